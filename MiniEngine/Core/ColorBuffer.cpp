@@ -133,9 +133,24 @@ void ColorBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Heig
 }
 
 void ColorBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t NumMips,
-    DXGI_FORMAT Format, EsramAllocator&)
+    DXGI_FORMAT Format, EsramAllocator& Allocator)
 {
-    Create(Name, Width, Height, NumMips, Format);
+    NumMips = (NumMips == 0 ? ComputeNumMips(Width, Height) : NumMips);
+    D3D12_RESOURCE_FLAGS Flags = CombineResourceFlags();
+    D3D12_RESOURCE_DESC ResourceDesc = DescribeTex2D(Width, Height, 1, NumMips, Format, Flags);
+
+    ResourceDesc.SampleDesc.Count = m_FragmentCount;
+    ResourceDesc.SampleDesc.Quality = 0;
+
+    D3D12_CLEAR_VALUE ClearValue = {};
+    ClearValue.Format = Format;
+    ClearValue.Color[0] = m_ClearColor.R();
+    ClearValue.Color[1] = m_ClearColor.G();
+    ClearValue.Color[2] = m_ClearColor.B();
+    ClearValue.Color[3] = m_ClearColor.A();
+
+    CreateTextureResource(Graphics::g_Device, Name, ResourceDesc, ClearValue, Allocator,
+        [this, Format, NumMips]() { CreateDerivedViews(Graphics::g_Device, Format, 1, NumMips); });
 }
 
 void ColorBuffer::CreateArray( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount,
@@ -156,9 +171,20 @@ void ColorBuffer::CreateArray( const std::wstring& Name, uint32_t Width, uint32_
 }
 
 void ColorBuffer::CreateArray( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount,
-    DXGI_FORMAT Format, EsramAllocator& )
+    DXGI_FORMAT Format, EsramAllocator& Allocator )
 {
-    CreateArray(Name, Width, Height, ArrayCount, Format);
+    D3D12_RESOURCE_FLAGS Flags = CombineResourceFlags();
+    D3D12_RESOURCE_DESC ResourceDesc = DescribeTex2D(Width, Height, ArrayCount, 1, Format, Flags);
+
+    D3D12_CLEAR_VALUE ClearValue = {};
+    ClearValue.Format = Format;
+    ClearValue.Color[0] = m_ClearColor.R();
+    ClearValue.Color[1] = m_ClearColor.G();
+    ClearValue.Color[2] = m_ClearColor.B();
+    ClearValue.Color[3] = m_ClearColor.A();
+
+    CreateTextureResource(Graphics::g_Device, Name, ResourceDesc, ClearValue, Allocator,
+        [this, Format, ArrayCount]() { CreateDerivedViews(Graphics::g_Device, Format, ArrayCount, 1); });
 }
 
 void ColorBuffer::GenerateMipMaps(CommandContext& BaseContext)
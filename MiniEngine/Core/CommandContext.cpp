@@ -18,6 +18,7 @@
 #include "GraphicsCore.h"
 #include "DescriptorHeap.h"
 #include "EngineProfiling.h"
+#include "TaskScheduler.h"
 
 #ifndef RELEASE
     #include <d3d11_2.h>
@@ -139,6 +140,17 @@ uint64_t CommandContext::Finish( bool WaitForCompletion )
     CommandQueue& Queue = g_CommandManager.GetQueue(m_Type);
 
     uint64_t FenceValue = Queue.ExecuteCommandList(m_CommandList);
+
+    if (WaitForCompletion)
+        g_CommandManager.WaitForFence(FenceValue);
+
+    ReleaseAfterExecution(Queue, FenceValue);
+
+    return FenceValue;
+}
+
+void CommandContext::ReleaseAfterExecution( CommandQueue& Queue, uint64_t FenceValue )
+{
     Queue.DiscardAllocator(FenceValue, m_CurrentAllocator);
     m_CurrentAllocator = nullptr;
 
@@ -147,12 +159,7 @@ uint64_t CommandContext::Finish( bool WaitForCompletion )
     m_DynamicViewDescriptorHeap.CleanupUsedHeaps(FenceValue);
     m_DynamicSamplerDescriptorHeap.CleanupUsedHeaps(FenceValue);
 
-    if (WaitForCompletion)
-        g_CommandManager.WaitForFence(FenceValue);
-
     g_ContextManager.FreeContext(this);
-
-    return FenceValue;
 }
 
 CommandContext::CommandContext(D3D12_COMMAND_LIST_TYPE Type) :
@@ -166,12 +173,14 @@ CommandContext::CommandContext(D3D12_COMMAND_LIST_TYPE Type) :
     m_CommandList = nullptr;
     m_CurrentAllocator = nullptr;
     ZeroMemory(m_CurrentDescriptorHeaps, sizeof(m_CurrentDescriptorHeaps));
+    ZeroMemory(&m_GraphicsState, sizeof(m_GraphicsState));
 
     m_CurGraphicsRootSignature = nullptr;
     m_CurGraphicsPipelineState = nullptr;
     m_CurComputeRootSignature = nullptr;
     m_CurComputePipelineState = nullptr;
     m_NumBarriersToFlush = 0;
+    ZeroMemory(&m_BarrierStats, sizeof(m_BarrierStats));
 }
 
 CommandContext::~CommandContext( void )
@@ -193,11 +202,14 @@ void CommandContext::Reset( void )
     m_CurrentAllocator = g_CommandManager.GetQueue(m_Type).RequestAllocator();
     m_CommandList->Reset(m_CurrentAllocator, nullptr);
 
+    ZeroMemory(&m_GraphicsState, sizeof(m_GraphicsState));
+
     m_CurGraphicsRootSignature = nullptr;
     m_CurGraphicsPipelineState = nullptr;
     m_CurComputeRootSignature = nullptr;
     m_CurComputePipelineState = nullptr;
     m_NumBarriersToFlush = 0;
+    ZeroMemory(&m_BarrierStats, sizeof(m_BarrierStats));
 
     BindDescriptorHeaps();
 }
@@ -220,11 +232,117 @@ void CommandContext::BindDescriptorHeaps( void )
 void GraphicsContext::SetRenderTargets( UINT NumRTVs, const D3D12_CPU_DESCRIPTOR_HANDLE RTVs[], D3D12_CPU_DESCRIPTOR_HANDLE DSV )
 {
     m_CommandList->OMSetRenderTargets( NumRTVs, RTVs, FALSE, &DSV );
+
+    ASSERT(NumRTVs <= D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
+    memcpy(m_GraphicsState.RTVs, RTVs, NumRTVs * sizeof(D3D12_CPU_DESCRIPTOR_HANDLE));
+    m_GraphicsState.NumRTVs = NumRTVs;
+    m_GraphicsState.DSV = DSV;
+    m_GraphicsState.HasDSV = true;
 }
 
 void GraphicsContext::SetRenderTargets(UINT NumRTVs, const D3D12_CPU_DESCRIPTOR_HANDLE RTVs[])
 {
     m_CommandList->OMSetRenderTargets(NumRTVs, RTVs, FALSE, nullptr);
+
+    ASSERT(NumRTVs <= D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
+    memcpy(m_GraphicsState.RTVs, RTVs, NumRTVs * sizeof(D3D12_CPU_DESCRIPTOR_HANDLE));
+    m_GraphicsState.NumRTVs = NumRTVs;
+    m_GraphicsState.HasDSV = false;
+}
+
+void GraphicsContext::InheritGraphicsState( const GraphicsContext& Parent )
+{
+    const GraphicsState& State = Parent.m_GraphicsState;
+
+    // Descriptor heaps come first, in case SetupState sets descriptor tables in them
+    memcpy(m_CurrentDescriptorHeaps, Parent.m_CurrentDescriptorHeaps, sizeof(m_CurrentDescriptorHeaps));
+    BindDescriptorHeaps();
+
+    // Setting the root signature object (not just the D3D one) prepares the dynamic descriptor heaps for it
+    if (State.RootSig != nullptr)
+        SetRootSignature(*State.RootSig);
+    if (Parent.m_CurGraphicsPipelineState != nullptr)
+    {
+        m_CommandList->SetPipelineState(Parent.m_CurGraphicsPipelineState);
+        m_CurGraphicsPipelineState = Parent.m_CurGraphicsPipelineState;
+    }
+
+    m_GraphicsState = State;
+    ApplyGraphicsState();
+}
+
+void GraphicsContext::ApplyGraphicsState( void )
+{
+    const GraphicsState& State = m_GraphicsState;
+
+    if (State.NumRTVs > 0 || State.HasDSV)
+        m_CommandList->OMSetRenderTargets(State.NumRTVs, State.RTVs, FALSE, State.HasDSV ? &State.DSV : nullptr);
+    if (State.HasViewport)
+        m_CommandList->RSSetViewports(1, &State.Viewport);
+    if (State.HasScissor)
+        m_CommandList->RSSetScissorRects(1, &State.Scissor);
+    if (State.HasBlendFactor)
+        m_CommandList->OMSetBlendFactor(State.BlendFactor);
+    m_CommandList->OMSetStencilRef(State.StencilRef);
+    if (State.Topology != D3D_PRIMITIVE_TOPOLOGY_UNDEFINED)
+        m_CommandList->IASetPrimitiveTopology(State.Topology);
+    if (State.IBView.BufferLocation != 0)
+        m_CommandList->IASetIndexBuffer(&State.IBView);
+    if (State.NumVBs > 0)
+        m_CommandList->IASetVertexBuffers(0, State.NumVBs, State.VBViews);
+}
+
+void GraphicsContext::RecordParallel( uint32_t NumItems, uint32_t NumContexts,
+    const std::function<void(GraphicsContext&)>& SetupState,
+    const std::function<void(GraphicsContext&, uint32_t, uint32_t)>& RecordRange )
+{
+    NumContexts = std::min(NumContexts, std::min(NumItems, (uint32_t)kMaxParallelContexts));
+    if (NumContexts <= 1)
+    {
+        if (NumItems > 0)
+        {
+            if (SetupState)
+                SetupState(*this);
+            RecordRange(*this, 0, NumItems);
+        }
+        return;
+    }
+
+    GraphicsContext* Contexts[kMaxParallelContexts];
+    ID3D12CommandList* CommandLists[kMaxParallelContexts];
+
+    for (uint32_t i = 0; i < NumContexts; ++i)
+    {
+        Contexts[i] = &g_ContextManager.AllocateContext(D3D12_COMMAND_LIST_TYPE_DIRECT)->GetGraphicsContext();
+        Contexts[i]->InheritGraphicsState(*this);
+        CommandLists[i] = Contexts[i]->m_CommandList;
+    }
+
+    TaskScheduler::ParallelFor(0u, NumContexts, [&]( uint32_t i )
+    {
+        GraphicsContext& Context = *Contexts[i];
+        if (SetupState)
+            SetupState(Context);
+        RecordRange(Context, (uint32_t)((uint64_t)NumItems * i / NumContexts), (uint32_t)((uint64_t)NumItems * (i + 1) / NumContexts));
+        Context.FlushResourceBarriers();
+    }, 1);
+
+    // What this context recorded before the call goes first.  Flush() keeps the root signature, PSO and descriptor
+    // heaps, the rest of the tracked state is restored here.  The new command list has no root arguments, so the
+    // cached descriptor tables are marked for upload again and SetupState() sets what the parallel contexts saw, as
+    // if this context had recorded the items itself.
+    Flush();
+    ApplyGraphicsState();
+    m_DynamicViewDescriptorHeap.UnbindAllValid();
+    m_DynamicSamplerDescriptorHeap.UnbindAllValid();
+    if (SetupState)
+        SetupState(*this);
+
+    CommandQueue& Queue = g_CommandManager.GetGraphicsQueue();
+    uint64_t FenceValue = Queue.ExecuteCommandLists(NumContexts, CommandLists);
+
+    for (uint32_t i = 0; i < NumContexts; ++i)
+        Contexts[i]->ReleaseAfterExecution(Queue, FenceValue);
 }
 
 void GraphicsContext::BeginQuery(ID3D12QueryHeap* QueryHeap, D3D12_QUERY_TYPE Type, UINT HeapIndex)
@@ -294,6 +412,11 @@ void GraphicsContext::ClearDepth( DepthBuffer& Target )
     m_CommandList->ClearDepthStencilView(Target.GetDSV(), D3D12_CLEAR_FLAG_DEPTH, Target.GetClearDepth(), Target.GetClearStencil(), 0, nullptr );
 }
 
+void GraphicsContext::ClearDepth( DepthBuffer& Target, const D3D12_RECT& Rect )
+{
+    m_CommandList->ClearDepthStencilView(Target.GetDSV(), D3D12_CLEAR_FLAG_DEPTH, Target.GetClearDepth(), Target.GetClearStencil(), 1, &Rect );
+}
+
 void GraphicsContext::ClearStencil( DepthBuffer& Target )
 {
     m_CommandList->ClearDepthStencilView(Target.GetDSV(), D3D12_CLEAR_FLAG_STENCIL, Target.GetClearDepth(), Target.GetClearStencil(), 0, nullptr);
@@ -306,14 +429,15 @@ void GraphicsContext::ClearDepthAndStencil( DepthBuffer& Target )
 
 void GraphicsContext::SetViewportAndScissor( const D3D12_VIEWPORT& vp, const D3D12_RECT& rect )
 {
-    ASSERT(rect.left < rect.right && rect.top < rect.bottom);
-    m_CommandList->RSSetViewports( 1, &vp );
-    m_CommandList->RSSetScissorRects( 1, &rect );
+    SetViewport(vp);
+    SetScissor(rect);
 }
 
 void GraphicsContext::SetViewport( const D3D12_VIEWPORT& vp )
 {
     m_CommandList->RSSetViewports( 1, &vp );
+    m_GraphicsState.Viewport = vp;
+    m_GraphicsState.HasViewport = true;
 }
 
 void GraphicsContext::SetViewport( FLOAT x, FLOAT y, FLOAT w, FLOAT h, FLOAT minDepth, FLOAT maxDepth )
@@ -325,13 +449,22 @@ void GraphicsContext::SetViewport( FLOAT x, FLOAT y, FLOAT w, FLOAT h, FLOAT min
     vp.MaxDepth = maxDepth;
     vp.TopLeftX = x;
     vp.TopLeftY = y;
-    m_CommandList->RSSetViewports( 1, &vp );
+    SetViewport(vp);
 }
 
 void GraphicsContext::SetScissor( const D3D12_RECT& rect )
 {
     ASSERT(rect.left < rect.right && rect.top < rect.bottom);
     m_CommandList->RSSetScissorRects( 1, &rect );
+    m_GraphicsState.Scissor = rect;
+    m_GraphicsState.HasScissor = true;
+}
+
+bool CommandContext::IsReadableInState(const GpuResource& Resource, D3D12_RESOURCE_STATES NewState)
+{
+    const D3D12_RESOURCE_STATES OldState = Resource.m_UsageState;
+    return NewState != 0 && (NewState & ~OldState) == 0 && (OldState & ~READ_ONLY_RESOURCE_STATES) == 0 &&
+        Resource.m_TransitioningState == (D3D12_RESOURCE_STATES)-1;
 }
 
 void CommandContext::TransitionResource(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate)
@@ -344,6 +477,9 @@ void CommandContext::TransitionResource(GpuResource& Resource, D3D12_RESOURCE_ST
         ASSERT((NewState & VALID_COMPUTE_QUEUE_RESOURCE_STATES) == NewState);
     }
 
+    if (IsReadableInState(Resource, NewState))
+        NewState = OldState;
+
     if (OldState != NewState)
     {
         ASSERT(m_NumBarriersToFlush < 16, "Exceeded arbitrary limit on buffered barriers");
@@ -381,7 +517,7 @@ void CommandContext::BeginResourceTransition(GpuResource& Resource, D3D12_RESOUR
 
     D3D12_RESOURCE_STATES OldState = Resource.m_UsageState;
 
-    if (OldState != NewState)
+    if (OldState != NewState && !IsReadableInState(Resource, NewState))
     {
         ASSERT(m_NumBarriersToFlush < 16, "Exceeded arbitrary limit on buffered barriers");
         D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
@@ -428,6 +564,36 @@ void CommandContext::InsertAliasBarrier(GpuResource& Before, GpuResource& After,
         FlushResourceBarriers();
 }
 
+void CommandContext::AcquireTransientResource(GpuResource& Resource)
+{
+    ASSERT(m_NumBarriersToFlush < 16, "Exceeded arbitrary limit on buffered barriers");
+    D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
+
+    // Any resource could have used the memory before
+    BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+    BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    BarrierDesc.Aliasing.pResourceBefore = nullptr;
+    BarrierDesc.Aliasing.pResourceAfter = Resource.GetResource();
+
+    if (m_NumBarriersToFlush == 16)
+        FlushResourceBarriers();
+
+    const D3D12_RESOURCE_DESC Desc = Resource->GetDesc();
+    if (Desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        return;
+
+    // Textures must be initialized before use, because their compression metadata is garbage too.  Compute queues
+    // discard UAVs, direct queues render targets and depth buffers.
+    if (m_Type == D3D12_COMMAND_LIST_TYPE_COMPUTE)
+        TransitionResource(Resource, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+    else if (Desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)
+        TransitionResource(Resource, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
+    else
+        TransitionResource(Resource, D3D12_RESOURCE_STATE_RENDER_TARGET, true);
+
+    m_CommandList->DiscardResource(Resource.GetResource(), nullptr);
+}
+
 void CommandContext::WriteBuffer( GpuResource& Dest, size_t DestOffset, const void* BufferData, size_t NumBytes )
 {
     ASSERT(BufferData != nullptr && Math::IsAligned(BufferData, 16));
@@ -57,6 +57,16 @@ struct DWParam
     | D3D12_RESOURCE_STATE_COPY_DEST \
     | D3D12_RESOURCE_STATE_COPY_SOURCE )
 
+// States that can be combined, so that a resource can be read in several ways without barriers in between
+#define READ_ONLY_RESOURCE_STATES \
+    ( D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER \
+    | D3D12_RESOURCE_STATE_INDEX_BUFFER \
+    | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE \
+    | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE \
+    | D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT \
+    | D3D12_RESOURCE_STATE_COPY_SOURCE \
+    | D3D12_RESOURCE_STATE_DEPTH_READ )
+
 class ContextManager
 {
 public:
@@ -137,12 +147,26 @@ public:
     void WriteBuffer( GpuResource& Dest, size_t DestOffset, const void* Data, size_t NumBytes );
     void FillBuffer( GpuResource& Dest, size_t DestOffset, DWParam Value, size_t NumBytes );
 
+    // Transitions to a read-only state are skipped when the resource is already in a combination of read-only
+    // states including it.
     void TransitionResource(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate = false);
     void BeginResourceTransition(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate = false);
     void InsertUAVBarrier(GpuResource& Resource, bool FlushImmediate = false);
     void InsertAliasBarrier(GpuResource& Before, GpuResource& After, bool FlushImmediate = false);
     inline void FlushResourceBarriers(void);
 
+    // Transient buffers share memory (see EsramAllocator.h.)  Call this before the first use of one each frame.  It
+    // takes the memory over from the buffers used before, and discards texture contents, which are garbage.
+    void AcquireTransientResource(GpuResource& Resource);
+
+    // Barriers submitted since the context began, and the ResourceBarrier() calls that submitted them
+    struct BarrierStats
+    {
+        uint32_t Barriers;
+        uint32_t Batches;
+    };
+    const BarrierStats& GetBarrierStats( void ) const { return m_BarrierStats; }
+
     void InsertTimeStamp( ID3D12QueryHeap* pQueryHeap, uint32_t QueryIdx );
     void ResolveTimeStamps( ID3D12Resource* pReadbackHeap, ID3D12QueryHeap* pQueryHeap, uint32_t NumQueries );
     void PIXBeginEvent(const wchar_t* label);
@@ -158,6 +182,13 @@ protected:
 
     void BindDescriptorHeaps( void );
 
+    // True when the resource is in several read-only states at once, NewState among them, so it can be read as is
+    static bool IsReadableInState( const GpuResource& Resource, D3D12_RESOURCE_STATES NewState );
+
+    // Returns the allocator, memory and descriptors used by the command list, once FenceValue is reached, and frees
+    // the context.
+    void ReleaseAfterExecution( CommandQueue& Queue, uint64_t FenceValue );
+
     CommandListManager* m_OwningManager;
     ID3D12GraphicsCommandList* m_CommandList;
     ID3D12CommandAllocator* m_CurrentAllocator;
@@ -167,11 +198,35 @@ protected:
     ID3D12RootSignature* m_CurComputeRootSignature;
     ID3D12PipelineState* m_CurComputePipelineState;
 
+    // Graphics state besides the PSO that command lists don't inherit.  It is kept so that parallel recording contexts
+    // can start with it (see GraphicsContext::RecordParallel().)  Root parameters aren't kept.
+    struct GraphicsState
+    {
+        const RootSignature* RootSig;
+        D3D12_CPU_DESCRIPTOR_HANDLE RTVs[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+        D3D12_CPU_DESCRIPTOR_HANDLE DSV;
+        UINT NumRTVs;
+        bool HasDSV;
+        bool HasViewport;
+        bool HasScissor;
+        bool HasBlendFactor;
+        D3D12_VIEWPORT Viewport;
+        D3D12_RECT Scissor;
+        float BlendFactor[4];
+        UINT StencilRef;
+        D3D12_PRIMITIVE_TOPOLOGY Topology;
+        D3D12_INDEX_BUFFER_VIEW IBView;
+        UINT NumVBs;    // Slots below NumVBs that were never set hold null views
+        D3D12_VERTEX_BUFFER_VIEW VBViews[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+    };
+    GraphicsState m_GraphicsState;
+
     DynamicDescriptorHeap m_DynamicViewDescriptorHeap;        // HEAP_TYPE_CBV_SRV_UAV
     DynamicDescriptorHeap m_DynamicSamplerDescriptorHeap;    // HEAP_TYPE_SAMPLER
 
     D3D12_RESOURCE_BARRIER m_ResourceBarrierBuffer[16];
     UINT m_NumBarriersToFlush;
+    BarrierStats m_BarrierStats;
 
     ID3D12DescriptorHeap* m_CurrentDescriptorHeaps[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
 
@@ -186,6 +241,8 @@ protected:
 
 class GraphicsContext : public CommandContext
 {
+    friend class FrameGraph;
+
 public:
 
     static GraphicsContext& Begin(const std::wstring& ID = L"")
@@ -193,10 +250,28 @@ public:
         return CommandContext::Begin(ID).GetGraphicsContext();
     }
 
+    enum { kMaxParallelContexts = 16 };
+
+    // Records NumItems items of work on up to NumContexts graphics contexts at once, one worker thread each, by calling
+    // RecordRange(Context, Begin, End) for consecutive ranges of items.  Each context starts with the root signature,
+    // PSO, descriptor heaps, render targets, viewport, scissor, topology, index and vertex buffers of this context,
+    // then SetupState(Context) sets the root parameters the items need.  The commands recorded on this context so far
+    // are submitted first, then those of the parallel contexts in order, so the GPU sees what serial recording
+    // would have produced.  Recording on a single context happens on this one, after SetupState(*this).
+    //
+    // Root parameters set on this context beforehand don't reach the parallel contexts, so SetupState must set every
+    // one the items use.  It runs on this context again before the call returns, since submitting it loses the root
+    // constants and descriptors it had, so recording can go on afterwards as it would have serially.
+    // Parallel contexts must not transition resources, and this context must not be used until the call returns.
+    void RecordParallel( uint32_t NumItems, uint32_t NumContexts,
+        const std::function<void(GraphicsContext&)>& SetupState,
+        const std::function<void(GraphicsContext&, uint32_t, uint32_t)>& RecordRange );
+
     void ClearUAV( GpuBuffer& Target );
     void ClearUAV( ColorBuffer& Target );
     void ClearColor( ColorBuffer& Target );
     void ClearDepth( DepthBuffer& Target );
+    void ClearDepth( DepthBuffer& Target, const D3D12_RECT& Rect );
     void ClearStencil( DepthBuffer& Target );
     void ClearDepthAndStencil( DepthBuffer& Target );
 
@@ -258,6 +333,12 @@ public:
         uint32_t MaxCommands = 1, GpuBuffer* CommandCounterBuffer = nullptr, uint64_t CounterOffset = 0);
 
 private:
+
+    // Sets the graphics state of Parent on this context, which must have just begun.
+    void InheritGraphicsState( const GraphicsContext& Parent );
+
+    // Sets the tracked state (see CommandContext::GraphicsState) on the command list again
+    void ApplyGraphicsState( void );
 };
 
 class ComputeContext : public CommandContext
@@ -306,6 +387,8 @@ inline void CommandContext::FlushResourceBarriers( void )
     if (m_NumBarriersToFlush > 0)
     {
         m_CommandList->ResourceBarrier(m_NumBarriersToFlush, m_ResourceBarrierBuffer);
+        m_BarrierStats.Barriers += m_NumBarriersToFlush;
+        ++m_BarrierStats.Batches;
         m_NumBarriersToFlush = 0;
     }
 }
@@ -316,6 +399,7 @@ inline void GraphicsContext::SetRootSignature( const RootSignature& RootSig )
         return;
 
     m_CommandList->SetGraphicsRootSignature(m_CurGraphicsRootSignature = RootSig.GetSignature());
+    m_GraphicsState.RootSig = &RootSig;
 
     m_DynamicViewDescriptorHeap.ParseGraphicsRootSignature(RootSig);
     m_DynamicSamplerDescriptorHeap.ParseGraphicsRootSignature(RootSig);
@@ -366,16 +450,20 @@ inline void GraphicsContext::SetScissor( UINT left, UINT top, UINT right, UINT b
 inline void GraphicsContext::SetStencilRef( UINT ref )
 {
     m_CommandList->OMSetStencilRef( ref );
+    m_GraphicsState.StencilRef = ref;
 }
 
 inline void GraphicsContext::SetBlendFactor( Color BlendFactor )
 {
     m_CommandList->OMSetBlendFactor( BlendFactor.GetPtr() );
+    memcpy(m_GraphicsState.BlendFactor, BlendFactor.GetPtr(), sizeof(m_GraphicsState.BlendFactor));
+    m_GraphicsState.HasBlendFactor = true;
 }
 
 inline void GraphicsContext::SetPrimitiveTopology( D3D12_PRIMITIVE_TOPOLOGY Topology )
 {
     m_CommandList->IASetPrimitiveTopology(Topology);
+    m_GraphicsState.Topology = Topology;
 }
 
 inline void ComputeContext::SetConstantArray( UINT RootEntry, UINT NumConstants, const void* pConstants )
@@ -492,7 +580,7 @@ inline void GraphicsContext::SetDynamicVB( UINT Slot, size_t NumVertices, size_t
     VBView.SizeInBytes = (UINT)BufferSize;
     VBView.StrideInBytes = (UINT)VertexStride;
 
-    m_CommandList->IASetVertexBuffers(Slot, 1, &VBView);
+    SetVertexBuffers(Slot, 1, &VBView);
 }
 
 inline void GraphicsContext::SetDynamicIB( size_t IndexCount, const uint16_t* IndexData )
@@ -509,7 +597,7 @@ inline void GraphicsContext::SetDynamicIB( size_t IndexCount, const uint16_t* In
     IBView.SizeInBytes = (UINT)(IndexCount * sizeof(uint16_t));
     IBView.Format = DXGI_FORMAT_R16_UINT;
 
-    m_CommandList->IASetIndexBuffer(&IBView);
+    SetIndexBuffer(IBView);
 }
 
 inline void GraphicsContext::SetDynamicSRV(UINT RootIndex, size_t BufferSize, const void* BufferData)
@@ -664,6 +752,7 @@ inline void ComputeContext::SetDescriptorTable( UINT RootIndex, D3D12_GPU_DESCRI
 inline void GraphicsContext::SetIndexBuffer( const D3D12_INDEX_BUFFER_VIEW& IBView )
 {
     m_CommandList->IASetIndexBuffer(&IBView);
+    m_GraphicsState.IBView = IBView;
 }
 
 inline void GraphicsContext::SetVertexBuffer( UINT Slot, const D3D12_VERTEX_BUFFER_VIEW& VBView )
@@ -673,7 +762,13 @@ inline void GraphicsContext::SetVertexBuffer( UINT Slot, const D3D12_VERTEX_BUFF
 
 inline void GraphicsContext::SetVertexBuffers( UINT StartSlot, UINT Count, const D3D12_VERTEX_BUFFER_VIEW VBViews[] )
 {
+    ASSERT(StartSlot + Count <= D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
     m_CommandList->IASetVertexBuffers(StartSlot, Count, VBViews);
+    if (VBViews != nullptr)
+        memcpy(m_GraphicsState.VBViews + StartSlot, VBViews, Count * sizeof(D3D12_VERTEX_BUFFER_VIEW));
+    else
+        memset(m_GraphicsState.VBViews + StartSlot, 0, Count * sizeof(D3D12_VERTEX_BUFFER_VIEW));
+    m_GraphicsState.NumVBs = std::max(m_GraphicsState.NumVBs, StartSlot + Count);
 }
 
 inline void GraphicsContext::Draw(UINT VertexCount, UINT VertexStartOffset)
@@ -116,13 +116,19 @@ void CommandListManager::CreateNewCommandList( D3D12_COMMAND_LIST_TYPE Type, ID3
 }
 
 uint64_t CommandQueue::ExecuteCommandList( ID3D12CommandList* List )
+{
+    return ExecuteCommandLists(1, &List);
+}
+
+uint64_t CommandQueue::ExecuteCommandLists( UINT NumLists, ID3D12CommandList* const* Lists )
 {
     std::lock_guard<std::mutex> LockGuard(m_FenceMutex);
 
-    ASSERT_SUCCEEDED(((ID3D12GraphicsCommandList*)List)->Close());
+    for (UINT i = 0; i < NumLists; ++i)
+        ASSERT_SUCCEEDED(((ID3D12GraphicsCommandList*)Lists[i])->Close());
 
-    // Kickoff the command list
-    m_CommandQueue->ExecuteCommandLists(1, &List);
+    // Kickoff the command lists, they execute in order
+    m_CommandQueue->ExecuteCommandLists(NumLists, Lists);
 
     // Signal the next fence value (with the GPU)
     m_CommandQueue->Signal(m_pFence, m_NextFenceValue);
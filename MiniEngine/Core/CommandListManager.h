@@ -23,6 +23,7 @@ class CommandQueue
 {
     friend class CommandListManager;
     friend class CommandContext;
+    friend class GraphicsContext;
 
 public:
     CommandQueue(D3D12_COMMAND_LIST_TYPE Type);
@@ -50,6 +51,7 @@ public:
 private:
 
     uint64_t ExecuteCommandList(ID3D12CommandList* List);
+    uint64_t ExecuteCommandLists(UINT NumLists, ID3D12CommandList* const* Lists);
     ID3D12CommandAllocator* RequestAllocator(void);
     void DiscardAllocator(uint64_t FenceValueForReset, ID3D12CommandAllocator* Allocator);
 
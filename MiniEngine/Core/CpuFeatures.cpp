@@ -0,0 +1,72 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+
+#include "pch.h"
+#include "CpuFeatures.h"
+#include <intrin.h>
+
+namespace
+{
+    struct Features
+    {
+        bool SSE42;
+        bool PCLMULQDQ;
+        bool AVX;
+        bool AVX512F;
+        bool ArmCRC32;
+    };
+
+    Features DetectFeatures( void )
+    {
+        Features Result = {};
+
+#if defined(_M_X64) || defined(_M_IX86)
+        int CpuInfo[4];
+        __cpuid(CpuInfo, 0);
+        const int MaxLeaf = CpuInfo[0];
+
+        __cpuid(CpuInfo, 1);
+        Result.SSE42 = (CpuInfo[2] & (1 << 20)) != 0;
+        Result.PCLMULQDQ = (CpuInfo[2] & (1 << 1)) != 0;
+
+        const bool OSXSAVE = (CpuInfo[2] & (1 << 27)) != 0;
+        const bool AVX = (CpuInfo[2] & (1 << 28)) != 0;
+        if (OSXSAVE && AVX)
+        {
+            // XMM and YMM state, then opmask, upper ZMM and high ZMM state
+            const uint64_t XCR0 = _xgetbv(0);
+            Result.AVX = (XCR0 & 0x06) == 0x06;
+
+            if (Result.AVX && MaxLeaf >= 7)
+            {
+                __cpuidex(CpuInfo, 7, 0);
+                Result.AVX512F = (CpuInfo[1] & (1 << 16)) != 0 && (XCR0 & 0xE6) == 0xE6;
+            }
+        }
+#elif defined(_M_ARM64)
+        Result.ArmCRC32 = IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE) != 0;
+#endif
+
+        return Result;
+    }
+
+    const Features& GetFeatures( void )
+    {
+        static const Features s_Features = DetectFeatures();
+        return s_Features;
+    }
+}
+
+bool CpuFeatures::HasSSE42( void ) { return GetFeatures().SSE42; }
+bool CpuFeatures::HasPCLMULQDQ( void ) { return GetFeatures().PCLMULQDQ; }
+bool CpuFeatures::HasAVX( void ) { return GetFeatures().AVX; }
+bool CpuFeatures::HasAVX512F( void ) { return GetFeatures().AVX512F; }
+bool CpuFeatures::HasArmCRC32( void ) { return GetFeatures().ArmCRC32; }
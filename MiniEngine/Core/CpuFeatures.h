@@ -0,0 +1,28 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  The instruction set extensions the CPU (and the OS) supports, for code that picks its fastest path
+// at run time.  They are detected once, on first use.
+//
+
+#pragma once
+
+namespace CpuFeatures
+{
+    bool HasSSE42( void );
+    bool HasPCLMULQDQ( void );
+
+    // AVX and AVX-512 also need the OS to save the YMM (and ZMM) registers on context switches
+    bool HasAVX( void );
+    bool HasAVX512F( void );
+
+    // The ARMv8 CRC32 instructions
+    bool HasArmCRC32( void );
+}
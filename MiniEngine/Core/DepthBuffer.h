@@ -37,8 +37,8 @@ public:
     void Create( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format,
         D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN );
 
-    // Create a depth buffer.  Memory will be allocated in ESRAM (on Xbox One).  On Windows,
-    // this functions the same as Create() without a video address.
+    // Create a transient depth buffer.  It shares memory with buffers whose lifetimes don't overlap
+    // its own, and is only created when the allocator is committed (see EsramAllocator.h.)
     void Create( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format,
         EsramAllocator& Allocator );
 
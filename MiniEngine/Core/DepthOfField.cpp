@@ -153,6 +153,14 @@ void DepthOfField::Render( CommandContext& BaseContext, float /*NearClipDist*/,
     ComputeContext& Context = BaseContext.GetComputeContext();
     Context.SetRootSignature(s_RootSignature);
 
+    GpuResource* TransientBuffers[] =
+    {
+        &g_DoFPresortBuffer, &g_DoFPrefilter, &g_DoFBlurColor[0], &g_DoFBlurColor[1], &g_DoFBlurAlpha[0], &g_DoFBlurAlpha[1],
+        &g_DoFWorkQueue, &g_DoFFastQueue, &g_DoFFixupQueue
+    };
+    for (GpuResource* Buffer : TransientBuffers)
+        Context.AcquireTransientResource(*Buffer);
+
     ColorBuffer& LinearDepth = g_LinearDepth[ Graphics::GetFrameCount() % 2 ];
 
     uint32_t BufferWidth = (uint32_t)LinearDepth.GetWidth();
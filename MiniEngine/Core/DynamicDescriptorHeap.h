@@ -40,6 +40,9 @@ public:
 
     void CleanupUsedHeaps( uint64_t fenceValue );
 
+    // Mark all descriptors in the cache as stale and in need of re-uploading.
+    void UnbindAllValid( void );
+
     // Copy multiple handles into the cache area reserved for the specified root parameter.
     void SetGraphicsDescriptorHandles( UINT RootIndex, UINT Offset, UINT NumHandles, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] )
     {
@@ -163,7 +166,4 @@ private:
     void CopyAndBindStagedTables( DescriptorHandleCache& HandleCache, ID3D12GraphicsCommandList* CmdList,
         void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) );
 
-    // Mark all descriptors in the cache as stale and in need of re-uploading.
-    void UnbindAllValid( void );
-
 };
@@ -19,6 +19,7 @@
 #include "GameInput.h"
 #include "GpuTimeManager.h"
 #include "CommandContext.h"
+#include "FramePacing.h"
 #include <vector>
 #include <unordered_map>
 #include <array>
@@ -46,10 +47,25 @@ public:
         m_Average = 0.0f;
         m_Minimum = 0.0f;
         m_Maximum = 0.0f;
+        m_LastFrameIndex = 0;
     }
 
     void RecordStat( uint32_t FrameIndex, float Value )
     {
+        // Frames skipped since the last one recorded have no value, rather than that of a frame one history ago
+        if (FrameIndex > m_LastFrameIndex + 1)
+        {
+            uint32_t NumSkipped = FrameIndex - m_LastFrameIndex - 1;
+            if (NumSkipped > kExtendedHistorySize)
+                NumSkipped = kExtendedHistorySize;
+            for (uint32_t i = 1; i <= NumSkipped; ++i)
+            {
+                m_RecentHistory[(FrameIndex - i) % kHistorySize] = 0.0f;
+                m_ExtendedHistory[(FrameIndex - i) % kExtendedHistorySize] = 0.0f;
+            }
+        }
+        m_LastFrameIndex = FrameIndex;
+
         m_RecentHistory[FrameIndex % kHistorySize] = Value;
         m_ExtendedHistory[FrameIndex % kExtendedHistorySize] = Value;
         m_Recent = Value;
@@ -93,6 +109,7 @@ private:
     float m_Average;
     float m_Minimum;
     float m_Maximum;
+    uint32_t m_LastFrameIndex;
 };
 
 class StatPlot
@@ -303,7 +320,8 @@ public:
         Context->PIXEndEvent();
     }
 
-    void GatherTimes(uint32_t FrameIndex)
+    // GPU times are only recorded when HasGpuTimes, under the frame they were read back from
+    void GatherTimes(uint32_t FrameIndex, bool HasGpuTimes, uint32_t GpuFrameIndex)
     {
         if (sm_SelectedScope == this)
         {
@@ -312,14 +330,15 @@ public:
         if (EngineProfiling::Paused)
         {
             for (auto node : m_Children)
-                node->GatherTimes(FrameIndex);
+                node->GatherTimes(FrameIndex, HasGpuTimes, GpuFrameIndex);
             return;
         }
         m_CpuTime.RecordStat(FrameIndex, 1000.0f * (float)SystemTime::TimeBetweenTicks(m_StartTick, m_EndTick));
-        m_GpuTime.RecordStat(FrameIndex, 1000.0f * m_GpuTimer.GetTime());
+        if (HasGpuTimes)
+            m_GpuTime.RecordStat(GpuFrameIndex, 1000.0f * m_GpuTimer.GetTime());
 
         for (auto node : m_Children)
-            node->GatherTimes(FrameIndex);
+            node->GatherTimes(FrameIndex, HasGpuTimes, GpuFrameIndex);
 
         m_StartTick = 0;
         m_EndTick = 0;
@@ -343,15 +362,19 @@ public:
     {
         uint32_t FrameIndex = (uint32_t)Graphics::GetFrameCount();
 
-        GpuTimeManager::BeginReadBack();
-        sm_RootScope.GatherTimes(FrameIndex);
-        s_FrameDelta.RecordStat(FrameIndex, GpuTimeManager::GetTime(0));
+        // The GPU times, when there are any, are those of a frame one to three frames ago
+        uint64_t GpuFrameIndex = 0;
+        const bool HasGpuTimes = GpuTimeManager::BeginReadBack(GpuFrameIndex);
+        sm_RootScope.GatherTimes(FrameIndex, HasGpuTimes, (uint32_t)GpuFrameIndex);
+        if (HasGpuTimes)
+            s_FrameDelta.RecordStat((uint32_t)GpuFrameIndex, GpuTimeManager::GetTime(0));
         GpuTimeManager::EndReadBack();
 
         float TotalCpuTime, TotalGpuTime;
         sm_RootScope.SumInclusiveTimes(TotalCpuTime, TotalGpuTime);
         s_TotalCpuTime.RecordStat(FrameIndex, TotalCpuTime);
-        s_TotalGpuTime.RecordStat(FrameIndex, TotalGpuTime);
+        if (HasGpuTimes)
+            s_TotalGpuTime.RecordStat((uint32_t)GpuFrameIndex, TotalGpuTime);
 
         GraphRenderer::Update(XMFLOAT2(TotalCpuTime, TotalGpuTime), 0, GraphType::Global);
     }
@@ -462,6 +485,8 @@ namespace EngineProfiling
 
         Text.DrawFormattedString( "CPU %7.3f ms, GPU %7.3f ms, %3u Hz\n",
             cpuTime, gpuTime, (uint32_t)(frameRate + 0.5f));
+
+        FramePacing::DisplayStats(Text);
     }
 
     void DisplayPerfGraph( GraphicsContext& Context )
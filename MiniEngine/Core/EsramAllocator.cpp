@@ -0,0 +1,253 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Author:  James Stanard
+//
+
+#include "pch.h"
+#include "EsramAllocator.h"
+#include "GraphicsCore.h"
+#include <algorithm>
+
+void EsramAllocator::PushStack( void )
+{
+    m_ScopeBegins.push_back(++m_Time);
+}
+
+void EsramAllocator::PopStack( void )
+{
+    ASSERT(!m_ScopeBegins.empty(), "PopStack() without PushStack()");
+    uint32_t ScopeBegin = m_ScopeBegins.back();
+    m_ScopeBegins.pop_back();
+    EndLifetimes(ScopeBegin);
+}
+
+void EsramAllocator::EndLifetimes( uint32_t ScopeBegin )
+{
+    ++m_Time;
+
+    // Allocations are in declaration order, so those of the scope and of its nested scopes are at the end.  Nested
+    // scopes have ended theirs already.
+    for (size_t i = m_Allocations.size(); i > 0 && m_Allocations[i - 1].Range.Begin >= ScopeBegin; --i)
+    {
+        if (m_Allocations[i - 1].Range.End == kOpenLifetime)
+            m_Allocations[i - 1].Range.End = m_Time;
+    }
+}
+
+void EsramAllocator::Alloc( const D3D12_RESOURCE_DESC& ResourceDesc, CreateFunction CreateResource )
+{
+    D3D12_RESOURCE_ALLOCATION_INFO Info = Graphics::g_Device->GetResourceAllocationInfo(0, 1, &ResourceDesc);
+
+    Allocation NewAllocation;
+    NewAllocation.Range.Size = Info.SizeInBytes;
+    NewAllocation.Range.Alignment = Info.Alignment;
+    NewAllocation.Range.Begin = m_ScopeBegins.empty() ? 0 : m_ScopeBegins.back();
+    NewAllocation.Range.End = kOpenLifetime;
+    NewAllocation.Range.Offset = 0;
+
+    if (ResourceDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        NewAllocation.Category = kBuffers;
+    else if (ResourceDesc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+        NewAllocation.Category = kTargetTextures;
+    else
+        NewAllocation.Category = kOtherTextures;
+
+    NewAllocation.CreateResource = std::move(CreateResource);
+
+    m_Allocations.push_back(std::move(NewAllocation));
+}
+
+namespace
+{
+    // Gives the allocations offsets in the given order, each at the lowest offset not used by an allocation placed
+    // before it whose lifetime overlaps its own.  Returns the size of the heap they need.
+    uint64_t PlaceInOrder( EsramAllocator::Placement* Placements, const std::vector<uint32_t>& Order )
+    {
+        std::vector<const EsramAllocator::Placement*> Neighbors;
+        uint64_t HeapSize = 0;
+
+        for (size_t i = 0; i < Order.size(); ++i)
+        {
+            EsramAllocator::Placement& Current = Placements[Order[i]];
+
+            // The placed allocations that are live at the same time, in increasing offset order
+            Neighbors.clear();
+            for (size_t j = 0; j < i; ++j)
+            {
+                const EsramAllocator::Placement& Other = Placements[Order[j]];
+                if (Other.Begin < Current.End && Current.Begin < Other.End)
+                    Neighbors.push_back(&Other);
+            }
+
+            std::sort(Neighbors.begin(), Neighbors.end(), []( const EsramAllocator::Placement* a, const EsramAllocator::Placement* b )
+            {
+                return a->Offset < b->Offset;
+            });
+
+            // Take the first gap that fits.  Neighbors can share memory with each other, so their ranges might overlap.
+            uint64_t Offset = 0;
+            for (const EsramAllocator::Placement* Other : Neighbors)
+            {
+                if (Offset + Current.Size <= Other->Offset)
+                    break;
+
+                Offset = std::max(Offset, Math::AlignUp(Other->Offset + Other->Size, (size_t)Current.Alignment));
+            }
+
+            Current.Offset = Offset;
+            HeapSize = std::max(HeapSize, Offset + Current.Size);
+        }
+
+        return HeapSize;
+    }
+}
+
+uint64_t EsramAllocator::Place( Placement* Placements, uint32_t Count )
+{
+    std::vector<uint32_t> Order(Count);
+    for (uint32_t i = 0; i < Count; ++i)
+        Order[i] = i;
+
+    // Scope order:  outer scopes before the scopes nested in them.  Lifetimes declared with PushStack() and
+    // PopStack() nest, so the allocations live with one that are already placed are those of its enclosing scopes,
+    // and each allocation is stacked right on top of them.  With a single alignment, that needs no more memory than
+    // PeakLiveSize().
+    std::sort(Order.begin(), Order.end(), [Placements]( uint32_t a, uint32_t b )
+    {
+        if (Placements[a].Begin != Placements[b].Begin)
+            return Placements[a].Begin < Placements[b].Begin;
+        if (Placements[a].End != Placements[b].End)
+            return Placements[a].End > Placements[b].End;
+        return Placements[a].Size != Placements[b].Size ? Placements[a].Size > Placements[b].Size : a < b;
+    });
+
+    uint64_t HeapSize = PlaceInOrder(Placements, Order);
+
+    std::vector<uint64_t> ScopeOrderOffsets(Count);
+    for (uint32_t i = 0; i < Count; ++i)
+        ScopeOrderOffsets[i] = Placements[i].Offset;
+
+    // Largest first, so that small allocations fill the gaps left between large ones.  With mixed alignments,
+    // stacking can waste more memory on padding than this does.
+    std::sort(Order.begin(), Order.end(), [Placements]( uint32_t a, uint32_t b )
+    {
+        return Placements[a].Size != Placements[b].Size ? Placements[a].Size > Placements[b].Size : a < b;
+    });
+
+    uint64_t LargestFirstHeapSize = PlaceInOrder(Placements, Order);
+    if (LargestFirstHeapSize < HeapSize)
+        return LargestFirstHeapSize;
+
+    for (uint32_t i = 0; i < Count; ++i)
+        Placements[i].Offset = ScopeOrderOffsets[i];
+
+    return HeapSize;
+}
+
+uint64_t EsramAllocator::PeakLiveSize( const Placement* Placements, uint32_t Count )
+{
+    // The sum of live sizes can only increase when an allocation begins
+    uint64_t PeakSize = 0;
+
+    for (uint32_t i = 0; i < Count; ++i)
+    {
+        const uint32_t Time = Placements[i].Begin;
+
+        uint64_t LiveSize = 0;
+        for (uint32_t j = 0; j < Count; ++j)
+        {
+            if (Placements[j].Begin <= Time && Time < Placements[j].End)
+                LiveSize += Placements[j].Size;
+        }
+
+        PeakSize = std::max(PeakSize, LiveSize);
+    }
+
+    return PeakSize;
+}
+
+void EsramAllocator::Commit( std::vector<Microsoft::WRL::ComPtr<ID3D12Heap>>& Heaps )
+{
+    ASSERT(m_ScopeBegins.empty(), "PushStack() without PopStack()");
+    EndLifetimes(0);
+
+    // Resource heap tier 1 can't mix buffers, render targets and other textures in a heap
+    D3D12_FEATURE_DATA_D3D12_OPTIONS Options = {};
+    bool bMixedHeaps = SUCCEEDED(Graphics::g_Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &Options, sizeof(Options)))
+        && Options.ResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2;
+
+    static const D3D12_HEAP_FLAGS kCategoryHeapFlags[kNumHeapCategories] =
+    {
+        D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS,
+        D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES,
+        D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES
+    };
+
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Heap>> NewHeaps;
+    std::vector<Placement> Placements;
+    std::vector<Allocation*> HeapAllocations;
+
+    uint64_t TotalSize = 0;
+    uint64_t TotalHeapSize = 0;
+    uint64_t TotalPeakSize = 0;
+
+    const uint32_t NumHeaps = bMixedHeaps ? 1 : kNumHeapCategories;
+
+    for (uint32_t HeapIndex = 0; HeapIndex < NumHeaps; ++HeapIndex)
+    {
+        Placements.clear();
+        HeapAllocations.clear();
+
+        uint64_t HeapAlignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+        for (Allocation& Alloc : m_Allocations)
+        {
+            if (bMixedHeaps || Alloc.Category == HeapIndex)
+            {
+                Placements.push_back(Alloc.Range);
+                HeapAllocations.push_back(&Alloc);
+                HeapAlignment = std::max(HeapAlignment, Alloc.Range.Alignment);
+                TotalSize += Alloc.Range.Size;
+            }
+        }
+
+        if (Placements.empty())
+            continue;
+
+        const uint32_t Count = (uint32_t)Placements.size();
+        const uint64_t HeapSize = Math::AlignUp(Place(Placements.data(), Count), (size_t)HeapAlignment);
+        TotalHeapSize += HeapSize;
+        TotalPeakSize += PeakLiveSize(Placements.data(), Count);
+
+        D3D12_HEAP_DESC HeapDesc = {};
+        HeapDesc.SizeInBytes = HeapSize;
+        HeapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+        HeapDesc.Alignment = HeapAlignment;
+        HeapDesc.Flags = bMixedHeaps ? D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES : kCategoryHeapFlags[HeapIndex];
+
+        Microsoft::WRL::ComPtr<ID3D12Heap> Heap;
+        ASSERT_SUCCEEDED(Graphics::g_Device->CreateHeap(&HeapDesc, MY_IID_PPV_ARGS(&Heap)));
+        Heap->SetName(L"Transient Buffer Heap");
+
+        for (uint32_t i = 0; i < Count; ++i)
+            HeapAllocations[i]->CreateResource(Heap.Get(), Placements[i].Offset);
+
+        NewHeaps.push_back(Heap);
+    }
+
+    Heaps.swap(NewHeaps);
+
+    Utility::Printf("Transient buffers:  %u buffers placed in %llu KB instead of %llu KB (%llu KB saved, lifetimes need at least %llu KB)\n",
+        (uint32_t)m_Allocations.size(), TotalHeapSize >> 10, TotalSize >> 10, (TotalSize - TotalHeapSize) >> 10, TotalPeakSize >> 10);
+
+    m_Allocations.clear();
+    m_Time = 0;
+}
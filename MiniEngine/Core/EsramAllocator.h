@@ -8,30 +8,84 @@
 //
 // Developed by Minigraph
 //
-// Author:  James Stanard 
+// Author:  James Stanard
 //
+// Description:  Places transient buffers, whose contents are only needed during part of a frame, in heaps they
+// share with other transient buffers.  Buffers are declared in nested scopes (PushStack() and PopStack()) standing
+// for the passes of the frame that use them, the way they were stacked in ESRAM on Xbox One.  A buffer lives as long
+// as its scope, so buffers of scopes that don't overlap can share memory.
+//
+// The lifetimes form an interval graph.  Commit() colors it with memory ranges:  buffers are placed one at a time,
+// each at the lowest offset not used by a placed buffer whose lifetime overlaps its own.  Placing them in scope order
+// stacks them the way ESRAM did, and placing them from the largest to the smallest can waste less on alignment, so
+// both are tried and the smaller heap is kept.
+// Buffers are only created by Commit(), so they mustn't be used before it.
+//
+// Before its first use in a frame, a transient buffer must be acquired with CommandContext::AcquireTransientResource().
 
 #pragma once
 
 #include "pch.h"
+#include <functional>
 
 class EsramAllocator
 {
 public:
-    EsramAllocator() {}
+    // Creates the resource in Heap at HeapOffset, along with its views
+    typedef std::function<void(ID3D12Heap* Heap, uint64_t HeapOffset)> CreateFunction;
+
+    EsramAllocator() : m_Time(0) {}
+
+    void PushStack();
+    void PopStack();
+
+    // Reserves memory for a resource.  CreateResource is called by Commit().
+    void Alloc( const D3D12_RESOURCE_DESC& ResourceDesc, CreateFunction CreateResource );
+
+    // Places and creates the buffers, then reports how much memory sharing saved.  Heaps receives the heaps the
+    // buffers were placed in, which must be kept until the buffers are destroyed.  Its previous heaps are released
+    // once the buffers placed in them have been recreated.
+    void Commit( std::vector<Microsoft::WRL::ComPtr<ID3D12Heap>>& Heaps );
 
-    void PushStack() {}
-    void PopStack() {}
+    // Lifetimes are half open intervals of scope events [Begin, End).
+    struct Placement
+    {
+        uint64_t Size;
+        uint64_t Alignment;
+        uint32_t Begin;
+        uint32_t End;
+        uint64_t Offset;    // Set by Place()
+    };
+
+    // Gives every allocation an offset such that allocations whose lifetimes overlap don't share memory, and returns
+    // the size of the heap they need.  It doesn't touch the device.
+    static uint64_t Place( Placement* Placements, uint32_t Count );
+
+    // The most memory live at any one time, which no placement can beat (alignment aside.)
+    static uint64_t PeakLiveSize( const Placement* Placements, uint32_t Count );
 
-    D3D12_GPU_VIRTUAL_ADDRESS Alloc( size_t size, size_t align, const std::wstring& bufferName )
+private:
+
+    enum HeapCategory
     {
-        (size); (align); (bufferName);
-        return D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
-    }
+        kBuffers,
+        kTargetTextures,    // Render targets and depth buffers
+        kOtherTextures,
+        kNumHeapCategories
+    };
 
-    intptr_t SizeOfFreeSpace( void ) const
+    struct Allocation
     {
-        return 0;
-    }
+        Placement Range;
+        HeapCategory Category;
+        CreateFunction CreateResource;
+    };
+
+    static const uint32_t kOpenLifetime = 0xFFFFFFFF;
+
+    void EndLifetimes( uint32_t ScopeBegin );
 
+    std::vector<Allocation> m_Allocations;
+    std::vector<uint32_t> m_ScopeBegins;
+    uint32_t m_Time;
 };
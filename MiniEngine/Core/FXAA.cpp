@@ -116,6 +116,9 @@ void FXAA::Render( ComputeContext& Context, bool bUsePreComputedLuma )
 
     ColorBuffer& Target = g_bTypedUAVLoadSupport_R11G11B10_FLOAT ? g_SceneColorBuffer : g_PostEffectsBuffer;
 
+    Context.AcquireTransientResource(g_FXAAWorkQueue);
+    Context.AcquireTransientResource(g_FXAAColorQueue);
+
     Context.SetRootSignature(RootSig);
     Context.SetConstants(0, 1.0f / Target.GetWidth(), 1.0f / Target.GetHeight(), (float)ContrastThreshold, (float)SubpixelRemoval);
     Context.SetConstant(0, g_FXAAWorkQueue.GetElementCount() - 1, 4);
@@ -0,0 +1,421 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+
+#include "pch.h"
+#include "FrameGraph.h"
+#include "GraphicsCore.h"
+#include "CommandContext.h"
+#include <algorithm>
+
+namespace
+{
+    bool IsReadOnly( D3D12_RESOURCE_STATES State )
+    {
+        return State != 0 && (State & ~READ_ONLY_RESOURCE_STATES) == 0;
+    }
+
+    // Consecutive uses of a resource that can share one state:  a write, or reads
+    struct Segment
+    {
+        uint32_t First;         // Positions in the order of the passes that weren't culled
+        uint32_t Last;
+        D3D12_RESOURCE_STATES State;
+        bool IsWrite;
+        bool IsAsync;
+    };
+
+    struct PlacedBarrier
+    {
+        uint32_t Position;
+        FrameGraph::Barrier Barrier;
+    };
+}
+
+void FrameGraph::Reset( void )
+{
+    m_Resources.clear();
+    m_Passes.clear();
+    m_LivePasses.clear();
+    m_Barriers.clear();
+    m_WaitAtEnd = false;
+    m_Compiled = false;
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+FrameGraph::ResourceHandle FrameGraph::ImportResource( GpuResource& Resource, bool IsOutput )
+{
+    ResourceNode Node = { &Resource, Resource.m_UsageState, IsOutput, false };
+    m_Resources.push_back(Node);
+    m_Compiled = false;
+    return (ResourceHandle)m_Resources.size() - 1;
+}
+
+FrameGraph::ResourceHandle FrameGraph::ImportTransientResource( GpuResource& Resource )
+{
+    ResourceHandle Handle = ImportResource(Resource);
+    m_Resources[Handle].IsTransient = true;
+    return Handle;
+}
+
+FrameGraph::PassHandle FrameGraph::AddPass( const std::wstring& Name, uint32_t Flags, ExecuteFunction Execute )
+{
+    ASSERT((Flags & kAsyncCompute) == 0 || (Flags & kComputePass) != 0, "Only compute passes can run asynchronously");
+
+    PassNode Node = {};
+    Node.Name = Name;
+    Node.Flags = Flags;
+    Node.Execute = std::move(Execute);
+    m_Passes.push_back(std::move(Node));
+    m_Compiled = false;
+    return (PassHandle)m_Passes.size() - 1;
+}
+
+void FrameGraph::Read( PassHandle Pass, ResourceHandle Resource, D3D12_RESOURCE_STATES State )
+{
+    ASSERT(IsReadOnly(State), "Declare unordered access and other writable states with Write()");
+    AddAccess(Pass, Resource, State, false);
+}
+
+void FrameGraph::Write( PassHandle Pass, ResourceHandle Resource, D3D12_RESOURCE_STATES State )
+{
+    AddAccess(Pass, Resource, State, true);
+}
+
+void FrameGraph::AddAccess( PassHandle Pass, ResourceHandle Resource, D3D12_RESOURCE_STATES State, bool IsWrite )
+{
+    ASSERT(Pass < m_Passes.size() && Resource < m_Resources.size());
+    m_Compiled = false;
+
+    for (Access& Existing : m_Passes[Pass].Accesses)
+    {
+        if (Existing.Resource == Resource)
+        {
+            Existing.State |= State;
+            Existing.IsWrite = Existing.IsWrite || IsWrite;
+            return;
+        }
+    }
+
+    Access NewAccess = { Resource, State, IsWrite };
+    m_Passes[Pass].Accesses.push_back(NewAccess);
+}
+
+const FrameGraph::Access* FrameGraph::FindAccess( const PassNode& Pass, ResourceHandle Resource ) const
+{
+    for (const Access& Existing : Pass.Accesses)
+    {
+        if (Existing.Resource == Resource)
+            return &Existing;
+    }
+    return nullptr;
+}
+
+bool FrameGraph::Conflicts( const PassNode& First, const PassNode& Second ) const
+{
+    // Passes can run at the same time when they only read the resources they share, in the same states
+    for (const Access& FirstAccess : First.Accesses)
+    {
+        const Access* SecondAccess = FindAccess(Second, FirstAccess.Resource);
+        if (SecondAccess != nullptr && (FirstAccess.IsWrite || SecondAccess->IsWrite || FirstAccess.State != SecondAccess->State))
+            return true;
+    }
+    return false;
+}
+
+void FrameGraph::Compile( void )
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+    m_Stats.Passes = (uint32_t)m_Passes.size();
+
+    CullPasses();
+    ScheduleAsyncCompute();
+    PlaceBarriers();
+
+    m_Compiled = true;
+}
+
+void FrameGraph::CullPasses( void )
+{
+    // Walking backwards, a pass is needed when it writes a resource that is needed after it.  Writes might only
+    // update part of a resource, so the writers before a needed pass are needed too.
+    std::vector<bool> Needed(m_Resources.size());
+    for (size_t i = 0; i < m_Resources.size(); ++i)
+        Needed[i] = m_Resources[i].IsOutput;
+
+    for (size_t i = m_Passes.size(); i > 0; --i)
+    {
+        PassNode& Pass = m_Passes[i - 1];
+        Pass.AsyncCandidate = false;
+        Pass.Async = false;
+        Pass.WaitForAsync = false;
+        Pass.FirstBarrier = 0;
+        Pass.NumBarriers = 0;
+
+        bool IsNeeded = (Pass.Flags & kNeverCull) != 0;
+        for (const Access& PassAccess : Pass.Accesses)
+            IsNeeded = IsNeeded || (PassAccess.IsWrite && Needed[PassAccess.Resource]);
+
+        Pass.Culled = !IsNeeded;
+        if (Pass.Culled)
+        {
+            ++m_Stats.CulledPasses;
+            continue;
+        }
+
+        for (const Access& PassAccess : Pass.Accesses)
+            Needed[PassAccess.Resource] = true;
+    }
+
+    m_LivePasses.clear();
+    for (uint32_t i = 0; i < (uint32_t)m_Passes.size(); ++i)
+    {
+        if (!m_Passes[i].Culled)
+            m_LivePasses.push_back(i);
+    }
+}
+
+void FrameGraph::ScheduleAsyncCompute( void )
+{
+    const uint32_t NumLivePasses = (uint32_t)m_LivePasses.size();
+
+    // A compute pass is worth moving to the compute queue when graphics passes run between it and the first pass
+    // that depends on it (or that it would race with.)
+    for (uint32_t i = 0; i < NumLivePasses; ++i)
+    {
+        PassNode& Pass = m_Passes[m_LivePasses[i]];
+        if ((Pass.Flags & kComputePass) == 0 || Pass.Accesses.empty())
+            continue;
+
+        uint32_t OverlappedPasses = 0;
+        for (uint32_t j = i + 1; j < NumLivePasses; ++j)
+        {
+            const PassNode& Other = m_Passes[m_LivePasses[j]];
+            if (Conflicts(Pass, Other))
+                break;
+            if ((Other.Flags & kAsyncCompute) == 0)
+                ++OverlappedPasses;
+        }
+
+        Pass.AsyncCandidate = OverlappedPasses > 0;
+        Pass.Async = Pass.AsyncCandidate && (Pass.Flags & kAsyncCompute) != 0;
+
+        for (const Access& PassAccess : Pass.Accesses)
+        {
+            ASSERT(!Pass.Async || (PassAccess.State & VALID_COMPUTE_QUEUE_RESOURCE_STATES) == PassAccess.State,
+                "Async compute passes can only use resources in compute queue states");
+        }
+
+        m_Stats.AsyncCandidates += Pass.AsyncCandidate ? 1 : 0;
+        m_Stats.AsyncPasses += Pass.Async ? 1 : 0;
+    }
+
+    // The graphics queue waits for the async passes before the first pass that conflicts with one of them.  Async
+    // passes follow each other on the compute queue, but their barriers are issued on the graphics queue, so they
+    // wait too.
+    std::vector<uint32_t> InFlight;
+
+    for (uint32_t PassIndex : m_LivePasses)
+    {
+        PassNode& Pass = m_Passes[PassIndex];
+
+        for (uint32_t AsyncIndex : InFlight)
+            Pass.WaitForAsync = Pass.WaitForAsync || Conflicts(m_Passes[AsyncIndex], Pass);
+
+        if (Pass.WaitForAsync)
+            InFlight.clear();
+
+        if (Pass.Async)
+            InFlight.push_back(PassIndex);
+    }
+
+    m_WaitAtEnd = !InFlight.empty();
+}
+
+void FrameGraph::PlaceBarriers( void )
+{
+    const uint32_t NumLivePasses = (uint32_t)m_LivePasses.size();
+
+    std::vector<PlacedBarrier> Placed;
+    std::vector<Segment> Segments;
+
+    for (ResourceHandle Resource = 0; Resource < (ResourceHandle)m_Resources.size(); ++Resource)
+    {
+        // Reads that follow each other share a segment, in the union of their states.  Resources used on the compute
+        // queue can't be in graphics states, so async passes only share segments in the same state.
+        Segments.clear();
+        for (uint32_t Position = 0; Position < NumLivePasses; ++Position)
+        {
+            const PassNode& Pass = m_Passes[m_LivePasses[Position]];
+            const Access* PassAccess = FindAccess(Pass, Resource);
+            if (PassAccess == nullptr)
+                continue;
+
+            if (!Segments.empty())
+            {
+                Segment& Current = Segments.back();
+                if (!Current.IsWrite && !PassAccess->IsWrite &&
+                    (!(Current.IsAsync || Pass.Async) || Current.State == PassAccess->State))
+                {
+                    Current.State |= PassAccess->State;
+                    Current.Last = Position;
+                    Current.IsAsync = Current.IsAsync || Pass.Async;
+                    continue;
+                }
+            }
+
+            Segment NewSegment = { Position, Position, PassAccess->State, PassAccess->IsWrite, Pass.Async };
+            Segments.push_back(NewSegment);
+        }
+
+        D3D12_RESOURCE_STATES State = m_Resources[Resource].InitialState;
+        const Segment* Previous = nullptr;
+
+        for (const Segment& Current : Segments)
+        {
+            if (Current.State == State)
+            {
+                // Unordered accesses in the same state only need to wait for the writes before them
+                if (Previous != nullptr && State == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+                {
+                    PlacedBarrier UAVBarrier = { Current.First, { Resource, State, kUAVBarrier } };
+                    Placed.push_back(UAVBarrier);
+                    ++m_Stats.UAVBarriers;
+                }
+            }
+            else if (!Current.IsWrite && IsReadOnly(State) && (Current.State & ~State) == 0)
+            {
+                // Already readable in all of the states needed
+            }
+            else if (Previous != nullptr && !Previous->IsAsync && Current.First > Previous->Last + 1)
+            {
+                // The passes in between hide the transition.  Async passes could still be using the resource.
+                PlacedBarrier Begin = { Previous->Last + 1, { Resource, Current.State, kBeginTransition } };
+                PlacedBarrier End = { Current.First, { Resource, Current.State, kEndTransition } };
+                Placed.push_back(Begin);
+                Placed.push_back(End);
+                ++m_Stats.SplitTransitions;
+                State = Current.State;
+            }
+            else
+            {
+                PlacedBarrier Transition = { Current.First, { Resource, Current.State, kTransition } };
+                Placed.push_back(Transition);
+                ++m_Stats.Transitions;
+                State = Current.State;
+            }
+
+            Previous = &Current;
+        }
+    }
+
+    std::stable_sort(Placed.begin(), Placed.end(), []( const PlacedBarrier& a, const PlacedBarrier& b )
+    {
+        return a.Position < b.Position;
+    });
+
+    m_Barriers.clear();
+    for (const PlacedBarrier& Entry : Placed)
+        m_Barriers.push_back(Entry.Barrier);
+
+    uint32_t NextBarrier = 0;
+    for (uint32_t Position = 0; Position < NumLivePasses; ++Position)
+    {
+        PassNode& Pass = m_Passes[m_LivePasses[Position]];
+        Pass.FirstBarrier = NextBarrier;
+        while (NextBarrier < Placed.size() && Placed[NextBarrier].Position == Position)
+            ++NextBarrier;
+        Pass.NumBarriers = NextBarrier - Pass.FirstBarrier;
+        m_Stats.Batches += Pass.NumBarriers > 0 ? 1 : 0;
+    }
+}
+
+void FrameGraph::Execute( GraphicsContext& Context, bool ScheduleBarriers )
+{
+    m_Acquired.assign(m_Resources.size(), false);
+
+    if (!ScheduleBarriers)
+    {
+        for (PassNode& Pass : m_Passes)
+        {
+            AcquireTransientResources(Context, Pass);
+            Pass.Execute(Context);
+        }
+        return;
+    }
+
+    ASSERT(m_Compiled, "Compile() the frame graph before executing it");
+
+    for (uint32_t PassIndex : m_LivePasses)
+    {
+        PassNode& Pass = m_Passes[PassIndex];
+
+        if (Pass.WaitForAsync)
+            WaitForAsyncCompute(Context);
+
+        AcquireTransientResources(Context, Pass);
+        IssueBarriers(Context, Pass);
+
+        if (Pass.Async)
+        {
+            // The compute queue waits for what was recorded so far, the graphics queue goes on without waiting
+            Graphics::g_CommandManager.GetComputeQueue().StallForFence(Context.Flush());
+            Context.ApplyGraphicsState();
+
+            ComputeContext& AsyncContext = ComputeContext::Begin(Pass.Name, true);
+            Pass.Execute(AsyncContext);
+            m_AsyncFenceValue = AsyncContext.Finish();
+        }
+        else
+        {
+            Context.FlushResourceBarriers();
+            Pass.Execute(Context);
+        }
+    }
+
+    if (m_WaitAtEnd)
+        WaitForAsyncCompute(Context);
+}
+
+void FrameGraph::AcquireTransientResources( CommandContext& Context, const PassNode& Pass )
+{
+    for (const Access& PassAccess : Pass.Accesses)
+    {
+        if (m_Resources[PassAccess.Resource].IsTransient && !m_Acquired[PassAccess.Resource])
+        {
+            Context.AcquireTransientResource(*m_Resources[PassAccess.Resource].Resource);
+            m_Acquired[PassAccess.Resource] = true;
+        }
+    }
+}
+
+void FrameGraph::IssueBarriers( CommandContext& Context, const PassNode& Pass )
+{
+    // TransitionResource() ends transitions that were begun, and inserts a UAV barrier when the resource is already
+    // in the unordered access state.
+    for (uint32_t i = Pass.FirstBarrier; i < Pass.FirstBarrier + Pass.NumBarriers; ++i)
+    {
+        const Barrier& PassBarrier = m_Barriers[i];
+        GpuResource& Resource = *m_Resources[PassBarrier.Resource].Resource;
+
+        if (PassBarrier.Type == kBeginTransition)
+            Context.BeginResourceTransition(Resource, PassBarrier.State);
+        else
+            Context.TransitionResource(Resource, PassBarrier.State);
+    }
+}
+
+void FrameGraph::WaitForAsyncCompute( GraphicsContext& Context )
+{
+    // The graphics work recorded while the async passes ran is submitted before the wait
+    Context.Flush();
+    Context.ApplyGraphicsState();
+    Graphics::g_CommandManager.GetGraphicsQueue().StallForFence(m_AsyncFenceValue);
+}
@@ -0,0 +1,176 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  A frame graph lets the passes of a frame declare the resources they read and write, in the states
+// they need them in, and issues the barriers for them.  It is rebuilt every frame:  Reset(), then import resources
+// and add passes in the order they should run, then Compile() and Execute().
+//
+// Compile() works on the declarations only, so it can run (and be checked) without a device.  It
+//    - culls the passes whose writes reach neither an output resource nor a pass that isn't culled,
+//    - merges consecutive reads of a resource into one transition to the union of their states,
+//    - splits a transition into begin and end barriers when passes not using the resource run in between,
+//    - inserts UAV barriers between passes writing the same unordered access resource,
+//    - batches the barriers of a pass into one ResourceBarrier() call, and
+//    - finds the compute passes that could overlap graphics passes on the compute queue.
+//
+// Barriers are issued through CommandContext, which tracks the actual states, so a pass can still transition the
+// resources it doesn't declare (and those it does, as long as it leaves them in the declared state.)
+//
+
+#pragma once
+
+#include "pch.h"
+#include <functional>
+
+class GpuResource;
+class CommandContext;
+class GraphicsContext;
+
+class FrameGraph
+{
+public:
+    typedef uint32_t ResourceHandle;
+    typedef uint32_t PassHandle;
+    typedef std::function<void(CommandContext&)> ExecuteFunction;
+
+    enum PassFlags
+    {
+        kGraphicsPass = 0,
+        kComputePass = 1,   // Only dispatches, so it could run on the compute queue
+        kAsyncCompute = 2,  // A compute pass that should run on the compute queue when graphics passes can overlap it
+        kNeverCull = 4      // Has effects the graph doesn't see
+    };
+
+    // What Compile() found.  Split transitions issue two barriers each, a begin and an end.
+    struct Stats
+    {
+        uint32_t Passes;
+        uint32_t CulledPasses;
+        uint32_t AsyncCandidates;
+        uint32_t AsyncPasses;
+        uint32_t Transitions;
+        uint32_t SplitTransitions;
+        uint32_t UAVBarriers;
+        uint32_t Batches;
+    };
+
+    FrameGraph() : m_WaitAtEnd(false), m_Compiled(false), m_Stats(), m_AsyncFenceValue(0) {}
+
+    void Reset( void );
+
+    // Resources come from outside of the graph, in the state they are in now.  Output resources are used after the
+    // frame (or by the next one), so their writers are never culled.
+    ResourceHandle ImportResource( GpuResource& Resource, bool IsOutput = false );
+
+    // Transient resources share memory with others (see EsramAllocator.h.)  The graph acquires them before the
+    // first pass using them, so passes mustn't.
+    ResourceHandle ImportTransientResource( GpuResource& Resource );
+
+    // Execute receives the graphics context, or a compute context of its own when the pass runs asynchronously.
+    PassHandle AddPass( const std::wstring& Name, uint32_t Flags, ExecuteFunction Execute );
+
+    // Read states must be read-only.  Unordered access counts as a write, even when the pass only reads.  A pass that
+    // uses a resource more than once needs it in all of the states at the same time.
+    void Read( PassHandle Pass, ResourceHandle Resource, D3D12_RESOURCE_STATES State );
+    void Write( PassHandle Pass, ResourceHandle Resource, D3D12_RESOURCE_STATES State );
+
+    void Compile( void );
+
+    // Runs the passes that weren't culled, each after its batch of barriers.  With ScheduleBarriers false, every pass
+    // runs in the order it was added and the graph issues no barriers, leaving them to the passes as code written
+    // without a graph does (for comparisons.)
+    void Execute( GraphicsContext& Context, bool ScheduleBarriers = true );
+
+    const Stats& GetStats( void ) const { return m_Stats; }
+
+    uint32_t GetPassCount( void ) const { return (uint32_t)m_Passes.size(); }
+    const std::wstring& GetPassName( PassHandle Pass ) const { return m_Passes[Pass].Name; }
+    bool IsPassCulled( PassHandle Pass ) const { return m_Passes[Pass].Culled; }
+    bool IsAsyncCandidate( PassHandle Pass ) const { return m_Passes[Pass].AsyncCandidate; }
+    bool IsAsync( PassHandle Pass ) const { return m_Passes[Pass].Async; }
+
+    enum BarrierType
+    {
+        kTransition,
+        kBeginTransition,
+        kEndTransition,
+        kUAVBarrier
+    };
+
+    struct Barrier
+    {
+        ResourceHandle Resource;
+        D3D12_RESOURCE_STATES State;
+        BarrierType Type;
+    };
+
+    // The barriers issued before a pass that wasn't culled
+    const Barrier* GetBarriers( PassHandle Pass, uint32_t& Count ) const
+    {
+        Count = m_Passes[Pass].NumBarriers;
+        return m_Barriers.data() + m_Passes[Pass].FirstBarrier;
+    }
+
+private:
+
+    struct Access
+    {
+        ResourceHandle Resource;
+        D3D12_RESOURCE_STATES State;
+        bool IsWrite;
+    };
+
+    struct ResourceNode
+    {
+        GpuResource* Resource;
+        D3D12_RESOURCE_STATES InitialState;
+        bool IsOutput;
+        bool IsTransient;
+    };
+
+    struct PassNode
+    {
+        std::wstring Name;
+        uint32_t Flags;
+        ExecuteFunction Execute;
+        std::vector<Access> Accesses;
+
+        // Set by Compile()
+        bool Culled;
+        bool AsyncCandidate;
+        bool Async;
+        bool WaitForAsync;  // Uses resources of async passes still running
+        uint32_t FirstBarrier;
+        uint32_t NumBarriers;
+    };
+
+    void AddAccess( PassHandle Pass, ResourceHandle Resource, D3D12_RESOURCE_STATES State, bool IsWrite );
+    const Access* FindAccess( const PassNode& Pass, ResourceHandle Resource ) const;
+    bool Conflicts( const PassNode& First, const PassNode& Second ) const;
+
+    void CullPasses( void );
+    void ScheduleAsyncCompute( void );
+    void PlaceBarriers( void );
+
+    void AcquireTransientResources( CommandContext& Context, const PassNode& Pass );
+    void IssueBarriers( CommandContext& Context, const PassNode& Pass );
+    void WaitForAsyncCompute( GraphicsContext& Context );
+
+    std::vector<ResourceNode> m_Resources;
+    std::vector<PassNode> m_Passes;
+    std::vector<uint32_t> m_LivePasses;     // Passes that weren't culled, in order
+    std::vector<Barrier> m_Barriers;        // Grouped by pass
+    std::vector<bool> m_Acquired;           // Transient resources acquired by Execute()
+    bool m_WaitAtEnd;
+    bool m_Compiled;
+    Stats m_Stats;
+
+    uint64_t m_AsyncFenceValue;
+};
@@ -0,0 +1,292 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+
+#include "pch.h"
+#include "FramePacing.h"
+#include "SystemTime.h"
+#include "GraphicsCore.h"
+#include "TextRenderer.h"
+#include <algorithm>
+#include <cmath>
+
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    #include <timeapi.h>
+    #pragma comment(lib, "winmm.lib")
+#endif
+
+namespace
+{
+    // How quickly the estimate of a sleep's duration follows changes in it
+    const double kSleepEstimateDecay = 1.0 / 16.0;
+
+    // Standard deviations above the mean duration of a sleep that it is expected to take at most
+    const double kSleepEstimateDeviations = 2.0;
+}
+
+const float FramePacer::kStutterRatio = 1.5f;
+
+int64_t SystemFrameClock::GetCurrentTick( void )
+{
+    return SystemTime::GetCurrentTick();
+}
+
+int64_t SystemFrameClock::GetTicksPerSecond( void )
+{
+    return SystemTime::GetTickFrequency();
+}
+
+void SystemFrameClock::SleepOneMillisec( void )
+{
+    Sleep(1);
+}
+
+void SystemFrameClock::SpinWait( void )
+{
+    YieldProcessor();
+}
+
+FramePacer::FramePacer( FrameClock& Clock ) :
+    m_Clock(Clock),
+    m_TicksPerSecond(Clock.GetTicksPerSecond()),
+    m_TargetFrameTicks(0),
+    m_FrameTime(0.0f),
+    m_MissedDeadlines(0),
+    m_FixedUpdateRate(60),
+    m_MaxStepsPerFrame(4),
+    m_FixedAccumulator(0),
+    m_NumFixedSteps(0),
+    m_SleepEnabled(true),
+    m_SleepVariance(0.0),
+    m_SleepTicks(0),
+    m_SpinTicks(0),
+    m_NumFrameTimes(0),
+    m_NextFrameTime(0)
+{
+    m_FrameStartTick = m_Clock.GetCurrentTick();
+    m_Deadline = m_FrameStartTick;
+
+    // Until sleeps are measured, expect them to take twice as long as asked
+    m_SleepMean = 0.002 * m_TicksPerSecond;
+}
+
+void FramePacer::SetTargetFrameRate( float FramesPerSecond )
+{
+    m_TargetFrameTicks = FramesPerSecond > 0.0f ? (int64_t)((double)m_TicksPerSecond / FramesPerSecond + 0.5) : 0;
+}
+
+void FramePacer::SetFixedUpdateRate( uint32_t StepsPerSecond, uint32_t MaxStepsPerFrame )
+{
+    ASSERT(StepsPerSecond > 0 && MaxStepsPerFrame > 0);
+
+    // Keep the fraction of a step accumulated
+    if (StepsPerSecond != m_FixedUpdateRate)
+    {
+        m_FixedAccumulator = m_FixedAccumulator * StepsPerSecond / m_FixedUpdateRate;
+        m_FixedUpdateRate = StepsPerSecond;
+    }
+    m_MaxStepsPerFrame = MaxStepsPerFrame;
+}
+
+void FramePacer::WaitUntil( int64_t Tick )
+{
+    int64_t CurrentTick = m_Clock.GetCurrentTick();
+
+    // Sleep while the time left is more than a sleep is expected to take
+    while (m_SleepEnabled)
+    {
+        const double SleepEstimate = m_SleepMean + kSleepEstimateDeviations * std::sqrt(m_SleepVariance);
+        if ((double)(Tick - CurrentTick) <= SleepEstimate)
+            break;
+
+        m_Clock.SleepOneMillisec();
+        const int64_t SleepEndTick = m_Clock.GetCurrentTick();
+        const double Delta = (double)(SleepEndTick - CurrentTick) - m_SleepMean;
+        m_SleepMean += kSleepEstimateDecay * Delta;
+        m_SleepVariance = (1.0 - kSleepEstimateDecay) * (m_SleepVariance + kSleepEstimateDecay * Delta * Delta);
+        m_SleepTicks += SleepEndTick - CurrentTick;
+        CurrentTick = SleepEndTick;
+    }
+
+    // Spin for the rest
+    const int64_t SpinStartTick = CurrentTick;
+    while (CurrentTick < Tick)
+    {
+        m_Clock.SpinWait();
+        CurrentTick = m_Clock.GetCurrentTick();
+    }
+    m_SpinTicks += CurrentTick - SpinStartTick;
+}
+
+void FramePacer::EndFrame( void )
+{
+    int64_t FrameStartTick = m_Clock.GetCurrentTick();
+
+    // A frame that is on time begins on its deadline, so that its time is exactly the target frame time.  A late
+    // frame begins when it is ready, and the following deadlines move with it, rather than hurrying frames to
+    // catch up.
+    if (m_TargetFrameTicks > 0)
+    {
+        m_Deadline += m_TargetFrameTicks;
+        if (FrameStartTick > m_Deadline)
+        {
+            ++m_MissedDeadlines;
+            m_Deadline = FrameStartTick;
+        }
+        else
+        {
+            WaitUntil(m_Deadline);
+            FrameStartTick = m_Deadline;
+        }
+    }
+    else
+    {
+        m_Deadline = FrameStartTick;
+    }
+
+    const int64_t FrameTicks = FrameStartTick - m_FrameStartTick;
+    m_FrameStartTick = FrameStartTick;
+    m_FrameTime = (float)((double)FrameTicks / m_TicksPerSecond);
+
+    m_FrameTimes[m_NextFrameTime] = m_FrameTime * 1000.0f;
+    m_NextFrameTime = (m_NextFrameTime + 1) % kMaxStatFrames;
+    m_NumFrameTimes = std::min(m_NumFrameTimes + 1, (uint32_t)kMaxStatFrames);
+
+    // Steps that have elapsed in real time, up to the maximum.  Time past that is dropped.
+    m_FixedAccumulator += FrameTicks * m_FixedUpdateRate;
+    m_NumFixedSteps = (uint32_t)std::min(m_FixedAccumulator / m_TicksPerSecond, (int64_t)m_MaxStepsPerFrame);
+    m_FixedAccumulator -= m_NumFixedSteps * m_TicksPerSecond;
+    if (m_FixedAccumulator >= m_TicksPerSecond)
+        m_FixedAccumulator %= m_TicksPerSecond;
+}
+
+float FramePacer::GetInterpolation( void ) const
+{
+    return (float)((double)m_FixedAccumulator / m_TicksPerSecond);
+}
+
+FrameStats FramePacer::GetStats( void ) const
+{
+    FrameStats Stats = {};
+    Stats.NumFrames = m_NumFrameTimes;
+    if (m_NumFrameTimes == 0)
+        return Stats;
+
+    float Sorted[kMaxStatFrames];
+    std::copy(m_FrameTimes, m_FrameTimes + m_NumFrameTimes, Sorted);
+    std::sort(Sorted, Sorted + m_NumFrameTimes);
+
+    float Total = 0.0f;
+    for (uint32_t i = 0; i < m_NumFrameTimes; ++i)
+        Total += Sorted[i];
+
+    // Nearest rank percentiles
+    auto Percentile = [&]( uint32_t Percent )
+    {
+        const uint32_t Rank = (Percent * m_NumFrameTimes + 99) / 100;
+        return Sorted[std::max(Rank, 1u) - 1];
+    };
+
+    Stats.Average = Total / m_NumFrameTimes;
+    Stats.Median = Percentile(50);
+    Stats.Percentile90 = Percentile(90);
+    Stats.Percentile99 = Percentile(99);
+    Stats.Max = Sorted[m_NumFrameTimes - 1];
+
+    const float StutterTime = kStutterRatio * Stats.Median;
+    Stats.StutterCount = (uint32_t)(Sorted + m_NumFrameTimes - std::upper_bound(Sorted, Sorted + m_NumFrameTimes, StutterTime));
+
+    return Stats;
+}
+
+namespace FramePacing
+{
+    NumVar TargetFrameRate("Timing/Frame Pacing/Target Frame Rate", 0.0f, 0.0f, 240.0f, 5.0f);
+    IntVar FixedUpdateRate("Timing/Frame Pacing/Fixed Update Rate", 60, 10, 240, 10);
+    IntVar MaxFixedSteps("Timing/Frame Pacing/Max Fixed Steps", 4, 1, 16);
+    IntVar MaxFrameLatency("Timing/Frame Pacing/Max Frame Latency", 2, 1, 3);
+    BoolVar SleepWhileWaiting("Timing/Frame Pacing/Sleep While Waiting", true);
+    BoolVar DisplayFrameStats("Timing/Frame Pacing/Display Statistics", false);
+
+    SystemFrameClock s_SystemClock;
+    FramePacer* s_FramePacer = nullptr;
+
+    void Initialize( void )
+    {
+        ASSERT(s_FramePacer == nullptr, "Frame pacing has already been initialized");
+
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+        // Sleep(1) takes a whole scheduler tick, 15.6 ms by default
+        timeBeginPeriod(1);
+#endif
+
+        s_FramePacer = new FramePacer(s_SystemClock);
+    }
+
+    void Shutdown( void )
+    {
+        delete s_FramePacer;
+        s_FramePacer = nullptr;
+
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+        timeEndPeriod(1);
+#endif
+    }
+
+    void Update( void )
+    {
+        s_FramePacer->SetTargetFrameRate(TargetFrameRate);
+        s_FramePacer->SetFixedUpdateRate(FixedUpdateRate, MaxFixedSteps);
+        s_FramePacer->SetSleepEnabled(SleepWhileWaiting);
+
+        Graphics::WaitForPresentQueue(MaxFrameLatency);
+        s_FramePacer->EndFrame();
+    }
+
+    bool IsFrameRateLimited( void )
+    {
+        return TargetFrameRate > 0.0f;
+    }
+
+    float GetFrameTime( void )
+    {
+        return s_FramePacer->GetFrameTime();
+    }
+
+    uint32_t GetNumFixedSteps( void )
+    {
+        return s_FramePacer->GetNumFixedSteps();
+    }
+
+    float GetFixedTimestep( void )
+    {
+        return s_FramePacer->GetFixedTimestep();
+    }
+
+    float GetInterpolation( void )
+    {
+        return s_FramePacer->GetInterpolation();
+    }
+
+    FrameStats GetStats( void )
+    {
+        return s_FramePacer->GetStats();
+    }
+
+    void DisplayStats( TextContext& Text )
+    {
+        if (!DisplayFrameStats)
+            return;
+
+        FrameStats Stats = GetStats();
+        Text.DrawFormattedString("Frame %6.2f ms median, %6.2f ms 90%%, %6.2f ms 99%%, %6.2f ms max, %u stutters in %u frames\n",
+            Stats.Median, Stats.Percentile90, Stats.Percentile99, Stats.Max, Stats.StutterCount, Stats.NumFrames);
+    }
+}
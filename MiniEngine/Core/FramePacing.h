@@ -0,0 +1,160 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Frame pacing.  Frames can be limited to a target frame rate.  A frame's deadline is the previous
+// deadline plus the target frame time, rather than the time the frame ended plus it, so that frames stay in lockstep
+// with the target and waiting can't accumulate error.  Waits sleep while the wait is longer than a sleep is expected
+// to overshoot by, and spin for the rest.
+//
+// The game can also be simulated with a fixed time step:  each frame runs as many steps as have elapsed in real time,
+// and rendering interpolates between the last two.  Time is accumulated in ticks, so which steps run is exact.
+//
+// FramePacer runs on a FrameClock, so that it can be driven by a virtual clock as well as the system's.
+//
+
+#pragma once
+
+class TextContext;
+
+class FrameClock
+{
+public:
+    virtual ~FrameClock() {}
+
+    virtual int64_t GetCurrentTick( void ) = 0;
+    virtual int64_t GetTicksPerSecond( void ) = 0;
+
+    // Gives up the CPU for about a millisecond, which it can overshoot by a lot
+    virtual void SleepOneMillisec( void ) = 0;
+
+    // Called while spinning on GetCurrentTick()
+    virtual void SpinWait( void ) {}
+};
+
+// FrameClock of the SystemTime performance counter
+class SystemFrameClock : public FrameClock
+{
+public:
+    virtual int64_t GetCurrentTick( void ) override;
+    virtual int64_t GetTicksPerSecond( void ) override;
+    virtual void SleepOneMillisec( void ) override;
+    virtual void SpinWait( void ) override;
+};
+
+// Frame time statistics over the most recent frames, in milliseconds
+struct FrameStats
+{
+    uint32_t NumFrames;
+    float Average;
+    float Median;
+    float Percentile90;
+    float Percentile99;
+    float Max;
+    uint32_t StutterCount;        // Frames that took more than kStutterRatio times the median
+};
+
+class FramePacer
+{
+public:
+    enum
+    {
+        kMaxStatFrames = 512
+    };
+
+    static const float kStutterRatio;
+
+    FramePacer( FrameClock& Clock );
+
+    // 0 to not limit the frame rate
+    void SetTargetFrameRate( float FramesPerSecond );
+
+    // Each frame runs up to MaxStepsPerFrame steps.  Time past that is dropped, and the simulation falls behind.
+    void SetFixedUpdateRate( uint32_t StepsPerSecond, uint32_t MaxStepsPerFrame );
+
+    // When disabled, waits only spin
+    void SetSleepEnabled( bool Enable ) { m_SleepEnabled = Enable; }
+
+    // Ends a frame and begins the next.  Waits for the frame's deadline, if the frame rate is limited, then measures
+    // the frame and counts the fixed steps the next should run.
+    void EndFrame( void );
+
+    // Waits until the clock reaches Tick
+    void WaitUntil( int64_t Tick );
+
+    // The time between the beginning of the last frame and this one
+    float GetFrameTime( void ) const { return m_FrameTime; }
+
+    uint32_t GetNumFixedSteps( void ) const { return m_NumFixedSteps; }
+    float GetFixedTimestep( void ) const { return 1.0f / m_FixedUpdateRate; }
+
+    // How far time has progressed from the last fixed step to the next, in [0, 1).  Rendering interpolates the
+    // state before the last step to the state after it by this much.
+    float GetInterpolation( void ) const;
+
+    FrameStats GetStats( void ) const;
+
+    // The number of frames that began after their deadline
+    uint64_t GetMissedDeadlineCount( void ) const { return m_MissedDeadlines; }
+
+    // The total ticks spent sleeping and spinning in waits
+    int64_t GetSleepTicks( void ) const { return m_SleepTicks; }
+    int64_t GetSpinTicks( void ) const { return m_SpinTicks; }
+
+private:
+
+    FrameClock& m_Clock;
+    int64_t m_TicksPerSecond;
+
+    int64_t m_TargetFrameTicks;
+    int64_t m_Deadline;
+    int64_t m_FrameStartTick;
+    float m_FrameTime;
+    uint64_t m_MissedDeadlines;
+
+    // Fixed steps are StepsPerSecond per TicksPerSecond.  The accumulator counts ticks times StepsPerSecond, so
+    // that a step is exactly TicksPerSecond of it.
+    uint32_t m_FixedUpdateRate;
+    uint32_t m_MaxStepsPerFrame;
+    int64_t m_FixedAccumulator;
+    uint32_t m_NumFixedSteps;
+
+    // Running estimate of how long SleepOneMillisec() takes, as a mean and variance in ticks
+    bool m_SleepEnabled;
+    double m_SleepMean;
+    double m_SleepVariance;
+    int64_t m_SleepTicks;
+    int64_t m_SpinTicks;
+
+    float m_FrameTimes[kMaxStatFrames];
+    uint32_t m_NumFrameTimes;
+    uint32_t m_NextFrameTime;
+};
+
+namespace FramePacing
+{
+    void Initialize( void );
+    void Shutdown( void );
+
+    // Called at the start of each frame, after the last was presented.  Waits for the presentation queue and the
+    // frame's deadline, then counts the fixed steps to run.
+    void Update( void );
+
+    // Whether the frame rate is limited, and so GetFrameTime() should be used as the frame's time step
+    bool IsFrameRateLimited( void );
+    float GetFrameTime( void );
+
+    uint32_t GetNumFixedSteps( void );
+    float GetFixedTimestep( void );
+    float GetInterpolation( void );
+
+    FrameStats GetStats( void );
+
+    void DisplayStats( TextContext& Text );
+}
@@ -19,6 +19,8 @@
 #include "BufferManager.h"
 #include "CommandContext.h"
 #include "PostEffects.h"
+#include "FramePacing.h"
+#include "TaskScheduler.h"
 
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
     #pragma comment(lib, "runtimeobject.lib")
@@ -45,8 +47,10 @@ namespace GameCore
 
     void InitializeApplication( IGameApp& game )
     {
+        TaskScheduler::Initialize();
         Graphics::Initialize();
         SystemTime::Initialize();
+        FramePacing::Initialize();
         GameInput::Initialize();
         EngineTuning::Initialize();
 
@@ -58,17 +62,25 @@ namespace GameCore
         game.Cleanup();
 
         GameInput::Shutdown();
+        FramePacing::Shutdown();
+        TaskScheduler::Shutdown();
     }
 
     bool UpdateApplication( IGameApp& game )
     {
         EngineProfiling::Update();
+        FramePacing::Update();
 
-        float DeltaTime = Graphics::GetFrameTime();
+        // Graphics assumes that frames are presented every vertical blank when VSync is on, which a limited
+        // frame rate needn't be
+        float DeltaTime = FramePacing::IsFrameRateLimited() ? FramePacing::GetFrameTime() : Graphics::GetFrameTime();
     
         GameInput::Update(DeltaTime);
         EngineTuning::Update(DeltaTime);
-        
+
+        for (uint32_t Step = 0; Step < FramePacing::GetNumFixedSteps(); ++Step)
+            game.FixedUpdate(FramePacing::GetFixedTimestep());
+
         game.Update(DeltaTime);
         game.RenderScene();
 
@@ -80,6 +92,7 @@ namespace GameCore
 
             // Exclude from timings this copy necessary to setup the test
             MipsContext.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_GENERIC_READ);
+            MipsContext.AcquireTransientResource(g_GenMipsBuffer);
             MipsContext.TransitionResource(g_GenMipsBuffer, D3D12_RESOURCE_STATE_COPY_DEST);
             MipsContext.CopySubresource(g_GenMipsBuffer, 0, g_SceneColorBuffer, 0);
 
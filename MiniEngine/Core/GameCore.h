@@ -33,6 +33,12 @@ namespace GameCore
         // rendering should be handled by this method.
         virtual void Update( float deltaT ) = 0;
 
+        // Optional fixed time step simulation.  Invoked before Update() as many times as steps of the fixed
+        // update rate have elapsed, with the same time step every time, so that the simulation is deterministic
+        // no matter the frame rate.  FramePacing::GetInterpolation() tells how far to blend rendered state from
+        // before the last step to after it.
+        virtual void FixedUpdate( float /*fixedDeltaT*/ ) {}
+
         // Official rendering pass
         virtual void RenderScene( void ) = 0;
 
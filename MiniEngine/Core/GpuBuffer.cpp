@@ -87,9 +87,17 @@ void GpuBuffer::CreatePlaced(const std::wstring& name, ID3D12Heap* pBackingHeap,
 }
 
 void GpuBuffer::Create(const std::wstring& name, uint32_t NumElements, uint32_t ElementSize,
-    EsramAllocator&, const void* initialData)
+    EsramAllocator& Allocator)
 {
-    Create(name, NumElements, ElementSize, initialData);
+    m_ElementCount = NumElements;
+    m_ElementSize = ElementSize;
+    m_BufferSize = NumElements * ElementSize;
+
+    Allocator.Alloc(DescribeBuffer(), [=]( ID3D12Heap* Heap, uint64_t HeapOffset )
+    {
+        Destroy();
+        CreatePlaced(name, Heap, (uint32_t)HeapOffset, NumElements, ElementSize);
+    });
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE GpuBuffer::CreateConstantBufferView(uint32_t Offset, uint32_t Size) const
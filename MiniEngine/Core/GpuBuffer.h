@@ -28,9 +28,10 @@ public:
     void Create( const std::wstring& name, uint32_t NumElements, uint32_t ElementSize,
         const void* initialData = nullptr );
 
-    // Create a buffer in ESRAM.  On Windows, ESRAM is not used.
+    // Create a transient buffer.  It shares memory with buffers whose lifetimes don't overlap its own, so it has no
+    // initial data, and it is only created when the allocator is committed (see EsramAllocator.h.)
     void Create( const std::wstring& name, uint32_t NumElements, uint32_t ElementSize,
-        EsramAllocator& Allocator, const void* initialData = nullptr);
+        EsramAllocator& Allocator );
 
     // Sub-Allocate a buffer out of a pre-allocated heap.  If initial data is provided, it will be copied into the buffer using the default command context.
     void CreatePlaced(const std::wstring& name, ID3D12Heap* pBackingHeap, uint32_t HeapOffset, uint32_t NumElements, uint32_t ElementSize,
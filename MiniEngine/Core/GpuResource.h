@@ -18,6 +18,7 @@ class GpuResource
     friend class CommandContext;
     friend class GraphicsContext;
     friend class ComputeContext;
+    friend class FrameGraph;
 
 public:
     GpuResource() : 
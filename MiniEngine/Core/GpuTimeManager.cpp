@@ -16,127 +16,268 @@
 #include "GraphicsCore.h"
 #include "CommandContext.h"
 #include "CommandListManager.h"
+#include <vector>
+#include <algorithm>
+#include <atomic>
 
 namespace
 {
-    ID3D12QueryHeap* sm_QueryHeap = nullptr;
-    ID3D12Resource* sm_ReadBackBuffer = nullptr;
+    // Frames of time stamps in flight.  A frame is read back up to kNumFrames - 1 frames after it was recorded.
+    const uint32_t kNumFrames = 4;
+
+    // Pairs of start and stop queries in a frame's heap, until more are needed
+    const uint32_t kInitialNumPairs = 256;
+
+    const uint32_t kInvalidPair = 0xFFFFFFFF;
+
+    struct FrameQueries
+    {
+        ID3D12QueryHeap* QueryHeap;
+        ID3D12Resource* ReadBackBuffer;
+        uint32_t MaxNumPairs;
+
+        // The pairs timers were given, including those past the end of the heap that went unmeasured
+        std::atomic<uint32_t> NumPairs;
+
+        // The pair of queries each timer was given in the frame, or kInvalidPair.  Pair 0 is the frame itself.
+        // Sized for the timers that existed when the frame began, so that starting a timer never reallocates it.
+        std::vector<uint32_t> TimerPairs;
+
+        // The fence of the resolve, and whether the frame has been resolved and not yet read back
+        uint64_t Fence;
+        bool Resolved;
+
+        // Graphics::GetFrameCount() when the frame began
+        uint64_t FrameIndex;
+    };
+
+    FrameQueries sm_Frames[kNumFrames];
+    uint32_t sm_CurrentFrame = 0;
+    uint32_t sm_NumPairsNeeded = kInitialNumPairs;
+
+    FrameQueries* sm_ReadBackFrame = nullptr;
     uint64_t* sm_TimeStampBuffer = nullptr;
-    uint64_t sm_Fence = 0;
-    uint32_t sm_MaxNumTimers = 0;
-    uint32_t sm_NumTimers = 1;
+    std::atomic<uint32_t> sm_NumTimers(1);
     uint64_t sm_ValidTimeStart = 0;
     uint64_t sm_ValidTimeEnd = 0;
     double sm_GpuTickDelta = 0.0;
+
+    void CreateFrameQueries(FrameQueries& Frame, uint32_t MaxNumPairs)
+    {
+        D3D12_HEAP_PROPERTIES HeapProps;
+        HeapProps.Type = D3D12_HEAP_TYPE_READBACK;
+        HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+        HeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+        HeapProps.CreationNodeMask = 1;
+        HeapProps.VisibleNodeMask = 1;
+
+        D3D12_RESOURCE_DESC BufferDesc;
+        BufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        BufferDesc.Alignment = 0;
+        BufferDesc.Width = sizeof(uint64_t) * MaxNumPairs * 2;
+        BufferDesc.Height = 1;
+        BufferDesc.DepthOrArraySize = 1;
+        BufferDesc.MipLevels = 1;
+        BufferDesc.Format = DXGI_FORMAT_UNKNOWN;
+        BufferDesc.SampleDesc.Count = 1;
+        BufferDesc.SampleDesc.Quality = 0;
+        BufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        BufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+        ASSERT_SUCCEEDED(Graphics::g_Device->CreateCommittedResource( &HeapProps, D3D12_HEAP_FLAG_NONE, &BufferDesc,
+            D3D12_RESOURCE_STATE_COPY_DEST, nullptr, MY_IID_PPV_ARGS(&Frame.ReadBackBuffer) ));
+        Frame.ReadBackBuffer->SetName(L"GpuTimeStamp Buffer");
+
+        D3D12_QUERY_HEAP_DESC QueryHeapDesc;
+        QueryHeapDesc.Count = MaxNumPairs * 2;
+        QueryHeapDesc.NodeMask = 1;
+        QueryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        ASSERT_SUCCEEDED(Graphics::g_Device->CreateQueryHeap(&QueryHeapDesc, MY_IID_PPV_ARGS(&Frame.QueryHeap)));
+        Frame.QueryHeap->SetName(L"GpuTimeStamp QueryHeap");
+
+        Frame.MaxNumPairs = MaxNumPairs;
+    }
+
+    void DestroyFrameQueries(FrameQueries& Frame)
+    {
+        if (Frame.ReadBackBuffer != nullptr)
+            Frame.ReadBackBuffer->Release();
+        Frame.ReadBackBuffer = nullptr;
+
+        if (Frame.QueryHeap != nullptr)
+            Frame.QueryHeap->Release();
+        Frame.QueryHeap = nullptr;
+    }
+
+    // Begins recording a frame's time stamps in its heap, which the GPU may still be resolving the frame before from
+    void BeginFrame(FrameQueries& Frame)
+    {
+        // Replaced by this frame, if it was never read back
+        Frame.Resolved = false;
+
+        // The heap can only be replaced once the GPU is done with it.  Until then, timers past the end of it go
+        // unmeasured.
+        if (sm_NumPairsNeeded > Frame.MaxNumPairs && Graphics::g_CommandManager.IsFenceComplete(Frame.Fence))
+        {
+            uint32_t MaxNumPairs = Frame.MaxNumPairs;
+            while (MaxNumPairs < sm_NumPairsNeeded)
+                MaxNumPairs *= 2;
+
+            DestroyFrameQueries(Frame);
+            CreateFrameQueries(Frame, MaxNumPairs);
+        }
+
+        Frame.NumPairs.store(1, std::memory_order_relaxed);
+        Frame.TimerPairs.assign(sm_NumTimers.load(std::memory_order_relaxed), kInvalidPair);
+        Frame.TimerPairs[0] = 0;
+        Frame.FrameIndex = Graphics::GetFrameCount();
+    }
+
+    // The time stamps of a timer in the frame read back, or false if it didn't run in it
+    bool GetTimeStamps(uint32_t TimerIdx, uint64_t& TimeStamp1, uint64_t& TimeStamp2)
+    {
+        ASSERT(TimerIdx < sm_NumTimers.load(std::memory_order_relaxed), "Invalid GPU timer index");
+
+        if (sm_ReadBackFrame == nullptr || TimerIdx >= sm_ReadBackFrame->TimerPairs.size())
+            return false;
+
+        const uint32_t Pair = sm_ReadBackFrame->TimerPairs[TimerIdx];
+        if (Pair == kInvalidPair)
+            return false;
+
+        TimeStamp1 = sm_TimeStampBuffer[Pair * 2];
+        TimeStamp2 = sm_TimeStampBuffer[Pair * 2 + 1];
+
+        return TimeStamp1 >= sm_ValidTimeStart && TimeStamp2 <= sm_ValidTimeEnd && TimeStamp2 > TimeStamp1;
+    }
 }
 
-void GpuTimeManager::Initialize(uint32_t MaxNumTimers)
+void GpuTimeManager::Initialize(void)
 {
     uint64_t GpuFrequency;
     Graphics::g_CommandManager.GetCommandQueue()->GetTimestampFrequency(&GpuFrequency);
     sm_GpuTickDelta = 1.0 / static_cast<double>(GpuFrequency);
 
-    D3D12_HEAP_PROPERTIES HeapProps;
-    HeapProps.Type = D3D12_HEAP_TYPE_READBACK;
-    HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-    HeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-    HeapProps.CreationNodeMask = 1;
-    HeapProps.VisibleNodeMask = 1;
-
-    D3D12_RESOURCE_DESC BufferDesc;
-    BufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    BufferDesc.Alignment = 0;
-    BufferDesc.Width = sizeof(uint64_t) * MaxNumTimers * 2;
-    BufferDesc.Height = 1;
-    BufferDesc.DepthOrArraySize = 1;
-    BufferDesc.MipLevels = 1;
-    BufferDesc.Format = DXGI_FORMAT_UNKNOWN;
-    BufferDesc.SampleDesc.Count = 1;
-    BufferDesc.SampleDesc.Quality = 0;
-    BufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-    BufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-    ASSERT_SUCCEEDED(Graphics::g_Device->CreateCommittedResource( &HeapProps, D3D12_HEAP_FLAG_NONE, &BufferDesc,
-        D3D12_RESOURCE_STATE_COPY_DEST, nullptr, MY_IID_PPV_ARGS(&sm_ReadBackBuffer) ));
-    sm_ReadBackBuffer->SetName(L"GpuTimeStamp Buffer");
-
-    D3D12_QUERY_HEAP_DESC QueryHeapDesc;
-    QueryHeapDesc.Count = MaxNumTimers * 2;
-    QueryHeapDesc.NodeMask = 1;
-    QueryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
-    ASSERT_SUCCEEDED(Graphics::g_Device->CreateQueryHeap(&QueryHeapDesc, MY_IID_PPV_ARGS(&sm_QueryHeap)));
-    sm_QueryHeap->SetName(L"GpuTimeStamp QueryHeap");
-
-    sm_MaxNumTimers = (uint32_t)MaxNumTimers;
+    for (uint32_t i = 0; i < kNumFrames; ++i)
+    {
+        FrameQueries& Frame = sm_Frames[i];
+        Frame.QueryHeap = nullptr;
+        Frame.ReadBackBuffer = nullptr;
+        Frame.Fence = 0;
+        Frame.Resolved = false;
+        CreateFrameQueries(Frame, kInitialNumPairs);
+    }
+
+    sm_CurrentFrame = 0;
+    BeginFrame(sm_Frames[0]);
+
+    CommandContext& Context = CommandContext::Begin();
+    Context.InsertTimeStamp(sm_Frames[0].QueryHeap, 0);
+    Context.Finish();
 }
 
 void GpuTimeManager::Shutdown()
 {
-    if (sm_ReadBackBuffer != nullptr)
-        sm_ReadBackBuffer->Release();
-
-    if (sm_QueryHeap != nullptr)
-        sm_QueryHeap->Release();
+    for (uint32_t i = 0; i < kNumFrames; ++i)
+        DestroyFrameQueries(sm_Frames[i]);
 }
 
 uint32_t GpuTimeManager::NewTimer(void)
 {
-    return sm_NumTimers++;
+    return sm_NumTimers.fetch_add(1, std::memory_order_relaxed);
 }
 
 void GpuTimeManager::StartTimer(CommandContext& Context, uint32_t TimerIdx)
 {
-    Context.InsertTimeStamp(sm_QueryHeap, TimerIdx * 2);
+    ASSERT(TimerIdx > 0 && TimerIdx < sm_NumTimers.load(std::memory_order_relaxed), "Invalid GPU timer index");
+
+    // Timers created since the frame began are measured from the next one
+    FrameQueries& Frame = sm_Frames[sm_CurrentFrame];
+    if (TimerIdx >= Frame.TimerPairs.size())
+        return;
+
+    uint32_t Pair = Frame.NumPairs.fetch_add(1, std::memory_order_relaxed);
+    if (Pair < Frame.MaxNumPairs)
+        Context.InsertTimeStamp(Frame.QueryHeap, Pair * 2);
+    else
+        Pair = kInvalidPair;
+
+    Frame.TimerPairs[TimerIdx] = Pair;
 }
 
 void GpuTimeManager::StopTimer(CommandContext& Context, uint32_t TimerIdx)
 {
-    Context.InsertTimeStamp(sm_QueryHeap, TimerIdx * 2 + 1);
+    FrameQueries& Frame = sm_Frames[sm_CurrentFrame];
+    if (TimerIdx < Frame.TimerPairs.size() && Frame.TimerPairs[TimerIdx] != kInvalidPair)
+        Context.InsertTimeStamp(Frame.QueryHeap, Frame.TimerPairs[TimerIdx] * 2 + 1);
 }
 
-void GpuTimeManager::BeginReadBack(void)
+bool GpuTimeManager::BeginReadBack(uint64_t& FrameIndex)
 {
-    Graphics::g_CommandManager.WaitForFence(sm_Fence);
+    ASSERT(sm_ReadBackFrame == nullptr, "Time stamps are already being read back");
+
+    // The most recent frame the GPU has finished resolving.  Older frames are skipped, and when the GPU hasn't
+    // finished any since the last read back, there is nothing to read this time.
+    for (uint32_t Age = 1; Age < kNumFrames; ++Age)
+    {
+        FrameQueries& Frame = sm_Frames[(sm_CurrentFrame + kNumFrames - Age) % kNumFrames];
+        if (!Frame.Resolved)
+            break;
+
+        if (sm_ReadBackFrame != nullptr)
+            Frame.Resolved = false;
+        else if (Graphics::g_CommandManager.IsFenceComplete(Frame.Fence))
+            sm_ReadBackFrame = &Frame;
+    }
+
+    if (sm_ReadBackFrame == nullptr)
+        return false;
 
     D3D12_RANGE Range;
     Range.Begin = 0;
-    Range.End = (sm_NumTimers * 2) * sizeof(uint64_t);
-    ASSERT_SUCCEEDED(sm_ReadBackBuffer->Map(0, &Range, reinterpret_cast<void**>(&sm_TimeStampBuffer)));
+    Range.End = (std::min(sm_ReadBackFrame->NumPairs.load(), sm_ReadBackFrame->MaxNumPairs) * 2) * sizeof(uint64_t);
+    ASSERT_SUCCEEDED(sm_ReadBackFrame->ReadBackBuffer->Map(0, &Range, reinterpret_cast<void**>(&sm_TimeStampBuffer)));
 
     sm_ValidTimeStart = sm_TimeStampBuffer[0];
     sm_ValidTimeEnd = sm_TimeStampBuffer[1];
 
-    // On the first frame, with random values in the timestamp query heap, we can avoid a misstart.
-    if (sm_ValidTimeEnd < sm_ValidTimeStart)
-    {
-        sm_ValidTimeStart = 0ull;
-        sm_ValidTimeEnd = 0ull;
-    }
+    FrameIndex = sm_ReadBackFrame->FrameIndex;
+    return true;
 }
 
 void GpuTimeManager::EndReadBack(void)
 {
-    // Unmap with an empty range to indicate nothing was written by the CPU
-    D3D12_RANGE EmptyRange = {};
-    sm_ReadBackBuffer->Unmap(0, &EmptyRange);
-    sm_TimeStampBuffer = nullptr;
+    if (sm_ReadBackFrame != nullptr)
+    {
+        // Unmap with an empty range to indicate nothing was written by the CPU
+        D3D12_RANGE EmptyRange = {};
+        sm_ReadBackFrame->ReadBackBuffer->Unmap(0, &EmptyRange);
+        sm_ReadBackFrame->Resolved = false;
+        sm_ReadBackFrame = nullptr;
+        sm_TimeStampBuffer = nullptr;
+    }
+
+    // Heaps are grown to fit the most timers a frame has started
+    FrameQueries& Frame = sm_Frames[sm_CurrentFrame];
+    const uint32_t NumPairs = Frame.NumPairs.load();
+    sm_NumPairsNeeded = std::max(sm_NumPairsNeeded, NumPairs);
+
+    sm_CurrentFrame = (sm_CurrentFrame + 1) % kNumFrames;
+    FrameQueries& NextFrame = sm_Frames[sm_CurrentFrame];
+    BeginFrame(NextFrame);
 
     CommandContext& Context = CommandContext::Begin();
-    Context.InsertTimeStamp(sm_QueryHeap, 1);
-    Context.ResolveTimeStamps(sm_ReadBackBuffer, sm_QueryHeap, sm_NumTimers * 2);
-    Context.InsertTimeStamp(sm_QueryHeap, 0);
-    sm_Fence = Context.Finish();
+    Context.InsertTimeStamp(Frame.QueryHeap, 1);
+    Context.ResolveTimeStamps(Frame.ReadBackBuffer, Frame.QueryHeap, std::min(NumPairs, Frame.MaxNumPairs) * 2);
+    Context.InsertTimeStamp(NextFrame.QueryHeap, 0);
+    Frame.Fence = Context.Finish();
+    Frame.Resolved = true;
 }
 
 float GpuTimeManager::GetTime(uint32_t TimerIdx)
 {
-    ASSERT(sm_TimeStampBuffer != nullptr, "Time stamp readback buffer is not mapped");
-    ASSERT(TimerIdx < sm_NumTimers, "Invalid GPU timer index");
-
-    uint64_t TimeStamp1 = sm_TimeStampBuffer[TimerIdx * 2];
-    uint64_t TimeStamp2 = sm_TimeStampBuffer[TimerIdx * 2 + 1];
-
-    if (TimeStamp1 < sm_ValidTimeStart || TimeStamp2 > sm_ValidTimeEnd || TimeStamp2 <= TimeStamp1 )
+    uint64_t TimeStamp1, TimeStamp2;
+    if (!GetTimeStamps(TimerIdx, TimeStamp1, TimeStamp2))
         return 0.0f;
 
     return static_cast<float>(sm_GpuTickDelta * (TimeStamp2 - TimeStamp1));
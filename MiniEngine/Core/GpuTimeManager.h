@@ -10,6 +10,11 @@
 //
 // Author:  James Stanard 
 //
+// Description:  Time stamps are written to a ring of query heaps, one per frame, and read back one to three frames
+// after they were recorded, once the GPU has finished with them, so that the CPU never waits on the GPU for them.
+// Timers don't own queries:  a timer is given the next pair of queries in the frame's heap when it starts, and heaps
+// grow, once the GPU is done with them, to fit the most timers a frame has started.
+//
 
 #pragma once
 
@@ -19,19 +24,24 @@ class CommandContext;
 
 namespace GpuTimeManager
 {
-    void Initialize( uint32_t MaxNumTimers = 4096 );
+    void Initialize(void);
     void Shutdown();
 
     // Reserve a unique timer index
     uint32_t NewTimer(void);
 
-    // Write start and stop time stamps on the GPU timeline
+    // Write start and stop time stamps on the GPU timeline.  Different timers can be started and stopped on
+    // different threads at once, but each timer on one thread at a time, and none during EndReadBack().  Timers
+    // created during a frame are measured from the next one.
     void StartTimer(CommandContext& Context, uint32_t TimerIdx);
     void StopTimer(CommandContext& Context, uint32_t TimerIdx);
 
     // Bookend all calls to GetTime() with Begin/End which correspond to Map/Unmap.  This
-    // needs to happen either at the very start or very end of a frame.
-    void BeginReadBack(void);
+    // needs to happen either at the very start or very end of a frame.  The times read are those of the most recent
+    // frame the GPU has finished, one to three frames before this one, and FrameIndex is the Graphics::GetFrameCount()
+    // of that frame.  Returns false when the GPU hasn't finished a frame since the last read back, and there are no
+    // times to read.
+    bool BeginReadBack(uint64_t& FrameIndex);
     void EndReadBack(void);
 
     // Returns the time in milliseconds between start and stop queries
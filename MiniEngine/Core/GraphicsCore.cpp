@@ -186,6 +186,8 @@ namespace Graphics
     UINT g_CurrentBuffer = 0;
 
     IDXGISwapChain1* s_SwapChain1 = nullptr;
+    HANDLE s_FrameLatencyWaitableObject = nullptr;
+    uint32_t s_MaxFrameLatency = 0;
 
     DescriptorAllocator g_DescriptorAllocator[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES] =
     {
@@ -246,7 +248,9 @@ void Graphics::Resize(uint32_t width, uint32_t height)
     for (uint32_t i = 0; i < SWAP_CHAIN_BUFFER_COUNT; ++i)
         g_DisplayPlane[i].Destroy();
 
-    ASSERT_SUCCEEDED(s_SwapChain1->ResizeBuffers(SWAP_CHAIN_BUFFER_COUNT, width, height, SwapChainFormat, 0));
+    // The waitable object can't be removed
+    ASSERT_SUCCEEDED(s_SwapChain1->ResizeBuffers(SWAP_CHAIN_BUFFER_COUNT, width, height, SwapChainFormat,
+        DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT));
 
     for (uint32_t i = 0; i < SWAP_CHAIN_BUFFER_COUNT; ++i)
     {
@@ -470,7 +474,7 @@ void Graphics::Initialize(void)
     swapChainDesc.SampleDesc.Count = 1;
     swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
     swapChainDesc.BufferCount = SWAP_CHAIN_BUFFER_COUNT;
-    swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+    swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH | DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
     swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
 
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP) // Win32
@@ -479,6 +483,8 @@ void Graphics::Initialize(void)
     ASSERT_SUCCEEDED(dxgiFactory->CreateSwapChainForCoreWindow(g_CommandManager.GetCommandQueue(), (IUnknown*)GameCore::g_window.Get(), &swapChainDesc, nullptr, &s_SwapChain1));
 #endif
 
+    s_FrameLatencyWaitableObject = ((IDXGISwapChain2*)s_SwapChain1)->GetFrameLatencyWaitableObject();
+
 #if CONDITIONALLY_ENABLE_HDR_OUTPUT && defined(NTDDI_WIN10_RS2) && (NTDDI_VERSION >= NTDDI_WIN10_RS2)
     {
         IDXGISwapChain4* swapChain = (IDXGISwapChain4*)s_SwapChain1;
@@ -583,7 +589,7 @@ void Graphics::Initialize(void)
 
     g_PreDisplayBuffer.Create(L"PreDisplay Buffer", g_DisplayWidth, g_DisplayHeight, 1, SwapChainFormat);
 
-    GpuTimeManager::Initialize(4096);
+    GpuTimeManager::Initialize();
     SetNativeResolution();
     TemporalEffects::Initialize();
     PostEffects::Initialize();
@@ -606,6 +612,8 @@ void Graphics::Shutdown( void )
     CommandContext::DestroyAllContexts();
     g_CommandManager.Shutdown();
     GpuTimeManager::Shutdown();
+    CloseHandle(s_FrameLatencyWaitableObject);
+    s_FrameLatencyWaitableObject = nullptr;
     s_SwapChain1->Release();
     PSO::DestroyAll();
     RootSignature::DestroyAll();
@@ -827,6 +835,19 @@ void Graphics::Present(void)
     SetNativeResolution();
 }
 
+void Graphics::WaitForPresentQueue(uint32_t MaxFrameLatency)
+{
+    ASSERT(s_FrameLatencyWaitableObject != nullptr);
+
+    if (MaxFrameLatency != s_MaxFrameLatency)
+    {
+        ASSERT_SUCCEEDED(((IDXGISwapChain2*)s_SwapChain1)->SetMaximumFrameLatency(MaxFrameLatency));
+        s_MaxFrameLatency = MaxFrameLatency;
+    }
+
+    WaitForSingleObjectEx(s_FrameLatencyWaitableObject, 1000, TRUE);
+}
+
 uint64_t Graphics::GetFrameCount(void)
 {
     return s_FrameIndex;
@@ -41,6 +41,10 @@ namespace Graphics
     void Shutdown(void);
     void Present(void);
 
+    // Waits until fewer than MaxFrameLatency presented frames are queued for display, so that the next frame reads
+    // its input as late as it can
+    void WaitForPresentQueue(uint32_t MaxFrameLatency);
+
     extern uint32_t g_DisplayWidth;
     extern uint32_t g_DisplayHeight;
 
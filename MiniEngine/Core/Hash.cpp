@@ -0,0 +1,231 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Author:  James Stanard 
+
+#include "pch.h"
+#include "Hash.h"
+#include "CpuFeatures.h"
+
+#include <intrin.h>
+
+namespace
+{
+    // The CRC32C polynomial, with bits reflected as the CRC instructions have them
+    const uint32_t kCrc32cPoly = 0x82F63B78;
+
+    // Interleaved kernels hash three blocks at a time, first of the long size and then of the short one.  The CRC
+    // instructions take three cycles and can start one a cycle.
+    const size_t kLongBlockWords = 128;      // 1 KB
+    const size_t kShortBlockWords = 8;       // 64 B
+
+    // Shifts a CRC over a number of zero bytes, which is multiplying it by x^(8 * bytes) mod P
+    struct CrcShift
+    {
+        uint32_t Constant;                  // x^(8 * bytes - 33) mod P, for a carry-less multiply (see Shift())
+        uint32_t Table[4][256];             // The shift of each byte of the CRC, without one
+    };
+
+    enum { kLongShift1, kLongShift2, kShortShift1, kShortShift2, kNumShifts };
+
+    CrcShift s_Shifts[kNumShifts];
+    uint32_t s_SliceTables[8][256];
+
+    // a * b mod P
+    uint32_t MultiplyModP( uint32_t a, uint32_t b )
+    {
+        uint32_t Product = 0;
+        for (uint32_t Bit = 1u << 31; Bit != 0; Bit >>= 1)
+        {
+            if (a & Bit)
+                Product ^= b;
+            b = b & 1 ? (b >> 1) ^ kCrc32cPoly : b >> 1;
+        }
+        return Product;
+    }
+
+    // x^n mod P
+    uint32_t PowerModP( uint64_t n )
+    {
+        uint32_t Power = 1u << 31;
+        for (uint32_t Square = 1u << 30; n != 0; n >>= 1, Square = MultiplyModP(Square, Square))
+        {
+            if (n & 1)
+                Power = MultiplyModP(Power, Square);
+        }
+        return Power;
+    }
+
+    void InitializeShift( CrcShift& Shift, size_t Bytes )
+    {
+        Shift.Constant = PowerModP(8 * Bytes - 33);
+
+        const uint32_t Multiplier = PowerModP(8 * Bytes);
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            for (uint32_t b = 0; b < 256; ++b)
+                Shift.Table[i][b] = MultiplyModP(b << (8 * i), Multiplier);
+        }
+    }
+
+    uint32_t ShiftByTable( uint32_t Crc, const CrcShift& Shift )
+    {
+        return Shift.Table[0][Crc & 0xFF] ^ Shift.Table[1][(Crc >> 8) & 0xFF] ^
+            Shift.Table[2][(Crc >> 16) & 0xFF] ^ Shift.Table[3][Crc >> 24];
+    }
+
+    void InitializeTables( void )
+    {
+        for (uint32_t b = 0; b < 256; ++b)
+        {
+            uint32_t Crc = b;
+            for (uint32_t i = 0; i < 8; ++i)
+                Crc = Crc & 1 ? (Crc >> 1) ^ kCrc32cPoly : Crc >> 1;
+            s_SliceTables[0][b] = Crc;
+        }
+        for (uint32_t i = 1; i < 8; ++i)
+        {
+            for (uint32_t b = 0; b < 256; ++b)
+                s_SliceTables[i][b] = (s_SliceTables[i - 1][b] >> 8) ^ s_SliceTables[0][s_SliceTables[i - 1][b] & 0xFF];
+        }
+
+        InitializeShift(s_Shifts[kLongShift1], kLongBlockWords * 8);
+        InitializeShift(s_Shifts[kLongShift2], kLongBlockWords * 16);
+        InitializeShift(s_Shifts[kShortShift1], kShortBlockWords * 8);
+        InitializeShift(s_Shifts[kShortShift2], kShortBlockWords * 16);
+    }
+
+    // Slice-by-8, for CPUs without CRC instructions
+    struct SoftwareCrc
+    {
+        static uint64_t Crc32( uint64_t Crc64, uint32_t Data )
+        {
+            const uint32_t Crc = (uint32_t)Crc64 ^ Data;
+            return s_SliceTables[3][Crc & 0xFF] ^ s_SliceTables[2][(Crc >> 8) & 0xFF] ^
+                s_SliceTables[1][(Crc >> 16) & 0xFF] ^ s_SliceTables[0][Crc >> 24];
+        }
+
+        static uint64_t Crc64( uint64_t Crc64, uint64_t Data )
+        {
+            const uint32_t Crc = (uint32_t)Crc64 ^ (uint32_t)Data;
+            const uint32_t High = (uint32_t)(Data >> 32);
+            return s_SliceTables[7][Crc & 0xFF] ^ s_SliceTables[6][(Crc >> 8) & 0xFF] ^
+                s_SliceTables[5][(Crc >> 16) & 0xFF] ^ s_SliceTables[4][Crc >> 24] ^
+                s_SliceTables[3][High & 0xFF] ^ s_SliceTables[2][(High >> 8) & 0xFF] ^
+                s_SliceTables[1][(High >> 16) & 0xFF] ^ s_SliceTables[0][High >> 24];
+        }
+
+        static uint64_t Shift( uint64_t Crc, const CrcShift& Shift ) { return ShiftByTable((uint32_t)Crc, Shift); }
+    };
+
+#if defined(_M_X64)
+    struct Sse42Crc
+    {
+        static uint64_t Crc32( uint64_t Crc, uint32_t Data ) { return _mm_crc32_u32((uint32_t)Crc, Data); }
+        static uint64_t Crc64( uint64_t Crc, uint64_t Data ) { return _mm_crc32_u64(Crc, Data); }
+
+        // The 64-bit product of the CRC and x^(8 * bytes - 33), reduced by the CRC of it
+        static uint64_t Shift( uint64_t Crc, const CrcShift& Shift )
+        {
+            const __m128i Product = _mm_clmulepi64_si128(_mm_cvtsi64_si128(Crc), _mm_cvtsi32_si128(Shift.Constant), 0);
+            return _mm_crc32_u64(0, (uint64_t)_mm_cvtsi128_si64(Product));
+        }
+    };
+#elif defined(_M_ARM64)
+    struct Armv8Crc
+    {
+        static uint64_t Crc32( uint64_t Crc, uint32_t Data ) { return __crc32cw((uint32_t)Crc, Data); }
+        static uint64_t Crc64( uint64_t Crc, uint64_t Data ) { return __crc32cd((uint32_t)Crc, Data); }
+        static uint64_t Shift( uint64_t Crc, const CrcShift& Shift ) { return ShiftByTable((uint32_t)Crc, Shift); }
+    };
+#endif
+
+    // Hashes rounds of three consecutive blocks as three independent CRCs, so that the CPU can compute them at once,
+    // then shifts the first two past the blocks after them and combines them.  A CRC of zeros is zero, so the result
+    // is the CRC of the three blocks.
+    template <typename Crc32c>
+    uint64_t HashBlocks( const uint64_t*& Iter, const uint64_t* const End, uint64_t Hash, size_t BlockWords,
+        const CrcShift& Shift1, const CrcShift& Shift2 )
+    {
+        while ((size_t)(End - Iter) >= 3 * BlockWords)
+        {
+            const uint64_t* const Block1 = Iter + BlockWords;
+            const uint64_t* const Block2 = Block1 + BlockWords;
+
+            uint64_t Crc0 = Hash, Crc1 = 0, Crc2 = 0;
+            for (size_t i = 0; i < BlockWords; ++i)
+            {
+                Crc0 = Crc32c::Crc64(Crc0, Iter[i]);
+                Crc1 = Crc32c::Crc64(Crc1, Block1[i]);
+                Crc2 = Crc32c::Crc64(Crc2, Block2[i]);
+            }
+
+            Hash = Crc32c::Shift(Crc0, Shift2) ^ Crc32c::Shift(Crc1, Shift1) ^ Crc2;
+            Iter = Block2 + BlockWords;
+        }
+        return Hash;
+    }
+
+    template <typename Crc32c, bool Interleave>
+    size_t HashRangeCrc( const uint32_t* const Begin, const uint32_t* const End, size_t Hash )
+    {
+        if (Begin == End)
+            return Hash;
+
+        const uint64_t* Iter64 = (const uint64_t*)Math::AlignUp(Begin, 8);
+        const uint64_t* const End64 = (const uint64_t* const)Math::AlignDown(End, 8);
+        uint64_t Crc = (uint32_t)Hash;
+
+        // If not 64-bit aligned, start with a single u32
+        if ((uint32_t*)Iter64 > Begin)
+            Crc = Crc32c::Crc32(Crc, *Begin);
+
+        if (Interleave)
+        {
+            Crc = HashBlocks<Crc32c>(Iter64, End64, Crc, kLongBlockWords, s_Shifts[kLongShift1], s_Shifts[kLongShift2]);
+            Crc = HashBlocks<Crc32c>(Iter64, End64, Crc, kShortBlockWords, s_Shifts[kShortShift1], s_Shifts[kShortShift2]);
+        }
+
+        // Iterate over consecutive u64 values
+        while (Iter64 < End64)
+            Crc = Crc32c::Crc64(Crc, *Iter64++);
+
+        // If there is a 32-bit remainder, accumulate that
+        if ((uint32_t*)Iter64 < End)
+            Crc = Crc32c::Crc32(Crc, *(uint32_t*)Iter64);
+
+        return (size_t)Crc;
+    }
+
+    typedef size_t (*HashRangeFunction)( const uint32_t* const Begin, const uint32_t* const End, size_t Hash );
+
+    HashRangeFunction SelectHashRange( void )
+    {
+        InitializeTables();
+
+#if defined(_M_X64)
+        if (CpuFeatures::HasSSE42() && CpuFeatures::HasPCLMULQDQ())
+            return HashRangeCrc<Sse42Crc, true>;
+        else if (CpuFeatures::HasSSE42())
+            return HashRangeCrc<Sse42Crc, false>;
+#elif defined(_M_ARM64)
+        if (CpuFeatures::HasArmCRC32())
+            return HashRangeCrc<Armv8Crc, true>;
+#endif
+
+        return HashRangeCrc<SoftwareCrc, false>;
+    }
+}
+
+size_t Utility::HashRange( const uint32_t* const Begin, const uint32_t* const End, size_t Hash )
+{
+    static const HashRangeFunction s_HashRange = SelectHashRange();
+    return s_HashRange(Begin, End, Hash);
+}
@@ -49,7 +49,7 @@ namespace Math
 
     inline Vector3 BoundingSphere::GetCenter( void ) const
     {
-        return Vector3(m_repr);
+        return Vector3(XMVECTOR(m_repr));
     }
 
     inline Scalar BoundingSphere::GetRadius( void ) const
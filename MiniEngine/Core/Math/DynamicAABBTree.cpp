@@ -0,0 +1,384 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+
+#include "pch.h"
+#include "DynamicAABBTree.h"
+
+using namespace Math;
+
+namespace
+{
+    // How much taller one child may be than the other before Rotate() gives up on the surface area heuristic
+    const int32_t kMaxImbalance = 4;
+
+    // Half the surface area of a box, the cost of a node in the surface area heuristic
+    inline float Area( const float MinBound[3], const float MaxBound[3] )
+    {
+        float X = MaxBound[0] - MinBound[0];
+        float Y = MaxBound[1] - MinBound[1];
+        float Z = MaxBound[2] - MinBound[2];
+        return X * Y + Y * Z + Z * X;
+    }
+
+    template <typename NodeType>
+    inline float Area( const NodeType& A )
+    {
+        return Area(A.MinBound, A.MaxBound);
+    }
+
+    template <typename NodeType>
+    inline float AreaOfUnion( const NodeType& A, const NodeType& B )
+    {
+        float MinBound[3], MaxBound[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            MinBound[axis] = A.MinBound[axis] < B.MinBound[axis] ? A.MinBound[axis] : B.MinBound[axis];
+            MaxBound[axis] = A.MaxBound[axis] > B.MaxBound[axis] ? A.MaxBound[axis] : B.MaxBound[axis];
+        }
+        return Area(MinBound, MaxBound);
+    }
+
+    template <typename NodeType>
+    inline void SetUnion( NodeType& Dest, const NodeType& A, const NodeType& B )
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            Dest.MinBound[axis] = A.MinBound[axis] < B.MinBound[axis] ? A.MinBound[axis] : B.MinBound[axis];
+            Dest.MaxBound[axis] = A.MaxBound[axis] > B.MaxBound[axis] ? A.MaxBound[axis] : B.MaxBound[axis];
+        }
+        Dest.Height = 1 + (A.Height > B.Height ? A.Height : B.Height);
+    }
+}
+
+int32_t DynamicAABBTree::Insert( Vector3 minBound, Vector3 maxBound, uint32_t userData )
+{
+    int32_t Leaf = AllocateNode();
+    Node& leaf = m_Nodes[Leaf];
+    SetBounds(leaf, minBound, maxBound);
+    leaf.UserData = userData;
+    leaf.Height = 0;
+    InsertLeaf(Leaf);
+    return Leaf;
+}
+
+void DynamicAABBTree::Remove( int32_t proxy )
+{
+    ASSERT(m_Nodes[proxy].IsLeaf() && m_Nodes[proxy].Height == 0, "Invalid AABB tree proxy");
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+}
+
+bool DynamicAABBTree::Update( int32_t proxy, Vector3 minBound, Vector3 maxBound )
+{
+    Node& leaf = m_Nodes[proxy];
+    ASSERT(leaf.IsLeaf() && leaf.Height == 0, "Invalid AABB tree proxy");
+
+    if (leaf.MinBound[0] <= minBound.GetX() && leaf.MinBound[1] <= minBound.GetY() && leaf.MinBound[2] <= minBound.GetZ() &&
+        leaf.MaxBound[0] >= maxBound.GetX() && leaf.MaxBound[1] >= maxBound.GetY() && leaf.MaxBound[2] >= maxBound.GetZ())
+    {
+        return false;
+    }
+
+    RemoveLeaf(proxy);
+    SetBounds(m_Nodes[proxy], minBound, maxBound);
+    InsertLeaf(proxy);
+    return true;
+}
+
+void DynamicAABBTree::Refit( int32_t proxy, Vector3 minBound, Vector3 maxBound )
+{
+    Node& leaf = m_Nodes[proxy];
+    ASSERT(leaf.IsLeaf() && leaf.Height == 0, "Invalid AABB tree proxy");
+    SetBounds(leaf, minBound, maxBound);
+    RefitAncestors(leaf.Parent);
+}
+
+void DynamicAABBTree::Clear( void )
+{
+    m_Nodes.clear();
+    m_Root = kNullNode;
+    m_FreeList = kNullNode;
+}
+
+void DynamicAABBTree::CopyTo( AABBTree& snapshot ) const
+{
+    snapshot.m_Nodes = m_Nodes;
+    snapshot.m_Root = m_Root;
+}
+
+int32_t DynamicAABBTree::AllocateNode( void )
+{
+    int32_t Index;
+    if (m_FreeList != kNullNode)
+    {
+        Index = m_FreeList;
+        m_FreeList = m_Nodes[Index].Parent;
+    }
+    else
+    {
+        Index = (int32_t)m_Nodes.size();
+        m_Nodes.emplace_back();
+    }
+
+    Node& node = m_Nodes[Index];
+    node.Parent = kNullNode;
+    node.Child[0] = kNullNode;
+    node.Child[1] = kNullNode;
+    node.Height = 0;
+    node.UserData = 0;
+    return Index;
+}
+
+void DynamicAABBTree::FreeNode( int32_t index )
+{
+    m_Nodes[index].Parent = m_FreeList;
+    m_Nodes[index].Height = -1;
+    m_FreeList = index;
+}
+
+void DynamicAABBTree::SetBounds( Node& node, Vector3 minBound, Vector3 maxBound )
+{
+    node.MinBound[0] = minBound.GetX() - m_Margin;
+    node.MinBound[1] = minBound.GetY() - m_Margin;
+    node.MinBound[2] = minBound.GetZ() - m_Margin;
+    node.MaxBound[0] = maxBound.GetX() + m_Margin;
+    node.MaxBound[1] = maxBound.GetY() + m_Margin;
+    node.MaxBound[2] = maxBound.GetZ() + m_Margin;
+}
+
+void DynamicAABBTree::InsertLeaf( int32_t leaf )
+{
+    if (m_Root == kNullNode)
+    {
+        m_Root = leaf;
+        m_Nodes[leaf].Parent = kNullNode;
+        return;
+    }
+
+    // Find the best sibling with the surface area heuristic.  Descending into a node costs the growth of its box,
+    // which is inherited by all its ancestors, and stops when pairing with the node itself is cheaper.
+    int32_t Index = m_Root;
+    while (!m_Nodes[Index].IsLeaf())
+    {
+        const Node& node = m_Nodes[Index];
+        const Node& leafNode = m_Nodes[leaf];
+        const Node& child0 = m_Nodes[node.Child[0]];
+        const Node& child1 = m_Nodes[node.Child[1]];
+
+        float CombinedArea = AreaOfUnion(node, leafNode);
+        float Cost = 2.0f * CombinedArea;
+        float InheritanceCost = 2.0f * (CombinedArea - Area(node));
+
+        float Cost0 = AreaOfUnion(child0, leafNode) + InheritanceCost;
+        if (!child0.IsLeaf())
+            Cost0 -= Area(child0);
+        float Cost1 = AreaOfUnion(child1, leafNode) + InheritanceCost;
+        if (!child1.IsLeaf())
+            Cost1 -= Area(child1);
+
+        if (Cost < Cost0 && Cost < Cost1)
+            break;
+
+        Index = Cost0 < Cost1 ? node.Child[0] : node.Child[1];
+    }
+
+    // Pair the leaf with its sibling under a new parent
+    int32_t Sibling = Index;
+    int32_t OldParent = m_Nodes[Sibling].Parent;
+    int32_t NewParent = AllocateNode();
+
+    Node& newParent = m_Nodes[NewParent];
+    newParent.Parent = OldParent;
+    newParent.Child[0] = Sibling;
+    newParent.Child[1] = leaf;
+    SetUnion(newParent, m_Nodes[Sibling], m_Nodes[leaf]);
+    m_Nodes[Sibling].Parent = NewParent;
+    m_Nodes[leaf].Parent = NewParent;
+
+    if (OldParent == kNullNode)
+    {
+        m_Root = NewParent;
+    }
+    else
+    {
+        Node& oldParent = m_Nodes[OldParent];
+        oldParent.Child[oldParent.Child[0] == Sibling ? 0 : 1] = NewParent;
+        RefitAncestors(OldParent);
+    }
+}
+
+void DynamicAABBTree::RemoveLeaf( int32_t leaf )
+{
+    if (leaf == m_Root)
+    {
+        m_Root = kNullNode;
+        return;
+    }
+
+    // Replace the parent with the sibling
+    int32_t Parent = m_Nodes[leaf].Parent;
+    int32_t GrandParent = m_Nodes[Parent].Parent;
+    int32_t Sibling = m_Nodes[Parent].Child[m_Nodes[Parent].Child[0] == leaf ? 1 : 0];
+
+    m_Nodes[Sibling].Parent = GrandParent;
+    FreeNode(Parent);
+
+    if (GrandParent == kNullNode)
+    {
+        m_Root = Sibling;
+    }
+    else
+    {
+        Node& grandParent = m_Nodes[GrandParent];
+        grandParent.Child[grandParent.Child[0] == Parent ? 0 : 1] = Sibling;
+        RefitAncestors(GrandParent);
+    }
+}
+
+void DynamicAABBTree::RefitAncestors( int32_t index )
+{
+    while (index != kNullNode)
+    {
+        Node& node = m_Nodes[index];
+        SetUnion(node, m_Nodes[node.Child[0]], m_Nodes[node.Child[1]]);
+        Rotate(index);
+        index = m_Nodes[index].Parent;
+    }
+}
+
+// Tree rotations ("Automatic Creation of Object Hierarchies for Ray Tracing", Kensler 2008):  a child of the node
+// can swap places with a grandchild on the other side.  That only changes the box of the other child, so the swap
+// that shrinks that box the most is made, if any.
+//
+// The surface area heuristic alone builds chains out of identical or nested boxes, which would overflow the
+// queries' fixed stacks.  So when a child is more than kMaxImbalance levels shorter than the other one, it swaps
+// with the taller grandchild instead, whatever the areas.  That's the AVL style rotation of Box2D's dynamic tree, and
+// it keeps the height logarithmic.  Balancing every node that way makes the tree much worse for queries.
+void DynamicAABBTree::Rotate( int32_t index )
+{
+    Node& node = m_Nodes[index];
+    if (node.Height < 2)
+        return;
+
+    float BestDelta = 0.0f;
+    int BestSide = -1, BestGrandChild = -1;
+
+    const int32_t Height0 = m_Nodes[node.Child[0]].Height;
+    const int32_t Height1 = m_Nodes[node.Child[1]].Height;
+    if (Height0 > Height1 + kMaxImbalance || Height1 > Height0 + kMaxImbalance)
+    {
+        BestSide = Height0 < Height1 ? 0 : 1;
+        const Node& other = m_Nodes[node.Child[1 - BestSide]];
+        BestGrandChild = m_Nodes[other.Child[0]].Height > m_Nodes[other.Child[1]].Height ? 0 : 1;
+    }
+    else
+    {
+        for (int Side = 0; Side < 2; ++Side)
+        {
+            const Node& child = m_Nodes[node.Child[Side]];
+            const Node& other = m_Nodes[node.Child[1 - Side]];
+            if (other.IsLeaf())
+                continue;
+
+            float OtherArea = Area(other);
+            for (int GrandChild = 0; GrandChild < 2; ++GrandChild)
+            {
+                // The other child would keep its other grandchild and adopt this child
+                float Delta = AreaOfUnion(child, m_Nodes[other.Child[1 - GrandChild]]) - OtherArea;
+                if (Delta < BestDelta)
+                {
+                    BestDelta = Delta;
+                    BestSide = Side;
+                    BestGrandChild = GrandChild;
+                }
+            }
+        }
+    }
+
+    if (BestSide < 0)
+        return;
+
+    int32_t Child = node.Child[BestSide];
+    int32_t Other = node.Child[1 - BestSide];
+    Node& other = m_Nodes[Other];
+    int32_t GrandChild = other.Child[BestGrandChild];
+
+    node.Child[BestSide] = GrandChild;
+    m_Nodes[GrandChild].Parent = index;
+    other.Child[BestGrandChild] = Child;
+    m_Nodes[Child].Parent = Other;
+
+    SetUnion(other, m_Nodes[other.Child[0]], m_Nodes[other.Child[1]]);
+    const Node& child0 = m_Nodes[node.Child[0]];
+    const Node& child1 = m_Nodes[node.Child[1]];
+    node.Height = 1 + (child0.Height > child1.Height ? child0.Height : child1.Height);
+}
+
+uint32_t AABBTree::QueryNearest( Vector3 point, uint32_t k, uint32_t* userData, float* distanceSq ) const
+{
+    if (m_Root == kNullNode || k == 0)
+        return 0;
+
+    const float Point[3] = { point.GetX(), point.GetY(), point.GetZ() };
+
+    auto DistanceSq = [&]( const Node& node ) -> float
+    {
+        float Result = 0.0f;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float Offset = Point[axis] < node.MinBound[axis] ? node.MinBound[axis] - Point[axis] :
+                Point[axis] > node.MaxBound[axis] ? Point[axis] - node.MaxBound[axis] : 0.0f;
+            Result += Offset * Offset;
+        }
+        return Result;
+    };
+
+    // Depth first, nearer child first, skipping nodes that can't beat the k-th best result found so far.  The
+    // results are kept sorted with insertion sort, k is expected to be small.
+    struct StackEntry { int32_t Index; float DistanceSq; };
+    StackEntry Stack[kMaxStackDepth];
+    int32_t StackSize = 0;
+    Stack[StackSize++] = { m_Root, DistanceSq(m_Nodes[m_Root]) };
+
+    uint32_t Count = 0;
+    while (StackSize > 0)
+    {
+        StackEntry Entry = Stack[--StackSize];
+        if (Count == k && Entry.DistanceSq >= distanceSq[k - 1])
+            continue;
+
+        const Node& node = m_Nodes[Entry.Index];
+        if (node.IsLeaf())
+        {
+            uint32_t Slot = Count < k ? Count++ : k - 1;
+            while (Slot > 0 && distanceSq[Slot - 1] > Entry.DistanceSq)
+            {
+                distanceSq[Slot] = distanceSq[Slot - 1];
+                userData[Slot] = userData[Slot - 1];
+                --Slot;
+            }
+            distanceSq[Slot] = Entry.DistanceSq;
+            userData[Slot] = node.UserData;
+            continue;
+        }
+
+        StackEntry Near = { node.Child[0], DistanceSq(m_Nodes[node.Child[0]]) };
+        StackEntry Far = { node.Child[1], DistanceSq(m_Nodes[node.Child[1]]) };
+        if (Far.DistanceSq < Near.DistanceSq)
+            std::swap(Near, Far);
+
+        ASSERT(StackSize + 2 <= kMaxStackDepth, "AABB tree is too deep");
+        Stack[StackSize++] = Far;
+        Stack[StackSize++] = Near;
+    }
+
+    return Count;
+}
@@ -0,0 +1,292 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+
+#pragma once
+
+#include "Frustum.h"
+#include <vector>
+#include <utility>
+
+namespace Math
+{
+    // A bounding volume hierarchy of axis aligned boxes, with the queries views need:  frustum, sphere, ray and
+    // k nearest.  Queries report objects through a callback and never allocate.  They don't modify the tree either,
+    // so any number of threads can query the same tree at once, as long as nobody modifies it meanwhile.  To keep
+    // updating a tree while worker threads query it, query a snapshot (see DynamicAABBTree::CopyTo().)
+    class AABBTree
+    {
+    public:
+        static const int32_t kNullNode = -1;
+
+        AABBTree() : m_Root(kNullNode) {}
+
+        // Calls callback(userData) for every object whose box intersects the frustum.
+        template <typename Callback>
+        void QueryFrustum( const Frustum& frustum, Callback callback ) const;
+
+        // Calls callback(userData) for every object whose box intersects the sphere.
+        template <typename Callback>
+        void QuerySphere( BoundingSphere sphere, Callback callback ) const;
+
+        // Calls callback(userData, entryDistance) for every object whose box is hit by the ray within maxDistance,
+        // roughly front to back.  The callback returns the new maximum distance:  maxDistance to keep going, the
+        // distance of a hit to only look for closer ones, or 0 to stop.
+        template <typename Callback>
+        void QueryRay( Vector3 origin, Vector3 direction, float maxDistance, Callback callback ) const;
+
+        // Finds the (up to) k objects whose boxes are closest to point, and writes them sorted by distance.  Returns
+        // how many were found.
+        uint32_t QueryNearest( Vector3 point, uint32_t k, uint32_t* userData, float* distanceSq ) const;
+
+        // The number of levels of the tree (0 when empty.)
+        int32_t GetHeight( void ) const { return m_Root == kNullNode ? 0 : m_Nodes[m_Root].Height + 1; }
+
+    protected:
+
+        // Deep enough for any tree that fits in memory, since DynamicAABBTree::Rotate() keeps the height logarithmic
+        enum { kMaxStackDepth = 1024 };
+
+        struct Node
+        {
+            float MinBound[3];
+            int32_t Parent;         // The next free node when on the free list
+            float MaxBound[3];
+            int32_t Height;         // 0 for leaves, -1 for free nodes
+            int32_t Child[2];       // kNullNode for leaves
+            uint32_t UserData;
+
+            bool IsLeaf( void ) const { return Child[0] == kNullNode; }
+        };
+
+        std::vector<Node> m_Nodes;
+        int32_t m_Root;
+
+        friend class DynamicAABBTree;
+    };
+
+    class DynamicAABBTree : public AABBTree
+    {
+    public:
+        // Boxes are stored enlarged by margin, so that objects that move a little don't need to be reinserted.
+        explicit DynamicAABBTree( float margin = 0.0f ) : m_Margin(margin), m_FreeList(kNullNode) {}
+
+        // Returns a proxy that identifies the object in the other functions.
+        int32_t Insert( Vector3 minBound, Vector3 maxBound, uint32_t userData );
+        void Remove( int32_t proxy );
+
+        // Moves an object.  It's only reinserted, and true returned, when its new box isn't contained in the stored
+        // (enlarged) box anymore.
+        bool Update( int32_t proxy, Vector3 minBound, Vector3 maxBound );
+
+        // Replaces the box of an object in place, then refits its ancestors.  Cheaper than reinsertion for small
+        // changes, but the tree gets worse for large ones.
+        void Refit( int32_t proxy, Vector3 minBound, Vector3 maxBound );
+
+        void Clear( void );
+
+        uint32_t GetUserData( int32_t proxy ) const { return m_Nodes[proxy].UserData; }
+
+        // Copies the tree to snapshot, reusing its memory.
+        void CopyTo( AABBTree& snapshot ) const;
+
+    private:
+
+        int32_t AllocateNode( void );
+        void FreeNode( int32_t index );
+        void SetBounds( Node& node, Vector3 minBound, Vector3 maxBound );
+
+        void InsertLeaf( int32_t leaf );
+        void RemoveLeaf( int32_t leaf );
+
+        // Refits the boxes from index to the root, rotating nodes where it reduces the surface area of the tree.
+        void RefitAncestors( int32_t index );
+        void Rotate( int32_t index );
+
+        float m_Margin;
+        int32_t m_FreeList;
+    };
+
+    //=======================================================================================================
+    // Inline implementations
+    //
+
+    template <typename Callback>
+    void AABBTree::QueryFrustum( const Frustum& frustum, Callback callback ) const
+    {
+        if (m_Root == kNullNode)
+            return;
+
+        float Planes[6][4];
+        for (int p = 0; p < 6; ++p)
+        {
+            Vector4 Plane = frustum.GetFrustumPlane((Frustum::PlaneID)p);
+            Planes[p][0] = Plane.GetX();
+            Planes[p][1] = Plane.GetY();
+            Planes[p][2] = Plane.GetZ();
+            Planes[p][3] = Plane.GetW();
+        }
+
+        // Each entry keeps the planes that its box still straddles.  Boxes that are inside of a plane need not be
+        // tested against it again, and once inside of all of them, the whole subtree is reported without tests.
+        struct StackEntry { int32_t Index; uint32_t PlaneMask; };
+        StackEntry Stack[kMaxStackDepth];
+        int32_t StackSize = 0;
+        Stack[StackSize++] = { m_Root, 0x3F };
+
+        while (StackSize > 0)
+        {
+            StackEntry Entry = Stack[--StackSize];
+            const Node& node = m_Nodes[Entry.Index];
+
+            bool Outside = false;
+            for (int p = 0; p < 6 && !Outside; ++p)
+            {
+                if ((Entry.PlaneMask & (1 << p)) == 0)
+                    continue;
+
+                // The distances of the corners furthest in front of and behind the plane
+                float Front = Planes[p][3], Back = Planes[p][3];
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    float N = Planes[p][axis];
+                    Front += N * (N > 0.0f ? node.MaxBound[axis] : node.MinBound[axis]);
+                    Back += N * (N > 0.0f ? node.MinBound[axis] : node.MaxBound[axis]);
+                }
+
+                if (Front < 0.0f)
+                    Outside = true;
+                else if (Back >= 0.0f)
+                    Entry.PlaneMask &= ~(1 << p);
+            }
+
+            if (Outside)
+                continue;
+
+            if (node.IsLeaf())
+            {
+                callback(node.UserData);
+            }
+            else
+            {
+                ASSERT(StackSize + 2 <= kMaxStackDepth, "AABB tree is too deep");
+                Stack[StackSize++] = { node.Child[1], Entry.PlaneMask };
+                Stack[StackSize++] = { node.Child[0], Entry.PlaneMask };
+            }
+        }
+    }
+
+    template <typename Callback>
+    void AABBTree::QuerySphere( BoundingSphere sphere, Callback callback ) const
+    {
+        if (m_Root == kNullNode)
+            return;
+
+        const float Center[3] = { sphere.GetCenter().GetX(), sphere.GetCenter().GetY(), sphere.GetCenter().GetZ() };
+        const float RadiusSq = sphere.GetRadius() * sphere.GetRadius();
+
+        int32_t Stack[kMaxStackDepth];
+        int32_t StackSize = 0;
+        Stack[StackSize++] = m_Root;
+
+        while (StackSize > 0)
+        {
+            const Node& node = m_Nodes[Stack[--StackSize]];
+
+            float DistanceSq = 0.0f;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                float Offset = Center[axis] - (Center[axis] < node.MinBound[axis] ? node.MinBound[axis] :
+                    Center[axis] > node.MaxBound[axis] ? node.MaxBound[axis] : Center[axis]);
+                DistanceSq += Offset * Offset;
+            }
+            if (DistanceSq > RadiusSq)
+                continue;
+
+            if (node.IsLeaf())
+            {
+                callback(node.UserData);
+            }
+            else
+            {
+                ASSERT(StackSize + 2 <= kMaxStackDepth, "AABB tree is too deep");
+                Stack[StackSize++] = node.Child[1];
+                Stack[StackSize++] = node.Child[0];
+            }
+        }
+    }
+
+    template <typename Callback>
+    void AABBTree::QueryRay( Vector3 origin, Vector3 direction, float maxDistance, Callback callback ) const
+    {
+        if (m_Root == kNullNode)
+            return;
+
+        const float Origin[3] = { origin.GetX(), origin.GetY(), origin.GetZ() };
+        const Vector3 InvDirection = Recip(direction);
+        const float InvDir[3] = { InvDirection.GetX(), InvDirection.GetY(), InvDirection.GetZ() };
+
+        // Slab test, returns the entry distance or a negative value when missed
+        auto Intersect = [&]( const Node& node ) -> float
+        {
+            float Enter = 0.0f, Exit = maxDistance;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                float T0 = (node.MinBound[axis] - Origin[axis]) * InvDir[axis];
+                float T1 = (node.MaxBound[axis] - Origin[axis]) * InvDir[axis];
+                if (T0 > T1)
+                    std::swap(T0, T1);
+                Enter = T0 > Enter ? T0 : Enter;
+                Exit = T1 < Exit ? T1 : Exit;
+            }
+            return Enter <= Exit ? Enter : -1.0f;
+        };
+
+        struct StackEntry { int32_t Index; float Enter; };
+        StackEntry Stack[kMaxStackDepth];
+        int32_t StackSize = 0;
+
+        float RootEnter = Intersect(m_Nodes[m_Root]);
+        if (RootEnter >= 0.0f)
+            Stack[StackSize++] = { m_Root, RootEnter };
+
+        while (StackSize > 0)
+        {
+            StackEntry Entry = Stack[--StackSize];
+
+            // The callback might have shortened the ray since this node was pushed
+            if (Entry.Enter > maxDistance)
+                continue;
+
+            const Node& node = m_Nodes[Entry.Index];
+            if (node.IsLeaf())
+            {
+                maxDistance = callback(node.UserData, Entry.Enter);
+                if (maxDistance <= 0.0f)
+                    return;
+                continue;
+            }
+
+            // Push the farther child first, so that the nearer one is visited first
+            float Enter0 = Intersect(m_Nodes[node.Child[0]]);
+            float Enter1 = Intersect(m_Nodes[node.Child[1]]);
+            StackEntry Near = { node.Child[0], Enter0 }, Far = { node.Child[1], Enter1 };
+            if (Enter1 >= 0.0f && (Enter0 < 0.0f || Enter1 < Enter0))
+                std::swap(Near, Far);
+
+            ASSERT(StackSize + 2 <= kMaxStackDepth, "AABB tree is too deep");
+            if (Far.Enter >= 0.0f)
+                Stack[StackSize++] = Far;
+            if (Near.Enter >= 0.0f)
+                Stack[StackSize++] = Near;
+        }
+    }
+
+} // namespace Math
@@ -14,6 +14,8 @@
 #include "pch.h"
 #include "Frustum.h"
 #include "Camera.h"
+#include "CpuFeatures.h"
+#include <intrin.h>
 
 using namespace Math;
 
@@ -65,8 +67,8 @@ void Frustum::ConstructOrthographicFrustum( float Left, float Right, float Top,
     m_FrustumPlanes[kFarPlane]        = BoundingPlane(  0.0f,  0.0f,  1.0f,   Back );
     m_FrustumPlanes[kLeftPlane]        = BoundingPlane(  1.0f,  0.0f,  0.0f,  -Left );
     m_FrustumPlanes[kRightPlane]    = BoundingPlane( -1.0f,  0.0f,  0.0f,  Right );
-    m_FrustumPlanes[kTopPlane]        = BoundingPlane(  0.0f, -1.0f,  0.0f, Bottom );
-    m_FrustumPlanes[kBottomPlane]    = BoundingPlane(  0.0f,  1.0f,  0.0f,   -Top );
+    m_FrustumPlanes[kTopPlane]        = BoundingPlane(  0.0f, -1.0f,  0.0f,    Top );
+    m_FrustumPlanes[kBottomPlane]    = BoundingPlane(  0.0f,  1.0f,  0.0f, -Bottom );
 }
 
 
@@ -81,13 +83,13 @@ Frustum::Frustum( const Matrix4& ProjMat )
     // Identify if the projection is perspective or orthographic by looking at the 4th row.
     if (ProjMatF[3] == 0.0f && ProjMatF[7] == 0.0f && ProjMatF[11] == 0.0f && ProjMatF[15] == 1.0f)
     {
-        // Orthographic
+        // Orthographic.  Front and Back are the distances down -Z that map to depths of 0 and 1.
         float Left     = (-1.0f - ProjMatF[12]) * RcpXX;
         float Right     = ( 1.0f - ProjMatF[12]) * RcpXX;
         float Top     = ( 1.0f - ProjMatF[13]) * RcpYY;
         float Bottom = (-1.0f - ProjMatF[13]) * RcpYY;
-        float Front     = ( 0.0f - ProjMatF[14]) * RcpZZ;
-        float Back   = ( 1.0f - ProjMatF[14]) * RcpZZ;
+        float Front     = ( ProjMatF[14] - 0.0f) * RcpZZ;
+        float Back   = ( ProjMatF[14] - 1.0f) * RcpZZ;
 
         // Check for reverse Z here.  The bounding planes need to point into the frustum.
         if (Front < Back)
@@ -114,3 +116,197 @@ Frustum::Frustum( const Matrix4& ProjMat )
         ConstructPerspectiveFrustum( RcpXX, RcpYY, NearClip, FarClip );
     }
 }
+
+//=======================================================================================================
+// Batch culling
+//
+// A plane rejects an object when even the point of the object furthest along the plane's normal is behind it.
+// For a box that point is the "p-vertex", the corner picking the max coordinate wherever the normal is positive
+// and the min coordinate elsewhere.  It depends only on the plane, so the min or max coordinate arrays are
+// selected once per plane and the inner loops are reduced to multiplies, adds and compares.
+//
+
+namespace
+{
+    Frustum::SimdLevel DetectSimdLevel( void )
+    {
+        if (CpuFeatures::HasAVX512F())
+            return Frustum::kAVX512;
+        else if (CpuFeatures::HasAVX())
+            return Frustum::kAVX;
+        else
+            return Frustum::kSSE;
+    }
+
+    Frustum::SimdLevel& BatchSimdLevel( void )
+    {
+        static Frustum::SimdLevel s_SimdLevel = DetectSimdLevel();
+        return s_SimdLevel;
+    }
+
+    struct CullingPlanes
+    {
+        // The coordinate arrays to test against each plane (the p-vertex of boxes, or the center of spheres)
+        const float* X[6];
+        const float* Y[6];
+        const float* Z[6];
+        const float* Radius;
+
+        float NX[6], NY[6], NZ[6], D[6];
+    };
+
+    // The same tests as Frustum::IntersectBoundingBox() and Frustum::IntersectSphere()
+    template <bool HasRadius>
+    uint32_t TestObject( const CullingPlanes& Planes, uint32_t i )
+    {
+        for (int p = 0; p < 6; ++p)
+        {
+            float Dist = Planes.NX[p] * Planes.X[p][i] + Planes.NY[p] * Planes.Y[p][i] + Planes.NZ[p] * Planes.Z[p][i] + Planes.D[p];
+            if (HasRadius)
+                Dist += Planes.Radius[i];
+            if (Dist < 0.0f)
+                return 0;
+        }
+        return 1;
+    }
+
+    // Each returns a bit per object for objects i to i + 3 (7, 15).  Distances that are NaN don't reject objects,
+    // just as in the scalar tests.
+    template <bool HasRadius>
+    uint32_t TestObjects4( const CullingPlanes& Planes, uint32_t i )
+    {
+        const __m128 Zero = _mm_setzero_ps();
+        const __m128 Radius = HasRadius ? _mm_loadu_ps(Planes.Radius + i) : Zero;
+        __m128 Visible = _mm_cmpeq_ps(Zero, Zero);
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 Dist = _mm_mul_ps(_mm_set1_ps(Planes.NX[p]), _mm_loadu_ps(Planes.X[p] + i));
+            Dist = _mm_add_ps(Dist, _mm_mul_ps(_mm_set1_ps(Planes.NY[p]), _mm_loadu_ps(Planes.Y[p] + i)));
+            Dist = _mm_add_ps(Dist, _mm_mul_ps(_mm_set1_ps(Planes.NZ[p]), _mm_loadu_ps(Planes.Z[p] + i)));
+            Dist = _mm_add_ps(Dist, _mm_set1_ps(Planes.D[p]));
+            if (HasRadius)
+                Dist = _mm_add_ps(Dist, Radius);
+            Visible = _mm_and_ps(Visible, _mm_cmpnlt_ps(Dist, Zero));
+        }
+        return (uint32_t)_mm_movemask_ps(Visible);
+    }
+
+    template <bool HasRadius>
+    uint32_t TestObjects8( const CullingPlanes& Planes, uint32_t i )
+    {
+        const __m256 Zero = _mm256_setzero_ps();
+        const __m256 Radius = HasRadius ? _mm256_loadu_ps(Planes.Radius + i) : Zero;
+        __m256 Visible = _mm256_cmp_ps(Zero, Zero, _CMP_EQ_OQ);
+        for (int p = 0; p < 6; ++p)
+        {
+            __m256 Dist = _mm256_mul_ps(_mm256_set1_ps(Planes.NX[p]), _mm256_loadu_ps(Planes.X[p] + i));
+            Dist = _mm256_add_ps(Dist, _mm256_mul_ps(_mm256_set1_ps(Planes.NY[p]), _mm256_loadu_ps(Planes.Y[p] + i)));
+            Dist = _mm256_add_ps(Dist, _mm256_mul_ps(_mm256_set1_ps(Planes.NZ[p]), _mm256_loadu_ps(Planes.Z[p] + i)));
+            Dist = _mm256_add_ps(Dist, _mm256_set1_ps(Planes.D[p]));
+            if (HasRadius)
+                Dist = _mm256_add_ps(Dist, Radius);
+            Visible = _mm256_and_ps(Visible, _mm256_cmp_ps(Dist, Zero, _CMP_NLT_UQ));
+        }
+        return (uint32_t)_mm256_movemask_ps(Visible);
+    }
+
+    template <bool HasRadius>
+    uint32_t TestObjects16( const CullingPlanes& Planes, uint32_t i )
+    {
+        const __m512 Zero = _mm512_setzero_ps();
+        const __m512 Radius = HasRadius ? _mm512_loadu_ps(Planes.Radius + i) : Zero;
+        __mmask16 Visible = 0xFFFF;
+        for (int p = 0; p < 6; ++p)
+        {
+            __m512 Dist = _mm512_mul_ps(_mm512_set1_ps(Planes.NX[p]), _mm512_loadu_ps(Planes.X[p] + i));
+            Dist = _mm512_add_ps(Dist, _mm512_mul_ps(_mm512_set1_ps(Planes.NY[p]), _mm512_loadu_ps(Planes.Y[p] + i)));
+            Dist = _mm512_add_ps(Dist, _mm512_mul_ps(_mm512_set1_ps(Planes.NZ[p]), _mm512_loadu_ps(Planes.Z[p] + i)));
+            Dist = _mm512_add_ps(Dist, _mm512_set1_ps(Planes.D[p]));
+            if (HasRadius)
+                Dist = _mm512_add_ps(Dist, Radius);
+            Visible = _mm512_mask_cmp_ps_mask(Visible, Dist, Zero, _CMP_NLT_UQ);
+        }
+        return (uint32_t)Visible;
+    }
+
+    template <bool HasRadius>
+    void CullObjects( const CullingPlanes& Planes, uint32_t Count, uint32_t* VisibilityMasks )
+    {
+        memset(VisibilityMasks, 0, (Count + 31) / 32 * sizeof(uint32_t));
+
+        // Group sizes divide 32, so a group never straddles two masks
+        uint32_t i = 0;
+        switch (BatchSimdLevel())
+        {
+        case Frustum::kAVX512:
+            for (; i + 16 <= Count; i += 16)
+                VisibilityMasks[i / 32] |= TestObjects16<HasRadius>(Planes, i) << (i % 32);
+            _mm256_zeroupper();
+            break;
+        case Frustum::kAVX:
+            for (; i + 8 <= Count; i += 8)
+                VisibilityMasks[i / 32] |= TestObjects8<HasRadius>(Planes, i) << (i % 32);
+            _mm256_zeroupper();
+            break;
+        default:
+            break;
+        }
+
+        for (; i + 4 <= Count; i += 4)
+            VisibilityMasks[i / 32] |= TestObjects4<HasRadius>(Planes, i) << (i % 32);
+
+        for (; i < Count; ++i)
+            VisibilityMasks[i / 32] |= TestObject<HasRadius>(Planes, i) << (i % 32);
+    }
+}
+
+Frustum::SimdLevel Frustum::GetBatchSimdLevel( void )
+{
+    return BatchSimdLevel();
+}
+
+void Frustum::SetBatchSimdLevel( SimdLevel level )
+{
+    const SimdLevel Supported = DetectSimdLevel();
+    BatchSimdLevel() = level < Supported ? level : Supported;
+}
+
+void Frustum::IntersectBoundingBoxes( const float* minX, const float* minY, const float* minZ,
+    const float* maxX, const float* maxY, const float* maxZ, uint32_t count, uint32_t* visibilityMasks ) const
+{
+    CullingPlanes Planes;
+    for (int p = 0; p < 6; ++p)
+    {
+        Vector4 Plane = m_FrustumPlanes[p];
+        Planes.NX[p] = Plane.GetX();
+        Planes.NY[p] = Plane.GetY();
+        Planes.NZ[p] = Plane.GetZ();
+        Planes.D[p] = Plane.GetW();
+        Planes.X[p] = Planes.NX[p] > 0.0f ? maxX : minX;
+        Planes.Y[p] = Planes.NY[p] > 0.0f ? maxY : minY;
+        Planes.Z[p] = Planes.NZ[p] > 0.0f ? maxZ : minZ;
+    }
+    Planes.Radius = nullptr;
+
+    CullObjects<false>(Planes, count, visibilityMasks);
+}
+
+void Frustum::IntersectSpheres( const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+    uint32_t count, uint32_t* visibilityMasks ) const
+{
+    CullingPlanes Planes;
+    for (int p = 0; p < 6; ++p)
+    {
+        Vector4 Plane = m_FrustumPlanes[p];
+        Planes.NX[p] = Plane.GetX();
+        Planes.NY[p] = Plane.GetY();
+        Planes.NZ[p] = Plane.GetZ();
+        Planes.D[p] = Plane.GetW();
+        Planes.X[p] = centerX;
+        Planes.Y[p] = centerY;
+        Planes.Z[p] = centerZ;
+    }
+    Planes.Radius = radius;
+
+    CullObjects<true>(Planes, count, visibilityMasks);
+}
@@ -47,6 +47,21 @@ namespace Math
         // simple struct in the Model project.)
         bool IntersectBoundingBox(const Vector3 minBound, const Vector3 maxBound) const;
 
+        // Batch versions of the tests above, for objects stored as a structure of arrays (one array per coordinate.)
+        // Bit (i % 32) of visibilityMasks[i / 32] is set if object i intersects the frustum, unused bits of the last
+        // mask are cleared.  Depending on the CPU, 4, 8 or 16 objects are tested at once with SSE, AVX or AVX-512.
+        void IntersectBoundingBoxes( const float* minX, const float* minY, const float* minZ,
+            const float* maxX, const float* maxY, const float* maxZ, uint32_t count, uint32_t* visibilityMasks ) const;
+        void IntersectSpheres( const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+            uint32_t count, uint32_t* visibilityMasks ) const;
+
+        // The widest instructions the batch tests use.  It starts at the widest the CPU supports and can be lowered to
+        // test or measure the narrower paths, but not while other threads are culling.  Levels the CPU doesn't
+        // support are clamped to the widest it does, so GetBatchSimdLevel() tells which one is in use.
+        enum SimdLevel { kSSE, kAVX, kAVX512 };
+        static SimdLevel GetBatchSimdLevel( void );
+        static void SetBatchSimdLevel( SimdLevel level );
+
         friend Frustum  operator* ( const OrthogonalTransform& xform, const Frustum& frustum );    // Fast
         friend Frustum  operator* ( const AffineTransform& xform, const Frustum& frustum );        // Slow
         friend Frustum  operator* ( const Matrix4& xform, const Frustum& frustum );                // Slowest (and most general)
@@ -0,0 +1,158 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+
+#include "pch.h"
+#include "LowDiscrepancy.h"
+
+namespace
+{
+    // Joe & Kuo (2008) primitive polynomials and initial direction numbers for dimensions 2 to 8.  The first dimension
+    // is the van der Corput sequence.
+    struct SobolPolynomial
+    {
+        uint32_t Degree;
+        uint32_t Coefficients;
+        uint32_t InitialNumbers[5];
+    };
+
+    const SobolPolynomial kSobolPolynomials[Math::kMaxSobolDimensions - 1] =
+    {
+        { 1, 0, { 1 } },
+        { 2, 1, { 1, 3 } },
+        { 3, 1, { 1, 3, 1 } },
+        { 3, 2, { 1, 1, 1 } },
+        { 4, 1, { 1, 1, 3, 3 } },
+        { 4, 4, { 1, 3, 5, 13 } },
+        { 5, 2, { 1, 1, 5, 5, 17 } },
+    };
+
+    struct SobolDirections
+    {
+        uint32_t Numbers[Math::kMaxSobolDimensions][32];
+
+        SobolDirections()
+        {
+            for (uint32_t Bit = 0; Bit < 32; ++Bit)
+                Numbers[0][Bit] = 1u << (31 - Bit);
+
+            for (uint32_t Dim = 1; Dim < Math::kMaxSobolDimensions; ++Dim)
+            {
+                const SobolPolynomial& Poly = kSobolPolynomials[Dim - 1];
+                uint32_t* V = Numbers[Dim];
+                const uint32_t s = Poly.Degree;
+
+                for (uint32_t Bit = 0; Bit < 32; ++Bit)
+                {
+                    if (Bit < s)
+                    {
+                        V[Bit] = Poly.InitialNumbers[Bit] << (31 - Bit);
+                        continue;
+                    }
+
+                    V[Bit] = V[Bit - s] ^ (V[Bit - s] >> s);
+                    for (uint32_t k = 1; k < s; ++k)
+                    {
+                        if ((Poly.Coefficients >> (s - 1 - k)) & 1)
+                            V[Bit] ^= V[Bit - k];
+                    }
+                }
+            }
+        }
+    };
+
+    const SobolDirections& GetSobolDirections( void )
+    {
+        static const SobolDirections s_Directions;
+        return s_Directions;
+    }
+
+    const uint32_t kHaltonPrimes[Math::kMaxHaltonDimensions] =
+        { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53 };
+
+    inline float BitsToUnitFloat( uint32_t Bits )
+    {
+        return (Bits >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+float Math::Sobol( uint32_t Index, uint32_t Dimension, uint32_t Scramble )
+{
+    ASSERT(Dimension < kMaxSobolDimensions);
+    const uint32_t* V = GetSobolDirections().Numbers[Dimension];
+
+    uint32_t Bits = Scramble;
+    for (unsigned long Bit; _BitScanForward(&Bit, Index); Index &= Index - 1)
+        Bits ^= V[Bit];
+    return BitsToUnitFloat(Bits);
+}
+
+Math::SobolSequence::SobolSequence( uint32_t NumDimensions, uint32_t Scramble )
+    : m_NumDimensions(NumDimensions), m_Scramble(Scramble)
+{
+    ASSERT(NumDimensions <= kMaxSobolDimensions);
+    Reset();
+}
+
+void Math::SobolSequence::Reset( void )
+{
+    m_Index = 0;
+    for (uint32_t Dim = 0; Dim < m_NumDimensions; ++Dim)
+        m_Bits[Dim] = m_Scramble;
+}
+
+void Math::SobolSequence::Next( float* Point )
+{
+    for (uint32_t Dim = 0; Dim < m_NumDimensions; ++Dim)
+        Point[Dim] = BitsToUnitFloat(m_Bits[Dim]);
+
+    // The next Gray code differs from this one in the bit of the lowest zero of the index
+    unsigned long Bit;
+    _BitScanForward(&Bit, ~m_Index);
+    ++m_Index;
+
+    const SobolDirections& Directions = GetSobolDirections();
+    for (uint32_t Dim = 0; Dim < m_NumDimensions; ++Dim)
+        m_Bits[Dim] ^= Directions.Numbers[Dim][Bit];
+}
+
+float Math::RadicalInverse( uint32_t Index, uint32_t Base )
+{
+    if (Base == 2)
+    {
+        // Reverse the bits
+        Index = (Index << 16) | (Index >> 16);
+        Index = ((Index & 0x00FF00FF) << 8) | ((Index & 0xFF00FF00) >> 8);
+        Index = ((Index & 0x0F0F0F0F) << 4) | ((Index & 0xF0F0F0F0) >> 4);
+        Index = ((Index & 0x33333333) << 2) | ((Index & 0xCCCCCCCC) >> 2);
+        Index = ((Index & 0x55555555) << 1) | ((Index & 0xAAAAAAAA) >> 1);
+        return BitsToUnitFloat(Index);
+    }
+
+    // Accumulate the mirrored digits as an integer, divide once at the end
+    const double InvBase = 1.0 / Base;
+    uint64_t Reversed = 0;
+    double InvBaseN = 1.0;
+    while (Index > 0)
+    {
+        uint32_t Next = Index / Base;
+        Reversed = Reversed * Base + (Index - Next * Base);
+        InvBaseN *= InvBase;
+        Index = Next;
+    }
+    float Result = (float)(Reversed * InvBaseN);
+    return Result < 1.0f ? Result : 0.99999994f;
+}
+
+float Math::Halton( uint32_t Index, uint32_t Dimension )
+{
+    ASSERT(Dimension < kMaxHaltonDimensions);
+    return RadicalInverse(Index, kHaltonPrimes[Dimension]);
+}
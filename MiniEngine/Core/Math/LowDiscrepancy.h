@@ -0,0 +1,65 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Low discrepancy sequences, for sampling patterns (jitter, kernels, light and texture samples) that
+// cover their domain more evenly than random numbers do.  All values are in [0, 1).
+//
+//    Sobol:   base 2 (t,s) sequence, with the Joe & Kuo direction numbers, up to kMaxSobolDimensions.
+//    Halton:  radical inverses in the first kMaxHaltonDimensions primes.
+//    R2:      the additive recurrence of the plastic number (Roberts 2018), the simplest 2D pattern.
+//
+
+#pragma once
+
+#include "Common.h"
+
+namespace Math
+{
+    enum { kMaxSobolDimensions = 8, kMaxHaltonDimensions = 16 };
+
+    // Component Dimension of Sobol point Index.  Scramble is XORed with the bits of the result (a random digital
+    // shift), which gives a different pattern with the same stratification.
+    float Sobol( uint32_t Index, uint32_t Dimension, uint32_t Scramble = 0 );
+
+    // Generates successive Sobol points with one XOR per dimension.  Points come in Gray code order, which differs
+    // from Sobol(0, 1, 2...) but gives the same points within each power of two block.
+    class SobolSequence
+    {
+    public:
+        explicit SobolSequence( uint32_t NumDimensions, uint32_t Scramble = 0 );
+
+        // Writes NumDimensions values
+        void Next( float* Point );
+
+        void Reset( void );
+
+    private:
+        uint32_t m_NumDimensions;
+        uint32_t m_Scramble;
+        uint32_t m_Index;
+        uint32_t m_Bits[kMaxSobolDimensions];
+    };
+
+    // The radical inverse of Index in Base:  its digits mirrored around the decimal point.
+    float RadicalInverse( uint32_t Index, uint32_t Base );
+
+    // Component Dimension of Halton point Index
+    float Halton( uint32_t Index, uint32_t Dimension );
+
+    // R2 point Index.  Unlike Sobol and Halton points, any number of consecutive points is well distributed.
+    INLINE void R2( uint32_t Index, float& X, float& Y )
+    {
+        // 1 / g and 1 / g^2, with g the plastic number, as 0.32 fixed point.  Wrapping around is the fractional part.
+        const uint32_t Alpha1 = 0xC13FA9A9u;
+        const uint32_t Alpha2 = 0x91E10DA6u;
+        X = ((0x80000000u + Index * Alpha1) >> 8) * (1.0f / 16777216.0f);
+        Y = ((0x80000000u + Index * Alpha2) >> 8) * (1.0f / 16777216.0f);
+    }
+};
@@ -17,4 +17,105 @@
 namespace Math
 {
     RandomNumberGenerator g_RNG;
+
+    void PCG32::Advance( uint64_t Delta )
+    {
+        // Composes the LCG step with itself by squaring, as in the reference implementation
+        uint64_t CurMult = kMultiplier, CurPlus = m_Increment;
+        uint64_t AccMult = 1, AccPlus = 0;
+        while (Delta > 0)
+        {
+            if (Delta & 1)
+            {
+                AccMult *= CurMult;
+                AccPlus = AccPlus * CurMult + CurPlus;
+            }
+            CurPlus = (CurMult + 1) * CurPlus;
+            CurMult *= CurMult;
+            Delta >>= 1;
+        }
+        m_State = AccMult * m_State + AccPlus;
+    }
+
+    void Xoshiro256PlusPlus::Jump( const uint64_t Polynomial[4] )
+    {
+        // The state after the jump is the sum of the states the bits of the jump polynomial select
+        uint64_t Sum[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < 4; ++i)
+        {
+            for (int b = 0; b < 64; ++b)
+            {
+                if (Polynomial[i] & (1ull << b))
+                {
+                    Sum[0] ^= m_State[0];
+                    Sum[1] ^= m_State[1];
+                    Sum[2] ^= m_State[2];
+                    Sum[3] ^= m_State[3];
+                }
+                Next();
+            }
+        }
+        m_State[0] = Sum[0];
+        m_State[1] = Sum[1];
+        m_State[2] = Sum[2];
+        m_State[3] = Sum[3];
+    }
+
+    void Xoshiro256PlusPlus::Jump( void )
+    {
+        static const uint64_t kJump[4] =
+            { 0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull, 0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull };
+        Jump(kJump);
+    }
+
+    void Xoshiro256PlusPlus::LongJump( void )
+    {
+        static const uint64_t kLongJump[4] =
+            { 0x76E15D3EFEFDCBBFull, 0xC5004E441C522FB3ull, 0x77710069854EE241ull, 0x39109BB02ACBE635ull };
+        Jump(kLongJump);
+    }
+
+    void RandomNumberGenerator::FillFloats( float* Dest, size_t Count, float MinVal, float MaxVal )
+    {
+        // Setting up the second stream costs about 256 steps, not worth it for a few numbers
+        if (Count >= 64)
+        {
+            Xoshiro256PlusPlus Second = m_Gen;
+            Second.LongJump();
+
+            __m128i s0 = _mm_set_epi64x(Second.m_State[0], m_Gen.m_State[0]);
+            __m128i s1 = _mm_set_epi64x(Second.m_State[1], m_Gen.m_State[1]);
+            __m128i s2 = _mm_set_epi64x(Second.m_State[2], m_Gen.m_State[2]);
+            __m128i s3 = _mm_set_epi64x(Second.m_State[3], m_Gen.m_State[3]);
+
+            const __m128 Scale = _mm_set1_ps((MaxVal - MinVal) * (1.0f / 16777216.0f));
+            const __m128 Bias = _mm_set1_ps(MinVal);
+
+            for (; Count >= 4; Count -= 4, Dest += 4)
+            {
+                __m128i Sum = _mm_add_epi64(s0, s3);
+                __m128i Result = _mm_add_epi64(_mm_or_si128(_mm_slli_epi64(Sum, 23), _mm_srli_epi64(Sum, 41)), s0);
+                __m128i t = _mm_slli_epi64(s1, 17);
+
+                s2 = _mm_xor_si128(s2, s0);
+                s3 = _mm_xor_si128(s3, s1);
+                s1 = _mm_xor_si128(s1, s2);
+                s0 = _mm_xor_si128(s0, s3);
+                s2 = _mm_xor_si128(s2, t);
+                s3 = _mm_or_si128(_mm_slli_epi64(s3, 45), _mm_srli_epi64(s3, 19));
+
+                // Both 32-bit halves of every output make a float from their high 24 bits
+                __m128 Unit = _mm_cvtepi32_ps(_mm_srli_epi32(Result, 8));
+                _mm_storeu_ps(Dest, _mm_add_ps(_mm_mul_ps(Unit, Scale), Bias));
+            }
+
+            m_Gen.m_State[0] = _mm_cvtsi128_si64(s0);
+            m_Gen.m_State[1] = _mm_cvtsi128_si64(s1);
+            m_Gen.m_State[2] = _mm_cvtsi128_si64(s2);
+            m_Gen.m_State[3] = _mm_cvtsi128_si64(s3);
+        }
+
+        for (; Count > 0; --Count)
+            *Dest++ = NextFloat(MinVal, MaxVal);
+    }
 }
@@ -8,59 +8,188 @@
 //
 // Developed by Minigraph
 //
-// Author:  James Stanard 
+// Author:  James Stanard
+//
+// Description:  Small, fast pseudorandom number generators.  They are deterministic:  the same seed gives the same
+// numbers on every machine, and independent streams for worker threads are made by jumping ahead rather than by
+// seeding several generators.
+//
+//    PCG32 (O'Neill 2014) has 64 bits of state, 2^63 selectable streams and can jump ahead by any distance.
+//    Xoshiro256PlusPlus (Blackman & Vigna 2018) has 256 bits of state and jumps by 2^128 or 2^192 outputs.
 //
 
 #pragma once
 
 #include "Common.h"
-#include <random>
 
 namespace Math
 {
+    // Expands a seed into well mixed 64-bit values, used to seed the other generators
+    INLINE uint64_t SplitMix64( uint64_t& State )
+    {
+        uint64_t z = (State += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Converts the high 24 bits of a random integer to a float in [0, 1)
+    INLINE float UintToUnitFloat( uint32_t Bits )
+    {
+        return (Bits >> 8) * (1.0f / 16777216.0f);
+    }
+
+    class PCG32
+    {
+    public:
+        // Generators with different streams produce unrelated sequences, even from the same seed.
+        explicit PCG32( uint64_t Seed = 0, uint64_t Stream = 0 )
+        {
+            SetSeed(Seed, Stream);
+        }
+
+        void SetSeed( uint64_t Seed, uint64_t Stream = 0 )
+        {
+            m_State = 0;
+            m_Increment = (Stream << 1) | 1;
+            Next();
+            m_State += Seed;
+            Next();
+        }
+
+        uint32_t Next( void )
+        {
+            uint64_t OldState = m_State;
+            m_State = OldState * kMultiplier + m_Increment;
+            uint32_t XorShifted = (uint32_t)(((OldState >> 18) ^ OldState) >> 27);
+            uint32_t Rotation = (uint32_t)(OldState >> 59);
+            return _rotr(XorShifted, Rotation);
+        }
+
+        // Skips Delta outputs in O(log(Delta)) time.  Advance(-n) goes back n outputs.
+        void Advance( uint64_t Delta );
+
+    private:
+        static const uint64_t kMultiplier = 6364136223846793005ull;
+
+        uint64_t m_State;
+        uint64_t m_Increment;
+    };
+
+    class Xoshiro256PlusPlus
+    {
+    public:
+        explicit Xoshiro256PlusPlus( uint64_t Seed = 0 ) { SetSeed(Seed); }
+
+        void SetSeed( uint64_t Seed )
+        {
+            for (int i = 0; i < 4; ++i)
+                m_State[i] = SplitMix64(Seed);
+        }
+
+        uint64_t Next( void )
+        {
+            const uint64_t Result = _rotl64(m_State[0] + m_State[3], 23) + m_State[0];
+            const uint64_t t = m_State[1] << 17;
+
+            m_State[2] ^= m_State[0];
+            m_State[3] ^= m_State[1];
+            m_State[1] ^= m_State[2];
+            m_State[0] ^= m_State[3];
+            m_State[2] ^= t;
+            m_State[3] = _rotl64(m_State[3], 45);
+
+            return Result;
+        }
+
+        // Skips 2^128 outputs.  Calling Jump() i times on copies of one generator gives 2^64 non-overlapping
+        // streams, one per thread.
+        void Jump( void );
+
+        // Skips 2^192 outputs.  Streams made with LongJump() never overlap those made with Jump().
+        void LongJump( void );
+
+    private:
+        friend class RandomNumberGenerator;
+
+        void Jump( const uint64_t Polynomial[4] );
+
+        uint64_t m_State[4];
+    };
+
+    // General purpose generator for CPU side content (particles, test data, random lights...), built on
+    // xoshiro256++.  It isn't thread safe; give each thread its own, made with MakeStream().
     class RandomNumberGenerator
     {
     public:
-        RandomNumberGenerator() : m_gen(m_rd())
+        explicit RandomNumberGenerator( uint64_t Seed = 0 ) : m_Gen(Seed)
         {
         }
 
+        // Returns the generator for worker StreamIndex.  Its numbers never overlap those of this generator or of
+        // other streams (for less than 2^128 numbers each.)
+        RandomNumberGenerator MakeStream( uint32_t StreamIndex ) const
+        {
+            RandomNumberGenerator Stream = *this;
+            for (uint32_t i = 0; i <= StreamIndex; ++i)
+                Stream.m_Gen.Jump();
+            return Stream;
+        }
+
+        uint32_t NextUint( void )
+        {
+            return (uint32_t)(m_Gen.Next() >> 32);
+        }
+
         // Default int range is [MIN_INT, MAX_INT].  Max value is included.
         int32_t NextInt( void )
         {
-            return std::uniform_int_distribution<int32_t>(0x80000000, 0x7FFFFFFF)(m_gen);
+            return (int32_t)NextUint();
         }
 
         int32_t NextInt( int32_t MaxVal )
         {
-            return std::uniform_int_distribution<int32_t>(0, MaxVal)(m_gen);
+            return NextInt(0, MaxVal);
         }
 
+        // Unbiased, with Lemire's multiply and reject method
         int32_t NextInt( int32_t MinVal, int32_t MaxVal )
         {
-            return std::uniform_int_distribution<int32_t>(MinVal, MaxVal)(m_gen);
+            const uint64_t Range = (uint64_t)((int64_t)MaxVal - MinVal) + 1;
+            uint64_t Product = NextUint() * Range;
+            if ((uint32_t)Product < Range)
+            {
+                const uint32_t Threshold = (uint32_t)((0x100000000ull - Range) % Range);
+                while ((uint32_t)Product < Threshold)
+                    Product = NextUint() * Range;
+            }
+            return (int32_t)((int64_t)MinVal + (int64_t)(Product >> 32));
         }
 
         // Default float range is [0.0f, 1.0f).  Max value is excluded.
         float NextFloat( float MaxVal = 1.0f )
         {
-            return std::uniform_real_distribution<float>(0.0f, MaxVal)(m_gen);
+            return UintToUnitFloat(NextUint()) * MaxVal;
         }
 
         float NextFloat( float MinVal, float MaxVal )
         {
-            return std::uniform_real_distribution<float>(MinVal, MaxVal)(m_gen);
+            return MinVal + UintToUnitFloat(NextUint()) * (MaxVal - MinVal);
         }
 
-        void SetSeed( UINT s )
+        // Fills Dest with Count floats in [MinVal, MaxVal), four at a time with SSE2.  Each 64-bit output makes two
+        // floats, and a second stream, a LongJump() away, runs in the other half of the registers.  The numbers differ
+        // from those of NextFloat(), but they are just as deterministic.
+        void FillFloats( float* Dest, size_t Count, float MinVal = 0.0f, float MaxVal = 1.0f );
+
+        void SetSeed( uint64_t Seed )
         {
-            m_gen.seed(s);
+            m_Gen.SetSeed(Seed);
         }
 
     private:
 
-        std::random_device m_rd;
-        std::minstd_rand m_gen;
+        Xoshiro256PlusPlus m_Gen;
     };
 
     extern RandomNumberGenerator g_RNG;
@@ -0,0 +1,284 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+
+#include "pch.h"
+#include "TransformHierarchy.h"
+#include "TaskScheduler.h"
+#include "CpuFeatures.h"
+#include <intrin.h>
+
+using namespace Math;
+
+namespace
+{
+    // Levels are split into chunks of this many nodes, one per worker.  Smaller levels are computed on the calling
+    // thread.
+    const uint32_t kNodesPerChunk = 4096;
+
+    // World = ParentWorld * Local, as Matrix4 multiplies them:  each column of the local matrix is transformed by
+    // the parent's.
+    void MultiplyMatrix( const float* ParentWorld, const float* Local, float* World )
+    {
+        const __m128 P0 = _mm_loadu_ps(ParentWorld);
+        const __m128 P1 = _mm_loadu_ps(ParentWorld + 4);
+        const __m128 P2 = _mm_loadu_ps(ParentWorld + 8);
+        const __m128 P3 = _mm_loadu_ps(ParentWorld + 12);
+        for (int Column = 0; Column < 4; ++Column)
+        {
+            const __m128 L = _mm_loadu_ps(Local + Column * 4);
+            __m128 W = _mm_mul_ps(P0, _mm_shuffle_ps(L, L, _MM_SHUFFLE(0, 0, 0, 0)));
+            W = _mm_add_ps(W, _mm_mul_ps(P1, _mm_shuffle_ps(L, L, _MM_SHUFFLE(1, 1, 1, 1))));
+            W = _mm_add_ps(W, _mm_mul_ps(P2, _mm_shuffle_ps(L, L, _MM_SHUFFLE(2, 2, 2, 2))));
+            W = _mm_add_ps(W, _mm_mul_ps(P3, _mm_shuffle_ps(L, L, _MM_SHUFFLE(3, 3, 3, 3))));
+            _mm_storeu_ps(World + Column * 4, W);
+        }
+    }
+
+    // The same, two columns at a time, with the parent's columns in both halves of the registers
+    void MultiplyMatrixAVX( const float* ParentWorld, const float* Local, float* World )
+    {
+        const __m256 P0 = _mm256_broadcast_ps((const __m128*)ParentWorld);
+        const __m256 P1 = _mm256_broadcast_ps((const __m128*)(ParentWorld + 4));
+        const __m256 P2 = _mm256_broadcast_ps((const __m128*)(ParentWorld + 8));
+        const __m256 P3 = _mm256_broadcast_ps((const __m128*)(ParentWorld + 12));
+        for (int Column = 0; Column < 4; Column += 2)
+        {
+            const __m256 L = _mm256_loadu_ps(Local + Column * 4);
+            __m256 W = _mm256_mul_ps(P0, _mm256_permute_ps(L, _MM_SHUFFLE(0, 0, 0, 0)));
+            W = _mm256_add_ps(W, _mm256_mul_ps(P1, _mm256_permute_ps(L, _MM_SHUFFLE(1, 1, 1, 1))));
+            W = _mm256_add_ps(W, _mm256_mul_ps(P2, _mm256_permute_ps(L, _MM_SHUFFLE(2, 2, 2, 2))));
+            W = _mm256_add_ps(W, _mm256_mul_ps(P3, _mm256_permute_ps(L, _MM_SHUFFLE(3, 3, 3, 3))));
+            _mm256_storeu_ps(World + Column * 4, W);
+        }
+    }
+
+    struct LevelArrays
+    {
+        const uint32_t* ParentIndex;
+        const XMFLOAT4X4* Local;
+        XMFLOAT4X4* World;
+        uint8_t* Dirty;
+    };
+
+    // A node is dirty when its local transform or its parent's world matrix changed
+    template <bool UseAVX>
+    void UpdateNodes( const LevelArrays& Arrays, uint32_t Begin, uint32_t End )
+    {
+        for (uint32_t i = Begin; i < End; ++i)
+        {
+            const uint32_t Parent = Arrays.ParentIndex[i];
+            Arrays.Dirty[i] |= Arrays.Dirty[Parent];
+            if (!Arrays.Dirty[i])
+                continue;
+
+            if (UseAVX)
+                MultiplyMatrixAVX(&Arrays.World[Parent]._11, &Arrays.Local[i]._11, &Arrays.World[i]._11);
+            else
+                MultiplyMatrix(&Arrays.World[Parent]._11, &Arrays.Local[i]._11, &Arrays.World[i]._11);
+        }
+
+        if (UseAVX)
+            _mm256_zeroupper();
+    }
+}
+
+uint32_t TransformHierarchy::AddNode( uint32_t parent, const AffineTransform& local )
+{
+    ASSERT(parent == kNullNode || (parent < m_NodeIndex.size() && m_NodeIndex[parent] != kNullNode), "Invalid parent node");
+
+    uint32_t Node;
+    if (m_FreeNodes.empty())
+    {
+        Node = (uint32_t)m_NodeIndex.size();
+        m_NodeIndex.push_back(kNullNode);
+        m_Parent.push_back(kNullNode);
+        m_FirstChild.push_back(kNullNode);
+        m_NextSibling.push_back(kNullNode);
+        m_PrevSibling.push_back(kNullNode);
+    }
+    else
+    {
+        Node = m_FreeNodes.back();
+        m_FreeNodes.pop_back();
+    }
+
+    // First among its siblings
+    uint32_t& FirstSibling = parent == kNullNode ? m_FirstRoot : m_FirstChild[parent];
+    m_Parent[Node] = parent;
+    m_FirstChild[Node] = kNullNode;
+    m_PrevSibling[Node] = kNullNode;
+    m_NextSibling[Node] = FirstSibling;
+    if (FirstSibling != kNullNode)
+        m_PrevSibling[FirstSibling] = Node;
+    FirstSibling = Node;
+
+    // At the end of the arrays until they are sorted
+    m_NodeIndex[Node] = (uint32_t)m_Node.size();
+    m_Node.push_back(Node);
+    m_ParentIndex.push_back(parent == kNullNode ? kNullNode : m_NodeIndex[parent]);
+    m_Local.push_back(XMFLOAT4X4());
+    m_World.push_back(XMFLOAT4X4());
+    m_Dirty.push_back(1);
+    XMStoreFloat4x4(&m_Local.back(), Matrix4(local));
+
+    ++m_NumNodes;
+    m_HasDirtyNodes = true;
+    m_OrderChanged = true;
+    return Node;
+}
+
+void TransformHierarchy::RemoveNode( uint32_t node )
+{
+    ASSERT(node < m_NodeIndex.size() && m_NodeIndex[node] != kNullNode, "Invalid node");
+
+    // Unlink it from its siblings
+    if (m_PrevSibling[node] != kNullNode)
+        m_NextSibling[m_PrevSibling[node]] = m_NextSibling[node];
+    else if (m_Parent[node] != kNullNode)
+        m_FirstChild[m_Parent[node]] = m_NextSibling[node];
+    else
+        m_FirstRoot = m_NextSibling[node];
+    if (m_NextSibling[node] != kNullNode)
+        m_PrevSibling[m_NextSibling[node]] = m_PrevSibling[node];
+
+    // Free it and its descendants
+    std::vector<uint32_t> Stack(1, node);
+    while (!Stack.empty())
+    {
+        const uint32_t Node = Stack.back();
+        Stack.pop_back();
+        for (uint32_t Child = m_FirstChild[Node]; Child != kNullNode; Child = m_NextSibling[Child])
+            Stack.push_back(Child);
+
+        m_Node[m_NodeIndex[Node]] = kNullNode;
+        m_NodeIndex[Node] = kNullNode;
+        m_FreeNodes.push_back(Node);
+        --m_NumNodes;
+    }
+
+    m_OrderChanged = true;
+}
+
+void TransformHierarchy::SetLocalTransform( uint32_t node, const AffineTransform& local )
+{
+    ASSERT(node < m_NodeIndex.size() && m_NodeIndex[node] != kNullNode, "Invalid node");
+
+    const uint32_t Index = m_NodeIndex[node];
+    XMStoreFloat4x4(&m_Local[Index], Matrix4(local));
+    m_Dirty[Index] = 1;
+    m_HasDirtyNodes = true;
+}
+
+AffineTransform TransformHierarchy::GetLocalTransform( uint32_t node ) const
+{
+    ASSERT(node < m_NodeIndex.size() && m_NodeIndex[node] != kNullNode, "Invalid node");
+
+    return AffineTransform(XMLoadFloat4x4(&m_Local[m_NodeIndex[node]]));
+}
+
+void TransformHierarchy::SortBreadthFirst( void )
+{
+    // The roots, then their children, then theirs...
+    std::vector<uint32_t> Order;
+    Order.reserve(m_NumNodes);
+    for (uint32_t Root = m_FirstRoot; Root != kNullNode; Root = m_NextSibling[Root])
+        Order.push_back(Root);
+
+    m_LevelStart.clear();
+    for (uint32_t LevelStart = 0; LevelStart < (uint32_t)Order.size(); )
+    {
+        m_LevelStart.push_back(LevelStart);
+        const uint32_t LevelEnd = (uint32_t)Order.size();
+        for (uint32_t i = LevelStart; i < LevelEnd; ++i)
+        {
+            for (uint32_t Child = m_FirstChild[Order[i]]; Child != kNullNode; Child = m_NextSibling[Child])
+                Order.push_back(Child);
+        }
+        LevelStart = LevelEnd;
+    }
+    m_LevelStart.push_back((uint32_t)Order.size());
+    ASSERT(Order.size() == m_NumNodes);
+
+    std::vector<XMFLOAT4X4> Local(m_NumNodes);
+    std::vector<XMFLOAT4X4> World(m_NumNodes);
+    std::vector<uint8_t> Dirty(m_NumNodes);
+    for (uint32_t i = 0; i < m_NumNodes; ++i)
+    {
+        const uint32_t OldIndex = m_NodeIndex[Order[i]];
+        Local[i] = m_Local[OldIndex];
+        World[i] = m_World[OldIndex];
+        Dirty[i] = m_Dirty[OldIndex];
+    }
+    m_Local.swap(Local);
+    m_World.swap(World);
+    m_Dirty.swap(Dirty);
+
+    for (uint32_t i = 0; i < m_NumNodes; ++i)
+        m_NodeIndex[Order[i]] = i;
+
+    m_ParentIndex.resize(m_NumNodes);
+    for (uint32_t i = 0; i < m_NumNodes; ++i)
+    {
+        const uint32_t Parent = m_Parent[Order[i]];
+        m_ParentIndex[i] = Parent == kNullNode ? kNullNode : m_NodeIndex[Parent];
+    }
+
+    m_Node.swap(Order);
+    m_OrderChanged = false;
+}
+
+void TransformHierarchy::Update( void )
+{
+    static const bool s_UseAVX = CpuFeatures::HasAVX();
+
+    if (m_OrderChanged)
+        SortBreadthFirst();
+
+    // Nothing to do when no transforms were set since the last update
+    if (!m_HasDirtyNodes || m_NumNodes == 0)
+        return;
+
+    // Roots are in world space already
+    for (uint32_t i = 0; i < m_LevelStart[1]; ++i)
+    {
+        if (m_Dirty[i])
+            m_World[i] = m_Local[i];
+    }
+
+    LevelArrays Arrays;
+    Arrays.ParentIndex = m_ParentIndex.data();
+    Arrays.Local = m_Local.data();
+    Arrays.World = m_World.data();
+    Arrays.Dirty = m_Dirty.data();
+
+    // Each level only reads the world matrices and dirty flags of the level before it
+    for (uint32_t Level = 1; Level < GetLevelCount(); ++Level)
+    {
+        const uint32_t LevelStart = m_LevelStart[Level];
+        const uint32_t LevelEnd = m_LevelStart[Level + 1];
+        const uint32_t NumChunks = (LevelEnd - LevelStart + kNodesPerChunk - 1) / kNodesPerChunk;
+
+        auto UpdateChunk = [&]( uint32_t Chunk )
+        {
+            const uint32_t Begin = LevelStart + Chunk * kNodesPerChunk;
+            const uint32_t End = std::min(Begin + kNodesPerChunk, LevelEnd);
+            if (s_UseAVX)
+                UpdateNodes<true>(Arrays, Begin, End);
+            else
+                UpdateNodes<false>(Arrays, Begin, End);
+        };
+
+        TaskScheduler::ParallelFor(0u, NumChunks, UpdateChunk, 1);
+    }
+
+    memset(m_Dirty.data(), 0, m_Dirty.size());
+    m_HasDirtyNodes = false;
+}
@@ -0,0 +1,88 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+
+#pragma once
+
+#include "Matrix4.h"
+#include <vector>
+
+namespace Math
+{
+    // A hierarchy of transforms, each relative to its parent's, whose world matrices are computed all at once.  Nodes
+    // are stored a field per array, in breadth first order, so that each level of the hierarchy is contiguous and
+    // follows the level of its parents.  Update() goes through the levels in order and through the nodes of a level
+    // in parallel, multiplying a column at a time with SSE or two columns at a time with AVX.  It only computes the nodes
+    // whose local transform changed, or whose parent's world matrix did.
+    //
+    // Nodes are referred to by handles, which don't change.  Adding or removing nodes reorders the arrays, which
+    // happens in the next Update().
+    class TransformHierarchy
+    {
+    public:
+        enum : uint32_t
+        {
+            kNullNode = 0xFFFFFFFF
+        };
+
+        TransformHierarchy() : m_FirstRoot(kNullNode), m_NumNodes(0), m_HasDirtyNodes(false), m_OrderChanged(false) {}
+
+        // Adds a node under parent, or a root when parent is kNullNode, and returns its handle.
+        uint32_t AddNode( uint32_t parent, const AffineTransform& local );
+
+        // Removes a node and all of its descendants.
+        void RemoveNode( uint32_t node );
+
+        void SetLocalTransform( uint32_t node, const AffineTransform& local );
+        AffineTransform GetLocalTransform( uint32_t node ) const;
+        uint32_t GetParent( uint32_t node ) const { return m_Parent[node]; }
+        uint32_t GetNodeCount( void ) const { return m_NumNodes; }
+
+        // Computes the world matrices that changed since the last update.
+        void Update( void );
+
+        // The world matrices of every node, in breadth first order, as of the last Update().  They have the layout
+        // of Matrix4, so they can be copied to the GPU as they are.
+        const XMFLOAT4X4* GetWorldMatrices( void ) const { return m_World.data(); }
+
+        // Where a node's world matrix is in GetWorldMatrices(), until nodes are added or removed
+        uint32_t GetWorldIndex( uint32_t node ) const { return m_NodeIndex[node]; }
+        Matrix4 GetWorldMatrix( uint32_t node ) const { return Matrix4(XMLoadFloat4x4(&m_World[m_NodeIndex[node]])); }
+
+        // The levels of the hierarchy, roots first.  Level i is world matrices GetLevelStart(i) to GetLevelStart(i + 1).
+        uint32_t GetLevelCount( void ) const { return m_LevelStart.empty() ? 0 : (uint32_t)m_LevelStart.size() - 1; }
+        uint32_t GetLevelStart( uint32_t level ) const { return m_LevelStart[level]; }
+
+    private:
+
+        void SortBreadthFirst( void );
+
+        // By handle
+        std::vector<uint32_t> m_NodeIndex;          // kNullNode for free handles
+        std::vector<uint32_t> m_Parent;
+        std::vector<uint32_t> m_FirstChild;
+        std::vector<uint32_t> m_NextSibling;        // Roots are siblings of each other
+        std::vector<uint32_t> m_PrevSibling;
+        std::vector<uint32_t> m_FreeNodes;
+        uint32_t m_FirstRoot;
+        uint32_t m_NumNodes;
+
+        // By index, in breadth first order once sorted.  Nodes added since are at the end, and removed nodes leave
+        // holes.
+        std::vector<uint32_t> m_Node;               // The handle of each index, kNullNode for holes
+        std::vector<uint32_t> m_ParentIndex;        // kNullNode for roots
+        std::vector<XMFLOAT4X4> m_Local;
+        std::vector<XMFLOAT4X4> m_World;
+        std::vector<uint8_t> m_Dirty;
+        std::vector<uint32_t> m_LevelStart;
+        bool m_HasDirtyNodes;
+        bool m_OrderChanged;
+    };
+}
@@ -39,24 +39,30 @@ ParticleEffect::ParticleEffect(ParticleEffectProperties& effectProperties)
     m_EffectProperties = effectProperties;
 }
 
-inline static Color RandColor( Color c0, Color c1 )
+// Maps a random number in [0, 1) to [MinVal, MaxVal)
+inline static float RandRange( float Unit, float MinVal, float MaxVal )
+{
+    return MinVal + Unit * (MaxVal - MinVal);
+}
+
+inline static Color RandColor( const float* Unit, Color c0, Color c1 )
 {
     // We might want to find min and max of each channel rather than assuming c0 <= c1
     return Color(
-        s_RNG.NextFloat( c0.R(), c1.R()),
-        s_RNG.NextFloat( c0.G(), c1.G()),
-        s_RNG.NextFloat( c0.B(), c1.B()),
-        s_RNG.NextFloat( c0.A(), c1.A())
+        RandRange( Unit[0], c0.R(), c1.R()),
+        RandRange( Unit[1], c0.G(), c1.G()),
+        RandRange( Unit[2], c0.B(), c1.B()),
+        RandRange( Unit[3], c0.A(), c1.A())
         );
 }
 
-inline static XMFLOAT3 RandSpread( const XMFLOAT3& s )
+inline static XMFLOAT3 RandSpread( const float* Unit, const XMFLOAT3& s )
 {
     // We might want to find min and max of each channel rather than assuming c0 <= c1
     return XMFLOAT3(
-        s_RNG.NextFloat(-s.x, s.x),
-        s_RNG.NextFloat(-s.y, s.y), 
-        s_RNG.NextFloat(-s.z, s.z)
+        RandRange(Unit[0], -s.x, s.x),
+        RandRange(Unit[1], -s.y, s.y),
+        RandRange(Unit[2], -s.z, s.z)
         );
 }
 
@@ -68,29 +74,36 @@ void ParticleEffect::LoadDeviceResources(ID3D12Device* device)
     
     //Fill particle spawn data buffer
     ParticleSpawnData* pSpawnData = (ParticleSpawnData*)_malloca(m_EffectProperties.EmitProperties.MaxParticles * sizeof(ParticleSpawnData));
+
+    // All of the random numbers are made in one batch, then scaled to their ranges
+    const UINT RandomsPerParticle = 20;
+    float* pRandom = (float*)_malloca(m_EffectProperties.EmitProperties.MaxParticles * RandomsPerParticle * sizeof(float));
+    s_RNG.FillFloats(pRandom, m_EffectProperties.EmitProperties.MaxParticles * RandomsPerParticle);
     
     for (UINT i = 0; i < m_EffectProperties.EmitProperties.MaxParticles; i++)
     {
         ParticleSpawnData& SpawnData = pSpawnData[i];
-        SpawnData.AgeRate = 1.0f / s_RNG.NextFloat( m_EffectProperties.LifeMinMax.x, m_EffectProperties.LifeMinMax.y );
-        float horizontalAngle = s_RNG.NextFloat(XM_2PI);
-        float horizontalVelocity = s_RNG.NextFloat( m_EffectProperties.Velocity.GetX(), m_EffectProperties.Velocity.GetY() );
+        const float* Unit = pRandom + i * RandomsPerParticle;
+        SpawnData.AgeRate = 1.0f / RandRange( Unit[0], m_EffectProperties.LifeMinMax.x, m_EffectProperties.LifeMinMax.y );
+        float horizontalAngle = Unit[1] * XM_2PI;
+        float horizontalVelocity = RandRange( Unit[2], m_EffectProperties.Velocity.GetX(), m_EffectProperties.Velocity.GetY() );
         SpawnData.Velocity.x = horizontalVelocity * cos(horizontalAngle);
-        SpawnData.Velocity.y = s_RNG.NextFloat( m_EffectProperties.Velocity.GetZ(), m_EffectProperties.Velocity.GetW() );
+        SpawnData.Velocity.y = RandRange( Unit[3], m_EffectProperties.Velocity.GetZ(), m_EffectProperties.Velocity.GetW() );
         SpawnData.Velocity.z = horizontalVelocity * sin(horizontalAngle);
 
-        SpawnData.SpreadOffset = RandSpread(m_EffectProperties.Spread ) ;
+        SpawnData.SpreadOffset = RandSpread( Unit + 4, m_EffectProperties.Spread );
 
-        SpawnData.StartSize = s_RNG.NextFloat( m_EffectProperties.Size.GetX(), m_EffectProperties.Size.GetY() );
-        SpawnData.EndSize = s_RNG.NextFloat( m_EffectProperties.Size.GetZ(), m_EffectProperties.Size.GetW() );
-        SpawnData.StartColor = RandColor( m_EffectProperties.MinStartColor, m_EffectProperties.MaxStartColor );
-        SpawnData.EndColor = RandColor( m_EffectProperties.MinEndColor, m_EffectProperties.MaxEndColor );
-        SpawnData.Mass = s_RNG.NextFloat( m_EffectProperties.MassMinMax.x, m_EffectProperties.MassMinMax.y );
-        SpawnData.RotationSpeed = s_RNG.NextFloat(); //todo
-        SpawnData.Random = s_RNG.NextFloat();
+        SpawnData.StartSize = RandRange( Unit[7], m_EffectProperties.Size.GetX(), m_EffectProperties.Size.GetY() );
+        SpawnData.EndSize = RandRange( Unit[8], m_EffectProperties.Size.GetZ(), m_EffectProperties.Size.GetW() );
+        SpawnData.StartColor = RandColor( Unit + 9, m_EffectProperties.MinStartColor, m_EffectProperties.MaxStartColor );
+        SpawnData.EndColor = RandColor( Unit + 13, m_EffectProperties.MinEndColor, m_EffectProperties.MaxEndColor );
+        SpawnData.Mass = RandRange( Unit[17], m_EffectProperties.MassMinMax.x, m_EffectProperties.MassMinMax.y );
+        SpawnData.RotationSpeed = Unit[18]; //todo
+        SpawnData.Random = Unit[19];
     }
     
     m_RandomStateBuffer.Create(L"ParticleSystem::SpawnDataBuffer", m_EffectProperties.EmitProperties.MaxParticles, sizeof(ParticleSpawnData), pSpawnData);
+    _freea(pRandom);
     _freea(pSpawnData);
 
     m_StateBuffers[0].Create(L"ParticleSystem::Buffer0", m_EffectProperties.EmitProperties.MaxParticles, sizeof(ParticleMotion));
@@ -210,6 +210,10 @@ namespace
 
             CompContext.SetPipelineState(s_ParticleDepthBoundsCS);
 
+            CompContext.AcquireTransientResource(g_MinMaxDepth8);
+            CompContext.AcquireTransientResource(g_MinMaxDepth16);
+            CompContext.AcquireTransientResource(g_MinMaxDepth32);
+
             CompContext.TransitionResource(LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
             CompContext.TransitionResource(g_MinMaxDepth8, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
             CompContext.TransitionResource(g_MinMaxDepth16, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
@@ -373,9 +373,32 @@ void PixelBuffer::CreateTextureResource( ID3D12Device* Device, const std::wstrin
 }
 
 void PixelBuffer::CreateTextureResource( ID3D12Device* Device, const std::wstring& Name,
-    const D3D12_RESOURCE_DESC& ResourceDesc, D3D12_CLEAR_VALUE ClearValue, EsramAllocator& /*Allocator*/ )
+    const D3D12_RESOURCE_DESC& ResourceDesc, D3D12_CLEAR_VALUE ClearValue, ID3D12Heap* Heap, uint64_t HeapOffset )
 {
-    CreateTextureResource(Device, Name, ResourceDesc, ClearValue);
+    Destroy();
+
+    ASSERT_SUCCEEDED( Device->CreatePlacedResource( Heap, HeapOffset, &ResourceDesc, D3D12_RESOURCE_STATE_COMMON,
+        &ClearValue, MY_IID_PPV_ARGS(&m_pResource) ));
+
+    m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+    m_GpuVirtualAddress = D3D12_GPU_VIRTUAL_ADDRESS_NULL;
+
+#ifndef RELEASE
+    m_pResource->SetName(Name.c_str());
+#else
+    (Name);
+#endif
+}
+
+void PixelBuffer::CreateTextureResource( ID3D12Device* Device, const std::wstring& Name,
+    const D3D12_RESOURCE_DESC& ResourceDesc, D3D12_CLEAR_VALUE ClearValue, EsramAllocator& Allocator,
+    std::function<void(void)> CreateViews )
+{
+    Allocator.Alloc(ResourceDesc, [=]( ID3D12Heap* Heap, uint64_t HeapOffset )
+    {
+        CreateTextureResource(Device, Name, ResourceDesc, ClearValue, Heap, HeapOffset);
+        CreateViews();
+    });
 }
 
 void PixelBuffer::ExportToFile( const std::wstring& FilePath )
@@ -14,6 +14,7 @@
 #pragma once
 
 #include "GpuResource.h"
+#include <functional>
 
 class EsramAllocator;
 
@@ -44,7 +45,11 @@ protected:
         D3D12_CLEAR_VALUE ClearValue, D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN );
 
     void CreateTextureResource( ID3D12Device* Device, const std::wstring& Name, const D3D12_RESOURCE_DESC& ResourceDesc,
-        D3D12_CLEAR_VALUE ClearValue, EsramAllocator& Allocator );
+        D3D12_CLEAR_VALUE ClearValue, ID3D12Heap* Heap, uint64_t HeapOffset );
+
+    // Reserves transient memory for the resource.  It's created, and CreateViews called, when the allocator is committed.
+    void CreateTextureResource( ID3D12Device* Device, const std::wstring& Name, const D3D12_RESOURCE_DESC& ResourceDesc,
+        D3D12_CLEAR_VALUE ClearValue, EsramAllocator& Allocator, std::function<void(void)> CreateViews );
 
     static DXGI_FORMAT GetBaseFormat( DXGI_FORMAT Format );
     static DXGI_FORMAT GetUAVFormat( DXGI_FORMAT Format );
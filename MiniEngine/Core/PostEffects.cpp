@@ -472,6 +472,15 @@ void PostEffects::Render( void )
 
     Context.SetRootSignature(PostEffectsRS);
 
+    GpuResource* TransientBuffers[] =
+    {
+        &g_LumaBuffer, &g_Histogram, &g_LumaLR,
+        &g_aBloomUAV1[0], &g_aBloomUAV1[1], &g_aBloomUAV2[0], &g_aBloomUAV2[1], &g_aBloomUAV3[0], &g_aBloomUAV3[1],
+        &g_aBloomUAV4[0], &g_aBloomUAV4[1], &g_aBloomUAV5[0], &g_aBloomUAV5[1]
+    };
+    for (GpuResource* Buffer : TransientBuffers)
+        Context.AcquireTransientResource(*Buffer);
+
     Context.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
     if (EnableHDR && !SSAO::DebugDraw && !(DepthOfField::Enable && DepthOfField::DebugMode >= 3))
@@ -0,0 +1,251 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+
+#include "pch.h"
+#include "RenderQueue.h"
+#include "CommandContext.h"
+#include "TaskScheduler.h"
+#include <mutex>
+
+namespace
+{
+    enum
+    {
+        kDrawIndexShift = 0,
+        kDepthShift = kDrawIndexShift + RenderQueue::kDrawIndexBits,
+        kMaterialShift = kDepthShift + RenderQueue::kDepthBits,
+        kPSOShift = kMaterialShift + RenderQueue::kMaterialBits,
+        kPassShift = kPSOShift + RenderQueue::kPSOBits
+    };
+    static_assert(kPassShift + RenderQueue::kPassBits == 64, "Sort key fields must fill 64 bits");
+
+    // Sorting is split into chunks of at least this many keys, one per worker.  Small queues are sorted on the
+    // calling thread.
+    const uint32_t kMinKeysPerChunk = 8192;
+    const uint32_t kMaxSortChunks = 16;
+
+    // Parallel recording only pays off when each context gets enough draws to cover its setup and submission
+    const uint32_t kMinDrawsPerContext = 256;
+
+    inline uint32_t GetField( uint64_t Key, uint32_t Shift, uint32_t Bits )
+    {
+        return (uint32_t)(Key >> Shift) & ((1u << Bits) - 1);
+    }
+}
+
+RenderQueue::Stats& RenderQueue::Stats::operator+=( const Stats& rhs )
+{
+    Draws += rhs.Draws;
+    PSOChanges += rhs.PSOChanges;
+    MaterialChanges += rhs.MaterialChanges;
+    ConstantChanges += rhs.ConstantChanges;
+    UnsortedPSOChanges += rhs.UnsortedPSOChanges;
+    UnsortedMaterialChanges += rhs.UnsortedMaterialChanges;
+    UnsortedConstantChanges += rhs.UnsortedConstantChanges;
+    return *this;
+}
+
+RenderQueue::RenderQueue( uint32_t MaterialRootIndex, uint32_t MaterialSRVCount, uint32_t ConstantsRootIndex )
+    : m_MaterialRootIndex(MaterialRootIndex)
+    , m_MaterialSRVCount(MaterialSRVCount)
+    , m_ConstantsRootIndex(ConstantsRootIndex)
+{
+    Reset();
+}
+
+void RenderQueue::Reset( void )
+{
+    m_Keys.clear();
+    m_Draws.clear();
+    m_PSOs.clear();
+    memset(&m_UnsortedStats, 0, sizeof(m_UnsortedStats));
+    m_KeyBitsAnd = ~0ull;
+    m_KeyBitsOr = 0;
+}
+
+void RenderQueue::AddDraw( uint32_t Pass, const GraphicsPSO& PSO, uint32_t MaterialIndex, const D3D12_CPU_DESCRIPTOR_HANDLE* MaterialSRVs,
+    float Depth, uint32_t IndexCount, uint32_t StartIndex, int32_t BaseVertex, uint32_t Constant0, uint32_t Constant1 )
+{
+    const uint32_t DrawIndex = (uint32_t)m_Draws.size();
+    ASSERT(DrawIndex < kMaxDraws, "Too many draws in render queue");
+    ASSERT(Pass < kMaxPasses && MaterialIndex < kMaxMaterials);
+
+    uint32_t PSOIndex = 0;
+    while (PSOIndex < m_PSOs.size() && m_PSOs[PSOIndex] != &PSO)
+        ++PSOIndex;
+    if (PSOIndex == m_PSOs.size())
+    {
+        ASSERT(PSOIndex < kMaxPSOs, "Too many PSOs in render queue");
+        m_PSOs.push_back(&PSO);
+    }
+
+    // The bits of non-negative floats sort like the floats, their top bits make logarithmic buckets
+    uint32_t DepthBits;
+    Depth = Depth > 0.0f ? Depth : 0.0f;
+    memcpy(&DepthBits, &Depth, sizeof(DepthBits));
+
+    const uint64_t Key =
+        (uint64_t)Pass << kPassShift |
+        (uint64_t)PSOIndex << kPSOShift |
+        (uint64_t)MaterialIndex << kMaterialShift |
+        (uint64_t)(DepthBits >> (32 - kDepthBits)) << kDepthShift |
+        (uint64_t)DrawIndex << kDrawIndexShift;
+
+    Draw draw = { MaterialSRVs, IndexCount, StartIndex, BaseVertex, { Constant0, Constant1 } };
+
+    if (DrawIndex == 0)
+    {
+        m_UnsortedStats.UnsortedPSOChanges = 1;
+        m_UnsortedStats.UnsortedMaterialChanges = 1;
+        m_UnsortedStats.UnsortedConstantChanges = 1;
+    }
+    else
+    {
+        const uint64_t LastKey = m_Keys.back();
+        const Draw& Last = m_Draws.back();
+        m_UnsortedStats.UnsortedPSOChanges += GetField(Key, kPSOShift, kPSOBits) != GetField(LastKey, kPSOShift, kPSOBits);
+        m_UnsortedStats.UnsortedMaterialChanges += GetField(Key, kMaterialShift, kMaterialBits) != GetField(LastKey, kMaterialShift, kMaterialBits);
+        m_UnsortedStats.UnsortedConstantChanges += draw.Constants[0] != Last.Constants[0] || draw.Constants[1] != Last.Constants[1];
+    }
+
+    m_Keys.push_back(Key);
+    m_Draws.push_back(draw);
+    m_KeyBitsAnd &= Key;
+    m_KeyBitsOr |= Key;
+}
+
+void RenderQueue::Sort( void )
+{
+    const uint32_t Count = (uint32_t)m_Keys.size();
+    if (Count < 2)
+        return;
+
+    uint32_t NumChunks = Count / kMinKeysPerChunk;
+    NumChunks = NumChunks < 1 ? 1 : NumChunks > kMaxSortChunks ? kMaxSortChunks : NumChunks;
+
+    m_SortScratch.resize(Count);
+    m_ChunkHistograms.resize(NumChunks * 256);
+
+    uint64_t* Src = m_Keys.data();
+    uint64_t* Dst = m_SortScratch.data();
+    uint32_t* Histograms = m_ChunkHistograms.data();
+
+    auto ChunkBegin = [Count, NumChunks]( uint32_t Chunk ) { return (uint32_t)((uint64_t)Count * Chunk / NumChunks); };
+
+    // LSD radix sort, 8 bits at a time.  It's stable and draws were added in draw index order, so the draw index
+    // bits need no sorting.  Digits that all keys share (often the pass and PSO) are skipped too.
+    const uint64_t VaryingBits = m_KeyBitsAnd ^ m_KeyBitsOr;
+
+    for (uint32_t Shift = kDepthShift; Shift < 64; Shift += 8)
+    {
+        if (((VaryingBits >> Shift) & 0xFF) == 0)
+            continue;
+
+        TaskScheduler::ParallelFor(0u, NumChunks, [&]( uint32_t Chunk )
+        {
+            uint32_t* Histogram = Histograms + Chunk * 256;
+            memset(Histogram, 0, 256 * sizeof(uint32_t));
+            for (uint32_t i = ChunkBegin(Chunk), End = ChunkBegin(Chunk + 1); i < End; ++i)
+                ++Histogram[(Src[i] >> Shift) & 0xFF];
+        }, 1);
+
+        // Each chunk scatters its keys of a digit after those of the same digit in preceding chunks
+        uint32_t Offset = 0;
+        for (uint32_t Digit = 0; Digit < 256; ++Digit)
+        {
+            for (uint32_t Chunk = 0; Chunk < NumChunks; ++Chunk)
+            {
+                uint32_t DigitCount = Histograms[Chunk * 256 + Digit];
+                Histograms[Chunk * 256 + Digit] = Offset;
+                Offset += DigitCount;
+            }
+        }
+
+        TaskScheduler::ParallelFor(0u, NumChunks, [&]( uint32_t Chunk )
+        {
+            uint32_t* Offsets = Histograms + Chunk * 256;
+            for (uint32_t i = ChunkBegin(Chunk), End = ChunkBegin(Chunk + 1); i < End; ++i)
+                Dst[Offsets[(Src[i] >> Shift) & 0xFF]++] = Src[i];
+        }, 1);
+
+        std::swap(Src, Dst);
+    }
+
+    if (Src != m_Keys.data())
+        m_Keys.swap(m_SortScratch);
+}
+
+RenderQueue::Stats RenderQueue::Submit( GraphicsContext& Context )
+{
+    Stats Result = m_UnsortedStats;
+    Result += SubmitRange(Context, 0, (uint32_t)m_Keys.size());
+    return Result;
+}
+
+RenderQueue::Stats RenderQueue::Submit( GraphicsContext& Context, uint32_t NumContexts,
+    const std::function<void(GraphicsContext&)>& SetupState )
+{
+    const uint32_t Count = (uint32_t)m_Keys.size();
+    NumContexts = std::min(NumContexts, Count / kMinDrawsPerContext);
+
+    Stats Result = m_UnsortedStats;
+    std::mutex ResultMutex;
+
+    Context.RecordParallel(Count, NumContexts, SetupState, [&]( GraphicsContext& RangeContext, uint32_t Begin, uint32_t End )
+    {
+        Stats RangeStats = SubmitRange(RangeContext, Begin, End);
+        std::lock_guard<std::mutex> LockGuard(ResultMutex);
+        Result += RangeStats;
+    });
+
+    return Result;
+}
+
+RenderQueue::Stats RenderQueue::SubmitRange( GraphicsContext& Context, uint32_t Begin, uint32_t End ) const
+{
+    Stats Result = {};
+    Result.Draws = End - Begin;
+
+    uint64_t LastKey = 0;
+    const Draw* Last = nullptr;
+
+    for (uint32_t i = Begin; i < End; ++i)
+    {
+        const uint64_t Key = m_Keys[i];
+        const Draw& draw = m_Draws[GetField(Key, kDrawIndexShift, kDrawIndexBits)];
+
+        const uint32_t PSOIndex = GetField(Key, kPSOShift, kPSOBits);
+        if (Last == nullptr || PSOIndex != GetField(LastKey, kPSOShift, kPSOBits))
+        {
+            Context.SetPipelineState(*m_PSOs[PSOIndex]);
+            ++Result.PSOChanges;
+        }
+
+        if (Last == nullptr || GetField(Key, kMaterialShift, kMaterialBits) != GetField(LastKey, kMaterialShift, kMaterialBits))
+        {
+            Context.SetDynamicDescriptors(m_MaterialRootIndex, 0, m_MaterialSRVCount, draw.MaterialSRVs);
+            ++Result.MaterialChanges;
+        }
+
+        if (Last == nullptr || draw.Constants[0] != Last->Constants[0] || draw.Constants[1] != Last->Constants[1])
+        {
+            Context.SetConstants(m_ConstantsRootIndex, draw.Constants[0], draw.Constants[1]);
+            ++Result.ConstantChanges;
+        }
+
+        Context.DrawIndexed(draw.IndexCount, draw.StartIndex, draw.BaseVertex);
+
+        LastKey = Key;
+        Last = &draw;
+    }
+
+    return Result;
+}
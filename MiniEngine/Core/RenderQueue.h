@@ -0,0 +1,111 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  A render queue collects the draws of a view, sorts them so that draws sharing state are adjacent,
+// then submits them without redundant state changes.  Draws are sorted by 64-bit keys holding, from the most
+// significant bits, the pass, the PSO, the material, and a depth bucket (front to back.)  The low bits hold the
+// order in which draws were added, so that keys are unique and the order deterministic.
+//
+// Queues keep their memory from one frame to the next; Reset() doesn't free anything.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+class GraphicsContext;
+class GraphicsPSO;
+
+class RenderQueue
+{
+public:
+
+    enum
+    {
+        kPassBits = 4,
+        kPSOBits = 8,
+        kMaterialBits = 16,
+        kDepthBits = 16,
+        kDrawIndexBits = 20,
+
+        kMaxPasses = 1 << kPassBits,
+        kMaxPSOs = 1 << kPSOBits,
+        kMaxMaterials = 1 << kMaterialBits,
+        kMaxDraws = 1 << kDrawIndexBits
+    };
+
+    // State changes made by Submit(), and how many the draws would have needed in the order they were added.
+    // Without the queue, every draw that doesn't repeat the state of the one before costs a change.
+    struct Stats
+    {
+        uint32_t Draws;
+        uint32_t PSOChanges;
+        uint32_t MaterialChanges;
+        uint32_t ConstantChanges;
+        uint32_t UnsortedPSOChanges;
+        uint32_t UnsortedMaterialChanges;
+        uint32_t UnsortedConstantChanges;
+
+        Stats& operator+=( const Stats& rhs );
+    };
+
+    // Materials are bound as a table of MaterialSRVCount SRVs, and draws set two root constants.
+    RenderQueue( uint32_t MaterialRootIndex, uint32_t MaterialSRVCount, uint32_t ConstantsRootIndex );
+
+    void Reset( void );
+
+    // Passes are submitted in increasing order.  Within a pass and PSO, draws are grouped by material, then sorted by
+    // Depth, the distance to the view (or anything else that should be drawn in increasing order.)
+    void AddDraw( uint32_t Pass, const GraphicsPSO& PSO, uint32_t MaterialIndex, const D3D12_CPU_DESCRIPTOR_HANDLE* MaterialSRVs,
+        float Depth, uint32_t IndexCount, uint32_t StartIndex, int32_t BaseVertex, uint32_t Constant0, uint32_t Constant1 );
+
+    // Radix sorts the keys, in parallel when there are enough of them.
+    void Sort( void );
+
+    // Issues the draws in key order and returns the state changes it made.
+    Stats Submit( GraphicsContext& Context );
+
+    // Like Submit(), but the draws are split across up to NumContexts contexts recorded in parallel (see
+    // GraphicsContext::RecordParallel().)  SetupState sets the root parameters the draws need, other than the
+    // material and constants the queue sets.  Each context sets its first draw's state again.
+    Stats Submit( GraphicsContext& Context, uint32_t NumContexts, const std::function<void(GraphicsContext&)>& SetupState );
+
+    uint32_t GetDrawCount( void ) const { return (uint32_t)m_Keys.size(); }
+
+private:
+
+    Stats SubmitRange( GraphicsContext& Context, uint32_t Begin, uint32_t End ) const;
+
+    struct Draw
+    {
+        const D3D12_CPU_DESCRIPTOR_HANDLE* MaterialSRVs;
+        uint32_t IndexCount;
+        uint32_t StartIndex;
+        int32_t BaseVertex;
+        uint32_t Constants[2];
+    };
+
+    uint32_t m_MaterialRootIndex;
+    uint32_t m_MaterialSRVCount;
+    uint32_t m_ConstantsRootIndex;
+
+    std::vector<uint64_t> m_Keys;
+    std::vector<uint64_t> m_SortScratch;
+    std::vector<uint32_t> m_ChunkHistograms;
+    std::vector<Draw> m_Draws;
+    std::vector<const GraphicsPSO*> m_PSOs;
+
+    Stats m_UnsortedStats;
+
+    // To find the digits that all keys share
+    uint64_t m_KeyBitsAnd;
+    uint64_t m_KeyBitsOr;
+};
@@ -353,6 +353,17 @@ void SSAO::Render( GraphicsContext& GfxContext, const float* ProjMat, float Near
     ComputeContext& Context = AsyncCompute ? ComputeContext::Begin(L"Async SSAO", true) : GfxContext.GetComputeContext();
     Context.SetRootSignature(s_RootSignature);
 
+    ColorBuffer* TransientBuffers[] =
+    {
+        &g_DepthDownsize1, &g_DepthDownsize2, &g_DepthDownsize3, &g_DepthDownsize4,
+        &g_DepthTiled1, &g_DepthTiled2, &g_DepthTiled3, &g_DepthTiled4,
+        &g_AOMerged1, &g_AOMerged2, &g_AOMerged3, &g_AOMerged4,
+        &g_AOSmooth1, &g_AOSmooth2, &g_AOSmooth3,
+        &g_AOHighQuality1, &g_AOHighQuality2, &g_AOHighQuality3, &g_AOHighQuality4
+    };
+    for (ColorBuffer* Buffer : TransientBuffers)
+        Context.AcquireTransientResource(*Buffer);
+
     { ScopedTimer _prof(L"Decompress and downsample", Context);
 
     // Phase 1:  Decompress, linearize, downsample, and deinterleave the depth buffer
@@ -60,6 +60,35 @@ void ShadowBuffer::BeginRendering( GraphicsContext& Context )
     Context.SetViewportAndScissor(m_Viewport, m_Scissor);
 }
 
+void ShadowBuffer::BeginRendering( GraphicsContext& Context, uint32_t RegionX, uint32_t RegionY, uint32_t RegionSize )
+{
+    ASSERT(RegionX + RegionSize <= m_Width && RegionY + RegionSize <= m_Height);
+
+    D3D12_VIEWPORT Viewport = m_Viewport;
+    Viewport.TopLeftX = (float)RegionX;
+    Viewport.TopLeftY = (float)RegionY;
+    Viewport.Width = (float)RegionSize;
+    Viewport.Height = (float)RegionSize;
+
+    D3D12_RECT Region;
+    Region.left = (LONG)RegionX;
+    Region.top = (LONG)RegionY;
+    Region.right = (LONG)(RegionX + RegionSize);
+    Region.bottom = (LONG)(RegionY + RegionSize);
+
+    // The same border as the whole buffer, so that neighboring regions don't stretch into each other
+    D3D12_RECT Scissor;
+    Scissor.left = Region.left + 1;
+    Scissor.top = Region.top + 1;
+    Scissor.right = Region.right - 2;
+    Scissor.bottom = Region.bottom - 2;
+
+    Context.TransitionResource(*this, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
+    Context.ClearDepth(*this, Region);
+    Context.SetDepthStencilTarget(GetDSV());
+    Context.SetViewportAndScissor(Viewport, Scissor);
+}
+
 void ShadowBuffer::EndRendering( GraphicsContext& Context )
 {
     Context.TransitionResource(*this, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
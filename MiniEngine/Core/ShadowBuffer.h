@@ -31,6 +31,9 @@ public:
     D3D12_CPU_DESCRIPTOR_HANDLE GetSRV() const { return GetDepthSRV(); }
 
     void BeginRendering( GraphicsContext& context );
+
+    // Renders to a square region of the buffer, such as one cascade of an atlas, clearing only that region
+    void BeginRendering( GraphicsContext& context, uint32_t RegionX, uint32_t RegionY, uint32_t RegionSize );
     void EndRendering( GraphicsContext& context );
 
 private:
@@ -0,0 +1,193 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+
+#include "pch.h"
+#include "ShadowCascades.h"
+#include <cmath>
+
+using namespace Math;
+using namespace GameCore;
+
+namespace
+{
+    // The fraction of its width that the caster box of a cascade is padded by, so that the slice can move a little
+    // before the cascade is rendered again
+    const float kCasterPadding = 1.0f / 32.0f;
+}
+
+ShadowCascades::ShadowCascades() : m_NumCascades(0), m_CascadeSize(0)
+{
+    for (uint32_t i = 0; i < kMaxCascades; ++i)
+    {
+        m_SplitDepths[i] = 0.0f;
+        m_Rendered[i] = false;
+        m_Cached[i] = false;
+    }
+}
+
+void ShadowCascades::Invalidate( void )
+{
+    for (uint32_t i = 0; i < kMaxCascades; ++i)
+        m_Rendered[i] = false;
+}
+
+void ShadowCascades::Update(
+    const Camera& ViewCamera, Vector3 LightDirection, Vector3 SceneMin, Vector3 SceneMax,
+    float ShadowDistance, float SplitLambda, uint32_t NumCascades, uint32_t CascadeSize, uint32_t BufferPrecision )
+{
+    ASSERT(NumCascades >= 1 && NumCascades <= kMaxCascades);
+
+    // The regions move when the cascades are resized
+    if (CascadeSize != m_CascadeSize)
+        Invalidate();
+
+    m_NumCascades = NumCascades;
+    m_CascadeSize = CascadeSize;
+
+    const float NearClip = ViewCamera.GetNearClip();
+    const float FarClip = std::fmin(ShadowDistance, ViewCamera.GetFarClip());
+    ASSERT(FarClip > NearClip);
+
+    // The half extents of the view frustum over depth
+    const float* ProjMatF = (const float*)&ViewCamera.GetProjMatrix();
+    const float TanX = 1.0f / ProjMatF[0];
+    const float TanY = 1.0f / ProjMatF[5];
+    const float TanSq = TanX * TanX + TanY * TanY;
+
+    const Vector3 Eye = ViewCamera.GetPosition();
+    const Vector3 Forward = ViewCamera.GetForwardVec();
+    const Vector3 Right = ViewCamera.GetRightVec();
+    const Vector3 Up = ViewCamera.GetUpVec();
+
+    // The extent of the scene along the light.  Cascades start at its far end and reach its near end.
+    LightDirection = Normalize(LightDirection);
+    float SceneNear = FLT_MAX;
+    float SceneFar = -FLT_MAX;
+    for (uint32_t Corner = 0; Corner < 8; ++Corner)
+    {
+        const Vector3 P(
+            Corner & 1 ? SceneMax.GetX() : SceneMin.GetX(),
+            Corner & 2 ? SceneMax.GetY() : SceneMin.GetY(),
+            Corner & 4 ? SceneMax.GetZ() : SceneMin.GetZ());
+        const float Distance = Dot(P, LightDirection);
+        SceneNear = std::fmin(SceneNear, Distance);
+        SceneFar = std::fmax(SceneFar, Distance);
+    }
+    const float SceneDepth = std::fmax(SceneFar - SceneNear, 1.0f);
+
+    float SliceNear = NearClip;
+    for (uint32_t i = 0; i < NumCascades; ++i)
+    {
+        // The practical split scheme
+        const float t = (float)(i + 1) / NumCascades;
+        const float LogSplit = NearClip * std::pow(FarClip / NearClip, t);
+        const float UniformSplit = NearClip + (FarClip - NearClip) * t;
+        const float SliceFar = i + 1 == NumCascades ? FarClip : SplitLambda * LogSplit + (1.0f - SplitLambda) * UniformSplit;
+        m_SplitDepths[i] = SliceFar;
+
+        // The smallest sphere around the slice is centered on the view axis, where it is as far from the corners of
+        // the near end as it is from those of the far end, unless that is past the far end.  It only depends on the
+        // depths and the field of view.
+        float CenterDepth = 0.5f * (SliceNear + SliceFar) * (1.0f + TanSq);
+        float Radius;
+        if (CenterDepth >= SliceFar)
+        {
+            CenterDepth = SliceFar;
+            Radius = SliceFar * std::sqrt(TanSq);
+        }
+        else
+        {
+            const float FarDistance = SliceFar - CenterDepth;
+            Radius = std::sqrt(FarDistance * FarDistance + SliceFar * SliceFar * TanSq);
+        }
+
+        const Vector3 Center = Eye + Forward * CenterDepth;
+        m_Bounds[i] = BoundingSphere(Center, Radius);
+
+        // The half width of the cascade, with the border
+        const float HalfWidth = Radius * CascadeSize / (CascadeSize - 2 * kBorderTexels);
+
+        const Vector3 FarCenter = Center + LightDirection * (SceneFar - (float)Dot(Center, LightDirection));
+        m_Cameras[i].UpdateMatrix(LightDirection, FarCenter, Vector3(2.0f * HalfWidth, 2.0f * HalfWidth, SceneDepth),
+            CascadeSize, CascadeSize, BufferPrecision);
+
+        // The light space bounds of the slice, where Z increases toward the light from the far end of the scene.
+        // Receivers are in the scene, so they don't reach past it.
+        const ShadowCamera& Cascade = m_Cameras[i];
+        Vector3 SliceMin(FLT_MAX, FLT_MAX, FLT_MAX), SliceMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (uint32_t Corner = 0; Corner < 8; ++Corner)
+        {
+            const float Depth = Corner & 4 ? SliceFar : SliceNear;
+            const Vector3 P = Eye + Forward * Depth +
+                Right * (Corner & 1 ? Depth * TanX : -Depth * TanX) + Up * (Corner & 2 ? Depth * TanY : -Depth * TanY);
+            const Vector3 ViewP = Vector3(Cascade.GetViewMatrix() * P);
+            SliceMin = Min(SliceMin, ViewP);
+            SliceMax = Max(SliceMax, ViewP);
+        }
+
+        XMFLOAT3 Lo, Hi;
+        XMStoreFloat3(&Lo, SliceMin);
+        XMStoreFloat3(&Hi, SliceMax);
+        Lo.z = Clamp(Lo.z, 0.0f, SceneDepth - 1.0f);
+
+        // Cached when the cascade didn't move and its casters were culled to a box the slice is still in
+        const Matrix4& ViewProj = Cascade.GetViewProjMatrix();
+        m_Cached[i] = m_Rendered[i] && memcmp(&ViewProj, &m_RenderedViewProj[i], sizeof(Matrix4)) == 0 &&
+            Lo.x >= m_CasterMin[i][0] && Hi.x <= m_CasterMax[i][0] &&
+            Lo.y >= m_CasterMin[i][1] && Hi.y <= m_CasterMax[i][1] &&
+            Lo.z >= m_CasterMin[i][2];
+        m_RenderedViewProj[i] = ViewProj;
+        m_Rendered[i] = true;
+
+        if (!m_Cached[i])
+        {
+            // The slice extruded toward the light, to the near end of the scene.  Past the sides of the cascade,
+            // casters would be clipped.
+            const float Padding = 2.0f * HalfWidth * kCasterPadding;
+            m_CasterMin[i][0] = Max(Lo.x - Padding, -HalfWidth);
+            m_CasterMin[i][1] = Max(Lo.y - Padding, -HalfWidth);
+            m_CasterMin[i][2] = Max(Lo.z - Padding, 0.0f);
+            m_CasterMax[i][0] = Min(Hi.x + Padding, HalfWidth);
+            m_CasterMax[i][1] = Min(Hi.y + Padding, HalfWidth);
+            m_CasterMax[i][2] = SceneDepth;
+
+            // As the frustum of an orthographic projection in the cascade's view space
+            const float Width = m_CasterMax[i][0] - m_CasterMin[i][0];
+            const float Height = m_CasterMax[i][1] - m_CasterMin[i][1];
+            const float Depth = m_CasterMax[i][2] - m_CasterMin[i][2];
+            const Matrix4 CasterProj(
+                Vector4(2.0f / Width, 0.0f, 0.0f, 0.0f),
+                Vector4(0.0f, 2.0f / Height, 0.0f, 0.0f),
+                Vector4(0.0f, 0.0f, 1.0f / Depth, 0.0f),
+                Vector4(-(m_CasterMin[i][0] + m_CasterMax[i][0]) / Width, -(m_CasterMin[i][1] + m_CasterMax[i][1]) / Height,
+                    -m_CasterMin[i][2] / Depth, 1.0f));
+            m_CasterFrustums[i] = OrthogonalTransform(Cascade.GetRotation(), Cascade.GetPosition()) * Frustum(CasterProj);
+        }
+
+        SliceNear = SliceFar;
+    }
+
+    // Cascades past the count aren't rendered, so they start over when they come back
+    for (uint32_t i = NumCascades; i < kMaxCascades; ++i)
+    {
+        m_Rendered[i] = false;
+        m_Cached[i] = false;
+    }
+
+    // The cascades differ in scale and translation only
+    const Matrix4 InvShadowMatrix = Invert(m_Cameras[0].GetShadowMatrix());
+    for (uint32_t i = 0; i < NumCascades; ++i)
+    {
+        const Matrix4 ToCascade = m_Cameras[i].GetShadowMatrix() * InvShadowMatrix;
+        m_Scales[i] = Vector3(ToCascade.GetX().GetX(), ToCascade.GetY().GetY(), ToCascade.GetZ().GetZ());
+        m_Offsets[i] = Vector3(ToCascade.GetW());
+    }
+}
@@ -0,0 +1,109 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Cascaded shadow maps for a directional light.  The view frustum is split in depth with the practical
+// split scheme, a blend of logarithmic and uniform splits, and each cascade is a ShadowCamera fit around the bounding
+// sphere of its slice of the frustum.  The radius of the sphere doesn't change as the camera turns, and ShadowCamera
+// snaps the center to whole texels, so cascades don't shimmer.
+//
+// Every cascade reaches from the far end of the scene bounds to their near end toward the light.  Its shadow casters
+// are culled against a tighter box:  the bounds of its slice of the view frustum in light space, extruded toward the
+// light.  The casters outside of it can only shadow what the cascade sees of other slices.
+//
+// The cascades are regions of one shadow buffer, in a 2x2 grid.  A cascade is cached, and its region can be left as
+// it is, when its matrices are the same as those it was last rendered with and its slice is still inside the (padded)
+// box its casters were culled to.  Update() assumes the cascades that aren't cached are rendered after it.
+//
+// Nothing here touches the device, so the fitting and culling run (and can be checked) without one.
+//
+
+#pragma once
+
+#include "ShadowCamera.h"
+
+namespace GameCore
+{
+    using namespace Math;
+
+    class ShadowCascades
+    {
+    public:
+        enum
+        {
+            kMaxCascades = 4,
+            kBorderTexels = 6   // Around the slice, for filtering and the border ShadowBuffer doesn't render
+        };
+
+        ShadowCascades();
+
+        void Update(
+            const Camera& ViewCamera,        // Camera the shadows are seen from
+            Vector3 LightDirection,            // Direction parallel to light, in direction of travel
+            Vector3 SceneMin,                // Bounds of the shadow casters and receivers
+            Vector3 SceneMax,
+            float ShadowDistance,            // View depth where the last cascade ends--clamped to the far plane
+            float SplitLambda,                // 0 for uniform splits, 1 for logarithmic splits
+            uint32_t NumCascades,            // 1 to kMaxCascades
+            uint32_t CascadeSize,            // Width and height of a cascade, in texels
+            uint32_t BufferPrecision        // Bit depth of shadow buffer--usually 16 or 24
+            );
+
+        // Renders every cascade again, such as when shadow casters move or the shadow buffer is recreated
+        void Invalidate( void );
+
+        uint32_t GetNumCascades( void ) const { return m_NumCascades; }
+
+        // The view depth where a cascade ends
+        float GetSplitDepth( uint32_t Cascade ) const { return m_SplitDepths[Cascade]; }
+
+        // The sphere around the cascade's slice of the view frustum, which it covers with a border of kBorderTexels.
+        // Pixels should pick the cascade of their slice, as the cascade's casters are culled for it.
+        const BoundingSphere& GetCascadeBounds( uint32_t Cascade ) const { return m_Bounds[Cascade]; }
+
+        const ShadowCamera& GetCascadeCamera( uint32_t Cascade ) const { return m_Cameras[Cascade]; }
+
+        // The world space box the casters of a cascade were culled to when it was last rendered
+        const Frustum& GetCasterFrustum( uint32_t Cascade ) const { return m_CasterFrustums[Cascade]; }
+        bool IsCascadeCached( uint32_t Cascade ) const { return m_Cached[Cascade]; }
+
+        // The top left texel of a cascade's region of the shadow buffer
+        void GetCascadeRegion( uint32_t Cascade, uint32_t& RegionX, uint32_t& RegionY ) const
+        {
+            RegionX = (Cascade % 2) * m_CascadeSize;
+            RegionY = (Cascade / 2) * m_CascadeSize;
+        }
+
+        // Transforms world space to the texture space of the first cascade.  All cascades look in the same direction,
+        // so the texture space of another is P * GetCascadeScale() + GetCascadeOffset() of P in the first's.
+        const Matrix4& GetShadowMatrix( void ) const { return m_Cameras[0].GetShadowMatrix(); }
+        Vector3 GetCascadeScale( uint32_t Cascade ) const { return m_Scales[Cascade]; }
+        Vector3 GetCascadeOffset( uint32_t Cascade ) const { return m_Offsets[Cascade]; }
+
+    private:
+
+        ShadowCamera m_Cameras[kMaxCascades];
+        BoundingSphere m_Bounds[kMaxCascades];
+        Frustum m_CasterFrustums[kMaxCascades];
+        Vector3 m_Scales[kMaxCascades];
+        Vector3 m_Offsets[kMaxCascades];
+        float m_SplitDepths[kMaxCascades];
+
+        // The matrices the regions were last rendered with, and the light space boxes of their casters
+        Matrix4 m_RenderedViewProj[kMaxCascades];
+        float m_CasterMin[kMaxCascades][3];
+        float m_CasterMax[kMaxCascades][3];
+        bool m_Rendered[kMaxCascades];
+        bool m_Cached[kMaxCascades];
+
+        uint32_t m_NumCascades;
+        uint32_t m_CascadeSize;
+    };
+
+}
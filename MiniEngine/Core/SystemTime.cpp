@@ -15,6 +15,7 @@
 #include "SystemTime.h"
 
 double SystemTime::sm_CpuTickDelta = 0.0;
+int64_t SystemTime::sm_TickFrequency = 0;
 
 // Query the performance counter frequency
 void SystemTime::Initialize( void )
@@ -22,6 +23,7 @@ void SystemTime::Initialize( void )
     LARGE_INTEGER frequency;
     ASSERT(TRUE == QueryPerformanceFrequency(&frequency), "Unable to query performance counter frequency");
     sm_CpuTickDelta = 1.0 / static_cast<double>(frequency.QuadPart);
+    sm_TickFrequency = static_cast<int64_t>(frequency.QuadPart);
 }
 
 // Query the current value of the performance counter
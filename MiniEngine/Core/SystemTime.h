@@ -25,6 +25,9 @@ public:
     // Query the current value of the performance counter
     static int64_t GetCurrentTick( void );
 
+    // The number of performance counter ticks per second
+    static int64_t GetTickFrequency( void ) { return sm_TickFrequency; }
+
     static void BusyLoopSleep( float SleepTime );
 
     static inline double TicksToSeconds( int64_t TickCount )
@@ -46,6 +49,7 @@ private:
 
     // The amount of time that elapses between ticks of the performance counter
     static double sm_CpuTickDelta;
+    static int64_t sm_TickFrequency;
 };
 
 
@@ -0,0 +1,698 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+
+#include "pch.h"
+#include "TaskScheduler.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace TaskScheduler;
+
+namespace
+{
+    // Tasks a thread can have queued.  When its deque is full, it runs the task it spawns instead.
+    const int64_t kQueueSize = 4096;
+
+    // ParallelFor() gives each thread about this many pieces of the range when it picks the grain
+    const uint32_t kPiecesPerThread = 8;
+
+    // Times an idle worker looks for tasks before it sleeps
+    const uint32_t kIdleSpins = 256;
+
+    struct RangeJob
+    {
+        RangeFunction Function;
+        const void* Context;
+        uint32_t Grain;
+    };
+
+    struct Task
+    {
+        void (*Execute)( Task& Self );
+        TaskCounter* Counter;                   // Of the group the task belongs to, decremented when it is done
+        Task* NextFree;
+
+        // TaskGroup and TaskGraph tasks
+        std::function<void( void )> Function;
+
+        // ParallelFor() tasks
+        const RangeJob* Job;
+        uint32_t Begin;
+        uint32_t End;
+    };
+
+    // A Chase-Lev deque, with the memory orders of Le, Pop, Cohen and Zappa Nardelli, "Correct and Efficient
+    // Work-Stealing for Weak Memory Models".  Its owner pushes and pops at the bottom, and any thread steals from the
+    // top.  It doesn't grow.
+    class WorkQueue
+    {
+    public:
+        WorkQueue() : m_Bottom(0), m_Top(0)
+        {
+            for (int64_t i = 0; i < kQueueSize; ++i)
+                m_Tasks[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        // Owner only.  Returns false when the deque is full.
+        bool Push( Task* NewTask )
+        {
+            const int64_t Bottom = m_Bottom.load(std::memory_order_relaxed);
+            const int64_t Top = m_Top.load(std::memory_order_acquire);
+            if (Bottom - Top >= kQueueSize)
+                return false;
+
+            m_Tasks[Bottom & (kQueueSize - 1)].store(NewTask, std::memory_order_relaxed);
+            m_Bottom.store(Bottom + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Owner only.  Takes the newest task.
+        Task* Pop( void )
+        {
+            const int64_t Bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+            m_Bottom.store(Bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t Top = m_Top.load(std::memory_order_relaxed);
+
+            if (Top > Bottom)
+            {
+                m_Bottom.store(Bottom + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            Task* PoppedTask = m_Tasks[Bottom & (kQueueSize - 1)].load(std::memory_order_relaxed);
+            if (Top == Bottom)
+            {
+                // The last task, which a thief may be taking
+                if (!m_Top.compare_exchange_strong(Top, Top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    PoppedTask = nullptr;
+                m_Bottom.store(Bottom + 1, std::memory_order_relaxed);
+            }
+            return PoppedTask;
+        }
+
+        // Any thread.  Takes the oldest task, or returns null when the deque is empty or another thread took it first.
+        Task* Steal( void )
+        {
+            int64_t Top = m_Top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const int64_t Bottom = m_Bottom.load(std::memory_order_acquire);
+            if (Top >= Bottom)
+                return nullptr;
+
+            Task* StolenTask = m_Tasks[Top & (kQueueSize - 1)].load(std::memory_order_relaxed);
+            if (!m_Top.compare_exchange_strong(Top, Top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+            return StolenTask;
+        }
+
+        bool IsEmpty( void ) const
+        {
+            return m_Top.load(std::memory_order_relaxed) >= m_Bottom.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // Apart, as the owner writes the bottom and thieves write the top
+        std::atomic<int64_t> m_Bottom;
+        char m_Padding[64];
+        std::atomic<int64_t> m_Top;
+        std::atomic<Task*> m_Tasks[kQueueSize];
+    };
+
+    // Each thread keeps the tasks it finishes to spawn new ones, so tasks are only allocated while the pool warms up
+    struct TaskPool
+    {
+        TaskPool() : FirstFree(nullptr) {}
+
+        ~TaskPool()
+        {
+            while (FirstFree != nullptr)
+            {
+                Task* Next = FirstFree->NextFree;
+                delete FirstFree;
+                FirstFree = Next;
+            }
+        }
+
+        Task* FirstFree;
+    };
+
+    thread_local TaskPool t_TaskPool;
+    thread_local uint32_t t_ThreadIndex = kForeignThread;
+    thread_local uint32_t t_StealSeed = 0;
+
+    uint32_t s_NumThreads = 0;
+    WorkQueue* s_Queues = nullptr;
+    std::vector<std::thread> s_Workers;
+
+    // Tasks spawned by threads outside of the pool
+    std::mutex s_ForeignMutex;
+    std::deque<Task*> s_ForeignTasks;
+    std::atomic<uint32_t> s_NumForeignTasks(0);
+
+    // Idle workers sleep until a task is spawned.  A wake up is posted for each sleeping worker at most.
+    std::mutex s_SleepMutex;
+    std::condition_variable s_WakeCondition;
+    std::atomic<uint32_t> s_NumSleeping(0);
+    uint32_t s_NumWakeUps = 0;
+    bool s_Quit = false;
+
+    Task* AllocateTask( void )
+    {
+        Task* NewTask = t_TaskPool.FirstFree;
+        if (NewTask == nullptr)
+            return new Task;
+
+        t_TaskPool.FirstFree = NewTask->NextFree;
+        return NewTask;
+    }
+
+    void FreeTask( Task* OldTask )
+    {
+        OldTask->Function = nullptr;
+        OldTask->NextFree = t_TaskPool.FirstFree;
+        t_TaskPool.FirstFree = OldTask;
+    }
+
+    // Keeps the exception being handled if it is the group's first
+    void CaptureException( TaskCounter& Counter )
+    {
+        if (!Counter.HasException.exchange(true, std::memory_order_relaxed))
+            Counter.Exception = std::current_exception();
+    }
+
+    // On the waiting thread, once the group is done
+    void RethrowException( TaskCounter& Counter )
+    {
+        if (!Counter.HasException.load(std::memory_order_relaxed))
+            return;
+
+        std::exception_ptr Exception = Counter.Exception;
+        Counter.Exception = nullptr;
+        Counter.HasException.store(false, std::memory_order_relaxed);
+        std::rethrow_exception(Exception);
+    }
+
+    void ExecuteTask( Task* CurrentTask )
+    {
+        // The task still counts as done when it throws, or its waiters would never return
+        TaskCounter* Counter = CurrentTask->Counter;
+        try
+        {
+            CurrentTask->Execute(*CurrentTask);
+        }
+        catch (...)
+        {
+            CaptureException(*Counter);
+        }
+
+        // The group can go away as soon as it is decremented, and the release publishes the exception
+        FreeTask(CurrentTask);
+        Counter->NumPending.fetch_sub(1, std::memory_order_release);
+    }
+
+    void ExecuteFunction( Task& Self )
+    {
+        Self.Function();
+    }
+
+    bool HasTasks( void )
+    {
+        if (s_NumForeignTasks.load(std::memory_order_relaxed) > 0)
+            return true;
+
+        for (uint32_t i = 0; i < s_NumThreads; ++i)
+        {
+            if (!s_Queues[i].IsEmpty())
+                return true;
+        }
+        return false;
+    }
+
+    void WakeWorker( void )
+    {
+        // Either the worker going to sleep sees the task, or this sees the worker
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (s_NumSleeping.load(std::memory_order_relaxed) == 0)
+            return;
+
+        {
+            std::lock_guard<std::mutex> LockGuard(s_SleepMutex);
+            if (s_NumWakeUps >= s_NumSleeping.load(std::memory_order_relaxed))
+                return;
+            ++s_NumWakeUps;
+        }
+        s_WakeCondition.notify_one();
+    }
+
+    // Runs the task now when it can't be queued
+    void SpawnTask( Task* NewTask )
+    {
+        const uint32_t ThreadIndex = t_ThreadIndex;
+        if (ThreadIndex != kForeignThread)
+        {
+            if (!s_Queues[ThreadIndex].Push(NewTask))
+            {
+                ExecuteTask(NewTask);
+                return;
+            }
+        }
+        else if (s_NumThreads > 0)
+        {
+            std::lock_guard<std::mutex> LockGuard(s_ForeignMutex);
+            s_ForeignTasks.push_back(NewTask);
+            s_NumForeignTasks.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            ExecuteTask(NewTask);
+            return;
+        }
+
+        WakeWorker();
+    }
+
+    Task* FindTask( void )
+    {
+        const uint32_t ThreadIndex = t_ThreadIndex;
+        if (ThreadIndex != kForeignThread)
+        {
+            if (Task* OwnTask = s_Queues[ThreadIndex].Pop())
+                return OwnTask;
+        }
+
+        if (s_NumForeignTasks.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> LockGuard(s_ForeignMutex);
+            if (!s_ForeignTasks.empty())
+            {
+                Task* ForeignTask = s_ForeignTasks.front();
+                s_ForeignTasks.pop_front();
+                s_NumForeignTasks.fetch_sub(1, std::memory_order_relaxed);
+                return ForeignTask;
+            }
+        }
+
+        // Start from a random thread, so that thieves spread out
+        t_StealSeed = t_StealSeed * 1664525u + 1013904223u;
+        const uint32_t FirstVictim = (uint32_t)(((uint64_t)(t_StealSeed >> 8) * s_NumThreads) >> 24);
+        for (uint32_t i = 0; i < s_NumThreads; ++i)
+        {
+            uint32_t Victim = FirstVictim + i;
+            if (Victim >= s_NumThreads)
+                Victim -= s_NumThreads;
+            if (Victim == ThreadIndex)
+                continue;
+
+            if (Task* StolenTask = s_Queues[Victim].Steal())
+                return StolenTask;
+        }
+        return nullptr;
+    }
+
+    void WaitFor( const TaskCounter& Counter )
+    {
+        uint32_t IdleCount = 0;
+        while (Counter.NumPending.load(std::memory_order_acquire) != 0)
+        {
+            if (Task* NextTask = FindTask())
+            {
+                ExecuteTask(NextTask);
+                IdleCount = 0;
+            }
+            else if (++IdleCount < kIdleSpins)
+            {
+                YieldProcessor();
+            }
+            else
+            {
+                // Stolen tasks are still running
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void SleepUntilWoken( void )
+    {
+        std::unique_lock<std::mutex> Lock(s_SleepMutex);
+        s_NumSleeping.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!s_Quit && !HasTasks())
+        {
+            s_WakeCondition.wait(Lock, []{ return s_NumWakeUps > 0 || s_Quit; });
+            if (s_NumWakeUps > 0)
+                --s_NumWakeUps;
+        }
+        s_NumSleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // The logical processors of the calling thread's processor group, the first of each core before the second of
+    // any.  Workers are pinned in this order, after the one the main thread is given.
+    std::vector<GROUP_AFFINITY> GetProcessorOrder( void )
+    {
+        std::vector<GROUP_AFFINITY> Order;
+
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+        GROUP_AFFINITY ThreadAffinity;
+        if (!GetThreadGroupAffinity(GetCurrentThread(), &ThreadAffinity))
+            return Order;
+
+        DWORD Length = 0;
+        GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &Length);
+        std::vector<uint8_t> Buffer(Length);
+        if (Length == 0 || !GetLogicalProcessorInformationEx(RelationProcessorCore,
+            (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)Buffer.data(), &Length))
+        {
+            return Order;
+        }
+
+        std::vector<KAFFINITY> CoreMasks;
+        for (DWORD Offset = 0; Offset < Length; )
+        {
+            const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& Info =
+                *(const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)(Buffer.data() + Offset);
+            const GROUP_AFFINITY& CoreAffinity = Info.Processor.GroupMask[0];
+            if (CoreAffinity.Group == ThreadAffinity.Group && (CoreAffinity.Mask & ThreadAffinity.Mask) != 0)
+                CoreMasks.push_back(CoreAffinity.Mask & ThreadAffinity.Mask);
+            Offset += Info.Size;
+        }
+
+        for (bool Found = true; Found; )
+        {
+            Found = false;
+            for (KAFFINITY& Mask : CoreMasks)
+            {
+                if (Mask == 0)
+                    continue;
+
+                GROUP_AFFINITY Processor = {};
+                Processor.Group = ThreadAffinity.Group;
+                Processor.Mask = Mask & (~Mask + 1);
+                Order.push_back(Processor);
+                Mask &= Mask - 1;
+                Found = true;
+            }
+        }
+#endif
+        return Order;
+    }
+
+    void WorkerMain( uint32_t ThreadIndex, GROUP_AFFINITY Processor )
+    {
+        t_ThreadIndex = ThreadIndex;
+        t_StealSeed = ThreadIndex;
+
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+        if (Processor.Mask != 0)
+            SetThreadGroupAffinity(GetCurrentThread(), &Processor, nullptr);
+#endif
+
+        uint32_t IdleCount = 0;
+        for (;;)
+        {
+            if (Task* NextTask = FindTask())
+            {
+                ExecuteTask(NextTask);
+                IdleCount = 0;
+            }
+            else if (++IdleCount < kIdleSpins)
+            {
+                YieldProcessor();
+            }
+            else
+            {
+                SleepUntilWoken();
+                IdleCount = 0;
+
+                std::lock_guard<std::mutex> LockGuard(s_SleepMutex);
+                if (s_Quit)
+                    break;
+            }
+        }
+    }
+
+    void ExecuteRange( Task& Self )
+    {
+        const RangeJob& Job = *Self.Job;
+        const uint32_t Begin = Self.Begin;
+        uint32_t End = Self.End;
+
+        // Leave the upper half for thieves until the rest is small enough
+        while (End - Begin > Job.Grain)
+        {
+            const uint32_t Middle = Begin + (End - Begin) / 2;
+
+            Task* UpperHalf = AllocateTask();
+            UpperHalf->Execute = ExecuteRange;
+            UpperHalf->Counter = Self.Counter;
+            UpperHalf->Job = &Job;
+            UpperHalf->Begin = Middle;
+            UpperHalf->End = End;
+            Self.Counter->NumPending.fetch_add(1, std::memory_order_relaxed);
+            SpawnTask(UpperHalf);
+
+            End = Middle;
+        }
+
+        Job.Function(Job.Context, Begin, End);
+    }
+}
+
+void TaskScheduler::Initialize( uint32_t NumWorkers, bool PinWorkers )
+{
+    ASSERT(s_NumThreads == 0, "The task scheduler has already been initialized");
+
+    const std::vector<GROUP_AFFINITY> Processors = GetProcessorOrder();
+    if (NumWorkers == 0)
+    {
+        const uint32_t NumProcessors = Processors.empty() ? std::thread::hardware_concurrency() : (uint32_t)Processors.size();
+        NumWorkers = NumProcessors > 1 ? NumProcessors - 1 : 0;
+    }
+
+    s_NumThreads = NumWorkers + 1;
+    s_Queues = new WorkQueue[s_NumThreads];
+    s_Quit = false;
+    s_NumWakeUps = 0;
+
+    t_ThreadIndex = 0;
+    t_StealSeed = 0;
+
+    for (uint32_t i = 1; i <= NumWorkers; ++i)
+    {
+        GROUP_AFFINITY Processor = {};
+        if (PinWorkers && i < Processors.size())
+            Processor = Processors[i];
+        s_Workers.push_back(std::thread(WorkerMain, i, Processor));
+    }
+}
+
+void TaskScheduler::Shutdown( void )
+{
+    if (s_NumThreads == 0)
+        return;
+
+    ASSERT(!HasTasks(), "Tasks are left at shutdown");
+
+    {
+        std::lock_guard<std::mutex> LockGuard(s_SleepMutex);
+        s_Quit = true;
+    }
+    s_WakeCondition.notify_all();
+
+    for (std::thread& Worker : s_Workers)
+        Worker.join();
+    s_Workers.clear();
+
+    delete[] s_Queues;
+    s_Queues = nullptr;
+    s_NumThreads = 0;
+    t_ThreadIndex = kForeignThread;
+}
+
+uint32_t TaskScheduler::GetThreadCount( void )
+{
+    return s_NumThreads > 0 ? s_NumThreads : 1;
+}
+
+uint32_t TaskScheduler::GetThreadIndex( void )
+{
+    return t_ThreadIndex;
+}
+
+TaskGroup::~TaskGroup()
+{
+    WaitFor(m_Counter);
+}
+
+void TaskGroup::Run( std::function<void( void )> Function )
+{
+    Task* NewTask = AllocateTask();
+    NewTask->Execute = ExecuteFunction;
+    NewTask->Counter = &m_Counter;
+    NewTask->Function = std::move(Function);
+    m_Counter.NumPending.fetch_add(1, std::memory_order_relaxed);
+    SpawnTask(NewTask);
+}
+
+void TaskGroup::Wait( void )
+{
+    WaitFor(m_Counter);
+    RethrowException(m_Counter);
+}
+
+uint32_t TaskGraph::AddTask( std::function<void( void )> Function )
+{
+    m_Functions.push_back(std::move(Function));
+    m_Successors.emplace_back();
+    m_NumPredecessors.push_back(0);
+    m_Validated = false;
+    return (uint32_t)m_Functions.size() - 1;
+}
+
+void TaskGraph::AddDependency( uint32_t Before, uint32_t After )
+{
+    ASSERT(Before < GetTaskCount() && After < GetTaskCount() && Before != After);
+    m_Successors[Before].push_back(After);
+    ++m_NumPredecessors[After];
+    m_Validated = false;
+}
+
+void TaskGraph::Clear( void )
+{
+    m_Functions.clear();
+    m_Successors.clear();
+    m_NumPredecessors.clear();
+    m_Roots.clear();
+    m_NumWaiting.reset();
+    m_Validated = false;
+}
+
+void TaskGraph::Run( void )
+{
+    const uint32_t NumTasks = GetTaskCount();
+    if (NumTasks == 0)
+        return;
+
+    if (!m_Validated)
+    {
+        m_Roots.clear();
+        for (uint32_t i = 0; i < NumTasks; ++i)
+        {
+            if (m_NumPredecessors[i] == 0)
+                m_Roots.push_back(i);
+        }
+
+        // Every task is reached from the roots unless there is a cycle
+        std::vector<uint32_t> NumWaiting(m_NumPredecessors);
+        std::vector<uint32_t> Ready(m_Roots);
+        uint32_t NumReached = 0;
+        while (!Ready.empty())
+        {
+            const uint32_t Index = Ready.back();
+            Ready.pop_back();
+            ++NumReached;
+            for (uint32_t Successor : m_Successors[Index])
+            {
+                if (--NumWaiting[Successor] == 0)
+                    Ready.push_back(Successor);
+            }
+        }
+        ASSERT(NumReached == NumTasks, "Task graph has a cycle");
+
+        m_NumWaiting.reset(new std::atomic<uint32_t>[NumTasks]);
+        m_Validated = true;
+    }
+
+    for (uint32_t i = 0; i < NumTasks; ++i)
+        m_NumWaiting[i].store(m_NumPredecessors[i], std::memory_order_relaxed);
+    m_Counter.NumPending.store(NumTasks, std::memory_order_relaxed);
+
+    // Tasks are counted when they are added to the graph, not when they are spawned
+    for (uint32_t Root : m_Roots)
+    {
+        Task* NewTask = AllocateTask();
+        NewTask->Execute = ExecuteFunction;
+        NewTask->Counter = &m_Counter;
+        NewTask->Function = [this, Root]{ RunTask(Root); };
+        SpawnTask(NewTask);
+    }
+
+    WaitFor(m_Counter);
+    RethrowException(m_Counter);
+}
+
+void TaskGraph::RunTask( uint32_t Index )
+{
+    // Every task has to be spawned for the graph to finish, so after an exception the rest are spawned but skipped
+    try
+    {
+        if (!m_Counter.HasException.load(std::memory_order_relaxed))
+            m_Functions[Index]();
+    }
+    catch (...)
+    {
+        CaptureException(m_Counter);
+    }
+
+    for (uint32_t Successor : m_Successors[Index])
+    {
+        if (m_NumWaiting[Successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            Task* NewTask = AllocateTask();
+            NewTask->Execute = ExecuteFunction;
+            NewTask->Counter = &m_Counter;
+            NewTask->Function = [this, Successor]{ RunTask(Successor); };
+            SpawnTask(NewTask);
+        }
+    }
+}
+
+uint32_t TaskScheduler::GetDefaultGrain( uint32_t Count )
+{
+    const uint32_t NumPieces = GetThreadCount() * kPiecesPerThread;
+    return Count > NumPieces ? Count / NumPieces + (Count % NumPieces != 0 ? 1 : 0) : 1;
+}
+
+void TaskScheduler::ParallelForRange( uint32_t Begin, uint32_t End, uint32_t Grain, RangeFunction Function, const void* Context )
+{
+    if (End <= Begin)
+        return;
+
+    if (Grain == 0)
+        Grain = GetDefaultGrain(End - Begin);
+
+    if (End - Begin <= Grain || s_NumThreads <= 1)
+    {
+        Function(Context, Begin, End);
+        return;
+    }
+
+    RangeJob Job;
+    Job.Function = Function;
+    Job.Context = Context;
+    Job.Grain = Grain;
+
+    // The calling thread starts on the whole range
+    TaskCounter Counter;
+    Counter.NumPending.store(1, std::memory_order_relaxed);
+    Task* FirstTask = AllocateTask();
+    FirstTask->Execute = ExecuteRange;
+    FirstTask->Counter = &Counter;
+    FirstTask->Job = &Job;
+    FirstTask->Begin = Begin;
+    FirstTask->End = End;
+    ExecuteTask(FirstTask);
+
+    WaitFor(Counter);
+    RethrowException(Counter);
+}
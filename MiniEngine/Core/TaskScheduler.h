@@ -0,0 +1,175 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  A work stealing task scheduler, shared by the engine and the game.  Initialize() starts a pool of
+// worker threads, which the thread that called it (the main thread) belongs to as well.  Each thread of the pool has
+// a Chase-Lev deque of tasks:  it pushes and pops its own tasks at the bottom, and threads that run out of tasks steal
+// them from the top of the others'.  Tasks spawned by threads outside of the pool go to a shared queue.
+//
+// There are no fibers.  A thread that waits for tasks runs tasks until they are done, its own first, so waits can
+// nest inside of tasks.  Tasks shouldn't block on anything but other tasks.
+//
+// When tasks throw, the first exception is kept and rethrown by the wait once every task is done.
+//
+// ParallelFor() splits its range in half as it goes, leaving the upper half to be stolen, until the pieces are as
+// small as the grain.  Idle threads steal the biggest pieces, and a range that no one steals costs little more than
+// a loop.
+//
+// Until Initialize() and after Shutdown(), everything runs on the calling thread.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace TaskScheduler
+{
+    enum : uint32_t
+    {
+        kForeignThread = 0xFFFFFFFF
+    };
+
+    // Starts NumWorkers threads, or one for each logical processor but one when it is 0.  Pinned workers run on one
+    // logical processor each, spread over the physical cores before they share them.
+    void Initialize( uint32_t NumWorkers = 0, bool PinWorkers = true );
+
+    // Waits for the workers to finish what they are running, and stops them.  No tasks should be left.  It has to be
+    // called before the process exits, as the workers can't be stopped once static objects are being destroyed.
+    void Shutdown( void );
+
+    // The number of threads in the pool, including the main thread
+    uint32_t GetThreadCount( void );
+
+    // 0 for the main thread, 1 and up for workers, and kForeignThread for threads outside of the pool.  Tasks can use
+    // it to index per thread data.
+    uint32_t GetThreadIndex( void );
+
+    // The tasks of a group that haven't finished, and the first exception they threw.  Only the scheduler uses it.
+    struct TaskCounter
+    {
+        TaskCounter() : NumPending(0), HasException(false) {}
+
+        std::atomic<uint32_t> NumPending;
+        std::atomic<bool> HasException;
+        std::exception_ptr Exception;       // Written by the first task to throw, read once NumPending is 0
+    };
+
+    // Tasks that can be waited for together
+    class TaskGroup
+    {
+    public:
+        TaskGroup() {}
+
+        // Waits for the tasks, but drops their exceptions.  Call Wait() to get them.
+        ~TaskGroup();
+
+        // Runs Function on any thread of the pool.  Tasks of the group can run more tasks in it.
+        void Run( std::function<void( void )> Function );
+
+        // Runs tasks until those of the group are done, then rethrows the first exception they threw
+        void Wait( void );
+
+    private:
+        TaskGroup( const TaskGroup& ) = delete;
+        TaskGroup& operator=( const TaskGroup& ) = delete;
+
+        TaskCounter m_Counter;
+    };
+
+    // Tasks that start when the tasks they depend on are done.  A graph is built once and can be run any number of
+    // times.
+    class TaskGraph
+    {
+    public:
+        TaskGraph() : m_Validated(false) {}
+
+        // Returns the index of the task
+        uint32_t AddTask( std::function<void( void )> Function );
+
+        // After won't start until Before is done.  The dependencies must not form a cycle.
+        void AddDependency( uint32_t Before, uint32_t After );
+
+        // Runs every task and waits for them.  Once a task throws, the tasks that haven't started are skipped, and
+        // the exception is rethrown.
+        void Run( void );
+
+        void Clear( void );
+        uint32_t GetTaskCount( void ) const { return (uint32_t)m_Functions.size(); }
+
+    private:
+        void RunTask( uint32_t Index );
+
+        std::vector<std::function<void( void )>> m_Functions;
+        std::vector<std::vector<uint32_t>> m_Successors;
+        std::vector<uint32_t> m_NumPredecessors;
+        std::vector<uint32_t> m_Roots;
+        std::unique_ptr<std::atomic<uint32_t>[]> m_NumWaiting;
+        TaskCounter m_Counter;
+        bool m_Validated;
+    };
+
+    // Calls Function(Context, RangeBegin, RangeEnd) over subranges of [Begin, End) of at most Grain indices, in
+    // parallel, and waits for them.  A call that throws ends its subrange, but the other subranges still run, and
+    // the first exception is rethrown.  The templates below are easier to use.
+    typedef void (*RangeFunction)( const void* Context, uint32_t RangeBegin, uint32_t RangeEnd );
+    void ParallelForRange( uint32_t Begin, uint32_t End, uint32_t Grain, RangeFunction Function, const void* Context );
+
+    // The grain ParallelFor() picks when it is given 0:  enough pieces for each thread to get several
+    uint32_t GetDefaultGrain( uint32_t Count );
+
+    // Calls Func(i) for each i in [Begin, End), in parallel, and waits for them.  Grain is the most indices a task
+    // runs, or 0 to pick it from the range and the number of threads.
+    template <typename Function>
+    void ParallelFor( uint32_t Begin, uint32_t End, const Function& Func, uint32_t Grain = 0 )
+    {
+        ParallelForRange(Begin, End, Grain, []( const void* Context, uint32_t RangeBegin, uint32_t RangeEnd )
+        {
+            const Function& Func = *(const Function*)Context;
+            for (uint32_t i = RangeBegin; i < RangeEnd; ++i)
+                Func(i);
+        }, &Func);
+    }
+
+    // Reduces [Begin, End) in parallel.  Func(RangeBegin, RangeEnd) returns the value of a subrange, and Combine(A, B)
+    // joins the values of adjacent subranges, A's before B's.  The subranges only depend on the range, the grain and
+    // the number of threads, so the result doesn't change from run to run, even when Combine isn't associative (as
+    // with floating point).  T must be default constructible.
+    template <typename T, typename Function, typename CombineFunction>
+    T ParallelReduce( uint32_t Begin, uint32_t End, const T& Identity, const Function& Func,
+        const CombineFunction& Combine, uint32_t Grain = 0 )
+    {
+        if (End <= Begin)
+            return Identity;
+
+        const uint32_t Count = End - Begin;
+        if (Grain == 0)
+            Grain = GetDefaultGrain(Count);
+        Grain = std::min(Grain, Count);
+        const uint32_t NumChunks = Count / Grain + (Count % Grain != 0 ? 1 : 0);
+
+        // Not a std::vector, which packs bools into bits that the workers would write at the same time
+        std::unique_ptr<T[]> Values(new T[NumChunks]);
+        ParallelFor(0u, NumChunks, [&]( uint32_t Chunk )
+        {
+            const uint32_t ChunkBegin = Begin + Chunk * Grain;
+            Values[Chunk] = Func(ChunkBegin, ChunkBegin + std::min(Grain, End - ChunkBegin));
+        }, 1);
+
+        T Result = Values[0];
+        for (uint32_t Chunk = 1; Chunk < NumChunks; ++Chunk)
+            Result = Combine(Result, Values[Chunk]);
+        return Result;
+    }
+}
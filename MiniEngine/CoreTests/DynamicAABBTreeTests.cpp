@@ -0,0 +1,422 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Checks the frustum, sphere, ray and k nearest queries of DynamicAABBTree against a brute force pass
+// over the objects, on the tree and on a snapshot, after random inserts, removes, updates and refits.  Checks that
+// sorted, identical and nested boxes keep the tree within a few times the height of a balanced one, since the queries
+// walk it with fixed size stacks.
+//
+
+#include "stdafx.h"
+#include "Camera.h"
+#include "Math/DynamicAABBTree.h"
+#include "Math/Random.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Math;
+using namespace GameCore;
+
+namespace
+{
+    const float kMargin = 0.25f;
+
+    // Objects within this distance of the edge of a query may go either way, because the tree rounds differently
+    const float kTolerance = 1e-3f;
+
+    // Three times the height of a balanced tree
+    int32_t HeightBound( uint32_t NumObjects )
+    {
+        int32_t BalancedHeight = 1;
+        while ((1u << (BalancedHeight - 1)) < NumObjects)
+            ++BalancedHeight;
+        return 3 * BalancedHeight;
+    }
+
+    struct Object
+    {
+        int32_t Proxy;                      // kNullNode when not in the tree
+        float Min[3], Max[3];               // Where the object is
+        float StoredMin[3], StoredMax[3];   // The box the tree should have for it, enlarged by the margin
+
+        Object() : Proxy(AABBTree::kNullNode) {}
+
+        Vector3 MinBound( void ) const { return Vector3(Min[0], Min[1], Min[2]); }
+        Vector3 MaxBound( void ) const { return Vector3(Max[0], Max[1], Max[2]); }
+
+        // What Insert(), Refit() and a reinserting Update() do
+        void Store( void )
+        {
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                StoredMin[Axis] = Min[Axis] - kMargin;
+                StoredMax[Axis] = Max[Axis] + kMargin;
+            }
+        }
+
+        bool StoredBoxContains( void ) const
+        {
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                if (StoredMin[Axis] > Min[Axis] || StoredMax[Axis] < Max[Axis])
+                    return false;
+            }
+            return true;
+        }
+
+        void Place( RandomNumberGenerator& Rand )
+        {
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                const float Center = Rand.NextFloat(-100.0f, 100.0f);
+                const float HalfSize = Rand.NextFloat(0.0f, 4.0f);
+                Min[Axis] = Center - HalfSize;
+                Max[Axis] = Center + HalfSize;
+            }
+        }
+
+        // Mostly stays within the margin
+        void Nudge( RandomNumberGenerator& Rand )
+        {
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                const float Offset = Rand.NextFloat(-0.3f, 0.3f);
+                Min[Axis] += Offset;
+                Max[Axis] += Offset;
+            }
+        }
+
+        float DistanceSq( const float Point[3] ) const
+        {
+            float Result = 0.0f;
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                const float Offset = std::max(std::max(StoredMin[Axis] - Point[Axis], Point[Axis] - StoredMax[Axis]), 0.0f);
+                Result += Offset * Offset;
+            }
+            return Result;
+        }
+    };
+
+    std::vector<Frustum> TestFrusta( RandomNumberGenerator& Rand )
+    {
+        std::vector<Frustum> Frusta;
+        for (int i = 0; i < 4; ++i)
+        {
+            Camera ViewCamera;
+            ViewCamera.SetEyeAtUp(Vector3(Rand.NextFloat(-120.0f, 120.0f), Rand.NextFloat(-120.0f, 120.0f), Rand.NextFloat(-120.0f, 120.0f)),
+                Vector3(Rand.NextFloat(-50.0f, 50.0f), Rand.NextFloat(-50.0f, 50.0f), Rand.NextFloat(-50.0f, 50.0f)), Vector3(kYUnitVector));
+            ViewCamera.SetZRange(1.0f, 150.0f);
+            ViewCamera.Update();
+            Frusta.push_back(ViewCamera.GetWorldSpaceFrustum());
+        }
+        return Frusta;
+    }
+
+    // Reported counts how many times the query reported each object.  Inside tells how far inside of the query each
+    // object is, negative when outside.
+    template <typename InsideFunc>
+    void CheckReported( const std::vector<Object>& Objects, const std::vector<uint32_t>& Reported, InsideFunc Inside, const wchar_t* Message )
+    {
+        for (size_t i = 0; i < Objects.size(); ++i)
+        {
+            if (Objects[i].Proxy == AABBTree::kNullNode)
+            {
+                Assert::AreEqual(0u, Reported[i], L"Removed objects aren't reported");
+                continue;
+            }
+
+            Assert::IsTrue(Reported[i] <= 1, L"Objects are reported once");
+            const float Distance = Inside(Objects[i]);
+            if (Distance > kTolerance)
+                Assert::AreEqual(1u, Reported[i], Message);
+            else if (Distance < -kTolerance)
+                Assert::AreEqual(0u, Reported[i], Message);
+        }
+    }
+
+    // Where the ray enters and leaves the stored box, clipped to [0, MaxDistance]
+    void Slab( const float Origin[3], const float Direction[3], float MaxDistance, const Object& Obj, float& Enter, float& Exit )
+    {
+        Enter = 0.0f;
+        Exit = MaxDistance;
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            float T0 = (Obj.StoredMin[Axis] - Origin[Axis]) / Direction[Axis];
+            float T1 = (Obj.StoredMax[Axis] - Origin[Axis]) / Direction[Axis];
+            if (T0 > T1)
+                std::swap(T0, T1);
+            Enter = std::max(Enter, T0);
+            Exit = std::min(Exit, T1);
+        }
+    }
+
+    void CheckQueries( const AABBTree& Tree, const std::vector<Object>& Objects, uint32_t NumLive,
+        const std::vector<Frustum>& Frusta, RandomNumberGenerator& Rand )
+    {
+        const uint32_t NumObjects = (uint32_t)Objects.size();
+        std::vector<uint32_t> Reported;
+
+        for (const Frustum& F : Frusta)
+        {
+            Reported.assign(NumObjects, 0);
+            Tree.QueryFrustum(F, [&]( uint32_t UserData ) { ++Reported[UserData]; });
+            CheckReported(Objects, Reported, [&]( const Object& Obj )
+            {
+                // The distance of the corner furthest in front of each plane
+                float Inside = std::numeric_limits<float>::max();
+                for (int p = 0; p < 6; ++p)
+                {
+                    const Vector4 Plane = F.GetFrustumPlane((Frustum::PlaneID)p);
+                    const float Normal[3] = { Plane.GetX(), Plane.GetY(), Plane.GetZ() };
+                    float Front = Plane.GetW();
+                    for (int Axis = 0; Axis < 3; ++Axis)
+                        Front += Normal[Axis] * (Normal[Axis] > 0.0f ? Obj.StoredMax[Axis] : Obj.StoredMin[Axis]);
+                    Inside = std::min(Inside, Front);
+                }
+                return Inside;
+            }, L"The frustum query finds the boxes in the frustum");
+        }
+
+        for (int Query = 0; Query < 20; ++Query)
+        {
+            const float Center[3] = { Rand.NextFloat(-120.0f, 120.0f), Rand.NextFloat(-120.0f, 120.0f), Rand.NextFloat(-120.0f, 120.0f) };
+            const float Radius = Rand.NextFloat(0.0f, 40.0f);
+            Reported.assign(NumObjects, 0);
+            Tree.QuerySphere(BoundingSphere(Vector3(Center[0], Center[1], Center[2]), Radius), [&]( uint32_t UserData ) { ++Reported[UserData]; });
+            CheckReported(Objects, Reported, [&]( const Object& Obj ) { return Radius - std::sqrt(Obj.DistanceSq(Center)); },
+                L"The sphere query finds the boxes in the sphere");
+        }
+
+        for (int Query = 0; Query < 20; ++Query)
+        {
+            const Vector3 RayOrigin(Rand.NextFloat(-120.0f, 120.0f), Rand.NextFloat(-120.0f, 120.0f), Rand.NextFloat(-120.0f, 120.0f));
+            const Vector3 RayDirection = Normalize(Vector3(Rand.NextFloat(-1.0f, 1.0f), Rand.NextFloat(-1.0f, 1.0f), Rand.NextFloat(-1.0f, 1.0f)));
+            const float Origin[3] = { RayOrigin.GetX(), RayOrigin.GetY(), RayOrigin.GetZ() };
+            const float Direction[3] = { RayDirection.GetX(), RayDirection.GetY(), RayDirection.GetZ() };
+            const float MaxDistance = Rand.NextFloat(10.0f, 300.0f);
+
+            // Every hit
+            std::vector<float> Entries(NumObjects);
+            Reported.assign(NumObjects, 0);
+            Tree.QueryRay(RayOrigin, RayDirection, MaxDistance, [&]( uint32_t UserData, float Enter )
+            {
+                ++Reported[UserData];
+                Entries[UserData] = Enter;
+                return MaxDistance;
+            });
+            CheckReported(Objects, Reported, [&]( const Object& Obj )
+            {
+                float Enter, Exit;
+                Slab(Origin, Direction, MaxDistance, Obj, Enter, Exit);
+                return Exit - Enter;
+            }, L"The ray query finds the boxes on the ray");
+
+            // Within the tolerance of the closest hit, whether or not the boxes at the edge of the ray count
+            float ClosestHit = MaxDistance, ClosestGraze = MaxDistance;
+            for (uint32_t i = 0; i < NumObjects; ++i)
+            {
+                if (Objects[i].Proxy == AABBTree::kNullNode)
+                    continue;
+
+                float Enter, Exit;
+                Slab(Origin, Direction, MaxDistance, Objects[i], Enter, Exit);
+                if (Reported[i] != 0)
+                    Assert::AreEqual(Enter, Entries[i], kTolerance, L"The ray query reports where the ray enters each box");
+                if (Exit - Enter > kTolerance)
+                    ClosestHit = std::min(ClosestHit, Enter);
+                if (Exit - Enter >= -kTolerance)
+                    ClosestGraze = std::min(ClosestGraze, Enter);
+            }
+
+            // Only the closest hit, shortening the ray at each one
+            float Closest = MaxDistance;
+            Tree.QueryRay(RayOrigin, RayDirection, MaxDistance, [&]( uint32_t, float Enter )
+            {
+                Closest = std::min(Closest, Enter);
+                return Closest;
+            });
+            Assert::IsTrue(Closest <= ClosestHit + kTolerance && Closest >= ClosestGraze - kTolerance, L"Shortening the ray finds the closest hit");
+        }
+
+        std::vector<uint32_t> UserData;
+        std::vector<float> DistanceSq, Expected;
+        for (int Query = 0; Query < 20; ++Query)
+        {
+            const float Point[3] = { Rand.NextFloat(-120.0f, 120.0f), Rand.NextFloat(-120.0f, 120.0f), Rand.NextFloat(-120.0f, 120.0f) };
+            const uint32_t K = Query % 3 == 0 ? 1 : Query % 3 == 1 ? 8 : 64;
+            UserData.assign(K, 0);
+            DistanceSq.assign(K, 0.0f);
+            const uint32_t Found = Tree.QueryNearest(Vector3(Point[0], Point[1], Point[2]), K, UserData.data(), DistanceSq.data());
+            Assert::AreEqual(std::min(K, NumLive), Found, L"The nearest query finds k objects when there are that many");
+
+            Expected.clear();
+            for (const Object& Obj : Objects)
+            {
+                if (Obj.Proxy != AABBTree::kNullNode)
+                    Expected.push_back(Obj.DistanceSq(Point));
+            }
+            std::partial_sort(Expected.begin(), Expected.begin() + Found, Expected.end());
+
+            for (uint32_t i = 0; i < Found; ++i)
+            {
+                const float Tolerance = kTolerance * (1.0f + Expected[i]);
+                Assert::AreEqual(Expected[i], DistanceSq[i], Tolerance, L"The nearest query finds the closest boxes, closest first");
+                Assert::AreEqual(Objects[UserData[i]].DistanceSq(Point), DistanceSq[i], Tolerance, L"The nearest query reports the distance of each box");
+                Assert::IsTrue(Objects[UserData[i]].Proxy != AABBTree::kNullNode, L"Removed objects aren't reported");
+            }
+            std::sort(UserData.begin(), UserData.begin() + Found);
+            Assert::IsTrue(std::adjacent_find(UserData.begin(), UserData.begin() + Found) == UserData.begin() + Found, L"Objects are reported once");
+        }
+    }
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(DynamicAABBTreeTests)
+    {
+    public:
+
+        TEST_METHOD(QueriesMatchBruteForce)
+        {
+            RandomNumberGenerator Rand(37);
+            const std::vector<Frustum> Frusta = TestFrusta(Rand);
+
+            // Two thirds of the objects start in the tree
+            DynamicAABBTree Tree(kMargin);
+            AABBTree Snapshot;
+            std::vector<Object> Objects(3000);
+            uint32_t NumLive = 0;
+            for (uint32_t i = 0; i < 2000; ++i)
+            {
+                Objects[i].Place(Rand);
+                Objects[i].Store();
+                Objects[i].Proxy = Tree.Insert(Objects[i].MinBound(), Objects[i].MaxBound(), i);
+                ++NumLive;
+            }
+
+            uint32_t NumKept = 0, NumReinserted = 0;
+            for (uint32_t Round = 0; Round < 8; ++Round)
+            {
+                for (uint32_t Change = 0; Change < 1000; ++Change)
+                {
+                    const uint32_t Index = (uint32_t)Rand.NextInt((int32_t)Objects.size() - 1);
+                    Object& Obj = Objects[Index];
+                    if (Obj.Proxy == AABBTree::kNullNode)
+                    {
+                        Obj.Place(Rand);
+                        Obj.Store();
+                        Obj.Proxy = Tree.Insert(Obj.MinBound(), Obj.MaxBound(), Index);
+                        ++NumLive;
+                        continue;
+                    }
+
+                    switch (Rand.NextInt(4))
+                    {
+                    case 0:
+                        Tree.Remove(Obj.Proxy);
+                        Obj.Proxy = AABBTree::kNullNode;
+                        --NumLive;
+                        continue;
+
+                    case 1:
+                    case 2:
+                    {
+                        if (Rand.NextInt(1) == 0)
+                            Obj.Nudge(Rand);
+                        else
+                            Obj.Place(Rand);
+                        const bool Reinserted = !Obj.StoredBoxContains();
+                        Assert::AreEqual(Reinserted, Tree.Update(Obj.Proxy, Obj.MinBound(), Obj.MaxBound()),
+                            L"Update() reinserts the objects that leave their stored box");
+                        if (Reinserted)
+                        {
+                            Obj.Store();
+                            ++NumReinserted;
+                        }
+                        else
+                        {
+                            ++NumKept;
+                        }
+                        break;
+                    }
+
+                    default:
+                        // Large changes too, which make the tree worse but must not make it wrong
+                        if (Rand.NextInt(1) == 0)
+                            Obj.Nudge(Rand);
+                        else
+                            Obj.Place(Rand);
+                        Obj.Store();
+                        Tree.Refit(Obj.Proxy, Obj.MinBound(), Obj.MaxBound());
+                        break;
+                    }
+                    Assert::AreEqual(Index, Tree.GetUserData(Obj.Proxy), L"Proxies keep their user data");
+                }
+
+                Assert::IsTrue(Tree.GetHeight() <= HeightBound(NumLive), L"The tree stays balanced");
+                CheckQueries(Tree, Objects, NumLive, Frusta, Rand);
+                Tree.CopyTo(Snapshot);
+                CheckQueries(Snapshot, Objects, NumLive, Frusta, Rand);
+            }
+            Assert::IsTrue(NumKept > 0 && NumReinserted > 0, L"Updates both kept and reinserted objects");
+
+            Tree.Clear();
+            CheckQueries(Tree, std::vector<Object>(), 0, Frusta, Rand);
+        }
+
+        TEST_METHOD(DegenerateInsertsStayBalanced)
+        {
+            // Sorted both ways along an axis, the same box or point over and over, and boxes that each contain the
+            // previous one or are contained by it.  The surface area heuristic alone turns the last four into chains.
+            const uint32_t NumObjects = 1 << 14;
+            const char* const LayoutNames[] = { "Ascending", "Descending", "Same box", "Same point", "Growing", "Shrinking" };
+
+            for (uint32_t Layout = 0; Layout < _countof(LayoutNames); ++Layout)
+            {
+                DynamicAABBTree Tree;
+                std::vector<int32_t> Proxies;
+                for (uint32_t i = 0; i < NumObjects; ++i)
+                {
+                    float Min = 0.0f, Max = 0.0f;
+                    switch (Layout)
+                    {
+                    case 0: Min = (float)i; Max = Min + 1.0f; break;
+                    case 1: Min = -(float)i; Max = Min + 1.0f; break;
+                    case 2: Max = 1.0f; break;
+                    case 3: break;
+                    case 4: Max = (float)(i + 1); Min = -Max; break;
+                    case 5: Max = (float)(NumObjects - i); Min = -Max; break;
+                    }
+                    Proxies.push_back(Tree.Insert(Vector3(Min, Layout < 2 ? 0.0f : Min, Layout < 2 ? 0.0f : Min),
+                        Vector3(Max, Layout < 2 ? 1.0f : Max, Layout < 2 ? 1.0f : Max), i));
+                }
+                LogMessage("%s:  height %d", LayoutNames[Layout], Tree.GetHeight());
+                Assert::IsTrue(Tree.GetHeight() <= HeightBound(NumObjects), L"Degenerate inserts keep the tree balanced");
+
+                for (uint32_t i = 1; i < NumObjects; i += 2)
+                    Tree.Remove(Proxies[i]);
+                Assert::IsTrue(Tree.GetHeight() <= HeightBound(NumObjects / 2), L"Removes keep the tree balanced");
+
+                // Walking the whole tree doesn't overflow the queries' stacks
+                uint32_t Found = 0;
+                Tree.QuerySphere(BoundingSphere(Vector3(kZero), 1e6f), [&]( uint32_t ) { ++Found; });
+                Assert::AreEqual(NumObjects / 2, Found, L"The sphere query finds every object");
+
+                uint32_t UserData[4];
+                float DistanceSq[4];
+                Assert::AreEqual(4u, Tree.QueryNearest(Vector3(kZero), 4, UserData, DistanceSq), L"The nearest query finds k objects");
+            }
+        }
+    };
+}
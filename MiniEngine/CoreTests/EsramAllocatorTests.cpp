@@ -0,0 +1,234 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  EsramAllocator::Place() and PeakLiveSize() don't touch the device, so these tests check the
+// placements of lifetimes declared in scope trees the way PushStack(), PopStack() and Alloc() declare them:  no two
+// placements that are live at the same time share memory, offsets are aligned, and stack shaped lifetimes need no
+// more memory than is ever live at once.
+//
+
+#include "stdafx.h"
+#include "EsramAllocator.h"
+#include "Math/Random.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    typedef EsramAllocator::Placement Placement;
+
+    const uint64_t kSmallAlignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;    // 64 KB
+    const uint64_t kMSAAAlignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT; // 4 MB
+
+    // Times placements like EsramAllocator does:  a placement lives from the beginning of the scope it is declared in
+    // until that scope is popped.
+    class ScopeRecorder
+    {
+    public:
+        ScopeRecorder() : m_Time(0) {}
+
+        void PushStack( void )
+        {
+            m_ScopeBegins.push_back(++m_Time);
+        }
+
+        void PopStack( void )
+        {
+            uint32_t ScopeBegin = m_ScopeBegins.back();
+            m_ScopeBegins.pop_back();
+            EndLifetimes(ScopeBegin);
+        }
+
+        uint32_t Depth( void ) const { return (uint32_t)m_ScopeBegins.size(); }
+
+        // Sizes are a multiple of the alignment, as GetResourceAllocationInfo() reports them
+        void Alloc( uint64_t Size, uint64_t Alignment )
+        {
+            Placement NewPlacement = { Size, Alignment, m_ScopeBegins.empty() ? 0 : m_ScopeBegins.back(), kOpenLifetime, 0 };
+            m_Placements.push_back(NewPlacement);
+        }
+
+        std::vector<Placement>& Finish( void )
+        {
+            while (!m_ScopeBegins.empty())
+                PopStack();
+            EndLifetimes(0);
+            return m_Placements;
+        }
+
+    private:
+        static const uint32_t kOpenLifetime = 0xFFFFFFFF;
+
+        void EndLifetimes( uint32_t ScopeBegin )
+        {
+            ++m_Time;
+            for (size_t i = m_Placements.size(); i > 0 && m_Placements[i - 1].Begin >= ScopeBegin; --i)
+            {
+                if (m_Placements[i - 1].End == kOpenLifetime)
+                    m_Placements[i - 1].End = m_Time;
+            }
+        }
+
+        std::vector<Placement> m_Placements;
+        std::vector<uint32_t> m_ScopeBegins;
+        uint32_t m_Time;
+    };
+
+    // A random tree of up to NumOperations scope pushes, pops and allocations.  Sizes are 1 to 8 times the alignment
+    // of the allocation, and an allocation needs the MSAA alignment with a probability of MSAAPercent %.
+    std::vector<Placement> RandomScopeTree( Math::RandomNumberGenerator& Rand, uint32_t NumOperations, int32_t MSAAPercent )
+    {
+        ScopeRecorder Recorder;
+        for (uint32_t i = 0; i < NumOperations; ++i)
+        {
+            int32_t Operation = Rand.NextInt(9);
+            if (Operation < 3)
+                Recorder.PushStack();
+            else if (Operation < 5 && Recorder.Depth() > 0)
+                Recorder.PopStack();
+            else
+            {
+                uint64_t Alignment = Rand.NextInt(99) < MSAAPercent ? kMSAAAlignment : kSmallAlignment;
+                Recorder.Alloc(Alignment * Rand.NextInt(1, 8), Alignment);
+            }
+        }
+        return Recorder.Finish();
+    }
+
+    void CheckPlacements( const std::vector<Placement>& Placements, uint64_t HeapSize )
+    {
+        for (size_t i = 0; i < Placements.size(); ++i)
+        {
+            const Placement& A = Placements[i];
+            Assert::IsTrue(A.Offset % A.Alignment == 0, L"Offsets are aligned");
+            Assert::IsTrue(A.Offset + A.Size <= HeapSize, L"Placements fit in the heap");
+
+            for (size_t j = i + 1; j < Placements.size(); ++j)
+            {
+                const Placement& B = Placements[j];
+                bool LiveTogether = A.Begin < B.End && B.Begin < A.End;
+                bool ShareMemory = A.Offset < B.Offset + B.Size && B.Offset < A.Offset + A.Size;
+                Assert::IsFalse(LiveTogether && ShareMemory, L"Placements that are live at the same time don't share memory");
+            }
+        }
+    }
+
+    uint64_t PlaceAndCheck( std::vector<Placement>& Placements )
+    {
+        uint64_t HeapSize = EsramAllocator::Place(Placements.data(), (uint32_t)Placements.size());
+        CheckPlacements(Placements, HeapSize);
+        Assert::IsTrue(HeapSize >= EsramAllocator::PeakLiveSize(Placements.data(), (uint32_t)Placements.size()),
+            L"No placement beats the peak live size");
+        return HeapSize;
+    }
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(EsramAllocatorTests)
+    {
+    public:
+
+        TEST_METHOD(SiblingScopesShareMemory)
+        {
+            ScopeRecorder Recorder;
+            Recorder.Alloc(kSmallAlignment, kSmallAlignment);        // 0: the whole frame
+            Recorder.PushStack();
+            Recorder.Alloc(kSmallAlignment, kSmallAlignment);        // 1: scope A
+            Recorder.PushStack();
+            Recorder.Alloc(kSmallAlignment, kSmallAlignment);        // 2: scope A.1
+            Recorder.PopStack();
+            Recorder.Alloc(kSmallAlignment, kSmallAlignment);        // 3: scope A, after A.1
+            Recorder.PopStack();
+            Recorder.PushStack();
+            Recorder.Alloc(kSmallAlignment, kSmallAlignment);        // 4: scope B
+            Recorder.PopStack();
+            std::vector<Placement>& Placements = Recorder.Finish();
+
+            // An allocation lives as long as its scope, wherever in the scope it is declared
+            Assert::IsTrue(Placements[1].Begin == Placements[3].Begin && Placements[1].End == Placements[3].End);
+            Assert::IsTrue(Placements[2].Begin > Placements[1].Begin && Placements[2].End < Placements[1].End);
+            Assert::IsTrue(Placements[4].Begin >= Placements[1].End && Placements[0].End > Placements[4].End);
+
+            Assert::AreEqual(4 * kSmallAlignment, PlaceAndCheck(Placements), L"B reuses the memory of scope A");
+        }
+
+        TEST_METHOD(NestedScopesReachPeakLiveSize)
+        {
+            // Every scope is live with all the scopes around it, so nothing can share memory
+            ScopeRecorder Recorder;
+            uint64_t Total = 0;
+            for (uint32_t Depth = 1; Depth <= 16; ++Depth)
+            {
+                Recorder.PushStack();
+                Recorder.Alloc(kSmallAlignment * (Depth % 5 + 1), kSmallAlignment);
+                Total += kSmallAlignment * (Depth % 5 + 1);
+            }
+            std::vector<Placement>& Placements = Recorder.Finish();
+
+            Assert::AreEqual(Total, EsramAllocator::PeakLiveSize(Placements.data(), (uint32_t)Placements.size()));
+            Assert::AreEqual(Total, PlaceAndCheck(Placements));
+        }
+
+        TEST_METHOD(SiblingScopesReachPeakLiveSize)
+        {
+            // Siblings of different sizes under a common parent only need the largest of them on top of the parent
+            ScopeRecorder Recorder;
+            Recorder.PushStack();
+            Recorder.Alloc(3 * kSmallAlignment, kSmallAlignment);
+            for (uint32_t Sibling = 1; Sibling <= 8; ++Sibling)
+            {
+                Recorder.PushStack();
+                Recorder.Alloc(kSmallAlignment * Sibling, kSmallAlignment);
+                Recorder.Alloc(kSmallAlignment * (9 - Sibling) * 2, kSmallAlignment);
+                Recorder.PopStack();
+            }
+            std::vector<Placement>& Placements = Recorder.Finish();
+
+            uint64_t Peak = EsramAllocator::PeakLiveSize(Placements.data(), (uint32_t)Placements.size());
+            Assert::AreEqual(3 * kSmallAlignment + 17 * kSmallAlignment, Peak);
+            Assert::AreEqual(Peak, PlaceAndCheck(Placements));
+        }
+
+        TEST_METHOD(RandomScopeTreesReachPeakLiveSize)
+        {
+            Math::RandomNumberGenerator Rand(11);
+            for (uint32_t Trial = 0; Trial < 500; ++Trial)
+            {
+                std::vector<Placement> Placements = RandomScopeTree(Rand, 20 + Rand.NextInt(200), 0);
+                if (Placements.empty())
+                    continue;
+
+                uint64_t Peak = EsramAllocator::PeakLiveSize(Placements.data(), (uint32_t)Placements.size());
+                Assert::AreEqual(Peak, PlaceAndCheck(Placements), L"Scope trees with one alignment reach the peak live size");
+            }
+        }
+
+        TEST_METHOD(MixedAlignmentsPlaceValidly)
+        {
+            // A 4 MB aligned texture that is live with a 5 MB buffer can't start right after it
+            std::vector<Placement> Placements =
+            {
+                { 80 * kSmallAlignment, kSmallAlignment, 0, 4, 0 },
+                { kMSAAAlignment, kMSAAAlignment, 2, 6, 0 },
+            };
+            Assert::AreEqual(3 * kMSAAAlignment, PlaceAndCheck(Placements));
+            Assert::AreEqual(2 * kMSAAAlignment, Placements[1].Offset);
+
+            Math::RandomNumberGenerator Rand(12);
+            for (uint32_t Trial = 0; Trial < 500; ++Trial)
+            {
+                Placements = RandomScopeTree(Rand, 20 + Rand.NextInt(200), 30);
+                if (!Placements.empty())
+                    PlaceAndCheck(Placements);
+            }
+        }
+    };
+}
@@ -0,0 +1,447 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  FrameGraph::Compile() works on the declarations of the passes only, so these tests check the plans
+// it makes without a device.  BarrierReport compiles a frame shaped like ModelViewer's and compares the plan with the
+// barriers the same passes issue when each transitions its resources itself.
+//
+
+#include "stdafx.h"
+#include "FrameGraph.h"
+#include "GpuResource.h"
+#include "CommandContext.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    const D3D12_RESOURCE_STATES kRenderTarget = D3D12_RESOURCE_STATE_RENDER_TARGET;
+    const D3D12_RESOURCE_STATES kUnorderedAccess = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    const D3D12_RESOURCE_STATES kDepthWrite = D3D12_RESOURCE_STATE_DEPTH_WRITE;
+    const D3D12_RESOURCE_STATES kDepthRead = D3D12_RESOURCE_STATE_DEPTH_READ;
+    const D3D12_RESOURCE_STATES kPixelShaderResource = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+    const D3D12_RESOURCE_STATES kNonPixelShaderResource = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+
+    void DoNothing( CommandContext& ) {}
+
+    // Resources are only used for their state, so they don't need a device
+    struct TestResource : public GpuResource
+    {
+        explicit TestResource( D3D12_RESOURCE_STATES State ) : GpuResource(nullptr, State) {}
+    };
+
+    uint32_t CountBarriers( const FrameGraph& Graph, FrameGraph::PassHandle Pass, FrameGraph::BarrierType Type )
+    {
+        uint32_t Count = 0, NumBarriers;
+        const FrameGraph::Barrier* Barriers = Graph.GetBarriers(Pass, NumBarriers);
+        for (uint32_t i = 0; i < NumBarriers; ++i)
+            Count += Barriers[i].Type == Type ? 1 : 0;
+        return Count;
+    }
+
+    // A pass of a test frame, and what it uses
+    struct PassDesc
+    {
+        const wchar_t* Name;
+        uint32_t Flags;
+        struct Use
+        {
+            uint32_t Resource;
+            D3D12_RESOURCE_STATES State;
+            bool IsWrite;
+        } Uses[5];
+        uint32_t NumUses;
+    };
+
+    bool IsReadOnly( D3D12_RESOURCE_STATES State )
+    {
+        return State != 0 && (State & ~READ_ONLY_RESOURCE_STATES) == 0;
+    }
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(FrameGraphTests)
+    {
+    public:
+
+        TEST_METHOD(CullsPassesThatReachNoOutput)
+        {
+            TestResource Temp(kRenderTarget), Output(kRenderTarget), Unused(kUnorderedAccess), Scratch(kUnorderedAccess);
+            TestResource Readback(kUnorderedAccess);
+
+            FrameGraph Graph;
+            Graph.Reset();
+            FrameGraph::ResourceHandle hTemp = Graph.ImportResource(Temp);
+            FrameGraph::ResourceHandle hOutput = Graph.ImportResource(Output, true);
+            FrameGraph::ResourceHandle hUnused = Graph.ImportResource(Unused);
+            FrameGraph::ResourceHandle hScratch = Graph.ImportResource(Scratch);
+            FrameGraph::ResourceHandle hReadback = Graph.ImportResource(Readback);
+
+            FrameGraph::PassHandle Producer = Graph.AddPass(L"Producer", FrameGraph::kGraphicsPass, DoNothing);
+            Graph.Write(Producer, hTemp, kRenderTarget);
+            FrameGraph::PassHandle Consumer = Graph.AddPass(L"Consumer", FrameGraph::kGraphicsPass, DoNothing);
+            Graph.Read(Consumer, hTemp, kPixelShaderResource);
+            Graph.Write(Consumer, hOutput, kRenderTarget);
+
+            // Writes nothing that is used later
+            FrameGraph::PassHandle Dead = Graph.AddPass(L"Dead", FrameGraph::kComputePass, DoNothing);
+            Graph.Read(Dead, hTemp, kNonPixelShaderResource);
+            Graph.Write(Dead, hUnused, kUnorderedAccess);
+
+            // Only feeds the dead pass
+            FrameGraph::PassHandle Feeder = Graph.AddPass(L"Feeder", FrameGraph::kComputePass, DoNothing);
+            Graph.Write(Feeder, hScratch, kUnorderedAccess);
+            FrameGraph::PassHandle DeadReader = Graph.AddPass(L"DeadReader", FrameGraph::kComputePass, DoNothing);
+            Graph.Read(DeadReader, hScratch, kNonPixelShaderResource);
+            Graph.Write(DeadReader, hUnused, kUnorderedAccess);
+
+            // Writes something read outside of the graph
+            FrameGraph::PassHandle Kept = Graph.AddPass(L"Kept", FrameGraph::kComputePass | FrameGraph::kNeverCull, DoNothing);
+            Graph.Write(Kept, hReadback, kUnorderedAccess);
+
+            Graph.Compile();
+
+            Assert::IsFalse(Graph.IsPassCulled(Producer));
+            Assert::IsFalse(Graph.IsPassCulled(Consumer));
+            Assert::IsTrue(Graph.IsPassCulled(Dead));
+            Assert::IsTrue(Graph.IsPassCulled(Feeder));
+            Assert::IsTrue(Graph.IsPassCulled(DeadReader));
+            Assert::IsFalse(Graph.IsPassCulled(Kept));
+            Assert::AreEqual(6u, Graph.GetStats().Passes);
+            Assert::AreEqual(3u, Graph.GetStats().CulledPasses);
+        }
+
+        TEST_METHOD(MergesConsecutiveReads)
+        {
+            TestResource Source(kRenderTarget), Output1(kRenderTarget), Output2(kRenderTarget);
+
+            FrameGraph Graph;
+            Graph.Reset();
+            FrameGraph::ResourceHandle hSource = Graph.ImportResource(Source);
+            FrameGraph::ResourceHandle hOutput1 = Graph.ImportResource(Output1, true);
+            FrameGraph::ResourceHandle hOutput2 = Graph.ImportResource(Output2, true);
+
+            FrameGraph::PassHandle Write = Graph.AddPass(L"Write", FrameGraph::kGraphicsPass, DoNothing);
+            Graph.Write(Write, hSource, kRenderTarget);
+            FrameGraph::PassHandle Read1 = Graph.AddPass(L"Read1", FrameGraph::kGraphicsPass, DoNothing);
+            Graph.Read(Read1, hSource, kPixelShaderResource);
+            Graph.Write(Read1, hOutput1, kRenderTarget);
+            FrameGraph::PassHandle Read2 = Graph.AddPass(L"Read2", FrameGraph::kComputePass, DoNothing);
+            Graph.Read(Read2, hSource, kNonPixelShaderResource);
+            Graph.Write(Read2, hOutput2, kRenderTarget);
+
+            Graph.Compile();
+
+            // One transition, before the first read, to both read states
+            uint32_t NumBarriers;
+            const FrameGraph::Barrier* Barriers = Graph.GetBarriers(Read1, NumBarriers);
+            Assert::AreEqual(1u, NumBarriers);
+            Assert::AreEqual(hSource, Barriers[0].Resource);
+            Assert::IsTrue(Barriers[0].State == (kPixelShaderResource | kNonPixelShaderResource));
+            Assert::AreEqual((int)FrameGraph::kTransition, (int)Barriers[0].Type);
+
+            Graph.GetBarriers(Read2, NumBarriers);
+            Assert::AreEqual(0u, NumBarriers);
+            Graph.GetBarriers(Write, NumBarriers);
+            Assert::AreEqual(0u, NumBarriers);
+            Assert::AreEqual(1u, Graph.GetStats().Transitions);
+        }
+
+        TEST_METHOD(SkipsReadsInReadableStates)
+        {
+            TestResource Source(kPixelShaderResource | kNonPixelShaderResource), Output(kRenderTarget);
+
+            FrameGraph Graph;
+            Graph.Reset();
+            FrameGraph::ResourceHandle hSource = Graph.ImportResource(Source);
+            FrameGraph::ResourceHandle hOutput = Graph.ImportResource(Output, true);
+
+            FrameGraph::PassHandle Read = Graph.AddPass(L"Read", FrameGraph::kGraphicsPass, DoNothing);
+            Graph.Read(Read, hSource, kPixelShaderResource);
+            Graph.Write(Read, hOutput, kRenderTarget);
+
+            Graph.Compile();
+
+            Assert::AreEqual(0u, Graph.GetStats().Transitions);
+            Assert::AreEqual(0u, Graph.GetStats().Batches);
+        }
+
+        TEST_METHOD(SplitsTransitionsAcrossUnrelatedPasses)
+        {
+            TestResource Shadow(kPixelShaderResource), Color(kRenderTarget), Other(kRenderTarget);
+
+            FrameGraph Graph;
+            Graph.Reset();
+            FrameGraph::ResourceHandle hShadow = Graph.ImportResource(Shadow);
+            FrameGraph::ResourceHandle hColor = Graph.ImportResource(Color, true);
+            FrameGraph::ResourceHandle hOther = Graph.ImportResource(Other, true);
+
+            FrameGraph::PassHandle Render = Graph.AddPass(L"Render", FrameGraph::kGraphicsPass, DoNothing);
+            Graph.Write(Render, hShadow, kDepthWrite);
+            FrameGraph::PassHandle Unrelated = Graph.AddPass(L"Unrelated", FrameGraph::kGraphicsPass, DoNothing);
+            Graph.Write(Unrelated, hOther, kRenderTarget);
+            FrameGraph::PassHandle Use = Graph.AddPass(L"Use", FrameGraph::kGraphicsPass, DoNothing);
+            Graph.Read(Use, hShadow, kPixelShaderResource);
+            Graph.Write(Use, hColor, kRenderTarget);
+
+            Graph.Compile();
+
+            // The first transition has nothing before it to hide behind
+            Assert::AreEqual(1u, CountBarriers(Graph, Render, FrameGraph::kTransition));
+            Assert::AreEqual(1u, CountBarriers(Graph, Unrelated, FrameGraph::kBeginTransition));
+            Assert::AreEqual(1u, CountBarriers(Graph, Use, FrameGraph::kEndTransition));
+            Assert::AreEqual(1u, Graph.GetStats().Transitions);
+            Assert::AreEqual(1u, Graph.GetStats().SplitTransitions);
+        }
+
+        TEST_METHOD(UAVBarriersBetweenWriters)
+        {
+            TestResource Buffer(kUnorderedAccess);
+
+            FrameGraph Graph;
+            Graph.Reset();
+            FrameGraph::ResourceHandle hBuffer = Graph.ImportResource(Buffer, true);
+
+            FrameGraph::PassHandle First = Graph.AddPass(L"First", FrameGraph::kComputePass, DoNothing);
+            Graph.Write(First, hBuffer, kUnorderedAccess);
+            FrameGraph::PassHandle Second = Graph.AddPass(L"Second", FrameGraph::kComputePass, DoNothing);
+            Graph.Write(Second, hBuffer, kUnorderedAccess);
+
+            Graph.Compile();
+
+            Assert::AreEqual(0u, CountBarriers(Graph, First, FrameGraph::kUAVBarrier));
+            Assert::AreEqual(1u, CountBarriers(Graph, Second, FrameGraph::kUAVBarrier));
+            Assert::AreEqual(1u, Graph.GetStats().UAVBarriers);
+            Assert::AreEqual(0u, Graph.GetStats().Transitions);
+        }
+
+        TEST_METHOD(AsyncCompute)
+        {
+            TestResource Depth(kDepthWrite), AO(kUnorderedAccess), Shadow(kDepthWrite), Color(kRenderTarget);
+
+            FrameGraph Graph;
+            Graph.Reset();
+            FrameGraph::ResourceHandle hDepth = Graph.ImportResource(Depth);
+            FrameGraph::ResourceHandle hAO = Graph.ImportResource(AO);
+            FrameGraph::ResourceHandle hShadow = Graph.ImportResource(Shadow);
+            FrameGraph::ResourceHandle hColor = Graph.ImportResource(Color, true);
+
+            FrameGraph::PassHandle ZPrePass = Graph.AddPass(L"ZPrePass", FrameGraph::kGraphicsPass, DoNothing);
+            Graph.Write(ZPrePass, hDepth, kDepthWrite);
+            FrameGraph::PassHandle SSAO = Graph.AddPass(L"SSAO", FrameGraph::kComputePass | FrameGraph::kAsyncCompute, DoNothing);
+            Graph.Read(SSAO, hDepth, kNonPixelShaderResource);
+            Graph.Write(SSAO, hAO, kUnorderedAccess);
+            FrameGraph::PassHandle ShadowMap = Graph.AddPass(L"ShadowMap", FrameGraph::kGraphicsPass, DoNothing);
+            Graph.Write(ShadowMap, hShadow, kDepthWrite);
+            FrameGraph::PassHandle Lighting = Graph.AddPass(L"Lighting", FrameGraph::kGraphicsPass, DoNothing);
+            Graph.Read(Lighting, hAO, kPixelShaderResource);
+            Graph.Read(Lighting, hShadow, kPixelShaderResource);
+            Graph.Write(Lighting, hColor, kRenderTarget);
+
+            // Nothing overlaps it before the pass that writes what it reads
+            FrameGraph::PassHandle Blur = Graph.AddPass(L"Blur", FrameGraph::kComputePass, DoNothing);
+            Graph.Read(Blur, hColor, kNonPixelShaderResource);
+            Graph.Write(Blur, hAO, kUnorderedAccess);
+            FrameGraph::PassHandle Composite = Graph.AddPass(L"Composite", FrameGraph::kGraphicsPass, DoNothing);
+            Graph.Read(Composite, hAO, kPixelShaderResource);
+            Graph.Write(Composite, hColor, kRenderTarget);
+
+            Graph.Compile();
+
+            Assert::IsTrue(Graph.IsAsyncCandidate(SSAO));
+            Assert::IsTrue(Graph.IsAsync(SSAO));
+            Assert::IsFalse(Graph.IsAsyncCandidate(Blur));
+            Assert::IsFalse(Graph.IsAsync(Blur));
+            Assert::IsFalse(Graph.IsAsync(ShadowMap));
+            Assert::AreEqual(1u, Graph.GetStats().AsyncCandidates);
+            Assert::AreEqual(1u, Graph.GetStats().AsyncPasses);
+
+            // The async pass could still be using AO, so its transition isn't split across the shadow pass
+            Assert::AreEqual(0u, CountBarriers(Graph, ShadowMap, FrameGraph::kBeginTransition));
+            uint32_t NumBarriers;
+            const FrameGraph::Barrier* Barriers = Graph.GetBarriers(Lighting, NumBarriers);
+            bool FoundAO = false;
+            for (uint32_t i = 0; i < NumBarriers; ++i)
+                FoundAO = FoundAO || (Barriers[i].Resource == hAO && Barriers[i].Type == FrameGraph::kTransition);
+            Assert::IsTrue(FoundAO);
+        }
+
+        TEST_METHOD(BarrierReport)
+        {
+            // ModelViewer's RenderScene:  depth and the shadow map are transient, SSAO could run asynchronously, and one
+            // pass writes a buffer nothing reads.
+            enum { kDepth, kColor, kLinearDepth, kSSAO, kShadow, kLightGrid, kVelocity, kUnused, kNumResources };
+            const D3D12_RESOURCE_STATES InitialStates[kNumResources] = { kDepthWrite, kRenderTarget, kUnorderedAccess,
+                kPixelShaderResource, kPixelShaderResource, kNonPixelShaderResource, kPixelShaderResource,
+                D3D12_RESOURCE_STATE_COMMON };
+            const bool IsOutput[kNumResources] = { false, true, true, false, false, false, true, false };
+            const bool IsTransient[kNumResources] = { true, false, false, false, true, false, false, false };
+
+            const PassDesc Passes[] =
+            {
+                { L"ZPrePass", FrameGraph::kGraphicsPass, { { kDepth, kDepthWrite, true } }, 1 },
+                { L"SSAO", FrameGraph::kComputePass | FrameGraph::kAsyncCompute, { { kDepth, kNonPixelShaderResource, false },
+                    { kLinearDepth, kUnorderedAccess, true }, { kSSAO, kUnorderedAccess, true } }, 3 },
+                { L"FillLightGrid", FrameGraph::kComputePass, { { kDepth, kNonPixelShaderResource, false },
+                    { kLightGrid, kUnorderedAccess, true } }, 2 },
+                { L"ShadowMap", FrameGraph::kGraphicsPass, { { kShadow, kDepthWrite, true } }, 1 },
+                { L"Color", FrameGraph::kGraphicsPass, { { kDepth, kDepthRead, false }, { kSSAO, kPixelShaderResource, false },
+                    { kShadow, kPixelShaderResource, false }, { kLightGrid, kPixelShaderResource, false },
+                    { kColor, kRenderTarget, true } }, 5 },
+                { L"CameraVelocity", FrameGraph::kComputePass, { { kDepth, kNonPixelShaderResource, false },
+                    { kVelocity, kUnorderedAccess, true } }, 2 },
+                { L"Unused", FrameGraph::kComputePass, { { kUnused, kUnorderedAccess, true } }, 1 },
+                { L"TemporalResolve", FrameGraph::kComputePass, { { kVelocity, kNonPixelShaderResource, false },
+                    { kColor, kUnorderedAccess, true } }, 2 },
+                { L"TemporalSharpen", FrameGraph::kComputePass, { { kColor, kUnorderedAccess, true } }, 1 },
+            };
+            std::vector<TestResource> Resources;
+            Resources.reserve(kNumResources);
+            for (uint32_t i = 0; i < kNumResources; ++i)
+                Resources.emplace_back(InitialStates[i]);
+
+            FrameGraph Graph;
+            Graph.Reset();
+            for (uint32_t i = 0; i < kNumResources; ++i)
+            {
+                if (IsTransient[i])
+                    Graph.ImportTransientResource(Resources[i]);
+                else
+                    Graph.ImportResource(Resources[i], IsOutput[i]);
+            }
+            for (const PassDesc& Desc : Passes)
+            {
+                FrameGraph::PassHandle Pass = Graph.AddPass(Desc.Name, Desc.Flags, DoNothing);
+                for (uint32_t i = 0; i < Desc.NumUses; ++i)
+                {
+                    if (Desc.Uses[i].IsWrite)
+                        Graph.Write(Pass, Desc.Uses[i].Resource, Desc.Uses[i].State);
+                    else
+                        Graph.Read(Pass, Desc.Uses[i].Resource, Desc.Uses[i].State);
+                }
+            }
+            Graph.Compile();
+
+            // Without a graph, every pass transitions what it uses to the state it needs and flushes.  TransitionResource()
+            // skips reads in a readable state and inserts a UAV barrier between unordered accesses.
+            uint32_t ByHandTransitions = 0, ByHandUAVBarriers = 0, ByHandBatches = 0;
+            D3D12_RESOURCE_STATES States[kNumResources];
+            memcpy(States, InitialStates, sizeof(States));
+            for (const PassDesc& Desc : Passes)
+            {
+                uint32_t Barriers = 0;
+                for (uint32_t i = 0; i < Desc.NumUses; ++i)
+                {
+                    D3D12_RESOURCE_STATES& State = States[Desc.Uses[i].Resource];
+                    const D3D12_RESOURCE_STATES NewState = Desc.Uses[i].State;
+                    if (NewState == State)
+                    {
+                        if (NewState == kUnorderedAccess)
+                        {
+                            ++ByHandUAVBarriers;
+                            ++Barriers;
+                        }
+                    }
+                    else if (!(IsReadOnly(NewState) && IsReadOnly(State) && (NewState & ~State) == 0))
+                    {
+                        State = NewState;
+                        ++ByHandTransitions;
+                        ++Barriers;
+                    }
+                }
+                ByHandBatches += Barriers > 0 ? 1 : 0;
+            }
+
+            for (FrameGraph::PassHandle Pass = 0; Pass < Graph.GetPassCount(); ++Pass)
+            {
+                char Line[256];
+                int Length = sprintf_s(Line, "%-16ls%s%s%s", Graph.GetPassName(Pass).c_str(),
+                    Graph.IsPassCulled(Pass) ? " culled" : "", Graph.IsAsyncCandidate(Pass) ? " async-candidate" : "",
+                    Graph.IsAsync(Pass) ? " async" : "");
+
+                uint32_t NumBarriers;
+                const FrameGraph::Barrier* Barriers = Graph.GetBarriers(Pass, NumBarriers);
+                for (uint32_t i = 0; i < NumBarriers && !Graph.IsPassCulled(Pass) && Length < 200; ++i)
+                {
+                    Length += sprintf_s(Line + Length, sizeof(Line) - Length, " %c%u:%x", "TBEU"[Barriers[i].Type],
+                        Barriers[i].Resource, Barriers[i].State);
+                }
+                LogMessage("%s", Line);
+            }
+
+            const FrameGraph::Stats& Stats = Graph.GetStats();
+            const uint32_t GraphBarriers = Stats.Transitions + 2 * Stats.SplitTransitions + Stats.UAVBarriers;
+            LogMessage("Frame graph:  %u of %u passes culled, %u transitions, %u split, %u UAV barriers, %u barriers in %u batches",
+                Stats.CulledPasses, Stats.Passes, Stats.Transitions, Stats.SplitTransitions, Stats.UAVBarriers,
+                GraphBarriers, Stats.Batches);
+            LogMessage("By hand:  %u transitions, %u UAV barriers, %u barriers in %u batches", ByHandTransitions,
+                ByHandUAVBarriers, ByHandTransitions + ByHandUAVBarriers, ByHandBatches);
+
+            Assert::AreEqual(1u, Stats.CulledPasses);
+            Assert::IsTrue(Graph.IsPassCulled(6));
+            Assert::IsTrue(Graph.IsAsync(1));
+            Assert::IsTrue(Stats.Transitions + Stats.SplitTransitions < ByHandTransitions);
+            Assert::IsTrue(Stats.Batches < ByHandBatches);
+
+            // Depth is transitioned once for all of the passes reading it
+            uint32_t NumBarriers;
+            const FrameGraph::Barrier* Barriers = Graph.GetBarriers(1, NumBarriers);
+            bool FoundDepth = false;
+            for (uint32_t i = 0; i < NumBarriers; ++i)
+            {
+                if (Barriers[i].Resource == kDepth)
+                {
+                    Assert::IsFalse(FoundDepth);
+                    FoundDepth = true;
+                }
+            }
+            Assert::IsTrue(FoundDepth);
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(CompileTime)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(CompileTime)
+        {
+            // A larger frame:  chains of compute passes over a pool of buffers, with a graphics pass every few
+            const uint32_t kNumResources = 64, kNumPasses = 256;
+            std::vector<TestResource> Resources;
+            Resources.reserve(kNumResources);
+            for (uint32_t i = 0; i < kNumResources; ++i)
+                Resources.emplace_back(kUnorderedAccess);
+
+            FrameGraph Graph;
+            const int kFrames = 1000;
+            double Time = BenchmarkTime();
+            for (int Frame = 0; Frame < kFrames; ++Frame)
+            {
+                Graph.Reset();
+                for (uint32_t i = 0; i < kNumResources; ++i)
+                    Graph.ImportResource(Resources[i], i < 4);
+                for (uint32_t p = 0; p < kNumPasses; ++p)
+                {
+                    const bool IsCompute = p % 4 != 0;
+                    FrameGraph::PassHandle Pass = Graph.AddPass(L"Pass", IsCompute ? FrameGraph::kComputePass : 0, DoNothing);
+                    Graph.Read(Pass, (p * 7 + 1) % kNumResources, kNonPixelShaderResource);
+                    Graph.Read(Pass, (p * 13 + 5) % kNumResources, IsCompute ? kNonPixelShaderResource : kPixelShaderResource);
+                    Graph.Write(Pass, p % kNumResources, kUnorderedAccess);
+                }
+                Graph.Compile();
+            }
+            Time = BenchmarkTime() - Time;
+
+            const FrameGraph::Stats& Stats = Graph.GetStats();
+            LogMessage("%u passes, %u resources:  %.1f us per frame to build and compile (%u culled, %u barriers, %u batches)",
+                kNumPasses, kNumResources, Time / kFrames * 1e6, Stats.CulledPasses,
+                Stats.Transitions + 2 * Stats.SplitTransitions + Stats.UAVBarriers, Stats.Batches);
+        }
+    };
+}
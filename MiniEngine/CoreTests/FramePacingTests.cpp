@@ -0,0 +1,298 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Runs FramePacer on a virtual clock, so that deadlines, fixed steps and statistics are checked
+// exactly and without waiting.  Sleeps wake on the next scheduler tick after a millisecond, plus some jitter.
+//
+
+#include "stdafx.h"
+#include "FramePacing.h"
+#include "Math/Random.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    const int64_t kTicksPerSecond = 10000000;
+    const int64_t kTicksPerMillisec = kTicksPerSecond / 1000;
+
+    // Each spin advances the clock by this much, which bounds how far past a deadline a wait can end
+    const int64_t kSpinTicks = kTicksPerMillisec / 10;
+
+    class VirtualClock : public FrameClock
+    {
+    public:
+        VirtualClock( float SleepGranularityMs = 1.0f, float SleepJitterMs = 0.5f ) :
+            m_Rand(5), m_SleepGranularity(SleepGranularityMs), m_SleepJitter(SleepJitterMs), m_Now(kTicksPerSecond) {}
+
+        virtual int64_t GetCurrentTick( void ) override { return m_Now; }
+        virtual int64_t GetTicksPerSecond( void ) override { return kTicksPerSecond; }
+
+        virtual void SleepOneMillisec( void ) override
+        {
+            const int64_t Granularity = (int64_t)(m_SleepGranularity * kTicksPerMillisec);
+            const int64_t Wake = (m_Now + kTicksPerMillisec + Granularity - 1) / Granularity * Granularity;
+            m_Now = Wake + (int64_t)(m_Rand.NextFloat(0.0f, m_SleepJitter) * kTicksPerMillisec);
+        }
+
+        virtual void SpinWait( void ) override { m_Now += kSpinTicks; }
+
+        // The game's work for a frame
+        void Work( float Milliseconds ) { m_Now += (int64_t)(Milliseconds * kTicksPerMillisec); }
+
+    private:
+        Math::RandomNumberGenerator m_Rand;
+        float m_SleepGranularity;
+        float m_SleepJitter;
+        int64_t m_Now;
+    };
+
+    struct PacingResult
+    {
+        uint64_t MissedDeadlines;
+        int64_t LatestStart;        // The furthest past its deadline a frame began
+        int64_t Drift;              // How far the last frame began from the first plus the frames' target times
+    };
+
+    PacingResult RunPacedFrames( VirtualClock& Clock, FramePacer& Pacer, float FramesPerSecond, uint32_t NumFrames,
+        float MinWorkMs, float MaxWorkMs )
+    {
+        Math::RandomNumberGenerator Rand(3);
+        const int64_t TargetTicks = (int64_t)((double)kTicksPerSecond / FramesPerSecond + 0.5);
+
+        // An unlimited frame puts the deadline on the clock
+        Pacer.SetTargetFrameRate(0.0f);
+        Pacer.EndFrame();
+        Pacer.SetTargetFrameRate(FramesPerSecond);
+
+        PacingResult Result = {};
+        const int64_t StartTick = Clock.GetCurrentTick();
+        int64_t Deadline = StartTick;
+        for (uint32_t i = 0; i < NumFrames; ++i)
+        {
+            Clock.Work(Rand.NextFloat(MinWorkMs, MaxWorkMs));
+            Pacer.EndFrame();
+            Deadline += TargetTicks;
+            Result.LatestStart = std::max(Result.LatestStart, Clock.GetCurrentTick() - Deadline);
+        }
+        Result.MissedDeadlines = Pacer.GetMissedDeadlineCount();
+        Result.Drift = Clock.GetCurrentTick() - Deadline;
+        return Result;
+    }
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(FramePacingTests)
+    {
+    public:
+
+        TEST_METHOD(FramesKeepToTheTarget)
+        {
+            VirtualClock Clock;
+            FramePacer Pacer(Clock);
+            const PacingResult Result = RunPacedFrames(Clock, Pacer, 60.0f, 3000, 4.0f, 12.0f);
+
+            // Every frame is exactly the target time, because it begins on its deadline rather than when its wait ends
+            Assert::AreEqual(1.0 / 60.0, (double)Pacer.GetFrameTime(), 1e-6);
+            Assert::AreEqual(0ull, (unsigned long long)Result.MissedDeadlines);
+            Assert::IsTrue(Result.LatestStart <= kSpinTicks);
+            Assert::IsTrue(Result.Drift <= kSpinTicks);
+
+            const FrameStats Stats = Pacer.GetStats();
+            Assert::AreEqual(0u, Stats.StutterCount);
+            Assert::AreEqual(1000.0f / 60.0f, Stats.Max, 1e-3f);
+
+            LogMessage("60 Hz over 3000 frames:  latest start %.3f ms past the deadline, %.1f%% of the time asleep, %.2f%% spinning",
+                (double)Result.LatestStart / kTicksPerMillisec, 100.0 * Pacer.GetSleepTicks() / (3000 * kTicksPerSecond / 60),
+                100.0 * Pacer.GetSpinTicks() / (3000 * kTicksPerSecond / 60));
+        }
+
+        TEST_METHOD(CoarseSleepsSpinInstead)
+        {
+            // Without timeBeginPeriod(), a sleep takes a whole 15.6 ms scheduler tick.  The first sleeps overshoot,
+            // until the estimate of a sleep's duration grows to that, and then shorter waits spin instead.
+            VirtualClock Clock(15.625f, 0.5f);
+            FramePacer Pacer(Clock);
+            const PacingResult Learning = RunPacedFrames(Clock, Pacer, 60.0f, 60, 4.0f, 12.0f);
+            const int64_t SleepTicks = Pacer.GetSleepTicks();
+            const int64_t SpinTicks = Pacer.GetSpinTicks();
+
+            const PacingResult Result = RunPacedFrames(Clock, Pacer, 60.0f, 3000, 4.0f, 12.0f);
+            LogMessage("15.6 ms sleeps:  %.2f ms late while learning, %.3f ms after, %.1f%% of the time asleep, %.2f%% spinning",
+                (double)Learning.LatestStart / kTicksPerMillisec, (double)Result.LatestStart / kTicksPerMillisec,
+                100.0 * (Pacer.GetSleepTicks() - SleepTicks) / (3000 * kTicksPerSecond / 60),
+                100.0 * (Pacer.GetSpinTicks() - SpinTicks) / (3000 * kTicksPerSecond / 60));
+            Assert::AreEqual(0ull, (unsigned long long)Result.MissedDeadlines);
+            Assert::IsTrue(Result.LatestStart <= kSpinTicks);
+        }
+
+        TEST_METHOD(SpinOnlyWhenSleepIsDisabled)
+        {
+            VirtualClock Clock;
+            FramePacer Pacer(Clock);
+            Pacer.SetSleepEnabled(false);
+            const PacingResult Result = RunPacedFrames(Clock, Pacer, 60.0f, 600, 4.0f, 12.0f);
+            Assert::AreEqual(0ll, (long long)Pacer.GetSleepTicks());
+            Assert::AreEqual(0ull, (unsigned long long)Result.MissedDeadlines);
+            Assert::IsTrue(Result.LatestStart <= kSpinTicks);
+        }
+
+        TEST_METHOD(LateFramesMoveTheDeadline)
+        {
+            VirtualClock Clock;
+            FramePacer Pacer(Clock);
+            Pacer.SetTargetFrameRate(30.0f);
+            Pacer.EndFrame();
+
+            Clock.Work(5.0f);
+            Pacer.EndFrame();
+            Assert::AreEqual(1.0 / 30.0, (double)Pacer.GetFrameTime(), 1e-6);
+
+            // A 50 ms frame begins when it is ready, and the next isn't hurried to catch up.  The late frame is
+            // measured from its deadline, which the wait before it overshot by less than a spin.
+            Clock.Work(50.0f);
+            Pacer.EndFrame();
+            Assert::AreEqual(1ull, (unsigned long long)Pacer.GetMissedDeadlineCount());
+            Assert::AreEqual(0.05, (double)Pacer.GetFrameTime(), (double)kSpinTicks / kTicksPerSecond);
+
+            Clock.Work(5.0f);
+            Pacer.EndFrame();
+            Assert::AreEqual(1ull, (unsigned long long)Pacer.GetMissedDeadlineCount());
+            Assert::AreEqual(1.0 / 30.0, (double)Pacer.GetFrameTime(), 1e-6);
+        }
+
+        TEST_METHOD(UnlimitedFramesDontWait)
+        {
+            VirtualClock Clock;
+            FramePacer Pacer(Clock);
+            for (int i = 0; i < 10; ++i)
+            {
+                Clock.Work(3.0f);
+                Pacer.EndFrame();
+                Assert::AreEqual(0.003, (double)Pacer.GetFrameTime(), 1e-6);
+            }
+            Assert::AreEqual(0ll, (long long)(Pacer.GetSleepTicks() + Pacer.GetSpinTicks()));
+        }
+
+        TEST_METHOD(FixedStepsAreExact)
+        {
+            // However the time is split into frames, the steps run are the whole steps that have elapsed
+            for (uint64_t Seed = 0; Seed < 3; ++Seed)
+            {
+                VirtualClock Clock;
+                FramePacer Pacer(Clock);
+                Pacer.SetFixedUpdateRate(60, 1000);
+                Math::RandomNumberGenerator Rand(Seed);
+
+                const int64_t StartTick = Clock.GetCurrentTick();
+                uint64_t NumSteps = 0;
+                while (Clock.GetCurrentTick() - StartTick < 60 * kTicksPerSecond)
+                {
+                    Clock.Work(Rand.NextFloat(1.0f, 40.0f));
+                    Pacer.EndFrame();
+                    NumSteps += Pacer.GetNumFixedSteps();
+
+                    const float Interpolation = Pacer.GetInterpolation();
+                    Assert::IsTrue(Interpolation >= 0.0f && Interpolation < 1.0f);
+                }
+
+                const int64_t Elapsed = Clock.GetCurrentTick() - StartTick;
+                Assert::AreEqual((unsigned long long)(Elapsed * 60 / kTicksPerSecond), (unsigned long long)NumSteps);
+                Assert::AreEqual((double)(Elapsed * 60 % kTicksPerSecond) / kTicksPerSecond, (double)Pacer.GetInterpolation(), 1e-6);
+            }
+        }
+
+        TEST_METHOD(OneStepPerFrameInLockstep)
+        {
+            VirtualClock Clock;
+            FramePacer Pacer(Clock);
+            Pacer.SetTargetFrameRate(60.0f);
+            Pacer.SetFixedUpdateRate(60, 4);
+            Pacer.EndFrame();
+
+            // The target frame time is rounded to a tick, so a step is dropped or doubled at most once in 10000 frames
+            Math::RandomNumberGenerator Rand(2);
+            uint32_t OffByOne = 0;
+            for (int i = 0; i < 6000; ++i)
+            {
+                Clock.Work(Rand.NextFloat(2.0f, 14.0f));
+                Pacer.EndFrame();
+                OffByOne += Pacer.GetNumFixedSteps() == 1 ? 0 : 1;
+            }
+            Assert::IsTrue(OffByOne <= 1);
+        }
+
+        TEST_METHOD(StepsPastTheMaximumAreDropped)
+        {
+            VirtualClock Clock;
+            FramePacer Pacer(Clock);
+            Pacer.SetFixedUpdateRate(60, 4);
+
+            Clock.Work(1000.0f);
+            Pacer.EndFrame();
+            Assert::AreEqual(4u, Pacer.GetNumFixedSteps());
+
+            // The simulation doesn't try to catch up on the dropped time
+            Clock.Work(20.0f);
+            Pacer.EndFrame();
+            Assert::AreEqual(1u, Pacer.GetNumFixedSteps());
+        }
+
+        TEST_METHOD(ChangingTheStepRateKeepsTime)
+        {
+            VirtualClock Clock;
+            FramePacer Pacer(Clock);
+            Pacer.SetFixedUpdateRate(60, 4);
+
+            // Half of a 60 Hz step is a whole 120 Hz one
+            Clock.Work(25.0f);
+            Pacer.EndFrame();
+            Assert::AreEqual(1u, Pacer.GetNumFixedSteps());
+            Assert::AreEqual(0.5, (double)Pacer.GetInterpolation(), 1e-6);
+
+            Pacer.SetFixedUpdateRate(120, 4);
+            Pacer.EndFrame();
+            Assert::AreEqual(1u, Pacer.GetNumFixedSteps());
+            Assert::AreEqual(0.0, (double)Pacer.GetInterpolation(), 1e-6);
+        }
+
+        TEST_METHOD(Statistics)
+        {
+            VirtualClock Clock;
+            FramePacer Pacer(Clock);
+            for (int i = 0; i < 100; ++i)
+            {
+                Clock.Work(i % 20 == 19 ? 20.0f : 10.0f);
+                Pacer.EndFrame();
+            }
+
+            FrameStats Stats = Pacer.GetStats();
+            Assert::AreEqual(100u, Stats.NumFrames);
+            Assert::AreEqual(10.5f, Stats.Average, 1e-3f);
+            Assert::AreEqual(10.0f, Stats.Median, 1e-3f);
+            Assert::AreEqual(10.0f, Stats.Percentile90, 1e-3f);
+            Assert::AreEqual(20.0f, Stats.Percentile99, 1e-3f);
+            Assert::AreEqual(20.0f, Stats.Max, 1e-3f);
+            Assert::AreEqual(5u, Stats.StutterCount);
+
+            // Only the most recent frames are kept
+            for (int i = 0; i < FramePacer::kMaxStatFrames; ++i)
+            {
+                Clock.Work(8.0f);
+                Pacer.EndFrame();
+            }
+            Stats = Pacer.GetStats();
+            Assert::AreEqual((uint32_t)FramePacer::kMaxStatFrames, Stats.NumFrames);
+            Assert::AreEqual(8.0f, Stats.Max, 1e-3f);
+            Assert::AreEqual(0u, Stats.StutterCount);
+        }
+    };
+}
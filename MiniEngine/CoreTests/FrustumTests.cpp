@@ -0,0 +1,222 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Checks that Frustum::IntersectBoundingBoxes() and IntersectSpheres() give the same answer as the
+// scalar tests with the SSE, AVX and AVX-512 kernels, for every count up to a few groups past a mask, and measures
+// each kernel on a million boxes.  Kernels the CPU doesn't support are skipped.
+//
+
+#include "stdafx.h"
+#include "Camera.h"
+#include "ShadowCamera.h"
+#include "Math/Random.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Math;
+using namespace GameCore;
+
+namespace
+{
+    const Frustum::SimdLevel kSimdLevels[] = { Frustum::kSSE, Frustum::kAVX, Frustum::kAVX512 };
+    const char* const kSimdLevelNames[] = { "SSE", "AVX", "AVX-512" };
+
+    // Puts back the level the CPU picked when a test ends, however it ends
+    struct ScopedSimdLevel
+    {
+        Frustum::SimdLevel Saved;
+        ScopedSimdLevel() : Saved(Frustum::GetBatchSimdLevel()) {}
+        ~ScopedSimdLevel() { Frustum::SetBatchSimdLevel(Saved); }
+    };
+
+    // A perspective view looking down all three axes at once, so that the planes' normals have mixed signs, and an
+    // orthographic shadow view of the same region
+    std::vector<Frustum> TestFrusta( void )
+    {
+        Camera ViewCamera;
+        ViewCamera.SetEyeAtUp(Vector3(10.0f, 20.0f, 30.0f), Vector3(0.0f, 0.0f, 0.0f), Vector3(kYUnitVector));
+        ViewCamera.SetZRange(1.0f, 100.0f);
+        ViewCamera.Update();
+
+        ShadowCamera SunCamera;
+        SunCamera.UpdateMatrix(Normalize(Vector3(-0.3f, -1.0f, 0.2f)), Vector3(0.0f, -30.0f, 0.0f),
+            Vector3(80.0f, 60.0f, 90.0f), 1024, 1024, 16);
+
+        return std::vector<Frustum>{ ViewCamera.GetWorldSpaceFrustum(), SunCamera.GetWorldSpaceFrustum() };
+    }
+
+    // Boxes from -60 to 60 on each axis as a structure of arrays, and spheres centered on their min corners.  Many
+    // straddle a plane of the test frusta, and a few have NaN coordinates, which no test rejects.
+    struct Objects
+    {
+        std::vector<float> Min[3], Max[3];
+        std::vector<float> Radius;
+
+        Objects( uint32_t Count, uint64_t Seed )
+        {
+            RandomNumberGenerator Rand(Seed);
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                Min[Axis].resize(Count);
+                Max[Axis].resize(Count);
+            }
+            Radius.resize(Count);
+
+            for (uint32_t i = 0; i < Count; ++i)
+            {
+                const float HalfSize = Rand.NextFloat(0.0f, 8.0f);
+                for (int Axis = 0; Axis < 3; ++Axis)
+                {
+                    const float Center = Rand.NextFloat(-60.0f, 60.0f);
+                    Min[Axis][i] = Center - HalfSize * Rand.NextFloat(0.0f, 1.0f);
+                    Max[Axis][i] = Center + HalfSize * Rand.NextFloat(0.0f, 1.0f);
+                }
+                Radius[i] = HalfSize;
+            }
+
+            for (uint32_t i = 61; i < Count; i += 97)
+                Min[i % 3][i] = Max[i % 3][i] = std::numeric_limits<float>::quiet_NaN();
+        }
+
+        bool ScalarBox( const Frustum& F, uint32_t i ) const
+        {
+            return F.IntersectBoundingBox(Vector3(Min[0][i], Min[1][i], Min[2][i]), Vector3(Max[0][i], Max[1][i], Max[2][i]));
+        }
+
+        bool ScalarSphere( const Frustum& F, uint32_t i ) const
+        {
+            return F.IntersectSphere(BoundingSphere(Vector3(Min[0][i], Min[1][i], Min[2][i]), Radius[i]));
+        }
+
+        // Masks for the first Count objects, followed by a sentinel that must be left alone
+        std::vector<uint32_t> BatchBoxes( const Frustum& F, uint32_t Count ) const
+        {
+            std::vector<uint32_t> Masks((Count + 31) / 32 + 1, 0xA5A5A5A5u);
+            F.IntersectBoundingBoxes(Min[0].data(), Min[1].data(), Min[2].data(), Max[0].data(), Max[1].data(), Max[2].data(),
+                Count, Masks.data());
+            return Masks;
+        }
+
+        std::vector<uint32_t> BatchSpheres( const Frustum& F, uint32_t Count ) const
+        {
+            std::vector<uint32_t> Masks((Count + 31) / 32 + 1, 0xA5A5A5A5u);
+            F.IntersectSpheres(Min[0].data(), Min[1].data(), Min[2].data(), Radius.data(), Count, Masks.data());
+            return Masks;
+        }
+    };
+
+    template <typename ScalarTest>
+    void CheckMasks( const std::vector<uint32_t>& Masks, uint32_t Count, ScalarTest Scalar, const wchar_t* Message )
+    {
+        Assert::AreEqual(0xA5A5A5A5u, Masks.back(), L"Nothing is written past the last mask");
+        for (uint32_t i = 0; i < Count; ++i)
+            Assert::AreEqual(Scalar(i), (Masks[i / 32] >> (i % 32) & 1) != 0, Message);
+        if (Count % 32 != 0)
+            Assert::AreEqual(0u, Masks[Count / 32] >> (Count % 32), L"Unused bits of the last mask are cleared");
+    }
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(FrustumTests)
+    {
+    public:
+
+        TEST_METHOD(BatchMatchesScalar)
+        {
+            ScopedSimdLevel RestoreLevel;
+            const std::vector<Frustum> Frusta = TestFrusta();
+            const Objects Scene(4096, 36);
+
+            for (size_t Level = 0; Level < _countof(kSimdLevels); ++Level)
+            {
+                Frustum::SetBatchSimdLevel(kSimdLevels[Level]);
+                if (Frustum::GetBatchSimdLevel() != kSimdLevels[Level])
+                {
+                    LogMessage("%s isn't supported, skipped", kSimdLevelNames[Level]);
+                    continue;
+                }
+
+                for (const Frustum& F : Frusta)
+                {
+                    uint32_t Visible = 0;
+                    for (uint32_t i = 0; i < 4096; ++i)
+                        Visible += Scene.ScalarBox(F, i);
+                    Assert::IsTrue(Visible > 200 && Visible < 3900, L"The scene straddles the frustum");
+
+                    // Every partial group and final mask, then whole groups and masks with a remainder
+                    for (uint32_t Count = 0; Count <= 100; ++Count)
+                    {
+                        CheckMasks(Scene.BatchBoxes(F, Count), Count, [&]( uint32_t i ) { return Scene.ScalarBox(F, i); }, L"Boxes match the scalar test");
+                        CheckMasks(Scene.BatchSpheres(F, Count), Count, [&]( uint32_t i ) { return Scene.ScalarSphere(F, i); }, L"Spheres match the scalar test");
+                    }
+                    for (uint32_t Count : { 4093u, 4096u })
+                    {
+                        CheckMasks(Scene.BatchBoxes(F, Count), Count, [&]( uint32_t i ) { return Scene.ScalarBox(F, i); }, L"Boxes match the scalar test");
+                        CheckMasks(Scene.BatchSpheres(F, Count), Count, [&]( uint32_t i ) { return Scene.ScalarSphere(F, i); }, L"Spheres match the scalar test");
+                    }
+                }
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(BatchCullingTime)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(BatchCullingTime)
+        {
+            // A million boxes against the view frustum, best of 5 runs with each kernel and with the scalar test
+            ScopedSimdLevel RestoreLevel;
+            const Frustum ViewFrustum = TestFrusta()[0];
+            const uint32_t NumBoxes = 1 << 20;
+            const Objects Scene(NumBoxes, 37);
+            std::vector<uint32_t> Masks(NumBoxes / 32);
+
+            double BestTime = 1e9;
+            for (uint32_t Run = 0; Run < 5; ++Run)
+            {
+                const double Start = BenchmarkTime();
+                for (uint32_t i = 0; i < NumBoxes; i += 32)
+                {
+                    uint32_t Mask = 0;
+                    for (uint32_t Bit = 0; Bit < 32; ++Bit)
+                        Mask |= (uint32_t)Scene.ScalarBox(ViewFrustum, i + Bit) << Bit;
+                    Masks[i / 32] = Mask;
+                }
+                BestTime = std::min(BestTime, BenchmarkTime() - Start);
+            }
+            LogMessage("Scalar:  %.2f ms, %.0f M boxes/s", BestTime * 1000.0, NumBoxes / BestTime / 1e6);
+            const std::vector<uint32_t> Expected = Masks;
+
+            for (size_t Level = 0; Level < _countof(kSimdLevels); ++Level)
+            {
+                Frustum::SetBatchSimdLevel(kSimdLevels[Level]);
+                if (Frustum::GetBatchSimdLevel() != kSimdLevels[Level])
+                {
+                    LogMessage("%s isn't supported, skipped", kSimdLevelNames[Level]);
+                    continue;
+                }
+
+                BestTime = 1e9;
+                for (uint32_t Run = 0; Run < 5; ++Run)
+                {
+                    const double Start = BenchmarkTime();
+                    ViewFrustum.IntersectBoundingBoxes(Scene.Min[0].data(), Scene.Min[1].data(), Scene.Min[2].data(),
+                        Scene.Max[0].data(), Scene.Max[1].data(), Scene.Max[2].data(), NumBoxes, Masks.data());
+                    BestTime = std::min(BestTime, BenchmarkTime() - Start);
+                }
+                LogMessage("%s:  %.2f ms, %.0f M boxes/s", kSimdLevelNames[Level], BestTime * 1000.0, NumBoxes / BestTime / 1e6);
+                Assert::IsTrue(Expected == Masks, L"The kernel culls the same boxes as the scalar test");
+            }
+        }
+    };
+}
@@ -0,0 +1,215 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Checks that HashRange() is the CRC32C of its range for every alignment and length, whichever kernel
+// the CPU picked, counts its collisions on pipeline state-like descs and random keys, and measures its throughput
+// against the FNV loop it replaced.
+//
+
+#include "stdafx.h"
+#include "Hash.h"
+#include "Math/Random.h"
+#include <unordered_set>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    // CRC32C a bit at a time, without the initial and final inversions
+    uint32_t ReferenceCrc32c( const uint32_t* Begin, const uint32_t* End, uint32_t Crc )
+    {
+        for (const uint8_t* Byte = (const uint8_t*)Begin; Byte < (const uint8_t*)End; ++Byte)
+        {
+            Crc ^= *Byte;
+            for (int i = 0; i < 8; ++i)
+                Crc = Crc & 1 ? (Crc >> 1) ^ 0x82F63B78 : Crc >> 1;
+        }
+        return Crc;
+    }
+
+    // The hash HashRange() used before, on CPUs without SSE4.2
+    size_t FnvHashRange( const uint32_t* Begin, const uint32_t* End, size_t Hash )
+    {
+        for (const uint32_t* Iter = Begin; Iter < End; ++Iter)
+            Hash = 16777619U * Hash ^ *Iter;
+        return Hash;
+    }
+
+    // The collisions a random 32-bit hash is expected to have among Count keys
+    double ExpectedCollisions( size_t Count )
+    {
+        return (double)Count * (Count - 1) / 2.0 / 4294967296.0;
+    }
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(HashTests)
+    {
+    public:
+
+        TEST_METHOD(KnownValues)
+        {
+            // The iSCSI test vectors of RFC 3720, which invert the CRC before and after
+            uint32_t Data[8];
+            for (uint32_t& Word : Data)
+                Word = 0;
+            Assert::AreEqual(0x8A9136AAu, ~(uint32_t)Utility::HashRange(Data, Data + 8, 0xFFFFFFFF));
+
+            for (uint32_t& Word : Data)
+                Word = 0xFFFFFFFF;
+            Assert::AreEqual(0x62A8AB43u, ~(uint32_t)Utility::HashRange(Data, Data + 8, 0xFFFFFFFF));
+
+            uint8_t* Bytes = (uint8_t*)Data;
+            for (uint32_t i = 0; i < 32; ++i)
+                Bytes[i] = (uint8_t)i;
+            Assert::AreEqual(0x46DD794Eu, ~(uint32_t)Utility::HashRange(Data, Data + 8, 0xFFFFFFFF));
+
+            // An empty range is its seed
+            Assert::AreEqual((size_t)2166136261U, Utility::HashRange(Data, Data, 2166136261U));
+        }
+
+        TEST_METHOD(MatchesReferenceAtAnyAlignment)
+        {
+            // Lengths reach past the 3 KB rounds of long blocks and the 192 B rounds of short ones, from every
+            // alignment of the start and end to 8 bytes
+            Math::RandomNumberGenerator Rand(5);
+            std::vector<uint32_t> Buffer(8192);
+            for (uint32_t& Word : Buffer)
+                Word = Rand.NextUint();
+
+            uint32_t NumRanges = 0;
+            for (uint32_t Offset = 0; Offset < 4; ++Offset)
+            {
+                for (uint32_t Length = 0; Length < 2000; Length += Length < 100 ? 1 : 37)
+                {
+                    const uint32_t* Begin = Buffer.data() + Offset;
+                    const uint32_t Seed = Length & 1 ? 2166136261U : Rand.NextUint();
+                    Assert::AreEqual((size_t)ReferenceCrc32c(Begin, Begin + Length, Seed), Utility::HashRange(Begin, Begin + Length, Seed));
+                    ++NumRanges;
+                }
+            }
+
+            const uint32_t* Begin = Buffer.data() + 1;
+            const uint32_t* End = Buffer.data() + Buffer.size();
+            Assert::AreEqual((size_t)ReferenceCrc32c(Begin, End, 7), Utility::HashRange(Begin, End, 7));
+            LogMessage("%u ranges match the bitwise CRC32C", NumRanges + 1);
+        }
+
+        TEST_METHOD(HashStateChains)
+        {
+            // Hashing an array is hashing its elements in turn
+            struct Desc { uint32_t A, B, C; };
+            const Desc Descs[3] = { { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } };
+
+            size_t Hash = Utility::HashState(Descs);
+            Hash = Utility::HashState(Descs + 1, 2, Hash);
+            Assert::AreEqual(Utility::HashState(Descs, 3), Hash);
+        }
+
+        TEST_METHOD(StructuredDescCollisions)
+        {
+            // A 656 byte desc, like a graphics pipeline state desc, where a few fields take small values:  formats,
+            // bit masks, counts and flags.  CRCs of inputs that differ in under 32 bits can't collide.
+            std::vector<uint32_t> Desc(164, 0);
+            Desc[0] = 0x1234;
+            Desc[1] = 0x7FF6;
+
+            std::unordered_set<uint32_t> Crc, Fnv;
+            size_t NumDescs = 0;
+            for (uint32_t a = 0; a < 64; ++a)
+            {
+                for (uint32_t b = 0; b < 32; ++b)
+                {
+                    for (uint32_t c = 0; c < 16; ++c)
+                    {
+                        for (uint32_t d = 0; d < 32; ++d)
+                        {
+                            Desc[10] = a;
+                            Desc[40] = b * 0x10001;
+                            Desc[90] = 1u << c;
+                            Desc[120] = d;
+                            Desc[121] = (d * 7) & 15;
+                            Desc[163] = a ^ d;
+                            Crc.insert((uint32_t)Utility::HashRange(Desc.data(), Desc.data() + Desc.size(), 2166136261U));
+                            Fnv.insert((uint32_t)FnvHashRange(Desc.data(), Desc.data() + Desc.size(), 2166136261U));
+                            ++NumDescs;
+                        }
+                    }
+                }
+            }
+
+            LogMessage("%zu descs:  %zu CRC32C collisions, %zu FNV collisions in 32 bits, %.1f expected of a random hash",
+                NumDescs, NumDescs - Crc.size(), NumDescs - Fnv.size(), ExpectedCollisions(NumDescs));
+            Assert::AreEqual(NumDescs, Crc.size());
+        }
+
+        TEST_METHOD(RandomKeyCollisions)
+        {
+            Math::RandomNumberGenerator Rand(9);
+            const size_t NumKeys = 1000000;
+            uint32_t Key[16];
+
+            std::unordered_set<uint32_t> Hashes;
+            Hashes.reserve(NumKeys);
+            for (size_t i = 0; i < NumKeys; ++i)
+            {
+                for (uint32_t& Word : Key)
+                    Word = Rand.NextUint();
+                Hashes.insert((uint32_t)Utility::HashRange(Key, Key + 16, 2166136261U));
+            }
+
+            // Within four standard deviations of a random hash, whose collisions are about Poisson distributed
+            const double Expected = ExpectedCollisions(NumKeys);
+            const size_t Collisions = NumKeys - Hashes.size();
+            LogMessage("%zu random 64 B keys:  %zu collisions, %.1f expected", NumKeys, Collisions, Expected);
+            Assert::IsTrue(std::fabs((double)Collisions - Expected) < 4.0 * std::sqrt(Expected));
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Throughput)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(Throughput)
+        {
+            Math::RandomNumberGenerator Rand(1);
+            std::vector<uint32_t> Buffer(16384);
+            for (uint32_t& Word : Buffer)
+                Word = Rand.NextUint();
+
+            LogMessage("%8s %12s %12s", "Bytes", "HashRange", "FNV");
+            size_t Hash = 0;
+            const size_t Sizes[] = { 16, 64, 256, 656, 1024, 4096, 65536 };
+            for (size_t Bytes : Sizes)
+            {
+                const uint32_t* Begin = Buffer.data();
+                const uint32_t* End = Begin + Bytes / 4;
+                const size_t Iterations = 200000000 / (Bytes < 64 ? 64 : Bytes);
+
+                // Each hash seeds the next, so that calls can't overlap
+                double Start = BenchmarkTime();
+                for (size_t i = 0; i < Iterations; ++i)
+                    Hash = Utility::HashRange(Begin, End, Hash);
+                const double CrcTime = BenchmarkTime() - Start;
+
+                Start = BenchmarkTime();
+                for (size_t i = 0; i < Iterations; ++i)
+                    Hash = FnvHashRange(Begin, End, Hash);
+                const double FnvTime = BenchmarkTime() - Start;
+
+                LogMessage("%8zu %7.2f GB/s %7.2f GB/s", Bytes, Bytes * Iterations / CrcTime * 1e-9,
+                    Bytes * Iterations / FnvTime * 1e-9);
+            }
+
+            // Keeps the loops from being optimized away
+            Assert::IsTrue(Hash != 1);
+        }
+    };
+}
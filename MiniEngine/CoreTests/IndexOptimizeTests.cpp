@@ -0,0 +1,302 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Checks that ModelConverter's OptimizeFaces() reorders the faces it is given without changing them,
+// whichever way it ranks the vertices, lowers the cache misses of scrambled meshes, and doesn't carry anything over
+// from one call to the next in its per-thread scratch memory.  Measures it on 65K and 1M triangle meshes.
+//
+
+#include "stdafx.h"
+#include "../ModelConverter/IndexOptimizePostTransform.h"
+#include "Math/Random.h"
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    // Two triangles per quad of a Width x Height vertex grid, in row order
+    std::vector<uint32_t> GridIndices( uint32_t Width, uint32_t Height )
+    {
+        std::vector<uint32_t> Indices;
+        Indices.reserve((size_t)(Width - 1) * (Height - 1) * 6);
+        for (uint32_t y = 0; y + 1 < Height; ++y)
+        {
+            for (uint32_t x = 0; x + 1 < Width; ++x)
+            {
+                const uint32_t i0 = y * Width + x, i1 = i0 + 1, i2 = i0 + Width, i3 = i2 + 1;
+                Indices.insert(Indices.end(), { i0, i1, i2, i1, i3, i2 });
+            }
+        }
+        return Indices;
+    }
+
+    // Triangles of random vertices, which include degenerate ones
+    std::vector<uint32_t> RandomIndices( uint32_t NumVertices, uint32_t NumFaces, Math::RandomNumberGenerator& Rand )
+    {
+        std::vector<uint32_t> Indices(NumFaces * 3);
+        for (uint32_t& Index : Indices)
+            Index = (uint32_t)Rand.NextInt(NumVertices - 1);
+        return Indices;
+    }
+
+    // The same faces, in a random order
+    std::vector<uint32_t> ShuffleFaces( const std::vector<uint32_t>& Indices, Math::RandomNumberGenerator& Rand )
+    {
+        const uint32_t NumFaces = (uint32_t)Indices.size() / 3;
+        std::vector<uint32_t> Order(NumFaces);
+        for (uint32_t f = 0; f < NumFaces; ++f)
+            Order[f] = f;
+        for (uint32_t f = NumFaces; f > 1; --f)
+            std::swap(Order[f - 1], Order[Rand.NextInt(f - 1)]);
+
+        std::vector<uint32_t> Shuffled;
+        Shuffled.reserve(Indices.size());
+        for (uint32_t f : Order)
+            Shuffled.insert(Shuffled.end(), Indices.begin() + f * 3, Indices.begin() + f * 3 + 3);
+        return Shuffled;
+    }
+
+    template <typename IndexType>
+    std::vector<IndexType> ConvertIndices( const std::vector<uint32_t>& Indices )
+    {
+        std::vector<IndexType> Converted(Indices.size());
+        for (size_t i = 0; i < Indices.size(); ++i)
+            Converted[i] = (IndexType)Indices[i];
+        return Converted;
+    }
+
+    template <typename IndexType>
+    std::vector<IndexType> Optimize( const std::vector<uint32_t>& Indices, uint16_t CacheSize )
+    {
+        std::vector<IndexType> Input = ConvertIndices<IndexType>(Indices);
+        std::vector<IndexType> Output(Input.size());
+        OptimizeFaces<IndexType>(Input.data(), (uint32_t)Input.size(), Output.data(), CacheSize);
+        return Output;
+    }
+
+    // The faces of an index list, each with its corners in their original order, sorted
+    template <typename IndexType>
+    std::vector<std::array<uint32_t, 3>> SortedFaces( const std::vector<IndexType>& Indices )
+    {
+        std::vector<std::array<uint32_t, 3>> Faces(Indices.size() / 3);
+        for (size_t f = 0; f < Faces.size(); ++f)
+            Faces[f] = { Indices[f * 3], Indices[f * 3 + 1], Indices[f * 3 + 2] };
+        std::sort(Faces.begin(), Faces.end());
+        return Faces;
+    }
+
+    // Vertex transforms per triangle (ACMR) with an LRU post-transform cache of CacheSize vertices
+    template <typename IndexType>
+    double CacheMissRatio( const std::vector<IndexType>& Indices, uint32_t CacheSize )
+    {
+        std::vector<uint32_t> Cache;
+        size_t NumMisses = 0;
+        for (IndexType Index : Indices)
+        {
+            auto Iter = std::find(Cache.begin(), Cache.end(), (uint32_t)Index);
+            if (Iter != Cache.end())
+                Cache.erase(Iter);
+            else
+                ++NumMisses;
+            Cache.insert(Cache.begin(), (uint32_t)Index);
+            if (Cache.size() > CacheSize)
+                Cache.pop_back();
+        }
+        return (double)NumMisses / (Indices.size() / 3);
+    }
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(IndexOptimizeTests)
+    {
+    public:
+
+        TEST_METHOD(KeepsEveryFace)
+        {
+            // Ordered and shuffled grids, triangle soups with degenerate faces, and index ranges sparse enough to be
+            // ranked with the radix sort instead of the direct table
+            Math::RandomNumberGenerator Rand(35);
+            const uint16_t CacheSizes[] = { 16, 32, 64 };
+            uint32_t NumMeshes = 0;
+            for (uint32_t i = 0; i < 120; ++i)
+            {
+                std::vector<uint32_t> Indices;
+                if (i % 3 == 2)
+                    Indices = RandomIndices(3 + Rand.NextInt(400), 1 + Rand.NextInt(2000), Rand);
+                else
+                    Indices = GridIndices(2 + Rand.NextInt(100), 2 + Rand.NextInt(100));
+                if (i % 3 == 1)
+                    Indices = ShuffleFaces(Indices, Rand);
+                if (i % 4 == 3)
+                {
+                    for (uint32_t& Index : Indices)
+                        Index = Index * 3 + 11;
+                }
+
+                const uint16_t CacheSize = CacheSizes[i % 3];
+                const auto Expected = SortedFaces(Indices);
+                Assert::IsTrue(Expected == SortedFaces(Optimize<uint32_t>(Indices, CacheSize)), L"32-bit output has the input faces");
+                if (*std::max_element(Indices.begin(), Indices.end()) < 0xFFFF)
+                    Assert::IsTrue(Expected == SortedFaces(Optimize<uint16_t>(Indices, CacheSize)), L"16-bit output has the input faces");
+                ++NumMeshes;
+            }
+            LogMessage("%u meshes keep their faces", NumMeshes);
+        }
+
+        TEST_METHOD(RankingDoesntChangeTheOrder)
+        {
+            // Vertices are numbered by the rank of their index, so spreading the index values out (which switches
+            // from the direct table to the radix sort) or storing them in 16 bits must give the same face order
+            Math::RandomNumberGenerator Rand(36);
+            const std::vector<uint32_t> Meshes[] =
+            {
+                GridIndices(60, 40),
+                ShuffleFaces(GridIndices(90, 70), Rand),
+                RandomIndices(500, 3000, Rand),
+            };
+            for (const std::vector<uint32_t>& Indices : Meshes)
+            {
+                const std::vector<uint32_t> Dense = Optimize<uint32_t>(Indices, 32);
+                Assert::IsTrue(Dense == Optimize<uint32_t>(Indices, 32), L"Output is deterministic");
+
+                const std::vector<uint16_t> Narrow = Optimize<uint16_t>(Indices, 32);
+                Assert::IsTrue(std::equal(Dense.begin(), Dense.end(), Narrow.begin()), L"16-bit indices give the same order");
+
+                for (uint32_t Scale : { 7u, 65537u })
+                {
+                    std::vector<uint32_t> Sparse = Indices;
+                    for (uint32_t& Index : Sparse)
+                        Index = Index * Scale + 1000;
+                    const std::vector<uint32_t> SparseResult = Optimize<uint32_t>(Sparse, 32);
+                    for (size_t i = 0; i < Dense.size(); ++i)
+                        Assert::AreEqual(Dense[i] * Scale + 1000, SparseResult[i], L"Sparse indices give the same order");
+                }
+            }
+        }
+
+        TEST_METHOD(LowersCacheMisses)
+        {
+            // A shuffled grid misses on nearly every corner; the optimized order has to beat the row order, which
+            // only reuses the previous row while it fits in the cache
+            Math::RandomNumberGenerator Rand(37);
+            const std::vector<uint32_t> Grid = GridIndices(128, 128);
+            const std::vector<uint32_t> Shuffled = ShuffleFaces(Grid, Rand);
+            const uint16_t CacheSizes[] = { 16, 32 };
+            for (uint16_t CacheSize : CacheSizes)
+            {
+                const double Before = CacheMissRatio(Shuffled, CacheSize);
+                const double RowOrder = CacheMissRatio(Grid, CacheSize);
+                const double After = CacheMissRatio(Optimize<uint32_t>(Shuffled, CacheSize), CacheSize);
+                LogMessage("Cache of %u: ACMR %.3f shuffled, %.3f in row order, %.3f optimized", CacheSize, Before, RowOrder, After);
+                Assert::IsTrue(After < RowOrder, L"Beats the row order");
+                Assert::IsTrue(After < 0.5 * Before, L"Halves the misses of the shuffled grid");
+            }
+        }
+
+        TEST_METHOD(SmallAndDegenerateInputs)
+        {
+            // An empty list leaves the output alone
+            uint16_t Untouched = 0xABCD;
+            OptimizeFaces<uint16_t>(nullptr, 0, &Untouched, 32);
+            Assert::AreEqual((uint16_t)0xABCD, Untouched);
+
+            const std::vector<uint32_t> OneFace = { 5, 9, 7 };
+            Assert::IsTrue(OneFace == Optimize<uint32_t>(OneFace, 32), L"A single face is kept as it is");
+
+            const std::vector<uint32_t> Degenerate = { 3, 3, 3, 3, 3, 4, 4, 3, 3 };
+            Assert::IsTrue(SortedFaces(Degenerate) == SortedFaces(Optimize<uint32_t>(Degenerate, 32)), L"Degenerate faces are kept");
+
+            // The largest index of each type, which the sparse path has to rank like any other
+            const std::vector<uint32_t> Extremes = { 0, 0xFFFF, 1, 0xFFFF, 0, 2 };
+            Assert::IsTrue(SortedFaces(Extremes) == SortedFaces(Optimize<uint16_t>(Extremes, 32)), L"0xFFFF is an index like any other");
+            const std::vector<uint32_t> Extremes32 = { 0, 0xFFFFFFFF, 1, 0xFFFFFFFF, 0, 2 };
+            Assert::IsTrue(SortedFaces(Extremes32) == SortedFaces(Optimize<uint32_t>(Extremes32, 32)), L"0xFFFFFFFF is an index like any other");
+        }
+
+        TEST_METHOD(ScratchMemoryIsReused)
+        {
+            // The scratch memory is kept per thread.  A smaller mesh after a larger one, and a mesh of the other
+            // index type, mustn't see what the previous call left, and threads mustn't share it.
+            Math::RandomNumberGenerator Rand(38);
+            const std::vector<uint32_t> Large = ShuffleFaces(GridIndices(200, 150), Rand);
+            const std::vector<uint32_t> Small = RandomIndices(50, 200, Rand);
+
+            const std::vector<uint32_t> LargeResult = Optimize<uint32_t>(Large, 32);
+            const std::vector<uint32_t> SmallResult = Optimize<uint32_t>(Small, 32);
+            const std::vector<uint16_t> SmallResult16 = Optimize<uint16_t>(Small, 32);
+            Assert::IsTrue(LargeResult == Optimize<uint32_t>(Large, 32), L"A large mesh after a small one");
+            Assert::IsTrue(SmallResult == Optimize<uint32_t>(Small, 32), L"A small mesh after a large one");
+            Assert::IsTrue(std::equal(SmallResult.begin(), SmallResult.end(), SmallResult16.begin()), L"16 and 32-bit scratch memory are separate");
+
+            std::vector<uint32_t> ThreadResults[4];
+            std::thread Threads[4];
+            for (uint32_t t = 0; t < 4; ++t)
+            {
+                Threads[t] = std::thread([&, t]()
+                {
+                    for (uint32_t i = 0; i < 3; ++i)
+                        ThreadResults[t] = Optimize<uint32_t>((t + i) & 1 ? Small : Large, 32);
+                });
+            }
+            for (std::thread& Thread : Threads)
+                Thread.join();
+            for (uint32_t t = 0; t < 4; ++t)
+                Assert::IsTrue(ThreadResults[t] == (t & 1 ? SmallResult : LargeResult), L"Threads don't share scratch memory");
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(OptimizeTime)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(OptimizeTime)
+        {
+            // The sizes ModelConverter sees:  a 65K triangle mesh with 16-bit indices, and a 1M triangle one with
+            // 32-bit indices in scan order and scrambled.  Best of 5 runs, with a cache of 32 like the converter's
+            // default.
+            Math::RandomNumberGenerator Rand(39);
+            const std::vector<uint32_t> Small = ShuffleFaces(GridIndices(182, 182), Rand);
+            const std::vector<uint32_t> Large = GridIndices(708, 708);
+            const std::vector<uint32_t> LargeShuffled = ShuffleFaces(Large, Rand);
+
+            struct Case { const char* Name; const std::vector<uint32_t>* Indices; bool Narrow; };
+            const Case Cases[] =
+            {
+                { "16-bit, shuffled", &Small, true },
+                { "32-bit, ordered", &Large, false },
+                { "32-bit, shuffled", &LargeShuffled, false },
+            };
+            for (const Case& Test : Cases)
+            {
+                const std::vector<uint32_t>& Indices = *Test.Indices;
+                std::vector<uint16_t> Input16 = ConvertIndices<uint16_t>(Indices), Output16(Indices.size());
+                std::vector<uint32_t> Output32(Indices.size());
+
+                double BestTime = 1e9;
+                for (uint32_t Run = 0; Run < 5; ++Run)
+                {
+                    const double Start = BenchmarkTime();
+                    if (Test.Narrow)
+                        OptimizeFaces<uint16_t>(Input16.data(), (uint32_t)Indices.size(), Output16.data(), 32);
+                    else
+                        OptimizeFaces<uint32_t>(Indices.data(), (uint32_t)Indices.size(), Output32.data(), 32);
+                    BestTime = std::min(BestTime, BenchmarkTime() - Start);
+                }
+
+                const double Before = CacheMissRatio(Indices, 32);
+                const double After = Test.Narrow ? CacheMissRatio(Output16, 32) : CacheMissRatio(Output32, 32);
+                LogMessage("%zu triangles, %s: %.1f ms, ACMR %.3f -> %.3f", Indices.size() / 3, Test.Name, BestTime * 1000.0, Before, After);
+            }
+        }
+    };
+}
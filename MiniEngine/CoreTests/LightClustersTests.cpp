@@ -0,0 +1,230 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Bins a fixed set of sphere, cone and shadowed cone lights with ModelViewer's LightClusters and checks
+// the light grid and light grid bit mask it writes against a brute force reference, which tests every light against
+// the side planes of every tile and against the box of every froxel, in double precision.
+//
+
+#include "stdafx.h"
+#include "../ModelViewer/LightClusters.h"
+#include "Math/Random.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    const uint32_t kWidth = 1920;
+    const uint32_t kHeight = 1080;
+    const uint32_t kTileDim = 16;
+    const uint32_t kNumSlices = 16;
+    const float kNearClip = 1.0f;
+    const float kFarClip = 10000.0f;
+
+    LightClusters::View MakeView( void )
+    {
+        const float ProjScaleY = 1.0f / std::tan(DirectX::XM_PIDIV4 / 2.0f);
+        LightClusters::View View = { kWidth, kHeight, kTileDim, kNumSlices, ProjScaleY * kHeight / kWidth, ProjScaleY,
+            kNearClip, kFarClip };
+        return View;
+    }
+
+    LightClusters::Light MakeLight( float X, float Y, float Z, float Radius, uint32_t Type )
+    {
+        LightClusters::Light L = { { X, Y, Z }, Radius, Type };
+        return L;
+    }
+
+    // Spread through the view like ModelViewer's random lights, types in the same proportions, followed by lights
+    // at the edges of the view volume.  All of them are in view space, looking down -Z.
+    std::vector<LightClusters::Light> FixedLights( void )
+    {
+        std::vector<LightClusters::Light> Lights;
+
+        Math::RandomNumberGenerator Rand(7);
+        for (uint32_t i = 0; i < 120; ++i)
+        {
+            const float X = Rand.NextFloat(-1500.0f, 1500.0f);
+            const float Y = Rand.NextFloat(-750.0f, 750.0f);
+            const float Z = -Rand.NextFloat(-300.0f, 2700.0f);
+            const float Radius = Rand.NextFloat(200.0f, 1000.0f);
+            Lights.push_back(MakeLight(X, Y, Z, Radius, i < 30 ? 0 : i < 90 ? 1 : 2));
+        }
+
+        Lights.push_back(MakeLight(0.0f, 0.0f, -5.0f, 50.0f, 0));           // Around the camera:  every tile
+        Lights.push_back(MakeLight(0.0f, 0.0f, 500.0f, 100.0f, 1));         // Behind the camera:  no tile
+        Lights.push_back(MakeLight(3.0f, -2.0f, -0.5f, 1.0f, 2));           // Across the near plane
+        Lights.push_back(MakeLight(0.0f, 0.0f, -10500.0f, 200.0f, 0));      // Past the far plane:  no tile
+        Lights.push_back(MakeLight(800.0f, 300.0f, -9950.0f, 200.0f, 1));   // Across the far plane
+        Lights.push_back(MakeLight(-810.0f, 0.0f, -1000.0f, 120.0f, 2));    // Off the left edge, touching it
+        Lights.push_back(MakeLight(0.5f, 0.5f, -5000.0f, 1.0f, 0));         // Small and far, in a few tiles
+        Lights.push_back(MakeLight(0.0f, 2000.0f, -1000.0f, 100.0f, 1));    // Above the view:  no tile
+
+        return Lights;
+    }
+
+    // Tile edges as slopes of X and Y over depth, through pixel corners as the renderer places them
+    double TileSlopeX( const LightClusters::View& View, uint32_t Edge )
+    {
+        const double X = std::min(Edge * View.TileDim, View.Width);
+        return (2.0 * X / View.Width - 1.0) / View.ProjScaleX;
+    }
+
+    double TileSlopeY( const LightClusters::View& View, uint32_t Edge )
+    {
+        const double Y = std::min(Edge * View.TileDim, View.Height);
+        return (1.0 - 2.0 * Y / View.Height) / View.ProjScaleY;
+    }
+
+    double SliceDepth( const LightClusters::View& View, uint32_t Slice )
+    {
+        return View.NearClip * std::pow((double)View.FarClip / View.NearClip, (double)Slice / View.NumSlices);
+    }
+
+    // Whether a light belongs in a tile:  it is inside the four side planes of the tile, as FillLightGridCS tests,
+    // and its sphere touches the box around one of the tile's froxels.  Unsure is set when the answer is within
+    // rounding of the other one, where float and double precision can disagree.
+    bool ReferenceInTile( const LightClusters::View& View, const LightClusters::Light& L, uint32_t TileX, uint32_t TileY,
+        bool& Unsure )
+    {
+        const double X = L.Position[0], Y = L.Position[1], Depth = -L.Position[2], Radius = L.Radius;
+        const double Tolerance = 1e-4 * Radius;
+
+        // Signed distances outside of the planes through the left, right, bottom and top edges
+        const double Left = TileSlopeX(View, TileX), Right = TileSlopeX(View, TileX + 1);
+        const double Top = TileSlopeY(View, TileY), Bottom = TileSlopeY(View, TileY + 1);
+        const double Outside[4] =
+        {
+            (Left * Depth - X) / std::sqrt(1.0 + Left * Left),
+            (X - Right * Depth) / std::sqrt(1.0 + Right * Right),
+            (Bottom * Depth - Y) / std::sqrt(1.0 + Bottom * Bottom),
+            (Y - Top * Depth) / std::sqrt(1.0 + Top * Top)
+        };
+
+        Unsure = false;
+        for (double Distance : Outside)
+        {
+            Unsure |= std::abs(Distance - Radius) < Tolerance;
+            if (Distance > Radius)
+                return false;
+        }
+
+        bool Inside = false;
+        for (uint32_t Slice = 0; Slice < View.NumSlices; ++Slice)
+        {
+            const double NearZ = SliceDepth(View, Slice), FarZ = SliceDepth(View, Slice + 1);
+            const double MinX = std::min(NearZ * Left, FarZ * Left), MaxX = std::max(NearZ * Right, FarZ * Right);
+            const double MinY = std::min(NearZ * Bottom, FarZ * Bottom), MaxY = std::max(NearZ * Top, FarZ * Top);
+
+            const double DX = X - std::min(std::max(X, MinX), MaxX);
+            const double DY = Y - std::min(std::max(Y, MinY), MaxY);
+            const double DZ = Depth - std::min(std::max(Depth, NearZ), FarZ);
+            const double Distance = std::sqrt(DX * DX + DY * DY + DZ * DZ);
+
+            Unsure |= std::abs(Distance - Radius) < Tolerance;
+            Inside |= Distance <= Radius;
+        }
+        return Inside;
+    }
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(LightClustersTests)
+    {
+    public:
+
+        TEST_METHOD(LightGridMatchesBruteForce)
+        {
+            const LightClusters::View View = MakeView();
+            const std::vector<LightClusters::Light> Lights = FixedLights();
+            Assert::AreEqual((size_t)LightClusters::kMaxLights, Lights.size());
+
+            LightClusters Clusters;
+            Clusters.Bin(View, Lights.data(), (uint32_t)Lights.size());
+            Assert::AreEqual((kWidth + kTileDim - 1) / kTileDim, Clusters.GetTileCountX());
+            Assert::AreEqual((kHeight + kTileDim - 1) / kTileDim, Clusters.GetTileCountY());
+
+            // What m_LightGrid and m_LightGridBitMask receive
+            std::vector<uint8_t> LightGrid(Clusters.GetTileCount() * LightClusters::kTileSize);
+            std::vector<uint8_t> LightGridBitMask(Clusters.GetTileCount() * LightClusters::kTileMaskSize);
+            Clusters.WriteLightGrid(LightGrid.data(), LightGridBitMask.data());
+
+            uint32_t NumUnsure = 0, NumPairs = 0;
+            uint32_t TilesPerLight[LightClusters::kMaxLights] = {};
+
+            for (uint32_t TileY = 0; TileY < Clusters.GetTileCountY(); ++TileY)
+            {
+                for (uint32_t TileX = 0; TileX < Clusters.GetTileCountX(); ++TileX)
+                {
+                    const uint32_t TileIndex = TileY * Clusters.GetTileCountX() + TileX;
+                    const uint32_t* Tile = (const uint32_t*)&LightGrid[TileIndex * LightClusters::kTileSize];
+                    const uint32_t* Mask = (const uint32_t*)&LightGridBitMask[TileIndex * LightClusters::kTileMaskSize];
+
+                    // The reference's tile, with the unsure lights taken from the mask
+                    uint32_t ExpectedMask[LightClusters::kMaskWords] = {};
+                    for (uint32_t i = 0; i < Lights.size(); ++i)
+                    {
+                        bool Unsure;
+                        bool Inside = ReferenceInTile(View, Lights[i], TileX, TileY, Unsure);
+                        if (Unsure)
+                        {
+                            ++NumUnsure;
+                            Inside = (Mask[i / 32] >> (i % 32) & 1) != 0;
+                        }
+
+                        if (Inside)
+                        {
+                            ExpectedMask[i / 32] |= 1u << (i % 32);
+                            ++TilesPerLight[i];
+                            ++NumPairs;
+                        }
+                    }
+
+                    for (uint32_t Word = 0; Word < LightClusters::kMaskWords; ++Word)
+                        Assert::AreEqual(ExpectedMask[Word], Mask[Word], L"The bit mask holds the lights of the tile");
+
+                    // The per-type counts in the first word, then the indices grouped by type, in increasing order
+                    uint32_t Expected[1 + LightClusters::kMaxLights] = {};
+                    uint32_t NumIndices = 0;
+                    for (uint32_t Type = 0; Type < 3; ++Type)
+                    {
+                        uint32_t TypeCount = 0;
+                        for (uint32_t i = 0; i < Lights.size(); ++i)
+                        {
+                            if (Lights[i].Type == Type && (ExpectedMask[i / 32] >> (i % 32) & 1) != 0)
+                            {
+                                Expected[1 + NumIndices++] = i;
+                                ++TypeCount;
+                            }
+                        }
+                        Expected[0] |= TypeCount << (Type * 8);
+                    }
+
+                    Assert::AreEqual(Expected[0], Tile[0], L"The first word packs the light counts of the three types");
+                    for (uint32_t i = 1; i <= NumIndices; ++i)
+                        Assert::AreEqual(Expected[i], Tile[i], L"The light indices are grouped by type");
+                }
+            }
+
+            LogMessage("%u tile-light pairs, %u within rounding of the froxel or plane bounds", NumPairs, NumUnsure);
+            Assert::IsTrue(NumUnsure * 1000 < NumPairs, L"Few pairs are left to the binning to decide");
+
+            Assert::AreEqual(Clusters.GetTileCount(), TilesPerLight[120], L"A light around the camera is in every tile");
+            Assert::AreEqual(0u, TilesPerLight[121], L"Lights behind the camera are culled");
+            Assert::IsTrue(TilesPerLight[122] > 0, L"Lights across the near plane are kept");
+            Assert::AreEqual(0u, TilesPerLight[123], L"Lights past the far plane are culled");
+            Assert::IsTrue(TilesPerLight[124] > 0, L"Lights across the far plane are kept");
+            Assert::IsTrue(TilesPerLight[125] > 0, L"Lights off the edge of the view reach the tiles they touch");
+            Assert::IsTrue(TilesPerLight[126] > 0 && TilesPerLight[126] <= 4, L"Small lights are only in the tiles they cover");
+            Assert::AreEqual(0u, TilesPerLight[127], L"Lights above the view are culled");
+        }
+    };
+}
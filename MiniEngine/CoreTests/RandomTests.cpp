@@ -0,0 +1,473 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Reference values, statistical checks and throughput of Math/Random.h and Math/LowDiscrepancy.h.
+// The statistical bounds are at a significance of about 0.1%, but the seeds are fixed, so the tests are
+// deterministic.
+//
+
+#include "stdafx.h"
+#include "Math/Random.h"
+#include "Math/LowDiscrepancy.h"
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Math;
+
+namespace
+{
+    // xoshiro256++ as published by Blackman & Vigna, seeded like Xoshiro256PlusPlus
+    struct ReferenceXoshiro
+    {
+        uint64_t s[4];
+
+        explicit ReferenceXoshiro( uint64_t Seed )
+        {
+            for (int i = 0; i < 4; ++i)
+                s[i] = SplitMix64(Seed);
+        }
+
+        static uint64_t rotl( uint64_t x, int k ) { return (x << k) | (x >> (64 - k)); }
+
+        uint64_t next( void )
+        {
+            const uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+            const uint64_t t = s[1] << 17;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = rotl(s[3], 45);
+            return result;
+        }
+
+        void jump( const uint64_t JUMP[4] )
+        {
+            uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                for (int b = 0; b < 64; b++)
+                {
+                    if (JUMP[i] & (1ull << b))
+                    {
+                        s0 ^= s[0];
+                        s1 ^= s[1];
+                        s2 ^= s[2];
+                        s3 ^= s[3];
+                    }
+                    next();
+                }
+            }
+            s[0] = s0;
+            s[1] = s1;
+            s[2] = s2;
+            s[3] = s3;
+        }
+    };
+
+    const uint64_t kReferenceJump[4] = { 0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull };
+    const uint64_t kReferenceLongJump[4] = { 0x76e15d3efefdcbbfull, 0xc5004e441c522fb3ull, 0x77710069854ee241ull, 0x39109bb02acbe635ull };
+
+    // Pearson's chi-squared statistic of values in [0, 1) sorted into NumBuckets equal buckets
+    double ChiSquared( const std::vector<double>& Values, uint32_t NumBuckets )
+    {
+        std::vector<uint32_t> Histogram(NumBuckets);
+        for (double Value : Values)
+        {
+            const uint32_t Bucket = (uint32_t)(Value * NumBuckets);
+            Assert::IsTrue(Bucket < NumBuckets, L"Value out of [0, 1)");
+            ++Histogram[Bucket];
+        }
+        const double Expected = (double)Values.size() / NumBuckets;
+        double Sum = 0.0;
+        for (uint32_t Count : Histogram)
+            Sum += (Count - Expected) * (Count - Expected) / Expected;
+        return Sum;
+    }
+
+    // True when every one of the N = 2^M points falls in its own cell, for every split of the unit square into
+    // 2^j by 2^(M-j) cells:  the points of dimensions D1 and D2 form a (0,M,2)-net.
+    bool IsNet( uint32_t M, uint32_t D1, uint32_t D2 )
+    {
+        const uint32_t N = 1u << M;
+        for (uint32_t j = 0; j <= M; ++j)
+        {
+            const uint32_t NX = 1u << j, NY = 1u << (M - j);
+            std::vector<uint32_t> Cells(N);
+            for (uint32_t i = 0; i < N; ++i)
+                ++Cells[(uint32_t)(Sobol(i, D1) * NX) * NY + (uint32_t)(Sobol(i, D2) * NY)];
+            for (uint32_t Count : Cells)
+            {
+                if (Count != 1)
+                    return false;
+            }
+        }
+        return true;
+    }
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(RandomTests)
+    {
+    public:
+
+        TEST_METHOD(PCG32MatchesReference)
+        {
+            // pcg32-demo from the PCG reference implementation, seed 42 and stream 54
+            const uint32_t Reference[6] = { 0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293, 0xbfa4784b, 0xcbed606e };
+            PCG32 Gen(42, 54);
+            for (uint32_t Expected : Reference)
+                Assert::AreEqual(Expected, Gen.Next());
+        }
+
+        TEST_METHOD(PCG32Advance)
+        {
+            PCG32 Stepped(7, 3), Advanced(7, 3);
+            for (int i = 0; i < 12345; ++i)
+                Stepped.Next();
+            Advanced.Advance(12345);
+            Assert::AreEqual(Stepped.Next(), Advanced.Next());
+
+            // Going back to the start
+            Advanced.Advance((uint64_t)-12346);
+            PCG32 Fresh(7, 3);
+            Assert::AreEqual(Fresh.Next(), Advanced.Next());
+        }
+
+        TEST_METHOD(XoshiroMatchesReference)
+        {
+            Xoshiro256PlusPlus Gen(123);
+            ReferenceXoshiro Reference(123);
+            for (int i = 0; i < 1000; ++i)
+                Assert::AreEqual(Reference.next(), Gen.Next());
+
+            Gen.Jump();
+            Reference.jump(kReferenceJump);
+            for (int i = 0; i < 100; ++i)
+                Assert::AreEqual(Reference.next(), Gen.Next());
+
+            Gen.LongJump();
+            Reference.jump(kReferenceLongJump);
+            for (int i = 0; i < 100; ++i)
+                Assert::AreEqual(Reference.next(), Gen.Next());
+        }
+
+        TEST_METHOD(Streams)
+        {
+            const RandomNumberGenerator Base(3);
+
+            // Stream i is i + 1 jumps away from the base generator
+            Xoshiro256PlusPlus Jumped(3);
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                Jumped.Jump();
+                Xoshiro256PlusPlus Expected = Jumped;
+                RandomNumberGenerator Stream = Base.MakeStream(i);
+                for (int j = 0; j < 100; ++j)
+                    Assert::AreEqual((uint32_t)(Expected.Next() >> 32), Stream.NextUint());
+            }
+
+            RandomNumberGenerator Stream0 = Base.MakeStream(0), Stream1 = Base.MakeStream(1);
+            Assert::AreNotEqual(Stream0.NextUint(), Stream1.NextUint());
+        }
+
+        TEST_METHOD(NextIntRangeAndUniformity)
+        {
+            RandomNumberGenerator Gen(1);
+
+            std::vector<uint32_t> Histogram(7);
+            for (int i = 0; i < 700000; ++i)
+            {
+                const int32_t Value = Gen.NextInt(3, 9);
+                Assert::IsTrue(Value >= 3 && Value <= 9);
+                ++Histogram[Value - 3];
+            }
+            double ChiSq = 0.0;
+            for (uint32_t Count : Histogram)
+                ChiSq += (Count - 1e5) * (Count - 1e5) / 1e5;
+            LogMessage("NextInt(3, 9): chi-squared %.2f (6 degrees of freedom)", ChiSq);
+            Assert::IsTrue(ChiSq < 22.5);
+
+            for (int i = 0; i < 1000; ++i)
+            {
+                const int32_t Value = Gen.NextInt(5);
+                Assert::IsTrue(Value >= 0 && Value <= 5);
+            }
+            Assert::AreEqual(4, Gen.NextInt(4, 4));
+
+            // The full range doesn't overflow
+            uint32_t Negative = 0;
+            for (int i = 0; i < 100000; ++i)
+                Negative += Gen.NextInt(INT32_MIN, INT32_MAX) < 0;
+            Assert::IsTrue(Negative > 49000 && Negative < 51000);
+        }
+
+        TEST_METHOD(NextFloatUniformity)
+        {
+            RandomNumberGenerator Gen(1);
+            const int N = 1000000;
+            std::vector<double> Values(N);
+            double Mean = 0.0, Variance = 0.0;
+            for (int i = 0; i < N; ++i)
+            {
+                const float Value = Gen.NextFloat();
+                Values[i] = Value;
+                Mean += Value;
+                Variance += Value * Value;
+            }
+            Mean /= N;
+            Variance = Variance / N - Mean * Mean;
+            const double ChiSq = ChiSquared(Values, 1000);
+            LogMessage("NextFloat: mean %.5f, variance %.5f (%.5f), chi-squared %.1f (999 degrees of freedom)",
+                Mean, Variance, 1.0 / 12.0, ChiSq);
+            Assert::AreEqual(0.5, Mean, 0.002);
+            Assert::AreEqual(1.0 / 12.0, Variance, 0.001);
+            Assert::IsTrue(ChiSq < 1150.0);
+        }
+
+        TEST_METHOD(FillFloats)
+        {
+            // An odd count, to cover the tail after the last group of four
+            const size_t N = 1000003;
+            std::vector<float> Floats(N);
+            RandomNumberGenerator Gen(5);
+            Gen.FillFloats(Floats.data(), N, -2.0f, 3.0f);
+
+            std::vector<double> Values(N);
+            double Mean = 0.0;
+            for (size_t i = 0; i < N; ++i)
+            {
+                Assert::IsTrue(Floats[i] >= -2.0f && Floats[i] < 3.0f);
+                Values[i] = (Floats[i] + 2.0) / 5.0;
+                Mean += Floats[i];
+            }
+            Mean /= N;
+            const double ChiSq = ChiSquared(Values, 1000);
+
+            // Serial correlation between neighbors, which come from the two halves of one output or from two streams
+            double Correlation = 0.0;
+            for (size_t i = 1; i < N; ++i)
+                Correlation += (Values[i] - 0.5) * (Values[i - 1] - 0.5);
+            Correlation /= N / 12.0;
+
+            LogMessage("FillFloats: mean %.4f (0.5), chi-squared %.1f, lag 1 correlation %.5f", Mean, ChiSq, Correlation);
+            Assert::AreEqual(0.5, Mean, 0.01);
+            Assert::IsTrue(ChiSq < 1150.0);
+            Assert::AreEqual(0.0, Correlation, 0.005);
+
+            // Deterministic
+            std::vector<float> Again(N);
+            RandomNumberGenerator Gen2(5);
+            Gen2.FillFloats(Again.data(), N, -2.0f, 3.0f);
+            Assert::IsTrue(Floats == Again);
+
+            // The first lane takes two floats from each output of the generator itself
+            RandomNumberGenerator Gen3(9);
+            float Batch[64];
+            Gen3.FillFloats(Batch, 64);
+            Xoshiro256PlusPlus Expected(9);
+            const uint64_t Output = Expected.Next();
+            Assert::AreEqual(UintToUnitFloat((uint32_t)Output), Batch[0]);
+            Assert::AreEqual(UintToUnitFloat((uint32_t)(Output >> 32)), Batch[1]);
+        }
+
+        TEST_METHOD(SobolStratification)
+        {
+            // Every dimension on its own has one point in each of 2^M intervals
+            for (uint32_t M = 1; M <= 12; ++M)
+            {
+                const uint32_t N = 1u << M;
+                for (uint32_t d = 0; d < kMaxSobolDimensions; ++d)
+                {
+                    std::vector<uint32_t> Intervals(N);
+                    for (uint32_t i = 0; i < N; ++i)
+                        ++Intervals[(uint32_t)(Sobol(i, d) * N)];
+                    for (uint32_t Count : Intervals)
+                        Assert::AreEqual(1u, Count);
+                }
+                Assert::IsTrue(IsNet(M, 0, 1), L"The first two dimensions should form a (0,m,2)-net");
+            }
+
+            // Scrambling keeps the stratification
+            std::vector<uint32_t> Intervals(256);
+            for (uint32_t i = 0; i < 256; ++i)
+                ++Intervals[(uint32_t)(Sobol(i, 3, 0x9E3779B9u) * 256)];
+            for (uint32_t Count : Intervals)
+                Assert::AreEqual(1u, Count);
+        }
+
+        TEST_METHOD(SobolSequenceBlocks)
+        {
+            // Gray code order gives the same set of points in each block of a power of two
+            SobolSequence Sequence(3, 0x12345678);
+            for (int Block = 0; Block < 2; ++Block)
+            {
+                std::vector<uint32_t> Intervals(256);
+                for (int i = 0; i < 256; ++i)
+                {
+                    float Point[3];
+                    Sequence.Next(Point);
+                    ++Intervals[(uint32_t)(Point[2] * 256)];
+                }
+                for (uint32_t Count : Intervals)
+                    Assert::AreEqual(1u, Count);
+            }
+        }
+
+        TEST_METHOD(Halton)
+        {
+            Assert::AreEqual(0.5f, RadicalInverse(1, 2));
+            Assert::AreEqual(0.75f, RadicalInverse(3, 2));
+            Assert::AreEqual(1.0 / 3.0, (double)RadicalInverse(1, 3), 1e-7);
+            Assert::AreEqual(2.0 / 3.0 + 1.0 / 9.0, (double)RadicalInverse(5, 3), 1e-7);
+
+            // B^2 points in base B have one point in each interval of 1 / B^2
+            const uint32_t Primes[kMaxHaltonDimensions] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53 };
+            for (uint32_t d = 0; d < kMaxHaltonDimensions; ++d)
+            {
+                const uint32_t N = Primes[d] * Primes[d];
+                std::vector<uint32_t> Intervals(N);
+                for (uint32_t i = 0; i < N; ++i)
+                    ++Intervals[(uint32_t)(Math::Halton(i, d) * N + 0.01f)];
+                for (uint32_t Count : Intervals)
+                    Assert::AreEqual(1u, Count);
+            }
+
+            for (uint32_t i = 0; i < 2000000; i += 7)
+                Assert::IsTrue(Math::Halton(i, kMaxHaltonDimensions - 1) < 1.0f);
+        }
+
+        TEST_METHOD(R2Coverage)
+        {
+            float X, Y;
+            R2(0, X, Y);
+            Assert::AreEqual(0.5f, X);
+            Assert::AreEqual(0.5f, Y);
+
+            std::vector<uint32_t> Cells(100);
+            for (uint32_t i = 0; i < 10000; ++i)
+            {
+                R2(i, X, Y);
+                ++Cells[(uint32_t)(X * 10) * 10 + (uint32_t)(Y * 10)];
+            }
+            for (uint32_t Count : Cells)
+                Assert::IsTrue(Count >= 95 && Count <= 105);
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Throughput)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(Throughput)
+        {
+            const int N = 20000000;
+            std::vector<float> Out(N);
+            float Sum = 0.0f;
+
+            // What Math::RandomNumberGenerator used before
+            {
+                std::minstd_rand Gen(1);
+                std::uniform_real_distribution<float> Distribution(0.0f, 1.0f);
+                double Time = BenchmarkTime();
+                for (int i = 0; i < N; ++i)
+                    Out[i] = Distribution(Gen);
+                Time = BenchmarkTime() - Time;
+                LogMessage("minstd_rand, uniform_real_distribution:  %.2f ns/float", Time / N * 1e9);
+                Sum += Out[N / 2];
+            }
+            {
+                RandomNumberGenerator Gen(1);
+                double Time = BenchmarkTime();
+                for (int i = 0; i < N; ++i)
+                    Out[i] = Gen.NextFloat();
+                Time = BenchmarkTime() - Time;
+                LogMessage("NextFloat:  %.2f ns/float", Time / N * 1e9);
+                Sum += Out[N / 2];
+            }
+            {
+                RandomNumberGenerator Gen(1);
+                double Time = BenchmarkTime();
+                Gen.FillFloats(Out.data(), N);
+                Time = BenchmarkTime() - Time;
+                LogMessage("FillFloats:  %.2f ns/float", Time / N * 1e9);
+                Sum += Out[N / 2];
+            }
+            {
+                // Batches that stay in the L1 cache
+                RandomNumberGenerator Gen(1);
+                double Time = BenchmarkTime();
+                for (int k = 0; k < N / 4096; ++k)
+                    Gen.FillFloats(Out.data(), 4096);
+                Time = BenchmarkTime() - Time;
+                LogMessage("FillFloats, 4096 at a time:  %.2f ns/float", Time / N * 1e9);
+                Sum += Out[1];
+            }
+            {
+                PCG32 Gen(1);
+                double Time = BenchmarkTime();
+                for (int i = 0; i < N; ++i)
+                    Out[i] = UintToUnitFloat(Gen.Next());
+                Time = BenchmarkTime() - Time;
+                LogMessage("PCG32:  %.2f ns/float", Time / N * 1e9);
+                Sum += Out[N / 2];
+            }
+
+            int32_t IntSum = 0;
+            {
+                std::minstd_rand Gen(1);
+                std::uniform_int_distribution<int32_t> Distribution(0, 999);
+                double Time = BenchmarkTime();
+                for (int i = 0; i < N; ++i)
+                    IntSum += Distribution(Gen);
+                Time = BenchmarkTime() - Time;
+                LogMessage("minstd_rand, uniform_int_distribution(0, 999):  %.2f ns", Time / N * 1e9);
+            }
+            {
+                RandomNumberGenerator Gen(1);
+                double Time = BenchmarkTime();
+                for (int i = 0; i < N; ++i)
+                    IntSum += Gen.NextInt(999);
+                Time = BenchmarkTime() - Time;
+                LogMessage("NextInt(999):  %.2f ns", Time / N * 1e9);
+            }
+
+            {
+                double Time = BenchmarkTime();
+                for (uint32_t i = 0; i < N / 8; ++i)
+                    Sum += Sobol(i, 3);
+                Time = BenchmarkTime() - Time;
+                LogMessage("Sobol(i, 3):  %.2f ns", Time / (N / 8) * 1e9);
+            }
+            {
+                SobolSequence Sequence(2);
+                float Point[2];
+                double Time = BenchmarkTime();
+                for (int i = 0; i < N; ++i)
+                {
+                    Sequence.Next(Point);
+                    Sum += Point[1];
+                }
+                Time = BenchmarkTime() - Time;
+                LogMessage("SobolSequence, 2D:  %.2f ns/point", Time / N * 1e9);
+            }
+            {
+                double Time = BenchmarkTime();
+                for (uint32_t i = 0; i < N / 8; ++i)
+                    Sum += Math::Halton(i, 5);
+                Time = BenchmarkTime() - Time;
+                LogMessage("Halton(i, 5):  %.2f ns", Time / (N / 8) * 1e9);
+            }
+
+            // Keeps the loops from being optimized away
+            Assert::IsTrue(Sum == Sum && IntSum != 0);
+        }
+    };
+}
@@ -0,0 +1,427 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Checks the cascade fitting, caster culling and caching of ShadowCascades on the CPU, in a scene with
+// the bounds of Sponza and the sun of ModelViewer.  Receivers are sampled in the view frustum, and their occluders
+// are the boxes hit by a ray toward the light.
+//
+
+#include "stdafx.h"
+#include "ShadowCascades.h"
+#include "Camera.h"
+#include "Math/Random.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Math;
+using namespace GameCore;
+
+namespace
+{
+    const uint32_t kCascadeSize = 1024;
+    const float kShadowDistance = 3000.0f;
+    const float kSplitLambda = 0.7f;
+
+    const Vector3 kSceneMin(-1900.0f, -130.0f, -1200.0f);
+    const Vector3 kSceneMax(1800.0f, 1500.0f, 1150.0f);
+
+    Vector3 SunDirection( void )
+    {
+        // ModelViewer's default sun orientation and inclination
+        const float Theta = -0.5f, Phi = 0.75f * XM_PIDIV2;
+        const Vector3 ToSun(std::cos(Theta) * std::cos(Phi), std::sin(Phi), std::sin(Theta) * std::cos(Phi));
+        return -ToSun;
+    }
+
+    void SetView( Camera& ViewCamera, Vector3 Eye, Vector3 Forward )
+    {
+        ViewCamera.SetEyeAtUp(Eye, Eye + Forward, Vector3(kYUnitVector));
+        ViewCamera.SetZRange(1.0f, 10000.0f);
+        ViewCamera.Update();
+    }
+
+    void ToFloat3( Vector3 V, float Out[3] )
+    {
+        Out[0] = V.GetX();
+        Out[1] = V.GetY();
+        Out[2] = V.GetZ();
+    }
+
+    // Shadow casters:  boxes of assorted sizes in the scene bounds, stored as a structure of arrays for
+    // Frustum::IntersectBoundingBoxes()
+    struct Scene
+    {
+        uint32_t NumBoxes;
+        std::vector<float> Min[3], Max[3];
+
+        explicit Scene( uint32_t Count ) : NumBoxes(Count)
+        {
+            RandomNumberGenerator Rand(1);
+            float Lo[3], Hi[3];
+            ToFloat3(kSceneMin, Lo);
+            ToFloat3(kSceneMax, Hi);
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                Min[Axis].resize(Count);
+                Max[Axis].resize(Count);
+            }
+            for (uint32_t i = 0; i < Count; ++i)
+            {
+                for (int Axis = 0; Axis < 3; ++Axis)
+                {
+                    const float Center = Rand.NextFloat(Lo[Axis], Hi[Axis]);
+                    const float HalfSize = Rand.NextFloat(5.0f, 120.0f);
+                    Min[Axis][i] = std::fmax(Center - HalfSize, Lo[Axis]);
+                    Max[Axis][i] = std::fmin(Center + HalfSize, Hi[Axis]);
+                }
+            }
+        }
+
+        // The boxes that a cascade renders
+        std::vector<bool> Cull( const ShadowCascades& Cascades, uint32_t Cascade ) const
+        {
+            std::vector<uint32_t> Masks((NumBoxes + 31) / 32);
+            Cascades.GetCasterFrustum(Cascade).IntersectBoundingBoxes(Min[0].data(), Min[1].data(), Min[2].data(),
+                Max[0].data(), Max[1].data(), Max[2].data(), NumBoxes, Masks.data());
+
+            std::vector<bool> Rendered(NumBoxes);
+            for (uint32_t i = 0; i < NumBoxes; ++i)
+                Rendered[i] = (Masks[i / 32] >> (i % 32) & 1) != 0;
+            return Rendered;
+        }
+
+        // True when the ray from P toward the light hits box i
+        bool Occludes( uint32_t i, const float P[3], const float ToLight[3] ) const
+        {
+            float Enter = 0.0f, Exit = FLT_MAX;
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                const float Lo = Min[Axis][i], Hi = Max[Axis][i];
+                if (std::fabs(ToLight[Axis]) < 1e-12f)
+                {
+                    if (P[Axis] < Lo || P[Axis] > Hi)
+                        return false;
+                    continue;
+                }
+                float t1 = (Lo - P[Axis]) / ToLight[Axis];
+                float t2 = (Hi - P[Axis]) / ToLight[Axis];
+                Enter = std::fmax(Enter, std::fmin(t1, t2));
+                Exit = std::fmin(Exit, std::fmax(t1, t2));
+            }
+            return Exit >= Enter;
+        }
+    };
+
+    // A point in the view frustum at view depth Depth, and in the scene bounds.  Returns false when it isn't in the
+    // scene.
+    bool SampleReceiver( const Camera& ViewCamera, RandomNumberGenerator& Rand, float Depth, Vector3& P )
+    {
+        const float* ProjMatF = (const float*)&ViewCamera.GetProjMatrix();
+        const float TanX = 1.0f / ProjMatF[0], TanY = 1.0f / ProjMatF[5];
+        P = ViewCamera.GetPosition() + ViewCamera.GetForwardVec() * Depth +
+            ViewCamera.GetRightVec() * (Rand.NextFloat(-1.0f, 1.0f) * Depth * TanX) +
+            ViewCamera.GetUpVec() * (Rand.NextFloat(-1.0f, 1.0f) * Depth * TanY);
+
+        float Pf[3], Lo[3], Hi[3];
+        ToFloat3(P, Pf);
+        ToFloat3(kSceneMin, Lo);
+        ToFloat3(kSceneMax, Hi);
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            if (Pf[Axis] < Lo[Axis] || Pf[Axis] > Hi[Axis])
+                return false;
+        }
+        return true;
+    }
+
+    uint32_t CascadeOfDepth( const ShadowCascades& Cascades, float Depth )
+    {
+        uint32_t Cascade = 0;
+        while (Cascade + 1 < Cascades.GetNumCascades() && Depth > Cascades.GetSplitDepth(Cascade))
+            ++Cascade;
+        return Cascade;
+    }
+
+    Vector3 TextureCoords( const ShadowCascades& Cascades, uint32_t Cascade, Vector3 P )
+    {
+        return Vector3(Cascades.GetCascadeCamera(Cascade).GetShadowMatrix() * P);
+    }
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(ShadowCascadesTests)
+    {
+    public:
+
+        TEST_METHOD(SplitDepths)
+        {
+            Camera ViewCamera;
+            SetView(ViewCamera, Vector3(800.0f, 200.0f, 0.0f), Vector3(-1.0f, -0.1f, 0.2f));
+            const float Near = 1.0f, Far = kShadowDistance;
+
+            ShadowCascades Cascades;
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, 0.0f, 4, kCascadeSize, 16);
+            for (uint32_t i = 0; i < 4; ++i)
+                Assert::AreEqual(Near + (Far - Near) * (i + 1) / 4.0f, Cascades.GetSplitDepth(i), 0.01f);
+
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, 1.0f, 4, kCascadeSize, 16);
+            for (uint32_t i = 0; i < 4; ++i)
+                Assert::AreEqual(Near * std::pow(Far / Near, (i + 1) / 4.0f), Cascades.GetSplitDepth(i), 0.01f);
+
+            // The shadow distance is clamped to the far plane
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, 20000.0f, kSplitLambda, 3, kCascadeSize, 16);
+            Assert::AreEqual(3u, Cascades.GetNumCascades());
+            Assert::AreEqual(10000.0f, Cascades.GetSplitDepth(2), 0.01f);
+            Assert::IsTrue(Cascades.GetSplitDepth(0) < Cascades.GetSplitDepth(1));
+            Assert::IsTrue(Cascades.GetSplitDepth(1) < Cascades.GetSplitDepth(2));
+        }
+
+        TEST_METHOD(BoundsContainSlices)
+        {
+            Camera ViewCamera;
+            SetView(ViewCamera, Vector3(800.0f, 200.0f, 0.0f), Vector3(-1.0f, -0.1f, 0.2f));
+            ShadowCascades Cascades;
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 4, kCascadeSize, 16);
+
+            const float* ProjMatF = (const float*)&ViewCamera.GetProjMatrix();
+            const float TanX = 1.0f / ProjMatF[0], TanY = 1.0f / ProjMatF[5];
+            float SliceNear = ViewCamera.GetNearClip();
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                const BoundingSphere& Bounds = Cascades.GetCascadeBounds(i);
+                const float SliceFar = Cascades.GetSplitDepth(i);
+                float MaxDistance = 0.0f;
+                for (uint32_t Corner = 0; Corner < 8; ++Corner)
+                {
+                    const float Depth = Corner & 4 ? SliceFar : SliceNear;
+                    const Vector3 P = ViewCamera.GetPosition() + ViewCamera.GetForwardVec() * Depth +
+                        ViewCamera.GetRightVec() * (Corner & 1 ? Depth * TanX : -Depth * TanX) +
+                        ViewCamera.GetUpVec() * (Corner & 2 ? Depth * TanY : -Depth * TanY);
+                    MaxDistance = std::fmax(MaxDistance, Length(P - Bounds.GetCenter()));
+                }
+                Assert::IsTrue(MaxDistance <= Bounds.GetRadius() * 1.0001f);
+                SliceNear = SliceFar;
+            }
+        }
+
+        TEST_METHOD(StableUnderCameraMotion)
+        {
+            Camera ViewCamera;
+            ShadowCascades Cascades;
+            const Vector3 Eye(800.0f, 200.0f, 0.0f);
+            const Vector3 Fixed(100.0f, 50.0f, -40.0f);
+
+            SetView(ViewCamera, Eye, Vector3(-1.0f, -0.1f, 0.2f));
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 4, kCascadeSize, 16);
+            float Radius[4];
+            Vector3 Before[4];
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                Radius[i] = Cascades.GetCascadeBounds(i).GetRadius();
+                Before[i] = TextureCoords(Cascades, i, Fixed) * (float)kCascadeSize;
+            }
+
+            // Turning doesn't change the size of the cascades, and moving shifts them by whole texels
+            SetView(ViewCamera, Eye + Vector3(0.37f, 0.0f, -0.21f), Vector3(-0.3f, -0.2f, 1.0f));
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 4, kCascadeSize, 16);
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                Assert::AreEqual(Radius[i], (float)Cascades.GetCascadeBounds(i).GetRadius(), Radius[i] * 1e-5f);
+
+                const Vector3 Shift = TextureCoords(Cascades, i, Fixed) * (float)kCascadeSize - Before[i];
+                const float ShiftX = Shift.GetX(), ShiftY = Shift.GetY();
+                Assert::AreEqual(std::round(ShiftX), ShiftX, 0.02f);
+                Assert::AreEqual(std::round(ShiftY), ShiftY, 0.02f);
+            }
+        }
+
+        TEST_METHOD(ReceiversInTheirCascade)
+        {
+            Camera ViewCamera;
+            SetView(ViewCamera, Vector3(800.0f, 200.0f, 0.0f), Vector3(-1.0f, -0.1f, 0.2f));
+            ShadowCascades Cascades;
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 4, kCascadeSize, 16);
+
+            RandomNumberGenerator Rand(2);
+            float MinMargin = FLT_MAX;
+            uint32_t NumReceivers = 0;
+            float SliceNear = ViewCamera.GetNearClip();
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                for (int Sample = 0; Sample < 5000; ++Sample)
+                {
+                    Vector3 P;
+                    if (!SampleReceiver(ViewCamera, Rand, Rand.NextFloat(SliceNear, Cascades.GetSplitDepth(i)), P))
+                        continue;
+
+                    const Vector3 T = TextureCoords(Cascades, i, P);
+                    const float X = T.GetX(), Y = T.GetY(), Z = T.GetZ();
+                    MinMargin = std::fmin(MinMargin, std::fmin(std::fmin(X, 1.0f - X), std::fmin(Y, 1.0f - Y)) * kCascadeSize);
+                    Assert::IsTrue(Z >= 0.0f && Z <= 1.0f, L"Receiver outside of the depth range of its cascade");
+                    ++NumReceivers;
+                }
+                SliceNear = Cascades.GetSplitDepth(i);
+            }
+
+            // The border is there for filtering.  Snapping to texels can take up to one of it.
+            LogMessage("%u receivers, closest to the edge of their cascade:  %.2f texels", NumReceivers, MinMargin);
+            Assert::IsTrue(NumReceivers > 1000);
+            Assert::IsTrue(MinMargin >= ShadowCascades::kBorderTexels - 1.0f);
+        }
+
+        TEST_METHOD(CascadeScaleAndOffset)
+        {
+            Camera ViewCamera;
+            SetView(ViewCamera, Vector3(800.0f, 200.0f, 0.0f), Vector3(-1.0f, -0.1f, 0.2f));
+            ShadowCascades Cascades;
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 4, kCascadeSize, 16);
+
+            RandomNumberGenerator Rand(3);
+            float MaxError = 0.0f;
+            for (int Sample = 0; Sample < 1000; ++Sample)
+            {
+                const Vector3 P(Rand.NextFloat(-1900.0f, 1800.0f), Rand.NextFloat(-130.0f, 1500.0f), Rand.NextFloat(-1200.0f, 1150.0f));
+                const Vector3 T0 = TextureCoords(Cascades, 0, P);
+                for (uint32_t i = 0; i < 4; ++i)
+                {
+                    const Vector3 Expected = TextureCoords(Cascades, i, P);
+                    const Vector3 Derived = T0 * Cascades.GetCascadeScale(i) + Cascades.GetCascadeOffset(i);
+                    const Vector3 Error = Abs(Derived - Expected);
+                    MaxError = std::fmax(MaxError, std::fmax(std::fmax(Error.GetX(), Error.GetY()), Error.GetZ()));
+                }
+            }
+            LogMessage("Largest error of the per cascade scale and offset:  %g", MaxError);
+            Assert::IsTrue(MaxError < 1e-4f);
+        }
+
+        TEST_METHOD(CasterCullingAlongPath)
+        {
+            // The camera walks and turns.  Every receiver's occluders must have been rendered into its cascade, when
+            // the cascade was last rendered, as cached cascades aren't rendered again.
+            const uint32_t kFrames = 240;
+            const Scene Casters(2000);
+            const Vector3 Eye(800.0f, 200.0f, 0.0f);
+            float ToLight[3];
+            ToFloat3(-SunDirection(), ToLight);
+
+            Camera ViewCamera;
+            ShadowCascades Cascades;
+            std::vector<bool> Rendered[ShadowCascades::kMaxCascades];
+            RandomNumberGenerator Rand(7);
+            uint32_t CascadesRendered = 0, Draws = 0, Occluders = 0, Missing = 0, Receivers = 0;
+
+            for (uint32_t Frame = 0; Frame < kFrames; ++Frame)
+            {
+                const float k = (float)Frame;
+                SetView(ViewCamera, Eye + Vector3(-0.5f, 0.0f, 0.3f) * k, Vector3(-std::cos(0.002f * k), -0.1f, 0.2f + 0.002f * k));
+                Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 4, kCascadeSize, 16);
+
+                for (uint32_t i = 0; i < 4; ++i)
+                {
+                    Assert::IsTrue(Frame > 0 || !Cascades.IsCascadeCached(i));
+                    if (Cascades.IsCascadeCached(i))
+                        continue;
+                    Rendered[i] = Casters.Cull(Cascades, i);
+                    ++CascadesRendered;
+                    for (bool IsRendered : Rendered[i])
+                        Draws += IsRendered ? 1 : 0;
+                }
+
+                if (Frame % 20 != 0)
+                    continue;
+
+                for (int Sample = 0; Sample < 600; ++Sample)
+                {
+                    const float Depth = Rand.NextFloat(1.0f, kShadowDistance);
+                    Vector3 P;
+                    if (!SampleReceiver(ViewCamera, Rand, Depth, P))
+                        continue;
+
+                    const uint32_t Cascade = CascadeOfDepth(Cascades, Depth);
+                    float Pf[3];
+                    ToFloat3(P, Pf);
+                    for (uint32_t Box = 0; Box < Casters.NumBoxes; ++Box)
+                    {
+                        if (!Casters.Occludes(Box, Pf, ToLight))
+                            continue;
+                        ++Occluders;
+                        Missing += Rendered[Cascade][Box] ? 0 : 1;
+                    }
+                    ++Receivers;
+                }
+            }
+
+            LogMessage("%u receivers with %u occluders, %u of them not rendered into their cascade", Receivers, Occluders, Missing);
+            LogMessage("Cascades rendered:  %u of %u, %.1f shadow draws per frame (of %u boxes, times 4 cascades without culling)",
+                CascadesRendered, 4 * kFrames, (float)Draws / kFrames, Casters.NumBoxes);
+            Assert::IsTrue(Occluders > 100);
+            Assert::AreEqual(0u, Missing);
+        }
+
+        TEST_METHOD(Caching)
+        {
+            Camera ViewCamera;
+            SetView(ViewCamera, Vector3(800.0f, 200.0f, 0.0f), Vector3(-1.0f, -0.1f, 0.2f));
+            ShadowCascades Cascades;
+
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 4, kCascadeSize, 16);
+            for (uint32_t i = 0; i < 4; ++i)
+                Assert::IsFalse(Cascades.IsCascadeCached(i));
+
+            // A camera that doesn't move renders nothing again
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 4, kCascadeSize, 16);
+            for (uint32_t i = 0; i < 4; ++i)
+                Assert::IsTrue(Cascades.IsCascadeCached(i));
+
+            Cascades.Invalidate();
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 4, kCascadeSize, 16);
+            for (uint32_t i = 0; i < 4; ++i)
+                Assert::IsFalse(Cascades.IsCascadeCached(i));
+
+            // Resizing moves the regions, and a cascade that comes back starts over
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 3, 512, 16);
+            for (uint32_t i = 0; i < 3; ++i)
+                Assert::IsFalse(Cascades.IsCascadeCached(i));
+            Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 4, 512, 16);
+            Assert::IsFalse(Cascades.IsCascadeCached(3));
+
+            // A new light direction moves every cascade
+            Cascades.Update(ViewCamera, SunDirection() + Vector3(0.0f, 0.0f, 0.05f), kSceneMin, kSceneMax, kShadowDistance,
+                kSplitLambda, 4, 512, 16);
+            for (uint32_t i = 0; i < 4; ++i)
+                Assert::IsFalse(Cascades.IsCascadeCached(i));
+
+            // Walking at half a unit per frame leaves most cascades where they were, turning moves the slices
+            const uint32_t kFrames = 240;
+            const Vector3 Eye(800.0f, 200.0f, 0.0f);
+            uint32_t Walking[ShadowCascades::kMaxCascades] = {}, Turning[ShadowCascades::kMaxCascades] = {};
+            Cascades.Invalidate();
+            for (uint32_t Frame = 0; Frame < kFrames; ++Frame)
+            {
+                SetView(ViewCamera, Eye + Vector3(-0.5f, 0.0f, 0.3f) * (float)Frame, Vector3(-1.0f, -0.1f, 0.2f));
+                Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 4, kCascadeSize, 16);
+                for (uint32_t i = 0; i < 4; ++i)
+                    Walking[i] += Cascades.IsCascadeCached(i) ? 0 : 1;
+            }
+            Cascades.Invalidate();
+            for (uint32_t Frame = 0; Frame < kFrames; ++Frame)
+            {
+                const float Angle = 0.002f * Frame;
+                SetView(ViewCamera, Eye, Vector3(-std::cos(Angle), -0.1f, 0.2f + std::sin(Angle)));
+                Cascades.Update(ViewCamera, SunDirection(), kSceneMin, kSceneMax, kShadowDistance, kSplitLambda, 4, kCascadeSize, 16);
+                for (uint32_t i = 0; i < 4; ++i)
+                    Turning[i] += Cascades.IsCascadeCached(i) ? 0 : 1;
+            }
+            LogMessage("Renders in %u frames of walking:  %u %u %u %u, of turning:  %u %u %u %u", kFrames,
+                Walking[0], Walking[1], Walking[2], Walking[3], Turning[0], Turning[1], Turning[2], Turning[3]);
+            Assert::IsTrue(Walking[3] < kFrames / 2);
+        }
+    };
+}
@@ -0,0 +1,255 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Checks that ModelConverter's GenerateTangentFrames() builds unit tangents in the tangent plane of
+// each normal, pointing along increasing u, with bitangents flipped by mirrored UVs, and that the frames don't depend
+// on the face order, the index type or whether bitangents are written.  Measures a two million triangle mesh against
+// the plain tangent accumulation the RTAO scene loader used before.
+//
+
+#include "stdafx.h"
+#include "../ModelConverter/TangentSpace.h"
+#include "Math/Random.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    // Position, normal, texcoord, tangent and bitangent, as ModelConverter lays them out
+    const uint32_t kVertexFloats = 14;
+
+    // A Width x Height vertex grid in the XZ plane with jittered positions and normals tilted away from +Y.  U runs
+    // along +X, or along -X when Mirrored, and V along +Z.
+    struct GridMesh
+    {
+        std::vector<float> Vertices;
+        std::vector<uint32_t> Indices;
+
+        GridMesh( uint32_t Width, uint32_t Height, bool Mirrored, uint64_t Seed )
+        {
+            Math::RandomNumberGenerator Rand(Seed);
+            for (uint32_t y = 0; y < Height; ++y)
+            {
+                for (uint32_t x = 0; x < Width; ++x)
+                {
+                    const float U = (float)x / (Width - 1);
+                    const float Vertex[kVertexFloats] = {
+                        x + Rand.NextFloat(-0.2f, 0.2f), Rand.NextFloat(-0.2f, 0.2f), y + Rand.NextFloat(-0.2f, 0.2f),
+                        Rand.NextFloat(-0.2f, 0.2f), 1.0f, Rand.NextFloat(-0.2f, 0.2f),
+                        Mirrored ? 1.0f - U : U, (float)y / (Height - 1) };
+                    Vertices.insert(Vertices.end(), Vertex, Vertex + kVertexFloats);
+                }
+            }
+
+            // Counterclockwise seen from +Y
+            for (uint32_t y = 0; y + 1 < Height; ++y)
+            {
+                for (uint32_t x = 0; x + 1 < Width; ++x)
+                {
+                    const uint32_t i0 = y * Width + x, i1 = i0 + 1, i2 = i0 + Width, i3 = i2 + 1;
+                    Indices.insert(Indices.end(), { i0, i2, i1, i1, i2, i3 });
+                }
+            }
+        }
+
+        uint32_t VertexCount( void ) const { return (uint32_t)Vertices.size() / kVertexFloats; }
+        const float* Normal( uint32_t v ) const { return &Vertices[v * kVertexFloats + 3]; }
+        const float* Tangent( uint32_t v ) const { return &Vertices[v * kVertexFloats + 8]; }
+        const float* Bitangent( uint32_t v ) const { return &Vertices[v * kVertexFloats + 11]; }
+        float& U( uint32_t v ) { return Vertices[v * kVertexFloats + 6]; }
+        float& V( uint32_t v ) { return Vertices[v * kVertexFloats + 7]; }
+
+        TangentSpace::InterleavedVertices Interleaved( bool WithBitangents )
+        {
+            TangentSpace::InterleavedVertices Interleaved = {};
+            Interleaved.positions = &Vertices[0];
+            Interleaved.normals = &Vertices[3];
+            Interleaved.texcoords = &Vertices[6];
+            Interleaved.tangents = &Vertices[8];
+            Interleaved.bitangents = WithBitangents ? &Vertices[11] : nullptr;
+            Interleaved.positionStride = Interleaved.normalStride = Interleaved.texcoordStride = kVertexFloats * sizeof(float);
+            Interleaved.tangentStride = Interleaved.bitangentStride = kVertexFloats * sizeof(float);
+            Interleaved.vertexCount = VertexCount();
+            return Interleaved;
+        }
+
+        template <typename IndexType>
+        void GenerateFrames( const std::vector<uint32_t>& FaceIndices, bool WithBitangents = true )
+        {
+            std::vector<IndexType> ConvertedIndices(FaceIndices.begin(), FaceIndices.end());
+            TangentSpace::GenerateTangentFrames<IndexType>(Interleaved(WithBitangents), ConvertedIndices.data(), (uint32_t)FaceIndices.size());
+        }
+    };
+
+    float Length( const float* V ) { return std::sqrt(V[0] * V[0] + V[1] * V[1] + V[2] * V[2]); }
+    float Dot( const float* A, const float* B ) { return A[0] * B[0] + A[1] * B[1] + A[2] * B[2]; }
+
+    // The tangent generation the RTAO scene loader used before TangentSpace:  every face's tangent is added to its
+    // three vertices, and the sums are normalized.
+    void AccumulateTangents( GridMesh& Mesh )
+    {
+        const uint32_t VertexCount = Mesh.VertexCount();
+        float* const Vertices = Mesh.Vertices.data();
+        for (uint32_t v = 0; v < VertexCount; ++v)
+            std::fill(Vertices + v * kVertexFloats + 8, Vertices + v * kVertexFloats + 11, 0.0f);
+
+        for (size_t i = 0; i < Mesh.Indices.size(); i += 3)
+        {
+            float* const V0 = Vertices + Mesh.Indices[i] * kVertexFloats;
+            float* const V1 = Vertices + Mesh.Indices[i + 1] * kVertexFloats;
+            float* const V2 = Vertices + Mesh.Indices[i + 2] * kVertexFloats;
+            const float E1[3] = { V1[0] - V0[0], V1[1] - V0[1], V1[2] - V0[2] };
+            const float E2[3] = { V2[0] - V0[0], V2[1] - V0[1], V2[2] - V0[2] };
+            const float Du1 = V1[6] - V0[6], Dv1 = V1[7] - V0[7];
+            const float Du2 = V2[6] - V0[6], Dv2 = V2[7] - V0[7];
+            const float R = 1.0f / (Du1 * Dv2 - Du2 * Dv1);
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                const float T = (E1[c] * Dv2 - E2[c] * Dv1) * R;
+                V0[8 + c] += T;
+                V1[8 + c] += T;
+                V2[8 + c] += T;
+            }
+        }
+
+        for (uint32_t v = 0; v < VertexCount; ++v)
+        {
+            float* const T = Vertices + v * kVertexFloats + 8;
+            const float Scale = 1.0f / Length(T);
+            T[0] *= Scale;
+            T[1] *= Scale;
+            T[2] *= Scale;
+        }
+    }
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(TangentSpaceTests)
+    {
+    public:
+
+        TEST_METHOD(FramesFollowTheTexcoords)
+        {
+            for (bool Mirrored : { false, true })
+            {
+                GridMesh Mesh(40, 30, Mirrored, 30);
+                Mesh.GenerateFrames<uint32_t>(Mesh.Indices);
+
+                for (uint32_t v = 0; v < Mesh.VertexCount(); ++v)
+                {
+                    const float* T = Mesh.Tangent(v);
+                    const float* B = Mesh.Bitangent(v);
+                    const float* N = Mesh.Normal(v);
+
+                    Assert::AreEqual(1.0f, Length(T), 1e-4f, L"Tangents are unit length");
+                    Assert::AreEqual(0.0f, Dot(T, N) / Length(N), 1e-4f, L"Tangents are in the tangent plane");
+
+                    // Up to the tilt that the jitter gives the faces along the border
+                    Assert::IsTrue(T[0] * (Mirrored ? -1.0f : 1.0f) > 0.85f, L"Tangents point along increasing u");
+
+                    // The bitangent points along increasing v, +Z, whichever way u runs.  cross(+Y, +X) is -Z, so it
+                    // is -cross(n, t) unless the UVs are mirrored.
+                    const float Cross[3] = { N[1] * T[2] - N[2] * T[1], N[2] * T[0] - N[0] * T[2], N[0] * T[1] - N[1] * T[0] };
+                    Assert::AreEqual(1.0f, Length(B), 1e-4f, L"Bitangents are unit length");
+                    Assert::IsTrue(B[2] > 0.9f, L"Bitangents point along increasing v");
+                    Assert::AreEqual(Mirrored ? 1.0f : -1.0f, Dot(B, Cross) / Length(N), 1e-4f, L"Mirrored UVs flip the bitangent");
+                }
+            }
+        }
+
+        TEST_METHOD(DegenerateTexcoordsStillGiveAFrame)
+        {
+            // Every vertex at the same UV:  no face has a usable UV area, so any unit vector in the tangent plane
+            GridMesh Mesh(8, 8, false, 31);
+            for (uint32_t v = 0; v < Mesh.VertexCount(); ++v)
+                Mesh.U(v) = Mesh.V(v) = 0.5f;
+            Mesh.GenerateFrames<uint16_t>(Mesh.Indices);
+
+            for (uint32_t v = 0; v < Mesh.VertexCount(); ++v)
+            {
+                Assert::AreEqual(1.0f, Length(Mesh.Tangent(v)), 1e-4f, L"Tangents are unit length");
+                Assert::AreEqual(0.0f, Dot(Mesh.Tangent(v), Mesh.Normal(v)) / Length(Mesh.Normal(v)), 1e-4f, L"Tangents are in the tangent plane");
+                Assert::AreEqual(1.0f, Length(Mesh.Bitangent(v)), 1e-4f, L"Bitangents are unit length");
+            }
+
+            // An empty index list leaves every vertex with a fallback frame instead of reading past the end
+            GridMesh Unindexed(8, 8, false, 31);
+            Unindexed.GenerateFrames<uint32_t>(std::vector<uint32_t>());
+            Assert::AreEqual(1.0f, Length(Unindexed.Tangent(0)), 1e-4f, L"Unreferenced vertices get a unit tangent");
+        }
+
+        TEST_METHOD(FramesDontDependOnTheInputs)
+        {
+            // The faces shuffled, so that each vertex sums its corners in another order
+            GridMesh Mesh(180, 120, false, 32);
+            std::vector<uint32_t> Shuffled = Mesh.Indices;
+            Math::RandomNumberGenerator Rand(33);
+            const uint32_t NumFaces = (uint32_t)Shuffled.size() / 3;
+            for (uint32_t f = NumFaces; f > 1; --f)
+            {
+                const uint32_t Other = (uint32_t)Rand.NextInt(f - 1);
+                for (uint32_t c = 0; c < 3; ++c)
+                    std::swap(Shuffled[(f - 1) * 3 + c], Shuffled[Other * 3 + c]);
+            }
+
+            Mesh.GenerateFrames<uint32_t>(Mesh.Indices);
+            const std::vector<float> Expected = Mesh.Vertices;
+
+            Mesh.GenerateFrames<uint16_t>(Mesh.Indices);
+            Assert::IsTrue(Expected == Mesh.Vertices, L"16-bit indices give the same frames");
+
+            Mesh.GenerateFrames<uint32_t>(Mesh.Indices, false);
+            for (uint32_t v = 0; v < Mesh.VertexCount(); ++v)
+            {
+                Assert::IsTrue(std::equal(Mesh.Tangent(v), Mesh.Tangent(v) + 3, &Expected[v * kVertexFloats + 8]),
+                    L"Tangents are the same without bitangents");
+            }
+
+            Mesh.GenerateFrames<uint32_t>(Shuffled);
+            for (size_t i = 0; i < Expected.size(); ++i)
+                Assert::AreEqual(Expected[i], Mesh.Vertices[i], 1e-5f, L"The face order only changes the rounding");
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(GenerateTime)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(GenerateTime)
+        {
+            // A million vertices and two million triangles.  Best of 3 runs each, with and without the bitangents the
+            // RTAO scene loader doesn't store.
+            GridMesh Mesh(1024, 1024, false, 34);
+            const double MegaTriangles = Mesh.Indices.size() / 3 / 1e6;
+
+            double AccumulateTime = 1e9, TangentTime = 1e9, FrameTime = 1e9;
+            for (uint32_t Run = 0; Run < 3; ++Run)
+            {
+                double Start = BenchmarkTime();
+                AccumulateTangents(Mesh);
+                AccumulateTime = std::min(AccumulateTime, BenchmarkTime() - Start);
+
+                Start = BenchmarkTime();
+                Mesh.GenerateFrames<uint32_t>(Mesh.Indices, false);
+                TangentTime = std::min(TangentTime, BenchmarkTime() - Start);
+
+                Start = BenchmarkTime();
+                Mesh.GenerateFrames<uint32_t>(Mesh.Indices, true);
+                FrameTime = std::min(FrameTime, BenchmarkTime() - Start);
+            }
+
+            LogMessage("%.1f M triangles: tangent accumulation %.1f ms, %.1f M triangles/s", MegaTriangles, AccumulateTime * 1000.0, MegaTriangles / AccumulateTime);
+            LogMessage("GenerateTangentFrames, tangents only: %.1f ms, %.1f M triangles/s", TangentTime * 1000.0, MegaTriangles / TangentTime);
+            LogMessage("GenerateTangentFrames, with bitangents: %.1f ms, %.1f M triangles/s", FrameTime * 1000.0, MegaTriangles / FrameTime);
+        }
+    };
+}
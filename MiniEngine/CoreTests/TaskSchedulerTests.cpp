@@ -0,0 +1,356 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Checks that ParallelFor() calls its function once per index from the pool, from threads outside of
+// it and without a pool, that ParallelReduce() gives the same result on every run, that TaskGraph starts tasks after
+// their dependencies, that exceptions reach TaskGroup::Wait(), TaskGraph::Run() and ParallelFor(), and that waits
+// nested in tasks run other tasks instead of blocking the thread.
+//
+
+#include "stdafx.h"
+#include "TaskScheduler.h"
+#include "Math/Random.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    // Three workers whatever the CPU, so that tasks are stolen even on small machines.  The pool is shut down when a
+    // test ends, however it ends.
+    struct ScopedScheduler
+    {
+        explicit ScopedScheduler( uint32_t NumWorkers = 3 ) { TaskScheduler::Initialize(NumWorkers, false); }
+        ~ScopedScheduler() { TaskScheduler::Shutdown(); }
+    };
+
+    // Counts the calls for each index of [0, Count) that ParallelFor() makes over [Begin, End)
+    std::vector<uint32_t> CountCalls( uint32_t Count, uint32_t Begin, uint32_t End, uint32_t Grain )
+    {
+        std::unique_ptr<std::atomic<uint32_t>[]> Calls(new std::atomic<uint32_t>[Count]);
+        for (uint32_t i = 0; i < Count; ++i)
+            Calls[i].store(0);
+
+        TaskScheduler::ParallelFor(Begin, End, [&]( uint32_t i ) { Calls[i].fetch_add(1); }, Grain);
+
+        std::vector<uint32_t> Result(Count);
+        for (uint32_t i = 0; i < Count; ++i)
+            Result[i] = Calls[i].load();
+        return Result;
+    }
+
+    void CheckCoverage( uint32_t Begin, uint32_t End, uint32_t Grain )
+    {
+        const uint32_t Count = End + 8;
+        const std::vector<uint32_t> Calls = CountCalls(Count, Begin, End, Grain);
+        for (uint32_t i = 0; i < Count; ++i)
+            Assert::AreEqual(i >= Begin && i < End ? 1u : 0u, Calls[i], L"Each index of the range is called once, and no other");
+    }
+
+    uint32_t Fibonacci( uint32_t n )
+    {
+        if (n < 2)
+            return n;
+
+        uint32_t A, B;
+        TaskScheduler::TaskGroup Group;
+        Group.Run([&]{ A = Fibonacci(n - 1); });
+        Group.Run([&]{ B = Fibonacci(n - 2); });
+        Group.Wait();
+        return A + B;
+    }
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(TaskSchedulerTests)
+    {
+    public:
+
+        TEST_METHOD(ParallelForCallsEachIndexOnce)
+        {
+            const uint32_t Ranges[][3] =
+            {
+                // Begin, End, Grain
+                { 0, 0, 0 }, { 5, 5, 1 }, { 9, 3, 1 }, { 0, 1, 0 }, { 0, 100000, 0 }, { 0, 100000, 1 },
+                { 17, 10007, 7 }, { 3, 4099, 4096 }, { 1000, 1001, 1 }, { 0, 50000, 100000 }
+            };
+
+            // Without a pool, everything runs on the calling thread
+            for (const uint32_t* Range : Ranges)
+                CheckCoverage(Range[0], Range[1], Range[2]);
+
+            ScopedScheduler Scheduler;
+            for (const uint32_t* Range : Ranges)
+                CheckCoverage(Range[0], Range[1], Range[2]);
+
+            // A thread outside of the pool spawns to the shared queue and helps from there.  Asserts throw, so they
+            // are left to this thread.
+            uint32_t ForeignIndex = 0;
+            std::vector<std::vector<uint32_t>> ForeignCalls;
+            std::thread Foreign([&]
+            {
+                ForeignIndex = TaskScheduler::GetThreadIndex();
+                for (const uint32_t* Range : Ranges)
+                    ForeignCalls.push_back(CountCalls(Range[1] + 8, Range[0], Range[1], Range[2]));
+            });
+            Foreign.join();
+            Assert::AreEqual((uint32_t)TaskScheduler::kForeignThread, ForeignIndex);
+            for (size_t r = 0; r < _countof(Ranges); ++r)
+            {
+                for (uint32_t i = 0; i < ForeignCalls[r].size(); ++i)
+                {
+                    const bool InRange = i >= Ranges[r][0] && i < Ranges[r][1];
+                    Assert::AreEqual(InRange ? 1u : 0u, ForeignCalls[r][i], L"Each index of the range is called once, and no other");
+                }
+            }
+
+            // Every thread of the pool joins in on a range much larger than the pool
+            std::unique_ptr<std::atomic<uint32_t>[]> CallsPerThread(new std::atomic<uint32_t>[TaskScheduler::GetThreadCount()]);
+            for (uint32_t i = 0; i < TaskScheduler::GetThreadCount(); ++i)
+                CallsPerThread[i].store(0);
+            TaskScheduler::ParallelFor(0u, 1u << 16, [&]( uint32_t )
+            {
+                CallsPerThread[TaskScheduler::GetThreadIndex()].fetch_add(1);
+                std::this_thread::yield();
+            }, 16);
+            uint32_t NumCalls = 0;
+            for (uint32_t i = 0; i < TaskScheduler::GetThreadCount(); ++i)
+                NumCalls += CallsPerThread[i].load();
+            Assert::AreEqual(1u << 16, NumCalls);
+            Assert::IsTrue(CallsPerThread[0].load() < NumCalls, L"Workers steal part of the range");
+        }
+
+        TEST_METHOD(ParallelReduceIsDeterministic)
+        {
+            // Floating point sums of values of very different magnitudes depend on the order they are added in
+            const uint32_t Count = 200000;
+            Math::RandomNumberGenerator Rand(50);
+            std::vector<float> Values(Count);
+            for (float& Value : Values)
+                Value = Rand.NextFloat(-1.0f, 1.0f) * std::pow(10.0f, Rand.NextFloat(-6.0f, 6.0f));
+
+            auto SumRange = [&]( uint32_t Begin, uint32_t End )
+            {
+                float Sum = 0.0f;
+                for (uint32_t i = Begin; i < End; ++i)
+                    Sum += Values[i];
+                return Sum;
+            };
+            auto Add = []( float A, float B ) { return A + B; };
+
+            ScopedScheduler Scheduler;
+            for (uint32_t Grain : { 0u, 1u, 1000u, 4096u })
+            {
+                // The chunks ParallelReduce() documents, summed in order on this thread
+                const uint32_t ChunkSize = Grain == 0 ? TaskScheduler::GetDefaultGrain(Count) : Grain;
+                float Expected = SumRange(0, std::min(ChunkSize, Count));
+                for (uint32_t Begin = ChunkSize; Begin < Count; Begin += ChunkSize)
+                    Expected = Expected + SumRange(Begin, std::min(Begin + ChunkSize, Count));
+
+                for (uint32_t Run = 0; Run < 20; ++Run)
+                {
+                    const float Sum = TaskScheduler::ParallelReduce(0u, Count, 0.0f, SumRange, Add, Grain);
+                    Assert::IsTrue(memcmp(&Expected, &Sum, sizeof(float)) == 0, L"The sum is the same, bit for bit, on every run");
+                }
+            }
+
+            // Combine joins adjacent subranges in order:  concatenating them gives back the range
+            auto ListRange = []( uint32_t Begin, uint32_t End )
+            {
+                std::vector<uint32_t> List;
+                for (uint32_t i = Begin; i < End; ++i)
+                    List.push_back(i);
+                return List;
+            };
+            auto Concatenate = []( std::vector<uint32_t> A, const std::vector<uint32_t>& B )
+            {
+                A.insert(A.end(), B.begin(), B.end());
+                return A;
+            };
+            const std::vector<uint32_t> List = TaskScheduler::ParallelReduce(3u, 5003u, std::vector<uint32_t>(), ListRange, Concatenate, 7);
+            Assert::AreEqual((size_t)5000, List.size());
+            for (uint32_t i = 0; i < 5000; ++i)
+                Assert::AreEqual(i + 3, List[i], L"Subranges are combined in order");
+
+            Assert::AreEqual(-1.0f, TaskScheduler::ParallelReduce(7u, 7u, -1.0f, SumRange, Add), L"An empty range gives the identity");
+
+            // Grains as large as the range or larger, up to the largest index, are one subrange
+            const float WholeSum = SumRange(0, Count);
+            for (uint32_t Grain : { Count, Count + 1, 0xFFFFFFF0u, 0xFFFFFFFFu })
+            {
+                const float Sum = TaskScheduler::ParallelReduce(0u, Count, 0.0f, SumRange, Add, Grain);
+                Assert::IsTrue(memcmp(&WholeSum, &Sum, sizeof(float)) == 0, L"A grain past the end of the range gives one subrange");
+            }
+            auto CountRange = []( uint32_t Begin, uint32_t End ) { return End - Begin; };
+            auto AddCounts = []( uint32_t A, uint32_t B ) { return A + B; };
+            for (uint32_t Grain : { 0u, 300u, 999u, 0xFFFFFFFFu })
+                Assert::AreEqual(1000u, TaskScheduler::ParallelReduce(0xFFFFFFFFu - 1000, 0xFFFFFFFFu, 0u, CountRange, AddCounts, Grain), L"Subranges stop at the end of the range");
+
+            // Each task writes the value of its own subrange.  bools packed together would be written by several
+            // workers at once and lose some of them.
+            auto StartsAtMultipleOf3 = []( uint32_t Begin, uint32_t ) { return Begin % 3 == 0; };
+            auto Xor = []( bool A, bool B ) { return A != B; };
+            for (uint32_t Run = 0; Run < 20; ++Run)
+                Assert::IsTrue(TaskScheduler::ParallelReduce(0u, 30001u, false, StartsAtMultipleOf3, Xor, 1), L"Every bool subrange value is kept");
+        }
+
+        TEST_METHOD(TaskGraphRunsTasksAfterTheirDependencies)
+        {
+            // Random dependencies from earlier tasks to later ones, and a few tasks without any
+            const uint32_t NumTasks = 300;
+            Math::RandomNumberGenerator Rand(51);
+            std::vector<std::pair<uint32_t, uint32_t>> Dependencies;
+            for (uint32_t After = 1; After < NumTasks; ++After)
+            {
+                const uint32_t NumBefore = After % 10 == 0 ? 0 : (uint32_t)Rand.NextInt(3);
+                for (uint32_t d = 0; d < NumBefore; ++d)
+                    Dependencies.push_back(std::make_pair((uint32_t)Rand.NextInt(After - 1), After));
+            }
+
+            // A clock ticks at the start and the end of each task
+            std::atomic<uint32_t> Clock(0);
+            std::vector<uint32_t> Start(NumTasks), Finish(NumTasks), NumRuns(NumTasks);
+
+            TaskScheduler::TaskGraph Graph;
+            for (uint32_t i = 0; i < NumTasks; ++i)
+            {
+                Graph.AddTask([&, i]
+                {
+                    Start[i] = Clock.fetch_add(1);
+                    ++NumRuns[i];
+                    std::this_thread::yield();
+                    Finish[i] = Clock.fetch_add(1);
+                });
+            }
+            for (const std::pair<uint32_t, uint32_t>& Dependency : Dependencies)
+                Graph.AddDependency(Dependency.first, Dependency.second);
+
+            ScopedScheduler Scheduler;
+            for (uint32_t Run = 1; Run <= 3; ++Run)
+            {
+                Graph.Run();
+                for (uint32_t i = 0; i < NumTasks; ++i)
+                    Assert::AreEqual(Run, NumRuns[i], L"Each run runs every task once");
+                for (const std::pair<uint32_t, uint32_t>& Dependency : Dependencies)
+                    Assert::IsTrue(Finish[Dependency.first] < Start[Dependency.second], L"Tasks start after their dependencies are done");
+            }
+        }
+
+        TEST_METHOD(ExceptionsReachTheWaiter)
+        {
+            ScopedScheduler Scheduler;
+
+            // The other tasks of the group still run, and the group can be used again
+            std::atomic<uint32_t> NumRan(0);
+            TaskScheduler::TaskGroup Group;
+            for (uint32_t i = 0; i < 64; ++i)
+            {
+                Group.Run([&, i]
+                {
+                    if (i == 17)
+                        throw std::runtime_error("task 17");
+                    NumRan.fetch_add(1);
+                });
+            }
+            Assert::ExpectException<std::runtime_error>([&]{ Group.Wait(); }, L"TaskGroup::Wait() rethrows");
+            Assert::AreEqual(63u, NumRan.load());
+            Group.Run([&]{ NumRan.fetch_add(1); });
+            Group.Wait();
+            Assert::AreEqual(64u, NumRan.load());
+
+            // Tasks that haven't started when a task throws are skipped, and the next run starts over
+            bool Throw = true;
+            uint32_t NumAfter = 0;
+            TaskScheduler::TaskGraph Graph;
+            const uint32_t First = Graph.AddTask([]{});
+            const uint32_t Thrower = Graph.AddTask([&]{ if (Throw) throw std::logic_error("graph"); });
+            const uint32_t After = Graph.AddTask([&]{ ++NumAfter; });
+            Graph.AddDependency(First, Thrower);
+            Graph.AddDependency(Thrower, After);
+            Assert::ExpectException<std::logic_error>([&]{ Graph.Run(); }, L"TaskGraph::Run() rethrows");
+            Assert::AreEqual(0u, NumAfter, L"Successors of the task that threw don't run");
+            Throw = false;
+            Graph.Run();
+            Assert::AreEqual(1u, NumAfter);
+
+            // From any subrange, with the pool and without it
+            auto ThrowAt = []( uint32_t Index )
+            {
+                TaskScheduler::ParallelFor(0u, 10000u, [Index]( uint32_t i )
+                {
+                    if (i == Index)
+                        throw std::out_of_range("index");
+                }, 10);
+            };
+            for (uint32_t Index : { 0u, 4999u, 9999u })
+                Assert::ExpectException<std::out_of_range>([&]{ ThrowAt(Index); }, L"ParallelFor() rethrows");
+            CheckCoverage(0, 10000, 10);
+
+            TaskScheduler::Shutdown();
+            Assert::ExpectException<std::out_of_range>([&]{ ThrowAt(4999); }, L"ParallelFor() rethrows without a pool");
+            TaskScheduler::Initialize(3, false);
+        }
+
+        TEST_METHOD(NestedWaitsRunOtherTasks)
+        {
+            // One worker and many more waits than threads:  blocked waits would deadlock
+            ScopedScheduler Scheduler(1);
+            Assert::AreEqual(2584u, Fibonacci(18));
+
+            // Each outer task waits for inner tasks it spawned, and runs some of them itself meanwhile
+            const uint32_t NumOuter = 32, NumInner = 64;
+            std::vector<uint32_t> NumRanByWaiter(NumOuter);
+            std::atomic<uint32_t> NumInnerRan(0);
+            TaskScheduler::TaskGroup Outer;
+            for (uint32_t o = 0; o < NumOuter; ++o)
+            {
+                Outer.Run([&, o]
+                {
+                    const uint32_t Waiter = TaskScheduler::GetThreadIndex();
+                    std::atomic<uint32_t> RanByWaiter(0);
+                    TaskScheduler::TaskGroup Inner;
+                    for (uint32_t i = 0; i < NumInner; ++i)
+                    {
+                        Inner.Run([&]
+                        {
+                            if (TaskScheduler::GetThreadIndex() == Waiter)
+                                RanByWaiter.fetch_add(1);
+                            NumInnerRan.fetch_add(1);
+                        });
+                    }
+                    Inner.Wait();
+                    NumRanByWaiter[o] = RanByWaiter.load();
+                });
+            }
+            Outer.Wait();
+
+            // The waiter pops its own tasks first, so only a waiter that is preempted for long can lose all of them
+            Assert::AreEqual(NumOuter * NumInner, NumInnerRan.load());
+            const uint32_t NumHelped = (uint32_t)std::count_if(NumRanByWaiter.begin(), NumRanByWaiter.end(), []( uint32_t n ) { return n > 0; });
+            Assert::IsTrue(NumHelped >= NumOuter / 2, L"Waiting threads run tasks");
+
+            // ParallelFor() nested in ParallelFor()
+            std::atomic<uint32_t> Sum(0);
+            TaskScheduler::ParallelFor(0u, 100u, [&]( uint32_t )
+            {
+                TaskScheduler::ParallelFor(0u, 100u, [&]( uint32_t j ) { Sum.fetch_add(j); }, 1);
+            }, 1);
+            Assert::AreEqual(100u * 4950u, Sum.load());
+        }
+    };
+}
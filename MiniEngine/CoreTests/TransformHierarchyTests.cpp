@@ -0,0 +1,326 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Checks TransformHierarchy against world matrices computed recursively, through changes, adds and
+// removes, on wide, random and deep hierarchies, and measures its updates of a million nodes.
+//
+
+#include "stdafx.h"
+#include "Math/TransformHierarchy.h"
+#include "Math/Random.h"
+#include "TaskScheduler.h"
+#include <algorithm>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Math;
+
+namespace
+{
+    enum Shape
+    {
+        kRandomParents,     // Each node under a random earlier one, so that depth grows with the log of the count
+        kEightAry,          // A complete tree of eight children per node
+        kChains,            // Chains of 100 nodes
+        kNumShapes
+    };
+
+    const char* kShapeNames[kNumShapes] = { "random parents", "8-ary tree", "chains of 100" };
+
+    AffineTransform RandomLocal( RandomNumberGenerator& Rand )
+    {
+        const Vector3 Axis = Normalize(Vector3(Rand.NextFloat(-1.0f, 1.0f), Rand.NextFloat(-1.0f, 1.0f), 1.0f));
+        const Vector3 Translation(Rand.NextFloat(-1.0f, 1.0f), Rand.NextFloat(-1.0f, 1.0f), Rand.NextFloat(-1.0f, 1.0f));
+        return AffineTransform(Quaternion(Axis, Rand.NextFloat(-3.0f, 3.0f)), Translation);
+    }
+
+    // The hierarchy, with what the test knows of it by handle
+    struct Scene
+    {
+        TransformHierarchy Hierarchy;
+        std::vector<uint32_t> Parent;
+        std::vector<Matrix4> Local;
+        std::vector<bool> Alive;
+
+        uint32_t Add( uint32_t ParentNode, const AffineTransform& Transform )
+        {
+            const uint32_t Node = Hierarchy.AddNode(ParentNode, Transform);
+            if (Node >= Parent.size())
+            {
+                Parent.resize(Node + 1);
+                Local.resize(Node + 1);
+                Alive.resize(Node + 1);
+            }
+            Parent[Node] = ParentNode;
+            Local[Node] = Matrix4(Transform);
+            Alive[Node] = true;
+            return Node;
+        }
+
+        void Set( uint32_t Node, const AffineTransform& Transform )
+        {
+            Hierarchy.SetLocalTransform(Node, Transform);
+            Local[Node] = Matrix4(Transform);
+        }
+
+        void Remove( uint32_t Node )
+        {
+            Hierarchy.RemoveNode(Node);
+
+            // And every node below it
+            std::vector<bool> Removed(Alive.size());
+            for (uint32_t i = 0; i < Alive.size(); ++i)
+            {
+                for (uint32_t Ancestor = i; Ancestor != TransformHierarchy::kNullNode && Alive[Ancestor]; Ancestor = Parent[Ancestor])
+                {
+                    if (Ancestor == Node)
+                    {
+                        Removed[i] = true;
+                        break;
+                    }
+                }
+            }
+            for (uint32_t i = 0; i < Alive.size(); ++i)
+                Alive[i] = Alive[i] && !Removed[i];
+        }
+
+        uint32_t RandomAliveNode( RandomNumberGenerator& Rand ) const
+        {
+            uint32_t Node;
+            do
+                Node = Rand.NextInt((int32_t)Alive.size() - 1);
+            while (!Alive[Node]);
+            return Node;
+        }
+
+        void Build( Shape Type, uint32_t NumNodes, RandomNumberGenerator& Rand )
+        {
+            std::vector<uint32_t> Nodes;
+            Nodes.reserve(NumNodes);
+            for (uint32_t i = 0; i < NumNodes; ++i)
+            {
+                uint32_t ParentNode = TransformHierarchy::kNullNode;
+                if (Type == kRandomParents && i >= 100)
+                    ParentNode = Nodes[Rand.NextInt((int32_t)i - 1)];
+                else if (Type == kEightAry && i > 0)
+                    ParentNode = Nodes[(i - 1) / 8];
+                else if (Type == kChains && i % 100 != 0)
+                    ParentNode = Nodes[i - 1];
+                Nodes.push_back(Add(ParentNode, RandomLocal(Rand)));
+            }
+        }
+
+        // The world matrix of each live node, computed recursively, and how far the hierarchy's are from them
+        float MaxError( void ) const
+        {
+            std::vector<Matrix4> World(Alive.size());
+            std::vector<bool> Computed(Alive.size());
+            std::vector<uint32_t> Path;
+
+            float Error = 0.0f;
+            for (uint32_t Node = 0; Node < Alive.size(); ++Node)
+            {
+                if (!Alive[Node])
+                    continue;
+
+                for (uint32_t Ancestor = Node; Ancestor != TransformHierarchy::kNullNode && !Computed[Ancestor]; Ancestor = Parent[Ancestor])
+                    Path.push_back(Ancestor);
+                while (!Path.empty())
+                {
+                    const uint32_t Next = Path.back();
+                    Path.pop_back();
+                    World[Next] = Parent[Next] == TransformHierarchy::kNullNode ? Local[Next] : World[Parent[Next]] * Local[Next];
+                    Computed[Next] = true;
+                }
+
+                const Matrix4 Actual = Hierarchy.GetWorldMatrix(Node);
+                const float* A = (const float*)&Actual;
+                const float* Expected = (const float*)&World[Node];
+                for (int i = 0; i < 16; ++i)
+                    Error = std::max(Error, std::fabs(A[i] - Expected[i]) / (1.0f + std::fabs(Expected[i])));
+            }
+            return Error;
+        }
+
+        // Levels are contiguous, and each node is in the level after its parent's
+        bool LevelsAreOrdered( void ) const
+        {
+            auto LevelOf = [&]( uint32_t Node )
+            {
+                const uint32_t Index = Hierarchy.GetWorldIndex(Node);
+                uint32_t Level = 0;
+                while (Index >= Hierarchy.GetLevelStart(Level + 1))
+                    ++Level;
+                return Level;
+            };
+
+            for (uint32_t Node = 0; Node < Alive.size(); ++Node)
+            {
+                if (!Alive[Node])
+                    continue;
+                if (Hierarchy.GetParent(Node) != Parent[Node])
+                    return false;
+                const uint32_t Level = LevelOf(Node);
+                if (Parent[Node] == TransformHierarchy::kNullNode ? Level != 0 : Level != LevelOf(Parent[Node]) + 1)
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    // The straightforward way:  each node's children in a list, visited depth first
+    struct RecursiveHierarchy
+    {
+        std::vector<std::vector<uint32_t>> Children;
+        std::vector<uint32_t> Roots;
+        std::vector<Matrix4> World;
+
+        explicit RecursiveHierarchy( const Scene& Source ) : Children(Source.Parent.size()), World(Source.Parent.size())
+        {
+            for (uint32_t Node = 0; Node < Source.Parent.size(); ++Node)
+            {
+                if (Source.Parent[Node] == TransformHierarchy::kNullNode)
+                    Roots.push_back(Node);
+                else
+                    Children[Source.Parent[Node]].push_back(Node);
+            }
+        }
+
+        void Update( const std::vector<Matrix4>& Local )
+        {
+            for (uint32_t Root : Roots)
+            {
+                World[Root] = Local[Root];
+                Visit(Local, Root);
+            }
+        }
+
+        void Visit( const std::vector<Matrix4>& Local, uint32_t Node )
+        {
+            for (uint32_t Child : Children[Node])
+            {
+                World[Child] = World[Node] * Local[Child];
+                Visit(Local, Child);
+            }
+        }
+    };
+}
+
+namespace CoreTests
+{
+    TEST_CLASS(TransformHierarchyTests)
+    {
+    public:
+
+        TEST_METHOD(MatchesRecursion)
+        {
+            RandomNumberGenerator Rand(1);
+            for (int Type = 0; Type < kNumShapes; ++Type)
+            {
+                Scene Nodes;
+                Nodes.Build((Shape)Type, 20000, Rand);
+                Nodes.Hierarchy.Update();
+                const float BuildError = Nodes.MaxError();
+                Assert::IsTrue(Nodes.LevelsAreOrdered());
+
+                // Changes propagate to the descendants
+                for (int i = 0; i < 200; ++i)
+                    Nodes.Set(Nodes.RandomAliveNode(Rand), RandomLocal(Rand));
+                Nodes.Hierarchy.Update();
+                const float ChangeError = Nodes.MaxError();
+
+                // Removing subtrees and adding nodes reorders the levels
+                for (int i = 0; i < 20; ++i)
+                    Nodes.Remove(Nodes.RandomAliveNode(Rand));
+                for (int i = 0; i < 1000; ++i)
+                    Nodes.Add(Nodes.RandomAliveNode(Rand), RandomLocal(Rand));
+                for (int i = 0; i < 100; ++i)
+                    Nodes.Set(Nodes.RandomAliveNode(Rand), RandomLocal(Rand));
+                Nodes.Hierarchy.Update();
+                const float EditError = Nodes.MaxError();
+                Assert::IsTrue(Nodes.LevelsAreOrdered());
+                Assert::AreEqual((uint32_t)std::count(Nodes.Alive.begin(), Nodes.Alive.end(), true), Nodes.Hierarchy.GetNodeCount());
+
+                LogMessage("%s, %u nodes in %u levels:  largest relative error %.1e after building, %.1e after changes, %.1e after edits",
+                    kShapeNames[Type], Nodes.Hierarchy.GetNodeCount(), Nodes.Hierarchy.GetLevelCount(), BuildError, ChangeError, EditError);
+                Assert::IsTrue(BuildError < 1e-4f && ChangeError < 1e-4f && EditError < 1e-4f);
+            }
+        }
+
+        TEST_METHOD(UpdatesInParallel)
+        {
+            // The same hierarchy updated by the workers gives the same matrices, bit for bit
+            RandomNumberGenerator Rand(2);
+            Scene Serial, Parallel;
+            Serial.Build(kEightAry, 100000, Rand);
+            Rand = RandomNumberGenerator(2);
+            Parallel.Build(kEightAry, 100000, Rand);
+            Serial.Hierarchy.Update();
+
+            TaskScheduler::Initialize(0, false);
+            Parallel.Hierarchy.Update();
+            TaskScheduler::Shutdown();
+
+            const uint32_t NumNodes = Serial.Hierarchy.GetNodeCount();
+            Assert::IsTrue(memcmp(Serial.Hierarchy.GetWorldMatrices(), Parallel.Hierarchy.GetWorldMatrices(), NumNodes * sizeof(XMFLOAT4X4)) == 0);
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(MillionNodes)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(MillionNodes)
+        {
+            const uint32_t kNumNodes = 1000000;
+            RandomNumberGenerator Rand(3);
+            TaskScheduler::Initialize(0, false);
+            LogMessage("%u threads, times in ms", TaskScheduler::GetThreadCount());
+            LogMessage("%-16s %7s %9s %9s %9s %9s %9s", "", "Levels", "Recursive", "All", "All, 1T", "10%", "1%");
+
+            for (int Type = 0; Type < kNumShapes; ++Type)
+            {
+                Scene Nodes;
+                Nodes.Build((Shape)Type, kNumNodes, Rand);
+                Nodes.Hierarchy.Update();
+
+                RecursiveHierarchy Recursive(Nodes);
+                double Start = BenchmarkTime();
+                Recursive.Update(Nodes.Local);
+                const double RecursiveTime = BenchmarkTime() - Start;
+
+                // The time of Update() after a fraction of the nodes were changed, on the workers or the calling thread
+                auto TimeUpdate = [&]( uint32_t NumChanged, bool UseWorkers )
+                {
+                    for (uint32_t i = 0; i < NumChanged; ++i)
+                    {
+                        const uint32_t Node = NumChanged == kNumNodes ? i : Rand.NextInt(kNumNodes - 1);
+                        Nodes.Hierarchy.SetLocalTransform(Node, Nodes.Hierarchy.GetLocalTransform(Node));
+                    }
+                    if (!UseWorkers)
+                        TaskScheduler::Shutdown();
+                    const double UpdateStart = BenchmarkTime();
+                    Nodes.Hierarchy.Update();
+                    const double Time = BenchmarkTime() - UpdateStart;
+                    if (!UseWorkers)
+                        TaskScheduler::Initialize(0, false);
+                    return Time;
+                };
+
+                const double All = TimeUpdate(kNumNodes, true);
+                const double AllSerial = TimeUpdate(kNumNodes, false);
+                const double Tenth = TimeUpdate(kNumNodes / 10, true);
+                const double Hundredth = TimeUpdate(kNumNodes / 100, true);
+                LogMessage("%-16s %7u %9.2f %9.2f %9.2f %9.2f %9.2f", kShapeNames[Type], Nodes.Hierarchy.GetLevelCount(),
+                    RecursiveTime * 1e3, All * 1e3, AllSerial * 1e3, Tenth * 1e3, Hundredth * 1e3);
+            }
+
+            TaskScheduler::Shutdown();
+        }
+    };
+}
@@ -0,0 +1,45 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Unit tests and benchmarks for the parts of Core that run without a device, and for the ModelConverter
+// and ModelViewer code built into the tests.  Run them from Test Explorer or with vstest.console.exe CoreTests.dll.
+// The benchmarks are in the "Benchmark" category and only log their timings, so exclude them
+// (/TestCaseFilter:"TestCategory!=Benchmark") for a quick run, and measure with the Release configuration.
+//
+
+#pragma once
+
+#include "targetver.h"
+
+#include "pch.h"
+
+// Headers for CppUnitTest
+#include "CppUnitTest.h"
+
+#include <chrono>
+#include <cstdio>
+
+// Seconds since an arbitrary point, for the benchmarks
+inline double BenchmarkTime( void )
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Logs one line of a benchmark (or test) report to the test output
+inline void LogMessage( const char* Format, ... )
+{
+    char Buffer[512];
+    va_list Args;
+    va_start(Args, Format);
+    vsnprintf(Buffer, sizeof(Buffer) - 1, Format, Args);
+    va_end(Args);
+    strcat_s(Buffer, "\n");
+    Microsoft::VisualStudio::CppUnitTestFramework::Logger::WriteMessage(Buffer);
+}
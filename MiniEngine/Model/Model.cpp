@@ -22,6 +22,13 @@ Model::Model()
     , m_pIndexData(nullptr)
     , m_pVertexDataDepth(nullptr)
     , m_pIndexDataDepth(nullptr)
+    , m_pMeshletRange(nullptr)
+    , m_pMeshlet(nullptr)
+    , m_pMeshletVertices(nullptr)
+    , m_pMeshletTriangles(nullptr)
+    , m_pLodRange(nullptr)
+    , m_pLod(nullptr)
+    , m_pLodIndices(nullptr)
     , m_SRVs(nullptr)
 {
     Clear();
@@ -60,12 +67,44 @@ void Model::Clear()
     m_Header.vertexDataByteSizeDepth = 0;
     m_pIndexDataDepth = nullptr;
 
+    ClearMeshlets();
+    ClearLods();
+
     ReleaseTextures();
 
     m_Header.boundingBox.min = Vector3(0.0f);
     m_Header.boundingBox.max = Vector3(0.0f);
 }
 
+void Model::ClearMeshlets()
+{
+    delete [] m_pMeshletRange;
+    delete [] m_pMeshlet;
+    delete [] m_pMeshletVertices;
+    delete [] m_pMeshletTriangles;
+
+    m_pMeshletRange = nullptr;
+    m_pMeshlet = nullptr;
+    m_pMeshletVertices = nullptr;
+    m_pMeshletTriangles = nullptr;
+    m_MeshletHeader.meshletCount = 0;
+    m_MeshletHeader.vertexCount = 0;
+    m_MeshletHeader.triangleCount = 0;
+}
+
+void Model::ClearLods()
+{
+    delete [] m_pLodRange;
+    delete [] m_pLod;
+    delete [] m_pLodIndices;
+
+    m_pLodRange = nullptr;
+    m_pLod = nullptr;
+    m_pLodIndices = nullptr;
+    m_LodHeader.lodCount = 0;
+    m_LodHeader.indexCount = 0;
+}
+
 // assuming at least 3 floats for position
 void Model::ComputeMeshBoundingBox(unsigned int meshIndex, BoundingBox &bbox) const
 {
@@ -182,6 +182,97 @@ public:
     ByteAddressBuffer m_IndexBufferDepth;
     uint32_t m_VertexStrideDepth;
 
+    // Optional sections follow the vertex and index data of an H3D file, each
+    // introduced by a SectionHeader. Unknown sections are skipped on load, and
+    // files without any remain valid.
+    enum
+    {
+        section_meshlets = 0x4C48534D, // 'MSHL'
+        section_lods = 0x53444F4C, // 'LODS'
+    };
+
+    struct SectionHeader
+    {
+        uint32_t id;
+        uint32_t byteSize; // not including the header
+    };
+
+    // Meshlets partition each mesh's (color pass) index list into small, spatially
+    // coherent clusters that can be culled individually.
+    enum
+    {
+        maxMeshletVertices = 64,
+        maxMeshletTriangles = 124,
+    };
+
+    struct Meshlet
+    {
+        uint32_t vertexOffset; // into m_pMeshletVertices
+        uint32_t triangleOffset; // into m_pMeshletTriangles, in triangles
+        uint32_t vertexCount;
+        uint32_t triangleCount;
+
+        float boundingSphere[4]; // center and radius, in model space
+
+        // Normal cone. All triangles face away from the eye when
+        // dot(normalize(coneApex - eye), coneAxis) >= coneCutoff.
+        float coneApex[3];
+        float coneAxis[3];
+        float coneCutoff;
+    };
+
+    struct MeshletRange
+    {
+        uint32_t meshletOffset;
+        uint32_t meshletCount;
+    };
+
+    struct MeshletHeader
+    {
+        uint32_t meshletCount;
+        uint32_t vertexCount;
+        uint32_t triangleCount;
+    };
+    MeshletHeader m_MeshletHeader;
+    MeshletRange *m_pMeshletRange; // one per mesh, null if the model has no meshlets
+    Meshlet *m_pMeshlet;
+    uint16_t *m_pMeshletVertices; // mesh-relative vertex indices
+    uint8_t *m_pMeshletTriangles; // three meshlet-relative vertex indices per triangle
+
+    // Simplified index lists for each mesh, from the most detailed to the coarsest.
+    // They index the mesh's own vertices; the full detail index list is the implicit
+    // level 0. Once loaded, the LOD indices follow the regular indices in m_IndexBuffer.
+    enum { maxLods = 8 };
+
+    struct MeshLod
+    {
+        uint32_t indexOffset; // into m_pLodIndices
+        uint32_t indexCount;
+        float error; // (conservative) distance to the full detail mesh, in model space
+    };
+
+    struct LodRange
+    {
+        uint32_t lodOffset;
+        uint32_t lodCount;
+    };
+
+    struct LodHeader
+    {
+        uint32_t lodCount;
+        uint32_t indexCount;
+    };
+    LodHeader m_LodHeader;
+    LodRange *m_pLodRange; // one per mesh, null if the model has no LODs
+    MeshLod *m_pLod;
+    uint16_t *m_pLodIndices; // CPU copy, only kept by the converter
+
+    // First index of a LOD in m_IndexBuffer
+    uint32_t GetLodStartIndex(const MeshLod& lod) const
+    {
+        return m_Header.indexDataByteSize / sizeof(uint16_t) + lod.indexOffset;
+    }
+
     virtual bool Load(const char* filename)
     {
         return LoadH3D(filename);
@@ -206,6 +297,9 @@ protected:
     void ComputeGlobalBoundingBox(BoundingBox &bbox) const;
     void ComputeAllBoundingBoxes();
 
+    void ClearMeshlets();
+    void ClearLods();
+
     void ReleaseTextures();
     void LoadTextures();
     D3D12_CPU_DESCRIPTOR_HANDLE* m_SRVs;
@@ -79,8 +79,76 @@ bool Model::LoadH3D(const char *filename)
     if (m_Header.indexDataByteSize > 0)
         if (1 != fread(m_pIndexDataDepth, m_Header.indexDataByteSize, 1, file)) goto h3d_load_fail;
 
+    // optional sections, until the end of the file
+    ClearMeshlets();
+    ClearLods();
+    for (;;)
+    {
+        SectionHeader section;
+        if (1 != fread(&section, sizeof(SectionHeader), 1, file))
+            break;
+
+        long sectionEnd = ftell(file) + (long)section.byteSize;
+
+        switch (section.id)
+        {
+        case section_meshlets:
+            if (1 != fread(&m_MeshletHeader, sizeof(MeshletHeader), 1, file)) goto h3d_load_fail;
+
+            m_pMeshletRange = new MeshletRange [m_Header.meshCount];
+            m_pMeshlet = new Meshlet [m_MeshletHeader.meshletCount];
+            m_pMeshletVertices = new uint16_t [m_MeshletHeader.vertexCount];
+            m_pMeshletTriangles = new uint8_t [m_MeshletHeader.triangleCount * 3];
+
+            if (m_Header.meshCount > 0)
+                if (1 != fread(m_pMeshletRange, sizeof(MeshletRange) * m_Header.meshCount, 1, file)) goto h3d_load_fail;
+            if (m_MeshletHeader.meshletCount > 0)
+                if (1 != fread(m_pMeshlet, sizeof(Meshlet) * m_MeshletHeader.meshletCount, 1, file)) goto h3d_load_fail;
+            if (m_MeshletHeader.vertexCount > 0)
+                if (1 != fread(m_pMeshletVertices, sizeof(uint16_t) * m_MeshletHeader.vertexCount, 1, file)) goto h3d_load_fail;
+            if (m_MeshletHeader.triangleCount > 0)
+                if (1 != fread(m_pMeshletTriangles, 3 * m_MeshletHeader.triangleCount, 1, file)) goto h3d_load_fail;
+            break;
+
+        case section_lods:
+            if (1 != fread(&m_LodHeader, sizeof(LodHeader), 1, file)) goto h3d_load_fail;
+
+            m_pLodRange = new LodRange [m_Header.meshCount];
+            m_pLod = new MeshLod [m_LodHeader.lodCount];
+            m_pLodIndices = new uint16_t [m_LodHeader.indexCount];
+
+            if (m_Header.meshCount > 0)
+                if (1 != fread(m_pLodRange, sizeof(LodRange) * m_Header.meshCount, 1, file)) goto h3d_load_fail;
+            if (m_LodHeader.lodCount > 0)
+                if (1 != fread(m_pLod, sizeof(MeshLod) * m_LodHeader.lodCount, 1, file)) goto h3d_load_fail;
+            if (m_LodHeader.indexCount > 0)
+                if (1 != fread(m_pLodIndices, sizeof(uint16_t) * m_LodHeader.indexCount, 1, file)) goto h3d_load_fail;
+            break;
+
+        default:
+            // unknown section, skip it
+            break;
+        }
+
+        if (0 != fseek(file, sectionEnd, SEEK_SET)) goto h3d_load_fail;
+    }
+
     m_VertexBuffer.Create(L"VertexBuffer", m_Header.vertexDataByteSize / m_VertexStride, m_VertexStride, m_pVertexData);
-    m_IndexBuffer.Create(L"IndexBuffer", m_Header.indexDataByteSize / sizeof(uint16_t), sizeof(uint16_t), m_pIndexData);
+    if (m_LodHeader.indexCount > 0)
+    {
+        // LOD indices go after the regular ones, see GetLodStartIndex()
+        unsigned char *indexData = new unsigned char[ m_Header.indexDataByteSize + sizeof(uint16_t) * m_LodHeader.indexCount ];
+        memcpy(indexData, m_pIndexData, m_Header.indexDataByteSize);
+        memcpy(indexData + m_Header.indexDataByteSize, m_pLodIndices, sizeof(uint16_t) * m_LodHeader.indexCount);
+        m_IndexBuffer.Create(L"IndexBuffer", m_Header.indexDataByteSize / sizeof(uint16_t) + m_LodHeader.indexCount, sizeof(uint16_t), indexData);
+        delete [] indexData;
+        delete [] m_pLodIndices;
+        m_pLodIndices = nullptr;
+    }
+    else
+    {
+        m_IndexBuffer.Create(L"IndexBuffer", m_Header.indexDataByteSize / sizeof(uint16_t), sizeof(uint16_t), m_pIndexData);
+    }
     delete [] m_pVertexData;
     m_pVertexData = nullptr;
     delete [] m_pIndexData;
@@ -130,6 +198,54 @@ bool Model::SaveH3D(const char *filename) const
     if (m_Header.indexDataByteSize > 0)
         if (1 != fwrite(m_pIndexDataDepth, m_Header.indexDataByteSize, 1, file)) goto h3d_save_fail;
 
+    if (m_pMeshletRange != nullptr)
+    {
+        uint32_t triangleByteSize = 3 * m_MeshletHeader.triangleCount;
+        uint32_t padding = (4 - (triangleByteSize & 3)) & 3;
+        const uint32_t zero = 0;
+
+        SectionHeader section;
+        section.id = section_meshlets;
+        section.byteSize = sizeof(MeshletHeader) + sizeof(MeshletRange) * m_Header.meshCount + sizeof(Meshlet) * m_MeshletHeader.meshletCount
+            + sizeof(uint16_t) * m_MeshletHeader.vertexCount + triangleByteSize + padding;
+
+        if (1 != fwrite(&section, sizeof(SectionHeader), 1, file)) goto h3d_save_fail;
+        if (1 != fwrite(&m_MeshletHeader, sizeof(MeshletHeader), 1, file)) goto h3d_save_fail;
+        if (m_Header.meshCount > 0)
+            if (1 != fwrite(m_pMeshletRange, sizeof(MeshletRange) * m_Header.meshCount, 1, file)) goto h3d_save_fail;
+        if (m_MeshletHeader.meshletCount > 0)
+            if (1 != fwrite(m_pMeshlet, sizeof(Meshlet) * m_MeshletHeader.meshletCount, 1, file)) goto h3d_save_fail;
+        if (m_MeshletHeader.vertexCount > 0)
+            if (1 != fwrite(m_pMeshletVertices, sizeof(uint16_t) * m_MeshletHeader.vertexCount, 1, file)) goto h3d_save_fail;
+        if (triangleByteSize > 0)
+            if (1 != fwrite(m_pMeshletTriangles, triangleByteSize, 1, file)) goto h3d_save_fail;
+        if (padding > 0)
+            if (1 != fwrite(&zero, padding, 1, file)) goto h3d_save_fail;
+    }
+
+    if (m_pLodRange != nullptr)
+    {
+        uint32_t indexByteSize = sizeof(uint16_t) * m_LodHeader.indexCount;
+        uint32_t padding = (4 - (indexByteSize & 3)) & 3;
+        const uint32_t zero = 0;
+
+        SectionHeader section;
+        section.id = section_lods;
+        section.byteSize = sizeof(LodHeader) + sizeof(LodRange) * m_Header.meshCount + sizeof(MeshLod) * m_LodHeader.lodCount
+            + indexByteSize + padding;
+
+        if (1 != fwrite(&section, sizeof(SectionHeader), 1, file)) goto h3d_save_fail;
+        if (1 != fwrite(&m_LodHeader, sizeof(LodHeader), 1, file)) goto h3d_save_fail;
+        if (m_Header.meshCount > 0)
+            if (1 != fwrite(m_pLodRange, sizeof(LodRange) * m_Header.meshCount, 1, file)) goto h3d_save_fail;
+        if (m_LodHeader.lodCount > 0)
+            if (1 != fwrite(m_pLod, sizeof(MeshLod) * m_LodHeader.lodCount, 1, file)) goto h3d_save_fail;
+        if (indexByteSize > 0)
+            if (1 != fwrite(m_pLodIndices, indexByteSize, 1, file)) goto h3d_save_fail;
+        if (padding > 0)
+            if (1 != fwrite(&zero, padding, 1, file)) goto h3d_save_fail;
+    }
+
     ok = true;
 
 h3d_save_fail:
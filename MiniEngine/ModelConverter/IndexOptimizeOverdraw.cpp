@@ -0,0 +1,354 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include <algorithm>
+
+#include "IndexOptimizeOverdraw.h"
+
+namespace
+{
+    struct Float3
+    {
+        float x, y, z;
+
+        float operator[](int n) const { return (&x)[n]; }
+    };
+
+    inline Float3 LoadPosition(const float* vertexPositions, uint32_t vertexStride, uint32_t index)
+    {
+        Float3 p;
+        memcpy(&p, (const unsigned char*)vertexPositions + index * vertexStride, sizeof(Float3));
+        return p;
+    }
+
+    // FIFO post-transform cache. Vertices are timestamped when they enter the cache, so
+    // a vertex is still cached if fewer than cacheSize vertices entered after it.
+    class FifoCache
+    {
+    public:
+        FifoCache(uint32_t vertexCount, uint32_t cacheSize)
+            : m_Timestamp(vertexCount, 0), m_CacheSize(cacheSize), m_Time(cacheSize + 1)
+        {
+        }
+
+        void Flush()
+        {
+            m_Time += m_CacheSize + 1;
+        }
+
+        uint32_t ProcessTriangle(uint32_t i0, uint32_t i1, uint32_t i2)
+        {
+            return ProcessVertex(i0) + ProcessVertex(i1) + ProcessVertex(i2);
+        }
+
+    private:
+        uint32_t ProcessVertex(uint32_t index)
+        {
+            if (m_Time - m_Timestamp[index] <= m_CacheSize)
+                return 0;
+            m_Timestamp[index] = m_Time++;
+            return 1;
+        }
+
+        std::vector<uint32_t> m_Timestamp;
+        uint32_t m_CacheSize;
+        uint32_t m_Time;
+    };
+
+    // Splits the triangles into clusters, first where the cache gets completely flushed
+    // (all three vertices of a triangle miss), then within those where the ACMR of the
+    // cluster so far drops under the threshold. Flushing the cache at each cluster start
+    // bounds the ACMR of the final order to about acmrThreshold times the input's.
+    template <typename IndexType>
+    void FindClusters(const IndexType* indexList, uint32_t triangleCount, uint32_t vertexCount, uint32_t fifoCacheSize,
+        float acmrThreshold, std::vector<uint32_t>& clusters)
+    {
+        FifoCache cache(vertexCount, fifoCacheSize);
+
+        std::vector<uint32_t> hardBoundaries;
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            uint32_t misses = cache.ProcessTriangle(indexList[t * 3 + 0], indexList[t * 3 + 1], indexList[t * 3 + 2]);
+            if (t == 0 || misses == 3)
+                hardBoundaries.push_back(t);
+        }
+        hardBoundaries.push_back(triangleCount);
+
+        for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+        {
+            uint32_t start = hardBoundaries[h];
+            uint32_t end = hardBoundaries[h + 1];
+
+            cache.Flush();
+            uint32_t hardMisses = 0;
+            for (uint32_t t = start; t < end; t++)
+                hardMisses += cache.ProcessTriangle(indexList[t * 3 + 0], indexList[t * 3 + 1], indexList[t * 3 + 2]);
+            float missLimit = (float)hardMisses / (float)(end - start) * acmrThreshold;
+
+            cache.Flush();
+            uint32_t clusterStart = start;
+            uint32_t clusterMisses = 0;
+            for (uint32_t t = start; t < end; t++)
+            {
+                clusterMisses += cache.ProcessTriangle(indexList[t * 3 + 0], indexList[t * 3 + 1], indexList[t * 3 + 2]);
+                if ((float)clusterMisses <= missLimit * (float)(t - clusterStart + 1))
+                {
+                    clusters.push_back(clusterStart);
+                    cache.Flush();
+                    clusterStart = t + 1;
+                    clusterMisses = 0;
+                }
+            }
+            if (clusterStart < end)
+                clusters.push_back(clusterStart);
+        }
+        clusters.push_back(triangleCount);
+    }
+
+    // Rasterizes a triangle with a top-left fill rule, counting the fragments that pass the depth test
+    void RasterizeTriangle(float x0, float y0, float z0, float x1, float y1, float z1, float x2, float y2, float z2,
+        float* depthBuffer, int size, uint64_t& pixelsShaded)
+    {
+        float area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+        if (area <= 0.0f)
+            return;
+
+        int minX = std::max((int)floorf(std::min(x0, std::min(x1, x2))), 0);
+        int maxX = std::min((int)ceilf(std::max(x0, std::max(x1, x2))), size - 1);
+        int minY = std::max((int)floorf(std::min(y0, std::min(y1, y2))), 0);
+        int maxY = std::min((int)ceilf(std::max(y0, std::max(y1, y2))), size - 1);
+
+        // edge i is opposite to vertex i; top and left edges own the pixels exactly on them
+        float ex[3] = { x2 - x1, x0 - x2, x1 - x0 };
+        float ey[3] = { y2 - y1, y0 - y2, y1 - y0 };
+        bool topLeft[3];
+        for (int e = 0; e < 3; e++)
+            topLeft[e] = ey[e] < 0.0f || (ey[e] == 0.0f && ex[e] > 0.0f);
+
+        float invArea = 1.0f / area;
+        for (int y = minY; y <= maxY; y++)
+        {
+            float py = y + 0.5f;
+            for (int x = minX; x <= maxX; x++)
+            {
+                float px = x + 0.5f;
+                float w0 = (x2 - x1) * (py - y1) - (y2 - y1) * (px - x1);
+                float w1 = (x0 - x2) * (py - y2) - (y0 - y2) * (px - x2);
+                float w2 = (x1 - x0) * (py - y0) - (y1 - y0) * (px - x0);
+
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                    continue;
+                if ((w0 == 0.0f && !topLeft[0]) || (w1 == 0.0f && !topLeft[1]) || (w2 == 0.0f && !topLeft[2]))
+                    continue;
+
+                float z = (w0 * z0 + w1 * z1 + w2 * z2) * invArea;
+                float& depth = depthBuffer[y * size + x];
+                if (z < depth)
+                {
+                    depth = z;
+                    pixelsShaded++;
+                }
+            }
+        }
+    }
+}
+
+template <typename IndexType>
+float ComputeACMR(const IndexType* indexList, uint32_t indexCount, uint32_t vertexCount, uint32_t fifoCacheSize)
+{
+    uint32_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return 0.0f;
+
+    FifoCache cache(vertexCount, fifoCacheSize);
+    uint32_t misses = 0;
+    for (uint32_t t = 0; t < triangleCount; t++)
+        misses += cache.ProcessTriangle(indexList[t * 3 + 0], indexList[t * 3 + 1], indexList[t * 3 + 2]);
+
+    return (float)misses / (float)triangleCount;
+}
+
+template <typename IndexType>
+void OptimizeOverdraw(const IndexType* indexList, uint32_t indexCount, const float* vertexPositions, uint32_t vertexStride,
+    uint32_t vertexCount, IndexType* newIndexList, uint32_t fifoCacheSize, float acmrThreshold)
+{
+    uint32_t triangleCount = indexCount / 3;
+
+    std::vector<uint32_t> clusters;
+    FindClusters(indexList, triangleCount, vertexCount, fifoCacheSize, acmrThreshold, clusters);
+    uint32_t clusterCount = (uint32_t)clusters.size() - 1;
+
+    if (clusterCount <= 1)
+    {
+        memcpy(newIndexList, indexList, sizeof(IndexType) * indexCount);
+        return;
+    }
+
+    // area weighted centroid and normal of each cluster, and of the whole mesh
+    std::vector<Float3> clusterCentroid(clusterCount);
+    std::vector<Float3> clusterNormal(clusterCount);
+    double meshCentroid[3] = { 0.0, 0.0, 0.0 };
+    double meshArea = 0.0;
+
+    for (uint32_t c = 0; c < clusterCount; c++)
+    {
+        double centroid[3] = { 0.0, 0.0, 0.0 };
+        double normal[3] = { 0.0, 0.0, 0.0 };
+        double clusterArea = 0.0;
+
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            Float3 p0 = LoadPosition(vertexPositions, vertexStride, indexList[t * 3 + 0]);
+            Float3 p1 = LoadPosition(vertexPositions, vertexStride, indexList[t * 3 + 1]);
+            Float3 p2 = LoadPosition(vertexPositions, vertexStride, indexList[t * 3 + 2]);
+
+            double e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+            double e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+            double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            double area = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int k = 0; k < 3; k++)
+            {
+                centroid[k] += area * (p0[k] + p1[k] + p2[k]) / 3.0;
+                normal[k] += n[k];
+            }
+            clusterArea += area;
+        }
+
+        for (int k = 0; k < 3; k++)
+            meshCentroid[k] += centroid[k];
+        meshArea += clusterArea;
+
+        double invArea = clusterArea > 0.0 ? 1.0 / clusterArea : 0.0;
+        double normalLength = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        double invNormalLength = normalLength > 0.0 ? 1.0 / normalLength : 0.0;
+
+        clusterCentroid[c].x = (float)(centroid[0] * invArea);
+        clusterCentroid[c].y = (float)(centroid[1] * invArea);
+        clusterCentroid[c].z = (float)(centroid[2] * invArea);
+        clusterNormal[c].x = (float)(normal[0] * invNormalLength);
+        clusterNormal[c].y = (float)(normal[1] * invNormalLength);
+        clusterNormal[c].z = (float)(normal[2] * invNormalLength);
+    }
+
+    if (meshArea > 0.0)
+    {
+        for (int k = 0; k < 3; k++)
+            meshCentroid[k] /= meshArea;
+    }
+
+    // Occlusion potential: clusters far out from the center and facing away from it tend to
+    // hide the rest of the mesh, from any direction they are visible from, so draw them first
+    std::vector<float> occlusionPotential(clusterCount);
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    for (uint32_t c = 0; c < clusterCount; c++)
+    {
+        occlusionPotential[c] = (float)((clusterCentroid[c].x - meshCentroid[0]) * clusterNormal[c].x
+            + (clusterCentroid[c].y - meshCentroid[1]) * clusterNormal[c].y
+            + (clusterCentroid[c].z - meshCentroid[2]) * clusterNormal[c].z);
+        clusterOrder[c] = c;
+    }
+
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+        [&occlusionPotential](uint32_t a, uint32_t b) { return occlusionPotential[a] > occlusionPotential[b]; });
+
+    IndexType *dst = newIndexList;
+    for (uint32_t c : clusterOrder)
+    {
+        uint32_t clusterIndexCount = (clusters[c + 1] - clusters[c]) * 3;
+        memcpy(dst, indexList + clusters[c] * 3, sizeof(IndexType) * clusterIndexCount);
+        dst += clusterIndexCount;
+    }
+
+    // clusters are cut at cache flushes, but the order they end up in may still cost a few extra misses
+    float inputACMR = ComputeACMR(indexList, indexCount, vertexCount, fifoCacheSize);
+    float outputACMR = ComputeACMR(newIndexList, indexCount, vertexCount, fifoCacheSize);
+    if (outputACMR > inputACMR * acmrThreshold)
+        memcpy(newIndexList, indexList, sizeof(IndexType) * indexCount);
+}
+
+template <typename IndexType>
+void AnalyzeOverdraw(const IndexType* indexList, uint32_t indexCount, const float* vertexPositions, uint32_t vertexStride,
+    uint32_t vertexCount, OverdrawStats& stats)
+{
+    enum { viewportSize = 256 };
+
+    if (indexCount == 0)
+        return;
+
+    Float3 boundsMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+    Float3 boundsMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (uint32_t n = 0; n < indexCount; n++)
+    {
+        Float3 p = LoadPosition(vertexPositions, vertexStride, indexList[n]);
+        boundsMin.x = std::min(boundsMin.x, p.x); boundsMax.x = std::max(boundsMax.x, p.x);
+        boundsMin.y = std::min(boundsMin.y, p.y); boundsMax.y = std::max(boundsMax.y, p.y);
+        boundsMin.z = std::min(boundsMin.z, p.z); boundsMax.z = std::max(boundsMax.z, p.z);
+    }
+    float extent = std::max(boundsMax.x - boundsMin.x, std::max(boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z));
+    float scale = extent > 0.0f ? (viewportSize - 1) / extent : 0.0f;
+
+    std::vector<Float3> positions(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        Float3 p = LoadPosition(vertexPositions, vertexStride, v);
+        positions[v].x = (p.x - boundsMin.x) * scale;
+        positions[v].y = (p.y - boundsMin.y) * scale;
+        positions[v].z = (p.z - boundsMin.z) * scale;
+    }
+
+    std::vector<float> depthBuffer(viewportSize * viewportSize);
+
+    // orthographic views down each axis, from both sides
+    for (int axis = 0; axis < 3; axis++)
+    {
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+
+        for (int side = 0; side < 2; side++)
+        {
+            std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+
+            // looking down -axis from the positive side, the nearest points have the largest coordinate;
+            // from the negative side the view is mirrored, which also flips the winding
+            float depthSign = side == 0 ? -1.0f : 1.0f;
+
+            for (uint32_t n = 0; n + 2 < indexCount; n += 3)
+            {
+                const Float3& p0 = positions[indexList[n + 0]];
+                const Float3& p1 = positions[indexList[n + (side == 0 ? 1 : 2)]];
+                const Float3& p2 = positions[indexList[n + (side == 0 ? 2 : 1)]];
+
+                RasterizeTriangle(p0[u], p0[v], depthSign * p0[axis], p1[u], p1[v], depthSign * p1[axis], p2[u], p2[v], depthSign * p2[axis],
+                    depthBuffer.data(), viewportSize, stats.pixelsShaded);
+            }
+
+            for (float depth : depthBuffer)
+                stats.pixelsCovered += depth != FLT_MAX ? 1 : 0;
+        }
+    }
+}
+
+template void OptimizeOverdraw<uint16_t>(const uint16_t* indexList, uint32_t indexCount, const float* vertexPositions, uint32_t vertexStride,
+    uint32_t vertexCount, uint16_t* newIndexList, uint32_t fifoCacheSize, float acmrThreshold);
+template void OptimizeOverdraw<uint32_t>(const uint32_t* indexList, uint32_t indexCount, const float* vertexPositions, uint32_t vertexStride,
+    uint32_t vertexCount, uint32_t* newIndexList, uint32_t fifoCacheSize, float acmrThreshold);
+
+template float ComputeACMR<uint16_t>(const uint16_t* indexList, uint32_t indexCount, uint32_t vertexCount, uint32_t fifoCacheSize);
+template float ComputeACMR<uint32_t>(const uint32_t* indexList, uint32_t indexCount, uint32_t vertexCount, uint32_t fifoCacheSize);
+
+template void AnalyzeOverdraw<uint16_t>(const uint16_t* indexList, uint32_t indexCount, const float* vertexPositions, uint32_t vertexStride,
+    uint32_t vertexCount, OverdrawStats& stats);
+template void AnalyzeOverdraw<uint32_t>(const uint32_t* indexList, uint32_t indexCount, const float* vertexPositions, uint32_t vertexStride,
+    uint32_t vertexCount, OverdrawStats& stats);
@@ -0,0 +1,81 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+//  OptimizeOverdraw
+//-----------------------------------------------------------------------------
+//  Reorders the triangles of a vertex cache optimized index list to reduce
+//  overdraw, as described in "Fast Triangle Reordering for Vertex Locality
+//  and Reduced Overdraw" (Sander, Nehab, Barczak 2007). The list is split into
+//  clusters wherever the cache is flushed anyway, and where the cache miss
+//  ratio so far is low enough, then clusters are sorted so that the ones most
+//  likely to occlude the others (far from the mesh center, facing outwards)
+//  are drawn first.
+//
+//  Parameters:
+//      indexList
+//          input index list, typically the output of OptimizeFaces
+//      indexCount
+//          the number of indices in the list
+//      vertexPositions
+//          a pointer to the position (3 floats) of the first vertex
+//      vertexStride
+//          the distance in bytes between two vertex positions
+//      vertexCount
+//          the number of vertices, larger than any index in indexList
+//      newIndexList
+//          a pointer to a preallocated buffer the same size as indexList to
+//          hold the reordered index list
+//      fifoCacheSize
+//          the size of the simulated FIFO post-transform cache used to
+//          measure the ACMR (average cache miss ratio)
+//      acmrThreshold
+//          how much the ACMR may grow, relative to the input (e.g. 1.05). If
+//          the reordered list exceeds it, the input order is kept
+//-----------------------------------------------------------------------------
+template <typename IndexType>
+void OptimizeOverdraw(const IndexType* indexList, uint32_t indexCount, const float* vertexPositions, uint32_t vertexStride,
+    uint32_t vertexCount, IndexType* newIndexList, uint32_t fifoCacheSize, float acmrThreshold);
+
+//-----------------------------------------------------------------------------
+//  ComputeACMR
+//-----------------------------------------------------------------------------
+//  Returns the average number of post-transform cache misses per triangle of
+//  an index list, simulating a FIFO cache of fifoCacheSize entries.
+//-----------------------------------------------------------------------------
+template <typename IndexType>
+float ComputeACMR(const IndexType* indexList, uint32_t indexCount, uint32_t vertexCount, uint32_t fifoCacheSize);
+
+//-----------------------------------------------------------------------------
+//  OverdrawStats
+//-----------------------------------------------------------------------------
+//  Measures overdraw without a GPU: the mesh is rasterized in software, with
+//  back face culling and a depth test, from the six axis aligned directions.
+//  Overdraw is the number of pixels shaded (that passed the depth test) per
+//  pixel covered. 1.0 is perfect front to back order. AnalyzeOverdraw adds its
+//  counts to stats, so that several meshes can be accumulated.
+//-----------------------------------------------------------------------------
+struct OverdrawStats
+{
+    uint64_t pixelsCovered;
+    uint64_t pixelsShaded;
+
+    float GetOverdraw() const
+    {
+        return pixelsCovered > 0 ? (float)pixelsShaded / (float)pixelsCovered : 0.0f;
+    }
+};
+
+template <typename IndexType>
+void AnalyzeOverdraw(const IndexType* indexList, uint32_t indexCount, const float* vertexPositions, uint32_t vertexStride,
+    uint32_t vertexCount, OverdrawStats& stats);
@@ -20,6 +20,8 @@
 #include <assert.h>
 #include <math.h>
 #include <algorithm>
+#include <limits>
+#include <vector>
 
 #include "IndexOptimizePostTransform.h"
 
@@ -143,65 +145,89 @@ namespace
     template <typename IndexType>
     struct OptimizeVertexData
     {
-        float   score;
         uint32_t    activeFaceListStart;
         uint32_t    activeFaceListSize;
         IndexType  cachePos0;
         IndexType  cachePos1;
-        OptimizeVertexData() : score(0.f), activeFaceListStart(0), activeFaceListSize(0), cachePos0(0), cachePos1(0) { }
+        OptimizeVertexData() : activeFaceListStart(0), activeFaceListSize(0), cachePos0(0), cachePos1(0) { }
     };
 }
 
-template <typename T, typename IndexType>
-struct IndexSortCompareIndexed
+namespace
 {
-    const IndexType *_indexData;
+    // Scratch memory of OptimizeFaces. It is kept per thread and reused from one call to the
+    // next, so that converting a model with many meshes doesn't allocate for each of them.
+    template <typename IndexType>
+    struct OptimizeFacesArena
+    {
+        std::vector<OptimizeVertexData<IndexType>> vertexDataList;
+        std::vector<float> vertexScores; // kept apart from vertexDataList, they are read most often
+        std::vector<IndexType> vertexRemap;
+        std::vector<uint32_t> activeFaceList;
+        std::vector<uint8_t> processedFaceList;
+        std::vector<uint32_t> faceScoredStep;
+        std::vector<uint32_t> sortedCorners;
+        std::vector<uint32_t> sortScratch;
+        std::vector<IndexType> sortKeys;
+        std::vector<IndexType> sortKeyScratch;
+    };
 
-    IndexSortCompareIndexed(const IndexType *indexData)
-        : _indexData(indexData)
+    template <typename IndexType>
+    OptimizeFacesArena<IndexType>& GetOptimizeFacesArena()
     {
+        thread_local OptimizeFacesArena<IndexType> arena;
+        return arena;
     }
 
-    bool operator()(T a, T b) const
+    // Sorts the corners (positions in indexList) by index value with an LSD radix sort, one
+    // byte per pass. Passes where every index has the same digit are skipped. The keys move
+    // along with the corners, so that each pass reads its input sequentially.
+    template <typename IndexType>
+    void RadixSortCorners(const IndexType* indexList, uint32_t indexCount, OptimizeFacesArena<IndexType>& arena)
     {
-        IndexType indexA = _indexData[a];
-        IndexType indexB = _indexData[b];
-
-        if (indexA < indexB)
-            return true;
-        return false;
-    }
-};
+        std::vector<uint32_t>& sorted = arena.sortedCorners;
+        std::vector<uint32_t>& scratch = arena.sortScratch;
+        std::vector<IndexType>& keys = arena.sortKeys;
+        std::vector<IndexType>& keyScratch = arena.sortKeyScratch;
+
+        sorted.resize(indexCount);
+        scratch.resize(indexCount);
+        keys.assign(indexList, indexList + indexCount);
+        keyScratch.resize(indexCount);
+        for (uint32_t i = 0; i < indexCount; i++)
+        {
+            sorted[i] = i;
+        }
 
-template <typename T, typename IndexType>
-struct FaceValenceSort
-{
-    const OptimizeVertexData<IndexType> *_vertexData;
+        for (uint32_t shift = 0; shift < sizeof(IndexType) * 8; shift += 8)
+        {
+            uint32_t histogram[256] = {};
+            for (uint32_t i = 0; i < indexCount; i++)
+            {
+                histogram[(keys[i] >> shift) & 0xff]++;
+            }
+            if (histogram[(keys[0] >> shift) & 0xff] == indexCount)
+                continue;
 
-    FaceValenceSort(const OptimizeVertexData<IndexType> *vertexData)
-        : _vertexData(vertexData)
-    {
-    }
+            uint32_t offset = 0;
+            for (uint32_t digit = 0; digit < 256; digit++)
+            {
+                uint32_t count = histogram[digit];
+                histogram[digit] = offset;
+                offset += count;
+            }
 
-    bool operator()(T a, T b) const
-    {
-        const OptimizeVertexData<IndexType> *vA0 = _vertexData + a * 3 + 0;
-        const OptimizeVertexData<IndexType> *vA1 = _vertexData + a * 3 + 1;
-        const OptimizeVertexData<IndexType> *vA2 = _vertexData + a * 3 + 2;
-        const OptimizeVertexData<IndexType> *vB0 = _vertexData + b * 3 + 0;
-        const OptimizeVertexData<IndexType> *vB1 = _vertexData + b * 3 + 1;
-        const OptimizeVertexData<IndexType> *vB2 = _vertexData + b * 3 + 2;
-
-        int aValence = vA0->activeFaceListSize + vA1->activeFaceListSize + vA2->activeFaceListSize;
-        int bValence = vB0->activeFaceListSize + vB1->activeFaceListSize + vB2->activeFaceListSize;
-
-        // higher scoring faces are those with lower valence totals
-        // reverse sort (reverse of reverse)
-        if (aValence < bValence)
-            return true;
-        return false;
+            for (uint32_t i = 0; i < indexCount; i++)
+            {
+                uint32_t slot = histogram[(keys[i] >> shift) & 0xff]++;
+                scratch[slot] = sorted[i];
+                keyScratch[slot] = keys[i];
+            }
+            sorted.swap(scratch);
+            keys.swap(keyScratch);
+        }
     }
-};
+}
 
 //-----------------------------------------------------------------------------
 //  OptimizeFaces
@@ -211,8 +237,6 @@ struct FaceValenceSort
 //          input index list
 //      indexCount
 //          the number of indices in the list
-//      vertexCount
-//          the largest index value in indexList
 //      newIndexList
 //          a pointer to a preallocated buffer the same size as indexList to
 //          hold the optimized index list
@@ -222,34 +246,59 @@ struct FaceValenceSort
 template <typename IndexType>
 void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* newIndexList, uint16_t lruCacheSize)
 {
-    OptimizeVertexData<IndexType> *vertexDataList = new OptimizeVertexData<IndexType> [indexCount]; // upper bounds on size is indexCount
-    IndexType *vertexRemap = new IndexType [indexCount];
-    uint32_t *activeFaceList = new uint32_t [indexCount];
+    if (indexCount == 0)
+        return;
 
-    uint32_t faceCount = indexCount / 3;
-    uint8_t *processedFaceList = new uint8_t [faceCount];
-    memset(processedFaceList, 0, sizeof(uint8_t) * faceCount);
-    unsigned int *faceSorted = new unsigned int [faceCount];
-    unsigned int *faceReverseLookup = new unsigned int [faceCount];
+    OptimizeFacesArena<IndexType>& arena = GetOptimizeFacesArena<IndexType>();
 
-    // build the vertex remap table
+    uint32_t faceCount = indexCount / 3;
+    arena.vertexDataList.assign(indexCount, OptimizeVertexData<IndexType>()); // upper bounds on size is indexCount
+    arena.vertexScores.assign(indexCount, 0.f);
+    arena.vertexRemap.resize(indexCount);
+    arena.activeFaceList.resize(indexCount);
+    arena.processedFaceList.assign(faceCount, 0);
+    arena.faceScoredStep.assign(faceCount, (uint32_t)-1);
+
+    OptimizeVertexData<IndexType> *vertexDataList = arena.vertexDataList.data();
+    float *vertexScores = arena.vertexScores.data();
+    IndexType *vertexRemap = arena.vertexRemap.data();
+    uint32_t *activeFaceList = arena.activeFaceList.data();
+    uint8_t *processedFaceList = arena.processedFaceList.data();
+    uint32_t *faceScoredStep = arena.faceScoredStep.data();
+
+    // build the vertex remap table, unique vertices are numbered in increasing index order
     unsigned int uniqueVertexCount = 0;
+    IndexType maxIndex = *std::max_element(indexList, indexList + indexCount);
+    if (maxIndex < 2 * (uint64_t)indexCount)
     {
-        typedef IndexSortCompareIndexed<unsigned int, IndexType> indexSorter;
-        unsigned int *indexSorted = new unsigned int [indexCount];
-
-        for (unsigned int i = 0; i < indexCount; i++)
+        // the usual, dense, index range: rank the index values that are used directly
+        std::vector<uint32_t>& indexRank = arena.sortScratch;
+        indexRank.assign((size_t)maxIndex + 1, 0);
+        for (uint32_t i = 0; i < indexCount; i++)
         {
-            indexSorted[i] = i;
+            indexRank[indexList[i]] = 1;
         }
-
-        indexSorter sortFunc(indexList);
-        std::sort(indexSorted, indexSorted + indexCount, sortFunc);
+        for (size_t index = 0; index <= maxIndex; index++)
+        {
+            uint32_t used = indexRank[index];
+            indexRank[index] = uniqueVertexCount;
+            uniqueVertexCount += used;
+        }
+        for (uint32_t i = 0; i < indexCount; i++)
+        {
+            vertexRemap[i] = indexRank[indexList[i]];
+        }
+    }
+    else
+    {
+        RadixSortCorners(indexList, indexCount, arena);
+        const uint32_t *indexSorted = arena.sortedCorners.data();
+        const IndexType *indexValueSorted = arena.sortKeys.data();
 
         for (unsigned int i = 0; i < indexCount; i++)
         {
             if (i == 0
-                || sortFunc(indexSorted[i - 1], indexSorted[i]))
+                || indexValueSorted[i - 1] < indexValueSorted[i])
             {
                 // it's not a duplicate
                 vertexRemap[indexSorted[i]] = uniqueVertexCount;
@@ -260,8 +309,6 @@ void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* n
                 vertexRemap[indexSorted[i]] = vertexRemap[indexSorted[i - 1]];
             }
         }
-
-        delete [] indexSorted;
     }
 
     // compute face count per vertex
@@ -282,24 +329,12 @@ void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* n
             vertexData.cachePos1 = kEvictedCacheIndex;
             vertexData.activeFaceListStart = curActiveFaceListPos;
             curActiveFaceListPos += vertexData.activeFaceListSize;
-            vertexData.score = FindVertexScore(vertexData.activeFaceListSize, vertexData.cachePos0, lruCacheSize);
+            vertexScores[i] = FindVertexScore(vertexData.activeFaceListSize, vertexData.cachePos0, lruCacheSize);
             vertexData.activeFaceListSize = 0;
         }
         assert(curActiveFaceListPos == indexCount);
     }
 
-    // sort unprocessed faces by highest score
-    for (uint32_t f = 0; f < faceCount; f++)
-    {
-        faceSorted[f] = f;
-    }
-    FaceValenceSort<unsigned int, IndexType> faceValenceSort(vertexDataList);
-    std::sort(faceSorted, faceSorted + faceCount, faceValenceSort);
-    for (uint32_t f = 0; f < faceCount; f++)
-    {
-        faceReverseLookup[faceSorted[f]] = f;
-    }
-
     // fill out face list per vertex
     for (uint32_t i=0; i<indexCount; i+=3)
     {
@@ -319,8 +354,10 @@ void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* n
     uint32_t bestFace = 0;
     float bestScore = -1.f;
 
-    const float maxValenceScore = FindVertexScore(1, kEvictedCacheIndex, lruCacheSize) * 3.f;
-
+    // When the cache runs dry, the next unprocessed face in the original order starts a new strip.
+    // (This used to search a list sorted by face valence, but it was sorted while every active face
+    // count was zero, and the re-sort as faces were processed compared faces by their position in
+    // the list.) The search only ever moves forward, so over the whole mesh it visits each face once.
     unsigned int nextBestFace = 0;
     for (uint32_t i = 0; i < indexCount; i += 3)
     {
@@ -330,7 +367,7 @@ void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* n
             // search all unprocessed faces for a new starting point
             for (; nextBestFace < faceCount; nextBestFace++)
             {
-                unsigned int faceIndex = faceSorted[nextBestFace];
+                unsigned int faceIndex = nextBestFace;
                 if (processedFaceList[faceIndex] == 0)
                 {
                     uint32_t face = faceIndex * 3;
@@ -340,7 +377,7 @@ void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* n
                         //assert(vertexData.activeFaceListSize > 0);
                         //assert(vertexData.cachePos0 >= lruCacheSize);
 
-                        float vertexScore = vertexDataList[vertexRemap[face + k]].score;
+                        float vertexScore = vertexScores[vertexRemap[face + k]];
                         faceScore += vertexScore; 
                     }
 
@@ -348,7 +385,7 @@ void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* n
                     bestFace = face;
 
                     nextBestFace++;
-                    break; // we're searching a pre-sorted list, first one we find will be the best
+                    break;
                 }
             }
             assert(bestScore >= 0.f);
@@ -384,32 +421,7 @@ void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* n
             assert(it != end);
             std::swap(*it, *(end-1));
             --vertexData.activeFaceListSize;
-            vertexData.score = FindVertexScore(vertexData.activeFaceListSize, vertexData.cachePos1, lruCacheSize);
-
-            // need to re-sort the faces that use this vertex, as their score will change due to activeFaceListSize shrinking
-            for (uint32_t *fi = begin; fi != end - 1; ++fi)
-            {
-                unsigned int faceIndex = *fi / 3;
-
-                unsigned int n = faceReverseLookup[faceIndex];
-                assert(faceSorted[n] == faceIndex);
-
-                // found it, now move it up
-                while (n > 0)
-                {
-                    if (faceValenceSort(n, n - 1))
-                    {
-                        faceReverseLookup[faceSorted[n]] = n - 1;
-                        faceReverseLookup[faceSorted[n - 1]] = n;
-                        std::swap(faceSorted[n], faceSorted[n - 1]);
-                        n--;
-                    }
-                    else
-                    {
-                        break;
-                    }
-                }
-            }
+            vertexScores[vertexRemap[bestFace + v]] = FindVertexScore(vertexData.activeFaceListSize, vertexData.cachePos1, lruCacheSize);
         }
 
         // move the rest of the old verts in the cache down and compute their new scores
@@ -421,12 +433,13 @@ void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* n
             {
                 vertexData.cachePos1 = entriesInCache1;
                 cache1[entriesInCache1++] = cache0[c0];
-                vertexData.score = FindVertexScore(vertexData.activeFaceListSize, vertexData.cachePos1, lruCacheSize);
+                vertexScores[cache0[c0]] = FindVertexScore(vertexData.activeFaceListSize, vertexData.cachePos1, lruCacheSize);
                 // don't need to re-sort this vertex... once it gets out of the cache, it'll have its original score
             }
         }
 
         // find the best scoring triangle in the current cache (including up to 3 that were just evicted)
+        // faces are reached through each of their cached vertices, score them only once
         bestScore = -1.f;
         for (uint32_t c1 = 0; c1 < entriesInCache1; ++c1)
         {
@@ -436,11 +449,14 @@ void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* n
             for (uint32_t j=0; j<vertexData.activeFaceListSize; ++j)
             {
                 uint32_t face = activeFaceList[vertexData.activeFaceListStart+j];
+                if (faceScoredStep[face / 3] == i)
+                    continue;
+                faceScoredStep[face / 3] = i;
+
                 float faceScore = 0.f;
                 for (uint32_t v=0; v<3; v++)
                 {
-                    OptimizeVertexData<IndexType>& faceVertexData = vertexDataList[vertexRemap[face + v]];
-                    faceScore += faceVertexData.score;
+                    faceScore += vertexScores[vertexRemap[face + v]];
                 }
                 if (faceScore > bestScore)
                 {
@@ -453,11 +469,7 @@ void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* n
         std::swap(cache0, cache1);
         entriesInCache0 = std::min(entriesInCache1, lruCacheSize);
     }
-
-    delete [] vertexDataList;
-    delete [] vertexRemap;
-    delete [] activeFaceList;
-    delete [] processedFaceList;
-    delete [] faceSorted;
-    delete [] faceReverseLookup;
 }
+
+template void OptimizeFaces<uint16_t>(const uint16_t* indexList, uint32_t indexCount, uint16_t* newIndexList, uint16_t lruCacheSize);
+template void OptimizeFaces<uint32_t>(const uint32_t* indexList, uint32_t indexCount, uint32_t* newIndexList, uint16_t lruCacheSize);
@@ -26,9 +26,8 @@
 //          hold the optimized index list
 //      lruCacheSize
 //          the size of the simulated post-transform cache (max:64)
+//
+//  Instantiated for uint16_t and uint32_t index lists.
 //-----------------------------------------------------------------------------
 template <typename IndexType>
 void OptimizeFaces(const IndexType* indexList, uint32_t indexCount, IndexType* newIndexList, uint16_t lruCacheSize);
-
-template void OptimizeFaces<uint16_t>(const uint16_t* indexList, uint32_t indexCount, uint16_t* newIndexList, uint16_t lruCacheSize);
-template void OptimizeFaces<uint32_t>(const uint32_t* indexList, uint32_t indexCount, uint32_t* newIndexList, uint16_t lruCacheSize);
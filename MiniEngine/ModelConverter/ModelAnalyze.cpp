@@ -0,0 +1,258 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ModelAnalyze.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+    enum { cacheConfigCount = 4 };
+    const uint32_t s_CacheSizes[cacheConfigCount] = { 8, 16, 32, 64 };
+
+    enum { fetchLineSize = 64 };
+    enum { fetchCacheLines = 16 * 1024 / fetchLineSize };
+
+    struct StreamStats
+    {
+        uint32_t triangleCount;
+        uint32_t vertexCount; // unique vertices referenced
+        uint64_t fifoMisses[cacheConfigCount];
+        uint64_t lruMisses[cacheConfigCount];
+        uint64_t bytesFetched;
+        uint64_t bytesReferenced;
+
+        void Add(const StreamStats& stats)
+        {
+            triangleCount += stats.triangleCount;
+            vertexCount += stats.vertexCount;
+            for (int c = 0; c < cacheConfigCount; c++)
+            {
+                fifoMisses[c] += stats.fifoMisses[c];
+                lruMisses[c] += stats.lruMisses[c];
+            }
+            bytesFetched += stats.bytesFetched;
+            bytesReferenced += stats.bytesReferenced;
+        }
+    };
+
+    struct MeshletStats
+    {
+        uint32_t meshletCount;
+        uint64_t vertexCount;
+        uint64_t triangleCount;
+
+        void Add(const MeshletStats& stats)
+        {
+            meshletCount += stats.meshletCount;
+            vertexCount += stats.vertexCount;
+            triangleCount += stats.triangleCount;
+        }
+    };
+
+    // Returns the number of misses of a FIFO cache. Vertices are timestamped when they enter
+    // the cache, so a vertex is still cached if fewer than cacheSize vertices entered after it.
+    uint64_t SimulateFifoCache(const uint16_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+    {
+        std::vector<uint32_t> timestamp(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+        uint64_t misses = 0;
+
+        for (uint32_t n = 0; n < indexCount; n++)
+        {
+            if (time - timestamp[indices[n]] > cacheSize)
+            {
+                timestamp[indices[n]] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+
+    uint64_t SimulateLruCache(const uint16_t* indices, uint32_t indexCount, uint32_t cacheSize)
+    {
+        uint32_t cache[64];
+        uint32_t entries = 0;
+        uint64_t misses = 0;
+
+        for (uint32_t n = 0; n < indexCount; n++)
+        {
+            uint32_t index = indices[n];
+            uint32_t position = 0;
+            while (position < entries && cache[position] != index)
+                position++;
+
+            if (position == entries)
+            {
+                misses++;
+                entries = std::min(entries + 1, cacheSize);
+                position = entries - 1;
+            }
+
+            // move to the front
+            memmove(cache + 1, cache, sizeof(uint32_t) * position);
+            cache[0] = index;
+        }
+        return misses;
+    }
+
+    // Simulates fetching every referenced vertex through a FIFO cache of 64 byte lines.
+    // Vertex buffers are assumed to start on a line boundary.
+    void SimulateVertexFetch(const uint16_t* indices, uint32_t indexCount, uint32_t vertexDataByteOffset,
+        uint32_t vertexStride, uint32_t vertexCount, StreamStats& stats)
+    {
+        uint32_t firstLine = vertexDataByteOffset / fetchLineSize;
+        uint32_t lineCount = (vertexDataByteOffset + vertexCount * vertexStride + fetchLineSize - 1) / fetchLineSize - firstLine;
+
+        std::vector<uint32_t> timestamp(lineCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        uint32_t time = fetchCacheLines + 1;
+
+        for (uint32_t n = 0; n < indexCount; n++)
+        {
+            uint32_t index = indices[n];
+            if (!referenced[index])
+            {
+                referenced[index] = true;
+                stats.vertexCount++;
+                stats.bytesReferenced += vertexStride;
+            }
+
+            uint32_t start = vertexDataByteOffset + index * vertexStride;
+            for (uint32_t line = start / fetchLineSize; line <= (start + vertexStride - 1) / fetchLineSize; line++)
+            {
+                uint32_t& lineTimestamp = timestamp[line - firstLine];
+                if (time - lineTimestamp > fetchCacheLines)
+                {
+                    lineTimestamp = time++;
+                    stats.bytesFetched += fetchLineSize;
+                }
+            }
+        }
+    }
+
+    void AnalyzeStream(const uint16_t* indices, uint32_t indexCount, uint32_t vertexDataByteOffset,
+        uint32_t vertexStride, uint32_t vertexCount, StreamStats& stats)
+    {
+        memset(&stats, 0, sizeof(stats));
+        stats.triangleCount = indexCount / 3;
+
+        for (int c = 0; c < cacheConfigCount; c++)
+        {
+            stats.fifoMisses[c] = SimulateFifoCache(indices, indexCount, vertexCount, s_CacheSizes[c]);
+            stats.lruMisses[c] = SimulateLruCache(indices, indexCount, s_CacheSizes[c]);
+        }
+        SimulateVertexFetch(indices, indexCount, vertexDataByteOffset, vertexStride, vertexCount, stats);
+    }
+
+    void WriteCacheStats(FILE *file, const char *name, const uint64_t misses[cacheConfigCount], const StreamStats& stats)
+    {
+        fprintf(file, "\"%s\": [", name);
+        for (int c = 0; c < cacheConfigCount; c++)
+        {
+            double acmr = stats.triangleCount > 0 ? (double)misses[c] / stats.triangleCount : 0.0;
+            double atvr = stats.vertexCount > 0 ? (double)misses[c] / stats.vertexCount : 0.0;
+            fprintf(file, "%s{ \"size\": %u, \"acmr\": %.4f, \"atvr\": %.4f }", c > 0 ? ", " : "", s_CacheSizes[c], acmr, atvr);
+        }
+        fprintf(file, "]");
+    }
+
+    void WriteStreamStats(FILE *file, const char *indent, const char *name, const StreamStats& stats)
+    {
+        double overfetch = stats.bytesReferenced > 0 ? (double)stats.bytesFetched / stats.bytesReferenced : 0.0;
+
+        fprintf(file, "%s\"%s\": {\n", indent, name);
+        fprintf(file, "%s    \"triangles\": %u,\n", indent, stats.triangleCount);
+        fprintf(file, "%s    \"vertices\": %u,\n", indent, stats.vertexCount);
+        fprintf(file, "%s    ", indent);
+        WriteCacheStats(file, "fifo", stats.fifoMisses, stats);
+        fprintf(file, ",\n%s    ", indent);
+        WriteCacheStats(file, "lru", stats.lruMisses, stats);
+        fprintf(file, ",\n%s    \"overfetch\": %.4f\n", indent, overfetch);
+        fprintf(file, "%s}", indent);
+    }
+
+    void WriteMeshletStats(FILE *file, const char *indent, const MeshletStats& stats)
+    {
+        double vertexUtilization = stats.meshletCount > 0 ? (double)stats.vertexCount / ((uint64_t)stats.meshletCount * Model::maxMeshletVertices) : 0.0;
+        double triangleUtilization = stats.meshletCount > 0 ? (double)stats.triangleCount / ((uint64_t)stats.meshletCount * Model::maxMeshletTriangles) : 0.0;
+
+        fprintf(file, "%s\"meshlets\": { \"count\": %u, \"vertex_utilization\": %.4f, \"triangle_utilization\": %.4f }",
+            indent, stats.meshletCount, vertexUtilization, triangleUtilization);
+    }
+}
+
+bool WriteModelAnalysis(const Model *model, const char *filename)
+{
+    if (model->m_pIndexData == nullptr || model->m_pIndexDataDepth == nullptr)
+        return false;
+
+    FILE *file = nullptr;
+    if (0 != fopen_s(&file, filename, "w"))
+        return false;
+
+    StreamStats totalColor = {}, totalDepth = {};
+    MeshletStats totalMeshlets = {};
+
+    fprintf(file, "{\n    \"meshes\": [\n");
+    for (unsigned int meshIndex = 0; meshIndex < model->m_Header.meshCount; meshIndex++)
+    {
+        const Model::Mesh *mesh = model->m_pMesh + meshIndex;
+
+        StreamStats color, depth;
+        AnalyzeStream((const uint16_t*)(model->m_pIndexData + mesh->indexDataByteOffset), mesh->indexCount,
+            mesh->vertexDataByteOffset, mesh->vertexStride, mesh->vertexCount, color);
+        AnalyzeStream((const uint16_t*)(model->m_pIndexDataDepth + mesh->indexDataByteOffset), mesh->indexCount,
+            mesh->vertexDataByteOffsetDepth, mesh->vertexStrideDepth, mesh->vertexCountDepth, depth);
+        totalColor.Add(color);
+        totalDepth.Add(depth);
+
+        fprintf(file, "        {\n");
+        fprintf(file, "            \"mesh\": %u,\n", meshIndex);
+        WriteStreamStats(file, "            ", "color", color);
+        fprintf(file, ",\n");
+        WriteStreamStats(file, "            ", "depth", depth);
+
+        if (model->m_pMeshletRange != nullptr)
+        {
+            const Model::MeshletRange& range = model->m_pMeshletRange[meshIndex];
+            MeshletStats meshlets = { range.meshletCount, 0, 0 };
+            for (uint32_t n = 0; n < range.meshletCount; n++)
+            {
+                meshlets.vertexCount += model->m_pMeshlet[range.meshletOffset + n].vertexCount;
+                meshlets.triangleCount += model->m_pMeshlet[range.meshletOffset + n].triangleCount;
+            }
+            totalMeshlets.Add(meshlets);
+
+            fprintf(file, ",\n");
+            WriteMeshletStats(file, "            ", meshlets);
+        }
+
+        fprintf(file, "\n        }%s\n", meshIndex + 1 < model->m_Header.meshCount ? "," : "");
+    }
+    fprintf(file, "    ],\n");
+
+    fprintf(file, "    \"aggregate\": {\n");
+    WriteStreamStats(file, "        ", "color", totalColor);
+    fprintf(file, ",\n");
+    WriteStreamStats(file, "        ", "depth", totalDepth);
+    if (model->m_pMeshletRange != nullptr)
+    {
+        fprintf(file, ",\n");
+        WriteMeshletStats(file, "        ", totalMeshlets);
+    }
+    fprintf(file, "\n    }\n}\n");
+
+    bool success = ferror(file) == 0;
+    fclose(file);
+    return success;
+}
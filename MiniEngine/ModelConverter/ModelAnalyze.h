@@ -0,0 +1,27 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include "Model.h"
+
+//-----------------------------------------------------------------------------
+//  WriteModelAnalysis
+//-----------------------------------------------------------------------------
+//  Writes a JSON report of how efficiently the model's meshes use the vertex
+//  pipeline, per mesh and in aggregate, for both the color and the depth-only
+//  index lists:
+//      - ACMR (cache misses per triangle) and ATVR (cache misses per vertex)
+//        of FIFO and LRU post-transform caches of 8, 16, 32 and 64 entries
+//      - vertex fetch overfetch: bytes read from 64 byte cache lines, through
+//        a simulated 16KB cache, per byte of vertex data referenced
+//      - meshlet count and utilization of the meshlet vertex/triangle limits
+//  The model's CPU side vertex and index data must still be present.
+//-----------------------------------------------------------------------------
+bool WriteModelAnalysis(const Model *model, const char *filename);
@@ -12,6 +12,7 @@
 //
 
 #include "ModelAssimp.h"
+#include "TangentSpace.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -39,6 +40,12 @@ int AssimpModel::FormatFromFilename(const char *filename)
     return format_none;
 }
 
+AssimpModel::AssimpModel()
+{
+    static const float defaultLodRatios[] = { 0.5f, 0.25f, 0.12f, 0.06f };
+    SetLodRatios(defaultLodRatios, _countof(defaultLodRatios));
+}
+
 bool AssimpModel::Load(const char *filename)
 {
     Clear();
@@ -103,7 +110,6 @@ bool AssimpModel::LoadAssimp(const char *filename)
     importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
 
     const aiScene *scene = importer.ReadFile(filename,
-        aiProcess_CalcTangentSpace |
         aiProcess_JoinIdenticalVertices |
         aiProcess_Triangulate |
         aiProcess_RemoveComponent |
@@ -302,8 +308,6 @@ bool AssimpModel::LoadAssimp(const char *filename)
         float *dstPos = (float*)(m_pVertexData + dstMesh->vertexDataByteOffset + dstMesh->attrib[attrib_position].offset);
         float *dstTexcoord0 = (float*)(m_pVertexData + dstMesh->vertexDataByteOffset + dstMesh->attrib[attrib_texcoord0].offset);
         float *dstNormal = (float*)(m_pVertexData + dstMesh->vertexDataByteOffset + dstMesh->attrib[attrib_normal].offset);
-        float *dstTangent = (float*)(m_pVertexData + dstMesh->vertexDataByteOffset + dstMesh->attrib[attrib_tangent].offset);
-        float *dstBitangent = (float*)(m_pVertexData + dstMesh->vertexDataByteOffset + dstMesh->attrib[attrib_bitangent].offset);
 
         float *dstPosDepth = (float*)(m_pVertexDataDepth + dstMesh->vertexDataByteOffsetDepth + dstMesh->attribDepth[attrib_position].offset);
 
@@ -352,36 +356,6 @@ bool AssimpModel::LoadAssimp(const char *filename)
                 assert(0);
             }
             dstNormal = (float*)((unsigned char*)dstNormal + dstMesh->vertexStride);
-
-            if (srcMesh->mTangents)
-            {
-                dstTangent[0] = srcMesh->mTangents[v].x;
-                dstTangent[1] = srcMesh->mTangents[v].y;
-                dstTangent[2] = srcMesh->mTangents[v].z;
-            }
-            else
-            {
-                // TODO: generate tangents/bitangents if missing
-                dstTangent[0] = 1.0f;
-                dstTangent[1] = 0.0f;
-                dstTangent[2] = 0.0f;
-            }
-            dstTangent = (float*)((unsigned char*)dstTangent + dstMesh->vertexStride);
-
-            if (srcMesh->mBitangents)
-            {
-                dstBitangent[0] = srcMesh->mBitangents[v].x;
-                dstBitangent[1] = srcMesh->mBitangents[v].y;
-                dstBitangent[2] = srcMesh->mBitangents[v].z;
-            }
-            else
-            {
-                // TODO: generate tangents/bitangents if missing
-                dstBitangent[0] = 0.0f;
-                dstBitangent[1] = 1.0f;
-                dstBitangent[2] = 0.0f;
-            }
-            dstBitangent = (float*)((unsigned char*)dstBitangent + dstMesh->vertexStride);
         }
 
         uint16_t *dstIndex = (uint16_t*)(m_pIndexData + dstMesh->indexDataByteOffset);
@@ -398,6 +372,22 @@ bool AssimpModel::LoadAssimp(const char *filename)
             *dstIndexDepth++ = srcMesh->mFaces[f].mIndices[1];
             *dstIndexDepth++ = srcMesh->mFaces[f].mIndices[2];
         }
+
+        // tangent frames are generated here rather than by aiProcess_CalcTangentSpace
+        unsigned char *meshVertexData = m_pVertexData + dstMesh->vertexDataByteOffset;
+        TangentSpace::InterleavedVertices vertices;
+        vertices.positions = meshVertexData + dstMesh->attrib[attrib_position].offset;
+        vertices.positionStride = dstMesh->vertexStride;
+        vertices.normals = meshVertexData + dstMesh->attrib[attrib_normal].offset;
+        vertices.normalStride = dstMesh->vertexStride;
+        vertices.texcoords = meshVertexData + dstMesh->attrib[attrib_texcoord0].offset;
+        vertices.texcoordStride = dstMesh->vertexStride;
+        vertices.vertexCount = dstMesh->vertexCount;
+        vertices.tangents = meshVertexData + dstMesh->attrib[attrib_tangent].offset;
+        vertices.tangentStride = dstMesh->vertexStride;
+        vertices.bitangents = meshVertexData + dstMesh->attrib[attrib_bitangent].offset;
+        vertices.bitangentStride = dstMesh->vertexStride;
+        TangentSpace::GenerateTangentFrames(vertices, (const uint16_t*)(m_pIndexData + dstMesh->indexDataByteOffset), dstMesh->indexCount);
     }
 
     ComputeAllBoundingBoxes();
@@ -27,6 +27,11 @@ public:
     static const char *s_FormatString[];
     static int FormatFromFilename(const char *filename);
 
+    AssimpModel();
+
+    // Fractions of the original triangle count of each generated LOD, most detailed first
+    void SetLodRatios(const float *ratios, unsigned int count);
+
     virtual bool Load(const char* filename) override;
     bool Save(const char* filename) const;
 
@@ -37,6 +42,13 @@ private:
     void Optimize();
     void OptimizeRemoveDuplicateVertices(bool depth);
     void OptimizePostTransform(bool depth);
+    void OptimizeOverdraw(bool depth);
     void OptimizePreTransform(bool depth);
+
+    void BuildMeshlets();
+    void BuildLods();
+
+    float m_LodRatios[maxLods];
+    unsigned int m_LodRatioCount;
 };
 
@@ -12,15 +12,49 @@
 //
 
 #include "ModelAssimp.h"
+#include "ModelAnalyze.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 void PrintHelp()
 {
     printf("model_convert\n");
 
     printf("usage:\n");
-    printf("model_convert input_file output_file\n");
+    printf("model_convert input_file output_file [-lods ratio,ratio,...] [-analyze report_file]\n");
+    printf("  -lods: fractions of the triangle count of each LOD, default 0.5,0.25,0.12,0.06\n");
+    printf("         -lods none disables LOD generation\n");
+    printf("  -analyze: writes vertex cache, vertex fetch and meshlet statistics as JSON\n");
+}
+
+bool ParseLodRatios(const char *arg, AssimpModel &model)
+{
+    float ratios[Model::maxLods];
+    unsigned int count = 0;
+
+    if (strcmp(arg, "none") != 0)
+    {
+        const char *p = arg;
+        while (*p)
+        {
+            char *end;
+            float ratio = strtof(p, &end);
+            if (end == p || ratio <= 0.0f || ratio >= 1.0f || count == Model::maxLods)
+                return false;
+            ratios[count++] = ratio;
+
+            p = end;
+            if (*p == ',')
+                p++;
+            else if (*p != 0)
+                return false;
+        }
+    }
+
+    model.SetLodRatios(ratios, count);
+    return true;
 }
 
 void PrintModelStats(const Model *model)
@@ -97,9 +131,40 @@ void PrintModelStats(const Model *model)
             printAttribFormat(mesh->attrib[n].format);
             printf("\n");
         }
+
+        if (model->m_pMeshletRange != nullptr)
+        {
+            const Model::MeshletRange *range = model->m_pMeshletRange + meshIndex;
+            printf("meshlets: %u\n", range->meshletCount);
+        }
+
+        if (model->m_pLodRange != nullptr)
+        {
+            const Model::LodRange *range = model->m_pLodRange + meshIndex;
+            for (unsigned int lodIndex = 0; lodIndex < range->lodCount; lodIndex++)
+            {
+                const Model::MeshLod *lod = model->m_pLod + range->lodOffset + lodIndex;
+                printf("lod %u: indices %u, error %f\n", lodIndex + 1, lod->indexCount, lod->error);
+            }
+        }
     }
     printf("\n");
 
+    if (model->m_pMeshletRange != nullptr)
+    {
+        printf("meshlet count: %u\n", model->m_MeshletHeader.meshletCount);
+        printf("meshlet vertices: %u\n", model->m_MeshletHeader.vertexCount);
+        printf("meshlet triangles: %u\n", model->m_MeshletHeader.triangleCount);
+        printf("\n");
+    }
+
+    if (model->m_pLodRange != nullptr)
+    {
+        printf("lod count: %u\n", model->m_LodHeader.lodCount);
+        printf("lod indices: %u\n", model->m_LodHeader.indexCount);
+        printf("\n");
+    }
+
     printf("material count: %u\n", model->m_Header.materialCount);
     for (unsigned int materialIndex = 0; materialIndex < model->m_Header.materialCount; materialIndex++)
     {
@@ -112,7 +177,7 @@ void PrintModelStats(const Model *model)
 
 int main(int argc, char **argv)
 {
-    if (argc != 3)
+    if (argc < 3 || (argc & 1) == 0)
     {
         PrintHelp();
         return -1;
@@ -120,12 +185,33 @@ int main(int argc, char **argv)
 
     const char *input_file = argv[1];
     const char *output_file = argv[2];
+    const char *analysis_file = nullptr;
 
     printf("input file %s\n", input_file);
     printf("output file %s\n", output_file);
 
     AssimpModel model;
 
+    for (int arg = 3; arg < argc; arg += 2)
+    {
+        bool valid = false;
+        if (strcmp(argv[arg], "-lods") == 0)
+        {
+            valid = ParseLodRatios(argv[arg + 1], model);
+        }
+        else if (strcmp(argv[arg], "-analyze") == 0)
+        {
+            analysis_file = argv[arg + 1];
+            valid = true;
+        }
+
+        if (!valid)
+        {
+            PrintHelp();
+            return -1;
+        }
+    }
+
     printf("loading...\n");
     if (!model.Load(input_file))
     {
@@ -144,5 +230,15 @@ int main(int argc, char **argv)
 
     PrintModelStats(&model);
 
+    if (analysis_file != nullptr)
+    {
+        printf("analyzing...\n");
+        if (!WriteModelAnalysis(&model, analysis_file))
+        {
+            printf("failed to write analysis: %s\n", analysis_file);
+            return -1;
+        }
+    }
+
     return 0;
 }
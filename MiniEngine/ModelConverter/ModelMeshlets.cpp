@@ -0,0 +1,311 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ModelAssimp.h"
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+    struct Float3
+    {
+        float x, y, z;
+    };
+
+    inline Float3 Sub(const Float3& a, const Float3& b) { Float3 r = { a.x - b.x, a.y - b.y, a.z - b.z }; return r; }
+    inline Float3 Cross(const Float3& a, const Float3& b) { Float3 r = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; return r; }
+    inline float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    inline float LengthSq(const Float3& a) { return Dot(a, a); }
+
+    inline Float3 Normalize(const Float3& a)
+    {
+        float length = sqrtf(LengthSq(a));
+        float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        Float3 r = { a.x * scale, a.y * scale, a.z * scale };
+        return r;
+    }
+
+    // Ritter's bounding sphere: a pass to find two distant points, then grow to fit.
+    void ComputeBoundingSphere(const Float3* positions, const uint16_t* vertices, uint32_t vertexCount, float sphere[4])
+    {
+        Float3 first = positions[vertices[0]];
+        Float3 a = first;
+        float maxDistSq = -1.0f;
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            float distSq = LengthSq(Sub(positions[vertices[v]], first));
+            if (distSq > maxDistSq) { maxDistSq = distSq; a = positions[vertices[v]]; }
+        }
+        Float3 b = a;
+        maxDistSq = -1.0f;
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            float distSq = LengthSq(Sub(positions[vertices[v]], a));
+            if (distSq > maxDistSq) { maxDistSq = distSq; b = positions[vertices[v]]; }
+        }
+
+        Float3 center = { (a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f };
+        float radius = sqrtf(maxDistSq) * 0.5f;
+
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            Float3 d = Sub(positions[vertices[v]], center);
+            float dist = sqrtf(LengthSq(d));
+            if (dist > radius)
+            {
+                float newRadius = (radius + dist) * 0.5f;
+                float shift = (newRadius - radius) / dist;
+                center.x += d.x * shift;
+                center.y += d.y * shift;
+                center.z += d.z * shift;
+                radius = newRadius;
+            }
+        }
+
+        sphere[0] = center.x;
+        sphere[1] = center.y;
+        sphere[2] = center.z;
+        sphere[3] = radius;
+    }
+
+    // Normal cone of the meshlet's triangles, with an apex such that the cone test is
+    // conservative for every point of the meshlet. Degenerate cones never cull.
+    void ComputeNormalCone(const Float3* positions, const uint16_t* vertices, const uint8_t* triangles, uint32_t triangleCount,
+        const float sphere[4], Model::Meshlet& meshlet)
+    {
+        std::vector<Float3> normals(triangleCount);
+        Float3 axis = { 0.0f, 0.0f, 0.0f };
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            const Float3& p0 = positions[vertices[triangles[t * 3 + 0]]];
+            const Float3& p1 = positions[vertices[triangles[t * 3 + 1]]];
+            const Float3& p2 = positions[vertices[triangles[t * 3 + 2]]];
+            normals[t] = Normalize(Cross(Sub(p1, p0), Sub(p2, p0)));
+            axis.x += normals[t].x;
+            axis.y += normals[t].y;
+            axis.z += normals[t].z;
+        }
+        axis = Normalize(axis);
+
+        float minDot = 1.0f;
+        for (uint32_t t = 0; t < triangleCount; t++)
+            minDot = std::min(minDot, Dot(normals[t], axis));
+
+        Float3 center = { sphere[0], sphere[1], sphere[2] };
+        meshlet.coneAxis[0] = axis.x;
+        meshlet.coneAxis[1] = axis.y;
+        meshlet.coneAxis[2] = axis.z;
+
+        if (minDot <= 0.1f || LengthSq(axis) == 0.0f)
+        {
+            // the normals are spread over (about) a hemisphere or more, the meshlet can't be back face culled
+            meshlet.coneApex[0] = center.x;
+            meshlet.coneApex[1] = center.y;
+            meshlet.coneApex[2] = center.z;
+            meshlet.coneCutoff = 1.0f;
+            return;
+        }
+
+        // Move the apex back along the axis until every triangle plane lies in front of it
+        float maxT = 0.0f;
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            const Float3& p0 = positions[vertices[triangles[t * 3 + 0]]];
+            float denominator = Dot(normals[t], axis);
+            if (denominator > 0.0f)
+                maxT = std::max(maxT, Dot(Sub(center, p0), normals[t]) / denominator);
+        }
+
+        meshlet.coneApex[0] = center.x - axis.x * maxT;
+        meshlet.coneApex[1] = center.y - axis.y * maxT;
+        meshlet.coneApex[2] = center.z - axis.z * maxT;
+        meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+    }
+
+    // Greedily grows meshlets over triangle adjacency. Among the triangles touching the current
+    // meshlet, the one adding the fewest new vertices wins. Ties go to the triangle closest to the
+    // meshlet's centroid, scaled by how many unused triangles its vertices have left, which fills
+    // in concave corners before growing outwards and keeps meshlets compact. When no neighbor
+    // fits, the meshlet is closed and the next one is seeded with the first unused triangle in
+    // index order, which OptimizeFaces has made spatially coherent.
+    void BuildMeshMeshlets(const Float3* positions, uint32_t vertexCount, const uint16_t* indices, uint32_t indexCount,
+        std::vector<Model::Meshlet>& meshlets, std::vector<uint16_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles)
+    {
+        uint32_t triangleCount = indexCount / 3;
+
+        // vertex to triangle adjacency
+        std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+        for (uint32_t n = 0; n < triangleCount * 3; n++)
+            adjacencyOffset[indices[n] + 1]++;
+        for (uint32_t v = 0; v < vertexCount; v++)
+            adjacencyOffset[v + 1] += adjacencyOffset[v];
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> cursor(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (uint32_t n = 0; n < triangleCount * 3; n++)
+                adjacency[cursor[indices[n]]++] = n / 3;
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> liveTriangles(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++)
+            liveTriangles[v] = adjacencyOffset[v + 1] - adjacencyOffset[v];
+        std::vector<uint8_t> localIndex(vertexCount, 0xff);
+        uint32_t nextSeed = 0;
+
+        Model::Meshlet meshlet = {};
+        meshlet.vertexOffset = (uint32_t)meshletVertices.size();
+        meshlet.triangleOffset = (uint32_t)(meshletTriangles.size() / 3);
+        Float3 centroidSum = { 0.0f, 0.0f, 0.0f };
+
+        auto closeMeshlet = [&]()
+        {
+            const uint16_t* vertices = meshletVertices.data() + meshlet.vertexOffset;
+            const uint8_t* triangles = meshletTriangles.data() + meshlet.triangleOffset * 3;
+            ComputeBoundingSphere(positions, vertices, meshlet.vertexCount, meshlet.boundingSphere);
+            ComputeNormalCone(positions, vertices, triangles, meshlet.triangleCount, meshlet.boundingSphere, meshlet);
+            meshlets.push_back(meshlet);
+
+            for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+                localIndex[vertices[v]] = 0xff;
+
+            meshlet = Model::Meshlet();
+            meshlet.vertexOffset = (uint32_t)meshletVertices.size();
+            meshlet.triangleOffset = (uint32_t)(meshletTriangles.size() / 3);
+            centroidSum.x = centroidSum.y = centroidSum.z = 0.0f;
+        };
+
+        auto newVertexCount = [&](uint32_t triangle)
+        {
+            return (localIndex[indices[triangle * 3 + 0]] == 0xff ? 1u : 0u)
+                + (localIndex[indices[triangle * 3 + 1]] == 0xff ? 1u : 0u)
+                + (localIndex[indices[triangle * 3 + 2]] == 0xff ? 1u : 0u);
+        };
+
+        for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+        {
+            uint32_t best = (uint32_t)-1;
+
+            if (meshlet.triangleCount > 0)
+            {
+                Float3 centroid = { centroidSum.x / meshlet.vertexCount, centroidSum.y / meshlet.vertexCount, centroidSum.z / meshlet.vertexCount };
+                uint32_t bestNewVertices = 4;
+                float bestScore = FLT_MAX;
+
+                const uint16_t* vertices = meshletVertices.data() + meshlet.vertexOffset;
+                for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+                {
+                    for (uint32_t a = adjacencyOffset[vertices[v]]; a < adjacencyOffset[vertices[v] + 1]; a++)
+                    {
+                        uint32_t triangle = adjacency[a];
+                        if (emitted[triangle])
+                            continue;
+
+                        uint32_t newVertices = newVertexCount(triangle);
+                        if (meshlet.vertexCount + newVertices > Model::maxMeshletVertices || newVertices > bestNewVertices)
+                            continue;
+
+                        const Float3& p0 = positions[indices[triangle * 3 + 0]];
+                        const Float3& p1 = positions[indices[triangle * 3 + 1]];
+                        const Float3& p2 = positions[indices[triangle * 3 + 2]];
+                        Float3 d = { (p0.x + p1.x + p2.x) / 3.0f - centroid.x, (p0.y + p1.y + p2.y) / 3.0f - centroid.y, (p0.z + p1.z + p2.z) / 3.0f - centroid.z };
+                        uint32_t live = liveTriangles[indices[triangle * 3 + 0]] + liveTriangles[indices[triangle * 3 + 1]] + liveTriangles[indices[triangle * 3 + 2]];
+                        float score = LengthSq(d) * (float)live;
+
+                        if (newVertices < bestNewVertices || score < bestScore)
+                        {
+                            best = triangle;
+                            bestNewVertices = newVertices;
+                            bestScore = score;
+                        }
+                    }
+                }
+
+                if (best == (uint32_t)-1)
+                    closeMeshlet();
+            }
+
+            if (best == (uint32_t)-1)
+            {
+                while (emitted[nextSeed])
+                    nextSeed++;
+                best = nextSeed;
+            }
+
+            // add the triangle
+            emitted[best] = true;
+            liveTriangles[indices[best * 3 + 0]]--;
+            liveTriangles[indices[best * 3 + 1]]--;
+            liveTriangles[indices[best * 3 + 2]]--;
+            for (int c = 0; c < 3; c++)
+            {
+                uint16_t vertex = indices[best * 3 + c];
+                if (localIndex[vertex] == 0xff)
+                {
+                    localIndex[vertex] = (uint8_t)meshlet.vertexCount++;
+                    meshletVertices.push_back(vertex);
+                    centroidSum.x += positions[vertex].x;
+                    centroidSum.y += positions[vertex].y;
+                    centroidSum.z += positions[vertex].z;
+                }
+                meshletTriangles.push_back(localIndex[vertex]);
+            }
+            meshlet.triangleCount++;
+
+            if (meshlet.triangleCount == Model::maxMeshletTriangles)
+                closeMeshlet();
+        }
+
+        if (meshlet.triangleCount > 0)
+            closeMeshlet();
+    }
+}
+
+void AssimpModel::BuildMeshlets()
+{
+    ClearMeshlets();
+
+    std::vector<Meshlet> meshlets;
+    std::vector<uint16_t> meshletVertices;
+    std::vector<uint8_t> meshletTriangles;
+    std::vector<Float3> positions;
+
+    m_pMeshletRange = new MeshletRange [m_Header.meshCount];
+
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    {
+        const Mesh *mesh = m_pMesh + meshIndex;
+
+        positions.resize(mesh->vertexCount);
+        const unsigned char *srcPosition = m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset;
+        for (unsigned int v = 0; v < mesh->vertexCount; v++)
+            memcpy(&positions[v], srcPosition + v * mesh->vertexStride, sizeof(Float3));
+
+        const uint16_t *indices = (const uint16_t*)(m_pIndexData + mesh->indexDataByteOffset);
+
+        m_pMeshletRange[meshIndex].meshletOffset = (uint32_t)meshlets.size();
+        BuildMeshMeshlets(positions.data(), mesh->vertexCount, indices, mesh->indexCount, meshlets, meshletVertices, meshletTriangles);
+        m_pMeshletRange[meshIndex].meshletCount = (uint32_t)meshlets.size() - m_pMeshletRange[meshIndex].meshletOffset;
+    }
+
+    m_MeshletHeader.meshletCount = (uint32_t)meshlets.size();
+    m_MeshletHeader.vertexCount = (uint32_t)meshletVertices.size();
+    m_MeshletHeader.triangleCount = (uint32_t)(meshletTriangles.size() / 3);
+
+    m_pMeshlet = new Meshlet [meshlets.size()];
+    m_pMeshletVertices = new uint16_t [meshletVertices.size()];
+    m_pMeshletTriangles = new uint8_t [meshletTriangles.size()];
+    memcpy(m_pMeshlet, meshlets.data(), sizeof(Meshlet) * meshlets.size());
+    memcpy(m_pMeshletVertices, meshletVertices.data(), sizeof(uint16_t) * meshletVertices.size());
+    memcpy(m_pMeshletTriangles, meshletTriangles.data(), meshletTriangles.size());
+}
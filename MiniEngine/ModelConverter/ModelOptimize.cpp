@@ -13,7 +13,9 @@
 
 #include "ModelAssimp.h"
 #include "IndexOptimizePostTransform.h"
+#include "IndexOptimizeOverdraw.h"
 
+#include <stdio.h>
 #include <string.h>
 
 void AssimpModel::OptimizeRemoveDuplicateVertices(bool depth)
@@ -116,6 +118,48 @@ void AssimpModel::OptimizePostTransform(bool depth)
     }
 }
 
+void AssimpModel::OptimizeOverdraw(bool depth)
+{
+    enum {fifoCacheSize = 16};
+    const float acmrThreshold = 1.05f;
+
+    float acmrBefore = 0.0f, acmrAfter = 0.0f;
+    OverdrawStats overdrawBefore = {}, overdrawAfter = {};
+    uint32_t triangleCount = 0;
+
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    {
+        Mesh *mesh = m_pMesh + meshIndex;
+
+        unsigned int vertexStride = depth ? mesh->vertexStrideDepth : mesh->vertexStride;
+        unsigned int vertexCount = depth ? mesh->vertexCountDepth : mesh->vertexCount;
+        const float *positions = (const float*)(depth
+            ? (m_pVertexDataDepth + mesh->vertexDataByteOffsetDepth + mesh->attribDepth[attrib_position].offset)
+            : (m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset));
+
+        uint16_t *srcIndices = new uint16_t [mesh->indexCount];
+        uint16_t *dstIndices = (uint16_t*)((depth ? m_pIndexDataDepth : m_pIndexData) + mesh->indexDataByteOffset);
+        memcpy(srcIndices, dstIndices, sizeof(uint16_t) * mesh->indexCount);
+
+        ::OptimizeOverdraw<uint16_t>(srcIndices, mesh->indexCount, positions, vertexStride, vertexCount, dstIndices, fifoCacheSize, acmrThreshold);
+
+        uint32_t meshTriangleCount = mesh->indexCount / 3;
+        acmrBefore += ComputeACMR<uint16_t>(srcIndices, mesh->indexCount, vertexCount, fifoCacheSize) * meshTriangleCount;
+        acmrAfter += ComputeACMR<uint16_t>(dstIndices, mesh->indexCount, vertexCount, fifoCacheSize) * meshTriangleCount;
+        AnalyzeOverdraw<uint16_t>(srcIndices, mesh->indexCount, positions, vertexStride, vertexCount, overdrawBefore);
+        AnalyzeOverdraw<uint16_t>(dstIndices, mesh->indexCount, positions, vertexStride, vertexCount, overdrawAfter);
+        triangleCount += meshTriangleCount;
+
+        delete [] srcIndices;
+    }
+
+    if (triangleCount > 0)
+    {
+        printf("overdraw optimization%s: ACMR %.3f -> %.3f, overdraw %.3f -> %.3f\n", depth ? " (depth-only)" : "",
+            acmrBefore / triangleCount, acmrAfter / triangleCount, overdrawBefore.GetOverdraw(), overdrawAfter.GetOverdraw());
+    }
+}
+
 void AssimpModel::OptimizePreTransform(bool depth)
 {
     unsigned char *reorderedVertexData = new unsigned char [depth ? m_Header.vertexDataByteSizeDepth : m_Header.vertexDataByteSize];
@@ -178,7 +222,17 @@ void AssimpModel::Optimize()
     OptimizePostTransform(false);
     OptimizePostTransform(true);
 
+    // re-order clusters of triangles front to back, within a small ACMR loss
+    OptimizeOverdraw(false);
+    OptimizeOverdraw(true);
+
     // re-order vertices for linear memory access
     OptimizePreTransform(false);
     OptimizePreTransform(true);
+
+    // partition the (final) color pass index lists into meshlets
+    BuildMeshlets();
+
+    // simplified versions of the color pass index lists
+    BuildLods();
 }
@@ -0,0 +1,520 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "ModelAssimp.h"
+
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+
+namespace
+{
+    struct Float3
+    {
+        float x, y, z;
+    };
+
+    inline Float3 Sub(const Float3& a, const Float3& b) { Float3 r = { a.x - b.x, a.y - b.y, a.z - b.z }; return r; }
+    inline Float3 Cross(const Float3& a, const Float3& b) { Float3 r = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; return r; }
+    inline float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+    // Symmetric 4x4 matrix of the Garland-Heckbert error quadric, upper triangle only.
+    // Q(p) is the sum of the squared distances from p to the accumulated planes.
+    struct Quadric
+    {
+        double a00, a01, a02, a03;
+        double a11, a12, a13;
+        double a22, a23;
+        double a33;
+
+        void AddPlane(double nx, double ny, double nz, double d, double weight)
+        {
+            a00 += weight * nx * nx; a01 += weight * nx * ny; a02 += weight * nx * nz; a03 += weight * nx * d;
+            a11 += weight * ny * ny; a12 += weight * ny * nz; a13 += weight * ny * d;
+            a22 += weight * nz * nz; a23 += weight * nz * d;
+            a33 += weight * d * d;
+        }
+
+        void Add(const Quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+            a11 += q.a11; a12 += q.a12; a13 += q.a13;
+            a22 += q.a22; a23 += q.a23;
+            a33 += q.a33;
+        }
+
+        double Evaluate(const Float3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double error = x * (a00 * x + 2.0 * (a01 * y + a02 * z + a03))
+                + y * (a11 * y + 2.0 * (a12 * z + a13))
+                + z * (a22 * z + 2.0 * a23)
+                + a33;
+            return error > 0.0 ? error : 0.0;
+        }
+    };
+
+    // Border edges are much more visible than interior ones when they move
+    enum { borderWeight = 10 };
+
+    enum VertexKind : uint8_t
+    {
+        vertex_interior,
+        vertex_border,  // on an open edge, may only slide along open edges
+        vertex_locked,  // on an attribute seam, never moves
+    };
+
+    // Vertices that share their position with another vertex sit on an attribute seam
+    // (split normals or UVs). Moving one side of the seam would tear the mesh open, so
+    // they are locked, along with the end points of UV borders.
+    void FindSeamVertices(const Float3* positions, uint32_t vertexCount, std::vector<uint8_t>& kind)
+    {
+        struct PositionHash
+        {
+            size_t operator()(const Float3& p) const
+            {
+                uint32_t h[3];
+                memcpy(h, &p, sizeof(h));
+                return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+            }
+        };
+        struct PositionEqual
+        {
+            bool operator()(const Float3& a, const Float3& b) const { return memcmp(&a, &b, sizeof(Float3)) == 0; }
+        };
+
+        std::unordered_map<Float3, uint32_t, PositionHash, PositionEqual> firstVertex;
+        firstVertex.reserve(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            auto inserted = firstVertex.insert(std::make_pair(positions[v], v));
+            if (!inserted.second)
+            {
+                kind[v] = vertex_locked;
+                kind[inserted.first->second] = vertex_locked;
+            }
+        }
+    }
+
+    class MeshSimplifier
+    {
+    public:
+        MeshSimplifier(const Float3* positions, uint32_t vertexCount)
+            : m_Positions(positions), m_VertexCount(vertexCount), m_SeamKind(vertexCount, vertex_interior)
+        {
+            FindSeamVertices(positions, vertexCount, m_SeamKind);
+        }
+
+        // Simplifies indices down to (about) targetIndexCount indices. Returns the new index
+        // count and the error introduced, as a distance.
+        uint32_t Simplify(std::vector<uint16_t>& indices, uint32_t targetIndexCount, float& error)
+        {
+            uint32_t indexCount = (uint32_t)indices.size();
+            double maxCost = 0.0;
+
+            ClassifyVertices(indices);
+            ComputeQuadrics(indices);
+
+            std::vector<Collapse> collapses;
+            std::vector<uint32_t> remap(m_VertexCount);
+            std::vector<bool> touched(m_VertexCount);
+
+            while (indexCount > targetIndexCount)
+            {
+                BuildAdjacency(indices);
+                GatherCollapses(indices, collapses);
+                if (collapses.empty())
+                    break;
+
+                std::sort(collapses.begin(), collapses.end(),
+                    [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+                for (uint32_t v = 0; v < m_VertexCount; v++)
+                    remap[v] = v;
+                std::fill(touched.begin(), touched.end(), false);
+
+                // Each pass only collapses edges whose neighborhoods haven't changed yet in this
+                // pass, so the costs and flip checks stay exact. Collapsing the cheapest half of the
+                // candidates per pass keeps the quality close to a strict priority queue.
+                uint32_t passCollapses = 0;
+                uint32_t maxPassCollapses = std::max(1u, (uint32_t)collapses.size() / 2);
+                uint32_t removedIndices = 0;
+                uint32_t removeTarget = indexCount - targetIndexCount;
+
+                for (const Collapse& c : collapses)
+                {
+                    if (removedIndices >= removeTarget || passCollapses >= maxPassCollapses)
+                        break;
+                    if (touched[c.from] || touched[c.to])
+                        continue;
+                    if (FlipsTriangle(indices, c.from, c.to))
+                        continue;
+
+                    remap[c.from] = c.to;
+                    m_Quadrics[c.to].Add(m_Quadrics[c.from]);
+                    maxCost = std::max(maxCost, c.cost);
+
+                    for (uint32_t a = m_AdjacencyOffset[c.from]; a < m_AdjacencyOffset[c.from + 1]; a++)
+                    {
+                        uint32_t triangle = m_Adjacency[a];
+                        touched[indices[triangle * 3 + 0]] = true;
+                        touched[indices[triangle * 3 + 1]] = true;
+                        touched[indices[triangle * 3 + 2]] = true;
+
+                        if (indices[triangle * 3 + 0] == c.to || indices[triangle * 3 + 1] == c.to || indices[triangle * 3 + 2] == c.to)
+                            removedIndices += 3;
+                    }
+                    passCollapses++;
+                }
+
+                if (passCollapses == 0)
+                    break;
+
+                // apply the collapses and drop the triangles that became degenerate
+                uint32_t writeIndex = 0;
+                for (uint32_t n = 0; n < indexCount; n += 3)
+                {
+                    uint16_t i0 = (uint16_t)remap[indices[n + 0]];
+                    uint16_t i1 = (uint16_t)remap[indices[n + 1]];
+                    uint16_t i2 = (uint16_t)remap[indices[n + 2]];
+                    if (i0 == i1 || i1 == i2 || i2 == i0)
+                        continue;
+                    indices[writeIndex++] = i0;
+                    indices[writeIndex++] = i1;
+                    indices[writeIndex++] = i2;
+                }
+                indexCount = writeIndex;
+                indices.resize(indexCount);
+            }
+
+            error = (float)sqrt(maxCost);
+            return indexCount;
+        }
+
+    private:
+        struct Collapse
+        {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+        };
+
+        void BuildAdjacency(const std::vector<uint16_t>& indices)
+        {
+            m_AdjacencyOffset.assign(m_VertexCount + 1, 0);
+            for (uint16_t index : indices)
+                m_AdjacencyOffset[index + 1]++;
+            for (uint32_t v = 0; v < m_VertexCount; v++)
+                m_AdjacencyOffset[v + 1] += m_AdjacencyOffset[v];
+
+            m_Adjacency.resize(indices.size());
+            std::vector<uint32_t> cursor(m_AdjacencyOffset.begin(), m_AdjacencyOffset.end() - 1);
+            for (uint32_t n = 0; n < (uint32_t)indices.size(); n++)
+                m_Adjacency[cursor[indices[n]]++] = n / 3;
+        }
+
+        // Returns true if the directed edge a->b has no twin b->a, i.e. lies on an open border
+        bool IsBorderEdge(const std::vector<uint16_t>& indices, uint32_t a, uint32_t b) const
+        {
+            for (uint32_t n = m_AdjacencyOffset[b]; n < m_AdjacencyOffset[b + 1]; n++)
+            {
+                const uint16_t* triangle = &indices[m_Adjacency[n] * 3];
+                for (int c = 0; c < 3; c++)
+                {
+                    if (triangle[c] == b && triangle[(c + 1) % 3] == a)
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        void ClassifyVertices(const std::vector<uint16_t>& indices)
+        {
+            BuildAdjacency(indices);
+
+            m_Kind = m_SeamKind;
+            for (uint32_t n = 0; n < (uint32_t)indices.size(); n += 3)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    uint32_t a = indices[n + c];
+                    uint32_t b = indices[n + (c + 1) % 3];
+                    if (!IsBorderEdge(indices, a, b))
+                        continue;
+
+                    // an open edge touching a seam is a UV border (the other side was split off),
+                    // keep both of its end points in place
+                    if (m_SeamKind[a] == vertex_locked || m_SeamKind[b] == vertex_locked)
+                    {
+                        m_Kind[a] = vertex_locked;
+                        m_Kind[b] = vertex_locked;
+                    }
+                    else
+                    {
+                        m_Kind[a] = std::max(m_Kind[a], (uint8_t)vertex_border);
+                        m_Kind[b] = std::max(m_Kind[b], (uint8_t)vertex_border);
+                    }
+                }
+            }
+        }
+
+        void ComputeQuadrics(const std::vector<uint16_t>& indices)
+        {
+            m_Quadrics.assign(m_VertexCount, Quadric());
+
+            for (uint32_t n = 0; n < (uint32_t)indices.size(); n += 3)
+            {
+                const Float3& p0 = m_Positions[indices[n + 0]];
+                const Float3& p1 = m_Positions[indices[n + 1]];
+                const Float3& p2 = m_Positions[indices[n + 2]];
+
+                Float3 normal = Cross(Sub(p1, p0), Sub(p2, p0));
+                double length = sqrt((double)Dot(normal, normal));
+                if (length == 0.0)
+                    continue;
+
+                double nx = normal.x / length, ny = normal.y / length, nz = normal.z / length;
+                double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+
+                Quadric plane = {};
+                plane.AddPlane(nx, ny, nz, d, 1.0);
+                m_Quadrics[indices[n + 0]].Add(plane);
+                m_Quadrics[indices[n + 1]].Add(plane);
+                m_Quadrics[indices[n + 2]].Add(plane);
+
+                // border edges also get a plane perpendicular to the triangle through the edge,
+                // so that border vertices stay on the border line
+                for (int c = 0; c < 3; c++)
+                {
+                    uint32_t a = indices[n + c];
+                    uint32_t b = indices[n + (c + 1) % 3];
+                    if (m_Kind[a] == vertex_interior || m_Kind[b] == vertex_interior || !IsBorderEdge(indices, a, b))
+                        continue;
+
+                    Float3 edge = Sub(m_Positions[b], m_Positions[a]);
+                    Float3 edgeNormal = Cross(edge, normal);
+                    double edgeLength = sqrt((double)Dot(edgeNormal, edgeNormal));
+                    if (edgeLength == 0.0)
+                        continue;
+
+                    double ex = edgeNormal.x / edgeLength, ey = edgeNormal.y / edgeLength, ez = edgeNormal.z / edgeLength;
+                    double ed = -(ex * m_Positions[a].x + ey * m_Positions[a].y + ez * m_Positions[a].z);
+
+                    Quadric border = {};
+                    border.AddPlane(ex, ey, ez, ed, borderWeight);
+                    m_Quadrics[a].Add(border);
+                    m_Quadrics[b].Add(border);
+                }
+            }
+        }
+
+        // Half edge collapses move a vertex onto one of its neighbors, so no vertex is ever
+        // created or modified and every LOD shares the mesh's vertex buffer.
+        bool CanCollapse(const std::vector<uint16_t>& indices, uint32_t from, uint32_t to) const
+        {
+            switch (m_Kind[from])
+            {
+            case vertex_interior:
+                return true;
+            case vertex_border:
+                // slide along the border only
+                return m_Kind[to] != vertex_interior && (IsBorderEdge(indices, from, to) || IsBorderEdge(indices, to, from));
+            default:
+                return false;
+            }
+        }
+
+        void GatherCollapses(const std::vector<uint16_t>& indices, std::vector<Collapse>& collapses) const
+        {
+            collapses.clear();
+            for (uint32_t n = 0; n < (uint32_t)indices.size(); n += 3)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    uint32_t a = indices[n + c];
+                    uint32_t b = indices[n + (c + 1) % 3];
+
+                    // interior edges are seen from both of their triangles, only gather them once
+                    bool border = IsBorderEdge(indices, a, b);
+                    if (!border && a > b)
+                        continue;
+
+                    if (CanCollapse(indices, a, b))
+                    {
+                        Collapse collapse = { a, b, m_Quadrics[a].Evaluate(m_Positions[b]) + m_Quadrics[b].Evaluate(m_Positions[b]) };
+                        collapses.push_back(collapse);
+                    }
+                    if (CanCollapse(indices, b, a))
+                    {
+                        Collapse collapse = { b, a, m_Quadrics[a].Evaluate(m_Positions[a]) + m_Quadrics[b].Evaluate(m_Positions[a]) };
+                        collapses.push_back(collapse);
+                    }
+                }
+            }
+        }
+
+        // Returns true if moving 'from' onto 'to' would flip (or collapse to a sliver) any of the
+        // triangles around 'from' that survive the collapse
+        bool FlipsTriangle(const std::vector<uint16_t>& indices, uint32_t from, uint32_t to) const
+        {
+            for (uint32_t a = m_AdjacencyOffset[from]; a < m_AdjacencyOffset[from + 1]; a++)
+            {
+                const uint16_t* triangle = &indices[m_Adjacency[a] * 3];
+                if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                    continue;
+
+                Float3 p[3], q[3];
+                for (int c = 0; c < 3; c++)
+                {
+                    p[c] = m_Positions[triangle[c]];
+                    q[c] = triangle[c] == from ? m_Positions[to] : p[c];
+                }
+
+                Float3 before = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+                Float3 after = Cross(Sub(q[1], q[0]), Sub(q[2], q[0]));
+                double dot = Dot(before, after);
+                if (dot <= 0.0 || dot * dot < 0.0625 * Dot(before, before) * Dot(after, after))
+                    return true;
+            }
+            return false;
+        }
+
+        const Float3* m_Positions;
+        uint32_t m_VertexCount;
+        std::vector<uint8_t> m_SeamKind;
+        std::vector<uint8_t> m_Kind;
+        std::vector<Quadric> m_Quadrics;
+        std::vector<uint32_t> m_AdjacencyOffset;
+        std::vector<uint32_t> m_Adjacency;
+    };
+
+    struct MeshLodChain
+    {
+        std::vector<Model::MeshLod> lods; // indexOffset relative to indices
+        std::vector<uint16_t> indices;
+    };
+
+    // Each level is simplified from the previous one, so the whole chain costs about as
+    // much as the first level. Errors accumulate along the chain.
+    void BuildMeshLodChain(const Float3* positions, uint32_t vertexCount, const uint16_t* indices, uint32_t indexCount,
+        const float* ratios, unsigned int ratioCount, MeshLodChain& chain)
+    {
+        MeshSimplifier simplifier(positions, vertexCount);
+        std::vector<uint16_t> lodIndices(indices, indices + indexCount);
+        uint32_t triangleCount = indexCount / 3;
+        float error = 0.0f;
+
+        for (unsigned int n = 0; n < ratioCount && chain.lods.size() < Model::maxLods; n++)
+        {
+            uint32_t targetIndexCount = (uint32_t)(triangleCount * ratios[n]) * 3;
+            if (targetIndexCount >= lodIndices.size())
+                continue;
+
+            uint32_t previousCount = (uint32_t)lodIndices.size();
+            float lodError = 0.0f;
+            uint32_t lodIndexCount = simplifier.Simplify(lodIndices, targetIndexCount, lodError);
+
+            // stop once the mesh doesn't get any simpler, everything left is locked
+            if (lodIndexCount == 0 || lodIndexCount * 10 > previousCount * 9)
+                break;
+
+            // lodError is measured against the previous level, not the full detail mesh
+            error += lodError;
+
+            Model::MeshLod lod;
+            lod.indexOffset = (uint32_t)chain.indices.size();
+            lod.indexCount = lodIndexCount;
+            lod.error = error;
+            chain.lods.push_back(lod);
+            chain.indices.insert(chain.indices.end(), lodIndices.begin(), lodIndices.end());
+        }
+    }
+}
+
+void AssimpModel::SetLodRatios(const float *ratios, unsigned int count)
+{
+    m_LodRatioCount = std::min(count, (unsigned int)maxLods);
+    for (unsigned int n = 0; n < m_LodRatioCount; n++)
+        m_LodRatios[n] = ratios[n];
+}
+
+void AssimpModel::BuildLods()
+{
+    ClearLods();
+
+    if (m_LodRatioCount == 0)
+        return;
+
+    std::vector<MeshLodChain> chains(m_Header.meshCount);
+
+    // meshes are independent, simplify them in parallel
+    std::atomic<unsigned int> nextMesh(0);
+    auto worker = [&]()
+    {
+        std::vector<Float3> positions;
+        for (unsigned int meshIndex = nextMesh++; meshIndex < m_Header.meshCount; meshIndex = nextMesh++)
+        {
+            const Mesh *mesh = m_pMesh + meshIndex;
+
+            positions.resize(mesh->vertexCount);
+            const unsigned char *srcPosition = m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset;
+            for (unsigned int v = 0; v < mesh->vertexCount; v++)
+                memcpy(&positions[v], srcPosition + v * mesh->vertexStride, sizeof(Float3));
+
+            const uint16_t *indices = (const uint16_t*)(m_pIndexData + mesh->indexDataByteOffset);
+            BuildMeshLodChain(positions.data(), mesh->vertexCount, indices, mesh->indexCount, m_LodRatios, m_LodRatioCount, chains[meshIndex]);
+        }
+    };
+
+    unsigned int threadCount = std::max(1u, std::min(std::thread::hardware_concurrency(), m_Header.meshCount));
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < threadCount; t++)
+        threads.push_back(std::thread(worker));
+    worker();
+    for (std::thread& thread : threads)
+        thread.join();
+
+    // concatenate in mesh order, so the output doesn't depend on the scheduling
+    m_LodHeader.lodCount = 0;
+    m_LodHeader.indexCount = 0;
+    for (const MeshLodChain& chain : chains)
+    {
+        m_LodHeader.lodCount += (uint32_t)chain.lods.size();
+        m_LodHeader.indexCount += (uint32_t)chain.indices.size();
+    }
+
+    m_pLodRange = new LodRange [m_Header.meshCount];
+    m_pLod = new MeshLod [m_LodHeader.lodCount];
+    m_pLodIndices = new uint16_t [m_LodHeader.indexCount];
+
+    uint32_t lodOffset = 0;
+    uint32_t indexOffset = 0;
+    for (unsigned int meshIndex = 0; meshIndex < m_Header.meshCount; meshIndex++)
+    {
+        const MeshLodChain& chain = chains[meshIndex];
+
+        m_pLodRange[meshIndex].lodOffset = lodOffset;
+        m_pLodRange[meshIndex].lodCount = (uint32_t)chain.lods.size();
+
+        for (const MeshLod& lod : chain.lods)
+        {
+            m_pLod[lodOffset] = lod;
+            m_pLod[lodOffset].indexOffset += indexOffset;
+            lodOffset++;
+        }
+
+        if (!chain.indices.empty())
+            memcpy(m_pLodIndices + indexOffset, chain.indices.data(), sizeof(uint16_t) * chain.indices.size());
+        indexOffset += (uint32_t)chain.indices.size();
+    }
+}
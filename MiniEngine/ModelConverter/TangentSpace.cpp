@@ -0,0 +1,196 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include <stdint.h>
+#include <math.h>
+
+#include "TangentSpace.h"
+
+namespace
+{
+    inline const float* Element(const void* base, uint32_t stride, uint32_t index)
+    {
+        return (const float*)((const uint8_t*)base + (size_t)index * stride);
+    }
+
+    inline float* Element(void* base, uint32_t stride, uint32_t index)
+    {
+        return (float*)((uint8_t*)base + (size_t)index * stride);
+    }
+
+    inline float Dot3(const float a[3], const float b[3])
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    // Scales v to unit length, or to zero for (near) zero length vectors.
+    inline void Normalize3(float v[3])
+    {
+        float lengthSq = Dot3(v, v);
+        float scale = lengthSq > 1e-20f ? 1.0f / sqrtf(lengthSq) : 0.0f;
+        v[0] *= scale;
+        v[1] *= scale;
+        v[2] *= scale;
+    }
+
+    // acos(x) for x in [-1, 1], with an absolute error below 7e-5 (Abramowitz & Stegun 4.4.45).
+    inline float ACos(float x)
+    {
+        float a = fabsf(x) < 1.0f ? fabsf(x) : 1.0f;
+        float result = (((-0.0187293f * a + 0.0742610f) * a - 0.2121144f) * a + 1.5707288f) * sqrtf(1.0f - a);
+        return x < 0.0f ? 3.14159265f - result : result;
+    }
+
+    inline void AddScaled(const float v[3], float scale, float sum[3])
+    {
+        sum[0] += v[0] * scale;
+        sum[1] += v[1] * scale;
+        sum[2] += v[2] * scale;
+    }
+
+    // Reads the normal of a vertex and returns its squared length. A missing or
+    // (near) zero normal reads as zero with a squared length of one, so that
+    // projecting onto it leaves vectors unchanged.
+    inline float LoadNormal(const TangentSpace::InterleavedVertices& v, uint32_t vertex, float n[3])
+    {
+        if (v.normals != nullptr)
+        {
+            const float* normal = Element(v.normals, v.normalStride, vertex);
+            n[0] = normal[0];
+            n[1] = normal[1];
+            n[2] = normal[2];
+            float lengthSq = Dot3(n, n);
+            if (lengthSq > 1e-20f)
+                return lengthSq;
+        }
+
+        n[0] = n[1] = n[2] = 0.0f;
+        return 1.0f;
+    }
+
+    // Writes normalize(v - n * dot(n, v) / dot(n, n)) to result, which may be v. The
+    // projection is scaled by dot(n, n) to save a division, which the normalization
+    // undoes. Returns false, leaving result alone, for vectors (nearly) along n.
+    inline bool ProjectOntoTangentPlane(const float n[3], float nLengthSq, const float v[3], float result[3])
+    {
+        float d = Dot3(n, v);
+        float x = v[0] * nLengthSq - n[0] * d;
+        float y = v[1] * nLengthSq - n[1] * d;
+        float z = v[2] * nLengthSq - n[2] * d;
+        float lengthSq = x * x + y * y + z * z;
+        if (lengthSq <= 1e-20f * nLengthSq * nLengthSq)
+            return false;
+
+        float scale = 1.0f / sqrtf(lengthSq);
+        result[0] = x * scale;
+        result[1] = y * scale;
+        result[2] = z * scale;
+        return true;
+    }
+}
+
+template <typename IndexType>
+void TangentSpace::GenerateTangentFrames(const InterleavedVertices& vertices, const IndexType* indexList, uint32_t indexCount)
+{
+    uint32_t vertexCount = vertices.vertexCount;
+    bool hasBitangents = vertices.bitangents != nullptr;
+
+    // The tangent and bitangent outputs double as the per-vertex accumulators
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        float* t = Element(vertices.tangents, vertices.tangentStride, v);
+        t[0] = t[1] = t[2] = 0.0f;
+        if (hasBitangents)
+        {
+            float* b = Element(vertices.bitangents, vertices.bitangentStride, v);
+            b[0] = b[1] = b[2] = 0.0f;
+        }
+    }
+
+    uint32_t faceCount = indexCount / 3;
+    for (uint32_t face = 0; face < faceCount; face++)
+    {
+        uint32_t i[3] = { indexList[face * 3 + 0], indexList[face * 3 + 1], indexList[face * 3 + 2] };
+        const float* p0 = Element(vertices.positions, vertices.positionStride, i[0]);
+        const float* p1 = Element(vertices.positions, vertices.positionStride, i[1]);
+        const float* p2 = Element(vertices.positions, vertices.positionStride, i[2]);
+        const float* uv0 = Element(vertices.texcoords, vertices.texcoordStride, i[0]);
+        const float* uv1 = Element(vertices.texcoords, vertices.texcoordStride, i[1]);
+        const float* uv2 = Element(vertices.texcoords, vertices.texcoordStride, i[2]);
+
+        float du1 = uv1[0] - uv0[0], dv1 = uv1[1] - uv0[1];
+        float du2 = uv2[0] - uv0[0], dv2 = uv2[1] - uv0[1];
+
+        // Solve E1 = T * du1 + B * dv1, E2 = T * du2 + B * dv2 up to the (positive) scale
+        // of the UV area, keeping its sign to orient the frame. Faces without UV area
+        // don't say anything about the frame.
+        float area = du1 * dv2 - dv1 * du2;
+        if (area == 0.0f)
+            continue;
+        float orientation = area < 0.0f ? -1.0f : 1.0f;
+        du1 *= orientation; dv1 *= orientation;
+        du2 *= orientation; dv2 *= orientation;
+
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float e3[3] = { p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2] };
+        float tangent[3] = { e1[0] * dv2 - e2[0] * dv1, e1[1] * dv2 - e2[1] * dv1, e1[2] * dv2 - e2[2] * dv1 };
+        float bitangent[3] = { e2[0] * du1 - e1[0] * du2, e2[1] * du1 - e1[1] * du2, e2[2] * du1 - e1[2] * du2 };
+
+        // Corner angles, from the cosines between the edges. The third is what's left of pi.
+        float e1LengthSq = Dot3(e1, e1), e2LengthSq = Dot3(e2, e2), e3LengthSq = Dot3(e3, e3);
+        float angle[3];
+        angle[0] = ACos(Dot3(e1, e2) / sqrtf(e1LengthSq * e2LengthSq + 1e-30f));
+        angle[1] = ACos(-Dot3(e1, e3) / sqrtf(e1LengthSq * e3LengthSq + 1e-30f));
+        angle[2] = 3.14159265f - angle[0] - angle[1];
+        angle[2] = angle[2] > 0.0f ? angle[2] : 0.0f;
+
+        // Each face adds its unit frame weighted by the corner angle
+        Normalize3(tangent);
+        for (uint32_t c = 0; c < 3; c++)
+            AddScaled(tangent, angle[c], Element(vertices.tangents, vertices.tangentStride, i[c]));
+
+        if (hasBitangents)
+        {
+            Normalize3(bitangent);
+            for (uint32_t c = 0; c < 3; c++)
+                AddScaled(bitangent, angle[c], Element(vertices.bitangents, vertices.bitangentStride, i[c]));
+        }
+    }
+
+    // Orthonormalize the sums against the normal, and pick the bitangent sign
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        float n[3];
+        float nLengthSq = LoadNormal(vertices, v, n);
+        float* t = Element(vertices.tangents, vertices.tangentStride, v);
+
+        if (!ProjectOntoTangentPlane(n, nLengthSq, t, t))
+        {
+            // No usable UVs around this vertex: any unit vector in the tangent plane will do.
+            const float x[3] = { 1.0f, 0.0f, 0.0f }, y[3] = { 0.0f, 1.0f, 0.0f };
+            ProjectOntoTangentPlane(n, nLengthSq, n[0] * n[0] < 0.81f * nLengthSq ? x : y, t);
+        }
+
+        if (hasBitangents)
+        {
+            // Compare the bitangent implied by the normal with the accumulated one,
+            // and replace the sum with sign * cross(normal, tangent).
+            float* b = Element(vertices.bitangents, vertices.bitangentStride, v);
+            float c[3] = { n[1] * t[2] - n[2] * t[1], n[2] * t[0] - n[0] * t[2], n[0] * t[1] - n[1] * t[0] };
+            float scale = (Dot3(c, b) < 0.0f ? -1.0f : 1.0f) / sqrtf(nLengthSq);
+            b[0] = c[0] * scale;
+            b[1] = c[1] * scale;
+            b[2] = c[2] * scale;
+        }
+    }
+}
+
+template void TangentSpace::GenerateTangentFrames<uint16_t>(const InterleavedVertices&, const uint16_t*, uint32_t);
+template void TangentSpace::GenerateTangentFrames<uint32_t>(const InterleavedVertices&, const uint32_t*, uint32_t);
@@ -0,0 +1,63 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#pragma once
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+//  Tangent frame generation following the MikkTSpace conventions: each face's
+//  unit tangent is weighted by its corner angle at each vertex, and the sum is
+//  projected onto the tangent plane of the vertex normal and normalized. The
+//  bitangent is reconstructed as sign * cross(normal, tangent).
+//
+//  This is one scalar pass over the faces that adds straight into the output
+//  vertices, then one pass over the vertices. Both callers already keep every
+//  core busy with a mesh per thread, so it doesn't start threads of its own.
+//
+//  Unlike the reference MikkTSpace implementation, face frames are projected
+//  once per vertex rather than once per corner, and vertices are never split:
+//  a vertex shared by faces with mirrored UVs gets the sign of the majority.
+//-----------------------------------------------------------------------------
+
+namespace TangentSpace
+{
+    // Interleaved vertices, as found in vertex buffers. Positions, normals and
+    // tangents are three floats, texture coordinates two. Normals and
+    // bitangents are optional. Without normals, tangents are only normalized.
+    struct InterleavedVertices
+    {
+        const void* positions;
+        uint32_t positionStride;
+        const void* normals;
+        uint32_t normalStride;
+        const void* texcoords;
+        uint32_t texcoordStride;
+        uint32_t vertexCount;
+
+        void* tangents;
+        uint32_t tangentStride;
+        void* bitangents;
+        uint32_t bitangentStride;
+    };
+
+    //-----------------------------------------------------------------------------
+    //  GenerateTangentFrames
+    //-----------------------------------------------------------------------------
+    //  Parameters:
+    //      vertices
+    //          the vertices to read from and write tangents (and bitangents) to
+    //      indexList
+    //          triangle list indices
+    //      indexCount
+    //          the number of indices in the list
+    //-----------------------------------------------------------------------------
+    template <typename IndexType>
+    void GenerateTangentFrames(const InterleavedVertices& vertices, const IndexType* indexList, uint32_t indexCount);
+}
@@ -17,7 +17,9 @@
 #include "RootSignature.h"
 #include "CommandContext.h"
 #include "Camera.h"
+#include "Math/Random.h"
 #include "BufferManager.h"
+#include "LightClusters.h"
 
 #include "CompiledShaders/FillLightGridCS_8.h"
 #include "CompiledShaders/FillLightGridCS_16.h"
@@ -46,6 +48,8 @@ enum { kMinLightGridDim = 8 };
 namespace Lighting
 {
     IntVar LightGridDim("Application/Forward+/Light Grid Dim", 16, kMinLightGridDim, 32, 8 );
+    BoolVar CPULightBinning("Application/Forward+/CPU Light Binning", false);
+    IntVar LightGridSlices("Application/Forward+/CPU Depth Slices", 16, 1, 64, 1);
 
     RootSignature m_FillLightRootSig;
     ComputePSO m_FillLightGridCS_8;
@@ -65,10 +69,14 @@ namespace Lighting
     ColorBuffer m_LightShadowArray;
     ShadowBuffer m_LightShadowTempBuffer;
     Matrix4 m_LightShadowMatrix[MaxLights];
+    Frustum m_LightShadowFrustum[MaxLights];
+
+    LightClusters m_LightClusters;
 
     void InitializeResources(void);
     void CreateRandomLights(const Vector3 minBound, const Vector3 maxBound);
     void FillLightGrid(GraphicsContext& gfxContext, const Camera& camera);
+    void FillLightGridCPU(GraphicsContext& gfxContext, const Camera& camera);
     void Shutdown(void);
 }
 
@@ -102,15 +110,10 @@ void Lighting::CreateRandomLights( const Vector3 minBound, const Vector3 maxBoun
     Vector3 posScale = maxBound - minBound;
     Vector3 posBias = minBound;
 
-    // todo: replace this with MT
-    srand(12645);
-    auto randUint = []() -> uint32_t
-    {
-        return rand(); // [0, RAND_MAX]
-    };
-    auto randFloat = [randUint]() -> float
+    RandomNumberGenerator rng(12645);
+    auto randFloat = [&rng]() -> float
     {
-        return randUint() * (1.0f / RAND_MAX); // convert [0, RAND_MAX] to [0, 1]
+        return rng.NextFloat(); // [0, 1)
     };
     auto randVecUniform = [randFloat]() -> Vector3
     {
@@ -132,7 +135,7 @@ void Lighting::CreateRandomLights( const Vector3 minBound, const Vector3 maxBoun
                 x1 = 2 * randFloat() - 1;
                 x2 = 2 * randFloat() - 1;
                 w = x1 * x1 + x2 * x2;
-            } while (w >= 1);
+            } while (w >= 1 || w == 0);
 
             w = sqrt(-2 * log(w) / w);
             y2 = x2 * w;
@@ -183,6 +186,7 @@ void Lighting::CreateRandomLights( const Vector3 minBound, const Vector3 maxBoun
         shadowCamera.SetPerspectiveMatrix(coneOuter * 2, 1.0f, lightRadius * .05f, lightRadius * 1.0f);
         shadowCamera.Update();
         m_LightShadowMatrix[n] = shadowCamera.GetViewProjMatrix();
+        m_LightShadowFrustum[n] = shadowCamera.GetWorldSpaceFrustum();
         Matrix4 shadowTextureMatrix = Matrix4(AffineTransform(Matrix3::MakeScale( 0.5f, -0.5f, 1.0f ), Vector3(0.5f, 0.5f, 0.0f))) * m_LightShadowMatrix[n];
 
         m_LightData[n].pos[0] = pos.GetX();
@@ -265,6 +269,12 @@ void Lighting::Shutdown(void)
 
 void Lighting::FillLightGrid(GraphicsContext& gfxContext, const Camera& camera)
 {
+    if (CPULightBinning)
+    {
+        FillLightGridCPU(gfxContext, camera);
+        return;
+    }
+
     ScopedTimer _prof(L"FillLightGrid", gfxContext);
 
     ComputeContext& Context = gfxContext.GetComputeContext();
@@ -324,3 +334,52 @@ void Lighting::FillLightGrid(GraphicsContext& gfxContext, const Camera& camera)
     Context.TransitionResource(m_LightGrid, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
     Context.TransitionResource(m_LightGridBitMask, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 }
+
+void Lighting::FillLightGridCPU(GraphicsContext& gfxContext, const Camera& camera)
+{
+    ScopedTimer _prof(L"FillLightGrid (CPU)", gfxContext);
+
+    // The same tiles as the shader's, which the pixel shader finds with LightGridDim
+    LightClusters::View View;
+    View.Width = g_SceneColorBuffer.GetWidth();
+    View.Height = g_SceneColorBuffer.GetHeight();
+    View.TileDim = LightGridDim;
+    View.NumSlices = LightGridSlices;
+    View.ProjScaleX = camera.GetProjMatrix().GetX().GetX();
+    View.ProjScaleY = camera.GetProjMatrix().GetY().GetY();
+    View.NearClip = camera.GetNearClip();
+    View.FarClip = camera.GetFarClip();
+
+    const Matrix4& ViewMatrix = camera.GetViewMatrix();
+
+    LightClusters::Light Lights[MaxLights];
+    for (uint32_t n = 0; n < MaxLights; n++)
+    {
+        Vector4 ViewPos = ViewMatrix * Vector3(m_LightData[n].pos[0], m_LightData[n].pos[1], m_LightData[n].pos[2]);
+        Lights[n].Position[0] = ViewPos.GetX();
+        Lights[n].Position[1] = ViewPos.GetY();
+        Lights[n].Position[2] = ViewPos.GetZ();
+        Lights[n].Radius = sqrt(m_LightData[n].radiusSq);
+        Lights[n].Type = m_LightData[n].type;
+    }
+
+    m_LightClusters.Bin(View, Lights, MaxLights);
+
+    const size_t LightGridSize = m_LightClusters.GetTileCount() * LightClusters::kTileSize;
+    const size_t BitMaskSize = m_LightClusters.GetTileCount() * LightClusters::kTileMaskSize;
+    ASSERT(LightGridSize <= m_LightGrid.GetBufferSize() && BitMaskSize <= m_LightGridBitMask.GetBufferSize(),
+        "The light grid is too small for the viewport");
+
+    DynAlloc LightGridUpload = gfxContext.ReserveUploadMemory(LightGridSize);
+    DynAlloc BitMaskUpload = gfxContext.ReserveUploadMemory(BitMaskSize);
+    m_LightClusters.WriteLightGrid(LightGridUpload.DataPtr, BitMaskUpload.DataPtr);
+
+    gfxContext.TransitionResource(m_LightGrid, D3D12_RESOURCE_STATE_COPY_DEST);
+    gfxContext.TransitionResource(m_LightGridBitMask, D3D12_RESOURCE_STATE_COPY_DEST, true);
+
+    gfxContext.CopyBufferRegion(m_LightGrid, 0, LightGridUpload.Buffer, LightGridUpload.Offset, LightGridSize);
+    gfxContext.CopyBufferRegion(m_LightGridBitMask, 0, BitMaskUpload.Buffer, BitMaskUpload.Offset, BitMaskSize);
+
+    gfxContext.TransitionResource(m_LightGrid, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    gfxContext.TransitionResource(m_LightGridBitMask, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
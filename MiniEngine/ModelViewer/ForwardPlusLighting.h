@@ -24,17 +24,22 @@ class ColorBuffer;
 class ShadowBuffer;
 class GraphicsContext;
 class IntVar;
+class BoolVar;
 namespace Math
 {
     class Vector3;
     class Matrix4;
     class Camera;
+    class Frustum;
 }
 
 namespace Lighting
 {
     extern IntVar LightGridDim;
 
+    // Bins the lights on the CPU instead of with FillLightGridCS (see LightClusters.h)
+    extern BoolVar CPULightBinning;
+
     enum { MaxLights = 128 };
 
     //LightData m_LightData[MaxLights];
@@ -48,6 +53,7 @@ namespace Lighting
     extern ColorBuffer m_LightShadowArray;
     extern ShadowBuffer m_LightShadowTempBuffer;
     extern Math::Matrix4 m_LightShadowMatrix[MaxLights];
+    extern Math::Frustum m_LightShadowFrustum[MaxLights];
 
     void InitializeResources(void);
     void CreateRandomLights(const Math::Vector3 minBound, const Math::Vector3 maxBound);
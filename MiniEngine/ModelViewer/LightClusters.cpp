@@ -0,0 +1,232 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+
+#include "pch.h"
+#include "LightClusters.h"
+#include "TaskScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <xmmintrin.h>
+
+namespace
+{
+    // Finds the tiles along one axis whose side planes a sphere is inside, where the planes through the origin contain
+    // the tile edges at Slopes.  Sign is 1 when slopes increase with the tile index, and -1 when they decrease.
+    bool PlaneRange( float Center, float Depth, float Radius, const float* Slopes, const float* PlaneScales,
+        uint32_t NumTiles, float Sign, uint32_t& First, uint32_t& Last )
+    {
+        // Skip the tiles the sphere is entirely past the end of, then those it is entirely before the start of
+        First = 0;
+        while (First < NumTiles && Sign * (Center - Slopes[First + 1] * Depth) > Radius * PlaneScales[First + 1])
+            ++First;
+
+        Last = NumTiles;
+        while (Last > First && Sign * (Slopes[Last - 1] * Depth - Center) > Radius * PlaneScales[Last - 1])
+            --Last;
+
+        if (First == Last)
+            return false;
+
+        --Last;
+        return true;
+    }
+}
+
+void LightClusters::Bin( const View& ViewDesc, const Light* Lights, uint32_t NumLights )
+{
+    ASSERT(ViewDesc.Width > 0 && ViewDesc.Height > 0 && ViewDesc.TileDim > 0 && ViewDesc.NumSlices > 0);
+    ASSERT(ViewDesc.NearClip > 0.0f && ViewDesc.FarClip > ViewDesc.NearClip, "Slices need a finite depth range");
+
+    m_View = ViewDesc;
+    m_TileCountX = (m_View.Width + m_View.TileDim - 1) / m_View.TileDim;
+    m_TileCountY = (m_View.Height + m_View.TileDim - 1) / m_View.TileDim;
+
+    // Tile edges go through pixel corners.  The last tiles end at the edges of the viewport.
+    m_TileSlopesX.resize(m_TileCountX + 1);
+    m_PlaneScalesX.resize(m_TileCountX + 1);
+    for (uint32_t i = 0; i <= m_TileCountX; ++i)
+    {
+        const float X = (float)std::min(i * m_View.TileDim, m_View.Width);
+        m_TileSlopesX[i] = (2.0f * X / m_View.Width - 1.0f) / m_View.ProjScaleX;
+        m_PlaneScalesX[i] = std::sqrt(1.0f + m_TileSlopesX[i] * m_TileSlopesX[i]);
+    }
+
+    m_TileSlopesY.resize(m_TileCountY + 1);
+    m_PlaneScalesY.resize(m_TileCountY + 1);
+    for (uint32_t i = 0; i <= m_TileCountY; ++i)
+    {
+        const float Y = (float)std::min(i * m_View.TileDim, m_View.Height);
+        m_TileSlopesY[i] = (1.0f - 2.0f * Y / m_View.Height) / m_View.ProjScaleY;
+        m_PlaneScalesY[i] = std::sqrt(1.0f + m_TileSlopesY[i] * m_TileSlopesY[i]);
+    }
+
+    const uint32_t NumSlices = m_View.NumSlices;
+    const float DepthRatio = m_View.FarClip / m_View.NearClip;
+    m_LogDepthScale = NumSlices / std::log(DepthRatio);
+
+    m_SliceDepths.resize(NumSlices + 4);
+    for (uint32_t i = 0; i < NumSlices; ++i)
+        m_SliceDepths[i] = m_View.NearClip * std::pow(DepthRatio, (float)i / NumSlices);
+    for (uint32_t i = NumSlices; i < NumSlices + 4; ++i)
+        m_SliceDepths[i] = m_View.FarClip;
+
+    m_NumLights = std::min(NumLights, (uint32_t)kMaxLights);
+    m_Lights.clear();
+    for (uint32_t i = 0; i < m_NumLights; ++i)
+    {
+        m_LightTypes[i] = (uint8_t)Lights[i].Type;
+
+        LightBounds Bounds;
+        if (ComputeBounds(Lights[i], i, Bounds))
+            m_Lights.push_back(Bounds);
+    }
+
+    m_TileMasks.resize(GetTileCount() * kMaskWords);
+
+    // Rows share nothing they write
+    TaskScheduler::ParallelFor(0u, m_TileCountY, [this]( uint32_t TileY )
+    {
+        BinRow(TileY);
+    });
+}
+
+uint32_t LightClusters::SliceAtDepth( float Depth ) const
+{
+    const float Slice = std::log(Depth / m_View.NearClip) * m_LogDepthScale;
+    return Slice <= 0.0f ? 0 : std::min((uint32_t)Slice, m_View.NumSlices - 1);
+}
+
+bool LightClusters::ComputeBounds( const Light& L, uint32_t Index, LightBounds& Bounds ) const
+{
+    const float X = L.Position[0];
+    const float Y = L.Position[1];
+    const float Depth = -L.Position[2];
+    const float Radius = L.Radius;
+    const float NearDepth = Depth - Radius;
+    const float FarDepth = Depth + Radius;
+
+    if (FarDepth < m_View.NearClip || NearDepth > m_View.FarClip)
+        return false;
+
+    Bounds.Index = Index;
+    Bounds.Center[0] = X;
+    Bounds.Center[1] = Y;
+    Bounds.Center[2] = Depth;
+    Bounds.RadiusSq = Radius * Radius;
+    Bounds.FirstSlice = SliceAtDepth(std::max(NearDepth, m_View.NearClip));
+    Bounds.LastSlice = SliceAtDepth(std::min(FarDepth, m_View.FarClip));
+
+    // The planes through the edges of the tiles are shared by all of the tiles of a row or column
+    return PlaneRange(X, Depth, Radius, m_TileSlopesX.data(), m_PlaneScalesX.data(), m_TileCountX, 1.0f,
+            Bounds.FirstTileX, Bounds.LastTileX) &&
+        PlaneRange(Y, Depth, Radius, m_TileSlopesY.data(), m_PlaneScalesY.data(), m_TileCountY, -1.0f,
+            Bounds.FirstTileY, Bounds.LastTileY);
+}
+
+void LightClusters::BinRow( uint32_t TileY )
+{
+    uint32_t* RowTileMasks = &m_TileMasks[TileY * m_TileCountX * kMaskWords];
+
+    std::fill(RowTileMasks, RowTileMasks + m_TileCountX * kMaskWords, 0);
+
+    const __m128 TopSlope = _mm_set1_ps(m_TileSlopesY[TileY]);
+    const __m128 BottomSlope = _mm_set1_ps(m_TileSlopesY[TileY + 1]);
+
+    for (const LightBounds& Bounds : m_Lights)
+    {
+        if (TileY < Bounds.FirstTileY || TileY > Bounds.LastTileY)
+            continue;
+
+        const __m128 CenterX = _mm_set1_ps(Bounds.Center[0]);
+        const __m128 CenterY = _mm_set1_ps(Bounds.Center[1]);
+        const __m128 CenterZ = _mm_set1_ps(Bounds.Center[2]);
+        const __m128 RadiusSq = _mm_set1_ps(Bounds.RadiusSq);
+
+        const uint32_t Word = Bounds.Index / 32;
+        const uint32_t Bit = 1u << (Bounds.Index % 32);
+
+        for (uint32_t TileX = Bounds.FirstTileX; TileX <= Bounds.LastTileX; ++TileX)
+        {
+            const __m128 LeftSlope = _mm_set1_ps(m_TileSlopesX[TileX]);
+            const __m128 RightSlope = _mm_set1_ps(m_TileSlopesX[TileX + 1]);
+
+            for (uint32_t Slice = Bounds.FirstSlice & ~3u; Slice <= Bounds.LastSlice; Slice += 4)
+            {
+                // The boxes around four froxels.  Depth is positive, so each bound is at the near or far end.
+                const __m128 NearZ = _mm_loadu_ps(&m_SliceDepths[Slice]);
+                const __m128 FarZ = _mm_loadu_ps(&m_SliceDepths[Slice + 1]);
+
+                const __m128 MinX = _mm_min_ps(_mm_mul_ps(NearZ, LeftSlope), _mm_mul_ps(FarZ, LeftSlope));
+                const __m128 MaxX = _mm_max_ps(_mm_mul_ps(NearZ, RightSlope), _mm_mul_ps(FarZ, RightSlope));
+                const __m128 MinY = _mm_min_ps(_mm_mul_ps(NearZ, BottomSlope), _mm_mul_ps(FarZ, BottomSlope));
+                const __m128 MaxY = _mm_max_ps(_mm_mul_ps(NearZ, TopSlope), _mm_mul_ps(FarZ, TopSlope));
+
+                // Distance from the center of the sphere to the closest point of each box
+                const __m128 DX = _mm_sub_ps(CenterX, _mm_min_ps(_mm_max_ps(CenterX, MinX), MaxX));
+                const __m128 DY = _mm_sub_ps(CenterY, _mm_min_ps(_mm_max_ps(CenterY, MinY), MaxY));
+                const __m128 DZ = _mm_sub_ps(CenterZ, _mm_min_ps(_mm_max_ps(CenterZ, NearZ), FarZ));
+                const __m128 DistSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(DX, DX), _mm_mul_ps(DY, DY)), _mm_mul_ps(DZ, DZ));
+
+                uint32_t Hits = (uint32_t)_mm_movemask_ps(_mm_cmple_ps(DistSq, RadiusSq));
+
+                // Only the slices of the light's range, which excludes the padding past the last slice
+                if (Slice < Bounds.FirstSlice)
+                    Hits &= 0xFu << (Bounds.FirstSlice - Slice);
+                if (Bounds.LastSlice - Slice < 3)
+                    Hits &= (1u << (Bounds.LastSlice - Slice + 1)) - 1;
+
+                if (Hits != 0)
+                {
+                    RowTileMasks[TileX * kMaskWords + Word] |= Bit;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void LightClusters::WriteLightGrid( void* LightGrid, void* LightGridBitMask ) const
+{
+    TaskScheduler::ParallelFor(0u, m_TileCountY, [&]( uint32_t TileY )
+    {
+        for (uint32_t TileX = 0; TileX < m_TileCountX; ++TileX)
+        {
+            const uint32_t TileIndex = TileY * m_TileCountX + TileX;
+            const uint32_t* Mask = GetTileMask(TileX, TileY);
+
+            // Grouped by type, in the order of the count bytes
+            uint32_t* Dest = (uint32_t*)((uint8_t*)LightGrid + TileIndex * kTileSize);
+            uint32_t NumIndices = 0;
+            uint32_t LightCount = 0;
+
+            for (uint32_t Type = 0; Type < 3; ++Type)
+            {
+                uint32_t TypeCount = 0;
+                for (uint32_t Word = 0; Word < kMaskWords; ++Word)
+                {
+                    for (unsigned long Bit, Bits = Mask[Word]; _BitScanForward(&Bit, Bits); Bits &= Bits - 1)
+                    {
+                        const uint32_t LightIndex = Word * 32 + Bit;
+                        if (m_LightTypes[LightIndex] == Type)
+                        {
+                            Dest[1 + NumIndices++] = LightIndex;
+                            ++TypeCount;
+                        }
+                    }
+                }
+                LightCount |= (TypeCount & 0xFF) << (Type * 8);
+            }
+            Dest[0] = LightCount;
+
+            memcpy((uint8_t*)LightGridBitMask + TileIndex * kTileMaskSize, Mask, kTileMaskSize);
+        }
+    });
+}
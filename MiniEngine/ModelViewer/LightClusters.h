@@ -0,0 +1,121 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Developed by Minigraph
+//
+// Description:  Assigns lights to the tiles of the Forward+ light grid on the CPU, in place of the FillLightGrid compute
+// shader.  Each tile is cut into froxels, depth slices that grow exponentially from the near plane to the far plane.
+// A light belongs to a tile when its sphere is inside the four side planes of the tile, as FillLightGridCS tests, and
+// touches the bounding box of one of its froxels, which rejects most of the lights near tile corners that the planes
+// accept.  The side planes are shared by rows and columns of tiles, so they give each light a rectangle of tiles
+// instead of being tested per tile.  Four froxels are tested at a time with SSE, and rows are binned by worker threads.
+//
+// The pixel shader reads a 2D light grid, so the froxels of a tile aren't kept.  WriteLightGrid() writes the tiles in
+// FillLightGridCS's layout:  the per-type light counts packed into the first word, then the light indices sorted by
+// type, and a 128-bit light mask.  Without the depth buffer, tiles keep the lights in front of or behind their
+// geometry, which the shader culls.
+//
+// Nothing here touches the device, so the binning runs (and can be checked) without one.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class LightClusters
+{
+public:
+    enum
+    {
+        kMaxLights = 128,
+        kMaskWords = kMaxLights / 32,
+        kTileSize = 4 + kMaxLights * 4,     // Bytes per tile in the light grid (TILE_SIZE in LightGrid.hlsli)
+        kTileMaskSize = kMaskWords * 4      // Bytes per tile in the light grid bit mask
+    };
+
+    // In view space, where the camera looks down -Z.  Types are those of the light grid:  0 for spheres, 1 for cones
+    // and 2 for cones with shadow maps.  Cones are binned by their bounding spheres, as FillLightGridCS does.
+    struct Light
+    {
+        float Position[3];
+        float Radius;
+        uint32_t Type;
+    };
+
+    struct View
+    {
+        uint32_t Width, Height;         // Of the viewport, in pixels
+        uint32_t TileDim;               // Tile width and height, in pixels
+        uint32_t NumSlices;             // Depth slices per tile
+        float ProjScaleX, ProjScaleY;   // The [0][0] and [1][1] elements of the projection matrix
+        float NearClip, FarClip;
+    };
+
+    LightClusters() : m_View(), m_TileCountX(0), m_TileCountY(0), m_LogDepthScale(0.0f), m_NumLights(0) {}
+
+    // Assigns the lights to the tiles of the view.  Lights after the first kMaxLights are ignored.
+    void Bin( const View& ViewDesc, const Light* Lights, uint32_t NumLights );
+
+    // Writes the light grid and the light grid bit mask of the binned lights, GetTileCount() tiles each.  Only the
+    // indices of the lights in a tile are written, not the unused end of the tile.
+    void WriteLightGrid( void* LightGrid, void* LightGridBitMask ) const;
+
+    uint32_t GetTileCountX( void ) const { return m_TileCountX; }
+    uint32_t GetTileCountY( void ) const { return m_TileCountY; }
+    uint32_t GetTileCount( void ) const { return m_TileCountX * m_TileCountY; }
+    uint32_t GetNumSlices( void ) const { return m_View.NumSlices; }
+
+    // The near view depth of a slice.  Slice NumSlices starts at the far plane.
+    float GetSliceDepth( uint32_t Slice ) const { return m_SliceDepths[Slice]; }
+
+    // A mask of kMaskWords words, with bit i of word w set for light 32 * w + i
+    const uint32_t* GetTileMask( uint32_t TileX, uint32_t TileY ) const
+    {
+        return &m_TileMasks[(TileY * m_TileCountX + TileX) * kMaskWords];
+    }
+
+private:
+
+    // The tiles inside whose side planes a light is, the slices its depth range overlaps, and its sphere with depth
+    // increasing away from the camera
+    struct LightBounds
+    {
+        uint32_t Index;
+        uint32_t FirstTileX, LastTileX;
+        uint32_t FirstTileY, LastTileY;
+        uint32_t FirstSlice, LastSlice;
+        float Center[3];
+        float RadiusSq;
+    };
+
+    bool ComputeBounds( const Light& L, uint32_t Index, LightBounds& Bounds ) const;
+    uint32_t SliceAtDepth( float Depth ) const;
+    void BinRow( uint32_t TileY );
+
+    View m_View;
+    uint32_t m_TileCountX;
+    uint32_t m_TileCountY;
+    float m_LogDepthScale;
+
+    // Tile edges as slopes of view space X and Y over depth, and the lengths of the plane normals (1, -Slope) in the XZ
+    // or YZ plane.  Y slopes decrease with the tile row.
+    std::vector<float> m_TileSlopesX;
+    std::vector<float> m_TileSlopesY;
+    std::vector<float> m_PlaneScalesX;
+    std::vector<float> m_PlaneScalesY;
+
+    // Slice boundaries, padded so that four slices can always be loaded at once
+    std::vector<float> m_SliceDepths;
+
+    std::vector<LightBounds> m_Lights;
+    uint32_t m_NumLights;
+    uint8_t m_LightTypes[kMaxLights];
+
+    std::vector<uint32_t> m_TileMasks;
+};
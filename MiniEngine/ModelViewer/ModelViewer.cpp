@@ -29,7 +29,10 @@
 #include "FXAA.h"
 #include "SystemTime.h"
 #include "TextRenderer.h"
-#include "ShadowCamera.h"
+#include "ShadowCascades.h"
+#include "Math/DynamicAABBTree.h"
+#include "RenderQueue.h"
+#include "FrameGraph.h"
 #include "ParticleEffectManager.h"
 #include "GameInput.h"
 #include "./ForwardPlusLighting.h"
@@ -57,20 +60,28 @@ class ModelViewer : public GameCore::IGameApp
 {
 public:
 
-    ModelViewer( void ) {}
+    ModelViewer( void ) : m_RenderQueue(2, 6, 4), m_BenchmarkContexts(0), m_BenchmarkFrames(0), m_BenchmarkTime(0.0),
+        m_BenchmarkSavedContexts(0), m_BarrierStats(), m_SunShadowBuffer(nullptr), m_ShadowCascadesRendered(0),
+        m_ShadowDraws(0) {}
 
     virtual void Startup( void ) override;
     virtual void Cleanup( void ) override;
 
     virtual void Update( float deltaT ) override;
     virtual void RenderScene( void ) override;
+    virtual void RenderUI( class GraphicsContext& gfxContext ) override;
 
 private:
 
     void RenderLightShadows(GraphicsContext& gfxContext);
 
-    enum eObjectFilter { kOpaque = 0x1, kCutout = 0x2, kTransparent = 0x4, kAll = 0xF, kNone = 0x0 };
-    void RenderObjects( GraphicsContext& Context, const Matrix4& ViewProjMat, eObjectFilter Filter = kAll );
+    // Steps the recording benchmark with the draw stats and record time of the last frame
+    void UpdateRecordingBenchmark( void );
+
+    // Renders the visible meshes with OpaquePSO or CutoutPSO, depending on their material.  Meshes are skipped when
+    // their PSO is null.
+    void RenderObjects( GraphicsContext& Context, const Matrix4& ViewProjMat, const Frustum& WorldFrustum,
+        const GraphicsPSO* OpaquePSO, const GraphicsPSO* CutoutPSO );
     void CreateParticleEffects();
     Camera m_Camera;
     std::auto_ptr<CameraController> m_CameraController;
@@ -99,8 +110,38 @@ private:
     Model m_Model;
     std::vector<bool> m_pMaterialIsCutout;
 
+    // Mesh bounding boxes as a structure of arrays, for Frustum::IntersectBoundingBoxes()
+    std::vector<float> m_MeshBoundsMin[3];
+    std::vector<float> m_MeshBoundsMax[3];
+    std::vector<uint32_t> m_MeshVisibility;
+
+    // The same boxes in a bounding volume hierarchy, the alternative to testing them all
+    DynamicAABBTree m_MeshTree;
+
+    RenderQueue m_RenderQueue;
+    RenderQueue::Stats m_DrawStats;
+    CpuTimer m_RecordTimer;
+
+    // The recording benchmark runs each context count for some frames and prints the average time spent recording
+    // draws.  m_BenchmarkContexts is the count being measured, 0 when it isn't running.
+    uint32_t m_BenchmarkContexts;
+    uint32_t m_BenchmarkFrames;
+    double m_BenchmarkTime;
+    int32_t m_BenchmarkSavedContexts;
+
+    // The passes of RenderScene(), and the barriers the scene context submitted in the last frame without and with
+    // the frame graph scheduling them
+    FrameGraph m_FrameGraph;
+    CommandContext::BarrierStats m_BarrierStats[2];
+
+    // The pixel shader constants of the frame, in upload memory so that parallel recording contexts can bind them too
+    D3D12_GPU_VIRTUAL_ADDRESS m_PSConstants;
+
     Vector3 m_SunDirection;
-    ShadowCamera m_SunShadow;
+    ShadowCascades m_SunShadow;
+    ID3D12Resource* m_SunShadowBuffer;  // The buffer the cached cascades are in
+    uint32_t m_ShadowCascadesRendered;
+    uint32_t m_ShadowDraws;
 };
 
 CREATE_APPLICATION( ModelViewer )
@@ -109,15 +150,27 @@ ExpVar m_SunLightIntensity("Application/Lighting/Sun Light Intensity", 4.0f, 0.0
 ExpVar m_AmbientIntensity("Application/Lighting/Ambient Intensity", 0.1f, -16.0f, 16.0f, 0.1f);
 NumVar m_SunOrientation("Application/Lighting/Sun Orientation", -0.5f, -100.0f, 100.0f, 0.1f );
 NumVar m_SunInclination("Application/Lighting/Sun Inclination", 0.75f, 0.0f, 1.0f, 0.01f );
-NumVar ShadowDimX("Application/Lighting/Shadow Dim X", 5000, 1000, 10000, 100 );
-NumVar ShadowDimY("Application/Lighting/Shadow Dim Y", 3000, 1000, 10000, 100 );
-NumVar ShadowDimZ("Application/Lighting/Shadow Dim Z", 3000, 1000, 10000, 100 );
+IntVar ShadowCascadeCount("Application/Lighting/Shadow Cascades", 4, 1, ShadowCascades::kMaxCascades, 1 );
+NumVar ShadowDistance("Application/Lighting/Shadow Distance", 3000, 500, 10000, 100 );
+NumVar CascadeSplitLambda("Application/Lighting/Cascade Split Lambda", 0.7f, 0.0f, 1.0f, 0.05f );
+BoolVar CacheShadowCascades("Application/Lighting/Cache Shadow Cascades", true);
 
 BoolVar ShowWaveTileCounts("Application/Forward+/Show Wave Tile Counts", false);
 #ifdef _WAVE_OP
 BoolVar EnableWaveOps("Application/Forward+/Enable Wave Ops", true);
 #endif
 
+BoolVar EnableLods("Application/Model/Enable LODs", true);
+NumVar LodErrorThreshold("Application/Model/LOD Error Threshold (px)", 1.0f, 0.125f, 16.0f, 0.125f);
+BoolVar ShowDrawStats("Application/Model/Show Draw Stats", false);
+IntVar RecordingContexts("Application/Model/Recording Contexts", 4, 1, GraphicsContext::kMaxParallelContexts);
+BoolVar BenchmarkRecording("Application/Model/Benchmark Recording", false);
+enum { kCullingOff, kCullingBatch, kCullingBVH, kNumCullingModes };
+const char* CullingModeLabels[kNumCullingModes] = { "Off", "Batch", "BVH" };
+EnumVar CullingMode("Application/Model/Frustum Culling", kCullingBatch, kNumCullingModes, CullingModeLabels);
+BoolVar UseFrameGraph("Application/Frame Graph/Schedule Barriers", true);
+BoolVar ShowBarrierStats("Application/Frame Graph/Show Barrier Stats", false);
+
 void ModelViewer::Startup( void )
 {
     SamplerDesc DefaultSamplerDesc;
@@ -229,6 +282,25 @@ void ModelViewer::Startup( void )
         }
     }
 
+    const uint32_t MeshCount = m_Model.m_Header.meshCount;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        m_MeshBoundsMin[axis].resize(MeshCount);
+        m_MeshBoundsMax[axis].resize(MeshCount);
+    }
+    for (uint32_t meshIndex = 0; meshIndex < MeshCount; ++meshIndex)
+    {
+        const Model::BoundingBox& bbox = m_Model.m_pMesh[meshIndex].boundingBox;
+        m_MeshBoundsMin[0][meshIndex] = bbox.min.GetX();
+        m_MeshBoundsMin[1][meshIndex] = bbox.min.GetY();
+        m_MeshBoundsMin[2][meshIndex] = bbox.min.GetZ();
+        m_MeshBoundsMax[0][meshIndex] = bbox.max.GetX();
+        m_MeshBoundsMax[1][meshIndex] = bbox.max.GetY();
+        m_MeshBoundsMax[2][meshIndex] = bbox.max.GetZ();
+        m_MeshTree.Insert(bbox.min, bbox.max, meshIndex);
+    }
+    m_MeshVisibility.resize((MeshCount + 31) / 32);
+
     CreateParticleEffects();
 
     float modelRadius = Length(m_Model.m_Header.boundingBox.max - m_Model.m_Header.boundingBox.min) * .5f;
@@ -254,6 +326,7 @@ void ModelViewer::Startup( void )
 
 void ModelViewer::Cleanup( void )
 {
+    m_MeshTree.Clear();
     m_Model.Clear();
     Lighting::Shutdown();
 }
@@ -281,6 +354,17 @@ void ModelViewer::Update( float deltaT )
     float sinphi = sinf(m_SunInclination * 3.14159f * 0.5f);
     m_SunDirection = Normalize(Vector3( costheta * cosphi, sinphi, sintheta * cosphi ));
 
+    // Nothing is cached when caching is off, or in a shadow buffer created since the cascades were rendered
+    if (!CacheShadowCascades || g_ShadowBuffer.GetResource() != m_SunShadowBuffer)
+    {
+        m_SunShadow.Invalidate();
+        m_SunShadowBuffer = g_ShadowBuffer.GetResource();
+    }
+
+    // The shadow buffer is a 2x2 grid of cascades
+    m_SunShadow.Update(m_Camera, -m_SunDirection, m_Model.m_Header.boundingBox.min, m_Model.m_Header.boundingBox.max,
+        ShadowDistance, CascadeSplitLambda, ShadowCascadeCount, g_ShadowBuffer.GetWidth() / 2, 16);
+
     // We use viewport offsets to jitter sample positions from frame to frame (for TAA.)
     // D3D has a design quirk with fractional offsets such that the implicit scissor
     // region of a viewport is floor(TopLeftXY) and floor(TopLeftXY + WidthHeight), so
@@ -302,7 +386,8 @@ void ModelViewer::Update( float deltaT )
     m_MainScissor.bottom = (LONG)g_SceneColorBuffer.GetHeight();
 }
 
-void ModelViewer::RenderObjects( GraphicsContext& gfxContext, const Matrix4& ViewProjMat, eObjectFilter Filter )
+void ModelViewer::RenderObjects( GraphicsContext& gfxContext, const Matrix4& ViewProjMat, const Frustum& WorldFrustum,
+    const GraphicsPSO* OpaquePSO, const GraphicsPSO* CutoutPSO )
 {
     struct VSConstants
     {
@@ -314,33 +399,137 @@ void ModelViewer::RenderObjects( GraphicsContext& gfxContext, const Matrix4& Vie
     vsConstants.modelToShadow = m_SunShadow.GetShadowMatrix();
     XMStoreFloat3(&vsConstants.viewerPos, m_Camera.GetPosition());
 
-    gfxContext.SetDynamicConstantBufferView(0, sizeof(vsConstants), &vsConstants);
-
-    uint32_t materialIdx = 0xFFFFFFFFul;
+    DynAlloc vsConstantsCB = gfxContext.ReserveUploadMemory(sizeof(vsConstants));
+    memcpy(vsConstantsCB.DataPtr, &vsConstants, sizeof(vsConstants));
+    gfxContext.SetConstantBuffer(0, vsConstantsCB.GpuAddress);
 
     uint32_t VertexStride = m_Model.m_VertexStride;
 
+    // LODs are selected from the main camera in every pass, so that shadows match what is seen.
+    // An error of one model space unit at distance d covers PixelsPerUnit / d pixels.
+    const bool UseLods = EnableLods && m_Model.m_pLodRange != nullptr;
+    const Vector3 ViewerPos = m_Camera.GetPosition();
+    const float PixelsPerUnit = g_DisplayHeight / (2.0f * tanf(m_Camera.GetFOV() * 0.5f));
+
+    if (CullingMode == kCullingBatch)
+    {
+        WorldFrustum.IntersectBoundingBoxes(
+            m_MeshBoundsMin[0].data(), m_MeshBoundsMin[1].data(), m_MeshBoundsMin[2].data(),
+            m_MeshBoundsMax[0].data(), m_MeshBoundsMax[1].data(), m_MeshBoundsMax[2].data(),
+            m_Model.m_Header.meshCount, m_MeshVisibility.data());
+    }
+    else if (CullingMode == kCullingBVH)
+    {
+        std::fill(m_MeshVisibility.begin(), m_MeshVisibility.end(), 0);
+        uint32_t* VisibilityMasks = m_MeshVisibility.data();
+        m_MeshTree.QueryFrustum(WorldFrustum, [VisibilityMasks](uint32_t meshIndex)
+        {
+            VisibilityMasks[meshIndex / 32] |= 1u << (meshIndex % 32);
+        });
+    }
+
+    // Draws are sorted front to back by the distance of their center from the near plane of the view
+    const BoundingPlane NearPlane = WorldFrustum.GetFrustumPlane(Frustum::kNearPlane);
+
+    m_RenderQueue.Reset();
+
     for (uint32_t meshIndex = 0; meshIndex < m_Model.m_Header.meshCount; meshIndex++)
     {
+        if (CullingMode != kCullingOff && (m_MeshVisibility[meshIndex / 32] & (1u << (meshIndex % 32))) == 0)
+            continue;
+
         const Model::Mesh& mesh = m_Model.m_pMesh[meshIndex];
 
+        const bool IsCutout = m_pMaterialIsCutout[mesh.materialIndex];
+        const GraphicsPSO* PSO = IsCutout ? CutoutPSO : OpaquePSO;
+        if (PSO == nullptr)
+            continue;
+
         uint32_t indexCount = mesh.indexCount;
         uint32_t startIndex = mesh.indexDataByteOffset / sizeof(uint16_t);
         uint32_t baseVertex = mesh.vertexDataByteOffset / VertexStride;
 
-        if (mesh.materialIndex != materialIdx)
+        if (UseLods)
         {
-            if ( m_pMaterialIsCutout[mesh.materialIndex] && !(Filter & kCutout) ||
-                !m_pMaterialIsCutout[mesh.materialIndex] && !(Filter & kOpaque) )
-                continue;
-
-            materialIdx = mesh.materialIndex;
-            gfxContext.SetDynamicDescriptors(2, 0, 6, m_Model.GetSRVs(materialIdx) );
+            // distance to the closest point of the mesh's bounding box
+            Vector3 ClosestPoint = Clamp(ViewerPos, mesh.boundingBox.min, mesh.boundingBox.max);
+            float Distance = Length(ViewerPos - ClosestPoint);
+            float MaxError = LodErrorThreshold * Distance / PixelsPerUnit;
+
+            // LOD errors only grow along the chain, pick the coarsest one that is still accurate enough
+            const Model::LodRange& Range = m_Model.m_pLodRange[meshIndex];
+            for (uint32_t lodIndex = 0; lodIndex < Range.lodCount; lodIndex++)
+            {
+                const Model::MeshLod& Lod = m_Model.m_pLod[Range.lodOffset + lodIndex];
+                if (Lod.error > MaxError)
+                    break;
+                indexCount = Lod.indexCount;
+                startIndex = m_Model.GetLodStartIndex(Lod);
+            }
         }
 
-        gfxContext.SetConstants(4, baseVertex, materialIdx);
+        // Opaque draws go first, cutouts are alpha tested against their depth
+        float Depth = NearPlane.DistanceFromPoint((mesh.boundingBox.min + mesh.boundingBox.max) * 0.5f);
+        m_RenderQueue.AddDraw(IsCutout ? 1 : 0, *PSO, mesh.materialIndex, m_Model.GetSRVs(mesh.materialIndex), Depth,
+            indexCount, startIndex, baseVertex, baseVertex, mesh.materialIndex);
+    }
+
+    m_RenderQueue.Sort();
 
-        gfxContext.DrawIndexed(indexCount, startIndex, baseVertex);
+    // Parallel contexts inherit the pipeline state but not the root parameters.  The extra textures are only read
+    // by the color pass, binding them in the others is harmless.
+    auto pfnSetupRootParameters = [&]( GraphicsContext& Context )
+    {
+        Context.SetConstantBuffer(0, vsConstantsCB.GpuAddress);
+        Context.SetConstantBuffer(1, m_PSConstants);
+        Context.SetDynamicDescriptors(3, 0, _countof(m_ExtraTextures), m_ExtraTextures);
+    };
+
+    m_RecordTimer.Start();
+    m_DrawStats += m_RenderQueue.Submit(gfxContext, RecordingContexts, pfnSetupRootParameters);
+    m_RecordTimer.Stop();
+}
+
+void ModelViewer::UpdateRecordingBenchmark( void )
+{
+    // Frames skipped after changing the context count, and frames measured
+    const uint32_t kWarmupFrames = 8;
+    const uint32_t kMeasuredFrames = 64;
+
+    if (m_BenchmarkContexts == 0)
+    {
+        if (!BenchmarkRecording)
+            return;
+
+        Utility::Printf("Draw recording time vs. recording contexts, %u draws per frame:\n", m_DrawStats.Draws);
+        m_BenchmarkSavedContexts = RecordingContexts;
+        m_BenchmarkContexts = 1;
+        m_BenchmarkFrames = 0;
+        m_BenchmarkTime = 0.0;
+        RecordingContexts = 1;
+        return;
+    }
+
+    if (m_BenchmarkFrames++ >= kWarmupFrames)
+        m_BenchmarkTime += m_RecordTimer.GetTime();
+
+    if (m_BenchmarkFrames < kWarmupFrames + kMeasuredFrames)
+        return;
+
+    Utility::Printf("%2u contexts: %7.3f ms\n", m_BenchmarkContexts, m_BenchmarkTime * 1000.0 / kMeasuredFrames);
+
+    m_BenchmarkContexts *= 2;
+    m_BenchmarkFrames = 0;
+    m_BenchmarkTime = 0.0;
+    if (m_BenchmarkContexts > GraphicsContext::kMaxParallelContexts)
+    {
+        m_BenchmarkContexts = 0;
+        RecordingContexts = m_BenchmarkSavedContexts;
+        BenchmarkRecording = false;
+    }
+    else
+    {
+        RecordingContexts = (int32_t)m_BenchmarkContexts;
     }
 }
 
@@ -356,10 +545,7 @@ void ModelViewer::RenderLightShadows(GraphicsContext& gfxContext)
 
     m_LightShadowTempBuffer.BeginRendering(gfxContext);
     {
-        gfxContext.SetPipelineState(m_ShadowPSO);
-        RenderObjects(gfxContext, m_LightShadowMatrix[LightIndex], kOpaque);
-        gfxContext.SetPipelineState(m_CutoutShadowPSO);
-        RenderObjects(gfxContext, m_LightShadowMatrix[LightIndex], kCutout);
+        RenderObjects(gfxContext, m_LightShadowMatrix[LightIndex], m_LightShadowFrustum[LightIndex], &m_ShadowPSO, &m_CutoutShadowPSO);
     }
     m_LightShadowTempBuffer.EndRendering(gfxContext);
 
@@ -393,7 +579,9 @@ void ModelViewer::RenderScene( void )
 
     GraphicsContext& gfxContext = GraphicsContext::Begin(L"Scene Render");
 
-    ParticleEffects::Update(gfxContext.GetComputeContext(), Graphics::GetFrameTime());
+    UpdateRecordingBenchmark();
+    memset(&m_DrawStats, 0, sizeof(m_DrawStats));
+    m_RecordTimer.Reset();
 
     uint32_t FrameIndex = TemporalEffects::GetFrameIndexMod2();
 
@@ -407,6 +595,12 @@ void ModelViewer::RenderScene( void )
         float InvTileDim[4];
         uint32_t TileCount[4];
         uint32_t FirstLightIndex[4];
+
+        float CascadeScale[ShadowCascades::kMaxCascades][4];
+        float CascadeOffset[ShadowCascades::kMaxCascades][4];
+        float CascadeSplits[ShadowCascades::kMaxCascades];
+        float ViewForward[4];
+        uint32_t NumCascades;
         uint32_t FrameIndexMod2;
     } psConstants;
 
@@ -420,8 +614,22 @@ void ModelViewer::RenderScene( void )
     psConstants.TileCount[1] = Math::DivideByMultiple(g_SceneColorBuffer.GetHeight(), Lighting::LightGridDim);
     psConstants.FirstLightIndex[0] = Lighting::m_FirstConeLight;
     psConstants.FirstLightIndex[1] = Lighting::m_FirstConeShadowedLight;
+    for (uint32_t i = 0; i < ShadowCascades::kMaxCascades; ++i)
+    {
+        // Unused cascades never start
+        const bool IsUsed = i < m_SunShadow.GetNumCascades();
+        XMStoreFloat4((XMFLOAT4*)psConstants.CascadeScale[i], IsUsed ? m_SunShadow.GetCascadeScale(i) : Vector3(kZero));
+        XMStoreFloat4((XMFLOAT4*)psConstants.CascadeOffset[i], IsUsed ? m_SunShadow.GetCascadeOffset(i) : Vector3(kZero));
+        psConstants.CascadeSplits[i] = IsUsed ? m_SunShadow.GetSplitDepth(i) : FLT_MAX;
+    }
+    XMStoreFloat4((XMFLOAT4*)psConstants.ViewForward, m_Camera.GetForwardVec());
+    psConstants.NumCascades = m_SunShadow.GetNumCascades();
     psConstants.FrameIndexMod2 = FrameIndex;
 
+    DynAlloc psConstantsCB = gfxContext.ReserveUploadMemory(sizeof(psConstants));
+    memcpy(psConstantsCB.DataPtr, &psConstants, sizeof(psConstants));
+    m_PSConstants = psConstantsCB.GpuAddress;
+
     // Set the default state for command lists
     auto pfnSetupGraphicsState = [&](void)
     {
@@ -433,116 +641,288 @@ void ModelViewer::RenderScene( void )
 
     pfnSetupGraphicsState();
 
-    RenderLightShadows(gfxContext);
+    // The passes declare the buffers they share, and the frame graph issues the barriers between them.  The other
+    // buffers are private to the systems using them, which transition them.
+    const bool ScheduleBarriers = UseFrameGraph && !SSAO::AsyncCompute;
+
+    m_FrameGraph.Reset();
+
+    FrameGraph::ResourceHandle SceneColor = m_FrameGraph.ImportResource(g_SceneColorBuffer, true);
+    FrameGraph::ResourceHandle SceneDepth = m_FrameGraph.ImportResource(g_SceneDepthBuffer);
+    FrameGraph::ResourceHandle LinearDepth = m_FrameGraph.ImportResource(g_LinearDepth[FrameIndex], true);
+    FrameGraph::ResourceHandle Velocity = m_FrameGraph.ImportResource(g_VelocityBuffer, true);
+    FrameGraph::ResourceHandle SSAOFullScreen = m_FrameGraph.ImportResource(g_SSAOFullScreen);
+    FrameGraph::ResourceHandle ShadowBuffer = m_FrameGraph.ImportResource(g_ShadowBuffer);
+    FrameGraph::ResourceHandle LightGrid = m_FrameGraph.ImportResource(Lighting::m_LightGrid);
+    FrameGraph::ResourceHandle LightGridBitMask = m_FrameGraph.ImportResource(Lighting::m_LightGridBitMask);
+
+    FrameGraph::PassHandle Pass;
 
+    // The particle buffers are private to the particle system, including those ParticleEffects::Render() reads
+    m_FrameGraph.AddPass(L"Update Particles", FrameGraph::kNeverCull, [&]( CommandContext& )
+    {
+        ParticleEffects::Update(gfxContext.GetComputeContext(), Graphics::GetFrameTime());
+    });
+
+    // Renders one light's shadow map per frame into the shadow map array, which keeps them all
+    m_FrameGraph.AddPass(L"Light Shadows", FrameGraph::kNeverCull, [&]( CommandContext& )
+    {
+        pfnSetupGraphicsState();
+        RenderLightShadows(gfxContext);
+    });
+
+    Pass = m_FrameGraph.AddPass(L"Z PrePass", FrameGraph::kGraphicsPass, [&]( CommandContext& )
     {
         ScopedTimer _prof(L"Z PrePass", gfxContext);
 
-        gfxContext.SetDynamicConstantBufferView(1, sizeof(psConstants), &psConstants);
+        gfxContext.SetConstantBuffer(1, m_PSConstants);
 
-        {
-            ScopedTimer _prof1(L"Opaque", gfxContext);
-            gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
-            gfxContext.ClearDepth(g_SceneDepthBuffer);
+        gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
+        gfxContext.ClearDepth(g_SceneDepthBuffer);
 
 #ifdef _WAVE_OP
-            gfxContext.SetPipelineState(EnableWaveOps ? m_DepthWaveOpsPSO : m_DepthPSO );
+        const GraphicsPSO& DepthPSO = EnableWaveOps ? m_DepthWaveOpsPSO : m_DepthPSO;
 #else
-            gfxContext.SetPipelineState(m_DepthPSO);
+        const GraphicsPSO& DepthPSO = m_DepthPSO;
 #endif
-            gfxContext.SetDepthStencilTarget(g_SceneDepthBuffer.GetDSV());
-            gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
-            RenderObjects(gfxContext, m_ViewProjMatrix, kOpaque );
-        }
-
-        {
-            ScopedTimer _prof2(L"Cutout", gfxContext);
-            gfxContext.SetPipelineState(m_CutoutDepthPSO);
-            RenderObjects(gfxContext, m_ViewProjMatrix, kCutout );
-        }
+        gfxContext.SetDepthStencilTarget(g_SceneDepthBuffer.GetDSV());
+        gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
+        RenderObjects(gfxContext, m_ViewProjMatrix, m_Camera.GetWorldSpaceFrustum(), &DepthPSO, &m_CutoutDepthPSO);
+    });
+    m_FrameGraph.Write(Pass, SceneDepth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    // Disabled SSAO clears its buffer as a render target
+    Pass = m_FrameGraph.AddPass(L"SSAO", SSAO::Enable ? FrameGraph::kComputePass : FrameGraph::kGraphicsPass, [&]( CommandContext& )
+    {
+        SSAO::Render(gfxContext, m_Camera);
+    });
+    m_FrameGraph.Write(Pass, SSAOFullScreen, SSAO::Enable ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_RENDER_TARGET);
+    if (SSAO::Enable || SSAO::ComputeLinearZ)
+    {
+        m_FrameGraph.Read(Pass, SceneDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Write(Pass, LinearDepth, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     }
+    if (SSAO::DebugDraw)
+        m_FrameGraph.Write(Pass, SceneColor, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-    SSAO::Render(gfxContext, m_Camera);
-
-    Lighting::FillLightGrid(gfxContext, m_Camera);
+    // Lights binned on the CPU are copied to the light grid, without waiting for depth
+    Pass = m_FrameGraph.AddPass(L"Fill Light Grid", Lighting::CPULightBinning ? FrameGraph::kGraphicsPass : FrameGraph::kComputePass, [&]( CommandContext& )
+    {
+        Lighting::FillLightGrid(gfxContext, m_Camera);
+    });
+    if (Lighting::CPULightBinning)
+    {
+        m_FrameGraph.Write(Pass, LightGrid, D3D12_RESOURCE_STATE_COPY_DEST);
+        m_FrameGraph.Write(Pass, LightGridBitMask, D3D12_RESOURCE_STATE_COPY_DEST);
+    }
+    else
+    {
+        m_FrameGraph.Read(Pass, SceneDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Read(Pass, LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Write(Pass, LightGrid, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        m_FrameGraph.Write(Pass, LightGridBitMask, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }
 
     if (!SSAO::DebugDraw)
     {
-        ScopedTimer _prof(L"Main Render", gfxContext);
+        // Cached cascades are left as they are, and when all of them are, the shadow buffer isn't touched.  The
+        // others were updated last, so they are rendered now.
+        m_ShadowCascadesRendered = 0;
+        m_ShadowDraws = 0;
+        for (uint32_t i = 0; i < m_SunShadow.GetNumCascades(); ++i)
+            m_ShadowCascadesRendered += m_SunShadow.IsCascadeCached(i) ? 0 : 1;
+
+        if (m_ShadowCascadesRendered > 0)
+        {
+            Pass = m_FrameGraph.AddPass(L"Render Shadow Map", FrameGraph::kGraphicsPass, [&]( CommandContext& )
+            {
+                ScopedTimer _prof(L"Render Shadow Map", gfxContext);
 
-        gfxContext.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true);
-        gfxContext.ClearColor(g_SceneColorBuffer);
+                pfnSetupGraphicsState();
 
-        pfnSetupGraphicsState();
+                const uint32_t DrawsBefore = m_DrawStats.Draws;
 
-        {
-            ScopedTimer _prof3(L"Render Shadow Map", gfxContext);
+                for (uint32_t i = 0; i < m_SunShadow.GetNumCascades(); ++i)
+                {
+                    if (m_SunShadow.IsCascadeCached(i))
+                        continue;
+
+                    uint32_t RegionX, RegionY;
+                    m_SunShadow.GetCascadeRegion(i, RegionX, RegionY);
 
-            m_SunShadow.UpdateMatrix(-m_SunDirection, Vector3(0, -500.0f, 0), Vector3(ShadowDimX, ShadowDimY, ShadowDimZ),
-                (uint32_t)g_ShadowBuffer.GetWidth(), (uint32_t)g_ShadowBuffer.GetHeight(), 16);
+                    g_ShadowBuffer.BeginRendering(gfxContext, RegionX, RegionY, g_ShadowBuffer.GetWidth() / 2);
+                    RenderObjects(gfxContext, m_SunShadow.GetCascadeCamera(i).GetViewProjMatrix(),
+                        m_SunShadow.GetCasterFrustum(i), &m_ShadowPSO, &m_CutoutShadowPSO);
+                }
+                g_ShadowBuffer.EndRendering(gfxContext);
 
-            g_ShadowBuffer.BeginRendering(gfxContext);
-            gfxContext.SetPipelineState(m_ShadowPSO);
-            RenderObjects(gfxContext, m_SunShadow.GetViewProjMatrix(), kOpaque);
-            gfxContext.SetPipelineState(m_CutoutShadowPSO);
-            RenderObjects(gfxContext, m_SunShadow.GetViewProjMatrix(), kCutout);
-            g_ShadowBuffer.EndRendering(gfxContext);
+                m_ShadowDraws = m_DrawStats.Draws - DrawsBefore;
+            });
+            m_FrameGraph.Write(Pass, ShadowBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
         }
 
-        if (SSAO::AsyncCompute)
+        Pass = m_FrameGraph.AddPass(L"Render Color", FrameGraph::kGraphicsPass, [&]( CommandContext& )
         {
-            gfxContext.Flush();
+            ScopedTimer _prof(L"Render Color", gfxContext);
+
+            gfxContext.TransitionResource(g_SceneColorBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true);
+            gfxContext.ClearColor(g_SceneColorBuffer);
+
             pfnSetupGraphicsState();
 
-            // Make the 3D queue wait for the Compute queue to finish SSAO
-            g_CommandManager.GetGraphicsQueue().StallForProducer(g_CommandManager.GetComputeQueue());
-        }
+            if (SSAO::AsyncCompute)
+            {
+                gfxContext.Flush();
+                pfnSetupGraphicsState();
 
-        {
-            ScopedTimer _prof4(L"Render Color", gfxContext);
+                // Make the 3D queue wait for the Compute queue to finish SSAO
+                g_CommandManager.GetGraphicsQueue().StallForProducer(g_CommandManager.GetComputeQueue());
+            }
 
             gfxContext.TransitionResource(g_SSAOFullScreen, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
             gfxContext.SetDynamicDescriptors(3, 0, _countof(m_ExtraTextures), m_ExtraTextures);
-            gfxContext.SetDynamicConstantBufferView(1, sizeof(psConstants), &psConstants);
+            gfxContext.SetConstantBuffer(1, m_PSConstants);
 #ifdef _WAVE_OP
-            gfxContext.SetPipelineState(EnableWaveOps ? m_ModelWaveOpsPSO : m_ModelPSO );
+            const GraphicsPSO& ModelPSO = EnableWaveOps ? m_ModelWaveOpsPSO : m_ModelPSO;
 #else
-            gfxContext.SetPipelineState(ShowWaveTileCounts ? m_WaveTileCountPSO : m_ModelPSO);
+            const GraphicsPSO& ModelPSO = ShowWaveTileCounts ? m_WaveTileCountPSO : m_ModelPSO;
 #endif
             gfxContext.TransitionResource(g_SceneDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_READ);
             gfxContext.SetRenderTarget(g_SceneColorBuffer.GetRTV(), g_SceneDepthBuffer.GetDSV_DepthReadOnly());
             gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
 
-            RenderObjects( gfxContext, m_ViewProjMatrix, kOpaque );
-
-            if (!ShowWaveTileCounts)
-            {
-                gfxContext.SetPipelineState(m_CutoutModelPSO);
-                RenderObjects( gfxContext, m_ViewProjMatrix, kCutout );
-            }
-        }
-
+            RenderObjects( gfxContext, m_ViewProjMatrix, m_Camera.GetWorldSpaceFrustum(), &ModelPSO,
+                ShowWaveTileCounts ? nullptr : &m_CutoutModelPSO );
+        });
+        m_FrameGraph.Write(Pass, SceneColor, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        m_FrameGraph.Read(Pass, SceneDepth, D3D12_RESOURCE_STATE_DEPTH_READ);
+        m_FrameGraph.Read(Pass, SSAOFullScreen, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Read(Pass, ShadowBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Read(Pass, LightGrid, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Read(Pass, LightGridBitMask, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    }
+    else
+    {
+        // The cascades updated for this frame aren't rendered
+        m_SunShadow.Invalidate();
     }
 
     // Some systems generate a per-pixel velocity buffer to better track dynamic and skinned meshes.  Everything
     // is static in our scene, so we generate velocity from camera motion and the depth buffer.  A velocity buffer
     // is necessary for all temporal effects (and motion blur).
-    MotionBlur::GenerateCameraVelocityBuffer(gfxContext, m_Camera, true);
+    Pass = m_FrameGraph.AddPass(L"Camera Velocity", FrameGraph::kComputePass, [&]( CommandContext& )
+    {
+        MotionBlur::GenerateCameraVelocityBuffer(gfxContext, m_Camera, true);
+    });
+    m_FrameGraph.Read(Pass, LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    m_FrameGraph.Write(Pass, Velocity, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-    TemporalEffects::ResolveImage(gfxContext);
+    // Resolving clears the history when TAA is turned on, so it runs even when TAA is off
+    Pass = m_FrameGraph.AddPass(L"Temporal Resolve", FrameGraph::kComputePass | FrameGraph::kNeverCull, [&]( CommandContext& )
+    {
+        TemporalEffects::ResolveImage(gfxContext);
+    });
+    if (TemporalEffects::EnableTAA)
+    {
+        m_FrameGraph.Read(Pass, Velocity, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Read(Pass, LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Write(Pass, SceneColor, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }
 
-    ParticleEffects::Render(gfxContext, m_Camera, g_SceneColorBuffer, g_SceneDepthBuffer,  g_LinearDepth[FrameIndex]);
+    if (ParticleEffects::Enable)
+    {
+        Pass = m_FrameGraph.AddPass(L"Particles", FrameGraph::kGraphicsPass, [&]( CommandContext& )
+        {
+            ParticleEffects::Render(gfxContext, m_Camera, g_SceneColorBuffer, g_SceneDepthBuffer,  g_LinearDepth[FrameIndex]);
+        });
+        m_FrameGraph.Read(Pass, LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        if (ParticleEffects::EnableTiledRendering)
+        {
+            m_FrameGraph.Write(Pass, SceneColor, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        }
+        else
+        {
+            m_FrameGraph.Write(Pass, SceneColor, D3D12_RESOURCE_STATE_RENDER_TARGET);
+            m_FrameGraph.Read(Pass, SceneDepth, D3D12_RESOURCE_STATE_DEPTH_READ);
+        }
+    }
 
     // Until I work out how to couple these two, it's "either-or".
     if (DepthOfField::Enable)
-        DepthOfField::Render(gfxContext, m_Camera.GetNearClip(), m_Camera.GetFarClip());
+    {
+        Pass = m_FrameGraph.AddPass(L"Depth of Field", FrameGraph::kComputePass, [&]( CommandContext& )
+        {
+            DepthOfField::Render(gfxContext, m_Camera.GetNearClip(), m_Camera.GetFarClip());
+        });
+        m_FrameGraph.Read(Pass, LinearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Write(Pass, SceneColor, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }
     else
-        MotionBlur::RenderObjectBlur(gfxContext, g_VelocityBuffer);
+    {
+        // Culled when motion blur is off, having nothing to write
+        Pass = m_FrameGraph.AddPass(L"Object Motion Blur", FrameGraph::kComputePass, [&]( CommandContext& )
+        {
+            MotionBlur::RenderObjectBlur(gfxContext, g_VelocityBuffer);
+        });
+        if (MotionBlur::Enable)
+        {
+            m_FrameGraph.Read(Pass, Velocity, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            m_FrameGraph.Write(Pass, SceneColor, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        }
+    }
+
+    m_FrameGraph.Compile();
+    m_FrameGraph.Execute(gfxContext, ScheduleBarriers);
+
+    m_BarrierStats[ScheduleBarriers] = gfxContext.GetBarrierStats();
 
     gfxContext.Finish();
 }
 
+void ModelViewer::RenderUI( class GraphicsContext& gfxContext )
+{
+    if (!ShowDrawStats && !ShowBarrierStats)
+        return;
+
+    TextContext Text(gfxContext);
+    Text.Begin();
+
+    if (ShowDrawStats)
+    {
+        // State changes made after sorting, and how many the draws would have needed in mesh order
+        Text.DrawFormattedString("\nDraws: %u\n", m_DrawStats.Draws);
+        Text.DrawFormattedString("Shadow draws: %u (%u of %u cascades rendered)\n", m_ShadowDraws,
+            m_ShadowCascadesRendered, m_SunShadow.GetNumCascades());
+        Text.DrawFormattedString("PSO changes: %u (unsorted %u)\n", m_DrawStats.PSOChanges, m_DrawStats.UnsortedPSOChanges);
+        Text.DrawFormattedString("Material changes: %u (unsorted %u)\n", m_DrawStats.MaterialChanges, m_DrawStats.UnsortedMaterialChanges);
+        Text.DrawFormattedString("Root constant changes: %u (unsorted %u)\n", m_DrawStats.ConstantChanges, m_DrawStats.UnsortedConstantChanges);
+        Text.DrawFormattedString("Draw recording: %7.3f ms (up to %d contexts)\n", m_RecordTimer.GetTime() * 1000.0, (int)RecordingContexts);
+    }
+
+    if (ShowBarrierStats)
+    {
+        // Toggle the frame graph to measure both.  The graph's own barriers are those of the shared buffers, the
+        // passes still issue the others.
+        const FrameGraph::Stats& Plan = m_FrameGraph.GetStats();
+        Text.DrawFormattedString("\nScene barriers by hand: %u in %u batches\n", m_BarrierStats[0].Barriers, m_BarrierStats[0].Batches);
+        Text.DrawFormattedString("Scene barriers with frame graph: %u in %u batches\n", m_BarrierStats[1].Barriers, m_BarrierStats[1].Batches);
+        Text.DrawFormattedString("Frame graph: %u transitions, %u split, %u UAV barriers in %u batches\n",
+            Plan.Transitions, Plan.SplitTransitions, Plan.UAVBarriers, Plan.Batches);
+        Text.DrawFormattedString("Passes: %u, culled %u, async compute candidates %u\n", Plan.Passes, Plan.CulledPasses, Plan.AsyncCandidates);
+
+        for (FrameGraph::PassHandle Pass = 0; Pass < m_FrameGraph.GetPassCount(); ++Pass)
+        {
+            if (m_FrameGraph.IsPassCulled(Pass))
+                Text.DrawFormattedString(L"  %s (culled)\n", m_FrameGraph.GetPassName(Pass).c_str());
+            else if (m_FrameGraph.IsAsyncCandidate(Pass))
+                Text.DrawFormattedString(L"  %s (could overlap graphics on the compute queue)\n", m_FrameGraph.GetPassName(Pass).c_str());
+        }
+    }
+
+    Text.End();
+}
+
 void ModelViewer::CreateParticleEffects()
 {
     ParticleEffectProperties Effect = ParticleEffectProperties();
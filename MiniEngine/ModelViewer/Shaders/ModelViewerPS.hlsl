@@ -57,6 +57,13 @@ cbuffer PSConstants : register(b0)
     float4 InvTileDim;
     uint4 TileCount;
     uint4 FirstLightIndex;
+
+    // Transform the first cascade's shadow coordinates to another's (see ShadowCascades.h)
+    float4 CascadeScale[4];
+    float4 CascadeOffset[4];
+    float4 CascadeSplits;   // The view depths where the cascades end
+    float4 ViewForward;
+    uint NumCascades;
 }
 
 SamplerState sampler0 : register(s0);
@@ -87,8 +94,18 @@ float3 ApplyAmbientLight(
     return ao * diffuse * lightColor;
 }
 
-float GetShadow( float3 ShadowCoord )
+float GetShadow( float3 ShadowCoord, float ViewDepth )
 {
+    // The cascade of the pixel's slice of the view frustum, whose casters were rendered for it.  Past the shadow
+    // distance, nothing is shadowed.
+    uint Cascade = (uint)dot(float4(ViewDepth > CascadeSplits), 1.0);
+    if (Cascade >= NumCascades)
+        return 1.0;
+
+    // The cascades are a 2x2 grid
+    float3 CascadeCoord = ShadowCoord * CascadeScale[Cascade].xyz + CascadeOffset[Cascade].xyz;
+    ShadowCoord = float3((CascadeCoord.xy + float2(Cascade & 1, Cascade >> 1)) * 0.5, CascadeCoord.z);
+
 #ifdef SINGLE_SAMPLE
     float result = texShadow.SampleCmpLevelZero( shadowSampler, ShadowCoord.xy, ShadowCoord.z );
 #else
@@ -151,10 +168,11 @@ float3 ApplyDirectionalLight(
     float3    viewDir,        // World-space vector from eye to point
     float3    lightDir,        // World-space vector from point to light
     float3    lightColor,        // Radiance of directional light
-    float3    shadowCoord        // Shadow coordinate (Shadow map UV & light-relative Z)
+    float3    shadowCoord,    // Shadow coordinate (Shadow map UV & light-relative Z)
+    float    viewDepth        // Distance of the point from the eye along the view direction
     )
 {
-    float shadow = GetShadow(shadowCoord);
+    float shadow = GetShadow(shadowCoord, viewDepth);
 
     return shadow * ApplyLightCommon(
         diffuseColor,
@@ -350,7 +368,8 @@ float3 main(VSOutput vsOutput) : SV_Target0
     float3 specularAlbedo = float3( 0.56, 0.56, 0.56 );
     float specularMask = texSpecular.Sample(sampler0, vsOutput.uv).g;
     float3 viewDir = normalize(vsOutput.viewDir);
-    colorSum += ApplyDirectionalLight( diffuseAlbedo, specularAlbedo, specularMask, gloss, normal, viewDir, SunDirection, SunColor, vsOutput.shadowCoord );
+    float viewDepth = dot(vsOutput.viewDir, ViewForward.xyz);
+    colorSum += ApplyDirectionalLight( diffuseAlbedo, specularAlbedo, specularMask, gloss, normal, viewDir, SunDirection, SunColor, vsOutput.shadowCoord, viewDepth );
 
     uint2 tilePos = GetTilePos(pixelPos, InvTileDim.xy);
     uint tileIndex = GetTileIndex(tilePos, TileCount.x);
@@ -7,6 +7,7 @@
 #include <vector>
 #include <algorithm>
 #include <intrin.h>
+#include <mutex>
 
 #include FT_FREETYPE_H
 
@@ -14,6 +15,7 @@
 #define kMinorVersion    0
 
 #define kMaxTextureDimension 4096
+#define kMaxThreads 256
 
 using namespace std;
 
@@ -43,7 +45,6 @@ uint16_t g_fontAdvanceY = 0;    // Distance from baseline to baseline (line heig
 float* g_DistanceMap = 0;
 uint32_t g_MapWidth = 0;
 uint32_t g_MapHeight = 0;
-volatile int32_t g_nextGlyphIdx = 0;
 volatile bool g_ReadyToPaint = false;
 
 void PrintAssertMessage( const char* file, uint32_t line, const char* cond, const char* msg, ...)
@@ -155,84 +156,175 @@ inline Canvas LoadCanvas(FT_GlyphSlot glyph)
     return ret;
 }
 
-float DistanceFromInside(const Canvas& canvas, uint32_t xCoord, uint32_t yCoord)
+// Scratch memory for the distance transform of one glyph.  Each thread keeps its own.
+struct DistanceScratch
 {
-    const uint32_t radius = g_maxDistance * 32;
-    const uint32_t x0 =    xCoord * 32 + 15;
-    const uint32_t y0 =    yCoord * 32 + 15;
+    vector<uint8_t> bits;           // The glyph's canvas, one byte per pixel, including the search margin
+    vector<int32_t> toInside;       // Per column distance to the nearest inside pixel of the current row
+    vector<int32_t> toOutside;      // Per column distance to the nearest outside pixel of the current row
+    vector<int32_t> centerToInside; // Per column distance to the nearest inside pixel of each texel center row
+    vector<int32_t> centerToOutside;// Per column distance to the nearest outside pixel of each texel center row
+    vector<double> height;          // Squared heights of the parabolas of the lower envelope
+    vector<int32_t> apex;           // Columns of the parabolas of the lower envelope
+    vector<double> bound;           // Boundaries between parabolas of the lower envelope
+};
+
+// Advance the running column distances by one row.  A pixel resets the distance to the kind of pixel it is,
+// and distances saturate past the search radius where they no longer matter.  Each row is processed as a
+// whole so that the loop vectorizes.
+inline void AdvanceColumnDistances( const uint8_t* bits, int32_t* toInside, int32_t* toOutside, uint32_t width, int32_t maxDist )
+{
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        int32_t inside = bits[x];
+        toInside[x] = inside ? 0 : min(toInside[x] + 1, maxDist);
+        toOutside[x] = inside ? min(toOutside[x] + 1, maxDist) : 0;
+    }
+}
 
-    uint32_t left =        (uint32_t)max(0, (int32_t)(x0 - radius + 1));
-    uint32_t right =    x0 + radius - 1;
-    uint32_t top =        (uint32_t)max(0, (int32_t)(y0 - radius + 1));
-    uint32_t bottom =    y0 + radius - 1;
+// Given the vertical distance from a row to the nearest feature in every column, find the exact Euclidean
+// distance from points on that row to the nearest feature by building the lower envelope of the parabolas
+// (x - column)^2 + distance^2 (Felzenszwalb & Huttenlocher).  Samples are taken at sampleStart + n * sampleStep
+// and written as distances normalized to the search radius.
+void SampleRowDistances( const int32_t* columnDist, uint32_t width, int32_t maxDist, DistanceScratch& scratch,
+    double sampleStart, double sampleStep, uint32_t numSamples, float* distances )
+{
+    scratch.height.resize(width);
+    scratch.apex.resize(width);
+    scratch.bound.resize(width + 1);
 
-    uint32_t bestDistSq = radius * radius;
+    double* height = scratch.height.data();
+    int32_t* apex = scratch.apex.data();
+    double* bound = scratch.bound.data();
+    int32_t k = -1;
 
-    for (uint32_t y1 = top; y1 <= bottom; y1 += 2)
+    for (int32_t q = 0; q < (int32_t)width; ++q)
     {
-        int32_t distY = (int32_t)(y1 - y0);
-        uint32_t distYSq = (uint32_t)(distY * distY);
+        // Columns whose feature is out of range cannot be any closer than the search radius
+        if (columnDist[q] >= maxDist)
+            continue;
+
+        double h = (columnDist[q] + 0.5) * (columnDist[q] + 0.5);
+        double s = -HUGE_VAL;
 
-        if (distYSq >= bestDistSq)
+        while (k >= 0)
         {
-            if (y1 > y0)
-                continue;
-            else
+            s = ((h + (double)q * q) - (height[k] + (double)apex[k] * apex[k])) / (2.0 * (q - apex[k]));
+            if (s > bound[k])
                 break;
+            --k;
         }
 
-        for (uint32_t x1 = left; x1 <= right; x1 += 2)
+        ++k;
+        apex[k] = q;
+        height[k] = h;
+        bound[k] = k == 0 ? -HUGE_VAL : s;
+    }
+
+    const double maxDistSq = (double)maxDist * maxDist;
+    bound[k + 1] = HUGE_VAL;
+
+    int32_t j = 0;
+    for (uint32_t n = 0; n < numSamples; ++n)
+    {
+        double x = sampleStart + n * sampleStep;
+        double distSq = maxDistSq;
+
+        if (k >= 0)
         {
-            int32_t distX = (int32_t)(x1 - x0);
-            uint32_t distXSq = (uint32_t)(distX * distX);
+            while (bound[j + 1] < x)
+                ++j;
 
-            uint32_t distSq = (uint32_t)(distXSq + distYSq);
-            if (distSq < bestDistSq && !ReadCanvasBit(canvas, x1 >> 1, y1 >> 1))
-                bestDistSq = distSq;
+            distSq = min(maxDistSq, (x - apex[j]) * (x - apex[j]) + height[j]);
         }
-    }
 
-    return sqrt((float)bestDistSq) / (float)radius;
+        distances[n] = (float)(sqrt(distSq) / maxDist);
+    }
 }
 
-float DistanceFromOutside(const Canvas& canvas, uint32_t xCoord, uint32_t yCoord)
+// Compute the signed distance of every texel of a glyph cell.  Rather than searching a window around every
+// texel, this runs an exact Euclidean distance transform over the high-res canvas:  one pass down and one up
+// each column to find vertical distances, then a lower envelope per texel row to combine them.  The distance
+// is measured from the center of each texel to the nearest canvas pixel of the opposite kind, and normalized
+// to the search radius as before.
+void ComputeCellDistances( const Canvas& canvas, uint32_t cellsX, uint32_t cellsY, DistanceScratch& scratch,
+    float* distanceMap, uint32_t mapWidth, uint32_t startX, uint32_t startY )
 {
-    const uint32_t radius = g_maxDistance * 32;
-    const uint32_t x0 =    xCoord * 32 + 15;
-    const uint32_t y0 =    yCoord * 32 + 15;
+    // Pad the canvas by the search radius so that features just outside the cell are still found
+    const int32_t maxDist = g_maxDistance * 16;
+    const uint32_t width = cellsX * 16 + maxDist * 2;
+    const uint32_t height = cellsY * 16 + maxDist * 2;
 
-    uint32_t left =        (uint32_t)max(0, (int32_t)(x0 - radius + 1));
-    uint32_t right =    x0 + radius - 1;
-    uint32_t top =        (uint32_t)max(0, (int32_t)(y0 - radius + 1));
-    uint32_t bottom =    y0 + radius - 1;
+    scratch.bits.resize(width * height);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        uint8_t* row = &scratch.bits[y * width];
+        for (uint32_t x = 0; x < width; ++x)
+            row[x] = ReadCanvasBit(canvas, x - maxDist, y - maxDist) ? 1 : 0;
+    }
 
-    uint32_t bestDistSq = radius * radius;
+    scratch.toInside.assign(width, maxDist);
+    scratch.toOutside.assign(width, maxDist);
+    scratch.centerToInside.resize(width * cellsY);
+    scratch.centerToOutside.resize(width * cellsY);
 
-    for (uint32_t y1 = top; y1 <= bottom; y1 += 2)
+    // Texel centers lie between canvas rows 7 and 8 of their cell.  Going down, record the distance from row 7
+    // to features above it.
+    for (uint32_t y = 0; y < height; ++y)
     {
-        int32_t distY = (int32_t)(y1 - y0);
-        uint32_t distYSq = (uint32_t)(distY * distY);
+        AdvanceColumnDistances(&scratch.bits[y * width], scratch.toInside.data(), scratch.toOutside.data(), width, maxDist);
 
-        if (distYSq >= bestDistSq)
+        uint32_t cellRow = y - maxDist;
+        if (cellRow < cellsY * 16 && (cellRow & 15) == 7)
         {
-            if (y1 > y0)
-                continue;
-            else
-                break;
+            memcpy(&scratch.centerToInside[(cellRow / 16) * width], scratch.toInside.data(), width * sizeof(int32_t));
+            memcpy(&scratch.centerToOutside[(cellRow / 16) * width], scratch.toOutside.data(), width * sizeof(int32_t));
         }
+    }
 
-        for (uint32_t x1 = left; x1 <= right; x1 += 2)
-        {
-            int32_t distX = (int32_t)(x1 - x0);
-            uint32_t distXSq = (uint32_t)(distX * distX);
+    // Going up, combine with the distance from row 8 to features below it.
+    scratch.toInside.assign(width, maxDist);
+    scratch.toOutside.assign(width, maxDist);
 
-            uint32_t distSq = (uint32_t)(distXSq + distYSq);
-            if (distSq < bestDistSq && ReadCanvasBit(canvas, x1 >> 1, y1 >> 1))
-                bestDistSq = distSq;
+    for (uint32_t y = height; y-- > 0; )
+    {
+        AdvanceColumnDistances(&scratch.bits[y * width], scratch.toInside.data(), scratch.toOutside.data(), width, maxDist);
+
+        uint32_t cellRow = y - maxDist;
+        if (cellRow < cellsY * 16 && (cellRow & 15) == 8)
+        {
+            int32_t* centerToInside = &scratch.centerToInside[(cellRow / 16) * width];
+            int32_t* centerToOutside = &scratch.centerToOutside[(cellRow / 16) * width];
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                centerToInside[x] = min(centerToInside[x], scratch.toInside[x]);
+                centerToOutside[x] = min(centerToOutside[x], scratch.toOutside[x]);
+            }
         }
     }
 
-    return sqrt((float)bestDistSq) / (float)radius;
+    vector<float> insideDist(cellsX), outsideDist(cellsX);
+
+    for (uint32_t y = 0; y < cellsY; ++y)
+    {
+        // Each texel center sits half a pixel right of canvas column 7 of its cell
+        const double firstCenter = maxDist + 7.5;
+        SampleRowDistances(&scratch.centerToOutside[y * width], width, maxDist, scratch, firstCenter, 16.0, cellsX, insideDist.data());
+        SampleRowDistances(&scratch.centerToInside[y * width], width, maxDist, scratch, firstCenter, 16.0, cellsX, outsideDist.data());
+
+        const uint8_t* row7 = &scratch.bits[(maxDist + y * 16 + 7) * width + maxDist];
+        const uint8_t* row8 = row7 + width;
+
+        for (uint32_t x = 0; x < cellsX; ++x)
+        {
+            bool inside = row7[x * 16 + 7] & row7[x * 16 + 8] & row8[x * 16 + 7] & row8[x * 16 + 8];
+
+            if (inside)
+                distanceMap[startX + x + (startY + y) * mapWidth] = +insideDist[x];
+            else
+                distanceMap[startX + x + (startY + y) * mapWidth] = -outsideDist[x];
+        }
+    }
 }
 
 // Get width and spacing of a given glyph to compute necessary space and layout in final texture.
@@ -283,10 +375,74 @@ uint32_t UnwrapUVs(uint32_t textureWidth)
     return (y + rowSize + glyphBorder) / 16;
 }
 
-void PaintCharacters( float* distanceMap, uint32_t width, uint32_t /*height*/ )
+// Glyphs are dealt out to per-thread queues in contiguous ranges.  A thread that runs out of glyphs steals
+// the back half of another thread's remaining range, so large glyphs don't leave the other threads idle.
+struct __declspec(align(64)) GlyphQueue
+{
+    std::mutex lock;
+    uint32_t begin;
+    uint32_t end;
+};
+
+GlyphQueue g_glyphQueues[kMaxThreads];
+uint32_t g_numGlyphQueues = 0;
+
+void InitializeGlyphQueues( uint32_t numQueues )
 {
-    int32_t i = -1;
-    while ((i = _InterlockedExchangeAdd((volatile long*)&g_nextGlyphIdx, 1)) < g_numGlyphs)
+    g_numGlyphQueues = numQueues;
+
+    for (uint32_t i = 0; i < numQueues; ++i)
+    {
+        g_glyphQueues[i].begin = (uint32_t)((uint64_t)g_numGlyphs * i / numQueues);
+        g_glyphQueues[i].end = (uint32_t)((uint64_t)g_numGlyphs * (i + 1) / numQueues);
+    }
+}
+
+bool PopGlyph( uint32_t queueIdx, uint32_t& glyphIdx )
+{
+    GlyphQueue& queue = g_glyphQueues[queueIdx];
+
+    {
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.begin < queue.end)
+        {
+            glyphIdx = queue.begin++;
+            return true;
+        }
+    }
+
+    for (uint32_t n = 1; n < g_numGlyphQueues; ++n)
+    {
+        GlyphQueue& victim = g_glyphQueues[(queueIdx + n) % g_numGlyphQueues];
+        uint32_t stolenBegin, stolenEnd;
+
+        {
+            lock_guard<mutex> guard(victim.lock);
+            uint32_t remaining = victim.end - victim.begin;
+            if (remaining == 0)
+                continue;
+
+            stolenEnd = victim.end;
+            stolenBegin = victim.end - (remaining + 1) / 2;
+            victim.end = stolenBegin;
+        }
+
+        lock_guard<mutex> guard(queue.lock);
+        queue.begin = stolenBegin + 1;
+        queue.end = stolenEnd;
+        glyphIdx = stolenBegin;
+        return true;
+    }
+
+    return false;
+}
+
+void PaintCharacters( uint32_t queueIdx, float* distanceMap, uint32_t width, uint32_t /*height*/ )
+{
+    DistanceScratch scratch;
+    uint32_t i;
+
+    while (PopGlyph(queueIdx, i))
     {
         // Get the character info
         const GlyphInfo& ch = g_glyphs[i];
@@ -302,26 +458,12 @@ void PaintCharacters( float* distanceMap, uint32_t width, uint32_t /*height*/ )
         uint32_t startY = ch.v / 16 - g_borderSize;
 
         // Convert high-res bitmap to low-res distance map
-        for (uint32_t x = 0; x < charWidth + g_borderSize * 2; ++x)
-        {
-            for (uint32_t y = 0; y < charHeight + g_borderSize * 2; ++y)
-            {
-                uint32_t left = x * 16 + 7;
-                uint32_t top = y * 16 + 7;
-
-                bool inside = ReadCanvasBit(canvas, left, top) & ReadCanvasBit(canvas, left + 1, top) &
-                    ReadCanvasBit(canvas, left, top + 1) & ReadCanvasBit(canvas, left + 1, top + 1);
-
-                if (inside)
-                    distanceMap[startX + x + (startY + y) * width] = +DistanceFromInside(canvas, x, y);
-                else
-                    distanceMap[startX + x + (startY + y) * width] = -DistanceFromOutside(canvas, x, y);
-            }
-        }
+        ComputeCellDistances(canvas, charWidth + g_borderSize * 2, charHeight + g_borderSize * 2, scratch,
+            distanceMap, width, startX, startY);
     }
 }
 
-void WorkerFunc( void )
+void WorkerFunc( uint32_t queueIdx )
 {
     // We can initialize FreeType while we wait to paint the alphabet
     InitializeFont();
@@ -330,7 +472,7 @@ void WorkerFunc( void )
     while (!g_ReadyToPaint)
         std::this_thread::sleep_for(std::chrono::milliseconds(2));
 
-    PaintCharacters(g_DistanceMap, g_MapWidth, g_MapHeight);
+    PaintCharacters(queueIdx, g_DistanceMap, g_MapWidth, g_MapHeight);
 
     ShutdownFont();
 }
@@ -406,13 +548,16 @@ void CompileFont(const string& outputName)
 
     std::vector<std::thread> Threads;
 
+    numThreads = min(max(numThreads, (size_t)1), (size_t)kMaxThreads);
+    InitializeGlyphQueues((uint32_t)numThreads);
+
     if (numThreads > 1)
     {
         --numThreads;
 
         for (uint32_t i = 0; i < numThreads; ++i)
         {
-            Threads.push_back(std::thread(WorkerFunc));
+            Threads.push_back(std::thread(WorkerFunc, i + 1));
         }
     }
 
@@ -477,7 +622,7 @@ void CompileFont(const string& outputName)
     g_ReadyToPaint = true;
 
     // Also paint on the main thread
-    PaintCharacters(g_DistanceMap, g_MapWidth, g_MapHeight);
+    PaintCharacters(0, g_DistanceMap, g_MapWidth, g_MapHeight);
 
     // Wait for all of the other threads
     if (numThreads > 0)
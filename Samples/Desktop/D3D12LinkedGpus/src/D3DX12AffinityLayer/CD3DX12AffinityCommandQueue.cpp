@@ -88,6 +88,26 @@ void STDMETHODCALLTYPE CD3DX12AffinityCommandQueue::ExecuteCommandLists(
     UINT ActiveNodeIndex = GetActiveNodeIndex();
     UINT EffectiveAffinityMask = (AffinityMask == 0) ? GetNodeMask() : AffinityMask & GetNodeMask();
 
+    // Deferred command lists are closed by their replay, so this is where a failed Close() shows up.
+    // Such a command list is not executed on any node, executing it would remove the device.
+    std::vector<CD3DX12AffinityGraphicsCommandList*> ClosedCommandLists;
+    ClosedCommandLists.reserve(NumCommandLists);
+
+    for (UINT c = 0; c < NumCommandLists; ++c)
+    {
+        CD3DX12AffinityGraphicsCommandList* AffinityCommandList = static_cast<CD3DX12AffinityGraphicsCommandList*>(ppCommandLists[c]);
+        HRESULT const hr = AffinityCommandList->WaitForReplay();
+        if (S_OK != hr)
+        {
+            WriteHRESULTError(hr);
+            GetParentDevice()->WriteApplicationMessage(D3D12_MESSAGE_SEVERITY_ERROR,
+                "ExecuteCommandLists: a deferred command list failed to close and is not executed.");
+            continue;
+        }
+
+        ClosedCommandLists.push_back(AffinityCommandList);
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & EffectiveAffinityMask) != 0)
@@ -96,9 +116,8 @@ void STDMETHODCALLTYPE CD3DX12AffinityCommandQueue::ExecuteCommandLists(
                 ID3D12CommandQueue* Queue = mCommandQueues[i];
 
                 UINT index = 0;
-                for (UINT c = 0; c < NumCommandLists; ++c)
+                for (CD3DX12AffinityGraphicsCommandList* AffinityCommandList : ClosedCommandLists)
                 {
-                    CD3DX12AffinityGraphicsCommandList* AffinityCommandList = static_cast<CD3DX12AffinityGraphicsCommandList*>(ppCommandLists[c]);
                     if (AffinityCommandList->GetActiveAffinityMask() & (1 << i))
                     {
                         mCachedCommandLists[index++] = AffinityCommandList->GetChildObject(i);
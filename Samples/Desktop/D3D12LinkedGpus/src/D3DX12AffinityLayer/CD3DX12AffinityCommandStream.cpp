@@ -0,0 +1,91 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CD3DX12AffinityCommandStream.h"
+#include <malloc.h>
+#include <new>
+
+static_assert(sizeof(CD3DX12AffinityCommandStream::CommandHeader) % CD3DX12AffinityCommandStream::Alignment == 0,
+    "Command payloads must start on an aligned boundary");
+
+CD3DX12AffinityCommandStream::CD3DX12AffinityCommandStream(SIZE_T ChunkSize)
+    : mCurrentChunk(0)
+    , mChunkSize(ChunkSize)
+    , mCommandCount(0)
+    , mSizeInBytes(0)
+    , mAffinityMask(0)
+{
+}
+
+CD3DX12AffinityCommandStream::~CD3DX12AffinityCommandStream()
+{
+    for (Chunk& Current : mChunks)
+    {
+        _aligned_free(Current.Data);
+    }
+}
+
+void* CD3DX12AffinityCommandStream::Allocate(UINT16 Type, UINT AffinityMask, SIZE_T PayloadSize)
+{
+    SIZE_T const Size = (sizeof(CommandHeader) + PayloadSize + Alignment - 1) & ~(Alignment - 1);
+
+    // Move on to the next chunk if the command does not fit in the current one. Chunks
+    // left over from a previous recording are reused when they are large enough.
+    if (mChunks.empty() || mChunks[mCurrentChunk].Used + Size > mChunks[mCurrentChunk].Capacity)
+    {
+        SIZE_T NextChunk = mChunks.empty() ? 0 : mCurrentChunk + 1;
+
+        if (NextChunk >= mChunks.size() || mChunks[NextChunk].Capacity < Size)
+        {
+            Chunk NewChunk;
+            NewChunk.Capacity = Size > mChunkSize ? Size : mChunkSize;
+            NewChunk.Used = 0;
+            NewChunk.Data = static_cast<BYTE*>(_aligned_malloc(NewChunk.Capacity, Alignment));
+            if (!NewChunk.Data)
+            {
+                throw std::bad_alloc();
+            }
+
+            mChunks.insert(mChunks.begin() + NextChunk, NewChunk);
+        }
+
+        mCurrentChunk = NextChunk;
+        mChunks[mCurrentChunk].Used = 0;
+    }
+
+    Chunk& Current = mChunks[mCurrentChunk];
+    CommandHeader* Header = reinterpret_cast<CommandHeader*>(Current.Data + Current.Used);
+    Header->Type = Type;
+    Header->Reserved = 0;
+    Header->AffinityMask = AffinityMask;
+    Header->Size = static_cast<UINT>(Size);
+    Header->Padding = 0;
+
+    Current.Used += Size;
+    mSizeInBytes += Size;
+    mAffinityMask |= AffinityMask;
+    ++mCommandCount;
+
+    return Header + 1;
+}
+
+void CD3DX12AffinityCommandStream::Reset()
+{
+    if (!mChunks.empty())
+    {
+        mChunks[0].Used = 0;
+    }
+
+    mCurrentChunk = 0;
+    mCommandCount = 0;
+    mSizeInBytes = 0;
+    mAffinityMask = 0;
+}
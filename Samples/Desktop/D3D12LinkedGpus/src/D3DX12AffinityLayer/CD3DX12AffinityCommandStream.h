@@ -0,0 +1,95 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+/**
+ * A compact, arena-allocated stream of recorded commands. Deferred command lists
+ * record each API call once into the stream, then replay it onto the native
+ * command list of every node at Close() time.
+ *
+ * Commands are stored back to back in large chunks. Each command starts with a
+ * small header holding its type, the affinity mask it was recorded with and its
+ * total size, followed by a command-specific payload. Chunks are kept across
+ * Reset() so that steady state recording does not allocate.
+ */
+
+#pragma once
+
+#include "Utils.h"
+
+class CD3DX12AffinityCommandStream
+{
+public:
+    struct CommandHeader
+    {
+        UINT16 Type;
+        UINT16 Reserved;
+        UINT AffinityMask;
+        UINT Size;
+        UINT Padding;
+    };
+
+    // Payloads are aligned to this boundary, which is enough for any D3D12 struct.
+    static SIZE_T const Alignment = 16;
+
+    explicit CD3DX12AffinityCommandStream(SIZE_T ChunkSize = 64 * 1024);
+    ~CD3DX12AffinityCommandStream();
+
+    // Reserves space for a command and returns a pointer to its (uninitialized) payload.
+    void* Allocate(UINT16 Type, UINT AffinityMask, SIZE_T PayloadSize);
+
+    // Discards all recorded commands, keeping the chunks for reuse.
+    void Reset();
+
+    bool IsEmpty() const { return mCommandCount == 0; }
+    UINT GetCommandCount() const { return mCommandCount; }
+    SIZE_T GetSizeInBytes() const { return mSizeInBytes; }
+
+    // The union of the affinity masks of all recorded commands.
+    UINT GetAffinityMask() const { return mAffinityMask; }
+
+    // Calls Visit(CommandHeader const&, void const* Payload) for each command, in recording order.
+    template <typename VisitFunc>
+    void ForEach(VisitFunc Visit) const
+    {
+        for (SIZE_T c = 0; c <= mCurrentChunk && c < mChunks.size(); ++c)
+        {
+            Chunk const& Current = mChunks[c];
+            BYTE const* Command = Current.Data;
+            BYTE const* End = Current.Data + Current.Used;
+
+            while (Command < End)
+            {
+                CommandHeader const* Header = reinterpret_cast<CommandHeader const*>(Command);
+                Visit(*Header, Command + sizeof(CommandHeader));
+                Command += Header->Size;
+            }
+        }
+    }
+
+private:
+    struct Chunk
+    {
+        BYTE* Data;
+        SIZE_T Capacity;
+        SIZE_T Used;
+    };
+
+    std::vector<Chunk> mChunks;
+    SIZE_T mCurrentChunk;
+    SIZE_T mChunkSize;
+    UINT mCommandCount;
+    SIZE_T mSizeInBytes;
+    UINT mAffinityMask;
+
+    // Non-copyable
+    CD3DX12AffinityCommandStream(CD3DX12AffinityCommandStream const&);
+    CD3DX12AffinityCommandStream& operator=(CD3DX12AffinityCommandStream const&);
+};
@@ -55,6 +55,11 @@
 
 //#define ALWAYS_RESET_ALL_COMMAND_LISTS 1
 
+// Record each call on a graphics command list once and replay it onto the command
+// list of every node, in parallel, when the command list is closed. Individual command
+// lists can also opt in with CD3DX12AffinityGraphicsCommandList::SetDeferredRecording().
+//#define D3DX12_DEFERRED_COMMAND_RECORDING 1
+
 ////////////////////////////
 // DEBUG CONFIG ////////////
 ////////////////////////////
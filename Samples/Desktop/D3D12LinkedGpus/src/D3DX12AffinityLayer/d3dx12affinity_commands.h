@@ -0,0 +1,343 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+/**
+ * Payloads of the commands recorded by deferred CD3DX12AffinityGraphicsCommandLists.
+ *
+ * Payloads keep the affinity objects and the original (node 0) handles and addresses.
+ * Translation to the objects, descriptor handles and virtual addresses of each node
+ * happens at replay time. Variable length arrays (viewports, barriers, root constants,
+ * ...) are stored directly after the payload struct, in the same command.
+ */
+
+#pragma once
+
+#include "d3dx12affinity.h"
+
+enum class EAffinityRecordedCommand : UINT16
+{
+    ClearState,
+    DrawInstanced,
+    DrawIndexedInstanced,
+    Dispatch,
+    CopyBufferRegion,
+    CopyTextureRegion,
+    CopyResource,
+    CopyTiles,
+    ResolveSubresource,
+    IASetPrimitiveTopology,
+    RSSetViewports,
+    RSSetScissorRects,
+    OMSetBlendFactor,
+    OMSetStencilRef,
+    SetPipelineState,
+    ResourceBarrier,
+    ExecuteBundle,
+    SetDescriptorHeaps,
+    SetComputeRootSignature,
+    SetGraphicsRootSignature,
+    SetComputeRootDescriptorTable,
+    SetGraphicsRootDescriptorTable,
+    SetComputeRoot32BitConstant,
+    SetGraphicsRoot32BitConstant,
+    SetComputeRoot32BitConstants,
+    SetGraphicsRoot32BitConstants,
+    SetComputeRootConstantBufferView,
+    SetGraphicsRootConstantBufferView,
+    SetComputeRootShaderResourceView,
+    SetGraphicsRootShaderResourceView,
+    SetComputeRootUnorderedAccessView,
+    SetGraphicsRootUnorderedAccessView,
+    IASetIndexBuffer,
+    IASetVertexBuffers,
+    SOSetTargets,
+    OMSetRenderTargets,
+    ClearDepthStencilView,
+    ClearRenderTargetView,
+    ClearUnorderedAccessViewUint,
+    ClearUnorderedAccessViewFloat,
+    DiscardResource,
+    BeginQuery,
+    EndQuery,
+    ResolveQueryData,
+    SetPredication,
+    SetMarker,
+    BeginEvent,
+    EndEvent,
+    ExecuteIndirect,
+    BroadcastResource,
+};
+
+// Returns the offset, from the start of a payload, of the variable length array that follows it.
+template <typename ElementType, typename PayloadType>
+inline SIZE_T GetRecordedArrayOffset()
+{
+    return (sizeof(PayloadType) + __alignof(ElementType) - 1) & ~(__alignof(ElementType) - 1);
+}
+
+// Returns the variable length array that follows a recorded payload.
+template <typename ElementType, typename PayloadType>
+inline ElementType* GetRecordedArray(PayloadType* Payload)
+{
+    return reinterpret_cast<ElementType*>(reinterpret_cast<BYTE*>(Payload) + GetRecordedArrayOffset<ElementType, PayloadType>());
+}
+
+template <typename ElementType, typename PayloadType>
+inline ElementType const* GetRecordedArray(PayloadType const* Payload)
+{
+    return reinterpret_cast<ElementType const*>(reinterpret_cast<BYTE const*>(Payload) + GetRecordedArrayOffset<ElementType, PayloadType>());
+}
+
+struct D3DX12_RECORDED_PIPELINE_STATE
+{
+    CD3DX12AffinityPipelineState* pPipelineState;
+};
+
+struct D3DX12_RECORDED_DRAW_INSTANCED
+{
+    UINT VertexCountPerInstance;
+    UINT InstanceCount;
+    UINT StartVertexLocation;
+    UINT StartInstanceLocation;
+};
+
+struct D3DX12_RECORDED_DRAW_INDEXED_INSTANCED
+{
+    UINT IndexCountPerInstance;
+    UINT InstanceCount;
+    UINT StartIndexLocation;
+    INT BaseVertexLocation;
+    UINT StartInstanceLocation;
+};
+
+struct D3DX12_RECORDED_DISPATCH
+{
+    UINT ThreadGroupCountX;
+    UINT ThreadGroupCountY;
+    UINT ThreadGroupCountZ;
+};
+
+struct D3DX12_RECORDED_COPY_BUFFER_REGION
+{
+    CD3DX12AffinityResource* pDstBuffer;
+    UINT64 DstOffset;
+    CD3DX12AffinityResource* pSrcBuffer;
+    UINT64 SrcOffset;
+    UINT64 NumBytes;
+};
+
+struct D3DX12_RECORDED_COPY_TEXTURE_REGION
+{
+    D3DX12_AFFINITY_TEXTURE_COPY_LOCATION Dst;
+    D3DX12_AFFINITY_TEXTURE_COPY_LOCATION Src;
+    UINT DstX;
+    UINT DstY;
+    UINT DstZ;
+    BOOL HasSrcBox;
+    D3D12_BOX SrcBox;
+};
+
+struct D3DX12_RECORDED_COPY_RESOURCE
+{
+    CD3DX12AffinityResource* pDstResource;
+    CD3DX12AffinityResource* pSrcResource;
+};
+
+struct D3DX12_RECORDED_COPY_TILES
+{
+    CD3DX12AffinityResource* pTiledResource;
+    D3D12_TILED_RESOURCE_COORDINATE TileRegionStartCoordinate;
+    D3D12_TILE_REGION_SIZE TileRegionSize;
+    CD3DX12AffinityResource* pBuffer;
+    UINT64 BufferStartOffsetInBytes;
+    D3D12_TILE_COPY_FLAGS Flags;
+};
+
+struct D3DX12_RECORDED_RESOLVE_SUBRESOURCE
+{
+    CD3DX12AffinityResource* pDstResource;
+    UINT DstSubresource;
+    CD3DX12AffinityResource* pSrcResource;
+    UINT SrcSubresource;
+    DXGI_FORMAT Format;
+};
+
+struct D3DX12_RECORDED_PRIMITIVE_TOPOLOGY
+{
+    D3D12_PRIMITIVE_TOPOLOGY PrimitiveTopology;
+};
+
+// Followed by Count D3D12_VIEWPORTs, D3D12_RECTs, barriers or descriptor heaps.
+struct D3DX12_RECORDED_ARRAY
+{
+    UINT Count;
+};
+
+struct D3DX12_RECORDED_BLEND_FACTOR
+{
+    BOOL HasBlendFactor;
+    FLOAT BlendFactor[4];
+};
+
+struct D3DX12_RECORDED_STENCIL_REF
+{
+    UINT StencilRef;
+};
+
+struct D3DX12_RECORDED_EXECUTE_BUNDLE
+{
+    CD3DX12AffinityGraphicsCommandList* pCommandList;
+};
+
+struct D3DX12_RECORDED_ROOT_SIGNATURE
+{
+    CD3DX12AffinityRootSignature* pRootSignature;
+};
+
+struct D3DX12_RECORDED_ROOT_DESCRIPTOR_TABLE
+{
+    UINT RootParameterIndex;
+    D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor;
+};
+
+struct D3DX12_RECORDED_ROOT_32BIT_CONSTANT
+{
+    UINT RootParameterIndex;
+    UINT SrcData;
+    UINT DestOffsetIn32BitValues;
+};
+
+// Followed by Num32BitValuesToSet UINTs.
+struct D3DX12_RECORDED_ROOT_32BIT_CONSTANTS
+{
+    UINT RootParameterIndex;
+    UINT Num32BitValuesToSet;
+    UINT DestOffsetIn32BitValues;
+};
+
+struct D3DX12_RECORDED_ROOT_VIEW
+{
+    UINT RootParameterIndex;
+    D3D12_GPU_VIRTUAL_ADDRESS BufferLocation;
+};
+
+struct D3DX12_RECORDED_INDEX_BUFFER
+{
+    BOOL HasView;
+    D3D12_INDEX_BUFFER_VIEW View;
+};
+
+// Followed by NumViews D3D12_VERTEX_BUFFER_VIEWs or D3D12_STREAM_OUTPUT_BUFFER_VIEWs when HasViews is set.
+struct D3DX12_RECORDED_BUFFER_VIEWS
+{
+    UINT StartSlot;
+    UINT NumViews;
+    BOOL HasViews;
+};
+
+// Followed by NumRecordedDescriptors D3D12_CPU_DESCRIPTOR_HANDLEs.
+struct D3DX12_RECORDED_RENDER_TARGETS
+{
+    UINT NumRenderTargetDescriptors;
+    UINT NumRecordedDescriptors;
+    BOOL RTsSingleHandleToDescriptorRange;
+    BOOL HasDepthStencilDescriptor;
+    D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilDescriptor;
+};
+
+// Followed by NumRects D3D12_RECTs.
+struct D3DX12_RECORDED_CLEAR_DEPTH_STENCIL
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView;
+    D3D12_CLEAR_FLAGS ClearFlags;
+    FLOAT Depth;
+    UINT8 Stencil;
+    UINT NumRects;
+};
+
+// Followed by NumRects D3D12_RECTs.
+struct D3DX12_RECORDED_CLEAR_RENDER_TARGET
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE RenderTargetView;
+    FLOAT ColorRGBA[4];
+    UINT NumRects;
+};
+
+// Followed by NumRects D3D12_RECTs. Values holds either UINTs or FLOATs.
+struct D3DX12_RECORDED_CLEAR_UNORDERED_ACCESS_VIEW
+{
+    D3D12_GPU_DESCRIPTOR_HANDLE ViewGPUHandleInCurrentHeap;
+    D3D12_CPU_DESCRIPTOR_HANDLE ViewCPUHandle;
+    CD3DX12AffinityResource* pResource;
+    union
+    {
+        UINT Uint[4];
+        FLOAT Float[4];
+    } Values;
+    UINT NumRects;
+};
+
+// Followed by Region.NumRects D3D12_RECTs when HasRegion is set.
+struct D3DX12_RECORDED_DISCARD_RESOURCE
+{
+    CD3DX12AffinityResource* pResource;
+    BOOL HasRegion;
+    D3D12_DISCARD_REGION Region;
+};
+
+struct D3DX12_RECORDED_QUERY
+{
+    CD3DX12AffinityQueryHeap* pQueryHeap;
+    D3D12_QUERY_TYPE Type;
+    UINT Index;
+};
+
+struct D3DX12_RECORDED_RESOLVE_QUERY_DATA
+{
+    CD3DX12AffinityQueryHeap* pQueryHeap;
+    D3D12_QUERY_TYPE Type;
+    UINT StartIndex;
+    UINT NumQueries;
+    CD3DX12AffinityResource* pDestinationBuffer;
+    UINT64 AlignedDestinationBufferOffset;
+};
+
+struct D3DX12_RECORDED_PREDICATION
+{
+    CD3DX12AffinityResource* pBuffer;
+    UINT64 AlignedBufferOffset;
+    D3D12_PREDICATION_OP Operation;
+};
+
+// Followed by Size bytes of event data when HasData is set.
+struct D3DX12_RECORDED_EVENT
+{
+    UINT Metadata;
+    UINT Size;
+    BOOL HasData;
+};
+
+struct D3DX12_RECORDED_EXECUTE_INDIRECT
+{
+    CD3DX12AffinityCommandSignature* pCommandSignature;
+    UINT MaxCommandCount;
+    CD3DX12AffinityResource* pArgumentBuffer;
+    UINT64 ArgumentBufferOffset;
+    CD3DX12AffinityResource* pCountBuffer;
+    UINT64 CountBufferOffset;
+};
+
+struct D3DX12_RECORDED_BROADCAST_RESOURCE
+{
+    CD3DX12AffinityResource* pResource;
+    UINT NodeIndex;
+    UINT TargetNodeMask;
+};
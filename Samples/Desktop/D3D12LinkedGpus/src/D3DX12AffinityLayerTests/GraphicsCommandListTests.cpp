@@ -0,0 +1,619 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Checks affinity graphics command lists against a two node mock device: deferred recording
+// sends every node the same calls as immediate recording, objects and descriptor handles are
+// translated to the ones of each node, commands only reach the nodes of their affinity, command
+// lists can be reset and recorded again, and executing a command list waits for its replay and
+// skips it if it failed to close.
+// Reports how long a frame of draws takes to record and close with immediate and with deferred
+// recording.
+
+#include "stdafx.h"
+#include "MockDevice.h"
+
+using namespace std;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    UINT const NodeCount = 2;
+    UINT const AllNodes = (1 << NodeCount) - 1;
+
+    // Creates one named mock per node, named Name@0, Name@1, ...
+    template <typename MockType, typename NativeType>
+    void CreateNatives(string const& Name, NativeType** Natives)
+    {
+        for (UINT i = 0; i < NodeCount; ++i)
+        {
+            Natives[i] = new MockType(Name + "@" + to_string(i));
+        }
+    }
+
+    // A linked device and the affinity objects that the tests record commands with.
+    class Scene
+    {
+    public:
+        Scene()
+        {
+            MockDevice* Native = new MockDevice(NodeCount);
+            D3DX12AffinityCreateLDADevice(Native, &Device);
+            Native->Release();
+            CD3DX12AffinityDevice::g_ActiveNodeIndex = 0;
+
+            ID3D12CommandAllocator* Allocators[NodeCount];
+            CreateNatives<MockCommandAllocator>("Allocator", Allocators);
+            Allocator = Track(new CD3DX12AffinityCommandAllocator(Device, Allocators, NodeCount, false));
+
+            OpaquePipeline = Create<CD3DX12AffinityPipelineState, MockPipelineState, ID3D12PipelineState>("OpaquePipeline");
+            SkyPipeline = Create<CD3DX12AffinityPipelineState, MockPipelineState, ID3D12PipelineState>("SkyPipeline");
+            RootSignature = Create<CD3DX12AffinityRootSignature, MockRootSignature, ID3D12RootSignature>("RootSignature");
+            DescriptorHeaps[0] = Create<CD3DX12AffinityDescriptorHeap, MockDescriptorHeap, ID3D12DescriptorHeap>("ViewHeap");
+            DescriptorHeaps[1] = Create<CD3DX12AffinityDescriptorHeap, MockDescriptorHeap, ID3D12DescriptorHeap>("SamplerHeap");
+            QueryHeap = Create<CD3DX12AffinityQueryHeap, MockQueryHeap, ID3D12QueryHeap>("QueryHeap");
+            CommandSignature = Create<CD3DX12AffinityCommandSignature, MockCommandSignature, ID3D12CommandSignature>("CommandSignature");
+            RenderTarget = Create<CD3DX12AffinityResource, MockResource, ID3D12Resource>("RenderTarget");
+            DepthBuffer = Create<CD3DX12AffinityResource, MockResource, ID3D12Resource>("DepthBuffer");
+            Texture = Create<CD3DX12AffinityResource, MockResource, ID3D12Resource>("Texture");
+            Buffer = Create<CD3DX12AffinityResource, MockResource, ID3D12Resource>("Buffer");
+            TiledResource = Create<CD3DX12AffinityResource, MockResource, ID3D12Resource>("TiledResource");
+            ArgumentBuffer = Create<CD3DX12AffinityResource, MockResource, ID3D12Resource>("ArgumentBuffer");
+            Bundle = CreateCommandList("Bundle", nullptr, false);
+
+            // One handle per node, as the affinity descriptor heaps hand them out.
+            for (UINT r = 0; r < 2; ++r)
+            {
+                RenderTargetViews[r] = MockDescriptor{ { 0x1100 + r, 0x2100 + r } };
+            }
+            DepthStencilView = MockDescriptor{ { 0x1200, 0x2200 } };
+            DescriptorTable = MockDescriptor{ { 0x1300, 0x2300 } };
+            ShaderVisibleUnorderedAccessView = MockDescriptor{ { 0x1400, 0x2400 } };
+            UnorderedAccessView = MockDescriptor{ { 0x1500, 0x2500 } };
+        }
+
+        ~Scene()
+        {
+            for (CD3DX12AffinityObject* Object : mObjects)
+            {
+                Object->Release();
+            }
+            Device->Release();
+        }
+
+        // A command list that logs the calls of node i to Logs[i], or only counts them if Logs is null.
+        CD3DX12AffinityGraphicsCommandList* CreateCommandList(string const& Name, vector<string>* Logs, bool DeferredRecording)
+        {
+            ID3D12GraphicsCommandList* Natives[NodeCount];
+            for (UINT i = 0; i < NodeCount; ++i)
+            {
+                Natives[i] = new MockGraphicsCommandList(Name + "@" + to_string(i), Logs ? &Logs[i] : nullptr);
+            }
+
+            CD3DX12AffinityGraphicsCommandList* CommandList = new CD3DX12AffinityGraphicsCommandList(Device, Natives, NodeCount, false);
+            CommandList->SetDeferredRecording(DeferredRecording);
+            return Track(CommandList);
+        }
+
+        CD3DX12AffinityDevice* Device;
+        CD3DX12AffinityCommandAllocator* Allocator;
+        CD3DX12AffinityPipelineState* OpaquePipeline;
+        CD3DX12AffinityPipelineState* SkyPipeline;
+        CD3DX12AffinityRootSignature* RootSignature;
+        CD3DX12AffinityDescriptorHeap* DescriptorHeaps[2];
+        CD3DX12AffinityQueryHeap* QueryHeap;
+        CD3DX12AffinityCommandSignature* CommandSignature;
+        CD3DX12AffinityResource* RenderTarget;
+        CD3DX12AffinityResource* DepthBuffer;
+        CD3DX12AffinityResource* Texture;
+        CD3DX12AffinityResource* Buffer;
+        CD3DX12AffinityResource* TiledResource;
+        CD3DX12AffinityResource* ArgumentBuffer;
+        CD3DX12AffinityGraphicsCommandList* Bundle;
+
+        MockDescriptor RenderTargetViews[2];
+        MockDescriptor DepthStencilView;
+        MockDescriptor DescriptorTable;
+        MockDescriptor ShaderVisibleUnorderedAccessView;
+        MockDescriptor UnorderedAccessView;
+
+    private:
+        template <typename AffinityType, typename MockType, typename NativeType>
+        AffinityType* Create(string const& Name)
+        {
+            NativeType* Natives[NodeCount];
+            CreateNatives<MockType>(Name, Natives);
+            return Track(new AffinityType(Device, Natives, NodeCount));
+        }
+
+        template <typename AffinityType>
+        AffinityType* Track(AffinityType* Object)
+        {
+            mObjects.push_back(Object);
+            return Object;
+        }
+
+        vector<CD3DX12AffinityObject*> mObjects;
+    };
+
+    D3DX12_AFFINITY_RESOURCE_BARRIER Transition(CD3DX12AffinityResource* pResource, D3D12_RESOURCE_STATES StateBefore, D3D12_RESOURCE_STATES StateAfter)
+    {
+        D3DX12_AFFINITY_RESOURCE_BARRIER Barrier = {};
+        Barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        Barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+        Barrier.Transition.pResource = pResource;
+        Barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+        Barrier.Transition.StateBefore = StateBefore;
+        Barrier.Transition.StateAfter = StateAfter;
+        return Barrier;
+    }
+
+    // Calls every command of the command list at least once, with several affinities and with
+    // and without the optional arguments that immediate recording accepts.
+    void RecordEveryCommand(Scene& S, CD3DX12AffinityGraphicsCommandList* CommandList)
+    {
+        CommandList->SetAffinity(AllNodes);
+
+        CD3DX12AffinityDescriptorHeap* DescriptorHeaps[] = { S.DescriptorHeaps[0], S.DescriptorHeaps[1] };
+        CommandList->SetDescriptorHeaps(2, DescriptorHeaps);
+        CommandList->SetGraphicsRootSignature(S.RootSignature);
+        CommandList->SetComputeRootSignature(S.RootSignature);
+
+        D3DX12_AFFINITY_RESOURCE_BARRIER Barriers[3] = {};
+        Barriers[0] = Transition(S.RenderTarget, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        Barriers[1].Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+        Barriers[1].Aliasing.pResourceBefore = nullptr;
+        Barriers[1].Aliasing.pResourceAfter = S.Texture;
+        Barriers[2].Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+        Barriers[2].Flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+        Barriers[2].UAV.pResource = S.Buffer;
+        CommandList->ResourceBarrier(3, Barriers);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE RenderTargetViews[] = { S.RenderTargetViews[0].Cpu(), S.RenderTargetViews[1].Cpu() };
+        D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView = S.DepthStencilView.Cpu();
+        CommandList->OMSetRenderTargets(2, RenderTargetViews, FALSE, &DepthStencilView);
+        CommandList->OMSetRenderTargets(1, RenderTargetViews, TRUE, nullptr);
+
+        FLOAT const ClearColor[] = { 0.0f, 0.25f, 0.5f, 1.0f };
+        D3D12_RECT const ClearRects[] = { { 0, 0, 64, 32 }, { 64, 32, 128, 64 } };
+        CommandList->ClearRenderTargetView(RenderTargetViews[0], ClearColor, 2, ClearRects);
+        CommandList->ClearRenderTargetView(RenderTargetViews[1], ClearColor, 0, nullptr);
+        CommandList->ClearDepthStencilView(DepthStencilView, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 1, ClearRects);
+
+        UINT const ClearValues[] = { 1, 2, 3, 4 };
+        FLOAT const ClearFloats[] = { 0.5f, 1.5f, 2.5f, 3.5f };
+        CommandList->ClearUnorderedAccessViewUint(S.ShaderVisibleUnorderedAccessView.Gpu(), S.UnorderedAccessView.Cpu(), S.Buffer, ClearValues, 0, nullptr);
+        CommandList->ClearUnorderedAccessViewFloat(S.ShaderVisibleUnorderedAccessView.Gpu(), S.UnorderedAccessView.Cpu(), S.Texture, ClearFloats, 1, ClearRects);
+
+        D3D12_VIEWPORT const Viewports[] = { { 0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 1.0f }, { 640.0f, 0.0f, 640.0f, 360.0f, 0.5f, 1.0f } };
+        CommandList->RSSetViewports(2, Viewports);
+        CommandList->RSSetScissorRects(1, ClearRects);
+        CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+        FLOAT const BlendFactor[] = { 0.1f, 0.2f, 0.3f, 0.4f };
+        CommandList->OMSetBlendFactor(BlendFactor);
+        CommandList->OMSetBlendFactor(nullptr);
+        CommandList->OMSetStencilRef(3);
+        CommandList->SetPipelineState(S.SkyPipeline);
+
+        UINT const Constants[] = { 7, 8, 9 };
+        CommandList->SetGraphicsRootDescriptorTable(0, S.DescriptorTable.Gpu());
+        CommandList->SetComputeRootDescriptorTable(1, S.DescriptorTable.Gpu());
+        CommandList->SetGraphicsRoot32BitConstant(2, 42, 1);
+        CommandList->SetComputeRoot32BitConstant(3, 43, 2);
+        CommandList->SetGraphicsRoot32BitConstants(2, 3, Constants, 0);
+        CommandList->SetComputeRoot32BitConstants(3, 2, Constants, 1);
+        CommandList->SetGraphicsRootConstantBufferView(4, 0x10000);
+        CommandList->SetComputeRootConstantBufferView(4, 0x10100);
+        CommandList->SetGraphicsRootShaderResourceView(5, 0x20000);
+        CommandList->SetComputeRootShaderResourceView(5, 0x20100);
+        CommandList->SetGraphicsRootUnorderedAccessView(6, 0x30000);
+        CommandList->SetComputeRootUnorderedAccessView(6, 0x30100);
+
+        D3D12_INDEX_BUFFER_VIEW const IndexBufferView = { 0x40000, 4096, DXGI_FORMAT_R16_UINT };
+        D3D12_VERTEX_BUFFER_VIEW const VertexBufferViews[] = { { 0x50000, 8192, 32 }, { 0x60000, 4096, 16 } };
+        D3D12_STREAM_OUTPUT_BUFFER_VIEW const StreamOutputBufferView = { 0x70000, 1024, 0x70400 };
+        CommandList->IASetIndexBuffer(&IndexBufferView);
+        CommandList->IASetVertexBuffers(1, 2, VertexBufferViews);
+        CommandList->SOSetTargets(0, 1, &StreamOutputBufferView);
+
+        CommandList->DrawInstanced(3, 1, 0, 0);
+        CommandList->DrawIndexedInstanced(36, 2, 6, -4, 1);
+        CommandList->IASetIndexBuffer(nullptr);
+        CommandList->Dispatch(8, 4, 1);
+        CommandList->ExecuteBundle(S.Bundle);
+        CommandList->ExecuteIndirect(S.CommandSignature, 16, S.ArgumentBuffer, 256, S.Buffer, 64);
+        CommandList->ExecuteIndirect(S.CommandSignature, 4, S.ArgumentBuffer, 0, nullptr, 0);
+
+        // Node specific work.
+        CommandList->SetAffinity(1 << 1);
+        CommandList->DrawInstanced(6, 2, 3, 1);
+        CommandList->CopyBufferRegion(S.Buffer, 128, S.ArgumentBuffer, 0, 64);
+        CommandList->SetAffinity(1 << 0);
+        CommandList->Dispatch(1, 2, 3);
+        CommandList->BroadcastResource(S.Texture, 0, AllNodes);
+        CommandList->SetAffinity(AllNodes);
+
+        CommandList->CopyResource(S.Texture, S.RenderTarget);
+
+        D3DX12_AFFINITY_TEXTURE_COPY_LOCATION Destination = {};
+        Destination.pResource = S.Texture;
+        Destination.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+        Destination.SubresourceIndex = 2;
+        D3DX12_AFFINITY_TEXTURE_COPY_LOCATION Source = {};
+        Source.pResource = S.Buffer;
+        Source.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+        Source.PlacedFootprint.Offset = 256;
+        Source.PlacedFootprint.Footprint.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        Source.PlacedFootprint.Footprint.Width = 64;
+        Source.PlacedFootprint.Footprint.Height = 32;
+        Source.PlacedFootprint.Footprint.Depth = 1;
+        Source.PlacedFootprint.Footprint.RowPitch = 256;
+        D3D12_BOX const SourceBox = { 0, 0, 0, 32, 16, 1 };
+        CommandList->CopyTextureRegion(&Destination, 4, 8, 0, &Source, &SourceBox);
+        CommandList->CopyTextureRegion(&Destination, 0, 0, 0, &Source, nullptr);
+
+        D3D12_TILED_RESOURCE_COORDINATE const TileCoordinate = { 1, 2, 0, 0 };
+        D3D12_TILE_REGION_SIZE const TileRegionSize = { 4, TRUE, 2, 2, 1 };
+        CommandList->CopyTiles(S.TiledResource, &TileCoordinate, &TileRegionSize, S.Buffer, 512, D3D12_TILE_COPY_FLAG_NONE);
+        CommandList->ResolveSubresource(S.Texture, 1, S.RenderTarget, 0, DXGI_FORMAT_R8G8B8A8_UNORM);
+
+        D3D12_DISCARD_REGION const DiscardRegion = { 2, ClearRects, 0, 1 };
+        CommandList->DiscardResource(S.Texture, &DiscardRegion);
+        CommandList->DiscardResource(S.DepthBuffer, nullptr);
+
+        CommandList->BeginQuery(S.QueryHeap, D3D12_QUERY_TYPE_OCCLUSION, 3);
+        CommandList->EndQuery(S.QueryHeap, D3D12_QUERY_TYPE_OCCLUSION, 3);
+        CommandList->ResolveQueryData(S.QueryHeap, D3D12_QUERY_TYPE_OCCLUSION, 0, 4, S.Buffer, 1024);
+        CommandList->SetPredication(S.Buffer, 1024, D3D12_PREDICATION_OP_NOT_EQUAL_ZERO);
+
+        char const EventName[] = "Frame";
+        CommandList->BeginEvent(1, EventName, sizeof(EventName));
+        CommandList->SetMarker(1, EventName, sizeof(EventName));
+        CommandList->SetMarker(0, nullptr, 0);
+        CommandList->EndEvent();
+
+        CommandList->ClearState(S.OpaquePipeline);
+        D3DX12_AFFINITY_RESOURCE_BARRIER const PresentBarrier = Transition(S.RenderTarget, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+        CommandList->ResourceBarrier(1, &PresentBarrier);
+    }
+
+    void AssertLogsEqual(vector<string> const& Expected, vector<string> const& Actual)
+    {
+        for (size_t l = 0; l < Expected.size() && l < Actual.size(); ++l)
+        {
+            Assert::AreEqual(Expected[l].c_str(), Actual[l].c_str());
+        }
+        Assert::AreEqual(Expected.size(), Actual.size());
+    }
+
+    // Calls on a command list of a typical frame: state setup, then DrawCount draws with their own
+    // root arguments and vertex buffers, as the samples record their scenes.
+    void RecordFrame(Scene& S, CD3DX12AffinityGraphicsCommandList* CommandList, UINT DrawCount)
+    {
+        CommandList->Reset(S.Allocator, S.OpaquePipeline);
+
+        CD3DX12AffinityDescriptorHeap* DescriptorHeaps[] = { S.DescriptorHeaps[0], S.DescriptorHeaps[1] };
+        CommandList->SetDescriptorHeaps(2, DescriptorHeaps);
+        CommandList->SetGraphicsRootSignature(S.RootSignature);
+
+        D3DX12_AFFINITY_RESOURCE_BARRIER Barrier = Transition(S.RenderTarget, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        CommandList->ResourceBarrier(1, &Barrier);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE RenderTargetView = S.RenderTargetViews[0].Cpu();
+        D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView = S.DepthStencilView.Cpu();
+        FLOAT const ClearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+        CommandList->OMSetRenderTargets(1, &RenderTargetView, FALSE, &DepthStencilView);
+        CommandList->ClearRenderTargetView(RenderTargetView, ClearColor, 0, nullptr);
+        CommandList->ClearDepthStencilView(DepthStencilView, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+
+        D3D12_VIEWPORT const Viewport = { 0.0f, 0.0f, 1920.0f, 1080.0f, 0.0f, 1.0f };
+        D3D12_RECT const ScissorRect = { 0, 0, 1920, 1080 };
+        CommandList->RSSetViewports(1, &Viewport);
+        CommandList->RSSetScissorRects(1, &ScissorRect);
+        CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        CommandList->SetGraphicsRootDescriptorTable(0, S.DescriptorTable.Gpu());
+
+        D3D12_INDEX_BUFFER_VIEW const IndexBufferView = { 0x40000, 1 << 20, DXGI_FORMAT_R16_UINT };
+        CommandList->IASetIndexBuffer(&IndexBufferView);
+
+        for (UINT d = 0; d < DrawCount; ++d)
+        {
+            if (d % 64 == 0)
+            {
+                CommandList->SetPipelineState((d / 64) % 2 ? S.SkyPipeline : S.OpaquePipeline);
+            }
+
+            UINT const Constants[] = { d, d * 3, d * 7, 1 };
+            D3D12_VERTEX_BUFFER_VIEW const VertexBufferView = { 0x100000 + UINT64(d) * 4096, 4096, 32 };
+            CommandList->SetGraphicsRoot32BitConstants(1, 4, Constants, 0);
+            CommandList->SetGraphicsRootConstantBufferView(2, 0x200000 + UINT64(d) * 256);
+            CommandList->IASetVertexBuffers(0, 1, &VertexBufferView);
+            CommandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
+        }
+
+        Barrier = Transition(S.RenderTarget, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+        CommandList->ResourceBarrier(1, &Barrier);
+        CommandList->Close();
+    }
+
+    MockGraphicsCommandList* GetMockCommandList(CD3DX12AffinityGraphicsCommandList* CommandList, UINT NodeIndex)
+    {
+        return static_cast<MockGraphicsCommandList*>(CommandList->GetChildObject(NodeIndex));
+    }
+}
+
+namespace D3DX12AffinityLayerTests
+{
+    TEST_CLASS(GraphicsCommandListTests)
+    {
+    public:
+        TEST_METHOD(DeferredRecordingMatchesImmediateRecording)
+        {
+            Scene S;
+            vector<string> ImmediateLogs[NodeCount];
+            vector<string> DeferredLogs[NodeCount];
+            CD3DX12AffinityGraphicsCommandList* Immediate = S.CreateCommandList("Immediate", ImmediateLogs, false);
+            CD3DX12AffinityGraphicsCommandList* Deferred = S.CreateCommandList("Deferred", DeferredLogs, true);
+
+            for (CD3DX12AffinityGraphicsCommandList* CommandList : { Immediate, Deferred })
+            {
+                Assert::AreEqual(S_OK, CommandList->Reset(S.Allocator, S.OpaquePipeline));
+                RecordEveryCommand(S, CommandList);
+                Assert::AreEqual(S_OK, CommandList->Close());
+                Assert::AreEqual(S_OK, CommandList->WaitForReplay());
+            }
+
+            for (UINT i = 0; i < NodeCount; ++i)
+            {
+                Assert::IsTrue(ImmediateLogs[i].size() > 60);
+                AssertLogsEqual(ImmediateLogs[i], DeferredLogs[i]);
+            }
+            Assert::IsTrue(Deferred->GetCommandStream().IsEmpty());
+        }
+
+        TEST_METHOD(CommandsAreTranslatedForEachNode)
+        {
+            for (bool DeferredRecording : { false, true })
+            {
+                Scene S;
+                vector<string> Logs[NodeCount];
+                CD3DX12AffinityGraphicsCommandList* CommandList = S.CreateCommandList("CommandList", Logs, DeferredRecording);
+
+                CommandList->Reset(S.Allocator, S.OpaquePipeline);
+                D3DX12_AFFINITY_RESOURCE_BARRIER Barrier = Transition(S.RenderTarget, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+                CommandList->ResourceBarrier(1, &Barrier);
+                D3D12_CPU_DESCRIPTOR_HANDLE RenderTargetViews[] = { S.RenderTargetViews[0].Cpu(), S.RenderTargetViews[1].Cpu() };
+                D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView = S.DepthStencilView.Cpu();
+                CommandList->OMSetRenderTargets(2, RenderTargetViews, FALSE, &DepthStencilView);
+                CommandList->SetGraphicsRootDescriptorTable(0, S.DescriptorTable.Gpu());
+                CommandList->SetGraphicsRootConstantBufferView(1, 0x10000);
+                CD3DX12AffinityDescriptorHeap* DescriptorHeaps[] = { S.DescriptorHeaps[0], S.DescriptorHeaps[1] };
+                CommandList->SetDescriptorHeaps(2, DescriptorHeaps);
+                CommandList->ExecuteBundle(S.Bundle);
+                CommandList->Close();
+                CommandList->WaitForReplay();
+
+                for (UINT i = 0; i < NodeCount; ++i)
+                {
+                    vector<string> Expected = {
+                        Format("Reset Allocator@%u OpaquePipeline@%u", i, i),
+                        Format("ResourceBarrier 1 (transition 0 RenderTarget@%u 4294967295 %d %d)", i, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET),
+                        Format("OMSetRenderTargets 2 0 %x %x depth %x", 0x1100 + i * 0x1000, 0x1101 + i * 0x1000, 0x1200 + i * 0x1000),
+                        Format("SetGraphicsRootDescriptorTable 0 %x", 0x1300 + i * 0x1000),
+                        "SetGraphicsRootConstantBufferView 1 10000",
+                        Format("SetDescriptorHeaps 2 ViewHeap@%u SamplerHeap@%u", i, i),
+                        Format("ExecuteBundle Bundle@%u", i),
+                        "Close",
+                    };
+                    AssertLogsEqual(Expected, Logs[i]);
+                }
+            }
+        }
+
+        TEST_METHOD(CommandsOnlyReachTheNodesOfTheirAffinity)
+        {
+            for (bool DeferredRecording : { false, true })
+            {
+                Scene S;
+                vector<string> Logs[NodeCount];
+                CD3DX12AffinityGraphicsCommandList* CommandList = S.CreateCommandList("CommandList", Logs, DeferredRecording);
+
+                CommandList->Reset(S.Allocator, nullptr);
+                CommandList->DrawInstanced(1, 1, 0, 0);
+                CommandList->SetAffinity(1 << 1);
+                CommandList->DrawInstanced(2, 1, 0, 0);
+                CommandList->SetAffinity(1 << 0);
+                CommandList->DrawInstanced(3, 1, 0, 0);
+                CommandList->BroadcastResource(S.Texture, 0, AllNodes);
+                CommandList->SetAffinity(AllNodes);
+                CommandList->DrawInstanced(4, 1, 0, 0);
+                CommandList->Close();
+                CommandList->WaitForReplay();
+
+                AssertLogsEqual({
+                    "Reset Allocator@0 null",
+                    "DrawInstanced 1 1 0 0",
+                    "DrawInstanced 3 1 0 0",
+                    "CopyResource Texture@1 Texture@0",
+                    "DrawInstanced 4 1 0 0",
+                    "Close" }, Logs[0]);
+                AssertLogsEqual({
+                    "Reset Allocator@1 null",
+                    "DrawInstanced 1 1 0 0",
+                    "DrawInstanced 2 1 0 0",
+                    "DrawInstanced 4 1 0 0",
+                    "Close" }, Logs[1]);
+            }
+        }
+
+        TEST_METHOD(CommandListsCanBeRecordedAgainAfterReset)
+        {
+            Scene S;
+            vector<string> ImmediateLogs[NodeCount];
+            vector<string> DeferredLogs[NodeCount];
+            CD3DX12AffinityGraphicsCommandList* Immediate = S.CreateCommandList("Immediate", ImmediateLogs, false);
+            CD3DX12AffinityGraphicsCommandList* Deferred = S.CreateCommandList("Deferred", DeferredLogs, true);
+
+            for (UINT Frame = 0; Frame < 3; ++Frame)
+            {
+                for (vector<string>& Log : DeferredLogs)
+                {
+                    Log.clear();
+                }
+                for (vector<string>& Log : ImmediateLogs)
+                {
+                    Log.clear();
+                }
+
+                // Later frames record fewer draws than the first, so stale commands would show.
+                RecordFrame(S, Immediate, 1000 >> Frame);
+                RecordFrame(S, Deferred, 1000 >> Frame);
+                Deferred->WaitForReplay();
+
+                for (UINT i = 0; i < NodeCount; ++i)
+                {
+                    AssertLogsEqual(ImmediateLogs[i], DeferredLogs[i]);
+                }
+                Assert::IsTrue(Deferred->GetCommandStream().IsEmpty());
+            }
+        }
+
+        TEST_METHOD(DeferredRecordingAcceptsNullOptionalArguments)
+        {
+            Scene S;
+            vector<string> Logs[NodeCount];
+            CD3DX12AffinityGraphicsCommandList* CommandList = S.CreateCommandList("CommandList", Logs, true);
+
+            CommandList->Reset(S.Allocator, S.OpaquePipeline);
+            CommandList->ClearState(nullptr);
+            CommandList->SetPredication(nullptr, 0, D3D12_PREDICATION_OP_EQUAL_ZERO);
+            CommandList->IASetVertexBuffers(0, 2, nullptr);
+            CommandList->SOSetTargets(0, 1, nullptr);
+            CommandList->Close();
+            CommandList->WaitForReplay();
+
+            for (UINT i = 0; i < NodeCount; ++i)
+            {
+                AssertLogsEqual({
+                    Format("Reset Allocator@%u OpaquePipeline@%u", i, i),
+                    "ClearState null",
+                    "SetPredication null 0 0",
+                    "IASetVertexBuffers 0 2 null",
+                    "SOSetTargets 0 1 null",
+                    "Close" }, Logs[i]);
+            }
+        }
+
+        TEST_METHOD(ExecutingACommandListWaitsForItsReplay)
+        {
+            Scene S;
+            D3D12_COMMAND_QUEUE_DESC const QueueDesc = { D3D12_COMMAND_LIST_TYPE_DIRECT };
+            CD3DX12AffinityCommandQueue* Queue = nullptr;
+            Assert::AreEqual(S_OK, S.Device->CreateCommandQueue(&QueueDesc, IID_PPV_ARGS(&Queue)));
+
+            // Slow enough native calls that the replay is still running when Close() returns.
+            CD3DX12AffinityGraphicsCommandList* CommandList = S.CreateCommandList("CommandList", nullptr, true);
+            for (UINT i = 0; i < NodeCount; ++i)
+            {
+                GetMockCommandList(CommandList, i)->SetCallTime(chrono::microseconds(20));
+            }
+            RecordFrame(S, CommandList, 1000);
+
+            CD3DX12AffinityCommandList* CommandLists[] = { CommandList };
+            Queue->ExecuteCommandLists(1, CommandLists);
+
+            for (UINT i = 0; i < NodeCount; ++i)
+            {
+                MockCommandQueue* NativeQueue = static_cast<MockCommandQueue*>(Queue->GetChildObject(i));
+                AssertLogsEqual({ Format("CommandList@%u", i) }, NativeQueue->GetExecutedCommandLists());
+            }
+            Queue->Release();
+        }
+
+        TEST_METHOD(CommandListsThatFailToCloseAreNotExecuted)
+        {
+            Scene S;
+            D3D12_COMMAND_QUEUE_DESC const QueueDesc = { D3D12_COMMAND_LIST_TYPE_DIRECT };
+            CD3DX12AffinityCommandQueue* Queue = nullptr;
+            Assert::AreEqual(S_OK, S.Device->CreateCommandQueue(&QueueDesc, IID_PPV_ARGS(&Queue)));
+
+            // The native command list of node 1 fails to close, after Close() has returned.
+            CD3DX12AffinityGraphicsCommandList* Failing = S.CreateCommandList("Failing", nullptr, true);
+            CD3DX12AffinityGraphicsCommandList* Working = S.CreateCommandList("Working", nullptr, true);
+            GetMockCommandList(Failing, 1)->SetCloseResult(E_OUTOFMEMORY);
+            RecordFrame(S, Failing, 10);
+            RecordFrame(S, Working, 10);
+
+            CD3DX12AffinityCommandList* CommandLists[] = { Failing, Working };
+            Queue->ExecuteCommandLists(2, CommandLists);
+
+            // Not on node 0 either, where it closed: the nodes have to execute the same command lists.
+            for (UINT i = 0; i < NodeCount; ++i)
+            {
+                MockCommandQueue* NativeQueue = static_cast<MockCommandQueue*>(Queue->GetChildObject(i));
+                AssertLogsEqual({ Format("Working@%u", i) }, NativeQueue->GetExecutedCommandLists());
+            }
+            Queue->Release();
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(RecordingBenchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(RecordingBenchmark)
+        {
+            UINT const FrameCount = 100;
+            Scene S;
+
+            // Without any time spent in the native calls, the timings are the overhead of the layer.
+            // With it, they show how much the replay of the nodes on the thread pool, which overlaps
+            // with recording the next frame, takes off the frame time of the recording thread.
+            LogMessage("Record and close a frame on %u nodes, %u frames each, on %u hardware threads:", NodeCount, FrameCount, thread::hardware_concurrency());
+            for (UINT CallTime : { 0u, 200u })
+            {
+                for (UINT DrawCount : { 100u, 1000u, 10000u })
+                {
+                    CD3DX12AffinityGraphicsCommandList* CommandLists[] = {
+                        S.CreateCommandList("Immediate", nullptr, false),
+                        S.CreateCommandList("Deferred", nullptr, true) };
+
+                    double Seconds[2] = {};
+                    for (UINT m = 0; m < 2; ++m)
+                    {
+                        for (UINT i = 0; i < NodeCount; ++i)
+                        {
+                            GetMockCommandList(CommandLists[m], i)->SetCallTime(chrono::nanoseconds(CallTime));
+                        }
+
+                        // The first frame allocates the stream and starts the replay threads.
+                        RecordFrame(S, CommandLists[m], DrawCount);
+
+                        double const Start = BenchmarkTime();
+                        for (UINT Frame = 0; Frame < FrameCount; ++Frame)
+                        {
+                            RecordFrame(S, CommandLists[m], DrawCount);
+                        }
+                        CommandLists[m]->WaitForReplay();
+                        Seconds[m] = (BenchmarkTime() - Start) / FrameCount;
+                    }
+
+                    for (UINT i = 0; i < NodeCount; ++i)
+                    {
+                        Assert::AreEqual(GetMockCommandList(CommandLists[0], i)->GetCallCount(), GetMockCommandList(CommandLists[1], i)->GetCallCount());
+                    }
+
+                    UINT64 const CallsPerFrame = GetMockCommandList(CommandLists[0], 0)->GetCallCount() / (FrameCount + 1);
+                    LogMessage("  %3u ns per native call, %5u draws (%5llu calls per node): immediate %8.3f ms, deferred %8.3f ms (%.2fx)",
+                        CallTime, DrawCount, CallsPerFrame, Seconds[0] * 1e3, Seconds[1] * 1e3, Seconds[0] / Seconds[1]);
+                }
+            }
+        }
+    };
+}
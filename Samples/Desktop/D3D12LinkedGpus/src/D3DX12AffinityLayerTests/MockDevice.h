@@ -0,0 +1,1143 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+/**
+ * Mock D3D12 objects, so that the affinity layer can be tested without a GPU.
+ *
+ * The mock device reports two linked nodes. Every mock object has a name, and mock
+ * graphics command lists write each call they receive to a log, one line per call,
+ * with the names of the native objects and the descriptor handles, addresses and
+ * array contents they were given. Comparing logs shows what the layer forwarded to
+ * each node. Without a log, a command list only counts its calls, and can be made to
+ * spend a fixed time in each one, as a driver would.
+ *
+ * Descriptor handles handed out by the affinity layer point at one value per node;
+ * see CD3DX12AffinityDevice::GetCPUHeapPointer(). MockDescriptor makes such handles.
+ */
+
+#pragma once
+
+// Reference counted, named base of the mock objects. Objects start with one reference
+// and delete themselves when the last one is released, as native objects do.
+class MockName
+{
+public:
+    explicit MockName(std::string const& Name) : mName(Name) {}
+    virtual ~MockName() {}
+
+    std::string const& GetName() const { return mName; }
+
+private:
+    std::string mName;
+};
+
+// The name of a mock object, or "null".
+inline std::string NameOf(IUnknown* Object)
+{
+    if (!Object)
+    {
+        return "null";
+    }
+    MockName* Named = dynamic_cast<MockName*>(Object);
+    return Named ? Named->GetName() : "unknown";
+}
+
+template <typename Interface>
+class MockObject : public Interface, public MockName
+{
+public:
+    explicit MockObject(std::string const& Name) : MockName(Name), mReferenceCount(1) {}
+
+    // IUnknown
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+    {
+        UNREFERENCED_PARAMETER(riid);
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override
+    {
+        return ++mReferenceCount;
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+        ULONG const ReferenceCount = --mReferenceCount;
+        if (ReferenceCount == 0)
+        {
+            delete this;
+        }
+        return ReferenceCount;
+    }
+
+    // ID3D12Object
+    HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* pDataSize, void* pData) override
+    {
+        UNREFERENCED_PARAMETER(guid);
+        UNREFERENCED_PARAMETER(pDataSize);
+        UNREFERENCED_PARAMETER(pData);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT DataSize, const void* pData) override
+    {
+        UNREFERENCED_PARAMETER(guid);
+        UNREFERENCED_PARAMETER(DataSize);
+        UNREFERENCED_PARAMETER(pData);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* pData) override
+    {
+        UNREFERENCED_PARAMETER(guid);
+        UNREFERENCED_PARAMETER(pData);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetName(LPCWSTR Name) override
+    {
+        UNREFERENCED_PARAMETER(Name);
+        return S_OK;
+    }
+
+private:
+    std::atomic<ULONG> mReferenceCount;
+};
+
+template <typename Interface>
+class MockDeviceChild : public MockObject<Interface>
+{
+public:
+    explicit MockDeviceChild(std::string const& Name) : MockObject<Interface>(Name) {}
+
+    // ID3D12DeviceChild
+    HRESULT STDMETHODCALLTYPE GetDevice(REFIID riid, void** ppvDevice) override
+    {
+        UNREFERENCED_PARAMETER(riid);
+        *ppvDevice = nullptr;
+        return E_NOTIMPL;
+    }
+};
+
+// Objects the affinity layer only passes through.
+typedef MockDeviceChild<ID3D12RootSignature> MockRootSignature;
+typedef MockDeviceChild<ID3D12QueryHeap> MockQueryHeap;
+typedef MockDeviceChild<ID3D12CommandSignature> MockCommandSignature;
+
+class MockResource : public MockDeviceChild<ID3D12Resource>
+{
+public:
+    explicit MockResource(std::string const& Name) : MockDeviceChild<ID3D12Resource>(Name) {}
+
+    HRESULT STDMETHODCALLTYPE Map(UINT Subresource, const D3D12_RANGE* pReadRange, void** ppData) override
+    {
+        UNREFERENCED_PARAMETER(Subresource);
+        UNREFERENCED_PARAMETER(pReadRange);
+        UNREFERENCED_PARAMETER(ppData);
+        return E_NOTIMPL;
+    }
+
+    void STDMETHODCALLTYPE Unmap(UINT Subresource, const D3D12_RANGE* pWrittenRange) override
+    {
+        UNREFERENCED_PARAMETER(Subresource);
+        UNREFERENCED_PARAMETER(pWrittenRange);
+    }
+
+    D3D12_RESOURCE_DESC STDMETHODCALLTYPE GetDesc() override
+    {
+        D3D12_RESOURCE_DESC Desc = {};
+        return Desc;
+    }
+
+    D3D12_GPU_VIRTUAL_ADDRESS STDMETHODCALLTYPE GetGPUVirtualAddress() override
+    {
+        return 0;
+    }
+
+    HRESULT STDMETHODCALLTYPE WriteToSubresource(UINT DstSubresource, const D3D12_BOX* pDstBox, const void* pSrcData, UINT SrcRowPitch, UINT SrcDepthPitch) override
+    {
+        UNREFERENCED_PARAMETER(DstSubresource);
+        UNREFERENCED_PARAMETER(pDstBox);
+        UNREFERENCED_PARAMETER(pSrcData);
+        UNREFERENCED_PARAMETER(SrcRowPitch);
+        UNREFERENCED_PARAMETER(SrcDepthPitch);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE ReadFromSubresource(void* pDstData, UINT DstRowPitch, UINT DstDepthPitch, UINT SrcSubresource, const D3D12_BOX* pSrcBox) override
+    {
+        UNREFERENCED_PARAMETER(pDstData);
+        UNREFERENCED_PARAMETER(DstRowPitch);
+        UNREFERENCED_PARAMETER(DstDepthPitch);
+        UNREFERENCED_PARAMETER(SrcSubresource);
+        UNREFERENCED_PARAMETER(pSrcBox);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetHeapProperties(D3D12_HEAP_PROPERTIES* pHeapProperties, D3D12_HEAP_FLAGS* pHeapFlags) override
+    {
+        UNREFERENCED_PARAMETER(pHeapProperties);
+        UNREFERENCED_PARAMETER(pHeapFlags);
+        return E_NOTIMPL;
+    }
+};
+
+class MockPipelineState : public MockDeviceChild<ID3D12PipelineState>
+{
+public:
+    explicit MockPipelineState(std::string const& Name) : MockDeviceChild<ID3D12PipelineState>(Name) {}
+
+    HRESULT STDMETHODCALLTYPE GetCachedBlob(ID3DBlob** ppBlob) override
+    {
+        *ppBlob = nullptr;
+        return E_NOTIMPL;
+    }
+};
+
+class MockCommandAllocator : public MockDeviceChild<ID3D12CommandAllocator>
+{
+public:
+    explicit MockCommandAllocator(std::string const& Name) : MockDeviceChild<ID3D12CommandAllocator>(Name) {}
+
+    HRESULT STDMETHODCALLTYPE Reset() override
+    {
+        return S_OK;
+    }
+};
+
+class MockDescriptorHeap : public MockDeviceChild<ID3D12DescriptorHeap>
+{
+public:
+    explicit MockDescriptorHeap(std::string const& Name) : MockDeviceChild<ID3D12DescriptorHeap>(Name) {}
+
+    D3D12_DESCRIPTOR_HEAP_DESC STDMETHODCALLTYPE GetDesc() override
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC Desc = {};
+        return Desc;
+    }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE STDMETHODCALLTYPE GetCPUDescriptorHandleForHeapStart() override
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE Handle = {};
+        return Handle;
+    }
+
+    D3D12_GPU_DESCRIPTOR_HANDLE STDMETHODCALLTYPE GetGPUDescriptorHandleForHeapStart() override
+    {
+        D3D12_GPU_DESCRIPTOR_HANDLE Handle = {};
+        return Handle;
+    }
+};
+
+class MockFence : public MockDeviceChild<ID3D12Fence>
+{
+public:
+    explicit MockFence(std::string const& Name) : MockDeviceChild<ID3D12Fence>(Name) {}
+
+    UINT64 STDMETHODCALLTYPE GetCompletedValue() override
+    {
+        return 0;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetEventOnCompletion(UINT64 Value, HANDLE hEvent) override
+    {
+        UNREFERENCED_PARAMETER(Value);
+        UNREFERENCED_PARAMETER(hEvent);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE Signal(UINT64 Value) override
+    {
+        UNREFERENCED_PARAMETER(Value);
+        return E_NOTIMPL;
+    }
+};
+
+class MockCommandQueue : public MockDeviceChild<ID3D12CommandQueue>
+{
+public:
+    MockCommandQueue(std::string const& Name, D3D12_COMMAND_QUEUE_DESC const& Desc) : MockDeviceChild<ID3D12CommandQueue>(Name), mDesc(Desc) {}
+
+    // The names of the command lists executed so far, followed by " (open)" for those that were not closed.
+    std::vector<std::string> const& GetExecutedCommandLists() const { return mExecutedCommandLists; }
+
+    void STDMETHODCALLTYPE UpdateTileMappings(ID3D12Resource* pResource, UINT NumResourceRegions, const D3D12_TILED_RESOURCE_COORDINATE* pResourceRegionStartCoordinates, const D3D12_TILE_REGION_SIZE* pResourceRegionSizes, ID3D12Heap* pHeap, UINT NumRanges, const D3D12_TILE_RANGE_FLAGS* pRangeFlags, const UINT* pHeapRangeStartOffsets, const UINT* pRangeTileCounts, D3D12_TILE_MAPPING_FLAGS Flags) override
+    {
+        UNREFERENCED_PARAMETER(pResource);
+        UNREFERENCED_PARAMETER(NumResourceRegions);
+        UNREFERENCED_PARAMETER(pResourceRegionStartCoordinates);
+        UNREFERENCED_PARAMETER(pResourceRegionSizes);
+        UNREFERENCED_PARAMETER(pHeap);
+        UNREFERENCED_PARAMETER(NumRanges);
+        UNREFERENCED_PARAMETER(pRangeFlags);
+        UNREFERENCED_PARAMETER(pHeapRangeStartOffsets);
+        UNREFERENCED_PARAMETER(pRangeTileCounts);
+        UNREFERENCED_PARAMETER(Flags);
+    }
+
+    void STDMETHODCALLTYPE CopyTileMappings(ID3D12Resource* pDstResource, const D3D12_TILED_RESOURCE_COORDINATE* pDstRegionStartCoordinate, ID3D12Resource* pSrcResource, const D3D12_TILED_RESOURCE_COORDINATE* pSrcRegionStartCoordinate, const D3D12_TILE_REGION_SIZE* pRegionSize, D3D12_TILE_MAPPING_FLAGS Flags) override
+    {
+        UNREFERENCED_PARAMETER(pDstResource);
+        UNREFERENCED_PARAMETER(pDstRegionStartCoordinate);
+        UNREFERENCED_PARAMETER(pSrcResource);
+        UNREFERENCED_PARAMETER(pSrcRegionStartCoordinate);
+        UNREFERENCED_PARAMETER(pRegionSize);
+        UNREFERENCED_PARAMETER(Flags);
+    }
+
+    void STDMETHODCALLTYPE ExecuteCommandLists(UINT NumCommandLists, ID3D12CommandList* const* ppCommandLists) override;
+
+    void STDMETHODCALLTYPE SetMarker(UINT Metadata, const void* pData, UINT Size) override
+    {
+        UNREFERENCED_PARAMETER(Metadata);
+        UNREFERENCED_PARAMETER(pData);
+        UNREFERENCED_PARAMETER(Size);
+    }
+
+    void STDMETHODCALLTYPE BeginEvent(UINT Metadata, const void* pData, UINT Size) override
+    {
+        UNREFERENCED_PARAMETER(Metadata);
+        UNREFERENCED_PARAMETER(pData);
+        UNREFERENCED_PARAMETER(Size);
+    }
+
+    void STDMETHODCALLTYPE EndEvent() override
+    {
+    }
+
+    HRESULT STDMETHODCALLTYPE Signal(ID3D12Fence* pFence, UINT64 Value) override
+    {
+        UNREFERENCED_PARAMETER(pFence);
+        UNREFERENCED_PARAMETER(Value);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE Wait(ID3D12Fence* pFence, UINT64 Value) override
+    {
+        UNREFERENCED_PARAMETER(pFence);
+        UNREFERENCED_PARAMETER(Value);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetTimestampFrequency(UINT64* pFrequency) override
+    {
+        UNREFERENCED_PARAMETER(pFrequency);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetClockCalibration(UINT64* pGpuTimestamp, UINT64* pCpuTimestamp) override
+    {
+        UNREFERENCED_PARAMETER(pGpuTimestamp);
+        UNREFERENCED_PARAMETER(pCpuTimestamp);
+        return E_NOTIMPL;
+    }
+
+    D3D12_COMMAND_QUEUE_DESC STDMETHODCALLTYPE GetDesc() override
+    {
+        return mDesc;
+    }
+
+private:
+    D3D12_COMMAND_QUEUE_DESC mDesc;
+    std::vector<std::string> mExecutedCommandLists;
+};
+
+// A device with NodeCount linked nodes. It only creates the copy queues and fences that
+// CD3DX12AffinityDevice makes for itself; the tests create every other object directly.
+class MockDevice : public MockObject<ID3D12Device>
+{
+public:
+    explicit MockDevice(UINT NodeCount) : MockObject<ID3D12Device>("Device"), mNodeCount(NodeCount) {}
+
+    UINT STDMETHODCALLTYPE GetNodeCount() override
+    {
+        return mNodeCount;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateCommandQueue(const D3D12_COMMAND_QUEUE_DESC* pDesc, REFIID riid, void** ppCommandQueue) override
+    {
+        UNREFERENCED_PARAMETER(riid);
+        *ppCommandQueue = static_cast<ID3D12CommandQueue*>(new MockCommandQueue("CommandQueue", *pDesc));
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateFence(UINT64 InitialValue, D3D12_FENCE_FLAGS Flags, REFIID riid, void** ppFence) override
+    {
+        UNREFERENCED_PARAMETER(InitialValue);
+        UNREFERENCED_PARAMETER(Flags);
+        UNREFERENCED_PARAMETER(riid);
+        *ppFence = static_cast<ID3D12Fence*>(new MockFence("Fence"));
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE type, REFIID riid, void** ppCommandAllocator) override
+    {
+        UNREFERENCED_PARAMETER(type);
+        UNREFERENCED_PARAMETER(riid);
+        *ppCommandAllocator = nullptr;
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC* pDesc, REFIID riid, void** ppPipelineState) override
+    {
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(riid);
+        *ppPipelineState = nullptr;
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC* pDesc, REFIID riid, void** ppPipelineState) override
+    {
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(riid);
+        *ppPipelineState = nullptr;
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateCommandList(UINT nodeMask, D3D12_COMMAND_LIST_TYPE type, ID3D12CommandAllocator* pCommandAllocator, ID3D12PipelineState* pInitialState, REFIID riid, void** ppCommandList) override
+    {
+        UNREFERENCED_PARAMETER(nodeMask);
+        UNREFERENCED_PARAMETER(type);
+        UNREFERENCED_PARAMETER(pCommandAllocator);
+        UNREFERENCED_PARAMETER(pInitialState);
+        UNREFERENCED_PARAMETER(riid);
+        *ppCommandList = nullptr;
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE CheckFeatureSupport(D3D12_FEATURE Feature, void* pFeatureSupportData, UINT FeatureSupportDataSize) override
+    {
+        UNREFERENCED_PARAMETER(Feature);
+        UNREFERENCED_PARAMETER(pFeatureSupportData);
+        UNREFERENCED_PARAMETER(FeatureSupportDataSize);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC* pDescriptorHeapDesc, REFIID riid, void** ppvHeap) override
+    {
+        UNREFERENCED_PARAMETER(pDescriptorHeapDesc);
+        UNREFERENCED_PARAMETER(riid);
+        *ppvHeap = nullptr;
+        return E_NOTIMPL;
+    }
+
+    UINT STDMETHODCALLTYPE GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE DescriptorHeapType) override
+    {
+        UNREFERENCED_PARAMETER(DescriptorHeapType);
+        return 32;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateRootSignature(UINT nodeMask, const void* pBlobWithRootSignature, SIZE_T blobLengthInBytes, REFIID riid, void** ppvRootSignature) override
+    {
+        UNREFERENCED_PARAMETER(nodeMask);
+        UNREFERENCED_PARAMETER(pBlobWithRootSignature);
+        UNREFERENCED_PARAMETER(blobLengthInBytes);
+        UNREFERENCED_PARAMETER(riid);
+        *ppvRootSignature = nullptr;
+        return E_NOTIMPL;
+    }
+
+    void STDMETHODCALLTYPE CreateConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC* pDesc, D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override
+    {
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(DestDescriptor);
+    }
+
+    void STDMETHODCALLTYPE CreateShaderResourceView(ID3D12Resource* pResource, const D3D12_SHADER_RESOURCE_VIEW_DESC* pDesc, D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override
+    {
+        UNREFERENCED_PARAMETER(pResource);
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(DestDescriptor);
+    }
+
+    void STDMETHODCALLTYPE CreateUnorderedAccessView(ID3D12Resource* pResource, ID3D12Resource* pCounterResource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* pDesc, D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override
+    {
+        UNREFERENCED_PARAMETER(pResource);
+        UNREFERENCED_PARAMETER(pCounterResource);
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(DestDescriptor);
+    }
+
+    void STDMETHODCALLTYPE CreateRenderTargetView(ID3D12Resource* pResource, const D3D12_RENDER_TARGET_VIEW_DESC* pDesc, D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override
+    {
+        UNREFERENCED_PARAMETER(pResource);
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(DestDescriptor);
+    }
+
+    void STDMETHODCALLTYPE CreateDepthStencilView(ID3D12Resource* pResource, const D3D12_DEPTH_STENCIL_VIEW_DESC* pDesc, D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override
+    {
+        UNREFERENCED_PARAMETER(pResource);
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(DestDescriptor);
+    }
+
+    void STDMETHODCALLTYPE CreateSampler(const D3D12_SAMPLER_DESC* pDesc, D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override
+    {
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(DestDescriptor);
+    }
+
+    void STDMETHODCALLTYPE CopyDescriptors(UINT NumDestDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* pDestDescriptorRangeStarts, const UINT* pDestDescriptorRangeSizes, UINT NumSrcDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* pSrcDescriptorRangeStarts, const UINT* pSrcDescriptorRangeSizes, D3D12_DESCRIPTOR_HEAP_TYPE DescriptorHeapsType) override
+    {
+        UNREFERENCED_PARAMETER(NumDestDescriptorRanges);
+        UNREFERENCED_PARAMETER(pDestDescriptorRangeStarts);
+        UNREFERENCED_PARAMETER(pDestDescriptorRangeSizes);
+        UNREFERENCED_PARAMETER(NumSrcDescriptorRanges);
+        UNREFERENCED_PARAMETER(pSrcDescriptorRangeStarts);
+        UNREFERENCED_PARAMETER(pSrcDescriptorRangeSizes);
+        UNREFERENCED_PARAMETER(DescriptorHeapsType);
+    }
+
+    void STDMETHODCALLTYPE CopyDescriptorsSimple(UINT NumDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptorRangeStart, D3D12_CPU_DESCRIPTOR_HANDLE SrcDescriptorRangeStart, D3D12_DESCRIPTOR_HEAP_TYPE DescriptorHeapsType) override
+    {
+        UNREFERENCED_PARAMETER(NumDescriptors);
+        UNREFERENCED_PARAMETER(DestDescriptorRangeStart);
+        UNREFERENCED_PARAMETER(SrcDescriptorRangeStart);
+        UNREFERENCED_PARAMETER(DescriptorHeapsType);
+    }
+
+    D3D12_RESOURCE_ALLOCATION_INFO STDMETHODCALLTYPE GetResourceAllocationInfo(UINT visibleMask, UINT numResourceDescs, const D3D12_RESOURCE_DESC* pResourceDescs) override
+    {
+        UNREFERENCED_PARAMETER(visibleMask);
+        UNREFERENCED_PARAMETER(numResourceDescs);
+        UNREFERENCED_PARAMETER(pResourceDescs);
+        D3D12_RESOURCE_ALLOCATION_INFO Info = {};
+        return Info;
+    }
+
+    D3D12_HEAP_PROPERTIES STDMETHODCALLTYPE GetCustomHeapProperties(UINT nodeMask, D3D12_HEAP_TYPE heapType) override
+    {
+        UNREFERENCED_PARAMETER(nodeMask);
+        UNREFERENCED_PARAMETER(heapType);
+        D3D12_HEAP_PROPERTIES Properties = {};
+        return Properties;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateCommittedResource(const D3D12_HEAP_PROPERTIES* pHeapProperties, D3D12_HEAP_FLAGS HeapFlags, const D3D12_RESOURCE_DESC* pDesc, D3D12_RESOURCE_STATES InitialResourceState, const D3D12_CLEAR_VALUE* pOptimizedClearValue, REFIID riidResource, void** ppvResource) override
+    {
+        UNREFERENCED_PARAMETER(pHeapProperties);
+        UNREFERENCED_PARAMETER(HeapFlags);
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(InitialResourceState);
+        UNREFERENCED_PARAMETER(pOptimizedClearValue);
+        UNREFERENCED_PARAMETER(riidResource);
+        *ppvResource = nullptr;
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateHeap(const D3D12_HEAP_DESC* pDesc, REFIID riid, void** ppvHeap) override
+    {
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(riid);
+        *ppvHeap = nullptr;
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreatePlacedResource(ID3D12Heap* pHeap, UINT64 HeapOffset, const D3D12_RESOURCE_DESC* pDesc, D3D12_RESOURCE_STATES InitialState, const D3D12_CLEAR_VALUE* pOptimizedClearValue, REFIID riid, void** ppvResource) override
+    {
+        UNREFERENCED_PARAMETER(pHeap);
+        UNREFERENCED_PARAMETER(HeapOffset);
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(InitialState);
+        UNREFERENCED_PARAMETER(pOptimizedClearValue);
+        UNREFERENCED_PARAMETER(riid);
+        *ppvResource = nullptr;
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateReservedResource(const D3D12_RESOURCE_DESC* pDesc, D3D12_RESOURCE_STATES InitialState, const D3D12_CLEAR_VALUE* pOptimizedClearValue, REFIID riid, void** ppvResource) override
+    {
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(InitialState);
+        UNREFERENCED_PARAMETER(pOptimizedClearValue);
+        UNREFERENCED_PARAMETER(riid);
+        *ppvResource = nullptr;
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateSharedHandle(ID3D12DeviceChild* pObject, const SECURITY_ATTRIBUTES* pAttributes, DWORD Access, LPCWSTR Name, HANDLE* pHandle) override
+    {
+        UNREFERENCED_PARAMETER(pObject);
+        UNREFERENCED_PARAMETER(pAttributes);
+        UNREFERENCED_PARAMETER(Access);
+        UNREFERENCED_PARAMETER(Name);
+        UNREFERENCED_PARAMETER(pHandle);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE OpenSharedHandle(HANDLE NTHandle, REFIID riid, void** ppvObj) override
+    {
+        UNREFERENCED_PARAMETER(NTHandle);
+        UNREFERENCED_PARAMETER(riid);
+        *ppvObj = nullptr;
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE OpenSharedHandleByName(LPCWSTR Name, DWORD Access, HANDLE* pNTHandle) override
+    {
+        UNREFERENCED_PARAMETER(Name);
+        UNREFERENCED_PARAMETER(Access);
+        UNREFERENCED_PARAMETER(pNTHandle);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE MakeResident(UINT NumObjects, ID3D12Pageable* const* ppObjects) override
+    {
+        UNREFERENCED_PARAMETER(NumObjects);
+        UNREFERENCED_PARAMETER(ppObjects);
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE Evict(UINT NumObjects, ID3D12Pageable* const* ppObjects) override
+    {
+        UNREFERENCED_PARAMETER(NumObjects);
+        UNREFERENCED_PARAMETER(ppObjects);
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetDeviceRemovedReason() override
+    {
+        return S_OK;
+    }
+
+    void STDMETHODCALLTYPE GetCopyableFootprints(const D3D12_RESOURCE_DESC* pResourceDesc, UINT FirstSubresource, UINT NumSubresources, UINT64 BaseOffset, D3D12_PLACED_SUBRESOURCE_FOOTPRINT* pLayouts, UINT* pNumRows, UINT64* pRowSizeInBytes, UINT64* pTotalBytes) override
+    {
+        UNREFERENCED_PARAMETER(pResourceDesc);
+        UNREFERENCED_PARAMETER(FirstSubresource);
+        UNREFERENCED_PARAMETER(NumSubresources);
+        UNREFERENCED_PARAMETER(BaseOffset);
+        UNREFERENCED_PARAMETER(pLayouts);
+        UNREFERENCED_PARAMETER(pNumRows);
+        UNREFERENCED_PARAMETER(pRowSizeInBytes);
+        UNREFERENCED_PARAMETER(pTotalBytes);
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateQueryHeap(const D3D12_QUERY_HEAP_DESC* pDesc, REFIID riid, void** ppvHeap) override
+    {
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(riid);
+        *ppvHeap = nullptr;
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetStablePowerState(BOOL Enable) override
+    {
+        UNREFERENCED_PARAMETER(Enable);
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE CreateCommandSignature(const D3D12_COMMAND_SIGNATURE_DESC* pDesc, ID3D12RootSignature* pRootSignature, REFIID riid, void** ppvCommandSignature) override
+    {
+        UNREFERENCED_PARAMETER(pDesc);
+        UNREFERENCED_PARAMETER(pRootSignature);
+        UNREFERENCED_PARAMETER(riid);
+        *ppvCommandSignature = nullptr;
+        return E_NOTIMPL;
+    }
+
+    void STDMETHODCALLTYPE GetResourceTiling(ID3D12Resource* pTiledResource, UINT* pNumTilesForEntireResource, D3D12_PACKED_MIP_INFO* pPackedMipDesc, D3D12_TILE_SHAPE* pStandardTileShapeForNonPackedMips, UINT* pNumSubresourceTilings, UINT FirstSubresourceTilingToGet, D3D12_SUBRESOURCE_TILING* pSubresourceTilingsForNonPackedMips) override
+    {
+        UNREFERENCED_PARAMETER(pTiledResource);
+        UNREFERENCED_PARAMETER(pNumTilesForEntireResource);
+        UNREFERENCED_PARAMETER(pPackedMipDesc);
+        UNREFERENCED_PARAMETER(pStandardTileShapeForNonPackedMips);
+        UNREFERENCED_PARAMETER(pNumSubresourceTilings);
+        UNREFERENCED_PARAMETER(FirstSubresourceTilingToGet);
+        UNREFERENCED_PARAMETER(pSubresourceTilingsForNonPackedMips);
+    }
+
+    LUID STDMETHODCALLTYPE GetAdapterLuid() override
+    {
+        LUID Luid = {};
+        return Luid;
+    }
+
+private:
+    UINT mNodeCount;
+};
+
+// A descriptor handle as the affinity layer hands them out: the address of one value per node.
+struct MockDescriptor
+{
+    UINT64 NodeHandles[D3DX12_MAX_ACTIVE_NODES];
+
+    D3D12_CPU_DESCRIPTOR_HANDLE Cpu() const
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE Handle;
+        Handle.ptr = reinterpret_cast<SIZE_T>(NodeHandles);
+        return Handle;
+    }
+
+    D3D12_GPU_DESCRIPTOR_HANDLE Gpu() const
+    {
+        D3D12_GPU_DESCRIPTOR_HANDLE Handle;
+        Handle.ptr = reinterpret_cast<UINT64>(NodeHandles);
+        return Handle;
+    }
+};
+
+// Formats one log line.
+inline std::string Format(const char* format, ...)
+{
+    char Buffer[512];
+    va_list Args;
+    va_start(Args, format);
+    vsnprintf(Buffer, sizeof(Buffer), format, Args);
+    va_end(Args);
+    return Buffer;
+}
+
+inline std::string FormatRects(UINT NumRects, const D3D12_RECT* pRects)
+{
+    if (!pRects)
+    {
+        return " rects null";
+    }
+    std::string Text = Format(" rects %u", NumRects);
+    for (UINT r = 0; r < NumRects; ++r)
+    {
+        Text += Format(" (%d %d %d %d)", pRects[r].left, pRects[r].top, pRects[r].right, pRects[r].bottom);
+    }
+    return Text;
+}
+
+inline std::string FormatBytes(const void* pData, UINT Size)
+{
+    if (!pData)
+    {
+        return " data null";
+    }
+    std::string Text = " data";
+    for (UINT b = 0; b < Size; ++b)
+    {
+        Text += Format(" %02x", static_cast<BYTE const*>(pData)[b]);
+    }
+    return Text;
+}
+
+inline std::string FormatCopyLocation(const D3D12_TEXTURE_COPY_LOCATION* pLocation)
+{
+    if (pLocation->Type == D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX)
+    {
+        return Format(" %s subresource %u", NameOf(pLocation->pResource).c_str(), pLocation->SubresourceIndex);
+    }
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT const& Footprint = pLocation->PlacedFootprint;
+    return Format(" %s footprint %llu %d %u %u %u %u", NameOf(pLocation->pResource).c_str(), Footprint.Offset, Footprint.Footprint.Format,
+        Footprint.Footprint.Width, Footprint.Footprint.Height, Footprint.Footprint.Depth, Footprint.Footprint.RowPitch);
+}
+
+// Logs every call as a line of text, or counts the calls if it has no log. Each call can be
+// made to take a fixed time, standing in for the time a driver takes to record it.
+class MockGraphicsCommandList : public MockDeviceChild<ID3D12GraphicsCommandList>
+{
+public:
+    MockGraphicsCommandList(std::string const& Name, std::vector<std::string>* Log)
+        : MockDeviceChild<ID3D12GraphicsCommandList>(Name)
+        , mLog(Log)
+        , mCallCount(0)
+        , mCallTime(0)
+        , mClosed(false)
+        , mCloseResult(S_OK)
+    {
+    }
+
+    UINT64 GetCallCount() const { return mCallCount; }
+
+    bool IsClosed() const { return mClosed; }
+
+    void SetCallTime(std::chrono::nanoseconds CallTime) { mCallTime = CallTime; }
+
+    // What Close() returns. The command list stays open when it isn't S_OK.
+    void SetCloseResult(HRESULT CloseResult) { mCloseResult = CloseResult; }
+
+    // ID3D12CommandList
+    D3D12_COMMAND_LIST_TYPE STDMETHODCALLTYPE GetType() override
+    {
+        return D3D12_COMMAND_LIST_TYPE_DIRECT;
+    }
+
+    // ID3D12GraphicsCommandList
+    HRESULT STDMETHODCALLTYPE Close() override
+    {
+        Log([&] { return "Close"; });
+        mClosed = (S_OK == mCloseResult);
+        return mCloseResult;
+    }
+
+    HRESULT STDMETHODCALLTYPE Reset(ID3D12CommandAllocator* pAllocator, ID3D12PipelineState* pInitialState) override
+    {
+        Log([&] { return Format("Reset %s %s", NameOf(pAllocator).c_str(), NameOf(pInitialState).c_str()); });
+        mClosed = false;
+        return S_OK;
+    }
+
+    void STDMETHODCALLTYPE ClearState(ID3D12PipelineState* pPipelineState) override
+    {
+        Log([&] { return Format("ClearState %s", NameOf(pPipelineState).c_str()); });
+    }
+
+    void STDMETHODCALLTYPE DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation) override
+    {
+        Log([&] { return Format("DrawInstanced %u %u %u %u", VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation); });
+    }
+
+    void STDMETHODCALLTYPE DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation) override
+    {
+        Log([&] { return Format("DrawIndexedInstanced %u %u %u %d %u", IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation); });
+    }
+
+    void STDMETHODCALLTYPE Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ) override
+    {
+        Log([&] { return Format("Dispatch %u %u %u", ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ); });
+    }
+
+    void STDMETHODCALLTYPE CopyBufferRegion(ID3D12Resource* pDstBuffer, UINT64 DstOffset, ID3D12Resource* pSrcBuffer, UINT64 SrcOffset, UINT64 NumBytes) override
+    {
+        Log([&] { return Format("CopyBufferRegion %s %llu %s %llu %llu", NameOf(pDstBuffer).c_str(), DstOffset, NameOf(pSrcBuffer).c_str(), SrcOffset, NumBytes); });
+    }
+
+    void STDMETHODCALLTYPE CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* pDst, UINT DstX, UINT DstY, UINT DstZ, const D3D12_TEXTURE_COPY_LOCATION* pSrc, const D3D12_BOX* pSrcBox) override
+    {
+        Log([&]
+        {
+            std::string Text = "CopyTextureRegion" + FormatCopyLocation(pDst) + Format(" %u %u %u", DstX, DstY, DstZ) + FormatCopyLocation(pSrc);
+            Text += pSrcBox ? Format(" box %u %u %u %u %u %u", pSrcBox->left, pSrcBox->top, pSrcBox->front, pSrcBox->right, pSrcBox->bottom, pSrcBox->back) : " box null";
+            return Text;
+        });
+    }
+
+    void STDMETHODCALLTYPE CopyResource(ID3D12Resource* pDstResource, ID3D12Resource* pSrcResource) override
+    {
+        Log([&] { return Format("CopyResource %s %s", NameOf(pDstResource).c_str(), NameOf(pSrcResource).c_str()); });
+    }
+
+    void STDMETHODCALLTYPE CopyTiles(ID3D12Resource* pTiledResource, const D3D12_TILED_RESOURCE_COORDINATE* pTileRegionStartCoordinate, const D3D12_TILE_REGION_SIZE* pTileRegionSize, ID3D12Resource* pBuffer, UINT64 BufferStartOffsetInBytes, D3D12_TILE_COPY_FLAGS Flags) override
+    {
+        Log([&] { return Format("CopyTiles %s (%u %u %u %u) (%u %d %u %u %u) %s %llu %d", NameOf(pTiledResource).c_str(),
+            pTileRegionStartCoordinate->X, pTileRegionStartCoordinate->Y, pTileRegionStartCoordinate->Z, pTileRegionStartCoordinate->Subresource,
+            pTileRegionSize->NumTiles, pTileRegionSize->UseBox, pTileRegionSize->Width, pTileRegionSize->Height, pTileRegionSize->Depth,
+            NameOf(pBuffer).c_str(), BufferStartOffsetInBytes, Flags); });
+    }
+
+    void STDMETHODCALLTYPE ResolveSubresource(ID3D12Resource* pDstResource, UINT DstSubresource, ID3D12Resource* pSrcResource, UINT SrcSubresource, DXGI_FORMAT Format_) override
+    {
+        Log([&] { return Format("ResolveSubresource %s %u %s %u %d", NameOf(pDstResource).c_str(), DstSubresource, NameOf(pSrcResource).c_str(), SrcSubresource, Format_); });
+    }
+
+    void STDMETHODCALLTYPE IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY PrimitiveTopology) override
+    {
+        Log([&] { return Format("IASetPrimitiveTopology %d", PrimitiveTopology); });
+    }
+
+    void STDMETHODCALLTYPE RSSetViewports(UINT NumViewports, const D3D12_VIEWPORT* pViewports) override
+    {
+        Log([&]
+        {
+            std::string Text = Format("RSSetViewports %u", NumViewports);
+            for (UINT v = 0; v < NumViewports; ++v)
+            {
+                D3D12_VIEWPORT const& Viewport = pViewports[v];
+                Text += Format(" (%g %g %g %g %g %g)", Viewport.TopLeftX, Viewport.TopLeftY, Viewport.Width, Viewport.Height, Viewport.MinDepth, Viewport.MaxDepth);
+            }
+            return Text;
+        });
+    }
+
+    void STDMETHODCALLTYPE RSSetScissorRects(UINT NumRects, const D3D12_RECT* pRects) override
+    {
+        Log([&] { return "RSSetScissorRects" + FormatRects(NumRects, pRects); });
+    }
+
+    void STDMETHODCALLTYPE OMSetBlendFactor(const FLOAT BlendFactor[4]) override
+    {
+        Log([&] { return BlendFactor ? Format("OMSetBlendFactor %g %g %g %g", BlendFactor[0], BlendFactor[1], BlendFactor[2], BlendFactor[3]) : "OMSetBlendFactor null"; });
+    }
+
+    void STDMETHODCALLTYPE OMSetStencilRef(UINT StencilRef) override
+    {
+        Log([&] { return Format("OMSetStencilRef %u", StencilRef); });
+    }
+
+    void STDMETHODCALLTYPE SetPipelineState(ID3D12PipelineState* pPipelineState) override
+    {
+        Log([&] { return Format("SetPipelineState %s", NameOf(pPipelineState).c_str()); });
+    }
+
+    void STDMETHODCALLTYPE ResourceBarrier(UINT NumBarriers, const D3D12_RESOURCE_BARRIER* pBarriers) override
+    {
+        Log([&]
+        {
+            std::string Text = Format("ResourceBarrier %u", NumBarriers);
+            for (UINT b = 0; b < NumBarriers; ++b)
+            {
+                D3D12_RESOURCE_BARRIER const& Barrier = pBarriers[b];
+                switch (Barrier.Type)
+                {
+                case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+                    Text += Format(" (transition %d %s %u %d %d)", Barrier.Flags, NameOf(Barrier.Transition.pResource).c_str(),
+                        Barrier.Transition.Subresource, Barrier.Transition.StateBefore, Barrier.Transition.StateAfter);
+                    break;
+                case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+                    Text += Format(" (aliasing %d %s %s)", Barrier.Flags, NameOf(Barrier.Aliasing.pResourceBefore).c_str(), NameOf(Barrier.Aliasing.pResourceAfter).c_str());
+                    break;
+                case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+                    Text += Format(" (uav %d %s)", Barrier.Flags, NameOf(Barrier.UAV.pResource).c_str());
+                    break;
+                }
+            }
+            return Text;
+        });
+    }
+
+    void STDMETHODCALLTYPE ExecuteBundle(ID3D12GraphicsCommandList* pCommandList) override
+    {
+        Log([&] { return Format("ExecuteBundle %s", NameOf(pCommandList).c_str()); });
+    }
+
+    void STDMETHODCALLTYPE SetDescriptorHeaps(UINT NumDescriptorHeaps, ID3D12DescriptorHeap* const* ppDescriptorHeaps) override
+    {
+        Log([&]
+        {
+            std::string Text = Format("SetDescriptorHeaps %u", NumDescriptorHeaps);
+            for (UINT h = 0; h < NumDescriptorHeaps; ++h)
+            {
+                Text += " " + NameOf(ppDescriptorHeaps[h]);
+            }
+            return Text;
+        });
+    }
+
+    void STDMETHODCALLTYPE SetComputeRootSignature(ID3D12RootSignature* pRootSignature) override
+    {
+        Log([&] { return Format("SetComputeRootSignature %s", NameOf(pRootSignature).c_str()); });
+    }
+
+    void STDMETHODCALLTYPE SetGraphicsRootSignature(ID3D12RootSignature* pRootSignature) override
+    {
+        Log([&] { return Format("SetGraphicsRootSignature %s", NameOf(pRootSignature).c_str()); });
+    }
+
+    void STDMETHODCALLTYPE SetComputeRootDescriptorTable(UINT RootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor) override
+    {
+        Log([&] { return Format("SetComputeRootDescriptorTable %u %llx", RootParameterIndex, BaseDescriptor.ptr); });
+    }
+
+    void STDMETHODCALLTYPE SetGraphicsRootDescriptorTable(UINT RootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor) override
+    {
+        Log([&] { return Format("SetGraphicsRootDescriptorTable %u %llx", RootParameterIndex, BaseDescriptor.ptr); });
+    }
+
+    void STDMETHODCALLTYPE SetComputeRoot32BitConstant(UINT RootParameterIndex, UINT SrcData, UINT DestOffsetIn32BitValues) override
+    {
+        Log([&] { return Format("SetComputeRoot32BitConstant %u %u %u", RootParameterIndex, SrcData, DestOffsetIn32BitValues); });
+    }
+
+    void STDMETHODCALLTYPE SetGraphicsRoot32BitConstant(UINT RootParameterIndex, UINT SrcData, UINT DestOffsetIn32BitValues) override
+    {
+        Log([&] { return Format("SetGraphicsRoot32BitConstant %u %u %u", RootParameterIndex, SrcData, DestOffsetIn32BitValues); });
+    }
+
+    void STDMETHODCALLTYPE SetComputeRoot32BitConstants(UINT RootParameterIndex, UINT Num32BitValuesToSet, const void* pSrcData, UINT DestOffsetIn32BitValues) override
+    {
+        Log([&] { return Format("SetComputeRoot32BitConstants %u %u", RootParameterIndex, DestOffsetIn32BitValues) + FormatBytes(pSrcData, Num32BitValuesToSet * 4); });
+    }
+
+    void STDMETHODCALLTYPE SetGraphicsRoot32BitConstants(UINT RootParameterIndex, UINT Num32BitValuesToSet, const void* pSrcData, UINT DestOffsetIn32BitValues) override
+    {
+        Log([&] { return Format("SetGraphicsRoot32BitConstants %u %u", RootParameterIndex, DestOffsetIn32BitValues) + FormatBytes(pSrcData, Num32BitValuesToSet * 4); });
+    }
+
+    void STDMETHODCALLTYPE SetComputeRootConstantBufferView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) override
+    {
+        Log([&] { return Format("SetComputeRootConstantBufferView %u %llx", RootParameterIndex, BufferLocation); });
+    }
+
+    void STDMETHODCALLTYPE SetGraphicsRootConstantBufferView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) override
+    {
+        Log([&] { return Format("SetGraphicsRootConstantBufferView %u %llx", RootParameterIndex, BufferLocation); });
+    }
+
+    void STDMETHODCALLTYPE SetComputeRootShaderResourceView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) override
+    {
+        Log([&] { return Format("SetComputeRootShaderResourceView %u %llx", RootParameterIndex, BufferLocation); });
+    }
+
+    void STDMETHODCALLTYPE SetGraphicsRootShaderResourceView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) override
+    {
+        Log([&] { return Format("SetGraphicsRootShaderResourceView %u %llx", RootParameterIndex, BufferLocation); });
+    }
+
+    void STDMETHODCALLTYPE SetComputeRootUnorderedAccessView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) override
+    {
+        Log([&] { return Format("SetComputeRootUnorderedAccessView %u %llx", RootParameterIndex, BufferLocation); });
+    }
+
+    void STDMETHODCALLTYPE SetGraphicsRootUnorderedAccessView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) override
+    {
+        Log([&] { return Format("SetGraphicsRootUnorderedAccessView %u %llx", RootParameterIndex, BufferLocation); });
+    }
+
+    void STDMETHODCALLTYPE IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* pView) override
+    {
+        Log([&] { return pView ? Format("IASetIndexBuffer %llx %u %d", pView->BufferLocation, pView->SizeInBytes, pView->Format) : "IASetIndexBuffer null"; });
+    }
+
+    void STDMETHODCALLTYPE IASetVertexBuffers(UINT StartSlot, UINT NumViews, const D3D12_VERTEX_BUFFER_VIEW* pViews) override
+    {
+        Log([&]
+        {
+            std::string Text = Format("IASetVertexBuffers %u %u", StartSlot, NumViews);
+            for (UINT v = 0; pViews && v < NumViews; ++v)
+            {
+                Text += Format(" (%llx %u %u)", pViews[v].BufferLocation, pViews[v].SizeInBytes, pViews[v].StrideInBytes);
+            }
+            return pViews ? Text : Text + " null";
+        });
+    }
+
+    void STDMETHODCALLTYPE SOSetTargets(UINT StartSlot, UINT NumViews, const D3D12_STREAM_OUTPUT_BUFFER_VIEW* pViews) override
+    {
+        Log([&]
+        {
+            std::string Text = Format("SOSetTargets %u %u", StartSlot, NumViews);
+            for (UINT v = 0; pViews && v < NumViews; ++v)
+            {
+                Text += Format(" (%llx %llu %llx)", pViews[v].BufferLocation, pViews[v].SizeInBytes, pViews[v].BufferFilledSizeLocation);
+            }
+            return pViews ? Text : Text + " null";
+        });
+    }
+
+    void STDMETHODCALLTYPE OMSetRenderTargets(UINT NumRenderTargetDescriptors, const D3D12_CPU_DESCRIPTOR_HANDLE* pRenderTargetDescriptors, BOOL RTsSingleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* pDepthStencilDescriptor) override
+    {
+        Log([&]
+        {
+            // A single handle describes the whole range, the other handles are not read.
+            UINT const NumHandles = (RTsSingleHandleToDescriptorRange && NumRenderTargetDescriptors > 0) ? 1 : NumRenderTargetDescriptors;
+            std::string Text = Format("OMSetRenderTargets %u %d", NumRenderTargetDescriptors, RTsSingleHandleToDescriptorRange);
+            for (UINT r = 0; r < NumHandles; ++r)
+            {
+                Text += Format(" %llx", static_cast<UINT64>(pRenderTargetDescriptors[r].ptr));
+            }
+            Text += pDepthStencilDescriptor ? Format(" depth %llx", static_cast<UINT64>(pDepthStencilDescriptor->ptr)) : " depth null";
+            return Text;
+        });
+    }
+
+    void STDMETHODCALLTYPE ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView, D3D12_CLEAR_FLAGS ClearFlags, FLOAT Depth, UINT8 Stencil, UINT NumRects, const D3D12_RECT* pRects) override
+    {
+        Log([&] { return Format("ClearDepthStencilView %llx %d %g %u", static_cast<UINT64>(DepthStencilView.ptr), ClearFlags, Depth, Stencil) + FormatRects(NumRects, pRects); });
+    }
+
+    void STDMETHODCALLTYPE ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE RenderTargetView, const FLOAT ColorRGBA[4], UINT NumRects, const D3D12_RECT* pRects) override
+    {
+        Log([&] { return Format("ClearRenderTargetView %llx %g %g %g %g", static_cast<UINT64>(RenderTargetView.ptr), ColorRGBA[0], ColorRGBA[1], ColorRGBA[2], ColorRGBA[3]) + FormatRects(NumRects, pRects); });
+    }
+
+    void STDMETHODCALLTYPE ClearUnorderedAccessViewUint(D3D12_GPU_DESCRIPTOR_HANDLE ViewGPUHandleInCurrentHeap, D3D12_CPU_DESCRIPTOR_HANDLE ViewCPUHandle, ID3D12Resource* pResource, const UINT Values[4], UINT NumRects, const D3D12_RECT* pRects) override
+    {
+        Log([&] { return Format("ClearUnorderedAccessViewUint %llx %llx %s %u %u %u %u", ViewGPUHandleInCurrentHeap.ptr, static_cast<UINT64>(ViewCPUHandle.ptr), NameOf(pResource).c_str(),
+            Values[0], Values[1], Values[2], Values[3]) + FormatRects(NumRects, pRects); });
+    }
+
+    void STDMETHODCALLTYPE ClearUnorderedAccessViewFloat(D3D12_GPU_DESCRIPTOR_HANDLE ViewGPUHandleInCurrentHeap, D3D12_CPU_DESCRIPTOR_HANDLE ViewCPUHandle, ID3D12Resource* pResource, const FLOAT Values[4], UINT NumRects, const D3D12_RECT* pRects) override
+    {
+        Log([&] { return Format("ClearUnorderedAccessViewFloat %llx %llx %s %g %g %g %g", ViewGPUHandleInCurrentHeap.ptr, static_cast<UINT64>(ViewCPUHandle.ptr), NameOf(pResource).c_str(),
+            Values[0], Values[1], Values[2], Values[3]) + FormatRects(NumRects, pRects); });
+    }
+
+    void STDMETHODCALLTYPE DiscardResource(ID3D12Resource* pResource, const D3D12_DISCARD_REGION* pRegion) override
+    {
+        Log([&]
+        {
+            std::string Text = Format("DiscardResource %s", NameOf(pResource).c_str());
+            Text += pRegion ? Format(" region %u %u", pRegion->FirstSubresource, pRegion->NumSubresources) + FormatRects(pRegion->NumRects, pRegion->pRects) : " region null";
+            return Text;
+        });
+    }
+
+    void STDMETHODCALLTYPE BeginQuery(ID3D12QueryHeap* pQueryHeap, D3D12_QUERY_TYPE Type, UINT Index) override
+    {
+        Log([&] { return Format("BeginQuery %s %d %u", NameOf(pQueryHeap).c_str(), Type, Index); });
+    }
+
+    void STDMETHODCALLTYPE EndQuery(ID3D12QueryHeap* pQueryHeap, D3D12_QUERY_TYPE Type, UINT Index) override
+    {
+        Log([&] { return Format("EndQuery %s %d %u", NameOf(pQueryHeap).c_str(), Type, Index); });
+    }
+
+    void STDMETHODCALLTYPE ResolveQueryData(ID3D12QueryHeap* pQueryHeap, D3D12_QUERY_TYPE Type, UINT StartIndex, UINT NumQueries, ID3D12Resource* pDestinationBuffer, UINT64 AlignedDestinationBufferOffset) override
+    {
+        Log([&] { return Format("ResolveQueryData %s %d %u %u %s %llu", NameOf(pQueryHeap).c_str(), Type, StartIndex, NumQueries, NameOf(pDestinationBuffer).c_str(), AlignedDestinationBufferOffset); });
+    }
+
+    void STDMETHODCALLTYPE SetPredication(ID3D12Resource* pBuffer, UINT64 AlignedBufferOffset, D3D12_PREDICATION_OP Operation) override
+    {
+        Log([&] { return Format("SetPredication %s %llu %d", NameOf(pBuffer).c_str(), AlignedBufferOffset, Operation); });
+    }
+
+    void STDMETHODCALLTYPE SetMarker(UINT Metadata, const void* pData, UINT Size) override
+    {
+        Log([&] { return Format("SetMarker %u %u", Metadata, Size) + FormatBytes(pData, Size); });
+    }
+
+    void STDMETHODCALLTYPE BeginEvent(UINT Metadata, const void* pData, UINT Size) override
+    {
+        Log([&] { return Format("BeginEvent %u %u", Metadata, Size) + FormatBytes(pData, Size); });
+    }
+
+    void STDMETHODCALLTYPE EndEvent() override
+    {
+        Log([&] { return "EndEvent"; });
+    }
+
+    void STDMETHODCALLTYPE ExecuteIndirect(ID3D12CommandSignature* pCommandSignature, UINT MaxCommandCount, ID3D12Resource* pArgumentBuffer, UINT64 ArgumentBufferOffset, ID3D12Resource* pCountBuffer, UINT64 CountBufferOffset) override
+    {
+        Log([&] { return Format("ExecuteIndirect %s %u %s %llu %s %llu", NameOf(pCommandSignature).c_str(), MaxCommandCount, NameOf(pArgumentBuffer).c_str(), ArgumentBufferOffset,
+            NameOf(pCountBuffer).c_str(), CountBufferOffset); });
+    }
+
+private:
+    // The text is only formatted when there is a log, so that the benchmarks time the layer.
+    template <typename TextFunc>
+    void Log(TextFunc Text)
+    {
+        ++mCallCount;
+        if (mCallTime.count() > 0)
+        {
+            std::chrono::steady_clock::time_point const End = std::chrono::steady_clock::now() + mCallTime;
+            while (std::chrono::steady_clock::now() < End)
+            {
+            }
+        }
+        if (mLog)
+        {
+            mLog->push_back(Text());
+        }
+    }
+
+    std::vector<std::string>* mLog;
+    UINT64 mCallCount;
+    std::chrono::nanoseconds mCallTime;
+    std::atomic<bool> mClosed;
+    HRESULT mCloseResult;
+};
+
+inline void STDMETHODCALLTYPE MockCommandQueue::ExecuteCommandLists(UINT NumCommandLists, ID3D12CommandList* const* ppCommandLists)
+{
+    for (UINT c = 0; c < NumCommandLists; ++c)
+    {
+        bool const Closed = static_cast<MockGraphicsCommandList*>(ppCommandLists[c])->IsClosed();
+        mExecutedCommandLists.push_back(NameOf(ppCommandLists[c]) + (Closed ? "" : " (open)"));
+    }
+}
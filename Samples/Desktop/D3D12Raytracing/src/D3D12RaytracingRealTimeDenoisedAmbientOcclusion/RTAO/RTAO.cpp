@@ -117,6 +117,14 @@ namespace RTAO_Args
     BoolVar Spp_doCheckerboard(L"Render/AO/RTAO/Sampling/Overrides/Do checkerboard 0.5 spp", false, OnToggleSppCheckerboard);
     BoolVar Spp_useGroundTruthSpp(L"Render/AO/RTAO/Sampling/Overrides/Do ground truth spp (no denoising): " STRINGIZE(GROUND_TRUTH_RPP), false, OnToggleSppGroundTruth);
 
+    void OnSampleGeneratorChange(void*)
+    {
+        Sample::instance().RTAOComponent().RequestRecreateAOSamples();
+    }
+
+    const WCHAR* SampleGenerators[Samplers::SampleGenerator::Count] = { L"Random", L"Multi-jittered", L"Sobol (Owen scrambled)", L"PMJ02" };
+    EnumVar Spp_SampleGenerator(L"Render/AO/RTAO/Sampling/Sample generator", Samplers::SampleGenerator::MultiJittered, Samplers::SampleGenerator::Count, SampleGenerators, OnSampleGeneratorChange);
+
     BoolVar RayGen_RandomFrameSeed(L"Render/AO/RTAO/Random per-frame seed", true);
 
     const WCHAR* FloatingPointFormatsR[TextureResourceFormatR::Count] = { L"R32_FLOAT", L"R16_FLOAT", L"R8_SNORM" };
@@ -438,12 +446,26 @@ void RTAO::CreateSamplesRNG()
 {
     UINT pixelsInSampleSet1D = RTAO_Args::Spp_AOSampleSetDistributedAcrossPixels;
     UINT samplesPerSet = RTAO_Args::Spp * pixelsInSampleSet1D * pixelsInSampleSet1D;
-    m_randomSampler.Reset(samplesPerSet, c_NumSampleSets, Samplers::HemisphereDistribution::Cosine);
 
-    UINT numSamples = m_randomSampler.NumSamples() * m_randomSampler.NumSampleSets();
+    // Recreate the sampler when a different generator is selected.
+    auto sampleGenerator = static_cast<Samplers::SampleGenerator::Enum>(static_cast<int>(RTAO_Args::Spp_SampleGenerator));
+    if (!m_randomSampler || sampleGenerator != m_sampleGenerator)
+    {
+        switch (sampleGenerator)
+        {
+        case Samplers::SampleGenerator::Random: m_randomSampler = make_unique<Samplers::Random>(); break;
+        case Samplers::SampleGenerator::MultiJittered: m_randomSampler = make_unique<Samplers::MultiJittered>(); break;
+        case Samplers::SampleGenerator::Sobol: m_randomSampler = make_unique<Samplers::Sobol>(); break;
+        case Samplers::SampleGenerator::PMJ02: m_randomSampler = make_unique<Samplers::PMJ02>(); break;
+        }
+        m_sampleGenerator = sampleGenerator;
+    }
+    m_randomSampler->Reset(samplesPerSet, c_NumSampleSets, Samplers::HemisphereDistribution::Cosine, pixelsInSampleSet1D);
+
+    UINT numSamples = m_randomSampler->NumSamples() * m_randomSampler->NumSampleSets();
     for (UINT i = 0; i < numSamples; i++)
     {
-        XMFLOAT3 p = m_randomSampler.GetHemisphereSample3D();
+        XMFLOAT3 p = m_randomSampler->GetHemisphereSample3D();
         // Convert [-1,1] to [0,1].
         m_samplesGPUBuffer[i].value = XMFLOAT2(p.x * 0.5f + 0.5f, p.y * 0.5f + 0.5f);
         m_hemisphereSamplesGPUBuffer[i].value = p;
@@ -487,8 +509,8 @@ void RTAO::UpdateConstantBuffer(UINT frameIndex)
     uniform_int_distribution<UINT> seedDistribution(0, UINT_MAX);
 
     m_CB->seed = RTAO_Args::RayGen_RandomFrameSeed ? seedDistribution(m_generatorURNG) : 1879;
-    m_CB->numSamplesPerSet = m_randomSampler.NumSamples();
-    m_CB->numSampleSets = m_randomSampler.NumSampleSets();
+    m_CB->numSamplesPerSet = m_randomSampler->NumSamples();
+    m_CB->numSampleSets = m_randomSampler->NumSampleSets();
     m_CB->numPixelsPerDimPerSet = RTAO_Args::Spp_AOSampleSetDistributedAcrossPixels;
 
     m_CB->useSortedRays = RTAO_Args::RaySorting_Enabled;
@@ -574,8 +596,8 @@ void RTAO::Run(
             activeRaytracingWidth,
             m_raytracingHeight,
             m_CB->seed,
-            m_randomSampler.NumSamples(),
-            m_randomSampler.NumSampleSets(),
+            m_randomSampler->NumSamples(),
+            m_randomSampler->NumSampleSets(),
             RTAO_Args::Spp_AOSampleSetDistributedAcrossPixels,
             doCheckerboardRayGeneration,
             m_checkerboardGenerateRaysForEvenPixels,
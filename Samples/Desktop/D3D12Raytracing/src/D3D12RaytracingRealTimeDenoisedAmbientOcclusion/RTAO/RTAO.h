@@ -36,6 +36,7 @@ namespace RTAO_Args
     extern IntVar Spp_AOSampleSetDistributedAcrossPixels;
     extern BoolVar Spp_doCheckerboard;
     extern BoolVar Spp_useGroundTruthSpp;
+    extern EnumVar Spp_SampleGenerator;
     extern BoolVar RaySorting_Enabled;
     extern NumVar MaxRayHitTime;
 }
@@ -103,7 +104,8 @@ private:
     
     ConstantBuffer<RTAOConstantBuffer> m_CB;
     UINT c_NumSampleSets = 83;
-    Samplers::MultiJittered m_randomSampler;
+    std::unique_ptr<Samplers::Sampler> m_randomSampler;
+    Samplers::SampleGenerator::Enum m_sampleGenerator;
     StructuredBuffer<AlignedUnitSquareSample2D> m_samplesGPUBuffer;
     StructuredBuffer<AlignedHemisphereSample3D> m_hemisphereSamplesGPUBuffer;
     BOOL m_isRecreateAOSamplesRequested = true;
@@ -11,11 +11,238 @@
 
 #include "stdafx.h"
 #include "Sampler.h"
+#include <atomic>
+#include <thread>
 
 using namespace std;
 using namespace DirectX;
 using namespace Samplers;
 
+namespace
+{
+    // Sample sets with fewer samples in total are generated faster than they are read from disk.
+    const UINT c_minCachedSamples = 1 << 16;
+    const UINT c_cacheFileVersion = 1;
+
+    // Calls func(i) for each i in [0, count), on all hardware threads.
+    template <typename Func>
+    void ParallelFor(UINT count, const Func& func)
+    {
+        UINT threadCount = min(max(thread::hardware_concurrency(), 1u), count);
+
+        atomic<UINT> next(0);
+        auto worker = [&]()
+        {
+            for (UINT i = next++; i < count; i = next++)
+            {
+                func(i);
+            }
+        };
+
+        vector<thread> threads;
+        for (UINT t = 1; t < threadCount; t++)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    UINT Hash(UINT x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352d;
+        x ^= x >> 15;
+        x *= 0x846ca68b;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // Seed of a sample set's generator. Sets don't depend on each other
+    // nor on the order they are generated in.
+    UINT SampleSetSeed(UINT seed, UINT sampleSet)
+    {
+        return Hash(seed ^ Hash(sampleSet + 0x9e3779b9));
+    }
+
+    UINT ReverseBits(UINT x)
+    {
+        x = (x << 16) | (x >> 16);
+        x = ((x & 0x00ff00ff) << 8) | ((x & 0xff00ff00) >> 8);
+        x = ((x & 0x0f0f0f0f) << 4) | ((x & 0xf0f0f0f0) >> 4);
+        x = ((x & 0x33333333) << 2) | ((x & 0xcccccccc) >> 2);
+        x = ((x & 0x55555555) << 1) | ((x & 0xaaaaaaaa) >> 1);
+        return x;
+    }
+
+    // Owen scrambles the bits of x, from its most significant bit down. 
+    // Each bit is flipped by a hash of the bits above it.
+    UINT NestedUniformScramble(UINT x, UINT seed)
+    {
+        x = ReverseBits(x);
+        x += seed;
+        x ^= x * 0x6c50b47c;
+        x ^= x * 0xb82f1e52;
+        x ^= x * 0xc7afe638;
+        x ^= x * 0x8d22f6e6;
+        return ReverseBits(x);
+    }
+
+    // Converts a 32 bit fixed point value to a float within [0,1).
+    float ToFloat01(UINT x)
+    {
+        return (x >> 8) * (1.f / (1 << 24));
+    }
+
+    // Index of an elementary interval of 2^log2Count samples. 
+    // Shape s has 2^s columns and 2^(log2Count - s) rows.
+    // X and Y index the finest columns and rows.
+    UINT IntervalIndex(UINT log2Count, UINT shape, UINT X, UINT Y)
+    {
+        return (shape << log2Count) + ((Y >> shape) << shape) + (X >> (log2Count - shape));
+    }
+
+    // Completes the finest column X and row Y of a new sample, known to their top xBits and yBits,
+    // such that it is in free elementary intervals of every shape. 
+    // Bits are added to X and Y in turn, each completing the interval of one more shape. 
+    // Their values are tried in random order, and a branch is left as soon as an interval is occupied.
+    bool CompleteFreeStrata(const vector<bool>& occupied, UINT log2Count, UINT& X, UINT xBits, UINT& Y, UINT yBits, mt19937& generatorURNG)
+    {
+        if (xBits == log2Count && yBits == log2Count)
+        {
+            return true;
+        }
+
+        bool isXBit = xBits <= yBits && xBits < log2Count;
+        UINT firstBit = generatorURNG() & 1;
+        for (UINT i = 0; i < 2; i++)
+        {
+            UINT bit = firstBit ^ i;
+            if (isXBit)
+            {
+                UINT newX = X | (bit << (log2Count - xBits - 1));
+                if (log2Count - (xBits + 1) <= yBits && occupied[IntervalIndex(log2Count, xBits + 1, newX, Y)])
+                    continue;
+                if (CompleteFreeStrata(occupied, log2Count, newX, xBits + 1, Y, yBits, generatorURNG))
+                {
+                    X = newX;
+                    return true;
+                }
+            }
+            else
+            {
+                UINT newY = Y | (bit << (log2Count - yBits - 1));
+                if (log2Count - (yBits + 1) <= xBits && occupied[IntervalIndex(log2Count, log2Count - (yBits + 1), X, newY)])
+                    continue;
+                if (CompleteFreeStrata(occupied, log2Count, X, xBits, newY, yBits + 1, generatorURNG))
+                {
+                    Y = newY;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+}
+
+// Generates a void-and-cluster blue noise mask.
+// The energy of a pixel is the sum of a gaussian of its toroidal distance 
+// to each pixel that is on. Tightest clusters are the pixels that are on 
+// with the highest energy, and largest voids those that are off with the lowest.
+std::vector<UINT> Samplers::GenerateBlueNoiseMask(UINT size, UINT seed)
+{
+    const UINT numPixels = size * size;
+    const float sigma = 1.5f;
+
+    // Gaussian of toroidal offsets.
+    vector<float> kernel(numPixels);
+    for (UINT y = 0; y < size; y++)
+        for (UINT x = 0; x < size; x++)
+        {
+            float dx = static_cast<float>(min(x, size - x));
+            float dy = static_cast<float>(min(y, size - y));
+            kernel[y * size + x] = expf(-(dx * dx + dy * dy) / (2 * sigma * sigma));
+        }
+
+    vector<bool> pattern(numPixels, false);
+    vector<float> energy(numPixels, 0.f);
+    auto Toggle = [&](vector<bool>& pattern, vector<float>& energy, UINT pixel)
+    {
+        pattern[pixel] = !pattern[pixel];
+        float sign = pattern[pixel] ? 1.f : -1.f;
+        UINT px = pixel % size, py = pixel / size;
+        for (UINT y = 0; y < size; y++)
+            for (UINT x = 0; x < size; x++)
+            {
+                energy[y * size + x] += sign * kernel[((y + size - py) % size) * size + (x + size - px) % size];
+            }
+    };
+    auto TightestCluster = [&](const vector<bool>& pattern, const vector<float>& energy)
+    {
+        UINT cluster = 0;
+        for (UINT i = 0; i < numPixels; i++)
+            if (pattern[i] && (!pattern[cluster] || energy[i] > energy[cluster]))
+                cluster = i;
+        return cluster;
+    };
+    auto LargestVoid = [&](const vector<bool>& pattern, const vector<float>& energy)
+    {
+        UINT largestVoid = 0;
+        for (UINT i = 0; i < numPixels; i++)
+            if (!pattern[i] && (pattern[largestVoid] || energy[i] < energy[largestVoid]))
+                largestVoid = i;
+        return largestVoid;
+    };
+
+    // Initial pattern: a tenth of the pixels turned on at random, 
+    // then spread by moving the tightest cluster to the largest void 
+    // until that leaves the pattern as is.
+    const UINT numInitialPixels = max(numPixels / 10, 1u);
+    {
+        mt19937 generatorURNG(seed);
+        vector<UINT> pixels(numPixels);
+        iota(begin(pixels), end(pixels), 0u);
+        shuffle(begin(pixels), end(pixels), generatorURNG);
+        for (UINT i = 0; i < numInitialPixels; i++)
+            Toggle(pattern, energy, pixels[i]);
+
+        for (UINT i = 0; i < numPixels; i++)
+        {
+            UINT cluster = TightestCluster(pattern, energy);
+            Toggle(pattern, energy, cluster);
+            UINT largestVoid = LargestVoid(pattern, energy);
+            Toggle(pattern, energy, largestVoid);
+            if (largestVoid == cluster)
+                break;
+        }
+    }
+
+    vector<UINT> ranks(numPixels);
+
+    // Rank the initial pixels by removing the tightest clusters first.
+    {
+        vector<bool> remainingPattern = pattern;
+        vector<float> remainingEnergy = energy;
+        for (UINT rank = numInitialPixels; rank-- > 0; )
+        {
+            UINT cluster = TightestCluster(remainingPattern, remainingEnergy);
+            Toggle(remainingPattern, remainingEnergy, cluster);
+            ranks[cluster] = rank;
+        }
+    }
+
+    // Rank the rest by filling the largest voids first.
+    // With a kernel that sums to the same energy at each pixel, the largest void 
+    // is also the tightest cluster of pixels that are off, so this fills both halves.
+    for (UINT rank = numInitialPixels; rank < numPixels; rank++)
+    {
+        UINT largestVoid = LargestVoid(pattern, energy);
+        Toggle(pattern, energy, largestVoid);
+        ranks[largestVoid] = rank;
+    }
+
+    return ranks;
+}
+
 Sampler::Sampler() : 
     m_numSamples(0), 
     m_numSampleSets(0), 
@@ -35,7 +262,8 @@ UINT Sampler::GetSampleIndex()
     if (m_index % m_numSamples == 0)
     {
         // Pick a random index jump within a set.
-        m_jump = GetRandomJump();
+        // Progressive sets are read from their start, so that their order is kept.
+        m_jump = IsProgressive() ? 0 : GetRandomJump();
         
         // Pick a random set index jump.
         m_setJump = GetRandomSetJump() * m_numSamples;
@@ -44,7 +272,7 @@ UINT Sampler::GetSampleIndex()
 }
 
 // Resets the sampler with newly randomly generated samples
-void Sampler::Reset(UINT numSamples, UINT numSampleSets, HemisphereDistribution::Enum hemisphereDistribution)
+void Sampler::Reset(UINT numSamples, UINT numSampleSets, HemisphereDistribution::Enum hemisphereDistribution, UINT numPixelsPerDimPerSet)
 {
     m_index = 0;
     m_numSamples = numSamples;
@@ -61,48 +289,117 @@ void Sampler::Reset(UINT numSamples, UINT numSampleSets, HemisphereDistribution:
         uniform_int_distribution<UINT> jumpDistribution(0, m_numSamples - 1);
         uniform_int_distribution<UINT> jumpSetDistribution(0, m_numSampleSets - 1);
 
-        uniform_real_distribution<float> unitSquareDistribution(0.f, 1.f);
-
-        // Specify the next representable value for the end range, since
-        // uniform_real_distribution constructs excluding the end value [being, end).
-        uniform_real_distribution<float> unitSquareDistributionInclusive(0.f, nextafter(1.f, FLT_MAX));
-
         GetRandomJump = bind(jumpDistribution, ref(m_generatorURNG));
         GetRandomSetJump = bind(jumpSetDistribution, ref(m_generatorURNG));
-        GetRandomFloat01 = bind(unitSquareDistribution, ref(m_generatorURNG));
-        GetRandomFloat01inclusive = bind(unitSquareDistributionInclusive, ref(m_generatorURNG));
     }
 
     // Generate random samples.
     {
-        GenerateSamples2D();
-
-        switch (hemisphereDistribution)
+        if (!LoadSampleSets())
         {
-        case HemisphereDistribution::Uniform: InitializeHemisphereSamples(0.f); break;
-        case HemisphereDistribution::Cosine: InitializeHemisphereSamples(1.f); break;
+            ParallelFor(m_numSampleSets, [&](UINT sampleSet)
+            {
+                mt19937 generatorURNG(SampleSetSeed(s_seed, sampleSet));
+                GenerateSamples2D(&m_samples[sampleSet * m_numSamples], generatorURNG);
+            });
+            SaveSampleSets();
         }
 
-        for (UINT i = 0; i < m_numSampleSets; i++)
+        vector<UINT> pixelRanks;
+        if (IsProgressive())
         {
-            auto first = begin(m_shuffledIndices) + i * m_numSamples;
-            auto last = first + m_numSamples;
-            
-            iota(first, last, 0u); // Fill with 0, 1, ..., m_numSamples - 1 
-            shuffle(first, last, m_generatorURNG);
+            pixelRanks = GenerateBlueNoiseMask(numPixelsPerDimPerSet, s_seed);
         }
+
+        float cosDensityPower = hemisphereDistribution == HemisphereDistribution::Cosine ? 1.f : 0.f;
+        ParallelFor(m_numSampleSets, [&](UINT sampleSet)
+        {
+            InitializeHemisphereSamples(sampleSet, cosDensityPower);
+            InitializeSampleOrder(sampleSet, pixelRanks);
+        });
     }
 };
 
-UnitSquareSample2D Sampler::RandomFloat01_2D()
+// Initialize the order samples of a set are accessed in.
+// pixelRanks - blue noise mask ranks of the pixels that share a set, for progressive samplers.
+void Sampler::InitializeSampleOrder(UINT sampleSet, const vector<UINT>& pixelRanks)
 {
-    return XMFLOAT2(GetRandomFloat01(), GetRandomFloat01());
+    auto first = begin(m_shuffledIndices) + sampleSet * m_numSamples;
+    auto last = first + m_numSamples;
+
+    iota(first, last, 0u); // Fill with 0, 1, ..., m_numSamples - 1 
+
+    if (IsProgressive())
+    {
+        // Neighboring pixels read consecutive samples of a shared set. 
+        // Give each pixel the sample at its rank in the blue noise mask instead,
+        // so that any pixels evenly spread across the NxN get the first, well stratified, 
+        // samples of the set. 
+        UINT numPixelsPerSet = static_cast<UINT>(pixelRanks.size());
+        for (UINT i = 0; i + numPixelsPerSet <= m_numSamples; i += numPixelsPerSet)
+        {
+            for (UINT pixel = 0; pixel < numPixelsPerSet; pixel++)
+            {
+                first[i + pixel] = i + pixelRanks[pixel];
+            }
+        }
+    }
+    else
+    {
+        // Shuffle with a generator of its own, so that the order doesn't depend 
+        // on whether the samples were generated or loaded.
+        mt19937 generatorURNG(SampleSetSeed(~s_seed, sampleSet));
+        shuffle(first, last, generatorURNG);
+    }
+}
+
+string Sampler::CacheFileName()
+{
+    return string("SampleSets_") + Name() + "_" + to_string(s_seed) + "_" + to_string(m_numSamples) + "x" + to_string(m_numSampleSets) + ".bin";
+}
+
+bool Sampler::LoadSampleSets()
+{
+    if (m_samples.size() < c_minCachedSamples)
+    {
+        return false;
+    }
+
+    ifstream file(CacheFileName(), ifstream::in | ifstream::binary);
+    UINT header[3] = {};
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!file || header[0] != c_cacheFileVersion || header[1] != m_numSamples || header[2] != m_numSampleSets)
+    {
+        return false;
+    }
+
+    file.read(reinterpret_cast<char*>(m_samples.data()), m_samples.size() * sizeof(UnitSquareSample2D));
+    return !!file;
+}
+
+void Sampler::SaveSampleSets()
+{
+    if (m_samples.size() < c_minCachedSamples)
+    {
+        return;
+    }
+
+    ofstream file(CacheFileName(), ofstream::out | ofstream::binary | ofstream::trunc);
+    UINT header[3] = { c_cacheFileVersion, m_numSamples, m_numSampleSets };
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(m_samples.data()), m_samples.size() * sizeof(UnitSquareSample2D));
 }
 
-UINT Sampler::GetRandomNumber(UINT min, UINT max)
+UnitSquareSample2D Sampler::RandomFloat01_2D(mt19937& generatorURNG)
+{
+    uniform_real_distribution<float> unitSquareDistribution(0.f, 1.f);
+    return XMFLOAT2(unitSquareDistribution(generatorURNG), unitSquareDistribution(generatorURNG));
+}
+
+UINT Sampler::GetRandomNumber(mt19937& generatorURNG, UINT min, UINT max)
 {
     uniform_int_distribution<UINT> distribution(min, max);
-    return distribution(m_generatorURNG);
+    return distribution(generatorURNG);
 }
 UnitSquareSample2D Sampler::GetSample2D()
 {
@@ -116,9 +413,9 @@ HemisphereSample3D Sampler::GetHemisphereSample3D()
 
 // Initialize samples on a 3D hemisphere from 2D unit square samples
 // cosDensityPower - cosine density power {0, 1, ...}. 0:uniform, 1:cosine,...
-void Sampler::InitializeHemisphereSamples(float cosDensityPower)
+void Sampler::InitializeHemisphereSamples(UINT sampleSet, float cosDensityPower)
 {
-    for (UINT i = 0; i < m_samples.size(); i++)
+    for (UINT i = sampleSet * m_numSamples; i < (sampleSet + 1) * m_numSamples; i++)
     {
         // Compute azimuth (phi) and polar angle (theta)
         /*
@@ -152,58 +449,170 @@ void Sampler::InitializeHemisphereSamples(float cosDensityPower)
 //             with each sample being random within its cell.
 // - N-rooks/Linear hypercube sampling: samples have uniform
 //             distribution in 1D projections of each axes.
-void MultiJittered::GenerateSamples2D()
+void MultiJittered::GenerateSamples2D(UnitSquareSample2D* samples, mt19937& generatorURNG)
 {
-    for (UINT s = 0; s < NumSampleSets(); s++)
-    {
-        // Generate samples on 2 level grid, with one sample per each (x,y)
-        UINT sampleSetStartID = s * NumSamples();
+    // Generate samples on 2 level grid, with one sample per each (x,y)
+    const UINT T = NumSamples();
+    const UINT N = static_cast<UINT>(sqrt(T));
 
-        const UINT T = NumSamples();
-        const UINT N = static_cast<UINT>(sqrt(T));
+    // Generate random samples
+    for (UINT col = 0, i = 0; col < N; col++)
+        for (UINT row = 0; row < N; row++, i++)
+        {
+            XMFLOAT2 stratum(static_cast<float>(row), static_cast<float>(col));
+            XMFLOAT2 cell(static_cast<float>(col), static_cast<float>(row));
+            UnitSquareSample2D randomValue01 = RandomFloat01_2D(generatorURNG);
 
-        #define SAMPLE(i) m_samples[sampleSetStartID + i]
+            samples[i].x = (randomValue01.x + cell.x) / T + stratum.x / N;
+            samples[i].y = (randomValue01.y + cell.y) / T + stratum.y / N;
+        }
 
-        // Generate random samples
-        for (UINT col = 0, i = 0; col < N; col++)
-            for (UINT row = 0; row < N; row++, i++)
-            {
-                XMFLOAT2 stratum(static_cast<float>(row), static_cast<float>(col));
-                XMFLOAT2 cell(static_cast<float>(col), static_cast<float>(row));
-                UnitSquareSample2D randomValue01 = RandomFloat01_2D();
+    // Shuffle sample axes such that there's a sample in each stratum 
+    // and n-rooks is maintained.
 
-                SAMPLE(i).x = (randomValue01.x + cell.x) / T + stratum.x / N;
-                SAMPLE(i).y = (randomValue01.y + cell.y) / T + stratum.y / N;
-            }
+    // Shuffle x coordinate across rows within a column
+    for (UINT row = 0; row < N - 1; row++)
+        for (UINT col = 0; col < N; col++)
+        {
+            UINT k = GetRandomNumber(generatorURNG, row + 1, N - 1);
+            swap(samples[row*N + col].x, samples[k*N + col].x);
+        }
 
-        // Shuffle sample axes such that there's a sample in each stratum 
-        // and n-rooks is maintained.
+    // Shuffle y coordinate across columns within a row
+    for (UINT row = 0; row < N; row++)
+        for (UINT col = 0; col < N - 1; col++)
+        {
+            UINT k = GetRandomNumber(generatorURNG, col + 1, N - 1);
+            swap(samples[row*N + col].y, samples[row*N + k].y);
+        }
+}
 
-        // Shuffle x coordinate across rows within a column
-        for (UINT row = 0; row < N - 1; row++)
-            for (UINT col = 0; col < N; col++)
-            {
-                UINT k = GetRandomNumber(row + 1, N - 1);
-                swap(SAMPLE(row*N + col).x, SAMPLE(k*N + col).x);
-            }
+// Generate random sample patterns on unit square.
+void Random::GenerateSamples2D(UnitSquareSample2D* samples, mt19937& generatorURNG)
+{
+    for (UINT i = 0; i < NumSamples(); i++)
+    {
+        samples[i] = RandomFloat01_2D(generatorURNG);
+    }
+}
 
-        // Shuffle y coordinate across columns within a row
-        for (UINT row = 0; row < N; row++)
-            for (UINT col = 0; col < N - 1; col++)
+// Generate Owen scrambled Sobol samples on unit square.
+// The first Sobol dimension is the bit reversed index, the second 
+// xors a direction number per set index bit, where each direction number 
+// is the previous one xored with itself shifted down by one.
+void Sobol::GenerateSamples2D(UnitSquareSample2D* samples, mt19937& generatorURNG)
+{
+    UINT seedX = generatorURNG();
+    UINT seedY = generatorURNG();
+
+    for (UINT i = 0; i < NumSamples(); i++)
+    {
+        UINT x = ReverseBits(i);
+        UINT y = 0;
+        for (UINT index = i, direction = 1u << 31; index; index >>= 1, direction ^= direction >> 1)
+        {
+            if (index & 1)
             {
-                UINT k = GetRandomNumber(col + 1, N - 1);
-                swap(SAMPLE(row*N + col).y, SAMPLE(row*N + k).y);
+                y ^= direction;
             }
-        
+        }
+        samples[i].x = ToFloat01(NestedUniformScramble(x, seedX));
+        samples[i].y = ToFloat01(NestedUniformScramble(y, seedY));
     }
 }
 
-// Generate random sample patterns on unit square.
-void Random::GenerateSamples2D()
+// Generate progressive multi-jittered (0,2) samples on unit square.
+// The sequence is extended from N = 4^k samples, one per cell of a 2^k x 2^k grid, in two steps:
+// - to 2N samples, with a sample in the subquadrant diagonally opposite of each sample's in its cell. 
+// - to 4N samples, with samples in the two remaining subquadrants of each cell.
+// Each new sample is placed randomly within its subquadrant, in elementary intervals of the extended 
+// count that no sample occupies yet.
+void PMJ02::GenerateSamples2D(UnitSquareSample2D* samples, mt19937& generatorURNG)
 {
-    for (auto& sample : m_samples)
+    const UINT numSamples = NumSamples();
+    if (numSamples == 0)
     {
-        sample = RandomFloat01_2D();
+        return;
     }
-}
+    samples[0] = RandomFloat01_2D(generatorURNG);
 
+    // Occupied elementary intervals of 2^log2Count samples, per interval shape.
+    UINT log2Count = 0;
+    vector<bool> occupied;
+    auto ToStratum = [&](float value) 
+    { 
+        return min(static_cast<UINT>(value * (1 << log2Count)), (1u << log2Count) - 1);
+    };
+    auto Occupy = [&](const UnitSquareSample2D& sample)
+    {
+        UINT X = ToStratum(sample.x), Y = ToStratum(sample.y);
+        for (UINT shape = 0; shape <= log2Count; shape++)
+            occupied[IntervalIndex(log2Count, shape, X, Y)] = true;
+    };
+    auto StartExtension = [&](UINT count)
+    {
+        for (log2Count = 0; (1u << log2Count) < count; log2Count++) {}
+        occupied.assign((log2Count + 1) << log2Count, false);
+        for (UINT i = 0; i < count / 2; i++)
+            Occupy(samples[i]);
+    };
+    
+    // Place a new sample in a subquadrant of a cell of an n x n grid.
+    uniform_real_distribution<float> unitDistribution(0.f, 1.f);
+    auto GenerateSample = [&](UINT cellX, UINT cellY, UINT halfX, UINT halfY, UINT n)
+    {
+        // The subquadrant fixes the top bits of the finest column and row. 
+        UINT subquadrantBits = 1;
+        for (UINT i = n; i > 1; i /= 2) 
+            subquadrantBits++;
+        UINT X = (2 * cellX + halfX) << (log2Count - subquadrantBits);
+        UINT Y = (2 * cellY + halfY) << (log2Count - subquadrantBits);
+        ThrowIfFalse(CompleteFreeStrata(occupied, log2Count, X, subquadrantBits, Y, subquadrantBits, generatorURNG), L"A (0,2) sequence always has a free stratum in the subquadrant");
+
+        // Random within the finest strata. Rounding mustn't take it to the next one.
+        auto Jitter = [&](UINT stratum)
+        {
+            float value = static_cast<float>((stratum + static_cast<double>(unitDistribution(generatorURNG))) / (1 << log2Count));
+            return min(value, nextafterf(static_cast<float>(stratum + 1) / (1 << log2Count), 0.f));
+        };
+        UnitSquareSample2D sample(Jitter(X), Jitter(Y));
+        Occupy(sample);
+        return sample;
+    };
+
+    for (UINT N = 1, n = 1; N < numSamples; N *= 4, n *= 2)
+    {
+        // Extend N to 2N samples.
+        StartExtension(2 * N);
+        for (UINT i = 0; i < N && N + i < numSamples; i++)
+        {
+            const UnitSquareSample2D& sample = samples[i];
+            UINT cellX = static_cast<UINT>(sample.x * n), cellY = static_cast<UINT>(sample.y * n);
+            UINT halfX = static_cast<UINT>(sample.x * 2 * n) & 1, halfY = static_cast<UINT>(sample.y * 2 * n) & 1;
+            samples[N + i] = GenerateSample(cellX, cellY, 1 - halfX, 1 - halfY, n);
+        }
+
+        if (2 * N >= numSamples)
+        {
+            break;
+        }
+
+        // Extend 2N to 4N samples.
+        StartExtension(4 * N);
+        for (UINT i = 0; i < N && 2 * N + i < numSamples; i++)
+        {
+            const UnitSquareSample2D& sample = samples[i];
+            UINT cellX = static_cast<UINT>(sample.x * n), cellY = static_cast<UINT>(sample.y * n);
+            UINT halfX = static_cast<UINT>(sample.x * 2 * n) & 1, halfY = static_cast<UINT>(sample.y * 2 * n) & 1;
+
+            // Pick one of the two remaining subquadrants at random, and the other for the 4th sample. 
+            if (GetRandomNumber(generatorURNG, 0, 1))
+                halfX = 1 - halfX;
+            else
+                halfY = 1 - halfY;
+            samples[2 * N + i] = GenerateSample(cellX, cellY, halfX, halfY, n);
+            if (3 * N + i < numSamples)
+                samples[3 * N + i] = GenerateSample(cellX, cellY, 1 - halfX, 1 - halfY, n);
+        }
+    }
+}
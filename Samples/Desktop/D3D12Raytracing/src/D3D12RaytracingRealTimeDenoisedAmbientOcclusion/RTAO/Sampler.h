@@ -22,17 +22,32 @@ namespace Samplers {
             Cosine
         };
     }
+
+    namespace SampleGenerator {
+        enum Enum {
+            Random,
+            MultiJittered,
+            Sobol,
+            PMJ02,
+            Count
+        };
+    }
+
+    // Generates a tileable size x size blue noise mask with the void-and-cluster method.
+    // Ref: [Ulichney 1993, The void-and-cluster method for dither array generation]
+    // Returns a rank within [0, size * size - 1] per pixel, in row major order.
+    // The pixels with the lowest ranks are evenly spread across the tile for any rank count.
+    std::vector<UINT> GenerateBlueNoiseMask(UINT size, UINT seed);
+
     class Sampler
     {
         static const UINT s_seed = 1729;
         std::function<UINT()> GetRandomJump;        // Generates a random uniform index within [0, m_numSamples - 1]
         std::function<UINT()> GetRandomSetJump;     // Generates a random uniform index within [0, m_numSampleSets - 1]
-        std::function<float()> GetRandomFloat01;    // Generates a random uniform float within [0,1)
-        std::function<float()> GetRandomFloat01inclusive; // Generates a random uniform float within [0,1]
     public:
         // Constructor, desctructor
         Sampler();
-        ~Sampler() {}
+        virtual ~Sampler() {}
         
         // Accessors
         UINT NumSamples() { return m_numSamples; }
@@ -41,16 +56,33 @@ namespace Samplers {
         // Member functions
         UnitSquareSample2D GetSample2D();
         HemisphereSample3D GetHemisphereSample3D();
-        void Reset(UINT numSamples, UINT numSampleSets, HemisphereDistribution::Enum useConsineHemisphereDistribution);
+        // numPixelsPerDimPerSet - NxN pixels that share a sample set. 
+        // Samples of progressive samplers are ordered for them with a blue noise mask.
+        void Reset(UINT numSamples, UINT numSampleSets, HemisphereDistribution::Enum useConsineHemisphereDistribution, UINT numPixelsPerDimPerSet = 1);
 
     private:
         UINT GetSampleIndex();
-        void InitializeHemisphereSamples(float cosDensityPower);
+        void InitializeHemisphereSamples(UINT sampleSet, float cosDensityPower);
+        void InitializeSampleOrder(UINT sampleSet, const std::vector<UINT>& pixelRanks);
+
+        // Sample sets take a while to generate for high sample counts,
+        // so large ones are cached to disk by generator, seed and counts.
+        std::string CacheFileName();
+        bool LoadSampleSets();
+        void SaveSampleSets();
 
     protected:
-        virtual void GenerateSamples2D() = 0; // Generate sample patterns in a unit square.
-        UnitSquareSample2D RandomFloat01_2D();
-        UINT GetRandomNumber(UINT min, UINT max);
+        // Generate a sample pattern in a unit square for a set of m_numSamples samples.
+        // Sets are generated in parallel, each with its own generator seeded by the set index.
+        virtual void GenerateSamples2D(UnitSquareSample2D* samples, std::mt19937& generatorURNG) = 0;
+
+        // Progressive samplers generate sets where the first 2^k samples are well stratified for any k.
+        // Their sample order is kept, rather than shuffled.
+        virtual bool IsProgressive() { return false; }
+        virtual const char* Name() = 0;
+
+        static UnitSquareSample2D RandomFloat01_2D(std::mt19937& generatorURNG);
+        static UINT GetRandomNumber(std::mt19937& generatorURNG, UINT min, UINT max);
 
         
         std::mt19937 m_generatorURNG;  // Uniform random number generator
@@ -74,6 +106,10 @@ namespace Samplers {
         // can lead to aliasing. This is a case when the initial
         // samples are generated always in the same spatial order,
         // such as is the case in multi-jittered sampler.
+        // Progressive samplers instead order the samples 
+        // of each NxN pixels of a set by a blue noise mask, 
+        // so that neighboring pixels get samples from 
+        // different strata.
         std::vector<UINT> m_shuffledIndices;
 
         // Index jump.
@@ -104,14 +140,42 @@ namespace Samplers {
     class MultiJittered : public Sampler
     {
     private:
-        void GenerateSamples2D();
+        void GenerateSamples2D(UnitSquareSample2D* samples, std::mt19937& generatorURNG);
+        const char* Name() { return "MultiJittered"; }
     };
 
     // Random sample patterns on unit square
     class Random : public Sampler
     {
     private:
-        void GenerateSamples2D();
+        void GenerateSamples2D(UnitSquareSample2D* samples, std::mt19937& generatorURNG);
+        const char* Name() { return "Random"; }
+    };
+
+    // Owen scrambled Sobol sample sequences on unit square
+    // Ref: [Burley 2020, Practical Hash-based Owen Scrambling]
+    // The first two Sobol dimensions form a (0,2)-sequence:
+    // the first 2^k samples have one sample in each elementary
+    // interval of area 2^-k, such as each cell of a 2^a x 2^(k-a) grid. 
+    // Owen scrambling randomizes each set while keeping that.
+    class Sobol : public Sampler
+    {
+    private:
+        void GenerateSamples2D(UnitSquareSample2D* samples, std::mt19937& generatorURNG);
+        bool IsProgressive() { return true; }
+        const char* Name() { return "Sobol"; }
+    };
+
+    // Progressive multi-jittered (0,2) sample sequences on unit square
+    // Ref: [Christensen et al. 2018, Progressive Multi-Jittered Sample Sequences]
+    // Stratified as Sobol sequences, but each sample is placed randomly
+    // within its elementary intervals, rather than by a scrambled bit pattern.
+    class PMJ02 : public Sampler
+    {
+    private:
+        void GenerateSamples2D(UnitSquareSample2D* samples, std::mt19937& generatorURNG);
+        bool IsProgressive() { return true; }
+        const char* Name() { return "PMJ02"; }
     };
 
 } // namespace Samplers
\ No newline at end of file
@@ -0,0 +1,498 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Checks that NumberParser reads floats exactly as strtof does, that binary and ASCII PLY files
+// with any face integer types load the meshes they were written from, and that PBRT scenes get
+// their triangle mesh arrays and their PLY meshes, loaded in parallel, in order. Measures number
+// parsing against strtof and istream, and how long a mesh of a million vertices takes to load.
+
+#include "stdafx.h"
+#include "PBRTParser.h"
+#include "PlyParser.h"
+#include "NumberParser.h"
+
+using namespace std;
+using namespace SceneParser;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    // Switches to an empty directory of its own for a test's lifetime,
+    // so that the files a test writes for the parsers are found by their names,
+    // and leaves no files behind.
+    class ScopedFileDirectory
+    {
+    public:
+        ScopedFileDirectory() :
+            m_previousDirectory(filesystem::current_path()),
+            m_directory(filesystem::temp_directory_path() / "RTAOTestsSceneFiles")
+        {
+            filesystem::remove_all(m_directory);
+            filesystem::create_directories(m_directory);
+            filesystem::current_path(m_directory);
+        }
+
+        ~ScopedFileDirectory()
+        {
+            filesystem::current_path(m_previousDirectory);
+            filesystem::remove_all(m_directory);
+        }
+
+    private:
+        filesystem::path m_previousDirectory;
+        filesystem::path m_directory;
+    };
+
+    // A grid of numQuadsPerDim x numQuadsPerDim quads in the xy plane, two counterclockwise triangles per quad.
+    // Positions and normals are jittered so that they take arbitrary float values.
+    Mesh GridMesh(UINT numQuadsPerDim, UINT seed)
+    {
+        const UINT numVerticesPerDim = numQuadsPerDim + 1;
+        mt19937 generatorURNG(seed);
+        uniform_real_distribution<float> jitter(-0.25f, 0.25f);
+
+        Mesh mesh;
+        mesh.m_VertexBuffer.resize(numVerticesPerDim * numVerticesPerDim);
+        for (UINT y = 0; y < numVerticesPerDim; y++)
+        {
+            for (UINT x = 0; x < numVerticesPerDim; x++)
+            {
+                SceneParser::Vertex &vertex = mesh.m_VertexBuffer[y * numVerticesPerDim + x];
+                vertex.Position = Vector3(x + jitter(generatorURNG), y + jitter(generatorURNG), jitter(generatorURNG));
+
+                float nx = jitter(generatorURNG), ny = jitter(generatorURNG);
+                float length = sqrtf(nx * nx + ny * ny + 1);
+                vertex.Normal = Vector3(nx / length, ny / length, 1 / length);
+
+                vertex.UV.u = static_cast<float>(x) / numQuadsPerDim;
+                vertex.UV.v = static_cast<float>(y) / numQuadsPerDim;
+            }
+        }
+
+        for (UINT y = 0; y < numQuadsPerDim; y++)
+        {
+            for (UINT x = 0; x < numQuadsPerDim; x++)
+            {
+                Index i0 = y * numVerticesPerDim + x, i1 = i0 + 1, i2 = i0 + numVerticesPerDim, i3 = i2 + 1;
+                Index indices[6] = { i0, i1, i3, i0, i3, i2 };
+                mesh.m_IndexBuffer.insert(mesh.m_IndexBuffer.end(), begin(indices), end(indices));
+            }
+        }
+        return mesh;
+    }
+
+    void WriteInteger(ofstream &file, UINT value, UINT numBytes)
+    {
+        file.write(reinterpret_cast<const char*>(&value), numBytes);  // Little endian
+    }
+
+    // Writes a mesh as a PLY file. Faces are lists of the given PLY integer types.
+    // Each vertex has a property the parser doesn't use between its position and normal.
+    void WritePly(const string &fileName, const Mesh &mesh, bool ascii, const char *countType = "uchar", const char *indexType = "int", UINT verticesPerFace = 3)
+    {
+        auto BytesPerType = [](const string &type) -> UINT { return type.find("char") != string::npos ? 1 : type.find("short") != string::npos ? 2 : 4; };
+        const UINT numVertices = static_cast<UINT>(mesh.m_VertexBuffer.size());
+        const UINT numFaces = static_cast<UINT>(mesh.m_IndexBuffer.size() / verticesPerFace);
+
+        ofstream file(fileName, ofstream::out | ofstream::binary | ofstream::trunc);
+        file << "ply\n"
+             << "format " << (ascii ? "ascii" : "binary_little_endian") << " 1.0\n"
+             << "comment Written by RTAOTests\n"
+             << "element vertex " << numVertices << "\n"
+             << "property float x\nproperty float y\nproperty float z\n"
+             << "property float confidence\n"
+             << "property float nx\nproperty float ny\nproperty float nz\n"
+             << "property float u\nproperty float v\n"
+             << "element face " << numFaces << "\n"
+             << "property list " << countType << " " << indexType << " vertex_indices\n"
+             << "end_header\n";
+
+        for (const SceneParser::Vertex &vertex : mesh.m_VertexBuffer)
+        {
+            float properties[9] = { vertex.Position.x, vertex.Position.y, vertex.Position.z, 0.5f, vertex.Normal.x, vertex.Normal.y, vertex.Normal.z, vertex.UV.u, vertex.UV.v };
+            if (ascii)
+            {
+                char line[256];
+                int length = 0;
+                for (float property : properties)
+                    length += snprintf(line + length, sizeof(line) - length, "%.9g ", property);
+                file << line << "\n";
+            }
+            else
+            {
+                file.write(reinterpret_cast<const char*>(properties), sizeof(properties));
+            }
+        }
+
+        for (UINT face = 0; face < numFaces; face++)
+        {
+            const Index *indices = &mesh.m_IndexBuffer[face * verticesPerFace];
+            if (ascii)
+            {
+                file << verticesPerFace;
+                for (UINT i = 0; i < verticesPerFace; i++)
+                    file << " " << indices[i];
+                file << "\n";
+            }
+            else
+            {
+                WriteInteger(file, verticesPerFace, BytesPerType(countType));
+                for (UINT i = 0; i < verticesPerFace; i++)
+                    WriteInteger(file, indices[i], BytesPerType(indexType));
+            }
+        }
+    }
+
+    // Writes a float or integer array of a PBRT shape, e.g. "point P" [ ... ].
+    template <typename T>
+    void WritePbrtArray(ofstream &file, const char *name, const vector<T> &values)
+    {
+        file << " \"" << name << "\" [";
+        char value[32];
+        for (T v : values)
+        {
+            snprintf(value, sizeof(value), is_integral<T>::value ? " %.0f" : " %.9g", static_cast<double>(v));
+            file << value;
+        }
+        file << " ]";
+    }
+
+    void WritePbrtTriangleMesh(ofstream &file, const Mesh &mesh)
+    {
+        vector<float> positions, normals, uvs;
+        for (const SceneParser::Vertex &vertex : mesh.m_VertexBuffer)
+        {
+            positions.insert(positions.end(), { vertex.Position.x, vertex.Position.y, vertex.Position.z });
+            normals.insert(normals.end(), { vertex.Normal.x, vertex.Normal.y, vertex.Normal.z });
+            uvs.insert(uvs.end(), { vertex.UV.u, vertex.UV.v });
+        }
+        file << "Shape \"trianglemesh\"";
+        WritePbrtArray(file, "integer indices", mesh.m_IndexBuffer);
+        WritePbrtArray(file, "point P", positions);
+        WritePbrtArray(file, "normal N", normals);
+        WritePbrtArray(file, "float uv", uvs);
+        file << "\n";
+    }
+
+    // Whether a mesh has the vertices and triangles of the mesh it was written from.
+    // normalTolerance is for the PBRT parser, which renormalizes normals.
+    // It also rewinds triangles, so their orders are only compared if windingMatters.
+    bool SameMesh(const Mesh &expected, const Mesh &mesh, float normalTolerance = 0, bool windingMatters = true)
+    {
+        if (expected.m_VertexBuffer.size() != mesh.m_VertexBuffer.size() || expected.m_IndexBuffer.size() != mesh.m_IndexBuffer.size())
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < mesh.m_VertexBuffer.size(); i++)
+        {
+            const SceneParser::Vertex &a = expected.m_VertexBuffer[i], &b = mesh.m_VertexBuffer[i];
+            if (memcmp(&a.Position, &b.Position, sizeof(a.Position)) || memcmp(&a.UV, &b.UV, sizeof(a.UV)) ||
+                fabsf(a.Normal.x - b.Normal.x) > normalTolerance || fabsf(a.Normal.y - b.Normal.y) > normalTolerance || fabsf(a.Normal.z - b.Normal.z) > normalTolerance)
+            {
+                return false;
+            }
+        }
+
+        for (size_t i = 0; i < mesh.m_IndexBuffer.size(); i += 3)
+        {
+            Index a[3] = { expected.m_IndexBuffer[i], expected.m_IndexBuffer[i + 1], expected.m_IndexBuffer[i + 2] };
+            Index b[3] = { mesh.m_IndexBuffer[i], mesh.m_IndexBuffer[i + 1], mesh.m_IndexBuffer[i + 2] };
+            if (!windingMatters)
+            {
+                sort(begin(a), end(a));
+                sort(begin(b), end(b));
+            }
+            if (!equal(begin(a), end(a), begin(b)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Whether func throws the parsers' format exception, which they throw by pointer.
+    template <typename Func>
+    bool ThrowsBadFormat(const Func &func)
+    {
+        try
+        {
+            func();
+        }
+        catch (BadFormatException *pException)
+        {
+            delete pException;
+            return true;
+        }
+        return false;
+    }
+
+    // Whitespace separated floats in the formats scene exporters write them in.
+    string RandomFloatText(UINT numValues, UINT seed)
+    {
+        static const char *formats[] = { "%g", "%.9g", "%e", "%.3f", "%.12f", "%.6f" };
+        static const char *separators[] = { " ", "  ", "\n", "\r\n", "\t", " \n\t " };
+        mt19937 generatorURNG(seed);
+        uniform_real_distribution<double> mantissa(-1e4, 1e4);
+
+        string text;
+        char value[64];
+        for (UINT i = 0; i < numValues; i++)
+        {
+            int exponent = static_cast<int>(generatorURNG() % 21) - 10;
+            snprintf(value, sizeof(value), formats[generatorURNG() % _countof(formats)], mantissa(generatorURNG) * pow(10.0, exponent));
+            text += value;
+            text += separators[generatorURNG() % _countof(separators)];
+        }
+        return text;
+    }
+}
+
+namespace RTAOTests
+{
+    TEST_CLASS(PBRTParserTests)
+    {
+    public:
+        TEST_METHOD(ParseFloatMatchesStrtof)
+        {
+            // Values that take the fast path, that have too many digits or too large an exponent for it,
+            // and forms that exporters write.
+            string text = RandomFloatText(200000, 1);
+            text += " 0 -0 +1.5 .5 5. 1e3 1E-3 -2.5e+2 3.4028235e38 1e-38 1.4e-45 123456789012345678901234 0.1234567890123456789 1e30 7e-30 ";
+
+            vector<float> expected;
+            for (const char *p = text.c_str(); ; )
+            {
+                char *end;
+                float value = strtof(p, &end);
+                if (end == p)
+                    break;
+                expected.push_back(value);
+                p = end;
+            }
+
+            const char *pCursor = text.data(), *pEnd = text.data() + text.size();
+            for (size_t i = 0; i < expected.size(); i++)
+            {
+                float value;
+                Assert::IsTrue(NumberParser::ParseFloat(pCursor, pEnd, value), L"Parses every value");
+                Assert::IsTrue(memcmp(&value, &expected[i], sizeof(float)) == 0, L"Values match strtof to the bit");
+            }
+            float value;
+            Assert::IsFalse(NumberParser::ParseFloat(pCursor, pEnd, value), L"Stops at the end");
+            Assert::IsTrue(NumberParser::SkipSeparators(pCursor, pEnd) == pEnd, L"Consumes the text");
+
+            LogMessage("%zu values match strtof", expected.size());
+        }
+
+        TEST_METHOD(ParseIntAndInvalidInput)
+        {
+            string text = "  12345678901 -42 +7\n\t0 9223372036854775807 ";
+            const char *pCursor = text.data(), *pEnd = text.data() + text.size();
+            INT64 expected[] = { 12345678901, -42, 7, 0, 9223372036854775807 };
+            for (INT64 value : expected)
+            {
+                INT64 parsed;
+                Assert::IsTrue(NumberParser::ParseInt(pCursor, pEnd, parsed), L"Parses every integer");
+                Assert::IsTrue(parsed == value, L"Integers match");
+            }
+
+            // Text that isn't a number, or an integer too long to be exact, is left as is.
+            for (string invalid : { "abc", "-", ".", "]", "12345678901234567890" })
+            {
+                const char *pStart = invalid.data(), *pInvalidEnd = invalid.data() + invalid.size();
+                const char *pInvalidCursor = pStart;
+                INT64 integer;
+                Assert::IsFalse(NumberParser::ParseInt(pInvalidCursor, pInvalidEnd, integer), L"Rejects what isn't an integer");
+                Assert::IsTrue(pInvalidCursor == pStart, L"Doesn't move past what it rejects");
+            }
+            for (string invalid : { "abc", "-", ".", "]", "e5" })
+            {
+                const char *pStart = invalid.data(), *pInvalidEnd = invalid.data() + invalid.size();
+                const char *pInvalidCursor = pStart;
+                float value;
+                Assert::IsFalse(NumberParser::ParseFloat(pInvalidCursor, pInvalidEnd, value), L"Rejects what isn't a float");
+                Assert::IsTrue(pInvalidCursor == pStart, L"Doesn't move past what it rejects");
+            }
+        }
+
+        TEST_METHOD(PlyFilesLoadTheirMeshes)
+        {
+            ScopedFileDirectory fileDirectory;
+            Mesh expected = GridMesh(40, 1);
+
+            for (bool ascii : { false, true })
+            {
+                WritePly("mesh.ply", expected, ascii);
+                Mesh mesh;
+                PlyParser::PlyParser().Parse("mesh.ply", mesh);
+                Assert::IsTrue(SameMesh(expected, mesh), ascii ? L"ASCII PLY files load the mesh they were written from" : L"Binary PLY files load the mesh they were written from");
+            }
+
+            // Every face list integer type. Indices are small enough for a byte.
+            Mesh small = GridMesh(8, 2);
+            for (const char *countType : { "uchar", "ushort", "uint" })
+            {
+                for (const char *indexType : { "uchar", "ushort", "int" })
+                {
+                    WritePly("small.ply", small, false, countType, indexType);
+                    Mesh mesh;
+                    PlyParser::PlyParser().Parse("small.ply", mesh);
+                    Assert::IsTrue(SameMesh(small, mesh), L"Faces load with any list integer types");
+                }
+            }
+        }
+
+        TEST_METHOD(BadPlyFilesThrow)
+        {
+            ScopedFileDirectory fileDirectory;
+            Mesh expected = GridMesh(8, 3);
+
+            Assert::IsTrue(ThrowsBadFormat([]() { Mesh mesh; PlyParser::PlyParser().Parse("missing.ply", mesh); }), L"Missing files throw");
+
+            // Quads
+            WritePly("quads.ply", expected, false, "uchar", "int", 4);
+            Assert::IsTrue(ThrowsBadFormat([]() { Mesh mesh; PlyParser::PlyParser().Parse("quads.ply", mesh); }), L"Faces that aren't triangles throw");
+            WritePly("quads.ply", expected, true, "uchar", "int", 4);
+            Assert::IsTrue(ThrowsBadFormat([]() { Mesh mesh; PlyParser::PlyParser().Parse("quads.ply", mesh); }), L"Faces that aren't triangles throw");
+
+            // Truncated in the faces, then in the vertices
+            WritePly("mesh.ply", expected, false);
+            auto size = filesystem::file_size("mesh.ply");
+            filesystem::resize_file("mesh.ply", size - 1);
+            Assert::IsTrue(ThrowsBadFormat([]() { Mesh mesh; PlyParser::PlyParser().Parse("mesh.ply", mesh); }), L"Truncated files throw");
+            filesystem::resize_file("mesh.ply", size / 2);
+            Assert::IsTrue(ThrowsBadFormat([]() { Mesh mesh; PlyParser::PlyParser().Parse("mesh.ply", mesh); }), L"Truncated files throw");
+        }
+
+        TEST_METHOD(PbrtScenesLoadTheirMeshes)
+        {
+            ScopedFileDirectory fileDirectory;
+            const UINT numPlyMeshes = 12;
+
+            // A triangle mesh, then PLY meshes of different sizes, so that they take different times to load.
+            vector<Mesh> expected;
+            expected.push_back(GridMesh(20, 100));
+            for (UINT i = 0; i < numPlyMeshes; i++)
+            {
+                expected.push_back(GridMesh(4 + (i * 7) % 40, i));
+                WritePly("mesh" + to_string(i) + ".ply", expected.back(), i % 3 == 0);
+            }
+
+            {
+                ofstream file("scene.pbrt");
+                file << "# Written by RTAOTests\nWorldBegin\nAttributeBegin\n";
+                WritePbrtTriangleMesh(file, expected[0]);
+                file << "AttributeEnd\n";
+                for (UINT i = 0; i < numPlyMeshes; i++)
+                    file << "Shape \"plymesh\" \"string filename\" [ \"mesh" << i << ".ply\" ]\n";
+                file << "WorldEnd\n";
+            }
+
+            // The triangle mesh normals' z is flipped on parsing.
+            for (SceneParser::Vertex &vertex : expected[0].m_VertexBuffer)
+                vertex.Normal.z = -vertex.Normal.z;
+
+            Scene scene;
+            PBRTParser::PBRTParser().Parse("scene.pbrt", scene, true, true);
+            Assert::AreEqual(static_cast<size_t>(numPlyMeshes + 1), scene.m_Meshes.size(), L"A mesh per shape");
+            for (UINT i = 0; i <= numPlyMeshes; i++)
+                Assert::IsTrue(SameMesh(expected[i], scene.m_Meshes[i], 1e-6f, false), L"Meshes load in order, with the data they were written with");
+        }
+
+        TEST_METHOD(PbrtSceneThrowsForBadPlyMeshes)
+        {
+            ScopedFileDirectory fileDirectory;
+            for (UINT i = 0; i < 8; i++)
+                WritePly("mesh" + to_string(i) + ".ply", GridMesh(16, i), false, "uchar", "int", i == 5 ? 4 : 3);
+
+            {
+                ofstream file("scene.pbrt");
+                file << "WorldBegin\n";
+                for (UINT i = 0; i < 8; i++)
+                    file << "Shape \"plymesh\" \"string filename\" [ \"mesh" << i << ".ply\" ]\n";
+                file << "WorldEnd\n";
+            }
+
+            Assert::IsTrue(ThrowsBadFormat([]() { Scene scene; PBRTParser::PBRTParser().Parse("scene.pbrt", scene, true, true); }), L"A PLY mesh's exception reaches the caller");
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(ParseThroughput)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(ParseThroughput)
+        {
+            const UINT numValues = 1 << 20;
+            string text = RandomFloatText(numValues, 2);
+            double sum = 0;
+
+            double start = BenchmarkTime();
+            {
+                const char *pCursor = text.data(), *pEnd = text.data() + text.size();
+                float value;
+                while (NumberParser::ParseFloat(pCursor, pEnd, value))
+                    sum += value;
+            }
+            double numberParserTime = BenchmarkTime() - start;
+
+            start = BenchmarkTime();
+            {
+                char *pEnd;
+                for (const char *p = text.c_str(); ; p = pEnd)
+                {
+                    float value = strtof(p, &pEnd);
+                    if (pEnd == p)
+                        break;
+                    sum += value;
+                }
+            }
+            double strtofTime = BenchmarkTime() - start;
+
+            start = BenchmarkTime();
+            {
+                istringstream stream(text);
+                float value;
+                while (stream >> value)
+                    sum += value;
+            }
+            double streamTime = BenchmarkTime() - start;
+
+            double megabytes = text.size() / 1e6;
+            LogMessage("%u floats, %.1f MB: NumberParser %.1f MB/s, strtof %.1f MB/s, istream %.1f MB/s",
+                numValues, megabytes, megabytes / numberParserTime, megabytes / strtofTime, megabytes / streamTime);
+
+            // A mesh of a million vertices and two million triangles.
+            ScopedFileDirectory fileDirectory;
+            Mesh expected = GridMesh(1023, 4);
+            start = BenchmarkTime();
+            expected.GenerateTangents();
+            double tangentsTime = BenchmarkTime() - start;
+
+            for (bool ascii : { false, true })
+            {
+                WritePly("mesh.ply", expected, ascii);
+                double fileMegabytes = filesystem::file_size("mesh.ply") / 1e6;
+
+                Mesh mesh;
+                start = BenchmarkTime();
+                PlyParser::PlyParser().Parse("mesh.ply", mesh);
+                double loadTime = BenchmarkTime() - start;
+                sum += mesh.m_VertexBuffer.back().Tangent.x;
+
+                LogMessage("%s PLY, %zu vertices, %.1f MB: loaded in %.3f s, %.3f s without tangents (%.1f MB/s)",
+                    ascii ? "ASCII" : "Binary", mesh.m_VertexBuffer.size(), fileMegabytes, loadTime, loadTime - tangentsTime, fileMegabytes / (loadTime - tangentsTime));
+            }
+
+            // Keeps the loops from being optimized away
+            Assert::IsTrue(sum == sum);
+        }
+    };
+}
@@ -0,0 +1,354 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Checks the AO sample generators: samples stay in range, progressive sets are (0,2)-nets 
+// at every power of two, sets are deterministic and cached as generated, and blue noise masks
+// spread their lowest ranks. Reports the L2-star discrepancy of each generator and how long
+// the largest setting the sample uses takes to generate and to load from the cache.
+
+#include "stdafx.h"
+#include "Sampler.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Samplers;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    // The sample's set count and its largest sample count per set.
+    const UINT c_numSampleSets = 83;
+    const UINT c_maxNumSamples = 1 << 16;
+
+    // Exposes the sets a sampler generated.
+    template <typename SamplerType>
+    class SampleSets : public SamplerType
+    {
+    public:
+        const UnitSquareSample2D* Set(UINT sampleSet) { return &this->m_samples[sampleSet * this->m_numSamples]; }
+        const HemisphereSample3D* HemisphereSet(UINT sampleSet) { return &this->m_hemisphereSamples[sampleSet * this->m_numSamples]; }
+        const UINT* SampleOrder(UINT sampleSet) { return &this->m_shuffledIndices[sampleSet * this->m_numSamples]; }
+        const vector<UnitSquareSample2D>& Samples() { return this->m_samples; }
+    };
+
+    // Calls func(sampler, name, isProgressive) with a sampler of each generator.
+    template <typename Func>
+    void ForEachGenerator(const Func& func)
+    {
+        { SampleSets<Random> sampler; func(sampler, "Random", false); }
+        { SampleSets<MultiJittered> sampler; func(sampler, "MultiJittered", false); }
+        { SampleSets<Sobol> sampler; func(sampler, "Sobol", true); }
+        { SampleSets<PMJ02> sampler; func(sampler, "PMJ02", true); }
+    }
+
+    // Large sample sets are cached to the working directory. 
+    // Switches to an empty directory of its own for a test's lifetime, 
+    // so that the test controls when sets are generated rather than loaded,
+    // and leaves no files behind.
+    class ScopedCacheDirectory
+    {
+    public:
+        ScopedCacheDirectory() :
+            m_previousDirectory(filesystem::current_path()),
+            m_directory(filesystem::temp_directory_path() / "RTAOTestsSampleSets")
+        {
+            filesystem::remove_all(m_directory);
+            filesystem::create_directories(m_directory);
+            filesystem::current_path(m_directory);
+        }
+
+        ~ScopedCacheDirectory()
+        {
+            filesystem::current_path(m_previousDirectory);
+            filesystem::remove_all(m_directory);
+        }
+
+        UINT NumCachedFiles()
+        {
+            return static_cast<UINT>(distance(filesystem::directory_iterator(m_directory), filesystem::directory_iterator()));
+        }
+
+        void Clear()
+        {
+            for (auto& entry : filesystem::directory_iterator(m_directory))
+                filesystem::remove(entry.path());
+        }
+
+    private:
+        filesystem::path m_previousDirectory;
+        filesystem::path m_directory;
+    };
+
+    // Whether each elementary interval of area 1/numSamples, 
+    // for each of its 2^a x 2^(log2(numSamples) - a) shapes, holds exactly one sample.
+    bool IsElementaryNet(const UnitSquareSample2D* samples, UINT numSamples)
+    {
+        UINT log2Count = 0;
+        while ((1u << log2Count) < numSamples)
+            log2Count++;
+
+        vector<bool> occupied(numSamples);
+        for (UINT shape = 0; shape <= log2Count; shape++)
+        {
+            UINT numColumns = 1 << shape, numRows = 1 << (log2Count - shape);
+            fill(begin(occupied), end(occupied), false);
+            for (UINT i = 0; i < numSamples; i++)
+            {
+                UINT column = static_cast<UINT>(samples[i].x * numColumns);
+                UINT row = static_cast<UINT>(samples[i].y * numRows);
+                if (column >= numColumns || row >= numRows || occupied[row * numColumns + column])
+                    return false;
+                occupied[row * numColumns + column] = true;
+            }
+        }
+        return true;
+    }
+
+    // L2-star discrepancy, by Warnock's formula.
+    double L2StarDiscrepancy(const UnitSquareSample2D* samples, UINT numSamples)
+    {
+        double sumProducts = 0, sumPairs = 0;
+        for (UINT i = 0; i < numSamples; i++)
+        {
+            double x = samples[i].x, y = samples[i].y;
+            sumProducts += (1 - x * x) * (1 - y * y);
+            for (UINT j = 0; j < numSamples; j++)
+            {
+                sumPairs += (1 - max(x, static_cast<double>(samples[j].x))) * (1 - max(y, static_cast<double>(samples[j].y)));
+            }
+        }
+        return sqrt(1.0 / 9 - sumProducts / (2.0 * numSamples) + sumPairs / (static_cast<double>(numSamples) * numSamples));
+    }
+
+    // Mean distance from each of the pixels ranked below numPixels to the nearest other one, on a torus.
+    double MeanNearestNeighborDistance(const vector<UINT>& ranks, UINT size, UINT numPixels)
+    {
+        vector<UINT> pixels;
+        for (UINT i = 0; i < size * size; i++)
+            if (ranks[i] < numPixels)
+                pixels.push_back(i);
+
+        double sumDistances = 0;
+        for (UINT a : pixels)
+        {
+            UINT minDistanceSq = UINT_MAX;
+            for (UINT b : pixels)
+            {
+                if (a == b)
+                    continue;
+                UINT dx = a % size > b % size ? a % size - b % size : b % size - a % size;
+                UINT dy = a / size > b / size ? a / size - b / size : b / size - a / size;
+                dx = min(dx, size - dx);
+                dy = min(dy, size - dy);
+                minDistanceSq = min(minDistanceSq, dx * dx + dy * dy);
+            }
+            sumDistances += sqrt(static_cast<double>(minDistanceSq));
+        }
+        return sumDistances / pixels.size();
+    }
+}
+
+namespace RTAOTests
+{
+    TEST_CLASS(SamplerTests)
+    {
+    public:
+        TEST_METHOD(SamplesAreInRange)
+        {
+            ScopedCacheDirectory cacheDirectory;
+            ForEachGenerator([&](auto& sampler, const char* name, bool)
+            {
+                for (auto distribution : { HemisphereDistribution::Uniform, HemisphereDistribution::Cosine })
+                {
+                    sampler.Reset(256, c_numSampleSets, distribution);
+                    for (UINT sampleSet = 0; sampleSet < c_numSampleSets; sampleSet++)
+                    {
+                        for (UINT i = 0; i < 256; i++)
+                        {
+                            const UnitSquareSample2D& sample = sampler.Set(sampleSet)[i];
+                            const HemisphereSample3D& direction = sampler.HemisphereSet(sampleSet)[i];
+                            Assert::IsTrue(sample.x >= 0 && sample.x < 1 && sample.y >= 0 && sample.y < 1, L"Unit square samples are within [0,1)");
+                            Assert::IsTrue(direction.z >= 0, L"Hemisphere samples are above the surface");
+                            Assert::AreEqual(1.f, direction.x * direction.x + direction.y * direction.y + direction.z * direction.z, 1e-5f, L"Hemisphere samples are directions");
+                        }
+                    }
+                }
+                LogMessage("%s: in range", name);
+            });
+        }
+
+        TEST_METHOD(ProgressiveSetsAreNets)
+        {
+            ScopedCacheDirectory cacheDirectory;
+            ForEachGenerator([&](auto& sampler, const char* name, bool isProgressive)
+            {
+                if (!isProgressive)
+                    return;
+
+                sampler.Reset(1024, c_numSampleSets, HemisphereDistribution::Cosine);
+                for (UINT sampleSet = 0; sampleSet < c_numSampleSets; sampleSet++)
+                    for (UINT numSamples = 1; numSamples <= 1024; numSamples *= 2)
+                        Assert::IsTrue(IsElementaryNet(sampler.Set(sampleSet), numSamples), L"Every power of two prefix of a set is a (0,2)-net");
+
+                // And at the largest sample count, with one set for time.
+                sampler.Reset(c_maxNumSamples, 1, HemisphereDistribution::Cosine);
+                for (UINT numSamples = 1; numSamples <= c_maxNumSamples; numSamples *= 2)
+                    Assert::IsTrue(IsElementaryNet(sampler.Set(0), numSamples), L"Every power of two prefix of a set is a (0,2)-net");
+
+                LogMessage("%s: every power of two prefix of %u sets of 1024 and a set of %u is a (0,2)-net", name, c_numSampleSets, c_maxNumSamples);
+            });
+        }
+
+        TEST_METHOD(ProgressiveSetsAreOrderedByTheMask)
+        {
+            ScopedCacheDirectory cacheDirectory;
+            const UINT numPixelsPerDim = 4, numPixels = numPixelsPerDim * numPixelsPerDim;
+            vector<UINT> ranks = GenerateBlueNoiseMask(numPixelsPerDim, 1729);
+
+            ForEachGenerator([&](auto& sampler, const char*, bool isProgressive)
+            {
+                sampler.Reset(64, c_numSampleSets, HemisphereDistribution::Cosine, numPixelsPerDim);
+                for (UINT sampleSet = 0; sampleSet < c_numSampleSets; sampleSet++)
+                {
+                    const UINT* order = sampler.SampleOrder(sampleSet);
+                    vector<UINT> sorted(order, order + 64);
+                    sort(begin(sorted), end(sorted));
+                    for (UINT i = 0; i < 64; i++)
+                        Assert::AreEqual(i, sorted[i], L"A set's order visits each sample once");
+
+                    if (isProgressive)
+                    {
+                        // Each run of NxN pixels reads the samples of its run by the pixels' ranks.
+                        for (UINT i = 0; i < 64; i++)
+                            Assert::AreEqual(i / numPixels * numPixels + ranks[i % numPixels], order[i], L"Progressive sets are ordered by the blue noise mask");
+                    }
+                }
+            });
+        }
+
+        TEST_METHOD(SetsAreDeterministicAndCached)
+        {
+            ScopedCacheDirectory cacheDirectory;
+            ForEachGenerator([&](auto& sampler, const char* name, bool)
+            {
+                // Small sets are never cached.
+                sampler.Reset(256, c_numSampleSets, HemisphereDistribution::Cosine);
+                Assert::AreEqual(0u, cacheDirectory.NumCachedFiles(), L"Small sample sets are not cached");
+                vector<UnitSquareSample2D> smallSets = sampler.Samples();
+
+                // A set doesn't depend on how many sets there are.
+                remove_reference_t<decltype(sampler)> moreSets;
+                moreSets.Reset(256, 2 * c_numSampleSets, HemisphereDistribution::Cosine);
+                Assert::IsTrue(memcmp(smallSets.data(), moreSets.Samples().data(), smallSets.size() * sizeof(UnitSquareSample2D)) == 0, L"Sets only depend on their index");
+
+                // Large ones are generated once, then loaded as generated.
+                sampler.Reset(c_maxNumSamples, 2, HemisphereDistribution::Cosine);
+                Assert::AreEqual(1u, cacheDirectory.NumCachedFiles(), L"Large sample sets are cached");
+                vector<UnitSquareSample2D> generated = sampler.Samples();
+
+                sampler.Reset(256, c_numSampleSets, HemisphereDistribution::Cosine);
+                sampler.Reset(c_maxNumSamples, 2, HemisphereDistribution::Cosine);
+                Assert::IsTrue(memcmp(generated.data(), sampler.Samples().data(), generated.size() * sizeof(UnitSquareSample2D)) == 0, L"Cached sets load as generated");
+
+                cacheDirectory.Clear();
+                sampler.Reset(c_maxNumSamples, 2, HemisphereDistribution::Cosine);
+                Assert::IsTrue(memcmp(generated.data(), sampler.Samples().data(), generated.size() * sizeof(UnitSquareSample2D)) == 0, L"Sets are deterministic");
+                cacheDirectory.Clear();
+
+                LogMessage("%s: deterministic and cached", name);
+            });
+        }
+
+        TEST_METHOD(Discrepancy)
+        {
+            // Mean L2-star discrepancy over the sets, per generator and sample count.
+            const UINT sampleCounts[] = { 64, 256, 1024 };
+            double discrepancy[SampleGenerator::Count][_countof(sampleCounts)] = {};
+
+            ScopedCacheDirectory cacheDirectory;
+            UINT generator = 0;
+            ForEachGenerator([&](auto& sampler, const char* name, bool)
+            {
+                for (UINT i = 0; i < _countof(sampleCounts); i++)
+                {
+                    sampler.Reset(sampleCounts[i], c_numSampleSets, HemisphereDistribution::Cosine);
+                    for (UINT sampleSet = 0; sampleSet < c_numSampleSets; sampleSet++)
+                        discrepancy[generator][i] += L2StarDiscrepancy(sampler.Set(sampleSet), sampleCounts[i]) / c_numSampleSets;
+                }
+                LogMessage("%-14s mean L2-star discrepancy, n = 64 / 256 / 1024: %.5f / %.5f / %.5f", name, discrepancy[generator][0], discrepancy[generator][1], discrepancy[generator][2]);
+                generator++;
+            });
+
+            for (UINT i = 0; i < _countof(sampleCounts); i++)
+            {
+                Assert::IsTrue(discrepancy[SampleGenerator::MultiJittered][i] < discrepancy[SampleGenerator::Random][i], L"Multi-jittered sets are more uniform than random ones");
+                Assert::IsTrue(discrepancy[SampleGenerator::Sobol][i] < discrepancy[SampleGenerator::MultiJittered][i], L"Sobol sets are more uniform than multi-jittered ones");
+                Assert::IsTrue(discrepancy[SampleGenerator::PMJ02][i] < discrepancy[SampleGenerator::MultiJittered][i], L"PMJ02 sets are more uniform than multi-jittered ones");
+            }
+        }
+
+        TEST_METHOD(BlueNoiseMasks)
+        {
+            for (UINT size = 1; size <= 64; size *= 2)
+            {
+                vector<UINT> ranks = GenerateBlueNoiseMask(size, 1729);
+                vector<UINT> sorted = ranks;
+                sort(begin(sorted), end(sorted));
+                for (UINT i = 0; i < size * size; i++)
+                    Assert::AreEqual(i, sorted[i], L"A mask ranks each pixel once");
+            }
+
+            // The lowest ranks of a mask are further apart than random ones.
+            const UINT size = 64;
+            vector<UINT> ranks = GenerateBlueNoiseMask(size, 1729);
+            vector<UINT> randomRanks(size * size);
+            iota(begin(randomRanks), end(randomRanks), 0u);
+            shuffle(begin(randomRanks), end(randomRanks), mt19937(1729));
+            for (UINT fraction : { 16u, 8u, 4u })
+            {
+                double maskDistance = MeanNearestNeighborDistance(ranks, size, size * size / fraction);
+                double randomDistance = MeanNearestNeighborDistance(randomRanks, size, size * size / fraction);
+                LogMessage("%ux%u mask, lowest 1/%u ranks: mean nearest neighbor distance %.2f (random ranks %.2f)", size, size, fraction, maskDistance, randomDistance);
+                Assert::IsTrue(maskDistance > randomDistance, L"The lowest ranks of a mask are evenly spread");
+            }
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(GenerationTime)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(GenerationTime)
+        {
+            // The largest setting of the sample, generated on all hardware threads, then loaded from the cache.
+            ScopedCacheDirectory cacheDirectory;
+            double sum = 0;
+            ForEachGenerator([&](auto& sampler, const char* name, bool)
+            {
+                double start = BenchmarkTime();
+                sampler.Reset(c_maxNumSamples, c_numSampleSets, HemisphereDistribution::Cosine);
+                double generateTime = BenchmarkTime() - start;
+                sum += sampler.Set(c_numSampleSets - 1)[c_maxNumSamples - 1].x;
+
+                start = BenchmarkTime();
+                sampler.Reset(c_maxNumSamples, c_numSampleSets, HemisphereDistribution::Cosine);
+                double loadTime = BenchmarkTime() - start;
+                sum += sampler.Set(c_numSampleSets - 1)[c_maxNumSamples - 1].x;
+                cacheDirectory.Clear();
+
+                LogMessage("%-14s %u x %u samples on %u threads: generated in %.3f s (%.1f M samples/s), loaded in %.3f s",
+                    name, c_maxNumSamples, c_numSampleSets, max(thread::hardware_concurrency(), 1u), 
+                    generateTime, c_maxNumSamples * c_numSampleSets / generateTime * 1e-6, loadTime);
+            });
+
+            // Keeps the loops from being optimized away
+            Assert::IsTrue(sum == sum);
+        }
+    };
+}
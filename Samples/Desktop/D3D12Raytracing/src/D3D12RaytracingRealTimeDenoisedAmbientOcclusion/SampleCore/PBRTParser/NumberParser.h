@@ -0,0 +1,214 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Fast parsing of whitespace separated ASCII numbers, as found in the bracketed
+// arrays of PBRT scenes and in ASCII PLY files.
+// Whitespace and digit runs are found 16 characters at a time with SSE2 and
+// runs of 8 digits are converted at once (SWAR). Numbers that can't be converted
+// exactly this way fall back to strtod.
+
+#pragma once
+
+#include <intrin.h>
+#include <emmintrin.h>
+
+namespace NumberParser
+{
+    // Returns a mask with a bit set for every one of the 16 characters at p that is whitespace (or any other control character).
+    inline UINT SeparatorMask16(const char* p)
+    {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // Signed compare: characters > ' ' are printable, including UTF-8 continuation bytes which compare negative
+        // and would therefore be classified as separators. Those never appear within numbers.
+        __m128i printable = _mm_cmpgt_epi8(chars, _mm_set1_epi8(' '));
+        return ~static_cast<UINT>(_mm_movemask_epi8(printable)) & 0xFFFF;
+    }
+
+    // Returns a mask with a bit set for every one of the 16 characters at p that is a decimal digit.
+    inline UINT DigitMask16(const char* p)
+    {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i aboveZero = _mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1));
+        __m128i belowNine = _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1));
+        return static_cast<UINT>(_mm_movemask_epi8(_mm_and_si128(aboveZero, belowNine)));
+    }
+
+    // The 16 character masks above leave bits 16-31 clear, so this counts at most 16 for them.
+    inline UINT CountTrailingOnes(UINT mask)
+    {
+        unsigned long index;
+        return _BitScanForward(&index, ~mask) ? index : 32;
+    }
+
+    inline const char* SkipSeparators(const char* p, const char* end)
+    {
+        while (end - p >= 16)
+        {
+            UINT separators = CountTrailingOnes(SeparatorMask16(p));
+            p += separators;
+            if (separators < 16)
+            {
+                return p;
+            }
+        }
+        while (p < end && static_cast<signed char>(*p) <= ' ')
+        {
+            ++p;
+        }
+        return p;
+    }
+
+    inline UINT CountDigits(const char* p, const char* end)
+    {
+        const char* start = p;
+        while (end - p >= 16)
+        {
+            UINT digits = CountTrailingOnes(DigitMask16(p));
+            p += digits;
+            if (digits < 16)
+            {
+                return static_cast<UINT>(p - start);
+            }
+        }
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            ++p;
+        }
+        return static_cast<UINT>(p - start);
+    }
+
+    // Converts 8 ASCII digits to an integer with three multiplies (SWAR).
+    inline UINT32 ParseEightDigits(const char* p)
+    {
+        UINT64 chunk;
+        memcpy(&chunk, p, sizeof(chunk));
+        chunk -= 0x3030303030303030ull;
+        chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFull;
+        chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFull;
+        chunk = chunk * 10000 + (chunk >> 32);
+        chunk &= 0xFFFFFFFFull;
+        return static_cast<UINT32>(chunk);
+    }
+
+    // Accumulates numDigits digits at p into value. Returns false on overflow of 19 significant digits.
+    inline bool AccumulateDigits(const char* p, UINT numDigits, UINT64& value, UINT& significantDigits)
+    {
+        if (significantDigits + numDigits > 19)
+        {
+            return false;
+        }
+        significantDigits += numDigits;
+
+        for (; numDigits >= 8; numDigits -= 8, p += 8)
+        {
+            value = value * 100000000ull + ParseEightDigits(p);
+        }
+        for (; numDigits > 0; --numDigits, ++p)
+        {
+            value = value * 10 + (*p - '0');
+        }
+        return true;
+    }
+
+    // Parses an optionally signed integer. Leading whitespace is skipped.
+    inline bool ParseInt(const char*& p, const char* end, INT64& value)
+    {
+        const char* cursor = SkipSeparators(p, end);
+        bool negative = false;
+        if (cursor < end && (*cursor == '-' || *cursor == '+'))
+        {
+            negative = *cursor == '-';
+            ++cursor;
+        }
+
+        UINT numDigits = CountDigits(cursor, end);
+        UINT significantDigits = 0;
+        UINT64 magnitude = 0;
+        if (numDigits == 0 || !AccumulateDigits(cursor, numDigits, magnitude, significantDigits))
+        {
+            return false;
+        }
+
+        value = negative ? -static_cast<INT64>(magnitude) : static_cast<INT64>(magnitude);
+        p = cursor + numDigits;
+        return true;
+    }
+
+    // Parses a floating point number in decimal or scientific notation. Leading whitespace is skipped.
+    inline bool ParseFloat(const char*& p, const char* end, float& value)
+    {
+        static const double PowersOf10[] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        const char* start = SkipSeparators(p, end);
+        const char* cursor = start;
+        bool negative = false;
+        if (cursor < end && (*cursor == '-' || *cursor == '+'))
+        {
+            negative = *cursor == '-';
+            ++cursor;
+        }
+
+        UINT64 mantissa = 0;
+        UINT significantDigits = 0;
+        INT exponent = 0;
+        bool exact = true;
+
+        UINT integerDigits = CountDigits(cursor, end);
+        exact &= AccumulateDigits(cursor, integerDigits, mantissa, significantDigits);
+        cursor += integerDigits;
+
+        UINT fractionDigits = 0;
+        if (cursor < end && *cursor == '.')
+        {
+            ++cursor;
+            fractionDigits = CountDigits(cursor, end);
+            exact &= AccumulateDigits(cursor, fractionDigits, mantissa, significantDigits);
+            cursor += fractionDigits;
+            exponent -= static_cast<INT>(fractionDigits);
+        }
+
+        if (integerDigits + fractionDigits == 0)
+        {
+            return false;
+        }
+
+        if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+        {
+            INT64 explicitExponent;
+            const char* exponentStart = cursor + 1;
+            if (exponentStart < end && static_cast<signed char>(*exponentStart) > ' ' && ParseInt(exponentStart, end, explicitExponent))
+            {
+                exponent += static_cast<INT>(explicitExponent);
+                cursor = exponentStart;
+            }
+        }
+
+        // Exact while the mantissa and the power of 10 are both exactly representable as doubles
+        if (exact && mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22)
+        {
+            double result = static_cast<double>(mantissa);
+            result = exponent < 0 ? result / PowersOf10[-exponent] : result * PowersOf10[exponent];
+            value = static_cast<float>(negative ? -result : result);
+        }
+        else
+        {
+            std::string text(start, cursor);
+            value = static_cast<float>(strtod(text.c_str(), nullptr));
+        }
+
+        p = cursor;
+        return true;
+    }
+}
@@ -17,6 +17,10 @@
 #include "stdafx.h"
 #include "PBRTParser.h"
 #include "PlyParser.h"
+#include "NumberParser.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
 
 using namespace SceneParser;
 using namespace std;
@@ -89,6 +93,7 @@ namespace PBRTParser
 			}
 		}
 
+		LoadPendingPlyMeshes(outputScene);
 		FixZeroVertexNormals(outputScene);
 
 		if (!rhCoords)
@@ -100,6 +105,53 @@ namespace PBRTParser
     }
 
 
+	void PBRTParser::LoadPendingPlyMeshes(SceneParser::Scene &outputScene)
+	{
+		const size_t numPlyMeshes = m_PendingPlyMeshes.size();
+		atomic<size_t> nextPlyMesh(0);
+		exception_ptr firstException;
+		mutex exceptionMutex;
+
+		auto LoadPlyMeshes = [&]()
+		{
+			for (size_t i = nextPlyMesh++; i < numPlyMeshes; i = nextPlyMesh++)
+			{
+				const PendingPlyMesh &plyMesh = m_PendingPlyMeshes[i];
+				Mesh &mesh = plyMesh.m_bAreaLight ? outputScene.m_AreaLights[plyMesh.m_MeshIndex].m_Mesh : outputScene.m_Meshes[plyMesh.m_MeshIndex];
+				try
+				{
+					PlyParser::PlyParser().Parse(plyMesh.m_FileName, mesh);
+				}
+				catch (...)
+				{
+					lock_guard<mutex> lock(exceptionMutex);
+					if (!firstException)
+					{
+						firstException = current_exception();
+					}
+				}
+			}
+		};
+
+		size_t numThreads = min<size_t>(max(thread::hardware_concurrency(), 1u), numPlyMeshes);
+		vector<thread> workers;
+		for (size_t i = 1; i < numThreads; i++)
+		{
+			workers.emplace_back(LoadPlyMeshes);
+		}
+		LoadPlyMeshes();
+		for (auto &worker : workers)
+		{
+			worker.join();
+		}
+
+		m_PendingPlyMeshes.clear();
+		if (firstException)
+		{
+			rethrow_exception(firstException);
+		}
+	}
+
 	// Calculates vertex normals where one is not set.
 	void PBRTParser::SwapGeometryCoordinateSystem(SceneParser::Scene &scene)
 	{
@@ -764,27 +816,65 @@ namespace PBRTParser
     void PBRTParser::ParseMesh(ifstream &fileStream, SceneParser::Scene &outputScene)
     {
         Mesh *pMesh;
-        if (GetCurrentAttributes().GetType() == Attributes::AreaLight)
+        bool bAreaLight = GetCurrentAttributes().GetType() == Attributes::AreaLight;
+        size_t meshIndex;
+        if (bAreaLight)
         {
             outputScene.m_AreaLights.push_back(
                 AreaLight(GetCurrentAttributes().GetAreaLightAttribute().m_lightColor));
+            meshIndex = outputScene.m_AreaLights.size() - 1;
             pMesh = &outputScene.m_AreaLights.back().m_Mesh;
         }
         else
         {
             outputScene.m_Meshes.push_back(Mesh());
-            pMesh = &outputScene.m_Meshes[outputScene.m_Meshes.size() - 1];
+            meshIndex = outputScene.m_Meshes.size() - 1;
+            pMesh = &outputScene.m_Meshes[meshIndex];
         }
         string correctedMaterialName = CorrectNameString(m_CurrentMaterial);
         pMesh->m_pMaterial = &outputScene.m_Materials[correctedMaterialName];
         ThrowIfTrue(pMesh->m_pMaterial == nullptr, L"Material name not found");
 		pMesh->m_transform = m_currentTransform;
-        ParseShape(fileStream, outputScene, *pMesh);
+        ParseShape(fileStream, outputScene, *pMesh, bAreaLight, meshIndex);
+
+
+    }
+
+    void PBRTParser::ParseBracketedInts(istream &inStream, vector<INT64> &values)
+    {
+        getline(inStream, m_arrayBuffer, ']');
+        ThrowIfTrue(inStream.eof(), L"Expected closing ']' after array");
+
+        const char *pCursor = m_arrayBuffer.data();
+        const char *pEnd = pCursor + m_arrayBuffer.size();
+        values.clear();
+
+        INT64 value;
+        while (NumberParser::ParseInt(pCursor, pEnd, value))
+        {
+            values.push_back(value);
+        }
+        ThrowIfTrue(NumberParser::SkipSeparators(pCursor, pEnd) != pEnd, L"Unexpected value in integer array");
+    }
+
+    void PBRTParser::ParseBracketedFloats(istream &inStream, vector<float> &values)
+    {
+        getline(inStream, m_arrayBuffer, ']');
+        ThrowIfTrue(inStream.eof(), L"Expected closing ']' after array");
 
+        const char *pCursor = m_arrayBuffer.data();
+        const char *pEnd = pCursor + m_arrayBuffer.size();
+        values.clear();
 
+        float value;
+        while (NumberParser::ParseFloat(pCursor, pEnd, value))
+        {
+            values.push_back(value);
+        }
+        ThrowIfTrue(NumberParser::SkipSeparators(pCursor, pEnd) != pEnd, L"Unexpected value in float array");
     }
 
-    void PBRTParser::ParseShape(ifstream &fileStream, SceneParser::Scene &outputScene, SceneParser::Mesh &mesh)
+    void PBRTParser::ParseShape(ifstream &fileStream, SceneParser::Scene &outputScene, SceneParser::Mesh &mesh, bool bAreaLight, size_t meshIndex)
     {
         fileStream >> lastParsedWord;
         
@@ -794,7 +884,8 @@ namespace PBRTParser
             ParseExpectedWords(fileStream, ExpectedWords, ARRAYSIZE(ExpectedWords));
 
             string correctedFileName = CorrectNameString(ParseString(fileStream));
-            PlyParser::PlyParser().Parse(m_relativeDirectory + correctedFileName, mesh);
+            PendingPlyMesh plyMesh = { m_relativeDirectory + correctedFileName, bAreaLight, meshIndex };
+            m_PendingPlyMeshes.push_back(plyMesh);
 
 
         }
@@ -809,22 +900,9 @@ namespace PBRTParser
                 fileStream >> lastParsedWord;
                 ThrowIfTrue(lastParsedWord.compare("["), L"\"indices\" expected to be followed up with \"[\"");
 
-                while (fileStream.good())
-                {
-                    int index;
-                    fileStream >> index;
-                    if (fileStream.good())
-                    {
-                        mesh.m_IndexBuffer.push_back(index);
-                    }
-                    else
-                    {
-                        fileStream.clear(ios::goodbit);
-                        fileStream >> lastParsedWord;
-                        ThrowIfTrue(lastParsedWord.compare("]"), L"Expected closing ']' after indices");
-                        break;
-                    }
-                }
+                vector<INT64> indices;
+                ParseBracketedInts(fileStream, indices);
+                mesh.m_IndexBuffer.assign(indices.begin(), indices.end());
 
                 fileStream >> lastParsedWord;
             }
@@ -838,26 +916,19 @@ namespace PBRTParser
                 fileStream >> lastParsedWord;
                 ThrowIfTrue(lastParsedWord.compare("["), L"'P' expected to be followed up with \"[\"");
 
-                while (fileStream.good())
+                vector<float> positions;
+                ParseBracketedFloats(fileStream, positions);
+                ThrowIfTrue(positions.size() % 3 != 0, L"Expected 3 values per position");
+
+                mesh.m_VertexBuffer.resize(positions.size() / 3, SceneParser::Vertex());
+                for (size_t i = 0; i < mesh.m_VertexBuffer.size(); i++)
                 {
-                    SceneParser::Vertex vertex = {};
-                    fileStream >> vertex.Position.x;
-                    fileStream >> vertex.Position.y;
-                    fileStream >> vertex.Position.z;
-
-                    if (fileStream.good())
-                    {
-                        mesh.m_VertexBuffer.push_back(vertex);
-                        verticesProcessed = true;
-                    }
-                    else
-                    {
-                        fileStream.clear(ios::goodbit);
-                        fileStream >> lastParsedWord;
-                        ThrowIfTrue(lastParsedWord.compare("]"), L"Expected closing ']' after positions");
-                        break;
-                    }
+                    SceneParser::Vertex &vertex = mesh.m_VertexBuffer[i];
+                    vertex.Position.x = positions[3 * i];
+                    vertex.Position.y = positions[3 * i + 1];
+                    vertex.Position.z = positions[3 * i + 2];
                 }
+                verticesProcessed = !mesh.m_VertexBuffer.empty();
 
                 fileStream >> lastParsedWord;
             }
@@ -871,32 +942,19 @@ namespace PBRTParser
                 fileStream >> lastParsedWord;
                 ThrowIfTrue(lastParsedWord.compare("["), L"'N' expected to be followed up with \"[\"");
 
-                UINT vertexIndex = 0;
-                while (fileStream.good())
+                vector<float> normals;
+                ParseBracketedFloats(fileStream, normals);
+                ThrowIfTrue(normals.size() % 3 != 0, L"Expected 3 values per normal");
+                ThrowIfTrue(normals.size() / 3 > mesh.m_VertexBuffer.size(), L"More position values specified than normals");
+
+                for (size_t i = 0; i < normals.size() / 3; i++)
                 {
-                    float x, y, z;
-                    fileStream >> x;
-                    fileStream >> y;
-                    fileStream >> z;
-                    if (fileStream.good())
-                    {
-                        ThrowIfTrue(vertexIndex >= mesh.m_VertexBuffer.size(), L"More position values specified than normals");
-                        SceneParser::Vertex &vertex = mesh.m_VertexBuffer[vertexIndex];
-                        vertexIndex++;
-
-                        vertex.Normal.x = x;
-                        vertex.Normal.y = y;
-                        vertex.Normal.z = -z;
-                        normalsProcessed = true;
-                    }
-                    else
-                    {
-                        fileStream.clear(ios::goodbit);
-                        fileStream >> lastParsedWord;
-                        ThrowIfTrue(lastParsedWord.compare("]"), L"Expected closing ']' after positions");
-                        break;
-                    }
+                    SceneParser::Vertex &vertex = mesh.m_VertexBuffer[i];
+                    vertex.Normal.x = normals[3 * i];
+                    vertex.Normal.y = normals[3 * i + 1];
+                    vertex.Normal.z = -normals[3 * i + 2];
                 }
+                normalsProcessed = !normals.empty();
 
                 fileStream >> lastParsedWord;
             }
@@ -910,30 +968,18 @@ namespace PBRTParser
                 fileStream >> lastParsedWord;
                 ThrowIfTrue(lastParsedWord.compare("["), L"'UV' expected to be followed up with \"[\"");
 
-                UINT vertexIndex = 0;
-                while (fileStream.good())
+                vector<float> uvs;
+                ParseBracketedFloats(fileStream, uvs);
+                ThrowIfTrue(uvs.size() % 2 != 0, L"Expected 2 values per UV");
+                ThrowIfTrue(uvs.size() / 2 > mesh.m_VertexBuffer.size(), L"More UV values specified than normals");
+
+                for (size_t i = 0; i < uvs.size() / 2; i++)
                 {
-                    float u, v;
-                    fileStream >> u;
-                    fileStream >> v;
-                    if (fileStream.good())
-                    {
-                        ThrowIfTrue(vertexIndex >= mesh.m_VertexBuffer.size(), L"More UV values specified than normals");
-                        SceneParser::Vertex &vertex = mesh.m_VertexBuffer[vertexIndex];
-                        vertexIndex++;
-
-                        vertex.UV.u = u;
-                        vertex.UV.v = v;
-                        uvsProcessed = true;
-                    }
-                    else
-                    {
-                        fileStream.clear(ios::goodbit);
-                        fileStream >> lastParsedWord;
-                        ThrowIfTrue(lastParsedWord.compare("]"), L"Expected closing ']' after positions");
-                        break;
-                    }
+                    SceneParser::Vertex &vertex = mesh.m_VertexBuffer[i];
+                    vertex.UV.u = uvs[2 * i];
+                    vertex.UV.v = uvs[2 * i + 1];
                 }
+                uvsProcessed = !uvs.empty();
 
                 fileStream >> lastParsedWord;
             }
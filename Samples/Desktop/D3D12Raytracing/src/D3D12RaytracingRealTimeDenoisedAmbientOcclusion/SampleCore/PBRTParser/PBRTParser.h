@@ -91,7 +91,12 @@ class PBRTParser : public SceneParser::SceneParserClass
         void ParseAreaLightSource(std::ifstream &fileStream, SceneParser::Scene &outputScene);
         void ParseTransform();
 
-        void ParseShape(std::ifstream &fileStream, SceneParser::Scene &outputScene, SceneParser::Mesh &mesh);
+        void ParseShape(std::ifstream &fileStream, SceneParser::Scene &outputScene, SceneParser::Mesh &mesh, bool bAreaLight, size_t meshIndex);
+        void LoadPendingPlyMeshes(SceneParser::Scene &outputScene);
+
+        // Reads the numbers of a bracketed array, up to and including the closing ']'.
+        void ParseBracketedInts(std::istream &inStream, std::vector<INT64> &values);
+        void ParseBracketedFloats(std::istream &inStream, std::vector<float> &values);
 
         void ParseBracketedVector3(std::istream, float &x, float &y, float &z);
 
@@ -167,6 +172,16 @@ class PBRTParser : public SceneParser::SceneParserClass
 
         XMMATRIX m_currentTransform;
 
+        // Ply meshes are loaded in parallel once the whole scene file has been parsed.
+        struct PendingPlyMesh
+        {
+            std::string m_FileName;
+            bool m_bAreaLight;
+            size_t m_MeshIndex;     // Into Scene::m_AreaLights or Scene::m_Meshes, which may still grow while parsing.
+        };
+        std::vector<PendingPlyMesh> m_PendingPlyMeshes;
+        std::string m_arrayBuffer;
+
         // Shouldn't be accessed directly outside of GetTempCharBuffer
         char _m_buffer[500];
         std::string lastParsedWord;
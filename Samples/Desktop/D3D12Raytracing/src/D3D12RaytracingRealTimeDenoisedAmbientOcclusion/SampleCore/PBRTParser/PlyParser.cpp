@@ -14,11 +14,12 @@
 // https://github.com/wallisc/DuosRenderer/tree/DXRRenderer/PBRTParser
 //
 
-#include "../../stdafx.h"
+#include "stdafx.h"
 #include <memory>
 #include <algorithm>
 #include "SceneParser.h"
 #include "PlyParser.h"
+#include "NumberParser.h"
 
 using namespace SceneParser;
 using namespace std;
@@ -33,206 +34,396 @@ void ThrowIfTrue(bool expression, string errorMessage = "")
     }
 }
 
-UINT8 PlyParser::BytesPerIntegerType(string type)
+MappedFile::MappedFile() :
+    m_file(INVALID_HANDLE_VALUE),
+    m_mapping(nullptr),
+    m_pData(nullptr),
+    m_size(0)
 {
-    if (!type.compare("uint8") || !type.compare("uchar"))
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const string &filename)
+{
+    Close();
+
+    m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping)
+    {
+        Close();
+        return false;
+    }
+
+    m_pData = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_pData)
+    {
+        Close();
+        return false;
+    }
+
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_pData)
+    {
+        UnmapViewOfFile(m_pData);
+        m_pData = nullptr;
+    }
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+    m_size = 0;
+}
+
+UINT8 PlyParser::BytesPerType(const string &type)
+{
+    if (!type.compare("uint8") || !type.compare("uchar") || !type.compare("int8") || !type.compare("char"))
     {
         return 1;
     }
-    else if (!type.compare("uint") || !type.compare("int"))
+    else if (!type.compare("uint16") || !type.compare("ushort") || !type.compare("int16") || !type.compare("short"))
+    {
+        return 2;
+    }
+    else if (!type.compare("uint") || !type.compare("int") || !type.compare("uint32") || !type.compare("int32") ||
+             !type.compare("float") || !type.compare("float32"))
     {
         return 4;
     }
+    else if (!type.compare("double") || !type.compare("float64"))
+    {
+        return 8;
+    }
     else
     {
-        ThrowIfTrue(true, "Integer type not implemented");
+        ThrowIfTrue(true, "Property type not implemented");
         return 0;
     }
 }
 
+string PlyParser::ParseWord()
+{
+    const char *pStart = m_pCursor;
+    while (m_pCursor < m_pEnd && *m_pCursor != ' ' && *m_pCursor != '\t' && *m_pCursor != '\r' && *m_pCursor != '\n')
+    {
+        m_pCursor++;
+    }
+    string word(pStart, m_pCursor);
+
+    while (m_pCursor < m_pEnd && (*m_pCursor == ' ' || *m_pCursor == '\t'))
+    {
+        m_pCursor++;
+    }
+    return word;
+}
+
+void PlyParser::SkipLine()
+{
+    while (m_pCursor < m_pEnd && *m_pCursor != '\n')
+    {
+        m_pCursor++;
+    }
+    if (m_pCursor < m_pEnd)
+    {
+        m_pCursor++;
+    }
+}
+
 void PlyParser::ParseHeader()
 {
-    m_fileStream >> lastParsedWord;
-    ThrowIfTrue(lastParsedWord.compare("ply"), "First word in ply file expect to be \'Ply\'");
-    
-    while (m_fileStream.good())
+    ThrowIfTrue(ParseWord().compare("ply"), "First word in ply file expect to be \'Ply\'");
+    SkipLine();
+
+    // Offsets within SceneParser::Vertex of the vertex properties we know about
+    static const struct
     {
-        if (!lastParsedWord.compare("end_header"))
+        const char *m_name;
+        ElementType m_type;
+        ElementIndex m_index;
+    } knownProperties[] =
+    {
+        { "x", POSITION, X }, { "y", POSITION, Y }, { "z", POSITION, Z },
+        { "nx", NORMAL, X }, { "ny", NORMAL, Y }, { "nz", NORMAL, Z },
+        { "u", TEXTURE, U }, { "v", TEXTURE, V },
+    };
+
+    m_format = BINARY_LITTLE_ENDIAN;
+    m_BytesPerVertexCount = 0;
+    m_BytesPerIndex = 0;
+    m_vertexStride = 0;
+    m_numFaces = 0;
+    m_numVertices = 0;
+    m_vertexLayout.clear();
+    m_vertexPropertyDstOffsets.clear();
+
+    string currentElement;
+    while (m_pCursor < m_pEnd)
+    {
+        string word = ParseWord();
+
+        if (!word.compare("end_header"))
         {
-            char tempBuffer[50];
-            m_fileStream.getline(tempBuffer, ARRAYSIZE(tempBuffer)); // Consume the last newline character;
-            break;
+            SkipLine(); // Consume the last newline character
+            return;
         }
-        else if (!lastParsedWord.compare("property"))
+        else if (!word.compare("format"))
         {
-            m_fileStream >> lastParsedWord;
-            if (!lastParsedWord.compare("list"))
+            string format = ParseWord();
+            if (!format.compare("ascii"))
             {
-                m_fileStream >> lastParsedWord;
-                m_BytesPerVertexCount = BytesPerIntegerType(lastParsedWord);
-                m_fileStream >> lastParsedWord;
-                m_BytesPerIndex = BytesPerIntegerType(lastParsedWord);
+                m_format = ASCII;
             }
-            else if (!lastParsedWord.compare("float"))
+            else
             {
-                m_fileStream >> lastParsedWord;
-                if (!lastParsedWord.compare("x"))
-                {
-                    m_elementLayout.push_back(Element(POSITION, X));
-                }
-                else if (!lastParsedWord.compare("y"))
-                {
-                    m_elementLayout.push_back(Element(POSITION, Y));
-                }
-                else if (!lastParsedWord.compare("z"))
-                {
-                    m_elementLayout.push_back(Element(POSITION, Z));
-                }
-                else if (!lastParsedWord.compare("nx"))
-                {
-                    m_elementLayout.push_back(Element(NORMAL, X));
-                }
-                else if (!lastParsedWord.compare("ny"))
-                {
-                    m_elementLayout.push_back(Element(NORMAL, Y));
-                }
-                else if (!lastParsedWord.compare("nz"))
-                {
-                    m_elementLayout.push_back(Element(NORMAL, Z));
-                }
-                else if (!lastParsedWord.compare("u"))
-                {
-                    m_elementLayout.push_back(Element(TEXTURE, U));
-                }
-                else if (!lastParsedWord.compare("v"))
-                {
-                    m_elementLayout.push_back(Element(TEXTURE, V));
-                }
+                ThrowIfTrue(format.compare("binary_little_endian"), "Only ascii and binary_little_endian ply files are supported");
             }
         }
-        else if (!lastParsedWord.compare("element"))
+        else if (!word.compare("element"))
         {
-            m_fileStream >> lastParsedWord;
-            if(!lastParsedWord.compare("face"))
+            currentElement = ParseWord();
+            if (!currentElement.compare("face"))
             {
-                m_fileStream >> m_numFaces;
+                m_numFaces = static_cast<UINT>(strtoul(ParseWord().c_str(), nullptr, 10));
             }
-            else if (!lastParsedWord.compare("vertex"))
+            else if (!currentElement.compare("vertex"))
             {
-                m_fileStream >> m_numVertices;
+                m_numVertices = static_cast<UINT>(strtoul(ParseWord().c_str(), nullptr, 10));
             }
         }
-        else
+        else if (!word.compare("property"))
         {
-            m_fileStream >> lastParsedWord;
+            string type = ParseWord();
+            if (!type.compare("list"))
+            {
+                if (!currentElement.compare("face"))
+                {
+                    m_BytesPerVertexCount = BytesPerType(ParseWord());
+                    m_BytesPerIndex = BytesPerType(ParseWord());
+                }
+            }
+            else if (!currentElement.compare("vertex"))
+            {
+                UINT8 size = BytesPerType(type);
+                string name = ParseWord();
+
+                UINT dstOffset = UINT_MAX;
+                for (auto &property : knownProperties)
+                {
+                    if (!name.compare(property.m_name))
+                    {
+                        ThrowIfTrue(type.compare("float") && type.compare("float32"), "Vertex attributes are expected to be floats");
+
+                        switch (property.m_type)
+                        {
+                        case POSITION:
+                            dstOffset = offsetof(SceneParser::Vertex, Position) + property.m_index * sizeof(float);
+                            break;
+                        case NORMAL:
+                            dstOffset = offsetof(SceneParser::Vertex, Normal) + property.m_index * sizeof(float);
+                            break;
+                        case TEXTURE:
+                            dstOffset = offsetof(SceneParser::Vertex, UV) + property.m_index * sizeof(float);
+                            break;
+                        }
+
+                        PropertyCopy copy = { m_vertexStride, dstOffset };
+                        m_vertexLayout.push_back(copy);
+                        break;
+                    }
+                }
+
+                m_vertexPropertyDstOffsets.push_back(dstOffset);
+                m_vertexStride += size;
+            }
         }
+
+        SkipLine();
     }
+
+    ThrowIfTrue(true, "Missing end_header");
 }
 
-UINT32 PlyParser::ParseVariableInteger(UINT8 bytePerInteger, void *pData)
+// Copies vertices from a binary ply file. NumCopies is known at compile time so the
+// per-property copies are unrolled and there is no per-property dispatch in the loop.
+template <UINT NumCopies>
+void PlyParser::CopyVertices(const char *pSrc, UINT stride, const PropertyCopy *pCopies, SceneParser::Vertex *pDst, UINT numVertices)
 {
-    switch (bytePerInteger)
+    for (UINT vertex = 0; vertex < numVertices; vertex++)
     {
-    case 1:
-    {
-        return (UINT32)(*(UINT8*)pData);
-    }
-    case 4:
-    {
-        return (*(UINT32*)pData);
-    }
-    default:
-        ThrowIfTrue(true, "Unimplemented integer type");
-        return 0;
+        BYTE *pVertex = reinterpret_cast<BYTE*>(&pDst[vertex]);
+        for (UINT c = 0; c < NumCopies; c++)
+        {
+            memcpy(pVertex + pCopies[c].m_dstOffset, pSrc + pCopies[c].m_srcOffset, sizeof(float));
+        }
+        pSrc += stride;
     }
 }
 
-void PlyParser::ParseBody(SceneParser::Mesh &mesh)
+namespace
 {
-    ThrowIfTrue(m_fileStream.fail());
-    ThrowIfTrue(m_fileStream.eof());
-    mesh.m_VertexBuffer.resize(m_numVertices);
-	mesh.m_IndexBuffer.reserve(3 * m_numFaces);
-
-    const UINT vertexSize = static_cast<UINT>(m_elementLayout.size() * sizeof(float));
-    const UINT verticesPerBuffer = 150;
-    const UINT bufferSize = vertexSize * verticesPerBuffer;
-    unique_ptr<char[]> pLineBuffer = unique_ptr<char[]>(new char[bufferSize]);
-    char *pIterator = pLineBuffer.get();
-    
-    for (UINT vertex = 0; vertex < m_numVertices; vertex++)
+    // Copies triangle indices from a binary ply file. Returns false if a face isn't a triangle.
+    template <typename CountType, typename IndexType>
+    bool CopyTriangles(const char *pSrc, UINT numFaces, Index *pDst)
     {
-        if (vertex % verticesPerBuffer == 0)
+        const UINT faceSize = sizeof(CountType) + 3 * sizeof(IndexType);
+        for (UINT face = 0; face < numFaces; face++, pSrc += faceSize, pDst += 3)
         {
-            UINT verticesLeft = m_numVertices - vertex;
-            UINT readSize = min(verticesLeft * vertexSize, bufferSize);
-
-            m_fileStream.read(pLineBuffer.get(), readSize);
-            ThrowIfTrue(m_fileStream.eof());
-            ThrowIfTrue(m_fileStream.fail(), "Failed to open a file");
+            CountType numIndicesPerFace;
+            memcpy(&numIndicesPerFace, pSrc, sizeof(CountType));
+            if (numIndicesPerFace != 3)
+            {
+                return false;
+            }
 
-            pIterator = pLineBuffer.get();
+            IndexType indices[3];
+            memcpy(indices, pSrc + sizeof(CountType), sizeof(indices));
+            pDst[0] = static_cast<Index>(indices[0]);
+            pDst[1] = static_cast<Index>(indices[1]);
+            pDst[2] = static_cast<Index>(indices[2]);
         }
+        return true;
+    }
 
-        SceneParser::Vertex &v = mesh.m_VertexBuffer[vertex];
+    typedef bool (*CopyTrianglesFunc)(const char *pSrc, UINT numFaces, Index *pDst);
 
-        for (auto element : m_elementLayout)
+    template <typename CountType>
+    CopyTrianglesFunc GetCopyTrianglesFunc(UINT8 bytesPerIndex)
+    {
+        switch (bytesPerIndex)
         {
-            float* pValue = nullptr;
-            switch (element.first)
-            {
-            case POSITION:
-                pValue = &v.Position[element.second];
-                break;
-            case NORMAL:
-                pValue = &v.Normal[element.second];
-                break;
-            case TEXTURE:
-                pValue = &v.UV[element.second];
-                break;
-            }
-
-            *pValue = *(float *)pIterator;
-            pIterator += sizeof(float);
+        case 1: return CopyTriangles<CountType, UINT8>;
+        case 2: return CopyTriangles<CountType, UINT16>;
+        case 4: return CopyTriangles<CountType, UINT32>;
+        default: return nullptr;
         }
     }
+}
+
+void PlyParser::ParseBinaryBody(SceneParser::Mesh &mesh)
+{
+    typedef void (*CopyVerticesFunc)(const char *pSrc, UINT stride, const PropertyCopy *pCopies, SceneParser::Vertex *pDst, UINT numVertices);
+    static const CopyVerticesFunc copyVerticesFuncs[] =
+    {
+        CopyVertices<0>, CopyVertices<1>, CopyVertices<2>, CopyVertices<3>,
+        CopyVertices<4>, CopyVertices<5>, CopyVertices<6>, CopyVertices<7>,
+        CopyVertices<8>,
+    };
+
+    ThrowIfTrue(m_vertexLayout.size() >= ARRAYSIZE(copyVerticesFuncs), "Too many vertex properties");
+    ThrowIfTrue(static_cast<UINT64>(m_numVertices) * m_vertexStride > static_cast<UINT64>(m_pEnd - m_pCursor), "Unexpected end of file");
+
+    copyVerticesFuncs[m_vertexLayout.size()](m_pCursor, m_vertexStride, m_vertexLayout.data(), mesh.m_VertexBuffer.data(), m_numVertices);
+    m_pCursor += static_cast<size_t>(m_numVertices) * m_vertexStride;
+
+    CopyTrianglesFunc copyTriangles = nullptr;
+    switch (m_BytesPerVertexCount)
+    {
+    case 1: copyTriangles = GetCopyTrianglesFunc<UINT8>(m_BytesPerIndex); break;
+    case 2: copyTriangles = GetCopyTrianglesFunc<UINT16>(m_BytesPerIndex); break;
+    case 4: copyTriangles = GetCopyTrianglesFunc<UINT32>(m_BytesPerIndex); break;
+    }
+    ThrowIfTrue(m_numFaces > 0 && copyTriangles == nullptr, "Unimplemented integer type");
 
     const UINT faceSize = m_BytesPerVertexCount + 3 * m_BytesPerIndex;
-    const UINT facesPerBuffer = bufferSize / faceSize;
-    const UINT faceBufferSize = faceSize * facesPerBuffer;
-    for (UINT face = 0; face < m_numFaces; face++)
+    ThrowIfTrue(static_cast<UINT64>(m_numFaces) * faceSize > static_cast<UINT64>(m_pEnd - m_pCursor), "Unexpected end of file");
+
+    if (m_numFaces > 0)
+    {
+        ThrowIfTrue(!copyTriangles(m_pCursor, m_numFaces, mesh.m_IndexBuffer.data()), "Not supporting non-triangle faces");
+        m_pCursor += static_cast<size_t>(m_numFaces) * faceSize;
+    }
+}
+
+void PlyParser::ParseAsciiBody(SceneParser::Mesh &mesh)
+{
+    const UINT numProperties = static_cast<UINT>(m_vertexPropertyDstOffsets.size());
+
+    for (UINT vertex = 0; vertex < m_numVertices; vertex++)
     {
-        if (face % facesPerBuffer == 0)
+        BYTE *pVertex = reinterpret_cast<BYTE*>(&mesh.m_VertexBuffer[vertex]);
+        for (UINT property = 0; property < numProperties; property++)
         {
-            UINT facesLeft = m_numFaces - face;
-            UINT readSize = min(facesLeft * faceSize, faceBufferSize);
-            m_fileStream.read(pLineBuffer.get(), readSize);
-            ThrowIfTrue(m_fileStream.fail(), "Failed to open a files");
+            float value;
+            ThrowIfTrue(!NumberParser::ParseFloat(m_pCursor, m_pEnd, value), "Failed to parse a vertex property");
 
-            pIterator = pLineBuffer.get();
+            UINT dstOffset = m_vertexPropertyDstOffsets[property];
+            if (dstOffset != UINT_MAX)
+            {
+                memcpy(pVertex + dstOffset, &value, sizeof(float));
+            }
         }
+    }
 
-        auto numIndicesPerFace = ParseVariableInteger(m_BytesPerVertexCount, pIterator);
+    Index *pIndices = mesh.m_IndexBuffer.data();
+    for (UINT face = 0; face < m_numFaces; face++)
+    {
+        INT64 numIndicesPerFace;
+        ThrowIfTrue(!NumberParser::ParseInt(m_pCursor, m_pEnd, numIndicesPerFace), "Failed to parse a face");
         ThrowIfTrue(numIndicesPerFace != 3, "Not supporting non-triangle faces");
-        pIterator += m_BytesPerVertexCount;
 
-        for (UINT faceIndex = 0; faceIndex < numIndicesPerFace; faceIndex++)
+        for (UINT faceIndex = 0; faceIndex < 3; faceIndex++)
         {
-            mesh.m_IndexBuffer.push_back((int)ParseVariableInteger(m_BytesPerIndex, pIterator));
-            pIterator += m_BytesPerIndex;
+            INT64 index;
+            ThrowIfTrue(!NumberParser::ParseInt(m_pCursor, m_pEnd, index), "Failed to parse a face");
+            *pIndices++ = static_cast<Index>(index);
         }
     }
+}
+
+void PlyParser::ParseBody(SceneParser::Mesh &mesh)
+{
+    mesh.m_VertexBuffer.resize(m_numVertices);
+    mesh.m_IndexBuffer.resize(3 * static_cast<size_t>(m_numFaces));
+
+    if (m_format == ASCII)
+    {
+        ParseAsciiBody(mesh);
+    }
+    else
+    {
+        ParseBinaryBody(mesh);
+    }
 
     mesh.GenerateTangents();
 }
 
 void PlyParser::Parse(const string &filename, SceneParser::Mesh &mesh)
 {
-    m_fileStream = ifstream(filename, ios::in | ios::binary);
-    ThrowIfTrue(!m_fileStream.good(), "Failure opening file");
+    ThrowIfTrue(!m_file.Open(filename), "Failure opening file");
+    m_pCursor = m_file.GetData();
+    m_pEnd = m_pCursor + m_file.GetSize();
 
     ParseHeader();
     ParseBody(mesh);
+
+    m_file.Close();
 }
 
 }
\ No newline at end of file
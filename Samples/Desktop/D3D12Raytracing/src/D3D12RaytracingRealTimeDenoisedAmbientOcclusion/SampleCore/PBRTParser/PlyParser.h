@@ -17,6 +17,29 @@
 #pragma once
 namespace PlyParser
 {
+    // Read-only view of a whole file, mapped into memory.
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        bool Open(const std::string &filename);
+        void Close();
+
+        const char *GetData() const { return m_pData; }
+        size_t GetSize() const { return m_size; }
+
+    private:
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        HANDLE m_file;
+        HANDLE m_mapping;
+        const char *m_pData;
+        size_t m_size;
+    };
+
     class PlyParser
     {
     public:
@@ -24,11 +47,22 @@ namespace PlyParser
         void ParseHeader();
         void ParseBody(SceneParser::Mesh &mesh);
     private:
-        UINT8 BytesPerIntegerType(std::string type);
-        UINT32 ParseVariableInteger(UINT8 bytePerInteger, void *pData);
+        UINT8 BytesPerType(const std::string &type);
+        std::string ParseWord();
+        void SkipLine();
 
-        std::ifstream m_fileStream;
-        std::string lastParsedWord;
+        void ParseBinaryBody(SceneParser::Mesh &mesh);
+        void ParseAsciiBody(SceneParser::Mesh &mesh);
+
+        MappedFile m_file;
+        const char *m_pCursor;
+        const char *m_pEnd;
+
+        enum Format
+        {
+            BINARY_LITTLE_ENDIAN,
+            ASCII
+        };
 
         enum ElementType
         {
@@ -46,11 +80,24 @@ namespace PlyParser
             Z = 2,
         };
 
+        // A vertex property compiled to the byte offsets it is copied from and to.
+        // Properties that aren't used are skipped over through the vertex stride.
+        struct PropertyCopy
+        {
+            UINT m_srcOffset;
+            UINT m_dstOffset;
+        };
+
+        template <UINT NumCopies>
+        static void CopyVertices(const char *pSrc, UINT stride, const PropertyCopy *pCopies, SceneParser::Vertex *pDst, UINT numVertices);
+
+        Format m_format;
         UINT8 m_BytesPerVertexCount;
         UINT8 m_BytesPerIndex;
 
-        typedef std::pair<ElementType, ElementIndex> Element;
-        std::vector<Element> m_elementLayout;
+        std::vector<PropertyCopy> m_vertexLayout;
+        std::vector<UINT> m_vertexPropertyDstOffsets;  // Per vertex property, UINT_MAX if unused. For ASCII files.
+        UINT m_vertexStride;
         UINT m_numFaces;
         UINT m_numVertices;
     };
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "TangentSpace.h"
+
 namespace SceneParser
 {
 
@@ -195,42 +197,22 @@ namespace SceneParser
 
         void GenerateTangents()
         {
-            // Zero tangents.
-            for (auto& vertex : m_VertexBuffer)
+            if (m_VertexBuffer.empty())
             {
-                vertex.Tangent.xmFloat3 = XMFLOAT3(0, 0, 0);
-            }
-
-            // Add tangents from all triangles a vertex corresponds to.
-            for (UINT i = 0; i < m_IndexBuffer.size(); i += 3)
-            {
-                auto& index0 = m_IndexBuffer[i];
-                auto& index1 = m_IndexBuffer[i+1];
-                auto& index2 = m_IndexBuffer[i+2];
-                XMFLOAT3& v0 = m_VertexBuffer[index0].Position.xmFloat3;
-                XMFLOAT3& v1 = m_VertexBuffer[index1].Position.xmFloat3;
-                XMFLOAT3& v2 = m_VertexBuffer[index2].Position.xmFloat3;
-
-                XMFLOAT2& uv0 = m_VertexBuffer[index0].UV.xmFloat2;
-                XMFLOAT2& uv1 = m_VertexBuffer[index1].UV.xmFloat2;
-                XMFLOAT2& uv2 = m_VertexBuffer[index2].UV.xmFloat2;
-
-                Vector3& tangent1 = m_VertexBuffer[index0].Tangent;
-                Vector3& tangent2 = m_VertexBuffer[index1].Tangent;
-                Vector3& tangent3 = m_VertexBuffer[index2].Tangent;
-
-                XMVECTOR tangent = XMLoadFloat3(&CalculateTangent(v0, v1, v2, uv0, uv1, uv2));
-
-                XMStoreFloat3(&tangent1.xmFloat3, tangent1.GetXMVECTOR() + tangent);
-                XMStoreFloat3(&tangent2.xmFloat3, tangent2.GetXMVECTOR() + tangent);
-                XMStoreFloat3(&tangent3.xmFloat3, tangent3.GetXMVECTOR() + tangent);
+                return;
             }
 
-            // Renormalize the tangents.
-            for (auto& vertex : m_VertexBuffer)
-            {
-                XMStoreFloat3(&vertex.Tangent.xmFloat3, XMVector3Normalize(XMLoadFloat3(&vertex.Tangent.xmFloat3)));
-            }
+            TangentSpace::InterleavedVertices vertices = {};
+            vertices.positions = &m_VertexBuffer[0].Position;
+            vertices.positionStride = sizeof(Vertex);
+            vertices.normals = &m_VertexBuffer[0].Normal;
+            vertices.normalStride = sizeof(Vertex);
+            vertices.texcoords = &m_VertexBuffer[0].UV;
+            vertices.texcoordStride = sizeof(Vertex);
+            vertices.vertexCount = static_cast<UINT>(m_VertexBuffer.size());
+            vertices.tangents = &m_VertexBuffer[0].Tangent;
+            vertices.tangentStride = sizeof(Vertex);
+            TangentSpace::GenerateTangentFrames(vertices, m_IndexBuffer.data(), static_cast<UINT>(m_IndexBuffer.size()));
         }
     };
 
@@ -11,6 +11,20 @@
 
 #include "d3dx12affinity.h"
 #include "Utils.h"
+#include "d3dx12affinity_commands.h"
+
+template <typename PayloadType>
+PayloadType* CD3DX12AffinityGraphicsCommandList::RecordCommand(EAffinityRecordedCommand Type, UINT AffinityMask)
+{
+    return static_cast<PayloadType*>(mCommandStream.Allocate(static_cast<UINT16>(Type), AffinityMask, sizeof(PayloadType)));
+}
+
+template <typename PayloadType, typename ElementType>
+PayloadType* CD3DX12AffinityGraphicsCommandList::RecordCommandWithArray(EAffinityRecordedCommand Type, UINT Count)
+{
+    SIZE_T const PayloadSize = GetRecordedArrayOffset<ElementType, PayloadType>() + Count * sizeof(ElementType);
+    return static_cast<PayloadType*>(mCommandStream.Allocate(static_cast<UINT16>(Type), mAffinityMask, PayloadSize));
+}
 
 void STDMETHODCALLTYPE CD3DX12AffinityGraphicsCommandList::SetAffinity(UINT AffinityMask)
 {
@@ -25,6 +39,16 @@ D3D12_COMMAND_LIST_TYPE CD3DX12AffinityGraphicsCommandList::GetType()
 
 HRESULT CD3DX12AffinityGraphicsCommandList::Close()
 {
+    if (mDeferredRecording)
+    {
+#if ALWAYS_RESET_ALL_COMMAND_LISTS
+        ReplayDeferredCommands((1 << GetNodeCount()) - 1);
+#else
+        ReplayDeferredCommands(mAffinityMask);
+#endif
+        return S_OK;
+    }
+
 #if ALWAYS_RESET_ALL_COMMAND_LISTS
     for (UINT i = 0; i < GetNodeCount(); ++i)
     {
@@ -61,6 +85,8 @@ HRESULT CD3DX12AffinityGraphicsCommandList::Reset(
         SetAffinity(1 << GetActiveNodeIndex());
     }
 
+    WaitForReplay();
+
 #if ALWAYS_RESET_ALL_COMMAND_LISTS
     for (UINT i = 0; i < GetNodeCount(); ++i)
     {
@@ -89,6 +115,13 @@ HRESULT CD3DX12AffinityGraphicsCommandList::Reset(
 void CD3DX12AffinityGraphicsCommandList::ClearState(
     CD3DX12AffinityPipelineState* pPipelineState)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_PIPELINE_STATE* Command = RecordCommand<D3DX12_RECORDED_PIPELINE_STATE>(EAffinityRecordedCommand::ClearState, mAffinityMask);
+        Command->pPipelineState = pPipelineState;
+        return;
+    }
+
     CD3DX12AffinityPipelineState* PipelineState = static_cast<CD3DX12AffinityPipelineState*>(pPipelineState);
 
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
@@ -107,6 +140,16 @@ void CD3DX12AffinityGraphicsCommandList::DrawInstanced(
     UINT StartVertexLocation,
     UINT StartInstanceLocation)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_DRAW_INSTANCED* Command = RecordCommand<D3DX12_RECORDED_DRAW_INSTANCED>(EAffinityRecordedCommand::DrawInstanced, mAffinityMask);
+        Command->VertexCountPerInstance = VertexCountPerInstance;
+        Command->InstanceCount = InstanceCount;
+        Command->StartVertexLocation = StartVertexLocation;
+        Command->StartInstanceLocation = StartInstanceLocation;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -123,6 +166,15 @@ void CD3DX12AffinityGraphicsCommandList::Dispatch(
     UINT ThreadGroupCountY,
     UINT ThreadGroupCountZ)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_DISPATCH* Command = RecordCommand<D3DX12_RECORDED_DISPATCH>(EAffinityRecordedCommand::Dispatch, mAffinityMask);
+        Command->ThreadGroupCountX = ThreadGroupCountX;
+        Command->ThreadGroupCountY = ThreadGroupCountY;
+        Command->ThreadGroupCountZ = ThreadGroupCountZ;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -140,6 +192,17 @@ void CD3DX12AffinityGraphicsCommandList::CopyBufferRegion(
     UINT64 SrcOffset,
     UINT64 NumBytes)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_COPY_BUFFER_REGION* Command = RecordCommand<D3DX12_RECORDED_COPY_BUFFER_REGION>(EAffinityRecordedCommand::CopyBufferRegion, mAffinityMask);
+        Command->pDstBuffer = pDstBuffer;
+        Command->DstOffset = DstOffset;
+        Command->pSrcBuffer = pSrcBuffer;
+        Command->SrcOffset = SrcOffset;
+        Command->NumBytes = NumBytes;
+        return;
+    }
+
     CD3DX12AffinityResource* DstBuffer = static_cast<CD3DX12AffinityResource*>(pDstBuffer);
     CD3DX12AffinityResource* SrcBuffer = static_cast<CD3DX12AffinityResource*>(pSrcBuffer);
 
@@ -162,6 +225,22 @@ void CD3DX12AffinityGraphicsCommandList::CopyTextureRegion(
     const D3DX12_AFFINITY_TEXTURE_COPY_LOCATION* pSrc,
     const D3D12_BOX* pSrcBox)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_COPY_TEXTURE_REGION* Command = RecordCommand<D3DX12_RECORDED_COPY_TEXTURE_REGION>(EAffinityRecordedCommand::CopyTextureRegion, mAffinityMask);
+        Command->Dst = *pDst;
+        Command->Src = *pSrc;
+        Command->DstX = DstX;
+        Command->DstY = DstY;
+        Command->DstZ = DstZ;
+        Command->HasSrcBox = pSrcBox != nullptr;
+        if (pSrcBox)
+        {
+            Command->SrcBox = *pSrcBox;
+        }
+        return;
+    }
+
     CD3DX12AffinityResource* DstTexture = static_cast<CD3DX12AffinityResource*>(pDst->pResource);
     CD3DX12AffinityResource* SrcTexture = static_cast<CD3DX12AffinityResource*>(pSrc->pResource);
 
@@ -185,6 +264,14 @@ void CD3DX12AffinityGraphicsCommandList::CopyResource(
     CD3DX12AffinityResource* pDstResource,
     CD3DX12AffinityResource* pSrcResource)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_COPY_RESOURCE* Command = RecordCommand<D3DX12_RECORDED_COPY_RESOURCE>(EAffinityRecordedCommand::CopyResource, mAffinityMask);
+        Command->pDstResource = pDstResource;
+        Command->pSrcResource = pSrcResource;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -204,6 +291,18 @@ void CD3DX12AffinityGraphicsCommandList::CopyTiles(
     UINT64 BufferStartOffsetInBytes,
     D3D12_TILE_COPY_FLAGS Flags)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_COPY_TILES* Command = RecordCommand<D3DX12_RECORDED_COPY_TILES>(EAffinityRecordedCommand::CopyTiles, mAffinityMask);
+        Command->pTiledResource = pTiledResource;
+        Command->TileRegionStartCoordinate = *pTileRegionStartCoordinate;
+        Command->TileRegionSize = *pTileRegionSize;
+        Command->pBuffer = pBuffer;
+        Command->BufferStartOffsetInBytes = BufferStartOffsetInBytes;
+        Command->Flags = Flags;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -228,6 +327,17 @@ void CD3DX12AffinityGraphicsCommandList::ResolveSubresource(
     UINT SrcSubresource,
     DXGI_FORMAT Format)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_RESOLVE_SUBRESOURCE* Command = RecordCommand<D3DX12_RECORDED_RESOLVE_SUBRESOURCE>(EAffinityRecordedCommand::ResolveSubresource, mAffinityMask);
+        Command->pDstResource = pDstResource;
+        Command->DstSubresource = DstSubresource;
+        Command->pSrcResource = pSrcResource;
+        Command->SrcSubresource = SrcSubresource;
+        Command->Format = Format;
+        return;
+    }
+
 
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
@@ -243,6 +353,13 @@ void CD3DX12AffinityGraphicsCommandList::ResolveSubresource(
 void CD3DX12AffinityGraphicsCommandList::IASetPrimitiveTopology(
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveTopology)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_PRIMITIVE_TOPOLOGY* Command = RecordCommand<D3DX12_RECORDED_PRIMITIVE_TOPOLOGY>(EAffinityRecordedCommand::IASetPrimitiveTopology, mAffinityMask);
+        Command->PrimitiveTopology = PrimitiveTopology;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -257,6 +374,14 @@ void CD3DX12AffinityGraphicsCommandList::RSSetViewports(
     UINT NumViewports,
     const D3D12_VIEWPORT* pViewports)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ARRAY* Command = RecordCommandWithArray<D3DX12_RECORDED_ARRAY, D3D12_VIEWPORT>(EAffinityRecordedCommand::RSSetViewports, NumViewports);
+        Command->Count = NumViewports;
+        memcpy(GetRecordedArray<D3D12_VIEWPORT>(Command), pViewports, NumViewports * sizeof(D3D12_VIEWPORT));
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -271,6 +396,14 @@ void CD3DX12AffinityGraphicsCommandList::RSSetScissorRects(
     UINT NumRects,
     const D3D12_RECT* pRects)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ARRAY* Command = RecordCommandWithArray<D3DX12_RECORDED_ARRAY, D3D12_RECT>(EAffinityRecordedCommand::RSSetScissorRects, NumRects);
+        Command->Count = NumRects;
+        memcpy(GetRecordedArray<D3D12_RECT>(Command), pRects, NumRects * sizeof(D3D12_RECT));
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -284,6 +417,17 @@ void CD3DX12AffinityGraphicsCommandList::RSSetScissorRects(
 void CD3DX12AffinityGraphicsCommandList::OMSetBlendFactor(
     const FLOAT BlendFactor[4])
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_BLEND_FACTOR* Command = RecordCommand<D3DX12_RECORDED_BLEND_FACTOR>(EAffinityRecordedCommand::OMSetBlendFactor, mAffinityMask);
+        Command->HasBlendFactor = BlendFactor != nullptr;
+        if (BlendFactor)
+        {
+            memcpy(Command->BlendFactor, BlendFactor, sizeof(Command->BlendFactor));
+        }
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -297,6 +441,13 @@ void CD3DX12AffinityGraphicsCommandList::OMSetBlendFactor(
 void CD3DX12AffinityGraphicsCommandList::OMSetStencilRef(
     UINT StencilRef)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_STENCIL_REF* Command = RecordCommand<D3DX12_RECORDED_STENCIL_REF>(EAffinityRecordedCommand::OMSetStencilRef, mAffinityMask);
+        Command->StencilRef = StencilRef;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -311,6 +462,14 @@ void CD3DX12AffinityGraphicsCommandList::ResourceBarrier(
     UINT NumBarriers,
     const D3DX12_AFFINITY_RESOURCE_BARRIER* pBarriers)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ARRAY* Command = RecordCommandWithArray<D3DX12_RECORDED_ARRAY, D3DX12_AFFINITY_RESOURCE_BARRIER>(EAffinityRecordedCommand::ResourceBarrier, NumBarriers);
+        Command->Count = NumBarriers;
+        memcpy(GetRecordedArray<D3DX12_AFFINITY_RESOURCE_BARRIER>(Command), pBarriers, NumBarriers * sizeof(D3DX12_AFFINITY_RESOURCE_BARRIER));
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -365,6 +524,16 @@ void CD3DX12AffinityGraphicsCommandList::ResourceBarrier(
 void CD3DX12AffinityGraphicsCommandList::ExecuteBundle(
     CD3DX12AffinityGraphicsCommandList* pCommandList)
 {
+    // The bundle has to be closed on every node before it is executed.
+    pCommandList->WaitForReplay();
+
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_EXECUTE_BUNDLE* Command = RecordCommand<D3DX12_RECORDED_EXECUTE_BUNDLE>(EAffinityRecordedCommand::ExecuteBundle, mAffinityMask);
+        Command->pCommandList = pCommandList;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -380,6 +549,14 @@ void CD3DX12AffinityGraphicsCommandList::SetDescriptorHeaps(
     UINT NumDescriptorHeaps,
     CD3DX12AffinityDescriptorHeap** ppDescriptorHeaps)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ARRAY* Command = RecordCommandWithArray<D3DX12_RECORDED_ARRAY, CD3DX12AffinityDescriptorHeap*>(EAffinityRecordedCommand::SetDescriptorHeaps, NumDescriptorHeaps);
+        Command->Count = NumDescriptorHeaps;
+        memcpy(GetRecordedArray<CD3DX12AffinityDescriptorHeap*>(Command), ppDescriptorHeaps, NumDescriptorHeaps * sizeof(CD3DX12AffinityDescriptorHeap*));
+        return;
+    }
+
     mCachedDescriptorHeaps.resize(NumDescriptorHeaps);
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
@@ -400,6 +577,13 @@ void CD3DX12AffinityGraphicsCommandList::SetDescriptorHeaps(
 void CD3DX12AffinityGraphicsCommandList::SetComputeRootSignature(
     CD3DX12AffinityRootSignature* pRootSignature)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_SIGNATURE* Command = RecordCommand<D3DX12_RECORDED_ROOT_SIGNATURE>(EAffinityRecordedCommand::SetComputeRootSignature, mAffinityMask);
+        Command->pRootSignature = pRootSignature;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -414,6 +598,13 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRootSignature(
 void CD3DX12AffinityGraphicsCommandList::SetGraphicsRootSignature(
     CD3DX12AffinityRootSignature* pRootSignature)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_SIGNATURE* Command = RecordCommand<D3DX12_RECORDED_ROOT_SIGNATURE>(EAffinityRecordedCommand::SetGraphicsRootSignature, mAffinityMask);
+        Command->pRootSignature = pRootSignature;
+        return;
+    }
+
     CD3DX12AffinityRootSignature* AffinityRootSignature = static_cast<CD3DX12AffinityRootSignature*>(pRootSignature);
 
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
@@ -432,6 +623,15 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRoot32BitConstant(
     UINT SrcData,
     UINT DestOffsetIn32BitValues)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_32BIT_CONSTANT* Command = RecordCommand<D3DX12_RECORDED_ROOT_32BIT_CONSTANT>(EAffinityRecordedCommand::SetComputeRoot32BitConstant, mAffinityMask);
+        Command->RootParameterIndex = RootParameterIndex;
+        Command->SrcData = SrcData;
+        Command->DestOffsetIn32BitValues = DestOffsetIn32BitValues;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -448,6 +648,15 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRoot32BitConstant(
     UINT SrcData,
     UINT DestOffsetIn32BitValues)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_32BIT_CONSTANT* Command = RecordCommand<D3DX12_RECORDED_ROOT_32BIT_CONSTANT>(EAffinityRecordedCommand::SetGraphicsRoot32BitConstant, mAffinityMask);
+        Command->RootParameterIndex = RootParameterIndex;
+        Command->SrcData = SrcData;
+        Command->DestOffsetIn32BitValues = DestOffsetIn32BitValues;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -465,6 +674,16 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRoot32BitConstants(
     const void* pSrcData,
     UINT DestOffsetIn32BitValues)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_32BIT_CONSTANTS* Command = RecordCommandWithArray<D3DX12_RECORDED_ROOT_32BIT_CONSTANTS, UINT>(EAffinityRecordedCommand::SetComputeRoot32BitConstants, Num32BitValuesToSet);
+        Command->RootParameterIndex = RootParameterIndex;
+        Command->Num32BitValuesToSet = Num32BitValuesToSet;
+        Command->DestOffsetIn32BitValues = DestOffsetIn32BitValues;
+        memcpy(GetRecordedArray<UINT>(Command), pSrcData, Num32BitValuesToSet * sizeof(UINT));
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -482,6 +701,16 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRoot32BitConstants(
     const void* pSrcData,
     UINT DestOffsetIn32BitValues)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_32BIT_CONSTANTS* Command = RecordCommandWithArray<D3DX12_RECORDED_ROOT_32BIT_CONSTANTS, UINT>(EAffinityRecordedCommand::SetGraphicsRoot32BitConstants, Num32BitValuesToSet);
+        Command->RootParameterIndex = RootParameterIndex;
+        Command->Num32BitValuesToSet = Num32BitValuesToSet;
+        Command->DestOffsetIn32BitValues = DestOffsetIn32BitValues;
+        memcpy(GetRecordedArray<UINT>(Command), pSrcData, Num32BitValuesToSet * sizeof(UINT));
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -497,6 +726,14 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRootConstantBufferView(
     UINT RootParameterIndex,
     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_VIEW* Command = RecordCommand<D3DX12_RECORDED_ROOT_VIEW>(EAffinityRecordedCommand::SetComputeRootConstantBufferView, mAffinityMask);
+        Command->RootParameterIndex = RootParameterIndex;
+        Command->BufferLocation = BufferLocation;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -512,6 +749,14 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRootConstantBufferView(
     UINT RootParameterIndex,
     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_VIEW* Command = RecordCommand<D3DX12_RECORDED_ROOT_VIEW>(EAffinityRecordedCommand::SetGraphicsRootConstantBufferView, mAffinityMask);
+        Command->RootParameterIndex = RootParameterIndex;
+        Command->BufferLocation = BufferLocation;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -527,6 +772,14 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRootShaderResourceView(
     UINT RootParameterIndex,
     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_VIEW* Command = RecordCommand<D3DX12_RECORDED_ROOT_VIEW>(EAffinityRecordedCommand::SetComputeRootShaderResourceView, mAffinityMask);
+        Command->RootParameterIndex = RootParameterIndex;
+        Command->BufferLocation = BufferLocation;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -542,6 +795,14 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRootShaderResourceView(
     UINT RootParameterIndex,
     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_VIEW* Command = RecordCommand<D3DX12_RECORDED_ROOT_VIEW>(EAffinityRecordedCommand::SetGraphicsRootShaderResourceView, mAffinityMask);
+        Command->RootParameterIndex = RootParameterIndex;
+        Command->BufferLocation = BufferLocation;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -557,6 +818,14 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRootUnorderedAccessView(
     UINT RootParameterIndex,
     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_VIEW* Command = RecordCommand<D3DX12_RECORDED_ROOT_VIEW>(EAffinityRecordedCommand::SetComputeRootUnorderedAccessView, mAffinityMask);
+        Command->RootParameterIndex = RootParameterIndex;
+        Command->BufferLocation = BufferLocation;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -572,6 +841,14 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRootUnorderedAccessView(
     UINT RootParameterIndex,
     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_VIEW* Command = RecordCommand<D3DX12_RECORDED_ROOT_VIEW>(EAffinityRecordedCommand::SetGraphicsRootUnorderedAccessView, mAffinityMask);
+        Command->RootParameterIndex = RootParameterIndex;
+        Command->BufferLocation = BufferLocation;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -588,6 +865,17 @@ void CD3DX12AffinityGraphicsCommandList::IASetVertexBuffers(
     UINT NumViews,
     const D3D12_VERTEX_BUFFER_VIEW* pViews)
 {
+    if (mDeferredRecording)
+    {
+        UINT const NumRecordedViews = pViews ? NumViews : 0;
+        D3DX12_RECORDED_BUFFER_VIEWS* Command = RecordCommandWithArray<D3DX12_RECORDED_BUFFER_VIEWS, D3D12_VERTEX_BUFFER_VIEW>(EAffinityRecordedCommand::IASetVertexBuffers, NumRecordedViews);
+        Command->StartSlot = StartSlot;
+        Command->NumViews = NumViews;
+        Command->HasViews = pViews != nullptr;
+        memcpy(GetRecordedArray<D3D12_VERTEX_BUFFER_VIEW>(Command), pViews, NumRecordedViews * sizeof(D3D12_VERTEX_BUFFER_VIEW));
+        return;
+    }
+
     mCachedBufferViews.resize(NumViews);
 
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
@@ -612,6 +900,17 @@ void CD3DX12AffinityGraphicsCommandList::SOSetTargets(
     UINT NumViews,
     const D3D12_STREAM_OUTPUT_BUFFER_VIEW* pViews)
 {
+    if (mDeferredRecording)
+    {
+        UINT const NumRecordedViews = pViews ? NumViews : 0;
+        D3DX12_RECORDED_BUFFER_VIEWS* Command = RecordCommandWithArray<D3DX12_RECORDED_BUFFER_VIEWS, D3D12_STREAM_OUTPUT_BUFFER_VIEW>(EAffinityRecordedCommand::SOSetTargets, NumRecordedViews);
+        Command->StartSlot = StartSlot;
+        Command->NumViews = NumViews;
+        Command->HasViews = pViews != nullptr;
+        memcpy(GetRecordedArray<D3D12_STREAM_OUTPUT_BUFFER_VIEW>(Command), pViews, NumRecordedViews * sizeof(D3D12_STREAM_OUTPUT_BUFFER_VIEW));
+        return;
+    }
+
     mCachedStreamOutBufferViews.resize(NumViews);
 
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
@@ -638,6 +937,23 @@ void CD3DX12AffinityGraphicsCommandList::OMSetRenderTargets(
     BOOL RTsSingleHandleToDescriptorRange,
     const D3D12_CPU_DESCRIPTOR_HANDLE* pDepthStencilDescriptor)
 {
+    if (mDeferredRecording)
+    {
+        // A single handle describes the whole range when RTsSingleHandleToDescriptorRange is set.
+        UINT const NumRecordedDescriptors = (RTsSingleHandleToDescriptorRange && NumRenderTargetDescriptors > 0) ? 1 : NumRenderTargetDescriptors;
+        D3DX12_RECORDED_RENDER_TARGETS* Command = RecordCommandWithArray<D3DX12_RECORDED_RENDER_TARGETS, D3D12_CPU_DESCRIPTOR_HANDLE>(EAffinityRecordedCommand::OMSetRenderTargets, NumRecordedDescriptors);
+        Command->NumRenderTargetDescriptors = NumRenderTargetDescriptors;
+        Command->NumRecordedDescriptors = NumRecordedDescriptors;
+        Command->RTsSingleHandleToDescriptorRange = RTsSingleHandleToDescriptorRange;
+        Command->HasDepthStencilDescriptor = pDepthStencilDescriptor != nullptr;
+        if (pDepthStencilDescriptor)
+        {
+            Command->DepthStencilDescriptor = *pDepthStencilDescriptor;
+        }
+        memcpy(GetRecordedArray<D3D12_CPU_DESCRIPTOR_HANDLE>(Command), pRenderTargetDescriptors, NumRecordedDescriptors * sizeof(D3D12_CPU_DESCRIPTOR_HANDLE));
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -671,6 +987,18 @@ void CD3DX12AffinityGraphicsCommandList::ClearDepthStencilView(
     UINT NumRects,
     const D3D12_RECT* pRects)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_CLEAR_DEPTH_STENCIL* Command = RecordCommandWithArray<D3DX12_RECORDED_CLEAR_DEPTH_STENCIL, D3D12_RECT>(EAffinityRecordedCommand::ClearDepthStencilView, NumRects);
+        Command->DepthStencilView = DepthStencilView;
+        Command->ClearFlags = ClearFlags;
+        Command->Depth = Depth;
+        Command->Stencil = Stencil;
+        Command->NumRects = NumRects;
+        memcpy(GetRecordedArray<D3D12_RECT>(Command), pRects, NumRects * sizeof(D3D12_RECT));
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -689,6 +1017,16 @@ void CD3DX12AffinityGraphicsCommandList::ClearRenderTargetView(
     UINT NumRects,
     const D3D12_RECT* pRects)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_CLEAR_RENDER_TARGET* Command = RecordCommandWithArray<D3DX12_RECORDED_CLEAR_RENDER_TARGET, D3D12_RECT>(EAffinityRecordedCommand::ClearRenderTargetView, NumRects);
+        Command->RenderTargetView = RenderTargetView;
+        memcpy(Command->ColorRGBA, ColorRGBA, sizeof(Command->ColorRGBA));
+        Command->NumRects = NumRects;
+        memcpy(GetRecordedArray<D3D12_RECT>(Command), pRects, NumRects * sizeof(D3D12_RECT));
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -713,6 +1051,18 @@ void CD3DX12AffinityGraphicsCommandList::ClearUnorderedAccessViewUint(
     UINT NumRects,
     const D3D12_RECT* pRects)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_CLEAR_UNORDERED_ACCESS_VIEW* Command = RecordCommandWithArray<D3DX12_RECORDED_CLEAR_UNORDERED_ACCESS_VIEW, D3D12_RECT>(EAffinityRecordedCommand::ClearUnorderedAccessViewUint, NumRects);
+        Command->ViewGPUHandleInCurrentHeap = ViewGPUHandleInCurrentHeap;
+        Command->ViewCPUHandle = ViewCPUHandle;
+        Command->pResource = pResource;
+        memcpy(Command->Values.Uint, Values, sizeof(Command->Values.Uint));
+        Command->NumRects = NumRects;
+        memcpy(GetRecordedArray<D3D12_RECT>(Command), pRects, NumRects * sizeof(D3D12_RECT));
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -735,6 +1085,18 @@ void CD3DX12AffinityGraphicsCommandList::ClearUnorderedAccessViewFloat(
     UINT NumRects,
     const D3D12_RECT* pRects)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_CLEAR_UNORDERED_ACCESS_VIEW* Command = RecordCommandWithArray<D3DX12_RECORDED_CLEAR_UNORDERED_ACCESS_VIEW, D3D12_RECT>(EAffinityRecordedCommand::ClearUnorderedAccessViewFloat, NumRects);
+        Command->ViewGPUHandleInCurrentHeap = ViewGPUHandleInCurrentHeap;
+        Command->ViewCPUHandle = ViewCPUHandle;
+        Command->pResource = pResource;
+        memcpy(Command->Values.Float, Values, sizeof(Command->Values.Float));
+        Command->NumRects = NumRects;
+        memcpy(GetRecordedArray<D3D12_RECT>(Command), pRects, NumRects * sizeof(D3D12_RECT));
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -753,6 +1115,21 @@ void CD3DX12AffinityGraphicsCommandList::DiscardResource(
     CD3DX12AffinityResource* pResource,
     const D3D12_DISCARD_REGION* pRegion)
 {
+    if (mDeferredRecording)
+    {
+        UINT const NumRecordedRects = pRegion ? pRegion->NumRects : 0;
+        D3DX12_RECORDED_DISCARD_RESOURCE* Command = RecordCommandWithArray<D3DX12_RECORDED_DISCARD_RESOURCE, D3D12_RECT>(EAffinityRecordedCommand::DiscardResource, NumRecordedRects);
+        Command->pResource = pResource;
+        Command->HasRegion = pRegion != nullptr;
+        if (pRegion)
+        {
+            Command->Region = *pRegion;
+            Command->Region.pRects = nullptr;
+            memcpy(GetRecordedArray<D3D12_RECT>(Command), pRegion->pRects, NumRecordedRects * sizeof(D3D12_RECT));
+        }
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -771,6 +1148,15 @@ void CD3DX12AffinityGraphicsCommandList::BeginQuery(
     D3D12_QUERY_TYPE Type,
     UINT Index)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_QUERY* Command = RecordCommand<D3DX12_RECORDED_QUERY>(EAffinityRecordedCommand::BeginQuery, mAffinityMask);
+        Command->pQueryHeap = pQueryHeap;
+        Command->Type = Type;
+        Command->Index = Index;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -791,6 +1177,15 @@ void CD3DX12AffinityGraphicsCommandList::EndQuery(
     D3D12_QUERY_TYPE Type,
     UINT Index)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_QUERY* Command = RecordCommand<D3DX12_RECORDED_QUERY>(EAffinityRecordedCommand::EndQuery, mAffinityMask);
+        Command->pQueryHeap = pQueryHeap;
+        Command->Type = Type;
+        Command->Index = Index;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -814,6 +1209,18 @@ void CD3DX12AffinityGraphicsCommandList::ResolveQueryData(
     CD3DX12AffinityResource* pDestinationBuffer,
     UINT64 AlignedDestinationBufferOffset)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_RESOLVE_QUERY_DATA* Command = RecordCommand<D3DX12_RECORDED_RESOLVE_QUERY_DATA>(EAffinityRecordedCommand::ResolveQueryData, mAffinityMask);
+        Command->pQueryHeap = pQueryHeap;
+        Command->Type = Type;
+        Command->StartIndex = StartIndex;
+        Command->NumQueries = NumQueries;
+        Command->pDestinationBuffer = pDestinationBuffer;
+        Command->AlignedDestinationBufferOffset = AlignedDestinationBufferOffset;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -838,6 +1245,15 @@ void CD3DX12AffinityGraphicsCommandList::SetPredication(
     UINT64 AlignedBufferOffset,
     D3D12_PREDICATION_OP Operation)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_PREDICATION* Command = RecordCommand<D3DX12_RECORDED_PREDICATION>(EAffinityRecordedCommand::SetPredication, mAffinityMask);
+        Command->pBuffer = pBuffer;
+        Command->AlignedBufferOffset = AlignedBufferOffset;
+        Command->Operation = Operation;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -857,6 +1273,17 @@ void CD3DX12AffinityGraphicsCommandList::SetMarker(
     const void* pData,
     UINT Size)
 {
+    if (mDeferredRecording)
+    {
+        UINT const RecordedSize = pData ? Size : 0;
+        D3DX12_RECORDED_EVENT* Command = RecordCommandWithArray<D3DX12_RECORDED_EVENT, BYTE>(EAffinityRecordedCommand::SetMarker, RecordedSize);
+        Command->Metadata = Metadata;
+        Command->Size = Size;
+        Command->HasData = pData != nullptr;
+        memcpy(GetRecordedArray<BYTE>(Command), pData, RecordedSize);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -876,6 +1303,17 @@ void CD3DX12AffinityGraphicsCommandList::BeginEvent(
     const void* pData,
     UINT Size)
 {
+    if (mDeferredRecording)
+    {
+        UINT const RecordedSize = pData ? Size : 0;
+        D3DX12_RECORDED_EVENT* Command = RecordCommandWithArray<D3DX12_RECORDED_EVENT, BYTE>(EAffinityRecordedCommand::BeginEvent, RecordedSize);
+        Command->Metadata = Metadata;
+        Command->Size = Size;
+        Command->HasData = pData != nullptr;
+        memcpy(GetRecordedArray<BYTE>(Command), pData, RecordedSize);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -892,6 +1330,12 @@ void CD3DX12AffinityGraphicsCommandList::BeginEvent(
 
 void CD3DX12AffinityGraphicsCommandList::EndEvent(void)
 {
+    if (mDeferredRecording)
+    {
+        mCommandStream.Allocate(static_cast<UINT16>(EAffinityRecordedCommand::EndEvent), mAffinityMask, 0);
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -911,6 +1355,18 @@ void CD3DX12AffinityGraphicsCommandList::ExecuteIndirect(
     CD3DX12AffinityResource* pCountBuffer,
     UINT64 CountBufferOffset)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_EXECUTE_INDIRECT* Command = RecordCommand<D3DX12_RECORDED_EXECUTE_INDIRECT>(EAffinityRecordedCommand::ExecuteIndirect, mAffinityMask);
+        Command->pCommandSignature = pCommandSignature;
+        Command->MaxCommandCount = MaxCommandCount;
+        Command->pArgumentBuffer = pArgumentBuffer;
+        Command->ArgumentBufferOffset = ArgumentBufferOffset;
+        Command->pCountBuffer = pCountBuffer;
+        Command->CountBufferOffset = CountBufferOffset;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -930,6 +1386,12 @@ CD3DX12AffinityGraphicsCommandList::CD3DX12AffinityGraphicsCommandList(CD3DX12Af
     : CD3DX12AffinityCommandList(device, reinterpret_cast<ID3D12CommandList**>(graphicsCommandLists), Count)
     , mUseDeviceActiveMaskOnReset(UseDeviceActiveMaskOnReset)
     , mAccumulatedAffinityMask(0)
+#ifdef D3DX12_DEFERRED_COMMAND_RECORDING
+    , mDeferredRecording(true)
+#else
+    , mDeferredRecording(false)
+#endif
+    , mReplayNodeMask(0)
 {
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES; i++)
     {
@@ -954,11 +1416,81 @@ CD3DX12AffinityGraphicsCommandList::CD3DX12AffinityGraphicsCommandList(CD3DX12Af
     {
         mAccumulatedAffinityMask = GetNodeMask();
     }
+
+    for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES; i++)
+    {
+        mReplayContexts[i].CommandList = this;
+        mReplayContexts[i].NodeIndex = i;
+        mReplayContexts[i].Work = nullptr;
+        mReplayContexts[i].CloseResult = S_OK;
+    }
+}
+
+CD3DX12AffinityGraphicsCommandList::~CD3DX12AffinityGraphicsCommandList()
+{
+    for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES; i++)
+    {
+        if (mReplayContexts[i].Work)
+        {
+            WaitForThreadpoolWorkCallbacks(mReplayContexts[i].Work, TRUE);
+            CloseThreadpoolWork(mReplayContexts[i].Work);
+        }
+    }
+}
+
+void CD3DX12AffinityGraphicsCommandList::SetDeferredRecording(bool Enable)
+{
+    WaitForReplay();
+    DEBUG_ASSERT(mCommandStream.IsEmpty());
+    mDeferredRecording = Enable;
+}
+
+bool CD3DX12AffinityGraphicsCommandList::IsDeferredRecording() const
+{
+    return mDeferredRecording;
+}
+
+HRESULT CD3DX12AffinityGraphicsCommandList::WaitForReplay()
+{
+    HRESULT Result = S_OK;
+
+    for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES; i++)
+    {
+        if (((1 << i) & mReplayNodeMask) != 0)
+        {
+            ReplayContext& Context = mReplayContexts[i];
+            if (Context.Work)
+            {
+                WaitForThreadpoolWorkCallbacks(Context.Work, FALSE);
+            }
+
+            if (S_OK == Result)
+            {
+                Result = Context.CloseResult;
+            }
+        }
+    }
+
+    mReplayNodeMask = 0;
+    mCommandStream.Reset();
+    return Result;
+}
+
+CD3DX12AffinityCommandStream const& CD3DX12AffinityGraphicsCommandList::GetCommandStream() const
+{
+    return mCommandStream;
 }
 
 void CD3DX12AffinityGraphicsCommandList::SetPipelineState(
     CD3DX12AffinityPipelineState* pPipelineState)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_PIPELINE_STATE* Command = RecordCommand<D3DX12_RECORDED_PIPELINE_STATE>(EAffinityRecordedCommand::SetPipelineState, mAffinityMask);
+        Command->pPipelineState = pPipelineState;
+        return;
+    }
+
     CD3DX12AffinityPipelineState* PipelineState = static_cast<CD3DX12AffinityPipelineState*>(pPipelineState);
 
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
@@ -976,6 +1508,14 @@ void CD3DX12AffinityGraphicsCommandList::SetComputeRootDescriptorTable(
     UINT RootParameterIndex,
     D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_DESCRIPTOR_TABLE* Command = RecordCommand<D3DX12_RECORDED_ROOT_DESCRIPTOR_TABLE>(EAffinityRecordedCommand::SetComputeRootDescriptorTable, mAffinityMask);
+        Command->RootParameterIndex = RootParameterIndex;
+        Command->BaseDescriptor = BaseDescriptor;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -991,6 +1531,14 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRootDescriptorTable(
     UINT RootParameterIndex,
     D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_ROOT_DESCRIPTOR_TABLE* Command = RecordCommand<D3DX12_RECORDED_ROOT_DESCRIPTOR_TABLE>(EAffinityRecordedCommand::SetGraphicsRootDescriptorTable, mAffinityMask);
+        Command->RootParameterIndex = RootParameterIndex;
+        Command->BaseDescriptor = BaseDescriptor;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -1005,6 +1553,17 @@ void CD3DX12AffinityGraphicsCommandList::SetGraphicsRootDescriptorTable(
 void CD3DX12AffinityGraphicsCommandList::IASetIndexBuffer(
     const D3D12_INDEX_BUFFER_VIEW* pView)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_INDEX_BUFFER* Command = RecordCommand<D3DX12_RECORDED_INDEX_BUFFER>(EAffinityRecordedCommand::IASetIndexBuffer, mAffinityMask);
+        Command->HasView = pView != nullptr;
+        if (pView)
+        {
+            Command->View = *pView;
+        }
+        return;
+    }
+
     if (pView)
     {
         D3D12_INDEX_BUFFER_VIEW View = *pView;
@@ -1040,6 +1599,17 @@ void CD3DX12AffinityGraphicsCommandList::DrawIndexedInstanced(
     INT BaseVertexLocation,
     UINT StartInstanceLocation)
 {
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_DRAW_INDEXED_INSTANCED* Command = RecordCommand<D3DX12_RECORDED_DRAW_INDEXED_INSTANCED>(EAffinityRecordedCommand::DrawIndexedInstanced, mAffinityMask);
+        Command->IndexCountPerInstance = IndexCountPerInstance;
+        Command->InstanceCount = InstanceCount;
+        Command->StartIndexLocation = StartIndexLocation;
+        Command->BaseVertexLocation = BaseVertexLocation;
+        Command->StartInstanceLocation = StartInstanceLocation;
+        return;
+    }
+
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
         if (((1 << i) & mAffinityMask) != 0)
@@ -1054,6 +1624,15 @@ void CD3DX12AffinityGraphicsCommandList::BroadcastResource(CD3DX12AffinityResour
     // The command list affinity must match the supplied source node
     DEBUG_ASSERT(mAffinityMask == (1 << NodeIndex));
 
+    if (mDeferredRecording)
+    {
+        D3DX12_RECORDED_BROADCAST_RESOURCE* Command = RecordCommand<D3DX12_RECORDED_BROADCAST_RESOURCE>(EAffinityRecordedCommand::BroadcastResource, 1 << NodeIndex);
+        Command->pResource = pResource;
+        Command->NodeIndex = NodeIndex;
+        Command->TargetNodeMask = TargetNodeMask;
+        return;
+    }
+
     // Copy is a push operation on the Source node commandlist to a target resource
     for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES;i++)
     {
@@ -1079,3 +1658,542 @@ UINT CD3DX12AffinityGraphicsCommandList::GetActiveAffinityMask()
 {
     return mAccumulatedAffinityMask;
 }
+
+void CD3DX12AffinityGraphicsCommandList::ReplayDeferredCommands(UINT CloseMask)
+{
+    // The stream is read only until WaitForReplay(), so every node translates, replays and
+    // closes its command list concurrently on the system thread pool. The recording thread
+    // does not replay any node itself, it only waits when the command list is executed or
+    // reset, which lets it record the next command list in the meantime.
+    mReplayNodeMask = CloseMask;
+
+    for (UINT i = 0; i < D3DX12_MAX_ACTIVE_NODES; i++)
+    {
+        if (((1 << i) & CloseMask) != 0)
+        {
+            ReplayContext& Context = mReplayContexts[i];
+            if (!Context.Work)
+            {
+                Context.Work = CreateThreadpoolWork(ReplayCommandsCallback, &Context, nullptr);
+            }
+
+            if (Context.Work)
+            {
+                SubmitThreadpoolWork(Context.Work);
+            }
+            else
+            {
+                ReplayCommands(Context);
+            }
+        }
+    }
+}
+
+void CALLBACK CD3DX12AffinityGraphicsCommandList::ReplayCommandsCallback(PTP_CALLBACK_INSTANCE Instance, PVOID Parameter, PTP_WORK Work)
+{
+    UNREFERENCED_PARAMETER(Instance);
+    UNREFERENCED_PARAMETER(Work);
+
+    ReplayContext* Context = static_cast<ReplayContext*>(Parameter);
+    Context->CommandList->ReplayCommands(*Context);
+}
+
+void CD3DX12AffinityGraphicsCommandList::ReplayCommands(ReplayContext& Context)
+{
+    UINT const i = Context.NodeIndex;
+    UINT const NodeBit = 1 << i;
+    ID3D12GraphicsCommandList* List = mGraphicsCommandLists[i];
+    CD3DX12AffinityDevice* Device = GetParentDevice();
+
+    if ((mCommandStream.GetAffinityMask() & NodeBit) == 0)
+    {
+        Context.CloseResult = List->Close();
+        return;
+    }
+
+    mCommandStream.ForEach([&](CD3DX12AffinityCommandStream::CommandHeader const& Header, void const* Payload)
+    {
+        if ((Header.AffinityMask & NodeBit) == 0)
+        {
+            return;
+        }
+
+        switch (static_cast<EAffinityRecordedCommand>(Header.Type))
+        {
+        case EAffinityRecordedCommand::ClearState:
+        {
+            D3DX12_RECORDED_PIPELINE_STATE const* Command = static_cast<D3DX12_RECORDED_PIPELINE_STATE const*>(Payload);
+            List->ClearState(Command->pPipelineState ? Command->pPipelineState->mPipelineStates[i] : nullptr);
+            break;
+        }
+        case EAffinityRecordedCommand::DrawInstanced:
+        {
+            D3DX12_RECORDED_DRAW_INSTANCED const* Command = static_cast<D3DX12_RECORDED_DRAW_INSTANCED const*>(Payload);
+            List->DrawInstanced(Command->VertexCountPerInstance, Command->InstanceCount, Command->StartVertexLocation, Command->StartInstanceLocation);
+            break;
+        }
+        case EAffinityRecordedCommand::DrawIndexedInstanced:
+        {
+            D3DX12_RECORDED_DRAW_INDEXED_INSTANCED const* Command = static_cast<D3DX12_RECORDED_DRAW_INDEXED_INSTANCED const*>(Payload);
+            List->DrawIndexedInstanced(Command->IndexCountPerInstance, Command->InstanceCount, Command->StartIndexLocation, Command->BaseVertexLocation, Command->StartInstanceLocation);
+            break;
+        }
+        case EAffinityRecordedCommand::Dispatch:
+        {
+            D3DX12_RECORDED_DISPATCH const* Command = static_cast<D3DX12_RECORDED_DISPATCH const*>(Payload);
+            List->Dispatch(Command->ThreadGroupCountX, Command->ThreadGroupCountY, Command->ThreadGroupCountZ);
+            break;
+        }
+        case EAffinityRecordedCommand::CopyBufferRegion:
+        {
+            D3DX12_RECORDED_COPY_BUFFER_REGION const* Command = static_cast<D3DX12_RECORDED_COPY_BUFFER_REGION const*>(Payload);
+            List->CopyBufferRegion(Command->pDstBuffer->mResources[i], Command->DstOffset, Command->pSrcBuffer->mResources[i], Command->SrcOffset, Command->NumBytes);
+            break;
+        }
+        case EAffinityRecordedCommand::CopyTextureRegion:
+        {
+            D3DX12_RECORDED_COPY_TEXTURE_REGION const* Command = static_cast<D3DX12_RECORDED_COPY_TEXTURE_REGION const*>(Payload);
+            D3D12_TEXTURE_COPY_LOCATION Dst = Command->Dst.ToD3D12();
+            D3D12_TEXTURE_COPY_LOCATION Src = Command->Src.ToD3D12();
+            Dst.pResource = Command->Dst.pResource->mResources[i];
+            Src.pResource = Command->Src.pResource->mResources[i];
+            List->CopyTextureRegion(&Dst, Command->DstX, Command->DstY, Command->DstZ, &Src, Command->HasSrcBox ? &Command->SrcBox : nullptr);
+            break;
+        }
+        case EAffinityRecordedCommand::CopyResource:
+        {
+            D3DX12_RECORDED_COPY_RESOURCE const* Command = static_cast<D3DX12_RECORDED_COPY_RESOURCE const*>(Payload);
+            List->CopyResource(Command->pDstResource->mResources[i], Command->pSrcResource->mResources[i]);
+            break;
+        }
+        case EAffinityRecordedCommand::CopyTiles:
+        {
+            D3DX12_RECORDED_COPY_TILES const* Command = static_cast<D3DX12_RECORDED_COPY_TILES const*>(Payload);
+            List->CopyTiles(
+                Command->pTiledResource->mResources[i],
+                &Command->TileRegionStartCoordinate,
+                &Command->TileRegionSize,
+                Command->pBuffer->mResources[i],
+                Command->BufferStartOffsetInBytes,
+                Command->Flags);
+            break;
+        }
+        case EAffinityRecordedCommand::ResolveSubresource:
+        {
+            D3DX12_RECORDED_RESOLVE_SUBRESOURCE const* Command = static_cast<D3DX12_RECORDED_RESOLVE_SUBRESOURCE const*>(Payload);
+            List->ResolveSubresource(Command->pDstResource->mResources[i], Command->DstSubresource, Command->pSrcResource->mResources[i], Command->SrcSubresource, Command->Format);
+            break;
+        }
+        case EAffinityRecordedCommand::IASetPrimitiveTopology:
+        {
+            D3DX12_RECORDED_PRIMITIVE_TOPOLOGY const* Command = static_cast<D3DX12_RECORDED_PRIMITIVE_TOPOLOGY const*>(Payload);
+            List->IASetPrimitiveTopology(Command->PrimitiveTopology);
+            break;
+        }
+        case EAffinityRecordedCommand::RSSetViewports:
+        {
+            D3DX12_RECORDED_ARRAY const* Command = static_cast<D3DX12_RECORDED_ARRAY const*>(Payload);
+            List->RSSetViewports(Command->Count, GetRecordedArray<D3D12_VIEWPORT>(Command));
+            break;
+        }
+        case EAffinityRecordedCommand::RSSetScissorRects:
+        {
+            D3DX12_RECORDED_ARRAY const* Command = static_cast<D3DX12_RECORDED_ARRAY const*>(Payload);
+            List->RSSetScissorRects(Command->Count, GetRecordedArray<D3D12_RECT>(Command));
+            break;
+        }
+        case EAffinityRecordedCommand::OMSetBlendFactor:
+        {
+            D3DX12_RECORDED_BLEND_FACTOR const* Command = static_cast<D3DX12_RECORDED_BLEND_FACTOR const*>(Payload);
+            List->OMSetBlendFactor(Command->HasBlendFactor ? Command->BlendFactor : nullptr);
+            break;
+        }
+        case EAffinityRecordedCommand::OMSetStencilRef:
+        {
+            D3DX12_RECORDED_STENCIL_REF const* Command = static_cast<D3DX12_RECORDED_STENCIL_REF const*>(Payload);
+            List->OMSetStencilRef(Command->StencilRef);
+            break;
+        }
+        case EAffinityRecordedCommand::SetPipelineState:
+        {
+            D3DX12_RECORDED_PIPELINE_STATE const* Command = static_cast<D3DX12_RECORDED_PIPELINE_STATE const*>(Payload);
+            List->SetPipelineState(Command->pPipelineState->mPipelineStates[i]);
+            break;
+        }
+        case EAffinityRecordedCommand::ResourceBarrier:
+        {
+            D3DX12_RECORDED_ARRAY const* Command = static_cast<D3DX12_RECORDED_ARRAY const*>(Payload);
+            D3DX12_AFFINITY_RESOURCE_BARRIER const* pBarriers = GetRecordedArray<D3DX12_AFFINITY_RESOURCE_BARRIER>(Command);
+
+            Context.ResourceBarriers.resize(Command->Count);
+            for (UINT b = 0; b < Command->Count; ++b)
+            {
+                D3D12_RESOURCE_BARRIER Use = pBarriers[b].ToD3D12();
+
+                switch (pBarriers[b].Type)
+                {
+                case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+                {
+                    if (pBarriers[b].Transition.pResource)
+                    {
+                        Use.Transition.pResource = pBarriers[b].Transition.pResource->mResources[i];
+                    }
+                    break;
+                }
+                case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+                {
+                    if (pBarriers[b].Aliasing.pResourceAfter)
+                    {
+                        Use.Aliasing.pResourceAfter = pBarriers[b].Aliasing.pResourceAfter->mResources[i];
+                    }
+                    if (pBarriers[b].Aliasing.pResourceBefore)
+                    {
+                        Use.Aliasing.pResourceBefore = pBarriers[b].Aliasing.pResourceBefore->mResources[i];
+                    }
+                    break;
+                }
+                case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+                {
+                    if (pBarriers[b].UAV.pResource)
+                    {
+                        Use.UAV.pResource = pBarriers[b].UAV.pResource->mResources[i];
+                    }
+                    break;
+                }
+                }
+
+                Context.ResourceBarriers[b] = Use;
+            }
+
+            List->ResourceBarrier(Command->Count, Context.ResourceBarriers.data());
+            break;
+        }
+        case EAffinityRecordedCommand::ExecuteBundle:
+        {
+            D3DX12_RECORDED_EXECUTE_BUNDLE const* Command = static_cast<D3DX12_RECORDED_EXECUTE_BUNDLE const*>(Payload);
+            List->ExecuteBundle(Command->pCommandList->mGraphicsCommandLists[i]);
+            break;
+        }
+        case EAffinityRecordedCommand::SetDescriptorHeaps:
+        {
+            D3DX12_RECORDED_ARRAY const* Command = static_cast<D3DX12_RECORDED_ARRAY const*>(Payload);
+            CD3DX12AffinityDescriptorHeap* const* ppDescriptorHeaps = GetRecordedArray<CD3DX12AffinityDescriptorHeap*>(Command);
+
+            Context.DescriptorHeaps.resize(Command->Count);
+            for (UINT h = 0; h < Command->Count; ++h)
+            {
+                Context.DescriptorHeaps[h] = ppDescriptorHeaps[h]->GetChildObject(i);
+            }
+
+            List->SetDescriptorHeaps(Command->Count, Context.DescriptorHeaps.data());
+            break;
+        }
+        case EAffinityRecordedCommand::SetComputeRootSignature:
+        {
+            D3DX12_RECORDED_ROOT_SIGNATURE const* Command = static_cast<D3DX12_RECORDED_ROOT_SIGNATURE const*>(Payload);
+            List->SetComputeRootSignature(Command->pRootSignature->mRootSignatures[i]);
+            break;
+        }
+        case EAffinityRecordedCommand::SetGraphicsRootSignature:
+        {
+            D3DX12_RECORDED_ROOT_SIGNATURE const* Command = static_cast<D3DX12_RECORDED_ROOT_SIGNATURE const*>(Payload);
+            List->SetGraphicsRootSignature(Command->pRootSignature->mRootSignatures[i]);
+            break;
+        }
+        case EAffinityRecordedCommand::SetComputeRootDescriptorTable:
+        {
+            D3DX12_RECORDED_ROOT_DESCRIPTOR_TABLE const* Command = static_cast<D3DX12_RECORDED_ROOT_DESCRIPTOR_TABLE const*>(Payload);
+            List->SetComputeRootDescriptorTable(Command->RootParameterIndex, Device->GetGPUHeapPointer(Command->BaseDescriptor, i));
+            break;
+        }
+        case EAffinityRecordedCommand::SetGraphicsRootDescriptorTable:
+        {
+            D3DX12_RECORDED_ROOT_DESCRIPTOR_TABLE const* Command = static_cast<D3DX12_RECORDED_ROOT_DESCRIPTOR_TABLE const*>(Payload);
+            List->SetGraphicsRootDescriptorTable(Command->RootParameterIndex, Device->GetGPUHeapPointer(Command->BaseDescriptor, i));
+            break;
+        }
+        case EAffinityRecordedCommand::SetComputeRoot32BitConstant:
+        {
+            D3DX12_RECORDED_ROOT_32BIT_CONSTANT const* Command = static_cast<D3DX12_RECORDED_ROOT_32BIT_CONSTANT const*>(Payload);
+            List->SetComputeRoot32BitConstant(Command->RootParameterIndex, Command->SrcData, Command->DestOffsetIn32BitValues);
+            break;
+        }
+        case EAffinityRecordedCommand::SetGraphicsRoot32BitConstant:
+        {
+            D3DX12_RECORDED_ROOT_32BIT_CONSTANT const* Command = static_cast<D3DX12_RECORDED_ROOT_32BIT_CONSTANT const*>(Payload);
+            List->SetGraphicsRoot32BitConstant(Command->RootParameterIndex, Command->SrcData, Command->DestOffsetIn32BitValues);
+            break;
+        }
+        case EAffinityRecordedCommand::SetComputeRoot32BitConstants:
+        {
+            D3DX12_RECORDED_ROOT_32BIT_CONSTANTS const* Command = static_cast<D3DX12_RECORDED_ROOT_32BIT_CONSTANTS const*>(Payload);
+            List->SetComputeRoot32BitConstants(Command->RootParameterIndex, Command->Num32BitValuesToSet, GetRecordedArray<UINT>(Command), Command->DestOffsetIn32BitValues);
+            break;
+        }
+        case EAffinityRecordedCommand::SetGraphicsRoot32BitConstants:
+        {
+            D3DX12_RECORDED_ROOT_32BIT_CONSTANTS const* Command = static_cast<D3DX12_RECORDED_ROOT_32BIT_CONSTANTS const*>(Payload);
+            List->SetGraphicsRoot32BitConstants(Command->RootParameterIndex, Command->Num32BitValuesToSet, GetRecordedArray<UINT>(Command), Command->DestOffsetIn32BitValues);
+            break;
+        }
+        case EAffinityRecordedCommand::SetComputeRootConstantBufferView:
+        {
+            D3DX12_RECORDED_ROOT_VIEW const* Command = static_cast<D3DX12_RECORDED_ROOT_VIEW const*>(Payload);
+            List->SetComputeRootConstantBufferView(Command->RootParameterIndex, Device->GetGPUVirtualAddress(Command->BufferLocation, i));
+            break;
+        }
+        case EAffinityRecordedCommand::SetGraphicsRootConstantBufferView:
+        {
+            D3DX12_RECORDED_ROOT_VIEW const* Command = static_cast<D3DX12_RECORDED_ROOT_VIEW const*>(Payload);
+            List->SetGraphicsRootConstantBufferView(Command->RootParameterIndex, Device->GetGPUVirtualAddress(Command->BufferLocation, i));
+            break;
+        }
+        case EAffinityRecordedCommand::SetComputeRootShaderResourceView:
+        {
+            D3DX12_RECORDED_ROOT_VIEW const* Command = static_cast<D3DX12_RECORDED_ROOT_VIEW const*>(Payload);
+            List->SetComputeRootShaderResourceView(Command->RootParameterIndex, Device->GetGPUVirtualAddress(Command->BufferLocation, i));
+            break;
+        }
+        case EAffinityRecordedCommand::SetGraphicsRootShaderResourceView:
+        {
+            D3DX12_RECORDED_ROOT_VIEW const* Command = static_cast<D3DX12_RECORDED_ROOT_VIEW const*>(Payload);
+            List->SetGraphicsRootShaderResourceView(Command->RootParameterIndex, Device->GetGPUVirtualAddress(Command->BufferLocation, i));
+            break;
+        }
+        case EAffinityRecordedCommand::SetComputeRootUnorderedAccessView:
+        {
+            D3DX12_RECORDED_ROOT_VIEW const* Command = static_cast<D3DX12_RECORDED_ROOT_VIEW const*>(Payload);
+            List->SetComputeRootUnorderedAccessView(Command->RootParameterIndex, Device->GetGPUVirtualAddress(Command->BufferLocation, i));
+            break;
+        }
+        case EAffinityRecordedCommand::SetGraphicsRootUnorderedAccessView:
+        {
+            D3DX12_RECORDED_ROOT_VIEW const* Command = static_cast<D3DX12_RECORDED_ROOT_VIEW const*>(Payload);
+            List->SetGraphicsRootUnorderedAccessView(Command->RootParameterIndex, Device->GetGPUVirtualAddress(Command->BufferLocation, i));
+            break;
+        }
+        case EAffinityRecordedCommand::IASetIndexBuffer:
+        {
+            D3DX12_RECORDED_INDEX_BUFFER const* Command = static_cast<D3DX12_RECORDED_INDEX_BUFFER const*>(Payload);
+            if (Command->HasView)
+            {
+                D3D12_INDEX_BUFFER_VIEW View = Command->View;
+                View.BufferLocation = Device->GetGPUVirtualAddress(Command->View.BufferLocation, i);
+                List->IASetIndexBuffer(&View);
+            }
+            else
+            {
+                List->IASetIndexBuffer(nullptr);
+            }
+            break;
+        }
+        case EAffinityRecordedCommand::IASetVertexBuffers:
+        {
+            D3DX12_RECORDED_BUFFER_VIEWS const* Command = static_cast<D3DX12_RECORDED_BUFFER_VIEWS const*>(Payload);
+            if (Command->HasViews)
+            {
+                D3D12_VERTEX_BUFFER_VIEW const* pViews = GetRecordedArray<D3D12_VERTEX_BUFFER_VIEW>(Command);
+
+                Context.BufferViews.resize(Command->NumViews);
+                for (UINT v = 0; v < Command->NumViews; ++v)
+                {
+                    Context.BufferViews[v] = pViews[v];
+                    Context.BufferViews[v].BufferLocation = Device->GetGPUVirtualAddress(pViews[v].BufferLocation, i);
+                }
+
+                List->IASetVertexBuffers(Command->StartSlot, Command->NumViews, Context.BufferViews.data());
+            }
+            else
+            {
+                List->IASetVertexBuffers(Command->StartSlot, Command->NumViews, nullptr);
+            }
+            break;
+        }
+        case EAffinityRecordedCommand::SOSetTargets:
+        {
+            D3DX12_RECORDED_BUFFER_VIEWS const* Command = static_cast<D3DX12_RECORDED_BUFFER_VIEWS const*>(Payload);
+            if (Command->HasViews)
+            {
+                D3D12_STREAM_OUTPUT_BUFFER_VIEW const* pViews = GetRecordedArray<D3D12_STREAM_OUTPUT_BUFFER_VIEW>(Command);
+
+                Context.StreamOutBufferViews.resize(Command->NumViews);
+                for (UINT v = 0; v < Command->NumViews; ++v)
+                {
+                    Context.StreamOutBufferViews[v] = pViews[v];
+                    Context.StreamOutBufferViews[v].BufferLocation = Device->GetGPUVirtualAddress(pViews[v].BufferLocation, i);
+                    Context.StreamOutBufferViews[v].BufferFilledSizeLocation = Device->GetGPUVirtualAddress(pViews[v].BufferFilledSizeLocation, i);
+                }
+
+                List->SOSetTargets(Command->StartSlot, Command->NumViews, Context.StreamOutBufferViews.data());
+            }
+            else
+            {
+                List->SOSetTargets(Command->StartSlot, Command->NumViews, nullptr);
+            }
+            break;
+        }
+        case EAffinityRecordedCommand::OMSetRenderTargets:
+        {
+            D3DX12_RECORDED_RENDER_TARGETS const* Command = static_cast<D3DX12_RECORDED_RENDER_TARGETS const*>(Payload);
+            D3D12_CPU_DESCRIPTOR_HANDLE const* pRenderTargetDescriptors = GetRecordedArray<D3D12_CPU_DESCRIPTOR_HANDLE>(Command);
+
+            Context.RenderTargetViews.resize(Command->NumRecordedDescriptors);
+            for (UINT r = 0; r < Command->NumRecordedDescriptors; ++r)
+            {
+                Context.RenderTargetViews[r] = Device->GetCPUHeapPointer(pRenderTargetDescriptors[r], i);
+            }
+
+            if (Command->HasDepthStencilDescriptor)
+            {
+                D3D12_CPU_DESCRIPTOR_HANDLE ActualDepthStencilDescriptor = Device->GetCPUHeapPointer(Command->DepthStencilDescriptor, i);
+                List->OMSetRenderTargets(Command->NumRenderTargetDescriptors, Context.RenderTargetViews.data(), Command->RTsSingleHandleToDescriptorRange, &ActualDepthStencilDescriptor);
+            }
+            else
+            {
+                List->OMSetRenderTargets(Command->NumRenderTargetDescriptors, Context.RenderTargetViews.data(), Command->RTsSingleHandleToDescriptorRange, nullptr);
+            }
+            break;
+        }
+        case EAffinityRecordedCommand::ClearDepthStencilView:
+        {
+            D3DX12_RECORDED_CLEAR_DEPTH_STENCIL const* Command = static_cast<D3DX12_RECORDED_CLEAR_DEPTH_STENCIL const*>(Payload);
+            List->ClearDepthStencilView(
+                Device->GetCPUHeapPointer(Command->DepthStencilView, i),
+                Command->ClearFlags, Command->Depth, Command->Stencil,
+                Command->NumRects, Command->NumRects ? GetRecordedArray<D3D12_RECT>(Command) : nullptr);
+            break;
+        }
+        case EAffinityRecordedCommand::ClearRenderTargetView:
+        {
+            D3DX12_RECORDED_CLEAR_RENDER_TARGET const* Command = static_cast<D3DX12_RECORDED_CLEAR_RENDER_TARGET const*>(Payload);
+#ifdef D3DX12_DEBUG_CLEAR_WHITE
+            FLOAT White[4] = { 1, 1, 1, 1 };
+            FLOAT const* ColorRGBA = White;
+#else
+            FLOAT const* ColorRGBA = Command->ColorRGBA;
+#endif
+            List->ClearRenderTargetView(
+                Device->GetCPUHeapPointer(Command->RenderTargetView, i), ColorRGBA,
+                Command->NumRects, Command->NumRects ? GetRecordedArray<D3D12_RECT>(Command) : nullptr);
+            break;
+        }
+        case EAffinityRecordedCommand::ClearUnorderedAccessViewUint:
+        {
+            D3DX12_RECORDED_CLEAR_UNORDERED_ACCESS_VIEW const* Command = static_cast<D3DX12_RECORDED_CLEAR_UNORDERED_ACCESS_VIEW const*>(Payload);
+            List->ClearUnorderedAccessViewUint(
+                Device->GetGPUHeapPointer(Command->ViewGPUHandleInCurrentHeap, i),
+                Device->GetCPUHeapPointer(Command->ViewCPUHandle, i),
+                Command->pResource->mResources[i], Command->Values.Uint,
+                Command->NumRects, Command->NumRects ? GetRecordedArray<D3D12_RECT>(Command) : nullptr);
+            break;
+        }
+        case EAffinityRecordedCommand::ClearUnorderedAccessViewFloat:
+        {
+            D3DX12_RECORDED_CLEAR_UNORDERED_ACCESS_VIEW const* Command = static_cast<D3DX12_RECORDED_CLEAR_UNORDERED_ACCESS_VIEW const*>(Payload);
+            List->ClearUnorderedAccessViewFloat(
+                Device->GetGPUHeapPointer(Command->ViewGPUHandleInCurrentHeap, i),
+                Device->GetCPUHeapPointer(Command->ViewCPUHandle, i),
+                Command->pResource->mResources[i], Command->Values.Float,
+                Command->NumRects, Command->NumRects ? GetRecordedArray<D3D12_RECT>(Command) : nullptr);
+            break;
+        }
+        case EAffinityRecordedCommand::DiscardResource:
+        {
+            D3DX12_RECORDED_DISCARD_RESOURCE const* Command = static_cast<D3DX12_RECORDED_DISCARD_RESOURCE const*>(Payload);
+            if (Command->HasRegion)
+            {
+                D3D12_DISCARD_REGION Region = Command->Region;
+                Region.pRects = Region.NumRects ? GetRecordedArray<D3D12_RECT>(Command) : nullptr;
+                List->DiscardResource(Command->pResource->mResources[i], &Region);
+            }
+            else
+            {
+                List->DiscardResource(Command->pResource->mResources[i], nullptr);
+            }
+            break;
+        }
+        case EAffinityRecordedCommand::BeginQuery:
+        {
+            D3DX12_RECORDED_QUERY const* Command = static_cast<D3DX12_RECORDED_QUERY const*>(Payload);
+            List->BeginQuery(Command->pQueryHeap->mQueryHeaps[i], Command->Type, Command->Index);
+            break;
+        }
+        case EAffinityRecordedCommand::EndQuery:
+        {
+            D3DX12_RECORDED_QUERY const* Command = static_cast<D3DX12_RECORDED_QUERY const*>(Payload);
+            List->EndQuery(Command->pQueryHeap->mQueryHeaps[i], Command->Type, Command->Index);
+            break;
+        }
+        case EAffinityRecordedCommand::ResolveQueryData:
+        {
+            D3DX12_RECORDED_RESOLVE_QUERY_DATA const* Command = static_cast<D3DX12_RECORDED_RESOLVE_QUERY_DATA const*>(Payload);
+            List->ResolveQueryData(
+                Command->pQueryHeap->mQueryHeaps[i],
+                Command->Type,
+                Command->StartIndex,
+                Command->NumQueries,
+                Command->pDestinationBuffer->mResources[i],
+                Command->AlignedDestinationBufferOffset);
+            break;
+        }
+        case EAffinityRecordedCommand::SetPredication:
+        {
+            D3DX12_RECORDED_PREDICATION const* Command = static_cast<D3DX12_RECORDED_PREDICATION const*>(Payload);
+            List->SetPredication(
+                Command->pBuffer ? Command->pBuffer->mResources[i] : nullptr,
+                Command->AlignedBufferOffset,
+                Command->Operation);
+            break;
+        }
+        case EAffinityRecordedCommand::SetMarker:
+        {
+            D3DX12_RECORDED_EVENT const* Command = static_cast<D3DX12_RECORDED_EVENT const*>(Payload);
+            List->SetMarker(Command->Metadata, Command->HasData ? GetRecordedArray<BYTE>(Command) : nullptr, Command->Size);
+            break;
+        }
+        case EAffinityRecordedCommand::BeginEvent:
+        {
+            D3DX12_RECORDED_EVENT const* Command = static_cast<D3DX12_RECORDED_EVENT const*>(Payload);
+            List->BeginEvent(Command->Metadata, Command->HasData ? GetRecordedArray<BYTE>(Command) : nullptr, Command->Size);
+            break;
+        }
+        case EAffinityRecordedCommand::EndEvent:
+        {
+            List->EndEvent();
+            break;
+        }
+        case EAffinityRecordedCommand::ExecuteIndirect:
+        {
+            D3DX12_RECORDED_EXECUTE_INDIRECT const* Command = static_cast<D3DX12_RECORDED_EXECUTE_INDIRECT const*>(Payload);
+            List->ExecuteIndirect(
+                Command->pCommandSignature->GetChildObject(i),
+                Command->MaxCommandCount,
+                Command->pArgumentBuffer->mResources[i], Command->ArgumentBufferOffset,
+                Command->pCountBuffer ? Command->pCountBuffer->mResources[i] : nullptr, Command->CountBufferOffset);
+            break;
+        }
+        case EAffinityRecordedCommand::BroadcastResource:
+        {
+            // Recorded with the affinity of the source node only, see BroadcastResource().
+            D3DX12_RECORDED_BROADCAST_RESOURCE const* Command = static_cast<D3DX12_RECORDED_BROADCAST_RESOURCE const*>(Payload);
+            for (UINT t = 0; t < D3DX12_MAX_ACTIVE_NODES; t++)
+            {
+                if (((1 << t) & Command->TargetNodeMask) != 0 && t != Command->NodeIndex)
+                {
+                    List->CopyResource(
+                        Command->pResource->GetChildObject(t),
+                        Command->pResource->GetChildObject(Command->NodeIndex));
+                }
+            }
+            break;
+        }
+        default:
+        {
+            DEBUG_ASSERT(false);
+            break;
+        }
+        }
+    });
+
+    Context.CloseResult = List->Close();
+}
@@ -15,6 +15,9 @@
 #include "CD3DX12AffinityCommandList.h"
 #include "CD3DX12AffinityQueryHeap.h"
 #include "CD3DX12AffinityDevice.h"
+#include "CD3DX12AffinityCommandStream.h"
+
+enum class EAffinityRecordedCommand : UINT16;
 
 class __declspec(uuid("BE1D71C8-88FD-4623-ABFA-D0E546D12FAF")) CD3DX12AffinityGraphicsCommandList : public CD3DX12AffinityCommandList
 {
@@ -275,6 +278,24 @@ public:
     void BroadcastResource(CD3DX12AffinityResource* pResource, UINT NodeIndex, UINT TargetNodeMask);
 
     CD3DX12AffinityGraphicsCommandList(CD3DX12AffinityDevice* device, ID3D12GraphicsCommandList** graphicsCommandLists, UINT Count, bool UseDeviceActiveMaskOnReset);
+    ~CD3DX12AffinityGraphicsCommandList();
+
+    // When deferred recording is enabled, calls are recorded once (without any per node
+    // translation) and, at Close(), replayed onto the command list of every node in parallel
+    // on the system thread pool. Close() returns without waiting for the replay, so it can't
+    // return the result of the native Close() calls: ExecuteCommandLists() reports a command
+    // list that failed to close and skips it.
+    // Can only be changed while the command list is closed or has nothing recorded.
+    void SetDeferredRecording(bool Enable);
+    bool IsDeferredRecording() const;
+
+    // Waits until the replay started by Close() has closed the command list of every node,
+    // and returns the first error of those Close() calls. ExecuteCommandLists(), ExecuteBundle()
+    // and Reset() already wait, so it is only needed before using the native command lists
+    // directly.
+    HRESULT WaitForReplay();
+
+    CD3DX12AffinityCommandStream const& GetCommandStream() const;
 
     ID3D12GraphicsCommandList* GetChildObject(UINT AffinityIndex);
     UINT GetActiveAffinityMask();
@@ -288,4 +309,33 @@ private:
     std::vector<D3D12_VERTEX_BUFFER_VIEW> mCachedBufferViews;
     std::vector<D3D12_STREAM_OUTPUT_BUFFER_VIEW> mCachedStreamOutBufferViews;
     std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> mCachedRenderTargetViews;
+
+    // Deferred recording
+    struct ReplayContext
+    {
+        CD3DX12AffinityGraphicsCommandList* CommandList;
+        UINT NodeIndex;
+        PTP_WORK Work;
+        HRESULT CloseResult;
+        std::vector<D3D12_RESOURCE_BARRIER> ResourceBarriers;
+        std::vector<ID3D12DescriptorHeap*> DescriptorHeaps;
+        std::vector<D3D12_VERTEX_BUFFER_VIEW> BufferViews;
+        std::vector<D3D12_STREAM_OUTPUT_BUFFER_VIEW> StreamOutBufferViews;
+        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> RenderTargetViews;
+    };
+
+    bool mDeferredRecording;
+    CD3DX12AffinityCommandStream mCommandStream;
+    ReplayContext mReplayContexts[D3DX12_MAX_ACTIVE_NODES];
+    UINT mReplayNodeMask;
+
+    template <typename PayloadType>
+    PayloadType* RecordCommand(EAffinityRecordedCommand Type, UINT AffinityMask);
+
+    template <typename PayloadType, typename ElementType>
+    PayloadType* RecordCommandWithArray(EAffinityRecordedCommand Type, UINT Count);
+
+    void ReplayDeferredCommands(UINT CloseMask);
+    void ReplayCommands(ReplayContext& Context);
+    static void CALLBACK ReplayCommandsCallback(PTP_CALLBACK_INSTANCE Instance, PVOID Parameter, PTP_WORK Work);
 };
@@ -0,0 +1,187 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Checks the command stream that deferred command lists record into: payloads are aligned,
+// commands are visited in recording order across chunks, oversized commands get a chunk of
+// their own, Reset() reuses the chunks, and the stream tracks the union of the affinity masks.
+
+#include "stdafx.h"
+#include "CD3DX12AffinityCommandStream.h"
+
+using namespace std;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace
+{
+    // A small chunk size, so that a few commands span several chunks.
+    SIZE_T const TestChunkSize = 256;
+
+    // Records a command whose payload is Size bytes, each set to Value.
+    void* Record(CD3DX12AffinityCommandStream& Stream, UINT16 Type, UINT AffinityMask, SIZE_T Size, BYTE Value)
+    {
+        void* Payload = Stream.Allocate(Type, AffinityMask, Size);
+        memset(Payload, Value, Size);
+        return Payload;
+    }
+
+    struct VisitedCommand
+    {
+        UINT16 Type;
+        UINT AffinityMask;
+        UINT Size;
+        void const* Payload;
+    };
+
+    vector<VisitedCommand> Visit(CD3DX12AffinityCommandStream const& Stream)
+    {
+        vector<VisitedCommand> Commands;
+        Stream.ForEach([&](CD3DX12AffinityCommandStream::CommandHeader const& Header, void const* Payload)
+        {
+            Commands.push_back({ Header.Type, Header.AffinityMask, Header.Size, Payload });
+        });
+        return Commands;
+    }
+}
+
+namespace D3DX12AffinityLayerTests
+{
+    TEST_CLASS(CommandStreamTests)
+    {
+    public:
+        TEST_METHOD(EmptyStream)
+        {
+            CD3DX12AffinityCommandStream Stream;
+            Assert::IsTrue(Stream.IsEmpty());
+            Assert::AreEqual(0u, Stream.GetCommandCount());
+            Assert::AreEqual(SIZE_T(0), Stream.GetSizeInBytes());
+            Assert::AreEqual(0u, Stream.GetAffinityMask());
+            Assert::AreEqual(size_t(0), Visit(Stream).size());
+        }
+
+        TEST_METHOD(PayloadsAreAligned)
+        {
+            CD3DX12AffinityCommandStream Stream(TestChunkSize);
+            SIZE_T ExpectedSize = 0;
+            for (UINT16 Size = 0; Size <= 40; ++Size)
+            {
+                void* Payload = Record(Stream, Size, 1, Size, BYTE(Size));
+                Assert::AreEqual(SIZE_T(0), reinterpret_cast<SIZE_T>(Payload) % CD3DX12AffinityCommandStream::Alignment);
+                ExpectedSize += (sizeof(CD3DX12AffinityCommandStream::CommandHeader) + Size + CD3DX12AffinityCommandStream::Alignment - 1) & ~(CD3DX12AffinityCommandStream::Alignment - 1);
+            }
+
+            Assert::AreEqual(41u, Stream.GetCommandCount());
+            Assert::AreEqual(ExpectedSize, Stream.GetSizeInBytes());
+            for (VisitedCommand const& Command : Visit(Stream))
+            {
+                Assert::AreEqual(SIZE_T(0), SIZE_T(Command.Size) % CD3DX12AffinityCommandStream::Alignment);
+                Assert::IsTrue(Command.Size >= sizeof(CD3DX12AffinityCommandStream::CommandHeader) + Command.Type);
+            }
+        }
+
+        TEST_METHOD(CommandsAreVisitedInRecordingOrder)
+        {
+            CD3DX12AffinityCommandStream Stream(TestChunkSize);
+            UINT const CommandCount = 100;
+            for (UINT c = 0; c < CommandCount; ++c)
+            {
+                Record(Stream, UINT16(c), 1u << (c % 2), 8 + (c % 5) * 8, BYTE(c));
+            }
+
+            vector<VisitedCommand> Commands = Visit(Stream);
+            Assert::AreEqual(size_t(CommandCount), Commands.size());
+            for (UINT c = 0; c < CommandCount; ++c)
+            {
+                Assert::AreEqual(UINT16(c), Commands[c].Type);
+                Assert::AreEqual(1u << (c % 2), Commands[c].AffinityMask);
+
+                BYTE const* Payload = static_cast<BYTE const*>(Commands[c].Payload);
+                for (UINT b = 0; b < 8 + (c % 5) * 8; ++b)
+                {
+                    Assert::AreEqual(BYTE(c), Payload[b]);
+                }
+            }
+        }
+
+        TEST_METHOD(OversizedCommandGetsItsOwnChunk)
+        {
+            CD3DX12AffinityCommandStream Stream(TestChunkSize);
+            Record(Stream, 0, 1, 16, 0xA0);
+            Record(Stream, 1, 1, TestChunkSize * 4, 0xA1);
+            Record(Stream, 2, 1, 16, 0xA2);
+
+            vector<VisitedCommand> Commands = Visit(Stream);
+            Assert::AreEqual(size_t(3), Commands.size());
+            for (UINT c = 0; c < 3; ++c)
+            {
+                Assert::AreEqual(UINT16(c), Commands[c].Type);
+                Assert::AreEqual(BYTE(0xA0 + c), *static_cast<BYTE const*>(Commands[c].Payload));
+            }
+            Assert::AreEqual(BYTE(0xA1), static_cast<BYTE const*>(Commands[1].Payload)[TestChunkSize * 4 - 1]);
+        }
+
+        TEST_METHOD(ResetReusesChunks)
+        {
+            CD3DX12AffinityCommandStream Stream(TestChunkSize);
+            vector<void*> FirstPayloads;
+            for (UINT c = 0; c < 50; ++c)
+            {
+                FirstPayloads.push_back(Record(Stream, UINT16(c), 3, 24, BYTE(c)));
+            }
+
+            Stream.Reset();
+            Assert::IsTrue(Stream.IsEmpty());
+            Assert::AreEqual(SIZE_T(0), Stream.GetSizeInBytes());
+            Assert::AreEqual(0u, Stream.GetAffinityMask());
+            Assert::AreEqual(size_t(0), Visit(Stream).size());
+
+            // Recording the same commands again lands them at the same addresses.
+            for (UINT c = 0; c < 50; ++c)
+            {
+                Assert::IsTrue(FirstPayloads[c] == Record(Stream, UINT16(c + 100), 3, 24, BYTE(c + 100)));
+            }
+
+            vector<VisitedCommand> Commands = Visit(Stream);
+            Assert::AreEqual(size_t(50), Commands.size());
+            for (UINT c = 0; c < 50; ++c)
+            {
+                Assert::AreEqual(UINT16(c + 100), Commands[c].Type);
+            }
+        }
+
+        TEST_METHOD(ShorterRecordingAfterResetOnlyVisitsNewCommands)
+        {
+            CD3DX12AffinityCommandStream Stream(TestChunkSize);
+            for (UINT c = 0; c < 50; ++c)
+            {
+                Record(Stream, UINT16(c), 1, 24, BYTE(c));
+            }
+
+            Stream.Reset();
+            Record(Stream, 7, 2, 24, 7);
+
+            vector<VisitedCommand> Commands = Visit(Stream);
+            Assert::AreEqual(size_t(1), Commands.size());
+            Assert::AreEqual(UINT16(7), Commands[0].Type);
+            Assert::AreEqual(2u, Commands[0].AffinityMask);
+        }
+
+        TEST_METHOD(AffinityMaskIsTheUnionOfTheCommands)
+        {
+            CD3DX12AffinityCommandStream Stream;
+            Record(Stream, 0, 1, 4, 0);
+            Assert::AreEqual(1u, Stream.GetAffinityMask());
+            Record(Stream, 0, 1, 4, 0);
+            Assert::AreEqual(1u, Stream.GetAffinityMask());
+            Record(Stream, 0, 2, 4, 0);
+            Assert::AreEqual(3u, Stream.GetAffinityMask());
+        }
+    };
+}
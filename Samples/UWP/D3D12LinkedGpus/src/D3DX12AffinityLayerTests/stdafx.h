@@ -0,0 +1,59 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Unit tests and benchmarks for the affinity layer, run against the mock device in MockDevice.h
+// so that they need neither a GPU nor linked adapters.
+// Run them from Test Explorer or with vstest.console.exe D3DX12AffinityLayerTests.dll. The benchmarks
+// are in the "Benchmark" category and only log their timings, so exclude them
+// (/TestCaseFilter:"TestCategory!=Benchmark") for a quick run, and measure with the Release configuration.
+
+#pragma once
+
+#include "targetver.h"
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers.
+#endif
+
+#include <windows.h>
+
+// C RunTime Header Files
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "d3dx12affinity.h"
+
+// Headers for CppUnitTest
+#include "CppUnitTest.h"
+
+// Seconds since an arbitrary point, for the benchmarks
+inline double BenchmarkTime()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Logs one line of a benchmark (or test) report to the test output
+inline void LogMessage(const char* format, ...)
+{
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer) - 1, format, args);
+    va_end(args);
+    strcat_s(buffer, "\n");
+    Microsoft::VisualStudio::CppUnitTestFramework::Logger::WriteMessage(buffer);
+}
@@ -29,6 +29,21 @@ public:
         return m_zoom;
     }
 
+    inline void SetZoom(float zoom)
+    {
+        m_zoom = zoom;
+    }
+
+    inline PointF GetPosition() const
+    {
+        return m_position;
+    }
+
+    inline void SetPosition(PointF position)
+    {
+        m_position = position;
+    }
+
     XMMATRIX GetViewProjectionMatrix() const;
     RectF GenerateViewportBounds() const;
 
@@ -37,6 +37,45 @@
 //
 #define PREFETCH_DISTANCE 600.0f
 
+//
+// The change in screen coverage required before an image is resubmitted to the paging
+// thread for reprioritization. This keeps small camera movements from flooding the
+// paging thread with submissions that would not change the paging order.
+//
+#define COVERAGE_REPRIORITIZE_THRESHOLD 0.01f
+
+//
+// A keyframe of the scripted camera path. The horizontal position is normalized to the
+// extent of the image grid, so the same path covers every image regardless of how many
+// texture assets are present.
+//
+struct CameraPathKey
+{
+    float Time;
+    float X;
+    float Y;
+    float Zoom;
+};
+
+//
+// The scripted camera path, played back with 'p'. It pans across the image grid at
+// several zoom levels, including fast flyovers and deep zooms into single images, which
+// exercise both prefetching and the visible mipmap priorities of the paging thread.
+//
+static const CameraPathKey CameraPath[] =
+{
+    {  0.0f, 0.00f,    0.0f, 0.6f },
+    {  4.0f, 0.25f,    0.0f, 0.6f },
+    {  6.0f, 0.25f,    0.0f, 4.0f },
+    {  9.0f, 0.40f, -132.0f, 4.0f },
+    { 11.0f, 0.40f,    0.0f, 0.2f },
+    { 13.0f, 1.00f,    0.0f, 0.2f },
+    { 15.0f, 1.00f,  132.0f, 2.0f },
+    { 17.0f, 0.60f,  132.0f, 2.0f },
+    { 18.0f, 0.10f,    0.0f, 0.8f },
+    { 22.0f, 0.00f,    0.0f, 0.6f },
+};
+
 //
 // Helper function to calculate an average for a numbe rof statistic points.
 //
@@ -104,6 +143,7 @@ void InitializeImage(Image* pImage, Resource* pResource, UINT32 ImageIndex)
 
     pImage->pResource = pResource;
     pImage->Bounds = DestRect;
+    pImage->PopInStartTick = 0;
 }
 
 D3D12MemoryManagement::D3D12MemoryManagement()
@@ -355,6 +395,10 @@ bool D3D12MemoryManagement::HandleMessage(HWND hwnd, UINT Message, WPARAM wParam
             {
                 m_bDrawMipColors = !m_bDrawMipColors;
             }
+            else if (wParam == GetVirtualKeyFromCharacter('p')) // Play camera 'p'ath.
+            {
+                StartCameraPath();
+            }
             else if (wParam == GetVirtualKeyFromCharacter('v')) // Toggle 'v'sync.
             {
                 m_bPresentOnVsync = !m_bPresentOnVsync;
@@ -485,7 +529,12 @@ bool D3D12MemoryManagement::HandleMessage(HWND hwnd, UINT Message, WPARAM wParam
     return false;
 }
 
-void D3D12MemoryManagement::CalculateImagePagingData(const RectF* pViewportBounds, const Image* pImage, UINT8* pVisibleMip, UINT8* pPrefetchMip)
+void D3D12MemoryManagement::CalculateImagePagingData(
+    const RectF* pViewportBounds,
+    const Image* pImage,
+    UINT8* pVisibleMip,
+    UINT8* pPrefetchMip,
+    float* pScreenCoverage)
 {
     float ImageScale = (pImage->Bounds.Right - pImage->Bounds.Left) * m_pSceneCamera->GetZoom();
     UINT8 RequiredMip = (UINT8)CalculateRequiredMipLevel(pImage->pResource, ImageScale);
@@ -520,12 +569,151 @@ void D3D12MemoryManagement::CalculateImagePagingData(const RectF* pViewportBound
         PrefetchMip = UNDEFINED_MIPMAP_INDEX;
     }
 
+    //
+    // The fraction of the viewport covered by the image orders the paging operations within
+    // each priority. Images that take up most of the screen are the most noticeable when they
+    // are blurry, so they are streamed in first.
+    //
+    float ScreenCoverage = 0.0f;
+    if (IsVisible)
+    {
+        float Width = min(pViewportBounds->Right, pImage->Bounds.Right) - max(pViewportBounds->Left, pImage->Bounds.Left);
+        float Height = min(pViewportBounds->Bottom, pImage->Bounds.Bottom) - max(pViewportBounds->Top, pImage->Bounds.Top);
+        float ViewportArea = (pViewportBounds->Right - pViewportBounds->Left) * (pViewportBounds->Bottom - pViewportBounds->Top);
+
+        if (ViewportArea > 0.0f)
+        {
+            ScreenCoverage = min((Width * Height) / ViewportArea, 1.0f);
+        }
+    }
+
     *pVisibleMip = VisibleMip;
     *pPrefetchMip = PrefetchMip;
+    *pScreenCoverage = ScreenCoverage;
+}
+
+void D3D12MemoryManagement::StartCameraPath()
+{
+    LARGE_INTEGER CurrentTick;
+    QueryPerformanceCounter(&CurrentTick);
+
+    m_bPlayingCameraPath = true;
+    m_CameraPathStartTick = CurrentTick.QuadPart;
+    ZeroMemory(&m_PopInStats, sizeof(m_PopInStats));
+
+    for (auto& Img : m_Images)
+    {
+        Img.PopInStartTick = 0;
+    }
+
+    //
+    // Always measure with the viewport camera as the scene camera, so the results are
+    // comparable between runs.
+    //
+    m_pSceneCamera = &m_ViewportCamera;
+    m_pCapturedCamera = &m_ViewportCamera;
+}
+
+void D3D12MemoryManagement::UpdateCameraPath(LONGLONG CurrentTick)
+{
+    if (!m_bPlayingCameraPath || m_Images.empty())
+    {
+        return;
+    }
+
+    float Time = (float)((CurrentTick - m_CameraPathStartTick) / (double)m_PerformanceFrequency.QuadPart);
+
+    const CameraPathKey& LastKey = CameraPath[_countof(CameraPath) - 1];
+    if (Time >= LastKey.Time)
+    {
+        m_bPlayingCameraPath = false;
+
+        float AverageSeconds = m_PopInStats.Count ? m_PopInStats.TotalSeconds / m_PopInStats.Count : 0.0f;
+        LOG_MESSAGE(
+            "Camera path complete: %d pop-ins, average latency %.2fms, maximum latency %.2fms",
+            m_PopInStats.Count,
+            AverageSeconds * 1000.0f,
+            m_PopInStats.MaxSeconds * 1000.0f);
+
+        Time = LastKey.Time;
+    }
+
+    UINT Key = 0;
+    while (Key + 2 < _countof(CameraPath) && CameraPath[Key + 1].Time <= Time)
+    {
+        ++Key;
+    }
+
+    const CameraPathKey& A = CameraPath[Key];
+    const CameraPathKey& B = CameraPath[Key + 1];
+    float t = min(max((Time - A.Time) / (B.Time - A.Time), 0.0f), 1.0f);
+
+    //
+    // The image grid extends to the right of the origin, one column every few images.
+    //
+    float GridLeft = m_Images.front().Bounds.Left;
+    float GridRight = m_Images.back().Bounds.Right;
+
+    PointF Position;
+    Position.X = GridLeft + (GridRight - GridLeft) * (A.X + (B.X - A.X) * t);
+    Position.Y = A.Y + (B.Y - A.Y) * t;
+
+    //
+    // Zoom is interpolated geometrically, so zooming in and out appear to move at a
+    // constant rate.
+    //
+    float Zoom = A.Zoom * powf(B.Zoom / A.Zoom, t);
+
+    m_ViewportCamera.SetPosition(Position);
+    m_ViewportCamera.SetZoom(Zoom);
+}
+
+void D3D12MemoryManagement::UpdatePopInStatistics(Image* pImage, LONGLONG CurrentTick)
+{
+    Resource* pResource = pImage->pResource;
+
+    if (!m_bPlayingCameraPath || pResource->VisibleMip == UNDEFINED_MIPMAP_INDEX)
+    {
+        //
+        // Statistics are only gathered while the camera path plays. An image that leaves the
+        // view while it is still blurry never popped in, so its wait is discarded.
+        //
+        pImage->PopInStartTick = 0;
+        return;
+    }
+
+    bool IsBlurry = IsMoreDetailedMip(pResource->MostDetailedMipResident, pResource->VisibleMip);
+
+    if (IsBlurry)
+    {
+        if (pImage->PopInStartTick == 0)
+        {
+            pImage->PopInStartTick = CurrentTick;
+        }
+    }
+    else if (pImage->PopInStartTick != 0)
+    {
+        //
+        // The requested mipmap became resident. Record how long the image was displayed at
+        // lower detail.
+        //
+        float Latency = (float)((CurrentTick - pImage->PopInStartTick) / (double)m_PerformanceFrequency.QuadPart);
+
+        ++m_PopInStats.Count;
+        m_PopInStats.TotalSeconds += Latency;
+        m_PopInStats.MaxSeconds = max(m_PopInStats.MaxSeconds, Latency);
+
+        pImage->PopInStartTick = 0;
+    }
 }
 
 HRESULT D3D12MemoryManagement::RenderScene(const RectF& ViewportBounds)
 {
+    LARGE_INTEGER CurrentTick;
+    QueryPerformanceCounter(&CurrentTick);
+
+    UpdateCameraPath(CurrentTick.QuadPart);
+
     RectF SceneBounds = m_pSceneCamera->GenerateViewportBounds();
 
     for (auto& Img : m_Images)
@@ -537,19 +725,26 @@ HRESULT D3D12MemoryManagement::RenderScene(const RectF& ViewportBounds)
         //
         UINT8 VisibleMip;
         UINT8 PrefetchMip;
-        CalculateImagePagingData(&SceneBounds, &Img, &VisibleMip, &PrefetchMip);
+        float ScreenCoverage;
+        CalculateImagePagingData(&SceneBounds, &Img, &VisibleMip, &PrefetchMip, &ScreenCoverage);
 
         //
-        // If the visibility or prefetch values have changed, notify the paging thread
-        // so it can update this resource's priority.
+        // If the visibility or prefetch values have changed, or the image covers a noticeably
+        // different portion of the screen, notify the paging thread so it can update this
+        // resource's priority.
         //
-        if (pResource->VisibleMip != VisibleMip || pResource->PrefetchMip != PrefetchMip)
+        if (pResource->VisibleMip != VisibleMip ||
+            pResource->PrefetchMip != PrefetchMip ||
+            fabsf(pResource->ScreenCoverage - ScreenCoverage) > COVERAGE_REPRIORITIZE_THRESHOLD)
         {
             pResource->VisibleMip = VisibleMip;
             pResource->PrefetchMip = PrefetchMip;
+            pResource->ScreenCoverage = ScreenCoverage;
             NotifyPagingWork(pResource);
         }
 
+        UpdatePopInStatistics(&Img, CurrentTick.QuadPart);
+
         //
         // Although visibility information is calculated above using the scene camera, for debug
         // purposes, we may want to render with another camera. We will calculate the real
@@ -668,7 +863,9 @@ HRESULT D3D12MemoryManagement::RenderUI()
 
             m_pTextFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_LEADING);
             m_pTextFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_NEAR);
-            wchar_t FPSString[128];
+            float PopInAverage = m_PopInStats.Count ? m_PopInStats.TotalSeconds / m_PopInStats.Count : 0.0f;
+
+            wchar_t FPSString[256];
             swprintf_s(
                 FPSString,
                 _TRUNCATE,
@@ -676,12 +873,19 @@ HRESULT D3D12MemoryManagement::RenderUI()
                 L"Glitch Count: %d\n"
                 L"\n"
                 L"RenderScene: %.2f ms\n"
-                L"RenderUI: %.2f ms",
+                L"RenderUI: %.2f ms\n"
+                L"\n"
+                L"Pop-in Count: %d%s\n"
+                L"Pop-in Latency: %.2f ms avg, %.2f ms max",
                 (UINT)(1.0f / StatTimeBetweenFrames),
                 StatTimeBetweenFrames * 1000.0f,
                 GetGlitchCount(),
                 StatRenderScene * 1000.0f,
-                StatRenderUI * 1000.0f);
+                StatRenderUI * 1000.0f,
+                m_PopInStats.Count,
+                m_bPlayingCameraPath ? L" (camera path)" : L"",
+                PopInAverage * 1000.0f,
+                m_PopInStats.MaxSeconds * 1000.0f);
 
             m_pD2DContext->DrawTextW(
                 FPSString,
@@ -34,6 +34,22 @@ struct Image
 {
     RectF Bounds;
     Resource* pResource;
+
+    // The performance counter value at which the image first displayed a less detailed
+    // mipmap than the one it requested, or zero if the requested mipmap is resident.
+    LONGLONG PopInStartTick;
+};
+
+//
+// Pop-in statistics, measuring the time between an image requesting a more detailed
+// visible mipmap and that mipmap becoming resident. This is the delay the user perceives
+// as blurry textures "popping" into focus.
+//
+struct PopInStatistics
+{
+    UINT Count;
+    float TotalSeconds;
+    float MaxSeconds;
 };
 
 class D3D12MemoryManagement : public DX12Framework
@@ -56,6 +72,14 @@ private:
     UINT64 m_GraphPoints[NUM_GRAPH_POINTS];
 
     bool m_bDrawMipColors = false;
+
+    //
+    // Scripted camera path used to measure pop-in latency with repeatable camera motion.
+    //
+    bool m_bPlayingCameraPath = false;
+    LONGLONG m_CameraPathStartTick = 0;
+    PopInStatistics m_PopInStats = {};
+
     bool m_bSimulateDeviceRemoved = false;
     bool m_bFullscreen = false;
     RECT m_WindowRect;
@@ -84,7 +108,12 @@ protected:
         const RectF* pViewportBounds,
         const Image* pImage,
         UINT8* pVisibleMip,
-        UINT8* pPrefetchMip);
+        UINT8* pPrefetchMip,
+        float* pScreenCoverage);
+
+    void StartCameraPath();
+    void UpdateCameraPath(LONGLONG CurrentTick);
+    void UpdatePopInStatistics(Image* pImage, LONGLONG CurrentTick);
 
 public:
     D3D12MemoryManagement();
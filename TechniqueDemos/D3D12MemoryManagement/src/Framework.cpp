@@ -296,11 +296,13 @@ void DX12Framework::DestroyResourceDeviceState(Resource* pResource)
     }
 
     RemoveResourceCommitment(pResource);
-    if (pResource->PrioritizationEntry.Flink != nullptr)
-    {
-        RemoveEntryList(&pResource->PrioritizationEntry);
-        pResource->PrioritizationEntry.Flink = nullptr;
-    }
+
+    //
+    // The paging worker thread, along with its prioritization list and paging heap, has
+    // already been destroyed at this point, so the resource is simply marked as unqueued.
+    //
+    pResource->PrioritizationPending = 0;
+    pResource->PagingHeapIndex = INVALID_PAGING_HEAP_INDEX;
 }
 
 void DX12Framework::DestroyDeviceIndependentStateInternal()
@@ -1437,7 +1439,9 @@ HRESULT DX12Framework::CreateResourceDeviceState(Resource* pResource, UINT NumMi
     pResource->TrimLimit = ERTP_None;
     pResource->bIgnoreBudget = false;
 
-    pResource->PagingEntry.Flink = nullptr;
+    pResource->PrioritizationPending = 0;
+    pResource->PagingHeapIndex = INVALID_PAGING_HEAP_INDEX;
+    pResource->PagingPriority = 0.0f;
 
     //
     // Notify the paging thread of this resource so it can be prioritized. Although
@@ -26,13 +26,7 @@ PagingWorkerThread::PagingWorkerThread(DX12Framework* pFramework) :
     m_RequestedStatus(EWTS_Suspended),
     m_BudgetNotificationCookie(0)
 {
-    InitializeListHead(&m_PrioritizationListHead);
-    for (int i = 0; i < _ERP_COUNT; ++i)
-    {
-        InitializeListHead(&m_PriorityQueues[i]);
-    }
-
-    InitializeCriticalSection(&m_PrioritizationListLock);
+    InitializeSListHead(&m_PrioritizationListHead);
 
     ZeroMemory(m_hWakeEvents, sizeof(m_hWakeEvents));
 }
@@ -231,10 +225,16 @@ DWORD PagingWorkerThread::Run()
 
 void PagingWorkerThread::DiscardPendingWork()
 {
-    for (int i = 0; i < _ERP_COUNT; ++i)
+    PSLIST_ENTRY pEntry = InterlockedFlushSList(&m_PrioritizationListHead);
+    while (pEntry != nullptr)
     {
-        InitializeListHead(&m_PriorityQueues[i]);
+        Resource* pResource = CONTAINING_RECORD(pEntry, Resource, PrioritizationEntry);
+        pEntry = pEntry->Next;
+
+        InterlockedExchange(&pResource->PrioritizationPending, 0);
     }
+
+    m_PagingQueue.Clear();
 }
 
 void PagingWorkerThread::ProcessStatusChangeRequest()
@@ -260,40 +260,70 @@ void PagingWorkerThread::ProcessSubmission(bool* pMoreWork)
     *pMoreWork = true;
 
     //
-    // Select the highest priority paging operation from the priority queues. SelectResource
-    // may return null if there are no entries, or if none of the operations can be selected
-    // (e.g. paging in the resources may go over the budget)
+    // Process a batch of paging operations. Each iteration pages in the next mipmap of the
+    // highest priority resource, then reprioritizes that resource, so a batch may load several
+    // mipmaps of the same resource if it remains the most important one, or move on to other
+    // resources as soon as their priority is higher. The batch ends when the bandwidth budget
+    // is consumed, so wake events are still processed at a steady rate.
     //
-    Resource* pResource = SelectResource();
-    if (pResource == nullptr)
+    UINT64 BatchBytes = 0;
+    for (UINT Operation = 0; Operation < PAGING_BATCH_MAX_OPERATIONS; ++Operation)
     {
-        *pMoreWork = false;
-        return;
-    }
+        //
+        // Select the highest priority paging operation from the priority heap. SelectResource
+        // may return null if there are no entries, if none of the operations can be selected
+        // (e.g. paging in the resources may go over the budget), or if the next operation
+        // does not fit in the remaining batch bandwidth.
+        //
+        UINT64 MipSize;
+        Resource* pResource = SelectResource(PAGING_BATCH_BANDWIDTH_BUDGET - BatchBytes, Operation == 0, &MipSize);
+        if (pResource == nullptr)
+        {
+            if (Operation == 0)
+            {
+                *pMoreWork = false;
+            }
+            break;
+        }
 
-    //
-    // Process the request.
-    //
-    HRESULT hr = m_pFramework->PageInNextLevelOfDetail(pResource);
-    if (FAILED(hr))
-    {
-        *pMoreWork = false;
-    }
+        //
+        // Process the request.
+        //
+        HRESULT hr = m_pFramework->PageInNextLevelOfDetail(pResource);
+        if (FAILED(hr))
+        {
+            *pMoreWork = false;
+        }
 
-    //
-    // After the paging operation completes, we need to reprioritize this specific resource.
-    //
-    PrioritizeResource(pResource);
+        //
+        // After the paging operation completes, we need to reprioritize this specific resource.
+        //
+        PrioritizeResource(pResource);
 
-    //
-    // Update the video memory info to see if we need to trim anything. This may be the case
-    // if the kernel recalculated the budget while processing the operation, or if we paged in
-    // a critical resource (such as a packed mipmap), which can let us go over budget.
-    //
-    m_pFramework->UpdateVideoMemoryInfo();
-    if (m_pFramework->IsOverBudget())
-    {
-        m_pFramework->TrimToBudget(pResource->TrimLimit);
+        //
+        // Update the video memory info to see if we need to trim anything. This may be the case
+        // if the kernel recalculated the budget while processing the operation, or if we paged in
+        // a critical resource (such as a packed mipmap), which can let us go over budget.
+        //
+        m_pFramework->UpdateVideoMemoryInfo();
+        if (m_pFramework->IsOverBudget())
+        {
+            m_pFramework->TrimToBudget(pResource->TrimLimit);
+        }
+
+        if (FAILED(hr))
+        {
+            break;
+        }
+
+        //
+        // Packed mipmaps report no size of their own, but still cost at least one tile.
+        //
+        BatchBytes += max(MipSize, (UINT64)TILE_SIZE);
+        if (BatchBytes >= PAGING_BATCH_BANDWIDTH_BUDGET)
+        {
+            break;
+        }
     }
 }
 
@@ -326,35 +356,75 @@ void PagingWorkerThread::SetStatus(WorkerThreadStatus Status)
 void PagingWorkerThread::EnqueueResource(Resource* pResource)
 {
     //
-    // Take the prioritization lock as we insert resources into the prioritization list.
-    // This synchronizes the rendering thread queuing work items with the paging thread
-    // prioritizing it.
+    // The rendering thread never blocks on the paging thread when submitting work. The
+    // pending flag guarantees that a resource is on the prioritization list at most once;
+    // if it is already there, the paging thread will read its latest state when it drains
+    // the list, so there is nothing more to do.
     //
-    EnterCriticalSection(&m_PrioritizationListLock);
-
-    if (pResource->PrioritizationEntry.Flink != nullptr)
+    if (InterlockedCompareExchange(&pResource->PrioritizationPending, 1, 0) == 0)
     {
-        RemoveEntryList(&pResource->PrioritizationEntry);
+        InterlockedPushEntrySList(&m_PrioritizationListHead, &pResource->PrioritizationEntry);
     }
-    InsertTailList(&m_PrioritizationListHead, &pResource->PrioritizationEntry);
-
-    LeaveCriticalSection(&m_PrioritizationListLock);
 
     SetEvent(m_hWakeEvents[EWR_Submission]);
 }
 
 void PagingWorkerThread::ReprioritizeResources()
 {
-    EnterCriticalSection(&m_PrioritizationListLock);
-    while (!IsListEmpty(&m_PrioritizationListHead))
+    //
+    // Take ownership of every queued resource with a single atomic operation. The pending
+    // flag is cleared before the resource state is read, so any change made by the rendering
+    // thread after this point queues the resource again rather than being lost.
+    //
+    PSLIST_ENTRY pEntry = InterlockedFlushSList(&m_PrioritizationListHead);
+    while (pEntry != nullptr)
     {
-        LIST_ENTRY* pEntry = RemoveHeadList(&m_PrioritizationListHead);
         Resource* pResource = CONTAINING_RECORD(pEntry, Resource, PrioritizationEntry);
-        pResource->PrioritizationEntry.Flink = nullptr;
+        pEntry = pEntry->Next;
+
+        InterlockedExchange(&pResource->PrioritizationPending, 0);
 
         PrioritizeResource(pResource);
     }
-    LeaveCriticalSection(&m_PrioritizationListLock);
+}
+
+//
+// Returns the largest continuous paging priority that still belongs to the specified band.
+//
+static inline float GetPagingPriorityBandMaximum(ResourcePriority Band)
+{
+    return (float)(_ERP_COUNT - 1 - Band) + 0.999f;
+}
+
+//
+// Calculates the continuous paging priority of a resource within a priority band.
+//
+// The integer part of the result is the band, with ERP_VeryHigh being the largest, so
+// resources are still processed in strict band order. The fraction orders resources
+// within a band: resources covering more of the screen, and resources that are more
+// mip levels away from their target detail, are paged in first.
+//
+static float CalculatePagingPriority(ResourcePriority Band, const Resource* pResource, UINT8 TargetMip)
+{
+    float Coverage = min(max(pResource->ScreenCoverage, 0.0f), 1.0f);
+
+    float MipDistance = 0.0f;
+    if (TargetMip != UNDEFINED_MIPMAP_INDEX && IsMoreDetailedMip(pResource->MostDetailedMipResident, TargetMip))
+    {
+        MipDistance = (float)(pResource->MostDetailedMipResident - TargetMip) / MAX_MIP_COUNT;
+    }
+
+    float Score = 0.75f * Coverage + 0.25f * MipDistance;
+
+    return min((float)(_ERP_COUNT - 1 - Band) + Score, GetPagingPriorityBandMaximum(Band));
+}
+
+//
+// Returns the priority band encoded in a continuous paging priority.
+//
+static inline ResourcePriority GetPagingPriorityBand(float Priority)
+{
+    return static_cast<ResourcePriority>(_ERP_COUNT - 1 - (int)Priority);
 }
 
 void PagingWorkerThread::PrioritizeResource(Resource* pResource)
@@ -363,11 +433,8 @@ void PagingWorkerThread::PrioritizeResource(Resource* pResource)
     UINT8 VisibleMip = pResource->VisibleMip;
     UINT8 PrefetchMip = pResource->PrefetchMip;
 
-    if (pResource->PagingEntry.Flink != nullptr)
-    {
-        RemoveEntryList(&pResource->PagingEntry);
-        pResource->PagingEntry.Flink = nullptr;
-    }
+    bool bHasWork = true;
+    float Priority = 0.0f;
 
     bool AnyPackedMipsMissing = MostDetailedMipResident > GetLeastDetailedMipHeapIndex(pResource);
     bool IsInPrefetchZone = (PrefetchMip != UNDEFINED_MIPMAP_INDEX);
@@ -376,12 +443,12 @@ void PagingWorkerThread::PrioritizeResource(Resource* pResource)
     {
         //
         // If the resource has not been loaded at all, and it's in the prefetch zone,
-        // consider it very high priority. We will not only add it to the high priority
-        // queue, but also push it in at the front to ensure this occurs before anything
-        // else. We want to make sure the user has *something* to see, even if it's just
-        // the 1x1 mipmap of a rough color.
+        // consider it very high priority. The very high priority band is processed before
+        // anything else, ordered by how much of the screen each resource covers. We want
+        // to make sure the user has *something* to see, even if it's just the 1x1 mipmap
+        // of a rough color.
         //
-        InsertTailList(&m_PriorityQueues[ERP_VeryHigh], &pResource->PagingEntry);
+        Priority = CalculatePagingPriority(ERP_VeryHigh, pResource, GetLeastDetailedMipHeapIndex(pResource));
         pResource->TrimLimit = ERTP_Visible;
         pResource->bIgnoreBudget = true;
     }
@@ -392,7 +459,7 @@ void PagingWorkerThread::PrioritizeResource(Resource* pResource)
         // one currently resident. This is high priority, because we want what's on screen
         // to be visually correct.
         //
-        InsertTailList(&m_PriorityQueues[ERP_High], &pResource->PagingEntry);
+        Priority = CalculatePagingPriority(ERP_High, pResource, VisibleMip);
         pResource->TrimLimit = ERTP_NonVisible;
     }
     else if (AnyPackedMipsMissing)
@@ -400,9 +467,10 @@ void PagingWorkerThread::PrioritizeResource(Resource* pResource)
         //
         // The resource has not been loaded, but is a somewhat safe distance away from the
         // camera to be considered a lower priority. We will make sure that the stuff the user
-        // sees on screen gets loaded before this.
+        // sees on screen gets loaded before this. Within the medium band, it still takes
+        // precedence over proximity prefetching.
         //
-        InsertHeadList(&m_PriorityQueues[ERP_Medium], &pResource->PagingEntry);
+        Priority = GetPagingPriorityBandMaximum(ERP_Medium);
         pResource->TrimLimit = ERTP_Visible;
         pResource->bIgnoreBudget = true;
     }
@@ -412,7 +480,7 @@ void PagingWorkerThread::PrioritizeResource(Resource* pResource)
         // This is a proximity prefetched mipmap. The user cannot see this mipmap yet, but it
         // is nearby. We want to reduce any texture popping that may occur as the user scrolls
         //
-        InsertTailList(&m_PriorityQueues[ERP_Medium], &pResource->PagingEntry);
+        Priority = CalculatePagingPriority(ERP_Medium, pResource, PrefetchMip);
         pResource->TrimLimit = ERTP_NonPrefetchable;
 
         assert(PrefetchMip != UNDEFINED_MIPMAP_INDEX);
@@ -425,88 +493,277 @@ void PagingWorkerThread::PrioritizeResource(Resource* pResource)
         // occur after everything else, but will help guarantee that the user gets a smooth
         // experience at all times by prefetching the texture data prior to being needed.
         //
-        InsertTailList(&m_PriorityQueues[ERP_Low], &pResource->PagingEntry);
+        Priority = CalculatePagingPriority(ERP_Low, pResource, 0);
         pResource->TrimLimit = ERTP_None;
     }
+    else
+    {
+        bHasWork = false;
+    }
+
+    if (bHasWork)
+    {
+        m_PagingQueue.Update(pResource, Priority);
+    }
+    else
+    {
+        m_PagingQueue.Remove(pResource);
+    }
 }
 
 //
-// SelectResource will look at each of the priority queues and select the best operation
-// to process. Unless marked otherwise, paging operations will not be selected if the
-// resulting paging operation is within a specific threshold of going over the budget.
+// SelectResource will look at the highest priority entries in the paging heap and select the
+// best operation to process. Unless marked otherwise, paging operations will not be selected
+// if the resulting paging operation is within a specific threshold of going over the budget.
 //
-Resource* PagingWorkerThread::SelectResource()
+// BandwidthRemaining limits the size of the selected operation, so that a batch of operations
+// stays within PAGING_BATCH_BANDWIDTH_BUDGET. The first operation of a batch is always allowed,
+// regardless of its size, so large mipmaps still make progress.
+//
+Resource* PagingWorkerThread::SelectResource(UINT64 BandwidthRemaining, bool bFirstInBatch, UINT64* pMipSize)
 {
-    for (int i = 0; i < _ERP_COUNT; ++i)
+    Resource* pDeferred[PAGING_SELECTION_ATTEMPTS];
+    UINT NumDeferred = 0;
+    Resource* pSelected = nullptr;
+
+    while (!m_PagingQueue.IsEmpty() && NumDeferred < PAGING_SELECTION_ATTEMPTS)
     {
+        Resource* pResource = m_PagingQueue.Top();
+        ResourcePriority Band = GetPagingPriorityBand(pResource->PagingPriority);
+
         //
         // A small bias is applied to the current local budget to help prevent resources from
         // going over. The size calculated by the driver may differ slightly from the size
         // calculated by the kernel (due to various alignment and segment restrictions), and so
         // a buffer is used to prevent the operation from accidentally going over.
         //
-        // The bias is determined by the priority of the operation. There is a 1MB minimum
-        // bias as a "safety zone," and an 8MB buffer for each priority after that.
+        // The bias is determined by the priority band of the operation. There is a 1MB minimum
+        // bias as a "safety zone," and an 8MB buffer for each band after that.
         //
-        UINT64 BudgetBias = _1MB + _8MB * i;
+        UINT64 BudgetBias = _1MB + _8MB * Band;
 
-        if (!IsListEmpty(&m_PriorityQueues[i]))
+        //
+        // The paging thread pages in one mipmap per operation. Once paged in, the resource
+        // is reprioritized; since its mip distance shrinks, other resources with similar
+        // coverage get their turn, preventing prefetching of large, low priority allocations
+        // from delaying visibility changes.
+        //
+        UINT NextMip = IncreaseMipQuality(pResource->MostDetailedMipResident, 1);
+        UINT64 MipSize = 0;
+        if (NextMip < pResource->PackedMipHeapIndex)
         {
-            LIST_ENTRY* pEntry = m_PriorityQueues[i].Flink;
-            Resource* pResource = CONTAINING_RECORD(pEntry, Resource, PagingEntry);
+            MipSize = GetNonPackedMipSize(pResource, NextMip);
+        }
 
-            //
-            // The paging thread will only page in one mipmap at a time to be fair to all
-            // resources. This allows resources to be selected in a round-robin sequence,
-            // preventing prefetching of low priority allocations to delay visibility changes
-            // from reprioritizing operations.
-            //
-            // Even though the paging operations are asycnhronous from rendering (i.e. they
-            // should not impact performance), it is still possible for the paging operations,
-            // if long enough, to block loading mipmaps that are otherwise important. For example,
-            // loading a large 8Kx8K mipmap far off screen could cause a significant enough delay
-            // to prevent a mipmap on screen from being loaded by the time it is actually visible.
-            //
-            UINT NextMip = IncreaseMipQuality(pResource->MostDetailedMipResident, 1);
-            UINT64 MipSize = 0;
-            if (NextMip < pResource->PackedMipHeapIndex)
-            {
-                MipSize = GetNonPackedMipSize(pResource, NextMip);
-            }
+        //
+        // The highest priority operation does not fit in what is left of this batch. Leave it
+        // at the top of the heap so that it starts the next batch.
+        //
+        if (!bFirstInBatch && MipSize > BandwidthRemaining)
+        {
+            break;
+        }
 
-            //
-            // When prioritizing operations, packed mipmaps are considered critical operations,
-            // and should never be restricted by the budget. This is because packed mipmaps represent
-            // the application's minimum working set. Although the application should try as hard as
-            // possible to remain under its budget, every application will have a minimum requirement
-            // to run. For this sample, packed mipmaps are considered the lowest quality that will
-            // be tolerated. It is not expected for packed mipmaps to account for a significant amount
-            // of space, since most will fit within a single 64KB tile. This means the rough estimate
-            // cost of all packed mipmaps is 64KB*NumResources.
-            //
-            if (!pResource->bIgnoreBudget)
-            {
-                DXGI_QUERY_VIDEO_MEMORY_INFO MemoryInfo = m_pFramework->GetLocalVideoMemoryInfo();
-                UINT64 TargetUsage = MemoryInfo.Budget - (MipSize + BudgetBias);
+        m_PagingQueue.Pop();
+
+        //
+        // When prioritizing operations, packed mipmaps are considered critical operations,
+        // and should never be restricted by the budget. This is because packed mipmaps represent
+        // the application's minimum working set. Although the application should try as hard as
+        // possible to remain under its budget, every application will have a minimum requirement
+        // to run. For this sample, packed mipmaps are considered the lowest quality that will
+        // be tolerated. It is not expected for packed mipmaps to account for a significant amount
+        // of space, since most will fit within a single 64KB tile. This means the rough estimate
+        // cost of all packed mipmaps is 64KB*NumResources.
+        //
+        if (!pResource->bIgnoreBudget)
+        {
+            DXGI_QUERY_VIDEO_MEMORY_INFO MemoryInfo = m_pFramework->GetLocalVideoMemoryInfo();
+            UINT64 TargetUsage = MemoryInfo.Budget - (MipSize + BudgetBias);
 
-                if (!m_pFramework->IsWithinBudgetThreshold(MipSize + BudgetBias))
+            if (!m_pFramework->IsWithinBudgetThreshold(MipSize + BudgetBias))
+            {
+                if (!m_pFramework->TrimToTarget(pResource->TrimLimit, TargetUsage))
                 {
-                    if (!m_pFramework->TrimToTarget(pResource->TrimLimit, TargetUsage))
-                    {
-                        continue;
-                    }
+                    //
+                    // Set the resource aside and try the next one. Lower priority operations
+                    // have a larger bias, but may be small enough to still fit.
+                    //
+                    pDeferred[NumDeferred++] = pResource;
+                    continue;
                 }
             }
+        }
+
+        //
+        // Trimming may have reprioritized this resource back into the heap.
+        //
+        m_PagingQueue.Remove(pResource);
+        pResource->bIgnoreBudget = false;
+
+        *pMipSize = MipSize;
+        pSelected = pResource;
+        break;
+    }
+
+    //
+    // Return the resources that could not be paged in to the heap. They are reprioritized
+    // rather than reinserted, since trimming may have changed their resident mipmaps.
+    //
+    for (UINT i = 0; i < NumDeferred; ++i)
+    {
+        PrioritizeResource(pDeferred[i]);
+    }
+
+    return pSelected;
+}
+
+//
+// PagingPriorityQueue
+//
+
+//
+// Inserts the resource with the specified priority, or moves it to its new position if
+// it is already in the heap. Returns false if the heap could not grow.
+//
+bool PagingPriorityQueue::Update(Resource* pResource, float Priority)
+{
+    UINT Index = pResource->PagingHeapIndex;
+
+    if (Index == INVALID_PAGING_HEAP_INDEX)
+    {
+        try
+        {
+            m_Heap.push_back(pResource);
+        }
+        catch (std::bad_alloc&)
+        {
+            LOG_ERROR("Out of memory growing the paging priority heap");
+            return false;
+        }
+
+        pResource->PagingPriority = Priority;
+        Index = (UINT)m_Heap.size() - 1;
+        pResource->PagingHeapIndex = Index;
+        SiftUp(Index);
+    }
+    else
+    {
+        assert(m_Heap[Index] == pResource);
+
+        float OldPriority = pResource->PagingPriority;
+        pResource->PagingPriority = Priority;
+        if (Priority > OldPriority)
+        {
+            SiftUp(Index);
+        }
+        else
+        {
+            SiftDown(Index);
+        }
+    }
+
+    return true;
+}
 
-            RemoveEntryList(pEntry);
-            pEntry->Flink = nullptr;
-            pResource->bIgnoreBudget = false;
+void PagingPriorityQueue::Remove(Resource* pResource)
+{
+    UINT Index = pResource->PagingHeapIndex;
+    if (Index == INVALID_PAGING_HEAP_INDEX)
+    {
+        return;
+    }
+
+    assert(m_Heap[Index] == pResource);
+
+    //
+    // Move the last entry into the vacated slot, and restore the heap property in
+    // whichever direction the moved entry needs to go.
+    //
+    Resource* pLast = m_Heap.back();
+    m_Heap.pop_back();
+    pResource->PagingHeapIndex = INVALID_PAGING_HEAP_INDEX;
+
+    if (pLast != pResource)
+    {
+        Place(Index, pLast);
+        SiftUp(Index);
+        SiftDown(pLast->PagingHeapIndex);
+    }
+}
 
-            return pResource;
+Resource* PagingPriorityQueue::Pop()
+{
+    Resource* pResource = Top();
+    if (pResource != nullptr)
+    {
+        Remove(pResource);
+    }
+    return pResource;
+}
+
+void PagingPriorityQueue::Clear()
+{
+    for (Resource* pResource : m_Heap)
+    {
+        pResource->PagingHeapIndex = INVALID_PAGING_HEAP_INDEX;
+    }
+    m_Heap.clear();
+}
+
+inline void PagingPriorityQueue::Place(UINT Index, Resource* pResource)
+{
+    m_Heap[Index] = pResource;
+    pResource->PagingHeapIndex = Index;
+}
+
+void PagingPriorityQueue::SiftUp(UINT Index)
+{
+    Resource* pResource = m_Heap[Index];
+
+    while (Index > 0)
+    {
+        UINT Parent = (Index - 1) / 2;
+        if (m_Heap[Parent]->PagingPriority >= pResource->PagingPriority)
+        {
+            break;
         }
+
+        Place(Index, m_Heap[Parent]);
+        Index = Parent;
+    }
+
+    Place(Index, pResource);
+}
+
+void PagingPriorityQueue::SiftDown(UINT Index)
+{
+    UINT Count = (UINT)m_Heap.size();
+    Resource* pResource = m_Heap[Index];
+
+    for (;;)
+    {
+        UINT Child = Index * 2 + 1;
+        if (Child >= Count)
+        {
+            break;
+        }
+
+        if (Child + 1 < Count && m_Heap[Child + 1]->PagingPriority > m_Heap[Child]->PagingPriority)
+        {
+            ++Child;
+        }
+
+        if (pResource->PagingPriority >= m_Heap[Child]->PagingPriority)
+        {
+            break;
+        }
+
+        Place(Index, m_Heap[Child]);
+        Index = Child;
     }
 
-    return nullptr;
+    Place(Index, pResource);
 }
 
 //
@@ -47,6 +47,70 @@ enum WorkerThreadStatus
     _EWTS_COUNT
 };
 
+//
+// Marks a resource that is not currently stored in the paging priority heap.
+//
+#define INVALID_PAGING_HEAP_INDEX 0xFFFFFFFF
+
+//
+// The maximum number of bytes the worker thread will page in before checking for new
+// wake events (status changes, submissions, budget notifications). Batching several
+// mipmaps per wake amortizes the reprioritization and budget queries, while the cap
+// keeps a single batch from delaying higher priority work for too long.
+//
+#define PAGING_BATCH_BANDWIDTH_BUDGET _32MB
+
+//
+// The maximum number of paging operations performed in a single batch. Packed mipmaps
+// are tiny, so this prevents a batch of them from starving wake event processing.
+//
+#define PAGING_BATCH_MAX_OPERATIONS 16
+
+//
+// The number of heap entries SelectResource will inspect before giving up when the
+// highest priority resources cannot be paged in without going over the budget.
+//
+#define PAGING_SELECTION_ATTEMPTS 8
+
+//
+// An indexed binary max-heap of resources, keyed on Resource::PagingPriority. Each
+// resource stores its position in the heap, so changing the priority of a resource
+// that is already queued is an O(log n) operation rather than a list search.
+//
+// The heap is owned by the paging worker thread and is not synchronized.
+//
+class PagingPriorityQueue
+{
+private:
+    std::vector<Resource*> m_Heap;
+
+public:
+    inline bool IsEmpty() const
+    {
+        return m_Heap.empty();
+    }
+
+    inline UINT GetCount() const
+    {
+        return (UINT)m_Heap.size();
+    }
+
+    inline Resource* Top() const
+    {
+        return m_Heap.empty() ? nullptr : m_Heap[0];
+    }
+
+    bool Update(Resource* pResource, float Priority);
+    void Remove(Resource* pResource);
+    Resource* Pop();
+    void Clear();
+
+private:
+    void Place(UINT Index, Resource* pResource);
+    void SiftUp(UINT Index);
+    void SiftDown(UINT Index);
+};
+
 //
 // The paging worker thread is the powerhouse behind all paging and texture streaming
 // for the sample.
@@ -73,18 +137,15 @@ private:
     HANDLE m_hStatusChangeEvent;
     DWORD m_BudgetNotificationCookie;
 
-    // Lock for accessing the prioritization list head, which is accessed by both
-    // the rendering and paging threads.
-    CRITICAL_SECTION m_PrioritizationListLock;
-
-    // A list of unprioritized resources. A resource must be prioritized before
+    // A lock-free list of unprioritized resources. A resource must be prioritized before
     // any paging operations can occur, so that the paging thread knows how to process
-    // the resource.
-    LIST_ENTRY m_PrioritizationListHead;
+    // the resource. The rendering thread pushes onto this list without blocking, and
+    // the paging thread drains the whole list at once.
+    SLIST_HEADER m_PrioritizationListHead;
 
-    // An array of priority-ordered linked list heads. The worker thread will process
-    // resources in these arrays in strict order.
-    LIST_ENTRY m_PriorityQueues[_ERP_COUNT];
+    // The prioritized resources with pending paging work. The worker thread always
+    // processes the resource with the highest priority first.
+    PagingPriorityQueue m_PagingQueue;
 
 private:
     PagingWorkerThread(DX12Framework* pFramework);
@@ -99,7 +160,7 @@ private:
     void EnqueueResource(Resource* pResource);
     void ReprioritizeResources();
     void PrioritizeResource(Resource* pResource);
-    Resource* SelectResource();
+    Resource* SelectResource(UINT64 BandwidthRemaining, bool bFirstInBatch, UINT64* pMipSize);
 
     void ProcessStatusChangeRequest();
     void ProcessSubmission(bool* pMoreWork);
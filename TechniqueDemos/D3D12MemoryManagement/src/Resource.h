@@ -102,11 +102,21 @@ struct Resource
     // List entry for tracking the commitment of mipmaps for this resource.
     LIST_ENTRY CommittedListEntry;
 
-    // List entry used by the worker thread to prioritize paging operations.
-    LIST_ENTRY PrioritizationEntry;
+    // Lock-free list entry used by the rendering thread to submit the resource to the
+    // worker thread for prioritization.
+    SLIST_ENTRY PrioritizationEntry;
 
-    // List entry used to track paging requests.
-    LIST_ENTRY PagingEntry;
+    // Nonzero while the resource is on the worker thread's prioritization list. This
+    // ensures the resource is pushed at most once, no matter how often it changes.
+    volatile LONG PrioritizationPending;
+
+    // Index of the resource in the worker thread's paging priority heap, or
+    // INVALID_PAGING_HEAP_INDEX when no paging work is pending for the resource.
+    UINT32 PagingHeapIndex;
+
+    // The continuous paging priority calculated by the worker thread. The integer part
+    // is the ResourcePriority band, and the fraction orders resources within the band.
+    float PagingPriority;
 
     CRITICAL_SECTION ReferenceLock;
 
@@ -152,6 +162,10 @@ struct Resource
     // camera movement.
     UINT8 PrefetchMip : MAX_MIP_COUNT_BITS;
 
+    // The fraction of the scene viewport covered by this resource, in [0, 1]. Written by
+    // the rendering thread, and used by the worker thread to order paging operations.
+    float ScreenCoverage;
+
     // True if the paging operation determined during prioritization should ignore
     // the local memory budget. This is used when paging in minimum quality mipmaps
     // to ensure that every resource has at least some low quality content.